@@ -30,6 +30,12 @@ asmlinkage u32 crc32_armv8_le(u32 init_crc, const u8 buf[], u32 len);
 asmlinkage u32 crc32c_pmull_le(const u8 buf[], u32 len, u32 init_crc);
 asmlinkage u32 crc32c_armv8_le(u32 init_crc, const u8 buf[], u32 len);
 
+asmlinkage u32 crc32_neon_le(const u8 buf[], u32 len, u32 init_crc);
+asmlinkage u32 crc32c_neon_le(const u8 buf[], u32 len, u32 init_crc);
+
+static u32 (*pmull_crc32)(const u8 buf[], u32 len, u32 init_crc);
+static u32 (*pmull_crc32c)(const u8 buf[], u32 len, u32 init_crc);
+
 static u32 (*fallback_crc32)(u32 init_crc, const u8 buf[], u32 len);
 static u32 (*fallback_crc32c)(u32 init_crc, const u8 buf[], u32 len);
 
@@ -123,7 +129,7 @@ static int crc32_pmull_update(struct shash_desc *desc, const u8 *data,
 			l = round_down(length, SCALE_F);
 
 			kernel_neon_begin();
-			*crc = crc32_pmull_le(data, l, *crc);
+			*crc = pmull_crc32(data, l, *crc);
 			kernel_neon_end();
 
 			data += l;
@@ -157,7 +163,7 @@ static int crc32c_pmull_update(struct shash_desc *desc, const u8 *data,
 			l = round_down(length, SCALE_F);
 
 			kernel_neon_begin();
-			*crc = crc32c_pmull_le(data, l, *crc);
+			*crc = pmull_crc32c(data, l, *crc);
 			kernel_neon_end();
 
 			data += l;
@@ -210,6 +216,8 @@ static int __init crc32_pmull_mod_init(void)
 	if (elf_hwcap2 & HWCAP2_PMULL) {
 		crc32_pmull_algs[0].update = crc32_pmull_update;
 		crc32_pmull_algs[1].update = crc32c_pmull_update;
+		pmull_crc32 = crc32_pmull_le;
+		pmull_crc32c = crc32c_pmull_le;
 
 		if (elf_hwcap2 & HWCAP2_CRC32) {
 			fallback_crc32 = crc32_armv8_le;
@@ -219,7 +227,28 @@ static int __init crc32_pmull_mod_init(void)
 			fallback_crc32c = __crc32c_le;
 		}
 	} else if (!(elf_hwcap2 & HWCAP2_CRC32)) {
-		return -ENODEV;
+		/*
+		 * ARMv7 cores such as the Cortex-A9 still beat the table driven
+		 * code by folding with the NEON vmull.p8 instruction.
+		 */
+		if (!(elf_hwcap & HWCAP_NEON))
+			return -ENODEV;
+
+		crc32_pmull_algs[0].update = crc32_pmull_update;
+		crc32_pmull_algs[1].update = crc32c_pmull_update;
+		pmull_crc32 = crc32_neon_le;
+		pmull_crc32c = crc32c_neon_le;
+		fallback_crc32 = crc32_le;
+		fallback_crc32c = __crc32c_le;
+
+		strscpy(crc32_pmull_algs[0].base.cra_driver_name,
+			"crc32-arm-neon", CRYPTO_MAX_ALG_NAME);
+		strscpy(crc32_pmull_algs[1].base.cra_driver_name,
+			"crc32c-arm-neon", CRYPTO_MAX_ALG_NAME);
+
+		/* preferred to the generic code, not to the CE versions */
+		crc32_pmull_algs[0].base.cra_priority = 150;
+		crc32_pmull_algs[1].base.cra_priority = 150;
 	}
 
 	return crypto_register_shashes(crc32_pmull_algs,
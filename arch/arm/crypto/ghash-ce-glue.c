@@ -9,11 +9,17 @@
 #include <asm/neon.h>
 #include <asm/simd.h>
 #include <asm/unaligned.h>
+#include <crypto/aes.h>
+#include <crypto/algapi.h>
 #include <crypto/b128ops.h>
 #include <crypto/cryptd.h>
+#include <crypto/gcm.h>
+#include <crypto/internal/aead.h>
 #include <crypto/internal/hash.h>
 #include <crypto/internal/simd.h>
+#include <crypto/internal/skcipher.h>
 #include <crypto/gf128mul.h>
+#include <crypto/scatterwalk.h>
 #include <linux/cpufeature.h>
 #include <linux/crypto.h>
 #include <linux/jump_label.h>
@@ -23,6 +29,7 @@ MODULE_DESCRIPTION("GHASH hash function using ARMv8 Crypto Extensions");
 MODULE_AUTHOR("Ard Biesheuvel <ard.biesheuvel@linaro.org>");
 MODULE_LICENSE("GPL v2");
 MODULE_ALIAS_CRYPTO("ghash");
+MODULE_ALIAS_CRYPTO("gcm(aes)");
 
 #define GHASH_BLOCK_SIZE	16
 #define GHASH_DIGEST_SIZE	16
@@ -42,6 +49,12 @@ struct ghash_async_ctx {
 	struct cryptd_ahash *cryptd_tfm;
 };
 
+struct gcm_aes_ctx {
+	struct crypto_sync_skcipher *ctr;
+	struct crypto_aes_ctx aes_key;
+	struct ghash_key ghash_key;
+};
+
 asmlinkage void pmull_ghash_update_p64(int blocks, u64 dg[], const char *src,
 				       u64 const h[][2], const char *head);
 
@@ -153,14 +166,8 @@ static void ghash_reflect(u64 h[], const be128 *k)
 		h[1] ^= 0xc200000000000000UL;
 }
 
-static int ghash_setkey(struct crypto_shash *tfm,
-			const u8 *inkey, unsigned int keylen)
+static void ghash_expand_key(struct ghash_key *key, const u8 *inkey)
 {
-	struct ghash_key *key = crypto_shash_ctx(tfm);
-
-	if (keylen != GHASH_BLOCK_SIZE)
-		return -EINVAL;
-
 	/* needed for the fallback */
 	memcpy(&key->k, inkey, GHASH_BLOCK_SIZE);
 	ghash_reflect(key->h[0], &key->k);
@@ -177,6 +184,17 @@ static int ghash_setkey(struct crypto_shash *tfm,
 		gf128mul_lle(&h, &key->k);
 		ghash_reflect(key->h[3], &h);
 	}
+}
+
+static int ghash_setkey(struct crypto_shash *tfm,
+			const u8 *inkey, unsigned int keylen)
+{
+	struct ghash_key *key = crypto_shash_ctx(tfm);
+
+	if (keylen != GHASH_BLOCK_SIZE)
+		return -EINVAL;
+
+	ghash_expand_key(key, inkey);
 	return 0;
 }
 
@@ -344,6 +362,253 @@ static struct ahash_alg ghash_async_alg = {
 	},
 };
 
+/*
+ * gcm(aes) without going through the gcm template: the template hashes
+ * through the asynchronous ghash-ce, which costs a request and a callback
+ * per step, while here GHASH runs directly over the scatterlists.  The
+ * CTR part is done by the best synchronous ctr(aes), i.e. the bit sliced
+ * NEON one on cores without the Crypto Extensions.
+ */
+static void gcm_update_mac(u64 dg[], const u8 *src, int count, u8 buf[],
+			   int *buf_count, struct gcm_aes_ctx *ctx)
+{
+	if (*buf_count > 0) {
+		int buf_added = min(count, GHASH_BLOCK_SIZE - *buf_count);
+
+		memcpy(&buf[*buf_count], src, buf_added);
+
+		*buf_count += buf_added;
+		src += buf_added;
+		count -= buf_added;
+	}
+
+	if (count >= GHASH_BLOCK_SIZE || *buf_count == GHASH_BLOCK_SIZE) {
+		int blocks = count / GHASH_BLOCK_SIZE;
+
+		ghash_do_update(blocks, dg, src, &ctx->ghash_key,
+				*buf_count ? buf : NULL);
+
+		src += blocks * GHASH_BLOCK_SIZE;
+		count %= GHASH_BLOCK_SIZE;
+		*buf_count = 0;
+	}
+
+	if (count > 0) {
+		memcpy(buf, src, count);
+		*buf_count = count;
+	}
+}
+
+static void gcm_calculate_mac(struct gcm_aes_ctx *ctx, u64 dg[],
+			      struct scatterlist *sg, u32 len)
+{
+	u8 buf[GHASH_BLOCK_SIZE];
+	struct scatter_walk walk;
+	int buf_count = 0;
+
+	if (!len)
+		return;
+
+	scatterwalk_start(&walk, sg);
+
+	do {
+		u32 n = scatterwalk_clamp(&walk, len);
+		u8 *p;
+
+		if (!n) {
+			scatterwalk_start(&walk, sg_next(walk.sg));
+			n = scatterwalk_clamp(&walk, len);
+		}
+		p = scatterwalk_map(&walk);
+
+		gcm_update_mac(dg, p, n, buf, &buf_count, ctx);
+		len -= n;
+
+		scatterwalk_unmap(p);
+		scatterwalk_advance(&walk, n);
+		scatterwalk_done(&walk, 0, len);
+	} while (len);
+
+	if (buf_count) {
+		memset(&buf[buf_count], 0, GHASH_BLOCK_SIZE - buf_count);
+		ghash_do_update(1, dg, buf, &ctx->ghash_key, NULL);
+	}
+}
+
+static void gcm_final(struct aead_request *req, struct gcm_aes_ctx *ctx,
+		      u64 dg[], u8 tag[], u32 cryptlen)
+{
+	u8 j0[AES_BLOCK_SIZE];
+	be128 lengths;
+
+	lengths.a = cpu_to_be64((u64)req->assoclen * 8);
+	lengths.b = cpu_to_be64((u64)cryptlen * 8);
+	ghash_do_update(1, dg, (void *)&lengths, &ctx->ghash_key, NULL);
+
+	put_unaligned_be64(dg[1], tag);
+	put_unaligned_be64(dg[0], tag + 8);
+
+	memcpy(j0, req->iv, GCM_AES_IV_SIZE);
+	put_unaligned_be32(1, j0 + GCM_AES_IV_SIZE);
+	aes_encrypt(&ctx->aes_key, j0, j0);
+	crypto_xor(tag, j0, AES_BLOCK_SIZE);
+	memzero_explicit(j0, sizeof(j0));
+}
+
+static int gcm_ctr_crypt(struct aead_request *req, struct gcm_aes_ctx *ctx,
+			 struct scatterlist *src, struct scatterlist *dst,
+			 u32 cryptlen)
+{
+	SYNC_SKCIPHER_REQUEST_ON_STACK(subreq, ctx->ctr);
+	u8 iv[AES_BLOCK_SIZE];
+	int err;
+
+	/* the counter starts right after J0 */
+	memcpy(iv, req->iv, GCM_AES_IV_SIZE);
+	put_unaligned_be32(2, iv + GCM_AES_IV_SIZE);
+
+	skcipher_request_set_sync_tfm(subreq, ctx->ctr);
+	skcipher_request_set_callback(subreq, req->base.flags, NULL, NULL);
+	skcipher_request_set_crypt(subreq, src, dst, cryptlen, iv);
+	err = crypto_skcipher_encrypt(subreq);
+	skcipher_request_zero(subreq);
+
+	return err;
+}
+
+static int gcm_aes_encrypt(struct aead_request *req)
+{
+	struct crypto_aead *aead = crypto_aead_reqtfm(req);
+	struct gcm_aes_ctx *ctx = crypto_aead_ctx(aead);
+	struct scatterlist src_sg[2], dst_sg[2], *src, *dst;
+	u8 tag[AES_BLOCK_SIZE];
+	u64 dg[2] = {};
+	int err;
+
+	src = scatterwalk_ffwd(src_sg, req->src, req->assoclen);
+	dst = src;
+	if (req->src != req->dst)
+		dst = scatterwalk_ffwd(dst_sg, req->dst, req->assoclen);
+
+	if (req->cryptlen) {
+		err = gcm_ctr_crypt(req, ctx, src, dst, req->cryptlen);
+		if (err)
+			return err;
+	}
+
+	gcm_calculate_mac(ctx, dg, req->src, req->assoclen);
+	gcm_calculate_mac(ctx, dg, dst, req->cryptlen);
+	gcm_final(req, ctx, dg, tag, req->cryptlen);
+
+	scatterwalk_map_and_copy(tag, req->dst, req->assoclen + req->cryptlen,
+				 crypto_aead_authsize(aead), 1);
+	return 0;
+}
+
+static int gcm_aes_decrypt(struct aead_request *req)
+{
+	struct crypto_aead *aead = crypto_aead_reqtfm(req);
+	struct gcm_aes_ctx *ctx = crypto_aead_ctx(aead);
+	unsigned int authsize = crypto_aead_authsize(aead);
+	struct scatterlist src_sg[2], dst_sg[2], *src, *dst;
+	u8 tag[AES_BLOCK_SIZE], otag[AES_BLOCK_SIZE];
+	u64 dg[2] = {};
+	u32 cryptlen;
+
+	if (req->cryptlen < authsize)
+		return -EINVAL;
+	cryptlen = req->cryptlen - authsize;
+
+	src = scatterwalk_ffwd(src_sg, req->src, req->assoclen);
+	dst = src;
+	if (req->src != req->dst)
+		dst = scatterwalk_ffwd(dst_sg, req->dst, req->assoclen);
+
+	/* authenticate before decrypting anything */
+	gcm_calculate_mac(ctx, dg, req->src, req->assoclen);
+	gcm_calculate_mac(ctx, dg, src, cryptlen);
+	gcm_final(req, ctx, dg, tag, cryptlen);
+
+	scatterwalk_map_and_copy(otag, req->src, req->assoclen + cryptlen,
+				 authsize, 0);
+	if (crypto_memneq(tag, otag, authsize))
+		return -EBADMSG;
+
+	if (!cryptlen)
+		return 0;
+
+	return gcm_ctr_crypt(req, ctx, src, dst, cryptlen);
+}
+
+static int gcm_aes_setkey(struct crypto_aead *tfm, const u8 *inkey,
+			  unsigned int keylen)
+{
+	struct gcm_aes_ctx *ctx = crypto_aead_ctx(tfm);
+	u8 h[AES_BLOCK_SIZE] = {};
+	int err;
+
+	err = aes_expandkey(&ctx->aes_key, inkey, keylen);
+	if (err)
+		return err;
+
+	crypto_sync_skcipher_clear_flags(ctx->ctr, CRYPTO_TFM_REQ_MASK);
+	crypto_sync_skcipher_set_flags(ctx->ctr, crypto_aead_get_flags(tfm) &
+					       CRYPTO_TFM_REQ_MASK);
+	err = crypto_sync_skcipher_setkey(ctx->ctr, inkey, keylen);
+	if (err)
+		return err;
+
+	aes_encrypt(&ctx->aes_key, h, h);
+	ghash_expand_key(&ctx->ghash_key, h);
+	memzero_explicit(h, sizeof(h));
+
+	return 0;
+}
+
+static int gcm_aes_setauthsize(struct crypto_aead *tfm, unsigned int authsize)
+{
+	return crypto_gcm_check_authsize(authsize);
+}
+
+static int gcm_aes_init_tfm(struct crypto_aead *tfm)
+{
+	struct gcm_aes_ctx *ctx = crypto_aead_ctx(tfm);
+	struct crypto_sync_skcipher *ctr;
+
+	ctr = crypto_alloc_sync_skcipher("ctr(aes)", 0, 0);
+	if (IS_ERR(ctr))
+		return PTR_ERR(ctr);
+
+	ctx->ctr = ctr;
+	return 0;
+}
+
+static void gcm_aes_exit_tfm(struct crypto_aead *tfm)
+{
+	struct gcm_aes_ctx *ctx = crypto_aead_ctx(tfm);
+
+	crypto_free_sync_skcipher(ctx->ctr);
+}
+
+static struct aead_alg gcm_aes_alg = {
+	.ivsize			= GCM_AES_IV_SIZE,
+	.chunksize		= AES_BLOCK_SIZE,
+	.maxauthsize		= AES_BLOCK_SIZE,
+	.setkey			= gcm_aes_setkey,
+	.setauthsize		= gcm_aes_setauthsize,
+	.encrypt		= gcm_aes_encrypt,
+	.decrypt		= gcm_aes_decrypt,
+	.init			= gcm_aes_init_tfm,
+	.exit			= gcm_aes_exit_tfm,
+
+	.base.cra_name		= "gcm(aes)",
+	.base.cra_driver_name	= "gcm-aes-neon",
+	.base.cra_priority	= 300,
+	.base.cra_blocksize	= 1,
+	.base.cra_ctxsize	= sizeof(struct gcm_aes_ctx) + sizeof(u64[2]),
+	.base.cra_module	= THIS_MODULE,
+};
+
 static int __init ghash_ce_mod_init(void)
 {
 	int err;
@@ -353,6 +618,7 @@ static int __init ghash_ce_mod_init(void)
 
 	if (elf_hwcap2 & HWCAP2_PMULL) {
 		ghash_alg.base.cra_ctxsize += 3 * sizeof(u64[2]);
+		gcm_aes_alg.base.cra_ctxsize += 3 * sizeof(u64[2]);
 		static_branch_enable(&use_p64);
 	}
 
@@ -362,9 +628,14 @@ static int __init ghash_ce_mod_init(void)
 	err = crypto_register_ahash(&ghash_async_alg);
 	if (err)
 		goto err_shash;
+	err = crypto_register_aead(&gcm_aes_alg);
+	if (err)
+		goto err_ahash;
 
 	return 0;
 
+err_ahash:
+	crypto_unregister_ahash(&ghash_async_alg);
 err_shash:
 	crypto_unregister_shash(&ghash_alg);
 	return err;
@@ -372,6 +643,7 @@ static int __init ghash_ce_mod_init(void)
 
 static void __exit ghash_ce_mod_exit(void)
 {
+	crypto_unregister_aead(&gcm_aes_alg);
 	crypto_unregister_ahash(&ghash_async_alg);
 	crypto_unregister_shash(&ghash_alg);
 }
@@ -11,8 +11,12 @@
 #include <linux/spinlock.h>
 #include <linux/log2.h>
 #include <linux/io.h>
+#include <linux/gfp.h>
+#include <linux/math64.h>
+#include <linux/moduleparam.h>
 #include <linux/of.h>
 #include <linux/of_address.h>
+#include <linux/sched/clock.h>
 
 #include <asm/cacheflush.h>
 #include <asm/cp15.h>
@@ -48,6 +52,10 @@ struct l2x0_regs l2x0_saved_regs;
 static bool l2x0_bresp_disable;
 static bool l2x0_flz_disable;
 
+static unsigned int l2c310_rev;
+static u32 l2c310_boot_prefetch;
+static u32 l2c310_boot_pwr_ctrl;
+
 /*
  * Common code for all cache controllers.
  */
@@ -536,6 +544,128 @@ static void l2c310_flush_all_erratum(void)
 	raw_spin_unlock_irqrestore(&l2x0_lock, flags);
 }
 
+/*
+ * Large ranges are cheaper to clean by way than line by line, but a way
+ * operation runs in the background and any operation issued meanwhile gets
+ * a SLVERR.  The line operations, atomic otherwise, are therefore made to
+ * exclude the way ones with a rwlock, taken for read, so they still don't
+ * serialize with each other.  The size above which cleaning by way pays is
+ * measured at boot on dirty lines, the worst case for the line operations,
+ * see l2c310_calibrate().  Flushing by way also invalidates the lines
+ * outside of the range, which is only sensible for a range larger than the
+ * cache.
+ */
+static DEFINE_RWLOCK(l2c310_way_lock);
+static unsigned long l2c310_clean_way_size = ULONG_MAX;
+static unsigned long l2c310_flush_way_size = ULONG_MAX;
+
+static void l2c310_op_way_locked(unsigned reg)
+{
+	void __iomem *base = l2x0_base;
+	unsigned long flags;
+
+	write_lock_irqsave(&l2c310_way_lock, flags);
+	__l2c_op_way(base + reg);
+	__l2c210_cache_sync(base);
+	write_unlock_irqrestore(&l2c310_way_lock, flags);
+}
+
+static void l2c310_inv_range(unsigned long start, unsigned long end)
+{
+	unsigned long flags;
+
+	read_lock_irqsave(&l2c310_way_lock, flags);
+	l2c210_inv_range(start, end);
+	read_unlock_irqrestore(&l2c310_way_lock, flags);
+}
+
+static void l2c310_clean_range(unsigned long start, unsigned long end)
+{
+	unsigned long flags;
+
+	if (end - start >= l2c310_clean_way_size) {
+		l2c310_op_way_locked(L2X0_CLEAN_WAY);
+		return;
+	}
+
+	read_lock_irqsave(&l2c310_way_lock, flags);
+	l2c210_clean_range(start, end);
+	read_unlock_irqrestore(&l2c310_way_lock, flags);
+}
+
+static void l2c310_flush_range(unsigned long start, unsigned long end)
+{
+	unsigned long flags;
+
+	if (end - start >= l2c310_flush_way_size) {
+		l2c310_op_way_locked(L2X0_CLEAN_INV_WAY);
+		return;
+	}
+
+	read_lock_irqsave(&l2c310_way_lock, flags);
+	l2c210_flush_range(start, end);
+	read_unlock_irqrestore(&l2c310_way_lock, flags);
+}
+
+static void l2c310_flush_all(void)
+{
+	l2c310_op_way_locked(L2X0_CLEAN_INV_WAY);
+}
+
+static void l2c310_sync(void)
+{
+	unsigned long flags;
+
+	read_lock_irqsave(&l2c310_way_lock, flags);
+	__l2c210_cache_sync(l2x0_base);
+	read_unlock_irqrestore(&l2c310_way_lock, flags);
+}
+
+#define L2C310_CALIBRATE_ORDER	4
+
+static int __init l2c310_calibrate(void)
+{
+	unsigned long size = PAGE_SIZE << L2C310_CALIBRATE_ORDER;
+	unsigned long addr, flags;
+	phys_addr_t phys;
+	u64 t0, t_line, t_way;
+
+	if (outer_cache.clean_range != l2c310_clean_range)
+		return 0;
+
+	addr = __get_free_pages(GFP_KERNEL, L2C310_CALIBRATE_ORDER);
+	if (!addr)
+		return 0;
+	phys = virt_to_phys((void *)addr);
+
+	/* push dirty lines out of L1 into the L2 */
+	memset((void *)addr, 0x5a, size);
+	__cpuc_flush_dcache_area((void *)addr, size);
+
+	local_irq_save(flags);
+	t0 = sched_clock();
+	l2c310_clean_range(phys, phys + size);
+	t_line = sched_clock() - t0;
+
+	t0 = sched_clock();
+	l2c310_op_way_locked(L2X0_CLEAN_WAY);
+	t_way = sched_clock() - t0;
+	local_irq_restore(flags);
+
+	free_pages(addr, L2C310_CALIBRATE_ORDER);
+
+	if (t_line)
+		size = max_t(u64, size, div64_u64(t_way * size, t_line));
+	l2c310_clean_way_size = size;
+	l2c310_flush_way_size = max_t(unsigned long, size, l2x0_size);
+
+	pr_info("L2C-310 way maintenance from %lu kB clean, %lu kB flush\n",
+		l2c310_clean_way_size >> 10, l2c310_flush_way_size >> 10);
+
+	return 0;
+}
+late_initcall(l2c310_calibrate);
+
 static void __init l2c310_save(void __iomem *base)
 {
 	unsigned revision;
@@ -563,8 +693,129 @@ static void __init l2c310_save(void __iomem *base)
 	if (revision >= L310_CACHE_ID_RTL_R3P0)
 		l2x0_saved_regs.pwr_ctrl = readl_relaxed(base +
 							L310_POWER_CTRL);
+
+	/* the last save is of the configuration the kernel booted with */
+	l2c310_rev = revision;
+	l2c310_boot_prefetch = l2x0_saved_regs.prefetch_ctrl;
+	l2c310_boot_pwr_ctrl = l2x0_saved_regs.pwr_ctrl;
+}
+
+/*
+ * Runtime selectable tuning of the L2C-310, for the workloads the DT
+ * settings don't suit.  "l2c310_profile=<name>" on the command line, or
+ * written to /sys/module/kernel/parameters/l2c310_profile, reprograms the
+ * prefetch and power control registers, the only ones which can change
+ * with the cache enabled.  The effect on the hit, miss and castout rates
+ * can be followed with the l2c_310 perf events.
+ */
+struct l2c310_profile {
+	const char *name;
+	u32 prefetch;
+	u32 pwr_ctrl;
+};
+
+static const struct l2c310_profile l2c310_profiles[] = {
+	/* the boot configuration */
+	{ .name = "default" },
+	/* long sequential accesses, e.g. buffers shared with DMA masters */
+	{
+		.name = "streaming",
+		.prefetch = L310_PREFETCH_CTRL_DBL_LINEFILL |
+			    L310_PREFETCH_CTRL_INSTR_PREFETCH |
+			    L310_PREFETCH_CTRL_DATA_PREFETCH |
+			    L310_PREFETCH_CTRL_DBL_LINEFILL_INCR | 7,
+		.pwr_ctrl = L310_DYNAMIC_CLK_GATING_EN,
+	},
+	/* no speculative linefills competing with the demand ones */
+	{
+		.name = "latency",
+		.prefetch = 0,
+		.pwr_ctrl = 0,
+	},
+};
+
+static unsigned int l2c310_profile;
+
+static void l2c310_set_profile(unsigned int idx)
+{
+	const struct l2c310_profile *profile = &l2c310_profiles[idx];
+	u32 prefetch_en = L310_PREFETCH_CTRL_DATA_PREFETCH |
+			  L310_PREFETCH_CTRL_INSTR_PREFETCH;
+	u32 prefetch = idx ? profile->prefetch : l2c310_boot_prefetch;
+	u32 pwr_ctrl = idx ? profile->pwr_ctrl : l2c310_boot_pwr_ctrl;
+
+	/* erratum 752271, see l2c310_fixup() */
+	if (l2c310_rev >= L310_CACHE_ID_RTL_R3P0 &&
+	    l2c310_rev < L310_CACHE_ID_RTL_R3P2)
+		prefetch &= ~L310_PREFETCH_CTRL_DBL_LINEFILL;
+
+	/* the prefetch enables are shared with the auxiliary control */
+	l2x0_saved_regs.aux_ctrl &= ~prefetch_en;
+	l2x0_saved_regs.aux_ctrl |= prefetch & prefetch_en;
+	l2x0_saved_regs.prefetch_ctrl = prefetch;
+	l2c_write_sec(prefetch, l2x0_base, L310_PREFETCH_CTRL);
+
+	if (l2c310_rev >= L310_CACHE_ID_RTL_R3P0) {
+		l2x0_saved_regs.pwr_ctrl = pwr_ctrl;
+		l2c_write_sec(pwr_ctrl, l2x0_base, L310_POWER_CTRL);
+	}
+
+	pr_info("L2C-310 %s profile, prefetch 0x%08x, power 0x%08x\n",
+		profile->name, prefetch, pwr_ctrl);
+}
+
+static bool l2c310_can_set_profile(void)
+{
+	return l2x0_base && l2c310_rev >= L310_CACHE_ID_RTL_R2P0;
 }
 
+static int l2c310_profile_store(const char *val, const struct kernel_param *kp)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(l2c310_profiles); i++)
+		if (sysfs_streq(val, l2c310_profiles[i].name))
+			break;
+	if (i == ARRAY_SIZE(l2c310_profiles))
+		return -EINVAL;
+
+	l2c310_profile = i;
+
+	/* on the command line, it is applied by l2c310_profile_init() */
+	if (l2c310_can_set_profile() && system_state != SYSTEM_BOOTING)
+		l2c310_set_profile(i);
+
+	return 0;
+}
+
+static int l2c310_profile_show(char *buf, const struct kernel_param *kp)
+{
+	unsigned int i;
+	int len = 0;
+
+	for (i = 0; i < ARRAY_SIZE(l2c310_profiles); i++)
+		len += sprintf(buf + len, i == l2c310_profile ? "[%s] " : "%s ",
+			       l2c310_profiles[i].name);
+	buf[len - 1] = '\n';
+
+	return len;
+}
+
+static const struct kernel_param_ops l2c310_profile_ops = {
+	.set = l2c310_profile_store,
+	.get = l2c310_profile_show,
+};
+core_param_cb(l2c310_profile, &l2c310_profile_ops, NULL, 0644);
+
+static int __init l2c310_profile_init(void)
+{
+	if (l2c310_profile && l2c310_can_set_profile())
+		l2c310_set_profile(l2c310_profile);
+
+	return 0;
+}
+arch_initcall(l2c310_profile_init);
+
 static void l2c310_configure(void __iomem *base)
 {
 	unsigned revision;
@@ -720,6 +971,26 @@ static void __init l2c310_fixup(void __iomem *base, u32 cache_id,
 	if (IS_ENABLED(CONFIG_PL310_ERRATA_769419))
 		errata[n++] = "769419";
 
+	/*
+	 * Way based maintenance of large ranges, when none of the above or
+	 * the bcm variant replaced the line operations.  Not on RT, where
+	 * the rwlock sleeps.
+	 */
+	if (!IS_ENABLED(CONFIG_PREEMPT_RT) &&
+	    fns->inv_range == l2c210_inv_range &&
+	    fns->flush_range == l2c210_flush_range &&
+	    fns->flush_all == l2c210_flush_all) {
+		fns->inv_range = l2c310_inv_range;
+		fns->clean_range = l2c310_clean_range;
+		fns->flush_range = l2c310_flush_range;
+		fns->flush_all = l2c310_flush_all;
+		/* the I/O coherent variant has no sync */
+		if (fns->sync == l2c210_sync)
+			fns->sync = l2c310_sync;
+		l2c310_clean_way_size = l2x0_size;
+		l2c310_flush_way_size = l2x0_size;
+	}
+
 	if (n) {
 		unsigned i;
 
@@ -14,16 +14,21 @@
 #include <linux/blk-crypto-profile.h>
 #include <linux/blkdev.h>
 #include <linux/crypto.h>
+#include <linux/debugfs.h>
 #include <linux/mempool.h>
 #include <linux/module.h>
 #include <linux/random.h>
 #include <linux/scatterlist.h>
+#include <linux/seq_file.h>
 
+#include "blk.h"
 #include "blk-cgroup.h"
 #include "blk-crypto-internal.h"
 
 static unsigned int num_prealloc_bounce_pg = 32;
-module_param(num_prealloc_bounce_pg, uint, 0);
+static const struct kernel_param_ops num_prealloc_bounce_pg_ops;
+module_param_cb(num_prealloc_bounce_pg, &num_prealloc_bounce_pg_ops,
+		&num_prealloc_bounce_pg, 0644);
 MODULE_PARM_DESC(num_prealloc_bounce_pg,
 		 "Number of preallocated bounce pages for the blk-crypto crypto API fallback");
 
@@ -83,6 +88,13 @@ static struct workqueue_struct *blk_crypto_wq;
 static mempool_t *blk_crypto_bounce_page_pool;
 static struct bio_set crypto_bio_split;
 
+/* Throughput of the fallback, in /sys/kernel/debug/block/ */
+static atomic64_t blk_crypto_encrypt_bytes;
+static atomic64_t blk_crypto_encrypt_ns;
+static atomic64_t blk_crypto_decrypt_bytes;
+static atomic64_t blk_crypto_decrypt_ns;
+static atomic_long_t blk_crypto_bounce_waits;
+
 /*
  * This is the key we set when evicting a keyslot. This *should* be the all 0's
  * key, but AES-XTS rejects that key, so we use some random bytes instead.
@@ -242,6 +254,23 @@ union blk_crypto_iv {
 	u8 bytes[BLK_CRYPTO_MAX_IV_SIZE];
 };
 
+/*
+ * Take a bounce page without waiting if possible, so that a pool too small for
+ * the workload shows in the statistics.
+ */
+static struct page *blk_crypto_fallback_alloc_bounce_page(void)
+{
+	struct page *page;
+
+	page = mempool_alloc(blk_crypto_bounce_page_pool,
+			     GFP_NOWAIT | __GFP_NOWARN);
+	if (page)
+		return page;
+
+	atomic_long_inc(&blk_crypto_bounce_waits);
+	return mempool_alloc(blk_crypto_bounce_page_pool, GFP_NOIO);
+}
+
 static void blk_crypto_dun_to_iv(const u64 dun[BLK_CRYPTO_DUN_ARRAY_SIZE],
 				 union blk_crypto_iv *iv)
 {
@@ -272,6 +301,7 @@ static bool blk_crypto_fallback_encrypt_bio(struct bio **bio_ptr)
 	unsigned int i, j;
 	bool ret = false;
 	blk_status_t blk_st;
+	u64 start;
 
 	/* Split the bio if it's too big for single page bvec */
 	if (!blk_crypto_fallback_split_bio_if_needed(bio_ptr))
@@ -312,12 +342,14 @@ static bool blk_crypto_fallback_encrypt_bio(struct bio **bio_ptr)
 	skcipher_request_set_crypt(ciph_req, &src, &dst, data_unit_size,
 				   iv.bytes);
 
+	start = ktime_get_ns();
+
 	/* Encrypt each page in the bounce bio */
 	for (i = 0; i < enc_bio->bi_vcnt; i++) {
 		struct bio_vec *enc_bvec = &enc_bio->bi_io_vec[i];
 		struct page *plaintext_page = enc_bvec->bv_page;
 		struct page *ciphertext_page =
-			mempool_alloc(blk_crypto_bounce_page_pool, GFP_NOIO);
+			blk_crypto_fallback_alloc_bounce_page();
 
 		enc_bvec->bv_page = ciphertext_page;
 
@@ -346,6 +378,9 @@ static bool blk_crypto_fallback_encrypt_bio(struct bio **bio_ptr)
 		}
 	}
 
+	atomic64_add(ktime_get_ns() - start, &blk_crypto_encrypt_ns);
+	atomic64_add(enc_bio->bi_iter.bi_size, &blk_crypto_encrypt_bytes);
+
 	enc_bio->bi_private = src_bio;
 	enc_bio->bi_end_io = blk_crypto_fallback_encrypt_endio;
 	*bio_ptr = enc_bio;
@@ -390,6 +425,7 @@ static void blk_crypto_fallback_decrypt_bio(struct work_struct *work)
 	const int data_unit_size = bc->bc_key->crypto_cfg.data_unit_size;
 	unsigned int i;
 	blk_status_t blk_st;
+	u64 start;
 
 	/*
 	 * Get a blk-crypto-fallback keyslot that contains a crypto_skcipher for
@@ -413,6 +449,8 @@ static void blk_crypto_fallback_decrypt_bio(struct work_struct *work)
 	skcipher_request_set_crypt(ciph_req, &sg, &sg, data_unit_size,
 				   iv.bytes);
 
+	start = ktime_get_ns();
+
 	/* Decrypt each segment in the bio */
 	__bio_for_each_segment(bv, bio, iter, f_ctx->crypt_iter) {
 		struct page *page = bv.bv_page;
@@ -432,6 +470,9 @@ static void blk_crypto_fallback_decrypt_bio(struct work_struct *work)
 		}
 	}
 
+	atomic64_add(ktime_get_ns() - start, &blk_crypto_decrypt_ns);
+	atomic64_add(f_ctx->crypt_iter.bi_size, &blk_crypto_decrypt_bytes);
+
 out:
 	skcipher_request_free(ciph_req);
 	blk_crypto_put_keyslot(slot);
@@ -529,7 +570,53 @@ int blk_crypto_fallback_evict_key(const struct blk_crypto_key *key)
 	return __blk_crypto_evict_key(blk_crypto_fallback_profile, key);
 }
 
+static int blk_crypto_fallback_stats_show(struct seq_file *s, void *data)
+{
+	seq_printf(s, "encrypt_bytes\t%lld\n",
+		   atomic64_read(&blk_crypto_encrypt_bytes));
+	seq_printf(s, "encrypt_ns\t%lld\n",
+		   atomic64_read(&blk_crypto_encrypt_ns));
+	seq_printf(s, "decrypt_bytes\t%lld\n",
+		   atomic64_read(&blk_crypto_decrypt_bytes));
+	seq_printf(s, "decrypt_ns\t%lld\n",
+		   atomic64_read(&blk_crypto_decrypt_ns));
+	seq_printf(s, "bounce_pages\t%u\n", READ_ONCE(num_prealloc_bounce_pg));
+	seq_printf(s, "bounce_waits\t%ld\n",
+		   atomic_long_read(&blk_crypto_bounce_waits));
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(blk_crypto_fallback_stats);
+
 static bool blk_crypto_fallback_inited;
+
+static int num_prealloc_bounce_pg_set(const char *val,
+				      const struct kernel_param *kp)
+{
+	unsigned int n;
+	int ret;
+
+	ret = kstrtouint(val, 0, &n);
+	if (ret)
+		return ret;
+	if (!n)
+		return -EINVAL;
+
+	/* The pool is only created once a mode starts being used */
+	mutex_lock(&tfms_init_lock);
+	if (blk_crypto_fallback_inited)
+		ret = mempool_resize(blk_crypto_bounce_page_pool, n);
+	if (!ret)
+		WRITE_ONCE(num_prealloc_bounce_pg, n);
+	mutex_unlock(&tfms_init_lock);
+
+	return ret;
+}
+
+static const struct kernel_param_ops num_prealloc_bounce_pg_ops = {
+	.set = num_prealloc_bounce_pg_set,
+	.get = param_get_uint,
+};
+
 static int blk_crypto_fallback_init(void)
 {
 	int i;
@@ -593,6 +680,9 @@ static int blk_crypto_fallback_init(void)
 	if (!bio_fallback_crypt_ctx_pool)
 		goto fail_free_crypt_ctx_cache;
 
+	debugfs_create_file("blk_crypto_fallback", 0400, blk_debugfs_root, NULL,
+			    &blk_crypto_fallback_stats_fops);
+
 	blk_crypto_fallback_inited = true;
 
 	return 0;
@@ -62,6 +62,14 @@
  * root cg issued io's, wethere that's some metadata intensive operation or the
  * group is using so much memory that it is pushing us into swap.
  *
+ * A group configured with rtarget= instead of target= only samples the
+ * latency of its reads.  On a slow single queue device, such as an eMMC, the
+ * writes of a group are mostly absorbed by the page cache and their latency
+ * tells little about what the group is waiting for, while a single burst of
+ * them could make the group miss its target and throttle everybody else.
+ * With rtarget= the group is protected for its reads only, and its writes are
+ * throttled along with the other groups when the reads of a peer get slow.
+ *
  * Copyright (C) 2018 Josef Bacik
  */
 #include <linux/kernel.h>
@@ -155,6 +163,8 @@ struct iolatency_grp {
 	u64 nr_samples;
 
 	bool ssd;
+	/* Only reads are sampled against min_lat_nsec. */
+	bool reads_only;
 	struct child_latency_info child_lat;
 };
 
@@ -626,8 +636,9 @@ static void blkcg_iolatency_done_bio(struct rq_qos *rqos, struct bio *bio)
 		 * submitted, so do not account for it.
 		 */
 		if (iolat->min_lat_nsec && bio->bi_status != BLK_STS_AGAIN) {
-			iolatency_record_time(iolat, &bio->bi_issue, now,
-					      issue_as_root);
+			if (!iolat->reads_only || bio_op(bio) == REQ_OP_READ)
+				iolatency_record_time(iolat, &bio->bi_issue,
+						      now, issue_as_root);
 			window_start = atomic64_read(&iolat->window_start);
 			if (now > window_start &&
 			    (now - window_start) >= iolat->cur_win_nsec) {
@@ -840,7 +851,9 @@ static ssize_t iolatency_set_limit(struct kernfs_open_file *of, char *buf,
 	struct iolatency_grp *iolat;
 	char *p, *tok;
 	u64 lat_val = 0;
+	bool reads_only = false;
 	u64 oldval;
+	bool oldreads;
 	int ret;
 
 	ret = blkg_conf_prep(blkcg, &blkcg_policy_iolatency, buf, &ctx);
@@ -858,7 +871,7 @@ static ssize_t iolatency_set_limit(struct kernfs_open_file *of, char *buf,
 		if (sscanf(tok, "%15[^=]=%20s", key, val) != 2)
 			goto out;
 
-		if (!strcmp(key, "target")) {
+		if (!strcmp(key, "target") || !strcmp(key, "rtarget")) {
 			u64 v;
 
 			if (!strcmp(val, "max"))
@@ -867,6 +880,7 @@ static ssize_t iolatency_set_limit(struct kernfs_open_file *of, char *buf,
 				lat_val = v * NSEC_PER_USEC;
 			else
 				goto out;
+			reads_only = key[0] == 'r';
 		} else {
 			goto out;
 		}
@@ -875,9 +889,11 @@ static ssize_t iolatency_set_limit(struct kernfs_open_file *of, char *buf,
 	/* Walk up the tree to see if our new val is lower than it should be. */
 	blkg = ctx.blkg;
 	oldval = iolat->min_lat_nsec;
+	oldreads = iolat->reads_only;
 
 	iolatency_set_min_lat_nsec(blkg, lat_val);
-	if (oldval != iolat->min_lat_nsec)
+	iolat->reads_only = lat_val && reads_only;
+	if (oldval != iolat->min_lat_nsec || oldreads != iolat->reads_only)
 		iolatency_clear_scaling(blkg);
 	ret = 0;
 out:
@@ -893,8 +909,9 @@ static u64 iolatency_prfill_limit(struct seq_file *sf,
 
 	if (!dname || !iolat->min_lat_nsec)
 		return 0;
-	seq_printf(sf, "%s target=%llu\n",
-		   dname, div_u64(iolat->min_lat_nsec, NSEC_PER_USEC));
+	seq_printf(sf, "%s %s=%llu\n", dname,
+		   iolat->reads_only ? "rtarget" : "target",
+		   div_u64(iolat->min_lat_nsec, NSEC_PER_USEC));
 	return 0;
 }
 
@@ -1022,6 +1039,7 @@ static void iolatency_pd_offline(struct blkg_policy_data *pd)
 	struct blkcg_gq *blkg = lat_to_blkg(iolat);
 
 	iolatency_set_min_lat_nsec(blkg, 0);
+	iolat->reads_only = false;
 	iolatency_clear_scaling(blkg);
 }
 
@@ -6,6 +6,7 @@
 #include <linux/kernel.h>
 #include <linux/blkdev.h>
 #include <linux/debugfs.h>
+#include <linux/slab.h>
 
 #include <linux/blk-mq.h>
 #include "blk.h"
@@ -14,6 +15,7 @@
 #include "blk-mq-sched.h"
 #include "blk-mq-tag.h"
 #include "blk-rq-qos.h"
+#include "blk-stat.h"
 
 static void print_stat(struct seq_file *m, struct blk_rq_stat *stat)
 {
@@ -123,6 +125,7 @@ static const char *const blk_queue_flag_name[] = {
 	QUEUE_FLAG_NAME(FUA),
 	QUEUE_FLAG_NAME(DAX),
 	QUEUE_FLAG_NAME(STATS),
+	QUEUE_FLAG_NAME(LAT_HIST),
 	QUEUE_FLAG_NAME(REGISTERED),
 	QUEUE_FLAG_NAME(QUIESCED),
 	QUEUE_FLAG_NAME(PCI_P2PDMA),
@@ -179,12 +182,140 @@ static ssize_t queue_state_write(void *data, const char __user *buf,
 	return count;
 }
 
+#ifdef CONFIG_BLK_DEBUG_FS_LATENCY
+enum {
+	BLK_MQ_LAT_QUEUE,	/* allocation to ->queue_rq() */
+	BLK_MQ_LAT_DRIVER,	/* ->queue_rq() to blk_mq_start_request() */
+	BLK_MQ_LAT_DEVICE,	/* blk_mq_start_request() to completion */
+	BLK_MQ_LAT_COMPLETE,	/* completion to the end of the request */
+	BLK_MQ_LAT_PHASES,
+};
+
+static const char *const blk_mq_lat_phase_name[BLK_MQ_LAT_PHASES] = {
+	[BLK_MQ_LAT_QUEUE]	= "queue",
+	[BLK_MQ_LAT_DRIVER]	= "driver",
+	[BLK_MQ_LAT_DEVICE]	= "device",
+	[BLK_MQ_LAT_COMPLETE]	= "complete",
+};
+
+/*
+ * Bucket i counts the latencies below 1024 << i ns, the last bucket the
+ * longer ones.  Shifting instead of dividing keeps the accounting cheap on
+ * 32-bit CPUs.
+ */
+#define BLK_MQ_LAT_BUCKETS	22
+
+struct blk_mq_lat_hist {
+	unsigned long count[2][BLK_MQ_LAT_PHASES][BLK_MQ_LAT_BUCKETS];
+};
+
+static void blk_mq_lat_add(struct blk_mq_lat_hist __percpu *hist, int dir,
+			   int phase, u64 start, u64 end)
+{
+	unsigned int bucket;
+
+	if (!start || end < start)
+		return;
+
+	bucket = min_t(unsigned int, fls64((end - start) >> 10),
+		       BLK_MQ_LAT_BUCKETS - 1);
+	this_cpu_inc(hist->count[dir][phase][bucket]);
+}
+
+/*
+ * Called at the end of a request with stats enabled.  The phases of which a
+ * timestamp is missing, because recording was turned on while the request
+ * was in flight or because the driver ended it without going through
+ * blk_mq_complete_request_remote(), are not counted.
+ */
+void blk_mq_debugfs_lat_done(struct request *rq, u64 now)
+{
+	struct blk_mq_lat_hist __percpu *hist;
+	int dir = op_is_write(req_op(rq));
+
+	if (!test_bit(QUEUE_FLAG_LAT_HIST, &rq->q->queue_flags))
+		return;
+
+	hist = READ_ONCE(rq->mq_hctx->lat_hist);
+	if (!hist || !rq->io_start_time_ns)
+		return;
+
+	if (rq->dispatch_time_ns) {
+		blk_mq_lat_add(hist, dir, BLK_MQ_LAT_QUEUE, rq->start_time_ns,
+			       rq->dispatch_time_ns);
+		blk_mq_lat_add(hist, dir, BLK_MQ_LAT_DRIVER,
+			       rq->dispatch_time_ns, rq->io_start_time_ns);
+	}
+	blk_mq_lat_add(hist, dir, BLK_MQ_LAT_DEVICE, rq->io_start_time_ns,
+		       rq->complete_time_ns ?: now);
+	blk_mq_lat_add(hist, dir, BLK_MQ_LAT_COMPLETE, rq->complete_time_ns,
+		       now);
+}
+
+void blk_mq_debugfs_free_lat_hist(struct blk_mq_hw_ctx *hctx)
+{
+	free_percpu(hctx->lat_hist);
+}
+
+static int queue_lat_hist_show(void *data, struct seq_file *m)
+{
+	struct request_queue *q = data;
+
+	seq_printf(m, "%d\n", test_bit(QUEUE_FLAG_LAT_HIST, &q->queue_flags));
+	return 0;
+}
+
+static ssize_t queue_lat_hist_write(void *data, const char __user *buf,
+				    size_t count, loff_t *ppos)
+{
+	struct request_queue *q = data;
+	struct blk_mq_lat_hist __percpu *hist;
+	struct blk_mq_hw_ctx *hctx;
+	unsigned long i;
+	bool enable;
+	int ret;
+
+	ret = kstrtobool_from_user(buf, count, &enable);
+	if (ret)
+		return ret;
+
+	/* Keeps the hardware queues from being reallocated under us. */
+	mutex_lock(&q->sysfs_lock);
+	if (enable == test_bit(QUEUE_FLAG_LAT_HIST, &q->queue_flags))
+		goto out;
+
+	if (enable) {
+		queue_for_each_hw_ctx(q, hctx, i) {
+			if (hctx->lat_hist)
+				continue;
+			hist = alloc_percpu(struct blk_mq_lat_hist);
+			if (!hist) {
+				ret = -ENOMEM;
+				goto out;
+			}
+			WRITE_ONCE(hctx->lat_hist, hist);
+		}
+		blk_stat_enable_accounting(q);
+		blk_queue_flag_set(QUEUE_FLAG_LAT_HIST, q);
+	} else {
+		blk_queue_flag_clear(QUEUE_FLAG_LAT_HIST, q);
+		blk_stat_disable_accounting(q);
+	}
+out:
+	mutex_unlock(&q->sysfs_lock);
+	return ret ?: count;
+}
+#endif
+
 static const struct blk_mq_debugfs_attr blk_mq_debugfs_queue_attrs[] = {
 	{ "poll_stat", 0400, queue_poll_stat_show },
 	{ "requeue_list", 0400, .seq_ops = &queue_requeue_list_seq_ops },
 	{ "pm_only", 0600, queue_pm_only_show, NULL },
 	{ "state", 0600, queue_state_show, queue_state_write },
 	{ "zone_wlock", 0400, queue_zone_wlock_show, NULL },
+#ifdef CONFIG_BLK_DEBUG_FS_LATENCY
+	{ "lat_hist", 0600, queue_lat_hist_show, queue_lat_hist_write },
+#endif
 	{ },
 };
 
@@ -413,6 +544,67 @@ static int hctx_type_show(void *data, struct seq_file *m)
 	return 0;
 }
 
+#ifdef CONFIG_BLK_DEBUG_FS_LATENCY
+static int hctx_lat_hist_show(void *data, struct seq_file *m)
+{
+	struct blk_mq_hw_ctx *hctx = data;
+	struct blk_mq_lat_hist *sum, *hist;
+	unsigned long count;
+	int cpu, dir, phase, i;
+
+	if (!hctx->lat_hist)
+		return 0;
+
+	sum = kzalloc(sizeof(*sum), GFP_KERNEL);
+	if (!sum)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		hist = per_cpu_ptr(hctx->lat_hist, cpu);
+		for (dir = 0; dir < 2; dir++)
+			for (phase = 0; phase < BLK_MQ_LAT_PHASES; phase++)
+				for (i = 0; i < BLK_MQ_LAT_BUCKETS; i++)
+					sum->count[dir][phase][i] +=
+						READ_ONCE(hist->count[dir][phase][i]);
+	}
+
+	/* one line per direction and phase, "<upper bound in ns>:<count>" */
+	for (dir = 0; dir < 2; dir++) {
+		for (phase = 0; phase < BLK_MQ_LAT_PHASES; phase++) {
+			seq_printf(m, "%-5s %-8s", dir ? "write" : "read",
+				   blk_mq_lat_phase_name[phase]);
+			for (i = 0; i < BLK_MQ_LAT_BUCKETS; i++) {
+				count = sum->count[dir][phase][i];
+				if (!count)
+					continue;
+				if (i == BLK_MQ_LAT_BUCKETS - 1)
+					seq_printf(m, " inf:%lu", count);
+				else
+					seq_printf(m, " %llu:%lu", 1024ULL << i,
+						   count);
+			}
+			seq_puts(m, "\n");
+		}
+	}
+
+	kfree(sum);
+	return 0;
+}
+
+static ssize_t hctx_lat_hist_write(void *data, const char __user *buf,
+				   size_t count, loff_t *ppos)
+{
+	struct blk_mq_hw_ctx *hctx = data;
+	int cpu;
+
+	if (hctx->lat_hist)
+		for_each_possible_cpu(cpu)
+			memset(per_cpu_ptr(hctx->lat_hist, cpu), 0,
+			       sizeof(struct blk_mq_lat_hist));
+	return count;
+}
+#endif
+
 static int hctx_ctx_map_show(void *data, struct seq_file *m)
 {
 	struct blk_mq_hw_ctx *hctx = data;
@@ -655,6 +847,9 @@ static const struct blk_mq_debugfs_attr blk_mq_debugfs_hctx_attrs[] = {
 	{"active", 0400, hctx_active_show},
 	{"dispatch_busy", 0400, hctx_dispatch_busy_show},
 	{"type", 0400, hctx_type_show},
+#ifdef CONFIG_BLK_DEBUG_FS_LATENCY
+	{"lat_hist", 0600, hctx_lat_hist_show, hctx_lat_hist_write},
+#endif
 	{},
 };
 
@@ -83,6 +83,49 @@ static inline void blk_mq_debugfs_unregister_rqos(struct rq_qos *rqos)
 }
 #endif
 
+#ifdef CONFIG_BLK_DEBUG_FS_LATENCY
+void blk_mq_debugfs_lat_done(struct request *rq, u64 now);
+void blk_mq_debugfs_free_lat_hist(struct blk_mq_hw_ctx *hctx);
+
+static inline void blk_mq_debugfs_lat_dispatch(struct request *rq)
+{
+	if (test_bit(QUEUE_FLAG_LAT_HIST, &rq->q->queue_flags))
+		rq->dispatch_time_ns = ktime_get_ns();
+}
+
+static inline void blk_mq_debugfs_lat_complete(struct request *rq)
+{
+	if (test_bit(QUEUE_FLAG_LAT_HIST, &rq->q->queue_flags))
+		rq->complete_time_ns = ktime_get_ns();
+}
+
+static inline void blk_mq_debugfs_lat_init(struct request *rq)
+{
+	rq->dispatch_time_ns = 0;
+	rq->complete_time_ns = 0;
+}
+#else
+static inline void blk_mq_debugfs_lat_done(struct request *rq, u64 now)
+{
+}
+
+static inline void blk_mq_debugfs_free_lat_hist(struct blk_mq_hw_ctx *hctx)
+{
+}
+
+static inline void blk_mq_debugfs_lat_dispatch(struct request *rq)
+{
+}
+
+static inline void blk_mq_debugfs_lat_complete(struct request *rq)
+{
+}
+
+static inline void blk_mq_debugfs_lat_init(struct request *rq)
+{
+}
+#endif
+
 #ifdef CONFIG_BLK_DEBUG_FS_ZONED
 int queue_zone_wlock_show(void *data, struct seq_file *m);
 #else
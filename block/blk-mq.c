@@ -375,6 +375,7 @@ static struct request *blk_mq_rq_ctx_init(struct blk_mq_alloc_data *data,
 	rq->alloc_time_ns = alloc_time_ns;
 #endif
 	rq->io_start_time_ns = 0;
+	blk_mq_debugfs_lat_init(rq);
 	rq->stats_sectors = 0;
 	rq->nr_phys_segments = 0;
 #if defined(CONFIG_BLK_DEV_INTEGRITY)
@@ -1013,6 +1014,7 @@ static inline void __blk_mq_end_request_acct(struct request *rq, u64 now)
 
 	blk_mq_sched_completed_request(rq, now);
 	blk_account_io_done(rq, now);
+	blk_mq_debugfs_lat_done(rq, now);
 }
 
 inline void __blk_mq_end_request(struct request *rq, blk_status_t error)
@@ -1181,6 +1183,7 @@ static void blk_mq_raise_softirq(struct request *rq)
 
 bool blk_mq_complete_request_remote(struct request *rq)
 {
+	blk_mq_debugfs_lat_complete(rq);
 	WRITE_ONCE(rq->state, MQ_RQ_COMPLETE);
 
 	/*
@@ -2038,6 +2041,7 @@ bool blk_mq_dispatch_rq_list(struct blk_mq_hw_ctx *hctx, struct list_head *list,
 		 */
 		if (nr_budgets)
 			nr_budgets--;
+		blk_mq_debugfs_lat_dispatch(rq);
 		ret = q->mq_ops->queue_rq(hctx, &bd);
 		switch (ret) {
 		case BLK_STS_OK:
@@ -2577,6 +2581,7 @@ static blk_status_t __blk_mq_issue_directly(struct blk_mq_hw_ctx *hctx,
 	 * Any other error (busy), just add it to our list as we
 	 * previously would have done.
 	 */
+	blk_mq_debugfs_lat_dispatch(rq);
 	ret = q->mq_ops->queue_rq(hctx, &bd);
 	switch (ret) {
 	case BLK_STS_OK:
@@ -194,6 +194,42 @@ int crypto_shash_finup(struct shash_desc *desc, const u8 *data,
 }
 EXPORT_SYMBOL_GPL(crypto_shash_finup);
 
+int crypto_shash_finup_mb(struct shash_desc *desc, const u8 * const data[],
+			  unsigned int len, u8 * const outs[],
+			  unsigned int num_msgs)
+{
+	struct crypto_shash *tfm = desc->tfm;
+	struct shash_alg *shash = crypto_shash_alg(tfm);
+	unsigned long alignmask = crypto_shash_alignmask(tfm);
+	SHASH_DESC_ON_STACK(desc2, tfm);
+	unsigned long mask = 0;
+	unsigned int i;
+	int err = 0;
+
+	for (i = 0; i < num_msgs; i++)
+		mask |= (unsigned long)data[i] | (unsigned long)outs[i];
+
+	if (num_msgs > 1 && num_msgs <= shash->mb_max_msgs &&
+	    !(mask & alignmask)) {
+		err = shash->finup_mb(desc, data, len, outs, num_msgs);
+		if (err != -EOPNOTSUPP)
+			return err;
+	}
+
+	desc2->tfm = tfm;
+	for (i = 0; i < num_msgs; i++) {
+		memcpy(shash_desc_ctx(desc2), shash_desc_ctx(desc),
+		       crypto_shash_descsize(tfm));
+		err = crypto_shash_finup(desc2, data[i], len, outs[i]);
+		if (err)
+			break;
+	}
+	shash_desc_zero(desc2);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(crypto_shash_finup_mb);
+
 static int shash_digest_unaligned(struct shash_desc *desc, const u8 *data,
 				  unsigned int len, u8 *out)
 {
@@ -539,6 +575,13 @@ static int shash_prepare_alg(struct shash_alg *alg)
 	if ((alg->export && !alg->import) || (alg->import && !alg->export))
 		return -EINVAL;
 
+	if (alg->finup_mb) {
+		if (alg->mb_max_msgs < 2 || alg->mb_max_msgs > HASH_MAX_MB_MSGS)
+			return -EINVAL;
+	} else {
+		alg->mb_max_msgs = 1;
+	}
+
 	base->cra_type = &crypto_shash_type;
 	base->cra_flags &= ~CRYPTO_ALG_TYPE_MASK;
 	base->cra_flags |= CRYPTO_ALG_TYPE_SHASH;
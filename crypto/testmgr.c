@@ -1886,6 +1886,87 @@ static int alloc_shash(const char *driver, u32 type, u32 mask,
 	return 0;
 }
 
+#define FINUP_MB_TEST_MAXLEN	4096
+
+/*
+ * Check that crypto_shash_finup_mb() gives each message the digest that
+ * crypto_shash_finup() gives it, continuing from a common salted state the
+ * way dm-verity uses it.  The messages differ, so that one message's
+ * digest showing up for another is caught too.
+ */
+static int test_shash_finup_mb(struct shash_desc *desc)
+{
+	static const unsigned int lens[] = { 0, 1, 63, 64, 65, 1000,
+					     FINUP_MB_TEST_MAXLEN };
+	struct crypto_shash *tfm = desc->tfm;
+	const unsigned int num_msgs = crypto_shash_mb_max_msgs(tfm);
+	const unsigned int digestsize = crypto_shash_digestsize(tfm);
+	const char *driver = crypto_shash_driver_name(tfm);
+	u8 digests[HASH_MAX_MB_MSGS][HASH_MAX_DIGESTSIZE];
+	u8 expected[HASH_MAX_DIGESTSIZE];
+	const u8 *data[HASH_MAX_MB_MSGS];
+	u8 *outs[HASH_MAX_MB_MSGS];
+	unsigned int i, j, nosimd;
+	u8 salt[32];
+	u8 *buf;
+	int err = 0;
+
+	if (num_msgs <= 1)
+		return 0;
+
+	buf = kmalloc(num_msgs * FINUP_MB_TEST_MAXLEN, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	get_random_bytes(salt, sizeof(salt));
+	get_random_bytes(buf, num_msgs * FINUP_MB_TEST_MAXLEN);
+	for (j = 0; j < num_msgs; j++) {
+		data[j] = buf + j * FINUP_MB_TEST_MAXLEN;
+		outs[j] = digests[j];
+	}
+
+	for (nosimd = 0; nosimd < 2; nosimd++) {
+		for (i = 0; i < ARRAY_SIZE(lens); i++) {
+			if (nosimd)
+				crypto_disable_simd_for_test();
+			err = crypto_shash_init(desc) ?:
+			      crypto_shash_update(desc, salt, sizeof(salt)) ?:
+			      crypto_shash_finup_mb(desc, data, lens[i], outs,
+						    num_msgs);
+			if (nosimd)
+				crypto_reenable_simd_for_test();
+			if (err) {
+				pr_err("alg: shash: %s finup_mb() failed with err %d on length %u, nosimd=%u\n",
+				       driver, err, lens[i], nosimd);
+				goto out;
+			}
+
+			for (j = 0; j < num_msgs; j++) {
+				err = crypto_shash_init(desc) ?:
+				      crypto_shash_update(desc, salt,
+							  sizeof(salt)) ?:
+				      crypto_shash_finup(desc, data[j],
+							 lens[i], expected);
+				if (err) {
+					pr_err("alg: shash: %s finup() failed with err %d on length %u\n",
+					       driver, err, lens[i]);
+					goto out;
+				}
+				if (memcmp(outs[j], expected, digestsize)) {
+					pr_err("alg: shash: %s finup_mb() gave the wrong digest for message %u of length %u, nosimd=%u\n",
+					       driver, j, lens[i], nosimd);
+					hexdump(outs[j], digestsize);
+					err = -EINVAL;
+					goto out;
+				}
+			}
+		}
+	}
+out:
+	kfree(buf);
+	return err;
+}
+
 static int __alg_test_hash(const struct hash_testvec *vecs,
 			   unsigned int num_vecs, const char *driver,
 			   u32 type, u32 mask,
@@ -1960,6 +2041,11 @@ static int __alg_test_hash(const struct hash_testvec *vecs,
 			goto out;
 		cond_resched();
 	}
+	if (desc) {
+		err = test_shash_finup_mb(desc);
+		if (err)
+			goto out;
+	}
 	err = test_hash_vs_generic_impl(generic_driver, maxkeysize, req,
 					desc, tsgl, hashstate);
 out:
@@ -75,11 +75,13 @@
 #define SPI_AVMM_VAL_SIZE		4UL
 
 /*
- * max rx size could be larger. But considering the buffer consuming,
- * it is proper that we limit 1KB xfer at max.
+ * max rx and tx sizes could be larger. But considering the buffer consuming,
+ * it is proper that we limit 1KB xfer at max. Bulk writes are sent as
+ * sequential write requests, so a large write doesn't pay for a request and
+ * a response per register.
  */
 #define MAX_READ_CNT		256UL
-#define MAX_WRITE_CNT		1UL
+#define MAX_WRITE_CNT		256UL
 
 struct trans_req_header {
 	u8 code;
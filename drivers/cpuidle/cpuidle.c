@@ -31,6 +31,7 @@
 
 DEFINE_PER_CPU(struct cpuidle_device *, cpuidle_devices);
 DEFINE_PER_CPU(struct cpuidle_device, cpuidle_dev);
+static DEFINE_PER_CPU(ktime_t, cpuidle_wakeup_deadline);
 
 DEFINE_MUTEX(cpuidle_lock);
 LIST_HEAD(cpuidle_detected_devices);
@@ -425,6 +426,43 @@ u64 cpuidle_poll_time(struct cpuidle_driver *drv,
 	return dev->poll_limit_ns;
 }
 
+/**
+ * cpuidle_expect_wakeup - announce an interrupt expected on a CPU
+ * @cpu: the CPU the interrupt is delivered to
+ * @deadline: ktime_get() time the interrupt is expected at, 0 for none
+ *
+ * Lets a driver knowing when its device is going to interrupt, such as the
+ * end of a DMA transfer, keep @cpu out of idle states it couldn't leave in
+ * time.  Governors take the hint like a timer expiring at @deadline, a
+ * deadline in the past is ignored.
+ */
+void cpuidle_expect_wakeup(int cpu, ktime_t deadline)
+{
+	WRITE_ONCE(per_cpu(cpuidle_wakeup_deadline, cpu), deadline);
+}
+EXPORT_SYMBOL_GPL(cpuidle_expect_wakeup);
+
+/**
+ * cpuidle_wakeup_hint - time until the wakeup expected on this CPU
+ *
+ * Return: the time until the deadline given to cpuidle_expect_wakeup(),
+ * KTIME_MAX if there is none or it has passed.
+ */
+ktime_t cpuidle_wakeup_hint(void)
+{
+	ktime_t deadline = READ_ONCE(*this_cpu_ptr(&cpuidle_wakeup_deadline));
+	ktime_t now;
+
+	if (!deadline)
+		return KTIME_MAX;
+
+	now = ktime_get();
+	if (deadline <= now)
+		return KTIME_MAX;
+
+	return ktime_sub(deadline, now);
+}
+
 /**
  * cpuidle_install_idle_handler - installs the cpuidle idle loop handler
  */
@@ -111,6 +111,7 @@ struct menu_device {
 	int             tick_wakeup;
 
 	u64		next_timer_ns;
+	u64		unhinted_predicted_ns;
 	unsigned int	bucket;
 	unsigned int	correction_factor[BUCKETS];
 	unsigned int	intervals[INTERVALS];
@@ -256,22 +257,30 @@ static unsigned int get_typical_interval(struct menu_device *data,
 	goto again;
 }
 
-/**
- * menu_select - selects the next idle state to enter
- * @drv: cpuidle driver containing state data
- * @dev: the CPU
- * @stop_tick: indication on whether or not to stop the tick
- */
-static int menu_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
-		       bool *stop_tick)
+static u64 menu_predict(struct menu_device *data, u64 next_timer_ns,
+			unsigned int bucket)
+{
+	unsigned int predicted_us;
+
+	/* Round up the result for half microseconds. */
+	predicted_us = div_u64(next_timer_ns * data->correction_factor[bucket] +
+			       (RESOLUTION * DECAY * NSEC_PER_USEC) / 2,
+			       RESOLUTION * DECAY * NSEC_PER_USEC);
+	/* Use the lowest expected idle interval to pick the idle state. */
+	return (u64)min(predicted_us,
+			get_typical_interval(data, predicted_us)) *
+			NSEC_PER_USEC;
+}
+
+static int __menu_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
+			 bool *stop_tick)
 {
 	struct menu_device *data = this_cpu_ptr(&menu_devices);
 	s64 latency_req = cpuidle_governor_latency_req(dev->cpu);
-	unsigned int predicted_us;
 	u64 predicted_ns;
 	u64 interactivity_req;
 	unsigned int nr_iowaiters;
-	ktime_t delta, delta_tick;
+	ktime_t delta, delta_tick, hint;
 	int i, idx;
 
 	if (data->needs_update) {
@@ -285,9 +294,20 @@ static int menu_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 		delta = 0;
 		delta_tick = 0;
 	}
-	data->next_timer_ns = delta;
 
 	nr_iowaiters = nr_iowait_cpu(dev->cpu);
+
+	/* an interrupt announced by a driver is as good as a timer */
+	hint = cpuidle_wakeup_hint();
+	if (hint < delta) {
+		data->unhinted_predicted_ns =
+			menu_predict(data, delta,
+				     which_bucket(delta, nr_iowaiters));
+		delta = hint;
+	} else {
+		data->unhinted_predicted_ns = 0;
+	}
+	data->next_timer_ns = delta;
 	data->bucket = which_bucket(data->next_timer_ns, nr_iowaiters);
 
 	if (unlikely(drv->state_count <= 1 || latency_req == 0) ||
@@ -303,15 +323,7 @@ static int menu_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 		return 0;
 	}
 
-	/* Round up the result for half microseconds. */
-	predicted_us = div_u64(data->next_timer_ns *
-			       data->correction_factor[data->bucket] +
-			       (RESOLUTION * DECAY * NSEC_PER_USEC) / 2,
-			       RESOLUTION * DECAY * NSEC_PER_USEC);
-	/* Use the lowest expected idle interval to pick the idle state. */
-	predicted_ns = (u64)min(predicted_us,
-				get_typical_interval(data, predicted_us)) *
-				NSEC_PER_USEC;
+	predicted_ns = menu_predict(data, data->next_timer_ns, data->bucket);
 
 	if (tick_nohz_tick_stopped()) {
 		/*
@@ -425,6 +437,42 @@ static int menu_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
 	return idx;
 }
 
+/**
+ * menu_select - selects the next idle state to enter
+ * @drv: cpuidle driver containing state data
+ * @dev: the CPU
+ * @stop_tick: indication on whether or not to stop the tick
+ *
+ * The selected state is counted as hinted when a wakeup hint shortened the
+ * time till the next timer and the next deeper state would have fitted in
+ * the idle duration predicted without the hint.  A hint only matters when
+ * the prediction didn't already expect an early wakeup.
+ */
+static int menu_select(struct cpuidle_driver *drv, struct cpuidle_device *dev,
+		       bool *stop_tick)
+{
+	struct menu_device *data = this_cpu_ptr(&menu_devices);
+	int idx = __menu_select(drv, dev, stop_tick);
+	int i;
+
+	if (!data->unhinted_predicted_ns)
+		return idx;
+
+	for (i = idx + 1; i < drv->state_count; i++) {
+		struct cpuidle_state *s = &drv->states[i];
+
+		if (dev->states_usage[i].disable)
+			continue;
+
+		if (s->target_residency_ns <= data->unhinted_predicted_ns &&
+		    s->exit_latency_ns <= cpuidle_governor_latency_req(dev->cpu))
+			dev->states_usage[idx].hinted++;
+		break;
+	}
+
+	return idx;
+}
+
 /**
  * menu_reflect - records that data structures need update
  * @dev: the CPU
@@ -257,6 +257,7 @@ define_show_state_time_function(target_residency)
 define_show_state_function(power_usage)
 define_show_state_ull_function(usage)
 define_show_state_ull_function(rejected)
+define_show_state_ull_function(hinted)
 define_show_state_str_function(name)
 define_show_state_str_function(desc)
 define_show_state_ull_function(above)
@@ -314,6 +315,7 @@ define_one_state_ro(residency, show_state_target_residency);
 define_one_state_ro(power, show_state_power_usage);
 define_one_state_ro(usage, show_state_usage);
 define_one_state_ro(rejected, show_state_rejected);
+define_one_state_ro(hinted, show_state_hinted);
 define_one_state_ro(time, show_state_time);
 define_one_state_rw(disable, show_state_disable, store_state_disable);
 define_one_state_ro(above, show_state_above);
@@ -328,6 +330,7 @@ static struct attribute *cpuidle_state_default_attrs[] = {
 	&attr_power.attr,
 	&attr_usage.attr,
 	&attr_rejected.attr,
+	&attr_hinted.attr,
 	&attr_time.attr,
 	&attr_disable.attr,
 	&attr_above.attr,
@@ -11,24 +11,32 @@
 #include <linux/fs.h>
 #include <linux/hw_random.h>
 #include <linux/kobject.h>
+#include <linux/ktime.h>
 #include <linux/miscdevice.h>
+#include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/of_platform.h>
 #include <linux/platform_device.h>
+#include <linux/scatterlist.h>
 #include <linux/firmware/intel/stratix10-svc-client.h>
 #include <linux/string.h>
 #include <linux/slab.h>
 #include <linux/sysfs.h>
 #include <linux/uaccess.h>
 
+#include <crypto/internal/hash.h>
+#include <crypto/sha2.h>
 #include <uapi/linux/intel_fcs-ioctl.h>
 #include "intel_fcs_smmu.h"
 
 #define RANDOM_NUMBER_SIZE	32
 #define RANDOM_NUMBER_EXT_SIZE	4080
 #define RANDOM_NUMBER_EXT_OFFSET 12
+
+/* random bytes fetched from the SDM at once for the hwrng */
+#define FCS_RNG_CACHE_SIZE	(16 * RANDOM_NUMBER_SIZE)
 #define FILE_NAME_SIZE		32
 #define PS_BUF_SIZE		64
 #define SMMU_BUF_SIZE		128
@@ -87,6 +95,21 @@
 /*SDM required minimun 8 bytes of data for crypto service*/
 #define CRYPTO_SERVICE_MIN_DATA_SIZE	8
 
+/* max number of operations in one INTEL_FCS_DEV_CRYPTO_BATCH call */
+#define FCS_BATCH_MAX_OPS	256
+#define FCS_BATCH_IV_BUF_SIZE	28
+
+/* mmap() offsets of registered buffers, offset 0 is the SMMU source buffer */
+#define FCS_FIXED_BUF_MMAP_STRIDE	AES_CRYPT_CMD_MAX_SZ
+#define FCS_FIXED_BUF_MMAP_OFFSET(i)	\
+	(((uint64_t)(i) + 1) * FCS_FIXED_BUF_MMAP_STRIDE)
+
+/* GET_DIGEST_INIT parameters for a plain SHA-2 hash */
+#define FCS_SHA_OP_MODE_HASH	1
+#define FCS_SHA_DIGEST_SZ_256	0
+#define FCS_SHA_DIGEST_SZ_384	1
+#define FCS_SHA_DIGEST_SZ_512	2
+
 /**
  * struct socfpga_fcs_data - FCS platform data structure.
  * @hwrng		Flag to indicate support for HW random number generator.
@@ -384,6 +407,518 @@ static void fcs_close_services(struct intel_fcs_priv *priv,
 	mutex_unlock(&priv->lock);
 }
 
+/**
+ * struct fcs_batch_bufs - shared memory reused by all operations of a batch
+ * @iv_buf: AES parameter block
+ * @s_buf: source data
+ * @d_buf: destination data
+ * @ps_buf: completion status of AES operations
+ * @size: size of @s_buf and @d_buf
+ */
+struct fcs_batch_bufs {
+	void *iv_buf;
+	void *s_buf;
+	void *d_buf;
+	void *ps_buf;
+	size_t size;
+};
+
+static int fcs_batch_aes_crypt(struct intel_fcs_priv *priv,
+			       struct stratix10_svc_client_msg *msg,
+			       struct fcs_aes_crypt *a_crypt,
+			       struct fcs_batch_bufs *bufs)
+{
+	unsigned int buf_sz;
+	int ret;
+
+	if (a_crypt->cpara.bmode > AES_CRYPT_MODE_CTR ||
+	    (a_crypt->cpara.bmode == AES_CRYPT_MODE_ECB &&
+	     a_crypt->cpara_size != AES_CRYPT_PARAM_SIZE_ECB) ||
+	    (a_crypt->cpara.bmode != AES_CRYPT_MODE_ECB &&
+	     a_crypt->cpara_size != AES_CRYPT_PARAM_SIZE_CBC_CTR))
+		return -EINVAL;
+
+	if (a_crypt->src_size > bufs->size || a_crypt->dst_size > bufs->size)
+		return -E2BIG;
+
+	memset(bufs->iv_buf, 0, FCS_BATCH_IV_BUF_SIZE);
+	memcpy(bufs->iv_buf, &a_crypt->cpara.bmode, 1);
+	memcpy(bufs->iv_buf + 1, &a_crypt->cpara.aes_mode, 1);
+	memcpy(bufs->iv_buf + 12, a_crypt->cpara.iv_field, 16);
+
+	memset(msg, 0, sizeof(*msg));
+	msg->command = COMMAND_FCS_CRYPTO_AES_CRYPT_INIT;
+	msg->payload = bufs->iv_buf;
+	msg->payload_length = a_crypt->cpara_size;
+	msg->arg[0] = a_crypt->sid;
+	msg->arg[1] = a_crypt->cid;
+	msg->arg[2] = a_crypt->kuid;
+	priv->client.receive_cb = fcs_vab_callback;
+
+	ret = fcs_request_service(priv, msg, FCS_REQUEST_TIMEOUT);
+	if (ret || priv->status)
+		return ret ? ret : -EIO;
+
+	if (copy_from_user(bufs->s_buf, a_crypt->src, a_crypt->src_size))
+		return -EFAULT;
+
+	memset(msg, 0, sizeof(*msg));
+	msg->command = COMMAND_FCS_CRYPTO_AES_CRYPT_FINALIZE;
+	msg->payload = bufs->s_buf;
+	msg->payload_length = a_crypt->src_size;
+	msg->payload_output = bufs->d_buf;
+	msg->payload_length_output = a_crypt->src_size;
+	msg->arg[0] = a_crypt->sid;
+	msg->arg[1] = a_crypt->cid;
+	priv->client.receive_cb = fcs_attestation_callback;
+
+	ret = fcs_request_service(priv, msg, FCS_REQUEST_TIMEOUT);
+	if (ret || priv->status)
+		return ret ? ret : -EIO;
+
+	/* to query the complete status */
+	msg->payload = bufs->ps_buf;
+	msg->payload_length = PS_BUF_SIZE;
+	msg->command = COMMAND_POLL_SERVICE_STATUS;
+	priv->client.receive_cb = fcs_data_callback;
+
+	ret = fcs_request_service(priv, msg, FCS_COMPLETED_TIMEOUT);
+	if (ret || priv->status)
+		return ret ? ret : -EIO;
+
+	if (!priv->kbuf || priv->size != 16)
+		return -EIO;
+
+	buf_sz = ((u32 *)priv->kbuf)[3];
+	if (buf_sz > a_crypt->dst_size)
+		return -EOVERFLOW;
+
+	if (copy_to_user(a_crypt->dst, bufs->d_buf, buf_sz))
+		return -EFAULT;
+
+	a_crypt->dst_size = buf_sz;
+
+	return 0;
+}
+
+static int fcs_batch_sha2_mac(struct intel_fcs_priv *priv,
+			      struct stratix10_svc_client_msg *msg,
+			      struct fcs_sha2_mac_data *mac, bool verify,
+			      struct fcs_batch_bufs *bufs)
+{
+	int ret;
+
+	if (mac->src_size > bufs->size || mac->dst_size > bufs->size)
+		return -E2BIG;
+
+	if (verify && mac->userdata_sz > mac->src_size)
+		return -EINVAL;
+
+	memset(msg, 0, sizeof(*msg));
+	msg->command = verify ? COMMAND_FCS_CRYPTO_MAC_VERIFY_INIT :
+				COMMAND_FCS_CRYPTO_GET_DIGEST_INIT;
+	msg->arg[0] = mac->sid;
+	msg->arg[1] = mac->cid;
+	msg->arg[2] = mac->kuid;
+	msg->arg[3] = CRYPTO_ECC_PARAM_SZ;
+	msg->arg[4] = mac->sha_op_mode |
+		      (mac->sha_digest_sz << CRYPTO_ECC_DIGEST_SZ_OFFSET);
+	priv->client.receive_cb = fcs_vab_callback;
+
+	ret = fcs_request_service(priv, msg, FCS_REQUEST_TIMEOUT);
+	if (ret || priv->status)
+		return ret ? ret : -EIO;
+
+	if (copy_from_user(bufs->s_buf, mac->src, mac->src_size))
+		return -EFAULT;
+
+	memset(msg, 0, sizeof(*msg));
+	msg->command = verify ? COMMAND_FCS_CRYPTO_MAC_VERIFY_FINALIZE :
+				COMMAND_FCS_CRYPTO_GET_DIGEST_FINALIZE;
+	msg->arg[0] = mac->sid;
+	msg->arg[1] = mac->cid;
+	if (verify)
+		msg->arg[2] = mac->userdata_sz;
+	msg->payload = bufs->s_buf;
+	msg->payload_length = mac->src_size;
+	msg->payload_output = bufs->d_buf;
+	msg->payload_length_output = verify ? mac->dst_size : bufs->size;
+	priv->client.receive_cb = fcs_attestation_callback;
+
+	ret = fcs_request_service(priv, msg, 10 * FCS_REQUEST_TIMEOUT);
+	if (ret || priv->status)
+		return ret ? ret : -EIO;
+
+	if (priv->size > mac->dst_size)
+		return -EOVERFLOW;
+
+	if (copy_to_user(mac->dst, priv->kbuf, priv->size))
+		return -EFAULT;
+
+	mac->dst_size = priv->size;
+
+	return 0;
+}
+
+/**
+ * fcs_crypto_batch() - process a batch of crypto operations
+ * @priv: FCS private data
+ * @msg: service layer message, reused for every operation
+ * @batch: batch description copied from user space
+ *
+ * The operations are processed in order with the FCS lock held once, with
+ * shared memory allocated once for the whole batch and with the service
+ * layer thread kept running between operations, instead of paying for all
+ * of these on every ioctl. The status of every operation is written back to
+ * its own struct intel_fcs_dev_ioctl, a failed operation does not stop the
+ * batch.
+ *
+ * Return: 0, or a negative error code if the batch itself is invalid.
+ */
+static int fcs_crypto_batch(struct intel_fcs_priv *priv,
+			    struct stratix10_svc_client_msg *msg,
+			    struct fcs_crypto_batch *batch)
+{
+	struct device *dev = priv->client.dev;
+	struct fcs_crypto_batch_op *ops;
+	struct intel_fcs_dev_ioctl *op_data;
+	struct fcs_batch_bufs bufs = { };
+	uint32_t i;
+	int ret = 0;
+
+	batch->completed = 0;
+	if (!batch->count || batch->count > FCS_BATCH_MAX_OPS)
+		return -EINVAL;
+
+	ops = memdup_user((void __user *)batch->ops,
+			  array_size(batch->count, sizeof(*ops)));
+	if (IS_ERR(ops))
+		return PTR_ERR(ops);
+
+	op_data = kzalloc(sizeof(*op_data), GFP_KERNEL);
+	if (!op_data) {
+		ret = -ENOMEM;
+		goto free_ops;
+	}
+
+	/* size the data buffers for the largest operation of the batch */
+	for (i = 0; i < batch->count; i++) {
+		if (copy_from_user(op_data, (void __user *)ops[i].data,
+				   sizeof(*op_data))) {
+			ret = -EFAULT;
+			goto free_data;
+		}
+
+		if (ops[i].cmd == INTEL_FCS_DEV_CRYPTO_AES_CRYPT_CMD)
+			bufs.size = max3(bufs.size,
+					 (size_t)op_data->com_paras.a_crypt.src_size,
+					 (size_t)op_data->com_paras.a_crypt.dst_size);
+		else
+			bufs.size = max3(bufs.size,
+					 (size_t)op_data->com_paras.s_mac_data.src_size,
+					 (size_t)op_data->com_paras.s_mac_data.dst_size);
+	}
+	bufs.size = clamp_t(size_t, bufs.size, CRYPTO_SERVICE_MIN_DATA_SIZE,
+			    AES_CRYPT_CMD_MAX_SZ);
+
+	bufs.iv_buf = stratix10_svc_allocate_memory(priv->chan,
+						    FCS_BATCH_IV_BUF_SIZE);
+	bufs.s_buf = stratix10_svc_allocate_memory(priv->chan, bufs.size);
+	bufs.d_buf = stratix10_svc_allocate_memory(priv->chan, bufs.size);
+	bufs.ps_buf = stratix10_svc_allocate_memory(priv->chan, PS_BUF_SIZE);
+	if (IS_ERR(bufs.iv_buf) || IS_ERR(bufs.s_buf) ||
+	    IS_ERR(bufs.d_buf) || IS_ERR(bufs.ps_buf)) {
+		dev_err(dev, "failed to allocate batch buffers\n");
+		ret = -ENOMEM;
+		goto free_bufs;
+	}
+
+	for (i = 0; i < batch->count; i++) {
+		int op_ret;
+
+		if (copy_from_user(op_data, (void __user *)ops[i].data,
+				   sizeof(*op_data))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		switch (ops[i].cmd) {
+		case INTEL_FCS_DEV_CRYPTO_AES_CRYPT_CMD:
+			op_ret = fcs_batch_aes_crypt(priv, msg,
+						     &op_data->com_paras.a_crypt,
+						     &bufs);
+			break;
+		case INTEL_FCS_DEV_CRYPTO_GET_DIGEST_CMD:
+			op_ret = fcs_batch_sha2_mac(priv, msg,
+						    &op_data->com_paras.s_mac_data,
+						    false, &bufs);
+			break;
+		case INTEL_FCS_DEV_CRYPTO_MAC_VERIFY_CMD:
+			op_ret = fcs_batch_sha2_mac(priv, msg,
+						    &op_data->com_paras.s_mac_data,
+						    true, &bufs);
+			break;
+		default:
+			op_ret = -EOPNOTSUPP;
+			break;
+		}
+
+		if (op_ret)
+			dev_dbg(dev, "batch op %u (cmd=%u) failed, ret=%d status=%d\n",
+				i, ops[i].cmd, op_ret, priv->status);
+
+		op_data->status = op_ret;
+		op_data->mbox_status = priv->status;
+		if (copy_to_user((void __user *)ops[i].data, op_data,
+				 sizeof(*op_data))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		batch->completed++;
+	}
+
+free_bufs:
+	if (!IS_ERR_OR_NULL(bufs.ps_buf))
+		stratix10_svc_free_memory(priv->chan, bufs.ps_buf);
+	if (!IS_ERR_OR_NULL(bufs.d_buf))
+		stratix10_svc_free_memory(priv->chan, bufs.d_buf);
+	if (!IS_ERR_OR_NULL(bufs.s_buf))
+		stratix10_svc_free_memory(priv->chan, bufs.s_buf);
+	if (!IS_ERR_OR_NULL(bufs.iv_buf))
+		stratix10_svc_free_memory(priv->chan, bufs.iv_buf);
+free_data:
+	kfree(op_data);
+free_ops:
+	kfree(ops);
+	return ret;
+}
+
+static struct fcs_fixed_buf *fcs_fixed_buf_get(struct intel_fcs_priv *priv,
+					       struct file *file,
+					       uint32_t index, uint32_t size)
+{
+	struct fcs_fixed_buf *fbuf;
+
+	if (index >= INTEL_FCS_FIXED_BUF_MAX)
+		return NULL;
+
+	fbuf = &priv->fixed_bufs[index];
+	if (!fbuf->va || fbuf->owner != file || size > fbuf->size)
+		return NULL;
+
+	return fbuf;
+}
+
+static void fcs_fixed_buf_free(struct intel_fcs_priv *priv,
+			       struct fcs_fixed_buf *fbuf)
+{
+	stratix10_svc_free_memory(priv->chan, fbuf->va);
+	fbuf->va = NULL;
+	fbuf->owner = NULL;
+
+	/* the parameter buffers live as long as any buffer is registered */
+	if (--priv->nr_fixed_bufs == 0) {
+		fcs_free_memory(priv, priv->fixed_iv_buf, priv->fixed_ps_buf,
+				NULL);
+		priv->fixed_iv_buf = NULL;
+		priv->fixed_ps_buf = NULL;
+	}
+}
+
+static int fcs_fixed_buf_register(struct intel_fcs_priv *priv,
+				  struct file *file,
+				  struct fcs_fixed_buffer *f_buf)
+{
+	struct fcs_fixed_buf *fbuf = NULL;
+	size_t size = PAGE_ALIGN(f_buf->size);
+	void *va;
+	int i;
+
+	if (!f_buf->size || size > AES_CRYPT_CMD_MAX_SZ)
+		return -EINVAL;
+
+	for (i = 0; i < INTEL_FCS_FIXED_BUF_MAX; i++)
+		if (!priv->fixed_bufs[i].va) {
+			fbuf = &priv->fixed_bufs[i];
+			break;
+		}
+	if (!fbuf)
+		return -ENOSPC;
+
+	if (!priv->nr_fixed_bufs) {
+		priv->fixed_iv_buf = stratix10_svc_allocate_memory(priv->chan,
+							FCS_BATCH_IV_BUF_SIZE);
+		if (IS_ERR(priv->fixed_iv_buf)) {
+			priv->fixed_iv_buf = NULL;
+			return -ENOMEM;
+		}
+
+		priv->fixed_ps_buf = stratix10_svc_allocate_memory(priv->chan,
+								   PS_BUF_SIZE);
+		if (IS_ERR(priv->fixed_ps_buf)) {
+			fcs_free_memory(priv, priv->fixed_iv_buf, NULL, NULL);
+			priv->fixed_iv_buf = NULL;
+			priv->fixed_ps_buf = NULL;
+			return -ENOMEM;
+		}
+	}
+
+	va = stratix10_svc_allocate_memory(priv->chan, size);
+	if (IS_ERR(va)) {
+		if (!priv->nr_fixed_bufs) {
+			fcs_free_memory(priv, priv->fixed_iv_buf,
+					priv->fixed_ps_buf, NULL);
+			priv->fixed_iv_buf = NULL;
+			priv->fixed_ps_buf = NULL;
+		}
+		return -ENOMEM;
+	}
+
+	fbuf->va = va;
+	fbuf->size = size;
+	fbuf->owner = file;
+	atomic_set(&fbuf->mapped, 0);
+	priv->nr_fixed_bufs++;
+
+	f_buf->index = i;
+	f_buf->size = size;
+	f_buf->offset = FCS_FIXED_BUF_MMAP_OFFSET(i);
+
+	return 0;
+}
+
+static int fcs_fixed_buf_unregister(struct intel_fcs_priv *priv,
+				    struct file *file, uint32_t index)
+{
+	struct fcs_fixed_buf *fbuf = fcs_fixed_buf_get(priv, file, index, 0);
+
+	if (!fbuf)
+		return -EINVAL;
+
+	/* the SDM must not write into pages still mapped by user space */
+	if (atomic_read(&fbuf->mapped))
+		return -EBUSY;
+
+	fcs_fixed_buf_free(priv, fbuf);
+
+	return 0;
+}
+
+/**
+ * fcs_fixed_crypt() - run an AES or digest operation on registered buffers
+ * @priv: FCS private data
+ * @msg: service layer message
+ * @file: file the buffers are registered with
+ * @f_crypt: operation description copied from user space
+ *
+ * The registered buffers are shared memory already, so they are handed to
+ * the service layer as they are: no payload copy and no allocation per call.
+ * The whole operation has to fit a single SDM transaction (INIT + FINALIZE).
+ *
+ * Return: 0, or a negative error code.
+ */
+static int fcs_fixed_crypt(struct intel_fcs_priv *priv,
+			   struct stratix10_svc_client_msg *msg,
+			   struct file *file, struct fcs_fixed_crypt *f_crypt)
+{
+	struct fcs_fixed_buf *src, *dst;
+	bool aes = f_crypt->cmd == INTEL_FCS_DEV_CRYPTO_AES_CRYPT_CMD;
+	unsigned int buf_sz;
+	int ret;
+
+	if (!aes && f_crypt->cmd != INTEL_FCS_DEV_CRYPTO_GET_DIGEST_CMD)
+		return -EOPNOTSUPP;
+
+	if (f_crypt->src_size < CRYPTO_SERVICE_MIN_DATA_SIZE)
+		return -EINVAL;
+
+	src = fcs_fixed_buf_get(priv, file, f_crypt->src_index,
+				f_crypt->src_size);
+	dst = fcs_fixed_buf_get(priv, file, f_crypt->dst_index,
+				aes ? f_crypt->src_size : 0);
+	if (!src || !dst)
+		return -EINVAL;
+
+	memset(msg, 0, sizeof(*msg));
+	msg->arg[0] = f_crypt->sid;
+	msg->arg[1] = f_crypt->cid;
+	msg->arg[2] = f_crypt->kuid;
+	priv->client.receive_cb = fcs_vab_callback;
+
+	if (aes) {
+		if (f_crypt->cpara.bmode > AES_CRYPT_MODE_CTR ||
+		    (f_crypt->cpara.bmode == AES_CRYPT_MODE_ECB &&
+		     f_crypt->cpara_size != AES_CRYPT_PARAM_SIZE_ECB) ||
+		    (f_crypt->cpara.bmode != AES_CRYPT_MODE_ECB &&
+		     f_crypt->cpara_size != AES_CRYPT_PARAM_SIZE_CBC_CTR))
+			return -EINVAL;
+
+		memset(priv->fixed_iv_buf, 0, FCS_BATCH_IV_BUF_SIZE);
+		memcpy(priv->fixed_iv_buf, &f_crypt->cpara.bmode, 1);
+		memcpy(priv->fixed_iv_buf + 1, &f_crypt->cpara.aes_mode, 1);
+		memcpy(priv->fixed_iv_buf + 12, f_crypt->cpara.iv_field, 16);
+
+		msg->command = COMMAND_FCS_CRYPTO_AES_CRYPT_INIT;
+		msg->payload = priv->fixed_iv_buf;
+		msg->payload_length = f_crypt->cpara_size;
+	} else {
+		msg->command = COMMAND_FCS_CRYPTO_GET_DIGEST_INIT;
+		msg->arg[3] = CRYPTO_ECC_PARAM_SZ;
+		msg->arg[4] = f_crypt->sha_op_mode |
+			      (f_crypt->sha_digest_sz <<
+			       CRYPTO_ECC_DIGEST_SZ_OFFSET);
+	}
+
+	ret = fcs_request_service(priv, msg, FCS_REQUEST_TIMEOUT);
+	if (ret || priv->status)
+		return ret ? ret : -EIO;
+
+	memset(msg, 0, sizeof(*msg));
+	msg->command = aes ? COMMAND_FCS_CRYPTO_AES_CRYPT_FINALIZE :
+			     COMMAND_FCS_CRYPTO_GET_DIGEST_FINALIZE;
+	msg->arg[0] = f_crypt->sid;
+	msg->arg[1] = f_crypt->cid;
+	msg->payload = src->va;
+	msg->payload_length = f_crypt->src_size;
+	msg->payload_output = dst->va;
+	msg->payload_length_output = dst->size;
+	priv->client.receive_cb = fcs_attestation_callback;
+
+	ret = fcs_request_service(priv, msg, 10 * FCS_REQUEST_TIMEOUT);
+	if (ret || priv->status)
+		return ret ? ret : -EIO;
+
+	if (!aes) {
+		if (priv->size > dst->size)
+			return -EOVERFLOW;
+
+		f_crypt->dst_size = priv->size;
+		return 0;
+	}
+
+	/* to query the complete status */
+	msg->payload = priv->fixed_ps_buf;
+	msg->payload_length = PS_BUF_SIZE;
+	msg->command = COMMAND_POLL_SERVICE_STATUS;
+	priv->client.receive_cb = fcs_data_callback;
+
+	ret = fcs_request_service(priv, msg, FCS_COMPLETED_TIMEOUT);
+	if (ret || priv->status)
+		return ret ? ret : -EIO;
+
+	if (!priv->kbuf || priv->size != 16)
+		return -EIO;
+
+	buf_sz = ((u32 *)priv->kbuf)[3];
+	if (buf_sz > dst->size)
+		return -EOVERFLOW;
+
+	f_crypt->dst_size = buf_sz;
+
+	return 0;
+}
+
 static long fcs_ioctl(struct file *file, unsigned int cmd,
 		      unsigned long arg)
 {
@@ -3648,6 +4183,84 @@ static long fcs_ioctl(struct file *file, unsigned int cmd,
 		fcs_close_services(priv, d_buf, ps_buf);
 		break;
 
+	case INTEL_FCS_DEV_CRYPTO_BATCH:
+		if (copy_from_user(data, (void __user *)arg, sizeof(*data))) {
+			dev_err(dev, "failure on copy_from_user\n");
+			mutex_unlock(&priv->lock);
+			return -EFAULT;
+		}
+
+		ret = fcs_crypto_batch(priv, msg, &data->com_paras.batch);
+		data->status = ret;
+
+		if (copy_to_user((void __user *)arg, data, sizeof(*data))) {
+			dev_err(dev, "failure on copy_to_user\n");
+			ret = -EFAULT;
+		}
+
+		fcs_close_services(priv, NULL, NULL);
+		break;
+
+	case INTEL_FCS_DEV_REGISTER_BUFFER:
+		if (copy_from_user(data, (void __user *)arg, sizeof(*data))) {
+			dev_err(dev, "failure on copy_from_user\n");
+			mutex_unlock(&priv->lock);
+			return -EFAULT;
+		}
+
+		ret = fcs_fixed_buf_register(priv, file, &data->com_paras.f_buf);
+		data->status = ret;
+
+		if (copy_to_user((void __user *)arg, data, sizeof(*data))) {
+			dev_err(dev, "failure on copy_to_user\n");
+			ret = -EFAULT;
+		}
+
+		mutex_unlock(&priv->lock);
+		break;
+
+	case INTEL_FCS_DEV_UNREGISTER_BUFFER:
+		if (copy_from_user(data, (void __user *)arg, sizeof(*data))) {
+			dev_err(dev, "failure on copy_from_user\n");
+			mutex_unlock(&priv->lock);
+			return -EFAULT;
+		}
+
+		ret = fcs_fixed_buf_unregister(priv, file,
+					       data->com_paras.f_buf.index);
+		data->status = ret;
+
+		if (copy_to_user((void __user *)arg, data, sizeof(*data))) {
+			dev_err(dev, "failure on copy_to_user\n");
+			ret = -EFAULT;
+		}
+
+		mutex_unlock(&priv->lock);
+		break;
+
+	case INTEL_FCS_DEV_CRYPTO_FIXED:
+		if (copy_from_user(data, (void __user *)arg, sizeof(*data))) {
+			dev_err(dev, "failure on copy_from_user\n");
+			mutex_unlock(&priv->lock);
+			return -EFAULT;
+		}
+
+		ret = fcs_fixed_crypt(priv, msg, file, &data->com_paras.f_crypt);
+		if (ret)
+			dev_dbg(dev, "fixed buffer op (cmd=%u) failed, ret=%d status=%d\n",
+				data->com_paras.f_crypt.cmd, ret, priv->status);
+
+		data->status = ret;
+		data->mbox_status = priv->status;
+
+		if (copy_to_user((void __user *)arg, data, sizeof(*data))) {
+			dev_err(dev, "failure on copy_to_user\n");
+			ret = -EFAULT;
+		}
+
+		fcs_close_services(priv, NULL, NULL);
+		break;
+
 	default:
 		mutex_unlock(&priv->lock);
 		dev_warn(dev, "shouldn't be here [0x%x]\n", cmd);
@@ -3666,31 +4279,37 @@ static int fcs_open(struct inode *inode, struct file *file)
 
 static int fcs_close(struct inode *inode, struct file *file)
 {
+	struct intel_fcs_priv *priv;
+	int i;
 
 	pr_debug("%s\n", __func__);
 
+	/* all mappings are gone by now, they hold a reference on the file */
+	priv = container_of(file->private_data, struct intel_fcs_priv, miscdev);
+	mutex_lock(&priv->lock);
+	for (i = 0; i < INTEL_FCS_FIXED_BUF_MAX; i++)
+		if (priv->fixed_bufs[i].va && priv->fixed_bufs[i].owner == file)
+			fcs_fixed_buf_free(priv, &priv->fixed_bufs[i]);
+	mutex_unlock(&priv->lock);
+
 	return 0;
 }
 
-static int fcs_rng_read(struct hwrng *rng, void *buf, size_t max, bool wait)
+/*
+ * Refill the entropy cache with as many RANDOM_NUMBER_GEN calls as fit in it,
+ * under a single service channel session.  Called with the hwrng core's
+ * reading mutex held, which serializes all the users of the cache.
+ */
+static int fcs_rng_refill(struct intel_fcs_priv *priv)
 {
-	struct stratix10_svc_client_msg *msg;
-	struct intel_fcs_priv *priv;
-	struct device *dev;
+	struct stratix10_svc_client_msg msg = {};
+	struct device *dev = priv->client.dev;
+	u64 start = ktime_get_ns();
+	unsigned int calls = 0;
 	void *s_buf;
 	int ret = 0;
-	size_t size = 0;
 
-	priv = (struct intel_fcs_priv *)rng->priv;
-	dev = priv->client.dev;
 	mutex_lock(&priv->lock);
-	msg = devm_kzalloc(dev, sizeof(*msg), GFP_KERNEL);
-	if (!msg) {
-		dev_err(dev, "failed to allocate msg buffer\n");
-		mutex_unlock(&priv->lock);
-		return -ENOMEM;
-	}
-
 	s_buf = stratix10_svc_allocate_memory(priv->chan,
 					      RANDOM_NUMBER_SIZE);
 	if (IS_ERR(s_buf)) {
@@ -3699,37 +4318,141 @@ static int fcs_rng_read(struct hwrng *rng, void *buf, size_t max, bool wait)
 		return -ENOMEM;
 	}
 
-	msg->command = COMMAND_FCS_RANDOM_NUMBER_GEN;
-	msg->payload = s_buf;
-	msg->payload_length = RANDOM_NUMBER_SIZE;
+	msg.command = COMMAND_FCS_RANDOM_NUMBER_GEN;
+	msg.payload = s_buf;
+	msg.payload_length = RANDOM_NUMBER_SIZE;
 	priv->client.receive_cb = fcs_hwrng_callback;
 
-	ret = fcs_request_service(priv, (void *)msg,
-				  FCS_REQUEST_TIMEOUT);
-	if (!ret && !priv->status) {
-		if (priv->size && priv->kbuf) {
-			if (max > priv->size)
-				size = priv->size;
-			else
-				size = max;
-
-			memcpy((uint8_t *)buf, (uint8_t *)priv->kbuf, size);
-		}
+	while (priv->rng_avail + RANDOM_NUMBER_SIZE <= FCS_RNG_CACHE_SIZE) {
+		ret = fcs_request_service(priv, (void *)&msg,
+					  FCS_REQUEST_TIMEOUT);
+		calls++;
+		if (ret || priv->status || !priv->kbuf ||
+		    priv->size > RANDOM_NUMBER_SIZE) {
+			ret = -EIO;
+			break;
+		}
+
+		memcpy(priv->rng_cache + priv->rng_avail, priv->kbuf,
+		       priv->size);
+		memzero_explicit(priv->kbuf, priv->size);
+		priv->rng_avail += priv->size;
+		if (!priv->size)
+			break;
 	}
 
 	fcs_close_services(priv, s_buf, NULL);
 
-	if (size == 0)
-		return -ENOTSUPP;
+	atomic64_add(calls, &priv->rng_calls);
+	atomic64_add(ktime_get_ns() - start, &priv->rng_ns);
+	if (ret)
+		atomic64_inc(&priv->rng_errors);
+
+	return priv->rng_avail ? 0 : ret;
+}
+
+static int fcs_rng_read(struct hwrng *rng, void *buf, size_t max, bool wait)
+{
+	struct intel_fcs_priv *priv = (struct intel_fcs_priv *)rng->priv;
+	size_t size;
+	int ret;
+
+	if (!priv->rng_avail) {
+		ret = fcs_rng_refill(priv);
+		if (ret)
+			return ret == -EIO ? -ENOTSUPP : ret;
+	}
+
+	/* the cache is consumed from its end */
+	size = min_t(size_t, max, priv->rng_avail);
+	priv->rng_avail -= size;
+	memcpy(buf, priv->rng_cache + priv->rng_avail, size);
+	memzero_explicit(priv->rng_cache + priv->rng_avail, size);
+	atomic64_add(size, &priv->rng_bytes);
 
 	return size;
 }
 
+static ssize_t rng_stats_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	struct intel_fcs_priv *priv = dev_get_drvdata(dev);
+
+	return sprintf(buf, "bytes %lld\ncalls %lld\nns %lld\nerrors %lld\n",
+		       atomic64_read(&priv->rng_bytes),
+		       atomic64_read(&priv->rng_calls),
+		       atomic64_read(&priv->rng_ns),
+		       atomic64_read(&priv->rng_errors));
+}
+static DEVICE_ATTR_RO(rng_stats);
+
+static void fcs_fixed_buf_vm_open(struct vm_area_struct *vma)
+{
+	struct fcs_fixed_buf *fbuf = vma->vm_private_data;
+
+	atomic_inc(&fbuf->mapped);
+}
+
+static void fcs_fixed_buf_vm_close(struct vm_area_struct *vma)
+{
+	struct fcs_fixed_buf *fbuf = vma->vm_private_data;
+
+	atomic_dec(&fbuf->mapped);
+}
+
+static const struct vm_operations_struct fcs_fixed_buf_vm_ops = {
+	.open = fcs_fixed_buf_vm_open,
+	.close = fcs_fixed_buf_vm_close,
+};
+
+static int fcs_fixed_buf_mmap(struct file *filp, struct vm_area_struct *vma)
+{
+	struct intel_fcs_priv *priv;
+	struct fcs_fixed_buf *fbuf;
+	unsigned long size = vma->vm_end - vma->vm_start;
+	unsigned long pfn;
+	uint64_t offset = (uint64_t)vma->vm_pgoff << PAGE_SHIFT;
+	uint32_t index;
+	int ret;
+
+	if (offset % FCS_FIXED_BUF_MMAP_STRIDE)
+		return -EINVAL;
+	index = offset / FCS_FIXED_BUF_MMAP_STRIDE - 1;
+
+	priv = container_of(filp->private_data, struct intel_fcs_priv, miscdev);
+	mutex_lock(&priv->lock);
+	fbuf = fcs_fixed_buf_get(priv, filp, index, size);
+	if (!fbuf) {
+		mutex_unlock(&priv->lock);
+		return -EINVAL;
+	}
+
+	/* the pool is either memremap()ed or from the page allocator */
+	pfn = is_vmalloc_addr(fbuf->va) ? vmalloc_to_pfn(fbuf->va) :
+					  virt_to_pfn(fbuf->va);
+
+	vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+	vma->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP | VM_DONTCOPY;
+	ret = remap_pfn_range(vma, vma->vm_start, pfn, size,
+			      vma->vm_page_prot);
+	if (!ret) {
+		vma->vm_private_data = fbuf;
+		vma->vm_ops = &fcs_fixed_buf_vm_ops;
+		fcs_fixed_buf_vm_open(vma);
+	}
+	mutex_unlock(&priv->lock);
+
+	return ret;
+}
+
 static int fcs_mmap(struct file *filp, struct vm_area_struct *vma)
 {
 	unsigned long size, off;
 	struct page *page;
 
+	if (vma->vm_pgoff)
+		return fcs_fixed_buf_mmap(filp, vma);
+
 	if (!source_ptr) {
 		pr_err("vmalloc failed mmap %s", __func__);
 		return -ENOMEM;
@@ -3757,6 +4480,406 @@ static const struct file_operations fcs_fops = {
 	.mmap = fcs_mmap
 };
 
+/*
+ * SHA-2 offload through the kernel crypto API.
+ *
+ * Only one-shot digest() requests of at least sha_offload_min bytes are
+ * sent to the SDM; every incremental request, and any digest below the
+ * threshold, is handled by the best software/CE implementation, which is
+ * faster than the mailbox round trip for small inputs.
+ */
+static unsigned int sha_offload_min = SZ_64K;
+module_param(sha_offload_min, uint, 0644);
+MODULE_PARM_DESC(sha_offload_min,
+		 "Minimum digest() size in bytes offloaded to the SDM (default 64K)");
+
+static struct intel_fcs_priv *fcs_sha_priv;
+
+struct fcs_sha_alg {
+	struct ahash_alg alg;
+	unsigned int digest_sz_code;
+};
+
+struct fcs_sha_ctx {
+	struct crypto_engine_ctx enginectx;
+	struct intel_fcs_priv *priv;
+	struct crypto_ahash *fallback;
+	unsigned int digest_sz_code;
+};
+
+struct fcs_sha_reqctx {
+	/* must be last, the fallback tfm reqsize is appended */
+	struct ahash_request fallback_req;
+};
+
+static void fcs_sha_fallback_prepare(struct ahash_request *req,
+				     struct fcs_sha_ctx *ctx)
+{
+	struct fcs_sha_reqctx *rctx = ahash_request_ctx(req);
+
+	ahash_request_set_tfm(&rctx->fallback_req, ctx->fallback);
+	rctx->fallback_req.base.flags = req->base.flags &
+					CRYPTO_TFM_REQ_MAY_SLEEP;
+	ahash_request_set_crypt(&rctx->fallback_req, req->src, req->result,
+				req->nbytes);
+}
+
+static int fcs_sha_init(struct ahash_request *req)
+{
+	struct fcs_sha_ctx *ctx = crypto_ahash_ctx(crypto_ahash_reqtfm(req));
+	struct fcs_sha_reqctx *rctx = ahash_request_ctx(req);
+
+	fcs_sha_fallback_prepare(req, ctx);
+	return crypto_ahash_init(&rctx->fallback_req);
+}
+
+static int fcs_sha_update(struct ahash_request *req)
+{
+	struct fcs_sha_ctx *ctx = crypto_ahash_ctx(crypto_ahash_reqtfm(req));
+	struct fcs_sha_reqctx *rctx = ahash_request_ctx(req);
+
+	fcs_sha_fallback_prepare(req, ctx);
+	return crypto_ahash_update(&rctx->fallback_req);
+}
+
+static int fcs_sha_final(struct ahash_request *req)
+{
+	struct fcs_sha_ctx *ctx = crypto_ahash_ctx(crypto_ahash_reqtfm(req));
+	struct fcs_sha_reqctx *rctx = ahash_request_ctx(req);
+
+	fcs_sha_fallback_prepare(req, ctx);
+	return crypto_ahash_final(&rctx->fallback_req);
+}
+
+static int fcs_sha_finup(struct ahash_request *req)
+{
+	struct fcs_sha_ctx *ctx = crypto_ahash_ctx(crypto_ahash_reqtfm(req));
+	struct fcs_sha_reqctx *rctx = ahash_request_ctx(req);
+
+	fcs_sha_fallback_prepare(req, ctx);
+	return crypto_ahash_finup(&rctx->fallback_req);
+}
+
+static int fcs_sha_export(struct ahash_request *req, void *out)
+{
+	struct fcs_sha_ctx *ctx = crypto_ahash_ctx(crypto_ahash_reqtfm(req));
+	struct fcs_sha_reqctx *rctx = ahash_request_ctx(req);
+
+	fcs_sha_fallback_prepare(req, ctx);
+	return crypto_ahash_export(&rctx->fallback_req, out);
+}
+
+static int fcs_sha_import(struct ahash_request *req, const void *in)
+{
+	struct fcs_sha_ctx *ctx = crypto_ahash_ctx(crypto_ahash_reqtfm(req));
+	struct fcs_sha_reqctx *rctx = ahash_request_ctx(req);
+
+	fcs_sha_fallback_prepare(req, ctx);
+	return crypto_ahash_import(&rctx->fallback_req, in);
+}
+
+static int fcs_sha_digest(struct ahash_request *req)
+{
+	struct fcs_sha_ctx *ctx = crypto_ahash_ctx(crypto_ahash_reqtfm(req));
+	struct fcs_sha_reqctx *rctx = ahash_request_ctx(req);
+
+	/* SDM requires a minimum amount of data per crypto service call */
+	if (req->nbytes < max_t(unsigned int, sha_offload_min,
+				CRYPTO_SERVICE_MIN_DATA_SIZE)) {
+		atomic64_inc(&ctx->priv->sha_fallbacks);
+		fcs_sha_fallback_prepare(req, ctx);
+		return crypto_ahash_digest(&rctx->fallback_req);
+	}
+
+	return crypto_transfer_hash_request_to_engine(ctx->priv->engine, req);
+}
+
+static int fcs_sha_one_request(struct crypto_engine *engine, void *areq)
+{
+	struct ahash_request *req = container_of(areq, struct ahash_request,
+						 base);
+	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
+	struct fcs_sha_ctx *ctx = crypto_ahash_ctx(tfm);
+	struct intel_fcs_priv *priv = ctx->priv;
+	struct device *dev = priv->client.dev;
+	struct stratix10_svc_client_msg msg = {};
+	unsigned int nents = sg_nents(req->src);
+	unsigned int remaining_size = req->nbytes;
+	unsigned int buf_size, data_size, offset = 0;
+	unsigned int cid;
+	void *s_buf, *d_buf;
+	int ret;
+
+	buf_size = min_t(unsigned int, remaining_size, AES_CRYPT_CMD_MAX_SZ);
+	cid = atomic_inc_return(&priv->sha_cid);
+
+	mutex_lock(&priv->lock);
+	s_buf = stratix10_svc_allocate_memory(priv->chan, buf_size);
+	if (IS_ERR(s_buf)) {
+		dev_err(dev, "failed allocate source buf\n");
+		fcs_close_services(priv, NULL, NULL);
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	d_buf = stratix10_svc_allocate_memory(priv->chan,
+					      crypto_ahash_digestsize(tfm));
+	if (IS_ERR(d_buf)) {
+		dev_err(dev, "failed allocate destation buf\n");
+		fcs_close_services(priv, s_buf, NULL);
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	msg.command = COMMAND_FCS_CRYPTO_GET_DIGEST_INIT;
+	msg.arg[0] = priv->sha_sid;
+	msg.arg[1] = cid;
+	msg.arg[2] = 0;
+	msg.arg[3] = CRYPTO_ECC_PARAM_SZ;
+	msg.arg[4] = FCS_SHA_OP_MODE_HASH |
+		     (ctx->digest_sz_code << CRYPTO_ECC_DIGEST_SZ_OFFSET);
+	priv->client.receive_cb = fcs_vab_callback;
+	ret = fcs_request_service(priv, (void *)&msg, FCS_REQUEST_TIMEOUT);
+	if (ret || priv->status) {
+		dev_err(dev, "failed to send the cmd=%d,ret=%d, status=%d\n",
+			COMMAND_FCS_CRYPTO_GET_DIGEST_INIT, ret, priv->status);
+		ret = -EIO;
+		goto close;
+	}
+
+	while (remaining_size > 0) {
+		if (remaining_size > AES_CRYPT_CMD_MAX_SZ) {
+			msg.command = COMMAND_FCS_CRYPTO_GET_DIGEST_UPDATE;
+			data_size = AES_CRYPT_CMD_MAX_SZ;
+		} else {
+			msg.command = COMMAND_FCS_CRYPTO_GET_DIGEST_FINALIZE;
+			data_size = remaining_size;
+		}
+
+		sg_pcopy_to_buffer(req->src, nents, s_buf, data_size, offset);
+
+		msg.arg[0] = priv->sha_sid;
+		msg.arg[1] = cid;
+		msg.payload = s_buf;
+		msg.payload_length = data_size;
+		msg.payload_output = d_buf;
+		msg.payload_length_output = crypto_ahash_digestsize(tfm);
+		priv->client.receive_cb = fcs_attestation_callback;
+
+		ret = fcs_request_service(priv, (void *)&msg,
+					  10 * FCS_REQUEST_TIMEOUT);
+		if (ret || priv->status) {
+			dev_err(dev, "unregconize response. ret=%d. status=%d\n",
+				ret, priv->status);
+			ret = -EIO;
+			goto close;
+		}
+
+		remaining_size -= data_size;
+		offset += data_size;
+	}
+
+	if (priv->size != crypto_ahash_digestsize(tfm)) {
+		dev_err(dev, "returned size %d is incorrect\n", priv->size);
+		ret = -EIO;
+		goto close;
+	}
+
+	memcpy(req->result, priv->kbuf, priv->size);
+	atomic64_inc(&priv->sha_reqs);
+	atomic64_add(req->nbytes, &priv->sha_bytes);
+
+close:
+	fcs_close_services(priv, s_buf, d_buf);
+out:
+	if (ret)
+		atomic64_inc(&priv->sha_errors);
+	crypto_finalize_hash_request(engine, req, ret);
+
+	return 0;
+}
+
+static int fcs_sha_cra_init(struct crypto_tfm *tfm)
+{
+	struct fcs_sha_ctx *ctx = crypto_tfm_ctx(tfm);
+	struct fcs_sha_alg *fcs_alg = container_of(__crypto_ahash_alg(tfm->__crt_alg),
+						   struct fcs_sha_alg, alg);
+
+	ctx->priv = fcs_sha_priv;
+	ctx->digest_sz_code = fcs_alg->digest_sz_code;
+	ctx->fallback = crypto_alloc_ahash(crypto_tfm_alg_name(tfm), 0,
+					   CRYPTO_ALG_NEED_FALLBACK);
+	if (IS_ERR(ctx->fallback)) {
+		dev_err(ctx->priv->client.dev, "fallback %s allocation failed\n",
+			crypto_tfm_alg_name(tfm));
+		return PTR_ERR(ctx->fallback);
+	}
+
+	/* the fallback state must fit in what we advertise as statesize */
+	if (crypto_ahash_statesize(ctx->fallback) >
+	    crypto_ahash_statesize(__crypto_ahash_cast(tfm))) {
+		crypto_free_ahash(ctx->fallback);
+		return -EINVAL;
+	}
+
+	crypto_ahash_set_reqsize(__crypto_ahash_cast(tfm),
+				 sizeof(struct fcs_sha_reqctx) +
+				 crypto_ahash_reqsize(ctx->fallback));
+
+	ctx->enginectx.op.do_one_request = fcs_sha_one_request;
+	ctx->enginectx.op.prepare_request = NULL;
+	ctx->enginectx.op.unprepare_request = NULL;
+
+	return 0;
+}
+
+static void fcs_sha_cra_exit(struct crypto_tfm *tfm)
+{
+	struct fcs_sha_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	crypto_free_ahash(ctx->fallback);
+}
+
+#define FCS_SHA_ALG(_name, _digestsize, _blocksize, _code)		\
+{									\
+	.digest_sz_code = _code,					\
+	.alg = {							\
+		.init = fcs_sha_init,					\
+		.update = fcs_sha_update,				\
+		.final = fcs_sha_final,					\
+		.finup = fcs_sha_finup,					\
+		.digest = fcs_sha_digest,				\
+		.export = fcs_sha_export,				\
+		.import = fcs_sha_import,				\
+		.halg = {						\
+			.digestsize = _digestsize,			\
+			/* the fallback is only known at tfm init */	\
+			.statesize = HASH_MAX_STATESIZE,		\
+			.base = {					\
+				.cra_name = _name,			\
+				.cra_driver_name = _name "-intel-fcs",	\
+				.cra_priority = 400,			\
+				.cra_flags = CRYPTO_ALG_ASYNC |		\
+					     CRYPTO_ALG_KERN_DRIVER_ONLY | \
+					     CRYPTO_ALG_NEED_FALLBACK,	\
+				.cra_blocksize = _blocksize,		\
+				.cra_ctxsize = sizeof(struct fcs_sha_ctx), \
+				.cra_init = fcs_sha_cra_init,		\
+				.cra_exit = fcs_sha_cra_exit,		\
+				.cra_module = THIS_MODULE,		\
+			}						\
+		}							\
+	}								\
+}
+
+static struct fcs_sha_alg fcs_sha_algs[] = {
+	FCS_SHA_ALG("sha256", SHA256_DIGEST_SIZE, SHA256_BLOCK_SIZE,
+		    FCS_SHA_DIGEST_SZ_256),
+	FCS_SHA_ALG("sha384", SHA384_DIGEST_SIZE, SHA384_BLOCK_SIZE,
+		    FCS_SHA_DIGEST_SZ_384),
+	FCS_SHA_ALG("sha512", SHA512_DIGEST_SIZE, SHA512_BLOCK_SIZE,
+		    FCS_SHA_DIGEST_SZ_512),
+};
+
+static ssize_t sha_stats_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	struct intel_fcs_priv *priv = dev_get_drvdata(dev);
+
+	return sprintf(buf, "requests %lld\nbytes %lld\nfallbacks %lld\nerrors %lld\n",
+		       atomic64_read(&priv->sha_reqs),
+		       atomic64_read(&priv->sha_bytes),
+		       atomic64_read(&priv->sha_fallbacks),
+		       atomic64_read(&priv->sha_errors));
+}
+static DEVICE_ATTR_RO(sha_stats);
+
+static int fcs_sha_register(struct intel_fcs_priv *priv)
+{
+	struct device *dev = priv->client.dev;
+	struct stratix10_svc_client_msg msg = {};
+	int ret, i;
+
+	mutex_lock(&priv->lock);
+	msg.command = COMMAND_FCS_CRYPTO_OPEN_SESSION;
+	priv->client.receive_cb = fcs_crypto_sessionid_callback;
+	ret = fcs_request_service(priv, (void *)&msg, FCS_REQUEST_TIMEOUT);
+	if (ret || priv->status) {
+		dev_err(dev, "failed to open SHA session, ret=%d status=%d\n",
+			ret, priv->status);
+		fcs_close_services(priv, NULL, NULL);
+		return -EIO;
+	}
+	priv->sha_sid = priv->sid;
+	fcs_close_services(priv, NULL, NULL);
+
+	priv->engine = crypto_engine_alloc_init(dev, true);
+	if (!priv->engine) {
+		ret = -ENOMEM;
+		goto close_session;
+	}
+
+	ret = crypto_engine_start(priv->engine);
+	if (ret)
+		goto engine_exit;
+
+	fcs_sha_priv = priv;
+	for (i = 0; i < ARRAY_SIZE(fcs_sha_algs); i++) {
+		ret = crypto_register_ahash(&fcs_sha_algs[i].alg);
+		if (ret) {
+			dev_err(dev, "can't register %s (%d)\n",
+				fcs_sha_algs[i].alg.halg.base.cra_name, ret);
+			goto unregister;
+		}
+	}
+
+	ret = device_create_file(dev, &dev_attr_sha_stats);
+	if (ret)
+		goto unregister;
+
+	return 0;
+
+unregister:
+	while (--i >= 0)
+		crypto_unregister_ahash(&fcs_sha_algs[i].alg);
+	fcs_sha_priv = NULL;
+engine_exit:
+	crypto_engine_exit(priv->engine);
+	priv->engine = NULL;
+close_session:
+	mutex_lock(&priv->lock);
+	msg.command = COMMAND_FCS_CRYPTO_CLOSE_SESSION;
+	msg.arg[0] = priv->sha_sid;
+	priv->client.receive_cb = fcs_vab_callback;
+	fcs_request_service(priv, (void *)&msg, FCS_REQUEST_TIMEOUT);
+	fcs_close_services(priv, NULL, NULL);
+
+	return ret;
+}
+
+static void fcs_sha_unregister(struct intel_fcs_priv *priv)
+{
+	struct stratix10_svc_client_msg msg = {};
+	int i;
+
+	if (!priv->engine)
+		return;
+
+	device_remove_file(priv->client.dev, &dev_attr_sha_stats);
+	for (i = 0; i < ARRAY_SIZE(fcs_sha_algs); i++)
+		crypto_unregister_ahash(&fcs_sha_algs[i].alg);
+	crypto_engine_exit(priv->engine);
+	priv->engine = NULL;
+	fcs_sha_priv = NULL;
+
+	mutex_lock(&priv->lock);
+	msg.command = COMMAND_FCS_CRYPTO_CLOSE_SESSION;
+	msg.arg[0] = priv->sha_sid;
+	priv->client.receive_cb = fcs_vab_callback;
+	fcs_request_service(priv, (void *)&msg, FCS_REQUEST_TIMEOUT);
+	fcs_close_services(priv, NULL, NULL);
+}
+
 static int fcs_driver_probe(struct platform_device *pdev)
 {
 	struct device *dev = &pdev->dev;
@@ -3886,6 +5009,11 @@ static int fcs_driver_probe(struct platform_device *pdev)
 
 	/* only register the HW RNG if the platform supports it! */
 	if (priv->p_data->have_hwrng) {
+		priv->rng_cache = devm_kzalloc(dev, FCS_RNG_CACHE_SIZE,
+					       GFP_KERNEL);
+		if (!priv->rng_cache)
+			return -ENOMEM;
+
 		/* register hwrng device */
 		priv->rng.name = "intel-rng";
 		priv->rng.read = fcs_rng_read;
@@ -3910,6 +5038,15 @@ static int fcs_driver_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, priv);
 
+	if (priv->p_data->have_hwrng &&
+	    device_create_file(dev, &dev_attr_rng_stats))
+		dev_notice(dev, "RNG statistics unavailable\n");
+
+	/* SHA-2 offload is optional, the ioctl interface works without it */
+	ret = fcs_sha_register(priv);
+	if (ret)
+		dev_notice(dev, "SHA-2 crypto API offload disabled (%d)\n", ret);
+
 	return 0;
 
 cleanup:
@@ -3958,8 +5095,12 @@ static int fcs_driver_remove(struct platform_device *pdev)
 	}
 
 no_platform:
-	if (priv->p_data->have_hwrng)
+	fcs_sha_unregister(priv);
+	if (priv->p_data->have_hwrng) {
+		device_remove_file(priv->client.dev, &dev_attr_rng_stats);
 		hwrng_unregister(&priv->rng);
+		memzero_explicit(priv->rng_cache, FCS_RNG_CACHE_SIZE);
+	}
 	misc_deregister(&priv->miscdev);
 	stratix10_svc_free_channel(priv->chan);
 
@@ -25,6 +25,7 @@
 #include <linux/dma-mapping.h>
 #include <linux/vmalloc.h>
 #include <asm/cacheflush.h>
+#include <crypto/engine.h>
 
 #include <uapi/linux/intel_fcs-ioctl.h>
 
@@ -38,6 +39,20 @@ extern uint64_t *l2_table;
 extern uint64_t *l1_table;
 extern uint64_t *l3_tables[512];
 
+/**
+ * struct fcs_fixed_buf - buffer registered with INTEL_FCS_DEV_REGISTER_BUFFER
+ * @va: service layer shared memory, NULL if the slot is free
+ * @size: size of @va
+ * @owner: file that registered the buffer
+ * @mapped: number of VMAs mapping the buffer
+ */
+struct fcs_fixed_buf {
+	void *va;
+	size_t size;
+	struct file *owner;
+	atomic_t mapped;
+};
+
 struct intel_fcs_priv {
 	struct stratix10_svc_chan *chan;
 	struct stratix10_svc_client client;
@@ -51,7 +66,24 @@ struct intel_fcs_priv {
 	unsigned int cid_high;
 	unsigned int sid;
 	struct hwrng rng;
+	u8 *rng_cache;
+	unsigned int rng_avail;
+	atomic64_t rng_bytes;
+	atomic64_t rng_calls;
+	atomic64_t rng_ns;
+	atomic64_t rng_errors;
 	const struct socfpga_fcs_data *p_data;
+	struct crypto_engine *engine;
+	unsigned int sha_sid;
+	atomic_t sha_cid;
+	atomic64_t sha_reqs;
+	atomic64_t sha_bytes;
+	atomic64_t sha_fallbacks;
+	atomic64_t sha_errors;
+	struct fcs_fixed_buf fixed_bufs[INTEL_FCS_FIXED_BUF_MAX];
+	unsigned int nr_fixed_bufs;
+	void *fixed_iv_buf;
+	void *fixed_ps_buf;
 };
 
 int smmu_program_reg(struct intel_fcs_priv *priv, uint32_t reg_add, uint32_t reg_value);
@@ -8,6 +8,7 @@
 #include <linux/dma-buf.h>
 #include <linux/dma-resv.h>
 #include <linux/kobject.h>
+#include <linux/math64.h>
 #include <linux/printk.h>
 #include <linux/slab.h>
 #include <linux/sysfs.h>
@@ -41,6 +42,17 @@
  * * ``/sys/kernel/dmabuf/buffers/<inode_number>/exporter_name``
  * * ``/sys/kernel/dmabuf/buffers/<inode_number>/size``
  *
+ * The DMA-BUF heaps have their allocation statistics under
+ * ``/sys/kernel/dmabuf/heaps/<heap_name>``:
+ *
+ * * ``allocations``: number of buffers allocated from the heap
+ * * ``alloc_latency_avg_ns`` and ``alloc_latency_max_ns``: time taken by
+ *   the allocations
+ * * ``bytes_in_use``: size of the buffers not released yet, only for the
+ *   heaps caching their buffers
+ * * ``pool_bytes`` and ``pool_hits``: size of the buffers cached by the heap
+ *   and number of allocations served from them
+ *
  * The information in the interface can also be used to derive per-exporter
  * statistics. The data from the interface can be gathered on error conditions
  * or other important events to provide a snapshot of DMA-BUF usage.
@@ -143,6 +155,7 @@ static const struct kset_uevent_ops dmabuf_sysfs_no_uevent_ops = {
 
 static struct kset *dma_buf_stats_kset;
 static struct kset *dma_buf_per_buffer_stats_kset;
+static struct kset *dma_heap_stats_kset;
 int dma_buf_init_sysfs_statistics(void)
 {
 	dma_buf_stats_kset = kset_create_and_add("dmabuf",
@@ -159,11 +172,21 @@ int dma_buf_init_sysfs_statistics(void)
 		return -ENOMEM;
 	}
 
+	dma_heap_stats_kset = kset_create_and_add("heaps",
+						  &dmabuf_sysfs_no_uevent_ops,
+						  &dma_buf_stats_kset->kobj);
+	if (!dma_heap_stats_kset) {
+		kset_unregister(dma_buf_per_buffer_stats_kset);
+		kset_unregister(dma_buf_stats_kset);
+		return -ENOMEM;
+	}
+
 	return 0;
 }
 
 void dma_buf_uninit_sysfs_statistics(void)
 {
+	kset_unregister(dma_heap_stats_kset);
 	kset_unregister(dma_buf_per_buffer_stats_kset);
 	kset_unregister(dma_buf_stats_kset);
 }
@@ -200,3 +223,116 @@ int dma_buf_stats_setup(struct dma_buf *dmabuf, struct file *file)
 	dmabuf->sysfs_entry = NULL;
 	return ret;
 }
+
+struct dma_heap_sysfs_entry {
+	struct kobject kobj;
+	struct dma_heap_stats *stats;
+};
+
+static struct dma_heap_stats *to_dma_heap_stats(struct kobject *kobj)
+{
+	return container_of(kobj, struct dma_heap_sysfs_entry, kobj)->stats;
+}
+
+static ssize_t allocations_show(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buf)
+{
+	struct dma_heap_stats *stats = to_dma_heap_stats(kobj);
+
+	return sysfs_emit(buf, "%lld\n", atomic64_read(&stats->allocations));
+}
+
+static ssize_t alloc_latency_avg_ns_show(struct kobject *kobj,
+					 struct kobj_attribute *attr, char *buf)
+{
+	struct dma_heap_stats *stats = to_dma_heap_stats(kobj);
+	u64 allocations = atomic64_read(&stats->allocations);
+	u64 ns = atomic64_read(&stats->alloc_ns);
+
+	return sysfs_emit(buf, "%llu\n",
+			  allocations ? div64_u64(ns, allocations) : 0);
+}
+
+static ssize_t alloc_latency_max_ns_show(struct kobject *kobj,
+					 struct kobj_attribute *attr, char *buf)
+{
+	struct dma_heap_stats *stats = to_dma_heap_stats(kobj);
+
+	return sysfs_emit(buf, "%lld\n", atomic64_read(&stats->alloc_ns_max));
+}
+
+static ssize_t bytes_in_use_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	struct dma_heap_stats *stats = to_dma_heap_stats(kobj);
+
+	return sysfs_emit(buf, "%lld\n", atomic64_read(&stats->bytes_in_use));
+}
+
+static ssize_t pool_bytes_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	struct dma_heap_stats *stats = to_dma_heap_stats(kobj);
+
+	return sysfs_emit(buf, "%lld\n", atomic64_read(&stats->pool_bytes));
+}
+
+static ssize_t pool_hits_show(struct kobject *kobj,
+			      struct kobj_attribute *attr, char *buf)
+{
+	struct dma_heap_stats *stats = to_dma_heap_stats(kobj);
+
+	return sysfs_emit(buf, "%lld\n", atomic64_read(&stats->pool_hits));
+}
+
+static struct kobj_attribute allocations_attribute = __ATTR_RO(allocations);
+static struct kobj_attribute alloc_latency_avg_ns_attribute =
+	__ATTR_RO(alloc_latency_avg_ns);
+static struct kobj_attribute alloc_latency_max_ns_attribute =
+	__ATTR_RO(alloc_latency_max_ns);
+static struct kobj_attribute bytes_in_use_attribute = __ATTR_RO(bytes_in_use);
+static struct kobj_attribute pool_bytes_attribute = __ATTR_RO(pool_bytes);
+static struct kobj_attribute pool_hits_attribute = __ATTR_RO(pool_hits);
+
+static struct attribute *dma_heap_stats_default_attrs[] = {
+	&allocations_attribute.attr,
+	&alloc_latency_avg_ns_attribute.attr,
+	&alloc_latency_max_ns_attribute.attr,
+	&bytes_in_use_attribute.attr,
+	&pool_bytes_attribute.attr,
+	&pool_hits_attribute.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(dma_heap_stats_default);
+
+static void dma_heap_sysfs_release(struct kobject *kobj)
+{
+	kfree(container_of(kobj, struct dma_heap_sysfs_entry, kobj));
+}
+
+static struct kobj_type dma_heap_ktype = {
+	.sysfs_ops = &kobj_sysfs_ops,
+	.release = dma_heap_sysfs_release,
+	.default_groups = dma_heap_stats_default_groups,
+};
+
+/* DMA-BUF heaps are never removed, neither is their directory. */
+int dma_heap_stats_setup(struct dma_heap_stats *stats, const char *name)
+{
+	struct dma_heap_sysfs_entry *sysfs_entry;
+	int ret;
+
+	sysfs_entry = kzalloc(sizeof(*sysfs_entry), GFP_KERNEL);
+	if (!sysfs_entry)
+		return -ENOMEM;
+
+	sysfs_entry->kobj.kset = dma_heap_stats_kset;
+	sysfs_entry->stats = stats;
+
+	ret = kobject_init_and_add(&sysfs_entry->kobj, &dma_heap_ktype, NULL,
+				   "%s", name);
+	if (ret)
+		kobject_put(&sysfs_entry->kobj);
+
+	return ret;
+}
@@ -8,6 +8,27 @@
 #ifndef _DMA_BUF_SYSFS_STATS_H
 #define _DMA_BUF_SYSFS_STATS_H
 
+#include <linux/atomic.h>
+
+/**
+ * struct dma_heap_stats - allocation statistics of a DMA-BUF heap
+ * @allocations:	number of buffers allocated
+ * @alloc_ns:		total time spent allocating them
+ * @alloc_ns_max:	longest allocation
+ * @bytes_in_use:	size of the buffers not released yet, only counted by
+ *			the heaps using dma_heap_pool_enable()
+ * @pool_bytes:		size of the buffers cached by the heap
+ * @pool_hits:		number of allocations served from the pool
+ */
+struct dma_heap_stats {
+	atomic64_t allocations;
+	atomic64_t alloc_ns;
+	atomic64_t alloc_ns_max;
+	atomic64_t bytes_in_use;
+	atomic64_t pool_bytes;
+	atomic64_t pool_hits;
+};
+
 #ifdef CONFIG_DMABUF_SYSFS_STATS
 
 int dma_buf_init_sysfs_statistics(void);
@@ -16,6 +37,8 @@ void dma_buf_uninit_sysfs_statistics(void);
 int dma_buf_stats_setup(struct dma_buf *dmabuf, struct file *file);
 
 void dma_buf_stats_teardown(struct dma_buf *dmabuf);
+
+int dma_heap_stats_setup(struct dma_heap_stats *stats, const char *name);
 #else
 
 static inline int dma_buf_init_sysfs_statistics(void)
@@ -31,5 +54,11 @@ static inline int dma_buf_stats_setup(struct dma_buf *dmabuf, struct file *file)
 }
 
 static inline void dma_buf_stats_teardown(struct dma_buf *dmabuf) {}
+
+static inline int dma_heap_stats_setup(struct dma_heap_stats *stats,
+				       const char *name)
+{
+	return 0;
+}
 #endif
 #endif // _DMA_BUF_SYSFS_STATS_H
@@ -9,7 +9,7 @@
 
 #include <linux/dma-fence-chain.h>
 
-static bool dma_fence_chain_enable_signaling(struct dma_fence *fence);
+static bool dma_fence_chain_arm(struct dma_fence_chain *head, bool follow);
 
 /**
  * dma_fence_chain_get_prev - use RCU to get a reference to the previous fence
@@ -119,6 +119,19 @@ static const char *dma_fence_chain_get_timeline_name(struct dma_fence *fence)
         return "unbound";
 }
 
+/*
+ * Once a node signals, all the nodes before it did as well. Drop them now
+ * rather than when the node is released, so walks from the newer nodes stop
+ * here instead of garbage collecting the whole signaled part of the chain.
+ */
+static void dma_fence_chain_compact(struct dma_fence_chain *chain)
+{
+	struct dma_fence *prev;
+
+	prev = unrcu_pointer(xchg(&chain->prev, NULL));
+	dma_fence_put(prev);
+}
+
 static void dma_fence_chain_irq_work(struct irq_work *work)
 {
 	struct dma_fence_chain *chain;
@@ -126,9 +139,11 @@ static void dma_fence_chain_irq_work(struct irq_work *work)
 	chain = container_of(work, typeof(*chain), work);
 
 	/* Try to rearm the callback */
-	if (!dma_fence_chain_enable_signaling(&chain->base))
+	if (!dma_fence_chain_arm(chain, true)) {
 		/* Ok, we are done. No more unsignaled fences left */
+		dma_fence_chain_compact(chain);
 		dma_fence_signal(&chain->base);
+	}
 	dma_fence_put(&chain->base);
 }
 
@@ -142,14 +157,29 @@ static void dma_fence_chain_cb(struct dma_fence *f, struct dma_fence_cb *cb)
 	dma_fence_put(f);
 }
 
-static bool dma_fence_chain_enable_signaling(struct dma_fence *fence)
+/*
+ * Install the callback of @head on the first unsignaled fence of the chain.
+ *
+ * With @follow set, an older node with signaling enabled is waited on instead
+ * of its contained fence: it signals once all the remaining fences did. The
+ * nodes waiting on a chain then line up behind each other, instead of all
+ * waiting on the fence signaled next and walking the chain again each time
+ * it does. Nodes share a lock class, so this is only done when called from
+ * the irq work, without the lock of @head held.
+ */
+static bool dma_fence_chain_arm(struct dma_fence_chain *head, bool follow)
 {
-	struct dma_fence_chain *head = to_dma_fence_chain(fence);
+	struct dma_fence *fence;
 
 	dma_fence_get(&head->base);
 	dma_fence_chain_for_each(fence, &head->base) {
 		struct dma_fence *f = dma_fence_chain_contained(fence);
 
+		if (follow && fence != &head->base &&
+		    dma_fence_is_chain(fence) &&
+		    test_bit(DMA_FENCE_FLAG_ENABLE_SIGNAL_BIT, &fence->flags))
+			f = fence;
+
 		dma_fence_get(f);
 		if (!dma_fence_add_callback(f, &head->cb, dma_fence_chain_cb)) {
 			dma_fence_put(fence);
@@ -161,6 +191,11 @@ static bool dma_fence_chain_enable_signaling(struct dma_fence *fence)
 	return false;
 }
 
+static bool dma_fence_chain_enable_signaling(struct dma_fence *fence)
+{
+	return dma_fence_chain_arm(to_dma_fence_chain(fence), false);
+}
+
 static bool dma_fence_chain_signaled(struct dma_fence *fence)
 {
 	dma_fence_chain_for_each(fence, fence) {
@@ -479,6 +479,44 @@ int dma_fence_signal(struct dma_fence *fence)
 }
 EXPORT_SYMBOL(dma_fence_signal);
 
+/**
+ * dma_fence_signal_many - signal completion of several fences
+ * @fences: the fences to signal
+ * @count: number of fences in @fences
+ *
+ * Signal completion of @fences in order, as dma_fence_signal() would, with a
+ * single timestamp. The lock shared by consecutive fences, as fences of the
+ * same timeline usually do, is only taken once for all of them.
+ *
+ * Meant for drivers completing several jobs at once, the callbacks of all
+ * the fences sharing a lock run with it held.
+ */
+void dma_fence_signal_many(struct dma_fence **fences, unsigned int count)
+{
+	ktime_t timestamp = ktime_get();
+	spinlock_t *lock = NULL;
+	unsigned long flags;
+	unsigned int i;
+	bool tmp;
+
+	tmp = dma_fence_begin_signalling();
+
+	for (i = 0; i < count; i++) {
+		if (fences[i]->lock != lock) {
+			if (lock)
+				spin_unlock_irqrestore(lock, flags);
+			lock = fences[i]->lock;
+			spin_lock_irqsave(lock, flags);
+		}
+		dma_fence_signal_timestamp_locked(fences[i], timestamp);
+	}
+	if (lock)
+		spin_unlock_irqrestore(lock, flags);
+
+	dma_fence_end_signalling(tmp);
+}
+EXPORT_SYMBOL(dma_fence_signal_many);
+
 /**
  * dma_fence_wait_timeout - sleep until the fence gets signaled
  * or until timeout elapses
@@ -12,7 +12,10 @@
 #include <linux/dma-buf.h>
 #include <linux/err.h>
 #include <linux/xarray.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/shrinker.h>
 #include <linux/slab.h>
 #include <linux/nospec.h>
 #include <linux/uaccess.h>
@@ -20,6 +23,8 @@
 #include <linux/dma-heap.h>
 #include <uapi/linux/dma-heap.h>
 
+#include "dma-buf-sysfs-stats.h"
+
 #define DEVNAME "dma_heap"
 
 #define NUM_HEAP_MINORS 128
@@ -31,6 +36,12 @@
  * @heap_devt		heap device node
  * @list		list head connecting to list of heaps
  * @heap_cdev		heap char device
+ * @stats		allocation statistics
+ * @pool_lock		protects @pool
+ * @pool		released buffers kept for reuse, most recent first
+ * @pool_max		maximum size of the buffers in @pool
+ * @pool_free		frees a buffer of the heap, NULL without pool
+ * @pool_shrinker	gives the buffers of @pool back under memory pressure
  *
  * Represents a heap of memory from which buffers can be made.
  */
@@ -41,6 +52,13 @@ struct dma_heap {
 	dev_t heap_devt;
 	struct list_head list;
 	struct cdev heap_cdev;
+	struct dma_heap_stats stats;
+	struct mutex pool_lock;
+	struct list_head pool;
+	size_t pool_max;
+	void (*pool_free)(struct dma_heap *heap,
+			  struct dma_heap_pool_buffer *buffer);
+	struct shrinker pool_shrinker;
 };
 
 static LIST_HEAD(heap_list);
@@ -54,6 +72,8 @@ static int dma_heap_buffer_alloc(struct dma_heap *heap, size_t len,
 				 unsigned int heap_flags)
 {
 	struct dma_buf *dmabuf;
+	ktime_t start;
+	s64 ns, max;
 	int fd;
 
 	/*
@@ -64,10 +84,23 @@ static int dma_heap_buffer_alloc(struct dma_heap *heap, size_t len,
 	if (!len)
 		return -EINVAL;
 
+	start = ktime_get();
 	dmabuf = heap->ops->allocate(heap, len, fd_flags, heap_flags);
 	if (IS_ERR(dmabuf))
 		return PTR_ERR(dmabuf);
 
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	atomic64_inc(&heap->stats.allocations);
+	atomic64_add(ns, &heap->stats.alloc_ns);
+	max = atomic64_read(&heap->stats.alloc_ns_max);
+	while (ns > max &&
+	       !atomic64_try_cmpxchg(&heap->stats.alloc_ns_max, &max, ns))
+		;
+
+	/* released through dma_heap_pool_put() */
+	if (heap->pool_free)
+		atomic64_add(len, &heap->stats.bytes_in_use);
+
 	fd = dma_buf_fd(dmabuf, fd_flags);
 	if (fd < 0) {
 		dma_buf_put(dmabuf);
@@ -216,6 +249,196 @@ const char *dma_heap_get_name(struct dma_heap *heap)
 	return heap->name;
 }
 
+/* Moves the oldest buffers of the pool to @list, pool_lock held. */
+static size_t dma_heap_pool_evict(struct dma_heap *heap, size_t bytes,
+				  struct list_head *list)
+{
+	struct dma_heap_pool_buffer *buffer;
+	size_t evicted = 0;
+
+	while (evicted < bytes && !list_empty(&heap->pool)) {
+		buffer = list_last_entry(&heap->pool,
+					 struct dma_heap_pool_buffer, list);
+		list_move(&buffer->list, list);
+		evicted += buffer->len;
+	}
+	atomic64_sub(evicted, &heap->stats.pool_bytes);
+
+	return evicted;
+}
+
+static void dma_heap_pool_free_list(struct dma_heap *heap,
+				    struct list_head *list)
+{
+	struct dma_heap_pool_buffer *buffer, *tmp;
+
+	list_for_each_entry_safe(buffer, tmp, list, list) {
+		list_del(&buffer->list);
+		heap->pool_free(heap, buffer);
+	}
+}
+
+static unsigned long dma_heap_pool_count(struct shrinker *shrinker,
+					 struct shrink_control *sc)
+{
+	struct dma_heap *heap = container_of(shrinker, struct dma_heap,
+					     pool_shrinker);
+	unsigned long pages;
+
+	pages = atomic64_read(&heap->stats.pool_bytes) >> PAGE_SHIFT;
+
+	return pages ?: SHRINK_EMPTY;
+}
+
+static unsigned long dma_heap_pool_scan(struct shrinker *shrinker,
+					struct shrink_control *sc)
+{
+	struct dma_heap *heap = container_of(shrinker, struct dma_heap,
+					     pool_shrinker);
+	LIST_HEAD(evicted);
+	size_t bytes;
+
+	if (!mutex_trylock(&heap->pool_lock))
+		return SHRINK_STOP;
+	bytes = dma_heap_pool_evict(heap, sc->nr_to_scan << PAGE_SHIFT,
+				    &evicted);
+	mutex_unlock(&heap->pool_lock);
+
+	dma_heap_pool_free_list(heap, &evicted);
+
+	return bytes >> PAGE_SHIFT;
+}
+
+/**
+ * dma_heap_pool_enable() - keep the released buffers of a heap for reuse
+ * @heap: DMA-Heap to cache the buffers of
+ * @max_bytes: maximum size of the cached buffers, 0 to only count the
+ *	       buffers in use
+ * @free: frees a buffer of the heap
+ *
+ * The heap releases its buffers with dma_heap_pool_put() and looks for one
+ * of the right size with dma_heap_pool_get() before allocating a new one.
+ * The cached buffers are freed when over @max_bytes and under memory
+ * pressure.
+ *
+ * Must be called right after dma_heap_add(), before anything is allocated
+ * from the heap.  The heap may use dma_heap_pool_put() even when this
+ * fails, the buffers are then freed right away.
+ *
+ * Returns:
+ * 0 on success, a negative error code otherwise.
+ */
+int dma_heap_pool_enable(struct dma_heap *heap, size_t max_bytes,
+			 void (*free)(struct dma_heap *heap,
+				      struct dma_heap_pool_buffer *buffer))
+{
+	int ret;
+
+	if (heap->pool_free)
+		return -EBUSY;
+
+	heap->pool_free = free;
+
+	heap->pool_shrinker.count_objects = dma_heap_pool_count;
+	heap->pool_shrinker.scan_objects = dma_heap_pool_scan;
+	heap->pool_shrinker.seeks = DEFAULT_SEEKS;
+	ret = register_shrinker(&heap->pool_shrinker, "dma-heap-%s",
+				heap->name);
+	if (ret)
+		return ret;
+
+	heap->pool_max = max_bytes;
+
+	return 0;
+}
+
+/**
+ * dma_heap_pool_get() - reuse a buffer released to the pool of a heap
+ * @heap: DMA-Heap to allocate from
+ * @len: size of the buffer, PAGE_ALIGNed
+ *
+ * The contents of the buffer are the ones it was released with, the heap
+ * has to clear them before handing the buffer out again.
+ *
+ * Returns:
+ * The most recently released buffer of @len bytes, NULL if there is none.
+ */
+struct dma_heap_pool_buffer *dma_heap_pool_get(struct dma_heap *heap,
+					       size_t len)
+{
+	struct dma_heap_pool_buffer *buffer, *found = NULL;
+
+	if (!heap->pool_free)
+		return NULL;
+
+	mutex_lock(&heap->pool_lock);
+	list_for_each_entry(buffer, &heap->pool, list) {
+		if (buffer->len == len) {
+			list_del(&buffer->list);
+			atomic64_sub(len, &heap->stats.pool_bytes);
+			atomic64_inc(&heap->stats.pool_hits);
+			found = buffer;
+			break;
+		}
+	}
+	mutex_unlock(&heap->pool_lock);
+
+	return found;
+}
+
+/**
+ * dma_heap_pool_put() - release a buffer to the pool of a heap
+ * @heap: DMA-Heap the buffer was allocated from
+ * @buffer: the buffer
+ *
+ * The buffer is freed right away when it doesn't fit in the pool, otherwise
+ * it replaces the oldest buffers of the pool.
+ */
+void dma_heap_pool_put(struct dma_heap *heap,
+		       struct dma_heap_pool_buffer *buffer)
+{
+	LIST_HEAD(evicted);
+	size_t bytes;
+
+	atomic64_sub(buffer->len, &heap->stats.bytes_in_use);
+
+	if (buffer->len > heap->pool_max) {
+		heap->pool_free(heap, buffer);
+		return;
+	}
+
+	mutex_lock(&heap->pool_lock);
+	bytes = atomic64_read(&heap->stats.pool_bytes) + buffer->len;
+	if (bytes > heap->pool_max)
+		dma_heap_pool_evict(heap, bytes - heap->pool_max, &evicted);
+	list_add(&buffer->list, &heap->pool);
+	atomic64_add(buffer->len, &heap->stats.pool_bytes);
+	mutex_unlock(&heap->pool_lock);
+
+	dma_heap_pool_free_list(heap, &evicted);
+}
+
+/**
+ * dma_heap_pool_drain() - free the buffers cached by the pool of a heap
+ * @heap: DMA-Heap to drain the pool of
+ *
+ * For the heaps allocating from a memory region of their own, which the
+ * shrinker knows nothing about, when an allocation fails.
+ */
+void dma_heap_pool_drain(struct dma_heap *heap)
+{
+	LIST_HEAD(evicted);
+
+	if (!heap->pool_free)
+		return;
+
+	mutex_lock(&heap->pool_lock);
+	dma_heap_pool_evict(heap, SIZE_MAX, &evicted);
+	mutex_unlock(&heap->pool_lock);
+
+	dma_heap_pool_free_list(heap, &evicted);
+}
+
 struct dma_heap *dma_heap_add(const struct dma_heap_export_info *exp_info)
 {
 	struct dma_heap *heap, *h, *err_ret;
@@ -240,6 +463,8 @@ struct dma_heap *dma_heap_add(const struct dma_heap_export_info *exp_info)
 	heap->name = exp_info->name;
 	heap->ops = exp_info->ops;
 	heap->priv = exp_info->priv;
+	mutex_init(&heap->pool_lock);
+	INIT_LIST_HEAD(&heap->pool);
 
 	/* Find unused minor number */
 	ret = xa_alloc(&dma_heap_minors, &minor, heap,
@@ -288,6 +513,12 @@ struct dma_heap *dma_heap_add(const struct dma_heap_export_info *exp_info)
 	list_add(&heap->list, &heap_list);
 	mutex_unlock(&heap_list_lock);
 
+	/* the statistics are not worth failing the heap for */
+	ret = dma_heap_stats_setup(&heap->stats, heap->name);
+	if (ret)
+		pr_warn("dma_heap: Unable to add statistics of heap %s: %d\n",
+			heap->name, ret);
+
 	return heap;
 
 err3:
@@ -8,6 +8,7 @@
 #include <linux/dma-fence.h>
 #include <linux/dma-fence-chain.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/kthread.h>
 #include <linux/mm.h>
 #include <linux/sched/signal.h>
@@ -44,7 +45,7 @@ static const struct dma_fence_ops mock_ops = {
 	.release = mock_fence_release,
 };
 
-static struct dma_fence *mock_fence(void)
+static struct dma_fence *__mock_fence(spinlock_t *lock)
 {
 	struct mock_fence *f;
 
@@ -52,12 +53,20 @@ static struct dma_fence *mock_fence(void)
 	if (!f)
 		return NULL;
 
-	spin_lock_init(&f->lock);
-	dma_fence_init(&f->base, &mock_ops, &f->lock, 0, 0);
+	if (!lock) {
+		spin_lock_init(&f->lock);
+		lock = &f->lock;
+	}
+	dma_fence_init(&f->base, &mock_ops, lock, 0, 0);
 
 	return &f->base;
 }
 
+static struct dma_fence *mock_fence(void)
+{
+	return __mock_fence(NULL);
+}
+
 static struct dma_fence *mock_chain(struct dma_fence *prev,
 				    struct dma_fence *fence,
 				    u64 seqno)
@@ -559,6 +568,159 @@ static int signal_backward(void *arg)
 	return err;
 }
 
+static int signal_many(void *arg)
+{
+	struct fence_chains fc;
+	int err;
+	int i;
+
+	err = fence_chains_init(&fc, 64, seqno_inc);
+	if (err)
+		return err;
+
+	dma_fence_signal_many(fc.fences, fc.chain_length / 2);
+
+	for (i = 0; i < fc.chain_length; i++) {
+		if (dma_fence_is_signaled(fc.chains[i]) !=
+		    (i < fc.chain_length / 2)) {
+			pr_err("chain[%d] is %ssignaled!\n", i,
+			       i < fc.chain_length / 2 ? "not " : "");
+			err = -EINVAL;
+			goto err;
+		}
+	}
+
+	dma_fence_signal_many(fc.fences, fc.chain_length);
+
+	for (i = 0; i < fc.chain_length; i++) {
+		if (!dma_fence_is_signaled(fc.chains[i])) {
+			pr_err("chain[%d] was not signaled!\n", i);
+			err = -EINVAL;
+			goto err;
+		}
+	}
+
+err:
+	fence_chains_fini(&fc);
+	return err;
+}
+
+static int signal_many_shared(void *arg)
+{
+	static DEFINE_SPINLOCK(lock0);
+	static DEFINE_SPINLOCK(lock1);
+	struct dma_fence *fences[64] = {}, *chains[64] = {};
+	struct dma_fence *tail = NULL;
+	int err = 0;
+	int i;
+
+	/* Runs of 4 fences share a lock, as the fences of a timeline do */
+	for (i = 0; i < ARRAY_SIZE(fences); i++) {
+		fences[i] = __mock_fence(i & 4 ? &lock1 : &lock0);
+		if (!fences[i]) {
+			err = -ENOMEM;
+			goto err;
+		}
+
+		chains[i] = mock_chain(tail, fences[i], i + 1);
+		if (!chains[i]) {
+			err = -ENOMEM;
+			goto err;
+		}
+
+		tail = chains[i];
+		dma_fence_enable_sw_signaling(chains[i]);
+	}
+
+	dma_fence_signal_many(fences, ARRAY_SIZE(fences) / 2);
+
+	for (i = 0; i < ARRAY_SIZE(fences); i++) {
+		if (dma_fence_is_signaled(chains[i]) !=
+		    (i < ARRAY_SIZE(fences) / 2)) {
+			pr_err("chain[%d] is %ssignaled!\n", i,
+			       i < ARRAY_SIZE(fences) / 2 ? "not " : "");
+			err = -EINVAL;
+			goto err;
+		}
+	}
+
+	dma_fence_signal_many(fences, ARRAY_SIZE(fences));
+
+	for (i = 0; i < ARRAY_SIZE(fences); i++) {
+		if (!dma_fence_is_signaled(chains[i])) {
+			pr_err("chain[%d] was not signaled!\n", i);
+			err = -EINVAL;
+			goto err;
+		}
+	}
+
+err:
+	for (i = 0; i < ARRAY_SIZE(fences); i++) {
+		if (fences[i])
+			dma_fence_signal(fences[i]);
+		dma_fence_put(fences[i]);
+		dma_fence_put(chains[i]);
+	}
+	return err;
+}
+
+static int __time_fence_chains(unsigned int count, bool backward, u64 *ns)
+{
+	struct fence_chains fc;
+	ktime_t start;
+	int err;
+	int i;
+
+	err = fence_chains_init(&fc, count, seqno_inc);
+	if (err)
+		return err;
+
+	/* Time the walks of the nodes waiting on the chain, in both orders */
+	for (i = 0; i < fc.chain_length; i++)
+		dma_fence_enable_sw_signaling(fc.chains[i]);
+
+	start = ktime_get();
+	if (backward) {
+		for (i = fc.chain_length; i--; )
+			dma_fence_signal(fc.fences[i]);
+	} else {
+		dma_fence_signal_many(fc.fences, fc.chain_length);
+	}
+
+	if (dma_fence_wait(fc.tail, false))
+		err = -EIO;
+	*ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	fence_chains_fini(&fc);
+	return err;
+}
+
+static int signal_lengths(void *arg)
+{
+	static const unsigned int lengths[] = {
+		64, 1 << 10, CHAIN_SZ, 4 * CHAIN_SZ
+	};
+	u64 forward, backward;
+	int err;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(lengths); i++) {
+		err = __time_fence_chains(lengths[i], false, &forward);
+		if (err)
+			return err;
+
+		err = __time_fence_chains(lengths[i], true, &backward);
+		if (err)
+			return err;
+
+		pr_info("chain length %u: forward %llu ns/node, backward %llu ns/node\n",
+			lengths[i], div_u64(forward, lengths[i]),
+			div_u64(backward, lengths[i]));
+	}
+
+	return 0;
+}
+
 static int __wait_fence_chains(void *arg)
 {
 	struct fence_chains *fc = arg;
@@ -688,6 +850,9 @@ int dma_fence_chain(void)
 		SUBTEST(find_race),
 		SUBTEST(signal_forward),
 		SUBTEST(signal_backward),
+		SUBTEST(signal_many),
+		SUBTEST(signal_many_shared),
+		SUBTEST(signal_lengths),
 		SUBTEST(wait_forward),
 		SUBTEST(wait_backward),
 		SUBTEST(wait_random),
@@ -2,6 +2,7 @@
 #include <linux/cred.h>
 #include <linux/device.h>
 #include <linux/dma-buf.h>
+#include <linux/dma-resv.h>
 #include <linux/highmem.h>
 #include <linux/init.h>
 #include <linux/kernel.h>
@@ -13,6 +14,8 @@
 #include <linux/udmabuf.h>
 #include <linux/hugetlb.h>
 
+#include <uapi/linux/dma-buf.h>
+
 static int list_limit = 1024;
 module_param(list_limit, int, 0644);
 MODULE_PARM_DESC(list_limit, "udmabuf_create_list->count limit. Default is 1024.");
@@ -119,40 +122,89 @@ static void release_udmabuf(struct dma_buf *buf)
 	kfree(ubuf);
 }
 
-static int begin_cpu_udmabuf(struct dma_buf *buf,
-			     enum dma_data_direction direction)
+/*
+ * Sync the part of the DMA mapping backing [offset, offset + len) of the
+ * buffer, the DMA segments covering the buffer in order.
+ */
+static void sync_udmabuf_range(struct udmabuf *ubuf, u64 offset, u64 len,
+			       enum dma_data_direction direction, bool for_cpu)
+{
+	struct device *dev = ubuf->device->this_device;
+	u64 start = 0, end = offset + len, lo, hi;
+	unsigned int seg_len, i;
+	struct scatterlist *sg;
+	dma_addr_t addr;
+
+	for_each_sgtable_dma_sg(ubuf->sg, sg, i) {
+		addr = sg_dma_address(sg);
+		seg_len = sg_dma_len(sg);
+
+		if (offset < start + seg_len) {
+			lo = max(offset, start) - start;
+			hi = min(end, start + seg_len) - start;
+			if (for_cpu)
+				dma_sync_single_range_for_cpu(dev, addr, lo,
+							      hi - lo,
+							      direction);
+			else
+				dma_sync_single_range_for_device(dev, addr, lo,
+								 hi - lo,
+								 direction);
+		}
+
+		start += seg_len;
+		if (start >= end)
+			break;
+	}
+}
+
+static int begin_cpu_udmabuf_range(struct dma_buf *buf,
+				   enum dma_data_direction direction,
+				   u64 offset, u64 len)
 {
 	struct udmabuf *ubuf = buf->priv;
 	struct device *dev = ubuf->device->this_device;
 	int ret = 0;
 
 	if (!ubuf->sg) {
+		/* mapping the whole buffer syncs it all for the device */
 		ubuf->sg = get_sg_table(dev, buf, direction);
 		if (IS_ERR(ubuf->sg)) {
 			ret = PTR_ERR(ubuf->sg);
 			ubuf->sg = NULL;
 		}
 	} else {
-		dma_sync_sg_for_cpu(dev, ubuf->sg->sgl, ubuf->sg->nents,
-				    direction);
+		sync_udmabuf_range(ubuf, offset, len, direction, true);
 	}
 
 	return ret;
 }
 
-static int end_cpu_udmabuf(struct dma_buf *buf,
-			   enum dma_data_direction direction)
+static int end_cpu_udmabuf_range(struct dma_buf *buf,
+				 enum dma_data_direction direction,
+				 u64 offset, u64 len)
 {
 	struct udmabuf *ubuf = buf->priv;
-	struct device *dev = ubuf->device->this_device;
 
 	if (!ubuf->sg)
 		return -EINVAL;
 
-	dma_sync_sg_for_device(dev, ubuf->sg->sgl, ubuf->sg->nents, direction);
+	sync_udmabuf_range(ubuf, offset, len, direction, false);
 	return 0;
 }
 
+static int begin_cpu_udmabuf(struct dma_buf *buf,
+			     enum dma_data_direction direction)
+{
+	return begin_cpu_udmabuf_range(buf, direction, 0, buf->size);
+}
+
+static int end_cpu_udmabuf(struct dma_buf *buf,
+			   enum dma_data_direction direction)
+{
+	return end_cpu_udmabuf_range(buf, direction, 0, buf->size);
+}
+
 static const struct dma_buf_ops udmabuf_ops = {
 	.cache_sgt_mapping = true,
 	.map_dma_buf	   = map_udmabuf,
@@ -336,6 +388,86 @@ static long udmabuf_ioctl_create_list(struct file *filp, unsigned long arg)
 	return ret;
 }
 
+static long udmabuf_ioctl_sync_ranges(struct file *filp, unsigned long arg)
+{
+	struct udmabuf_sync_ranges head;
+	struct udmabuf_sync_range *ranges;
+	enum dma_data_direction direction;
+	struct dma_buf *buf;
+	bool write;
+	u32 i;
+	long ret;
+
+	if (copy_from_user(&head, (void __user *)arg, sizeof(head)))
+		return -EFAULT;
+
+	if (head.flags & ~DMA_BUF_SYNC_VALID_FLAGS_MASK || head.__pad ||
+	    !head.count || head.count > list_limit)
+		return -EINVAL;
+
+	switch (head.flags & DMA_BUF_SYNC_RW) {
+	case DMA_BUF_SYNC_READ:
+		direction = DMA_FROM_DEVICE;
+		break;
+	case DMA_BUF_SYNC_WRITE:
+		direction = DMA_TO_DEVICE;
+		break;
+	case DMA_BUF_SYNC_RW:
+		direction = DMA_BIDIRECTIONAL;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	ranges = memdup_user(u64_to_user_ptr(head.ranges),
+			     array_size(head.count, sizeof(*ranges)));
+	if (IS_ERR(ranges))
+		return PTR_ERR(ranges);
+
+	buf = dma_buf_get(head.fd);
+	if (IS_ERR(buf)) {
+		ret = PTR_ERR(buf);
+		goto out_free;
+	}
+
+	ret = -EINVAL;
+	if (buf->ops != &udmabuf_ops)
+		goto out_put;
+
+	for (i = 0; i < head.count; i++)
+		if (ranges[i].offset > buf->size ||
+		    ranges[i].size > buf->size - ranges[i].offset)
+			goto out_put;
+
+	if (!(head.flags & DMA_BUF_SYNC_END)) {
+		/* as dma_buf_begin_cpu_access(), wait for implicit fences */
+		write = direction != DMA_FROM_DEVICE;
+		ret = dma_resv_wait_timeout(buf->resv,
+					    dma_resv_usage_rw(write), true,
+					    MAX_SCHEDULE_TIMEOUT);
+		if (ret < 0)
+			goto out_put;
+	}
+
+	ret = 0;
+	for (i = 0; i < head.count && !ret; i++) {
+		if (head.flags & DMA_BUF_SYNC_END)
+			ret = end_cpu_udmabuf_range(buf, direction,
+						    ranges[i].offset,
+						    ranges[i].size);
+		else
+			ret = begin_cpu_udmabuf_range(buf, direction,
+						      ranges[i].offset,
+						      ranges[i].size);
+	}
+
+out_put:
+	dma_buf_put(buf);
+out_free:
+	kfree(ranges);
+	return ret;
+}
+
 static long udmabuf_ioctl(struct file *filp, unsigned int ioctl,
 			  unsigned long arg)
 {
@@ -348,6 +480,9 @@ static long udmabuf_ioctl(struct file *filp, unsigned int ioctl,
 	case UDMABUF_CREATE_LIST:
 		ret = udmabuf_ioctl_create_list(filp, arg);
 		break;
+	case UDMABUF_SYNC_RANGES:
+		ret = udmabuf_ioctl_sync_ranges(filp, arg);
+		break;
 	default:
 		ret = -ENOTTY;
 		break;
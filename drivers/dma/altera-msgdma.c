@@ -9,6 +9,7 @@
  */
 
 #include <linux/bitops.h>
+#include <linux/cpuidle.h>
 #include <linux/delay.h>
 #include <linux/dma-mapping.h>
 #include <linux/dmapool.h>
@@ -18,6 +19,7 @@
 #include <linux/iopoll.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/of_dma.h>
 
@@ -26,6 +28,12 @@
 #define MSGDMA_MAX_TRANS_LEN		U32_MAX
 #define MSGDMA_DESC_NUM			1024
 
+/*
+ * Maximum number of responses handled per tasklet run, the interrupt stays
+ * masked while the response FIFO holds more.
+ */
+#define MSGDMA_POLL_BUDGET		64
+
 /**
  * struct msgdma_extended_desc - implements an extended descriptor
  * @read_addr_lo: data buffer source address low bits
@@ -51,6 +59,46 @@ struct msgdma_extended_desc {
 	u32 control;
 };
 
+/**
+ * struct msgdma_pref_desc - implements a descriptor of the prefetcher
+ * @read_addr_lo: data buffer source address low bits
+ * @write_addr_lo: data buffer destination address low bits
+ * @len: the number of bytes to transfer per descriptor
+ * @next_desc_lo: next descriptor address low bits
+ * @bytes_transferred: written back by the prefetcher
+ * @status: written back by the prefetcher, same bits as the response status
+ * @reserved_18: reserved
+ * @burst_seq_num: bit 31:24 write burst
+ *		   bit 23:16 read burst
+ *		   bit 15:00 sequence number
+ * @stride: bit 31:16 write stride
+ *	    bit 15:00 read stride
+ * @read_addr_hi: data buffer source address high bits
+ * @write_addr_hi: data buffer destination address high bits
+ * @next_desc_hi: next descriptor address high bits
+ * @reserved_30: reserved
+ * @control: characteristics of the transfer
+ *
+ * The prefetcher walks a list of these in memory, clearing the owned by
+ * hardware bit of each descriptor once processed.
+ */
+struct msgdma_pref_desc {
+	u32 read_addr_lo;
+	u32 write_addr_lo;
+	u32 len;
+	u32 next_desc_lo;
+	u32 bytes_transferred;
+	u32 status;
+	u32 reserved_18;
+	u32 burst_seq_num;
+	u32 stride;
+	u32 read_addr_hi;
+	u32 write_addr_hi;
+	u32 next_desc_hi;
+	u32 reserved_30[3];
+	u32 control;
+};
+
 /* mSGDMA descriptor control field bit definitions */
 #define MSGDMA_DESC_CTL_SET_CH(x)	((x) & 0xff)
 #define MSGDMA_DESC_CTL_GEN_SOP		BIT(8)
@@ -64,6 +112,9 @@ struct msgdma_extended_desc {
 #define MSGDMA_DESC_CTL_TR_ERR_IRQ	GENMASK(23, 16)
 #define MSGDMA_DESC_CTL_EARLY_DONE	BIT(24)
 
+/* Prefetcher descriptors only, cleared by the prefetcher once processed */
+#define MSGDMA_DESC_CTL_OWN_BY_HW	BIT(30)
+
 /*
  * Writing "1" the "go" bit commits the entire descriptor into the
  * descriptor FIFO(s)
@@ -142,6 +193,25 @@ struct msgdma_extended_desc {
 
 #define MSGDMA_CSR_SEQ_NUM_GET(v)		(((v) & 0xffff0000) >> 16)
 
+/* mSGDMA prefetcher register map */
+#define MSGDMA_PREF_CONTROL		0x00
+#define MSGDMA_PREF_NEXT_DESC_LO	0x04
+#define MSGDMA_PREF_NEXT_DESC_HI	0x08
+#define MSGDMA_PREF_POLL_FREQ		0x0c
+#define MSGDMA_PREF_STATUS		0x10
+
+/* mSGDMA prefetcher control and status register bit definitions */
+#define MSGDMA_PREF_CTL_RUN			BIT(0)
+#define MSGDMA_PREF_CTL_DESC_POLL_EN		BIT(1)
+#define MSGDMA_PREF_CTL_RESET			BIT(2)
+#define MSGDMA_PREF_CTL_GLOBAL_INTR		BIT(3)
+#define MSGDMA_PREF_CTL_PARK			BIT(4)
+
+#define MSGDMA_PREF_STAT_IRQ			BIT(0)
+
+/* Prefetcher clock cycles between two fetches of the chain tail */
+#define MSGDMA_PREF_POLL_CYCLES			256
+
 /* mSGDMA response register map */
 #define MSGDMA_RESP_BYTES_TRANSFERRED	0x00
 #define MSGDMA_RESP_STATUS		0x04
@@ -156,12 +226,18 @@ struct msgdma_extended_desc {
  * @hw_desc: assosiated HW descriptor
  * @node: node to move from the free list to the tx list
  * @tx_list: transmit list node
+ * @pref_desc: assosiated prefetcher descriptor, when there is a prefetcher
+ * @pref_phys: bus address of @pref_desc
+ * @cyclic: the transaction is cyclic, its descriptors are one period each
  */
 struct msgdma_sw_desc {
 	struct dma_async_tx_descriptor async_tx;
 	struct msgdma_extended_desc hw_desc;
 	struct list_head node;
 	struct list_head tx_list;
+	struct msgdma_pref_desc *pref_desc;
+	dma_addr_t pref_phys;
+	bool cyclic;
 };
 
 /*
@@ -184,9 +260,25 @@ struct msgdma_device {
 	struct msgdma_sw_desc *sw_desq;
 	unsigned int npendings;
 
+	/* Prefetcher descriptors, plus the one ending the chain */
+	struct msgdma_pref_desc *pref_desq;
+	struct msgdma_pref_desc *pref_tail;
+	dma_addr_t pref_tail_phys;
+	bool pref_running;
+
+	/* Running cyclic transaction and its next period to complete */
+	struct msgdma_sw_desc *cyclic;
+	struct msgdma_sw_desc *cyclic_next;
+
 	struct dma_slave_config slave_cfg;
 
+	/* Completion time estimate of the first transaction started idle */
+	ktime_t xfer_start;
+	size_t xfer_bytes;
+	u64 xfer_ns_per_kib;
+
 	int irq;
+	int irq_cpu;
 
 	/* mSGDMA controller */
 	void __iomem *csr;
@@ -196,6 +288,9 @@ struct msgdma_device {
 
 	/* mSGDMA response */
 	void __iomem *resp;
+
+	/* mSGDMA descriptor prefetcher */
+	void __iomem *pref;
 };
 
 #define to_mdev(chan)	container_of(chan, struct msgdma_device, dmachan)
@@ -218,6 +313,7 @@ static struct msgdma_sw_desc *msgdma_get_descriptor(struct msgdma_device *mdev)
 	spin_unlock_irqrestore(&mdev->lock, flags);
 
 	INIT_LIST_HEAD(&desc->tx_list);
+	desc->cyclic = false;
 
 	return desc;
 }
@@ -458,6 +554,168 @@ msgdma_prep_slave_sg(struct dma_chan *dchan, struct scatterlist *sgl,
 	return &first->async_tx;
 }
 
+/**
+ * msgdma_prep_dma_cyclic - prepare descriptors for a cyclic transaction
+ *
+ * @dchan: DMA channel
+ * @buf_addr: Buffer address
+ * @buf_len: Buffer length, a multiple of @period_len
+ * @period_len: Period length
+ * @dir: DMA transfer direction
+ * @flags: transfer ack flags
+ *
+ * Each period gets a descriptor raising the completion interrupt, which is
+ * given back to the controller once its callback is scheduled.
+ *
+ * Return: Async transaction descriptor on success and NULL on failure
+ */
+static struct dma_async_tx_descriptor *
+msgdma_prep_dma_cyclic(struct dma_chan *dchan, dma_addr_t buf_addr,
+		       size_t buf_len, size_t period_len,
+		       enum dma_transfer_direction dir, unsigned long flags)
+{
+	struct msgdma_device *mdev = to_mdev(dchan);
+	struct dma_slave_config *cfg = &mdev->slave_cfg;
+	struct msgdma_sw_desc *new, *first = NULL;
+	struct msgdma_extended_desc *desc;
+	dma_addr_t dma_dst, dma_src;
+	unsigned long irqflags;
+	u32 desc_cnt, stride;
+
+	if (dir != DMA_MEM_TO_DEV && dir != DMA_DEV_TO_MEM)
+		return NULL;
+
+	if (!period_len || period_len > MSGDMA_MAX_TRANS_LEN ||
+	    buf_len % period_len)
+		return NULL;
+
+	desc_cnt = buf_len / period_len;
+
+	spin_lock_irqsave(&mdev->lock, irqflags);
+	if (desc_cnt > mdev->desc_free_cnt) {
+		spin_unlock_irqrestore(&mdev->lock, irqflags);
+		dev_dbg(mdev->dev, "mdev %p descs are not available\n", mdev);
+		return NULL;
+	}
+	mdev->desc_free_cnt -= desc_cnt;
+	spin_unlock_irqrestore(&mdev->lock, irqflags);
+
+	while (desc_cnt--) {
+		/* Allocate and populate the descriptor */
+		new = msgdma_get_descriptor(mdev);
+
+		desc = &new->hw_desc;
+		if (dir == DMA_MEM_TO_DEV) {
+			dma_src = buf_addr;
+			dma_dst = cfg->dst_addr;
+			stride = MSGDMA_DESC_STRIDE_RD;
+		} else {
+			dma_src = cfg->src_addr;
+			dma_dst = buf_addr;
+			stride = MSGDMA_DESC_STRIDE_WR;
+		}
+		msgdma_desc_config(desc, dma_dst, dma_src, period_len, stride);
+		msgdma_desc_config_eod(desc);
+		buf_addr += period_len;
+
+		if (!first)
+			first = new;
+		else
+			list_add_tail(&new->node, &first->tx_list);
+	}
+
+	first->cyclic = true;
+	first->async_tx.flags = flags;
+
+	return &first->async_tx;
+}
+
+/**
+ * msgdma_prep_interleaved_dma - prepare descriptors for an interleaved
+ * transaction
+ *
+ * @dchan: DMA channel
+ * @xt: Interleaved transfer template
+ * @flags: transfer ack flags
+ *
+ * Every chunk of every frame gets its own descriptor, the gaps between the
+ * chunks being skipped by the addresses of the following descriptor.
+ *
+ * Return: Async transaction descriptor on success and NULL on failure
+ */
+static struct dma_async_tx_descriptor *
+msgdma_prep_interleaved_dma(struct dma_chan *dchan,
+			    struct dma_interleaved_template *xt,
+			    unsigned long flags)
+{
+	struct msgdma_device *mdev = to_mdev(dchan);
+	struct msgdma_sw_desc *new, *first = NULL;
+	struct msgdma_extended_desc *desc = NULL;
+	dma_addr_t dma_dst, dma_src;
+	unsigned long irqflags;
+	size_t i, j, desc_cnt;
+	u32 stride = 0;
+
+	if (xt->dir != DMA_MEM_TO_MEM || !xt->numf || !xt->frame_size)
+		return NULL;
+
+	for (j = 0; j < xt->frame_size; j++)
+		if (!xt->sgl[j].size ||
+		    xt->sgl[j].size > MSGDMA_MAX_TRANS_LEN)
+			return NULL;
+
+	/* A fixed address is a zero stride */
+	if (xt->src_inc)
+		stride |= MSGDMA_DESC_STRIDE_RD;
+	if (xt->dst_inc)
+		stride |= MSGDMA_DESC_STRIDE_WR;
+
+	desc_cnt = xt->numf * xt->frame_size;
+
+	spin_lock_irqsave(&mdev->lock, irqflags);
+	if (desc_cnt > mdev->desc_free_cnt) {
+		spin_unlock_irqrestore(&mdev->lock, irqflags);
+		dev_dbg(mdev->dev, "mdev %p descs are not available\n", mdev);
+		return NULL;
+	}
+	mdev->desc_free_cnt -= desc_cnt;
+	spin_unlock_irqrestore(&mdev->lock, irqflags);
+
+	dma_src = xt->src_start;
+	dma_dst = xt->dst_start;
+
+	for (i = 0; i < xt->numf; i++) {
+		for (j = 0; j < xt->frame_size; j++) {
+			struct data_chunk *chunk = &xt->sgl[j];
+
+			/* Allocate and populate the descriptor */
+			new = msgdma_get_descriptor(mdev);
+
+			desc = &new->hw_desc;
+			msgdma_desc_config(desc, dma_dst, dma_src,
+					   chunk->size, stride);
+
+			if (xt->src_inc)
+				dma_src += chunk->size +
+					   dmaengine_get_src_icg(xt, chunk);
+			if (xt->dst_inc)
+				dma_dst += chunk->size +
+					   dmaengine_get_dst_icg(xt, chunk);
+
+			if (!first)
+				first = new;
+			else
+				list_add_tail(&new->node, &first->tx_list);
+		}
+	}
+
+	msgdma_desc_config_eod(desc);
+	async_tx_ack(&first->async_tx);
+	first->async_tx.flags = flags;
+
+	return &first->async_tx;
+}
+
 static int msgdma_dma_config(struct dma_chan *dchan,
 			     struct dma_slave_config *config)
 {
@@ -473,13 +731,28 @@ static void msgdma_reset(struct msgdma_device *mdev)
 	u32 val;
 	int ret;
 
+	/* Reset the prefetcher first, so it stops feeding the dispatcher */
+	if (mdev->pref) {
+		iowrite32(MSGDMA_PREF_CTL_RESET,
+			  mdev->pref + MSGDMA_PREF_CONTROL);
+
+		ret = readl_poll_timeout_atomic(mdev->pref +
+						MSGDMA_PREF_CONTROL, val,
+						(val & MSGDMA_PREF_CTL_RESET) == 0,
+						1, 10000);
+		if (ret)
+			dev_err(mdev->dev, "DMA prefetcher did not reset\n");
+
+		iowrite32(MSGDMA_PREF_STAT_IRQ, mdev->pref + MSGDMA_PREF_STATUS);
+	}
+
 	/* Reset mSGDMA */
 	iowrite32(MSGDMA_CSR_STAT_MASK, mdev->csr + MSGDMA_CSR_STATUS);
 	iowrite32(MSGDMA_CSR_CTL_RESET, mdev->csr + MSGDMA_CSR_CONTROL);
 
-	ret = readl_poll_timeout(mdev->csr + MSGDMA_CSR_STATUS, val,
-				 (val & MSGDMA_CSR_STAT_RESETTING) == 0,
-				 1, 10000);
+	ret = readl_poll_timeout_atomic(mdev->csr + MSGDMA_CSR_STATUS, val,
+					(val & MSGDMA_CSR_STAT_RESETTING) == 0,
+					1, 10000);
 	if (ret)
 		dev_err(mdev->dev, "DMA channel did not reset\n");
 
@@ -491,6 +764,7 @@ static void msgdma_reset(struct msgdma_device *mdev)
 		  MSGDMA_CSR_CTL_GLOBAL_INTR, mdev->csr + MSGDMA_CSR_CONTROL);
 
 	mdev->idle = true;
+	mdev->pref_running = false;
 };
 
 static void msgdma_copy_one(struct msgdma_device *mdev,
@@ -542,15 +816,172 @@ static void msgdma_copy_desc_to_fifo(struct msgdma_device *mdev,
 		msgdma_copy_one(mdev, sdesc);
 }
 
+/**
+ * msgdma_pref_fill - Set up the prefetcher descriptor of a sw descriptor
+ * @desc: Descriptor pointer
+ * @next: Bus address of the next prefetcher descriptor
+ *
+ * The control word is written last, once the rest of the descriptor is
+ * visible to the prefetcher.
+ */
+static void msgdma_pref_fill(struct msgdma_sw_desc *desc, dma_addr_t next)
+{
+	struct msgdma_extended_desc *hw = &desc->hw_desc;
+	struct msgdma_pref_desc *pd = desc->pref_desc;
+
+	pd->read_addr_lo = hw->read_addr_lo;
+	pd->write_addr_lo = hw->write_addr_lo;
+	pd->len = hw->len;
+	pd->next_desc_lo = lower_32_bits(next);
+	pd->bytes_transferred = 0;
+	pd->status = 0;
+	pd->burst_seq_num = hw->burst_seq_num;
+	pd->stride = hw->stride;
+	pd->read_addr_hi = hw->read_addr_hi;
+	pd->write_addr_hi = hw->write_addr_hi;
+	pd->next_desc_hi = upper_32_bits(next);
+
+	dma_wmb();
+	WRITE_ONCE(pd->control, hw->control | MSGDMA_DESC_CTL_OWN_BY_HW);
+}
+
+/**
+ * msgdma_pref_append - Hand a list of transactions to the prefetcher
+ * @mdev: Pointer to the Altera mSGDMA device structure
+ * @list: Transactions to run, in order
+ * @cyclic: Link the last descriptor back to the first one
+ *
+ * The descriptors are chained in memory. The chain always ends on the tail
+ * descriptor, not owned by the hardware, which the prefetcher polls: the
+ * first new descriptor takes the place of the tail, the slot it leaves
+ * becoming the new tail, so the chain grows while the prefetcher runs and
+ * a whole list is handed over by the write of a single control word.
+ */
+static void msgdma_pref_append(struct msgdma_device *mdev,
+			       struct list_head *list, bool cyclic)
+{
+	struct msgdma_sw_desc *desc, *child, *prev, *first;
+	dma_addr_t first_next = 0;
+
+	first = list_first_entry_or_null(list, struct msgdma_sw_desc, node);
+	if (!first)
+		return;
+
+	swap(first->pref_desc, mdev->pref_tail);
+	swap(first->pref_phys, mdev->pref_tail_phys);
+	memset(mdev->pref_tail, 0, sizeof(*mdev->pref_tail));
+
+	/*
+	 * Everything but the first descriptor is only reachable through it,
+	 * so it is the one armed last.
+	 */
+	prev = NULL;
+	list_for_each_entry(desc, list, node) {
+		if (prev == first)
+			first_next = desc->pref_phys;
+		else if (prev)
+			msgdma_pref_fill(prev, desc->pref_phys);
+		prev = desc;
+
+		list_for_each_entry(child, &desc->tx_list, node) {
+			if (prev == first)
+				first_next = child->pref_phys;
+			else
+				msgdma_pref_fill(prev, child->pref_phys);
+			prev = child;
+		}
+	}
+
+	if (prev == first)
+		first_next = cyclic ? first->pref_phys : mdev->pref_tail_phys;
+	else
+		msgdma_pref_fill(prev, cyclic ? first->pref_phys :
+				 mdev->pref_tail_phys);
+	msgdma_pref_fill(first, first_next);
+
+	mdev->idle = false;
+	if (mdev->pref_running)
+		return;
+
+	/* Start polling the chain from its first descriptor */
+	wmb();
+	iowrite32(lower_32_bits(first->pref_phys),
+		  mdev->pref + MSGDMA_PREF_NEXT_DESC_LO);
+	iowrite32(upper_32_bits(first->pref_phys),
+		  mdev->pref + MSGDMA_PREF_NEXT_DESC_HI);
+	iowrite32(MSGDMA_PREF_POLL_CYCLES, mdev->pref + MSGDMA_PREF_POLL_FREQ);
+	iowrite32(MSGDMA_PREF_CTL_RUN | MSGDMA_PREF_CTL_DESC_POLL_EN |
+		  MSGDMA_PREF_CTL_GLOBAL_INTR,
+		  mdev->pref + MSGDMA_PREF_CONTROL);
+	mdev->pref_running = true;
+}
+
+/**
+ * msgdma_expect_done - Announce when the first started transaction ends
+ * @mdev: Pointer to the Altera mSGDMA device structure
+ * @desc: First transaction started on the idle controller
+ *
+ * Once the transfer rate is known from earlier transactions, the CPU taking
+ * the interrupts is told when this one is going to raise it, so it doesn't
+ * enter an idle state it couldn't leave in time.
+ */
+static void msgdma_expect_done(struct msgdma_device *mdev,
+			       struct msgdma_sw_desc *desc)
+{
+	struct msgdma_sw_desc *child;
+	u64 eta;
+
+	mdev->xfer_bytes = desc->hw_desc.len;
+	list_for_each_entry(child, &desc->tx_list, node)
+		mdev->xfer_bytes += child->hw_desc.len;
+	mdev->xfer_start = ktime_get();
+
+	if (!mdev->xfer_ns_per_kib || mdev->irq_cpu < 0)
+		return;
+
+	eta = div_u64((u64)mdev->xfer_bytes * mdev->xfer_ns_per_kib, SZ_1K);
+	cpuidle_expect_wakeup(mdev->irq_cpu,
+			      ktime_add_ns(mdev->xfer_start, eta));
+}
+
+/**
+ * msgdma_xfer_done - Update the transfer rate estimate
+ * @mdev: Pointer to the Altera mSGDMA device structure
+ *
+ * Called from the interrupt ending the transaction given to
+ * msgdma_expect_done(), the estimate is a running average.
+ */
+static void msgdma_xfer_done(struct msgdma_device *mdev)
+{
+	u64 ns_per_kib;
+
+	mdev->irq_cpu = smp_processor_id();
+	if (!mdev->xfer_bytes)
+		return;
+
+	ns_per_kib = div_u64(ktime_to_ns(ktime_sub(ktime_get(),
+						   mdev->xfer_start)) * SZ_1K,
+			     mdev->xfer_bytes);
+	if (mdev->xfer_ns_per_kib)
+		ns_per_kib = (3 * mdev->xfer_ns_per_kib + ns_per_kib) / 4;
+	mdev->xfer_ns_per_kib = ns_per_kib;
+	mdev->xfer_bytes = 0;
+}
+
 /**
  * msgdma_start_transfer - Initiate the new transfer
  * @mdev: Pointer to the Altera mSGDMA device structure
+ *
+ * A cyclic transaction runs alone, until it is terminated. The prefetcher
+ * takes new transactions while running, the descriptor FIFO once idle.
  */
 static void msgdma_start_transfer(struct msgdma_device *mdev)
 {
-	struct msgdma_sw_desc *desc;
+	struct msgdma_sw_desc *desc, *next;
+	bool idle = mdev->idle;
+	LIST_HEAD(list);
 
-	if (!mdev->idle)
+	if ((!mdev->idle && !mdev->pref) || mdev->cyclic)
 		return;
 
 	desc = list_first_entry_or_null(&mdev->pending_list,
@@ -558,8 +989,44 @@ static void msgdma_start_transfer(struct msgdma_device *mdev)
 	if (!desc)
 		return;
 
-	list_splice_tail_init(&mdev->pending_list, &mdev->active_list);
-	msgdma_copy_desc_to_fifo(mdev, desc);
+	if (desc->cyclic) {
+		list_move_tail(&desc->node, &list);
+		mdev->cyclic = desc;
+		mdev->cyclic_next = desc;
+	} else {
+		list_for_each_entry_safe(desc, next, &mdev->pending_list,
+					 node) {
+			if (desc->cyclic)
+				break;
+			list_move_tail(&desc->node, &list);
+		}
+	}
+
+	if (mdev->pref) {
+		msgdma_pref_append(mdev, &list, mdev->cyclic);
+	} else {
+		list_for_each_entry(desc, &list, node)
+			msgdma_copy_desc_to_fifo(mdev, desc);
+	}
+
+	if (idle && !mdev->cyclic)
+		msgdma_expect_done(mdev, list_first_entry(&list,
+							  struct msgdma_sw_desc,
+							  node));
+
+	list_splice_tail(&list, &mdev->active_list);
+}
+
+/**
+ * msgdma_hw_idle - Check whether the controller is done
+ * @mdev: Pointer to the Altera mSGDMA device structure
+ *
+ * Return: True when the dispatcher is stopped
+ */
+static bool msgdma_hw_idle(struct msgdma_device *mdev)
+{
+	return !(ioread32(mdev->csr + MSGDMA_CSR_STATUS) &
+		 MSGDMA_CSR_STAT_BUSY);
 }
 
 /**
@@ -579,24 +1046,31 @@ static void msgdma_issue_pending(struct dma_chan *chan)
 /**
  * msgdma_chan_desc_cleanup - Cleanup the completed descriptors
  * @mdev: Pointer to the Altera mSGDMA device structure
+ *
+ * The callbacks of all the completed descriptors are invoked in one go,
+ * with the lock dropped once for the whole batch.
  */
 static void msgdma_chan_desc_cleanup(struct msgdma_device *mdev)
 {
 	struct msgdma_sw_desc *desc, *next;
+	LIST_HEAD(done);
 
-	list_for_each_entry_safe(desc, next, &mdev->done_list, node) {
-		struct dmaengine_desc_callback cb;
+	list_splice_tail_init(&mdev->done_list, &done);
+	if (list_empty(&done))
+		return;
 
-		list_del(&desc->node);
+	spin_unlock(&mdev->lock);
+	list_for_each_entry(desc, &done, node) {
+		struct dmaengine_desc_callback cb;
 
 		dmaengine_desc_get_callback(&desc->async_tx, &cb);
-		if (dmaengine_desc_callback_valid(&cb)) {
-			spin_unlock(&mdev->lock);
-			dmaengine_desc_callback_invoke(&cb, NULL);
-			spin_lock(&mdev->lock);
-		}
+		dmaengine_desc_callback_invoke(&cb, NULL);
+	}
+	spin_lock(&mdev->lock);
 
-		/* Run any dependencies, then free the descriptor */
+	/* Run any dependencies, then free the descriptors */
+	list_for_each_entry_safe(desc, next, &done, node) {
+		list_del(&desc->node);
 		msgdma_free_descriptor(mdev, desc);
 	}
 }
@@ -618,6 +1092,108 @@ static void msgdma_complete_descriptor(struct msgdma_device *mdev)
 	list_add_tail(&desc->node, &mdev->done_list);
 }
 
+/**
+ * msgdma_last_descriptor - Get the last descriptor of a transaction
+ * @desc: Transaction descriptor pointer
+ *
+ * Return: The descriptor raising the completion interrupt
+ */
+static struct msgdma_sw_desc *
+msgdma_last_descriptor(struct msgdma_sw_desc *desc)
+{
+	if (list_empty(&desc->tx_list))
+		return desc;
+
+	return list_last_entry(&desc->tx_list, struct msgdma_sw_desc, node);
+}
+
+/**
+ * msgdma_pref_complete - Complete the transactions done by the prefetcher
+ * @mdev: Pointer to the Altera mSGDMA device structure
+ */
+static void msgdma_pref_complete(struct msgdma_device *mdev)
+{
+	struct msgdma_sw_desc *desc, *last;
+
+	while ((desc = list_first_entry_or_null(&mdev->active_list,
+						struct msgdma_sw_desc, node))) {
+		if (desc->cyclic)
+			break;
+
+		last = msgdma_last_descriptor(desc);
+		if (READ_ONCE(last->pref_desc->control) &
+		    MSGDMA_DESC_CTL_OWN_BY_HW)
+			break;
+
+		msgdma_complete_descriptor(mdev);
+	}
+}
+
+/**
+ * msgdma_cyclic_active - Check whether the cyclic transaction is running
+ * @mdev: Pointer to the Altera mSGDMA device structure
+ *
+ * Return: True once the transactions queued before it are all completed
+ */
+static bool msgdma_cyclic_active(struct msgdma_device *mdev)
+{
+	return mdev->cyclic &&
+	       list_first_entry_or_null(&mdev->active_list,
+					struct msgdma_sw_desc, node) ==
+	       mdev->cyclic;
+}
+
+/**
+ * msgdma_cyclic_period_done - Give the completed period back to the hardware
+ * @mdev: Pointer to the Altera mSGDMA device structure
+ */
+static void msgdma_cyclic_period_done(struct msgdma_device *mdev)
+{
+	struct msgdma_sw_desc *cyclic = mdev->cyclic;
+	struct msgdma_sw_desc *desc = mdev->cyclic_next;
+
+	if (mdev->pref) {
+		dma_wmb();
+		WRITE_ONCE(desc->pref_desc->control,
+			   desc->hw_desc.control | MSGDMA_DESC_CTL_OWN_BY_HW);
+	} else {
+		msgdma_copy_one(mdev, desc);
+	}
+
+	if (desc == cyclic)
+		desc = list_first_entry_or_null(&cyclic->tx_list,
+						struct msgdma_sw_desc, node);
+	else if (list_is_last(&desc->node, &cyclic->tx_list))
+		desc = NULL;
+	else
+		desc = list_next_entry(desc, node);
+
+	mdev->cyclic_next = desc ? desc : cyclic;
+}
+
+/**
+ * msgdma_cyclic_callback - Run the callback of the completed periods
+ * @mdev: Pointer to the Altera mSGDMA device structure
+ * @periods: Number of periods completed
+ */
+static void msgdma_cyclic_callback(struct msgdma_device *mdev,
+				   unsigned int periods)
+{
+	struct dmaengine_desc_callback cb;
+
+	if (!periods)
+		return;
+
+	dmaengine_desc_get_callback(&mdev->cyclic->async_tx, &cb);
+	if (!dmaengine_desc_callback_valid(&cb))
+		return;
+
+	spin_unlock(&mdev->lock);
+	while (periods--)
+		dmaengine_desc_callback_invoke(&cb, NULL);
+	spin_lock(&mdev->lock);
+}
+
 /**
  * msgdma_free_descriptors - Free channel descriptors
  * @mdev: Pointer to the Altera mSGDMA device structure
@@ -642,6 +1218,44 @@ static void msgdma_free_chan_resources(struct dma_chan *dchan)
 	msgdma_free_descriptors(mdev);
 	spin_unlock_irqrestore(&mdev->lock, flags);
 	kfree(mdev->sw_desq);
+
+	if (mdev->pref_desq)
+		dma_free_coherent(mdev->dev, (MSGDMA_DESC_NUM + 1) *
+				  sizeof(*mdev->pref_desq), mdev->pref_desq,
+				  mdev->hw_desq);
+	mdev->pref_desq = NULL;
+}
+
+/**
+ * msgdma_terminate_all - Abort all the transactions of the channel
+ * @dchan: DMA channel pointer
+ *
+ * Return: Always '0'
+ */
+static int msgdma_terminate_all(struct dma_chan *dchan)
+{
+	struct msgdma_device *mdev = to_mdev(dchan);
+	unsigned long flags;
+
+	spin_lock_irqsave(&mdev->lock, flags);
+	msgdma_reset(mdev);
+	mdev->cyclic = NULL;
+	mdev->cyclic_next = NULL;
+	msgdma_free_descriptors(mdev);
+	spin_unlock_irqrestore(&mdev->lock, flags);
+
+	return 0;
+}
+
+/**
+ * msgdma_synchronize - Wait for the callbacks of the channel to be done
+ * @dchan: DMA channel pointer
+ */
+static void msgdma_synchronize(struct dma_chan *dchan)
+{
+	struct msgdma_device *mdev = to_mdev(dchan);
+
+	tasklet_kill(&mdev->irq_tasklet);
 }
 
 /**
@@ -660,7 +1274,25 @@ static int msgdma_alloc_chan_resources(struct dma_chan *dchan)
 	if (!mdev->sw_desq)
 		return -ENOMEM;
 
+	if (mdev->pref) {
+		/* The zeroed descriptor past the others is the first tail */
+		mdev->pref_desq = dma_alloc_coherent(mdev->dev,
+						     (MSGDMA_DESC_NUM + 1) *
+						     sizeof(*mdev->pref_desq),
+						     &mdev->hw_desq,
+						     GFP_NOWAIT);
+		if (!mdev->pref_desq) {
+			kfree(mdev->sw_desq);
+			return -ENOMEM;
+		}
+
+		mdev->pref_tail = mdev->pref_desq + MSGDMA_DESC_NUM;
+		mdev->pref_tail_phys = mdev->hw_desq +
+				       MSGDMA_DESC_NUM * sizeof(*mdev->pref_desq);
+	}
+
 	mdev->idle = true;
+	mdev->irq_cpu = -1;
 	mdev->desc_free_cnt = MSGDMA_DESC_NUM;
 
 	INIT_LIST_HEAD(&mdev->free_list);
@@ -669,15 +1301,59 @@ static int msgdma_alloc_chan_resources(struct dma_chan *dchan)
 		desc = mdev->sw_desq + i;
 		dma_async_tx_descriptor_init(&desc->async_tx, &mdev->dmachan);
 		desc->async_tx.tx_submit = msgdma_tx_submit;
+		if (mdev->pref_desq) {
+			desc->pref_desc = mdev->pref_desq + i;
+			desc->pref_phys = mdev->hw_desq +
+					  i * sizeof(*mdev->pref_desq);
+		}
 		list_add_tail(&desc->node, &mdev->free_list);
 	}
 
 	return MSGDMA_DESC_NUM;
 }
 
+/**
+ * msgdma_irq_enable - Unmask or mask the controller interrupt
+ * @mdev: Pointer to the Altera mSGDMA device structure
+ * @enable: True to unmask the interrupt
+ */
+static void msgdma_irq_enable(struct msgdma_device *mdev, bool enable)
+{
+	u32 ctl = ioread32(mdev->csr + MSGDMA_CSR_CONTROL);
+
+	if (enable)
+		ctl |= MSGDMA_CSR_CTL_GLOBAL_INTR;
+	else
+		ctl &= ~MSGDMA_CSR_CTL_GLOBAL_INTR;
+	iowrite32(ctl, mdev->csr + MSGDMA_CSR_CONTROL);
+}
+
+/**
+ * msgdma_resp_count - Number of responses to handle
+ * @mdev: Pointer to the Altera mSGDMA device structure
+ *
+ * Return: The response FIFO fill level, capped to the poll budget
+ */
+static u32 msgdma_resp_count(struct msgdma_device *mdev)
+{
+	u32 count;
+
+	count = MSGDMA_CSR_RESP_FILL_LEVEL_GET(ioread32(mdev->csr +
+					       MSGDMA_CSR_RESP_FILL_LEVEL));
+	dev_dbg(mdev->dev, "%s (%d): response count=%d\n",
+		__func__, __LINE__, count);
+
+	return min_t(u32, count, MSGDMA_POLL_BUDGET);
+}
+
 /**
  * msgdma_tasklet - Schedule completion tasklet
  * @t: Pointer to the Altera sSGDMA channel structure
+ *
+ * With a response port the interrupt is masked by the handler and the
+ * response FIFO is polled here, at most MSGDMA_POLL_BUDGET entries a run,
+ * so that a stream of small transfers completes without an interrupt per
+ * transfer. The interrupt is unmasked once the FIFO is drained.
  */
 static void msgdma_tasklet(struct tasklet_struct *t)
 {
@@ -685,15 +1361,24 @@ static void msgdma_tasklet(struct tasklet_struct *t)
 	u32 count;
 	u32 __maybe_unused size;
 	u32 __maybe_unused status;
+	unsigned int periods = 0;
 	unsigned long flags;
 
 	spin_lock_irqsave(&mdev->lock, flags);
 
-	if (mdev->resp) {
+	if (mdev->pref) {
+		/* The prefetcher writes the status back to the descriptors */
+		count = 0;
+		msgdma_pref_complete(mdev);
+		while (msgdma_cyclic_active(mdev) && periods < MSGDMA_DESC_NUM &&
+		       !(READ_ONCE(mdev->cyclic_next->pref_desc->control) &
+			 MSGDMA_DESC_CTL_OWN_BY_HW)) {
+			msgdma_cyclic_period_done(mdev);
+			periods++;
+		}
+	} else if (mdev->resp) {
 		/* Read number of responses that are available */
-		count = ioread32(mdev->csr + MSGDMA_CSR_RESP_FILL_LEVEL);
-		dev_dbg(mdev->dev, "%s (%d): response count=%d\n",
-			__func__, __LINE__, count);
+		count = msgdma_resp_count(mdev);
 	} else {
 		count = 1;
 	}
@@ -712,8 +1397,35 @@ static void msgdma_tasklet(struct tasklet_struct *t)
 					MSGDMA_RESP_STATUS);
 		}
 
-		msgdma_complete_descriptor(mdev);
-		msgdma_chan_desc_cleanup(mdev);
+		if (msgdma_cyclic_active(mdev)) {
+			msgdma_cyclic_period_done(mdev);
+			periods++;
+		} else {
+			msgdma_complete_descriptor(mdev);
+		}
+	}
+
+	/* The handler can't restart the controller while it is masked */
+	if (mdev->resp && msgdma_hw_idle(mdev)) {
+		mdev->idle = true;
+		msgdma_start_transfer(mdev);
+	}
+
+	msgdma_cyclic_callback(mdev, periods);
+	msgdma_chan_desc_cleanup(mdev);
+
+	if (mdev->resp) {
+		if (msgdma_resp_count(mdev)) {
+			/* Budget exhausted, keep polling */
+			tasklet_schedule(&mdev->irq_tasklet);
+		} else {
+			msgdma_irq_enable(mdev, true);
+			/* Catch a response arrived before the unmask */
+			if (msgdma_resp_count(mdev)) {
+				msgdma_irq_enable(mdev, false);
+				tasklet_schedule(&mdev->irq_tasklet);
+			}
+		}
 	}
 
 	spin_unlock_irqrestore(&mdev->lock, flags);
@@ -729,10 +1441,15 @@ static void msgdma_tasklet(struct tasklet_struct *t)
 static irqreturn_t msgdma_irq_handler(int irq, void *data)
 {
 	struct msgdma_device *mdev = data;
-	u32 status;
 
-	status = ioread32(mdev->csr + MSGDMA_CSR_STATUS);
-	if ((status & MSGDMA_CSR_STAT_BUSY) == 0) {
+	if (mdev->pref)
+		iowrite32(MSGDMA_PREF_STAT_IRQ, mdev->pref + MSGDMA_PREF_STATUS);
+
+	spin_lock(&mdev->lock);
+	msgdma_xfer_done(mdev);
+	spin_unlock(&mdev->lock);
+
+	if (msgdma_hw_idle(mdev)) {
 		/* Start next transfer if the DMA controller is idle */
 		spin_lock(&mdev->lock);
 		mdev->idle = true;
@@ -740,6 +1457,13 @@ static irqreturn_t msgdma_irq_handler(int irq, void *data)
 		spin_unlock(&mdev->lock);
 	}
 
+	/* No more interrupts until the tasklet has drained the responses */
+	if (mdev->resp) {
+		spin_lock(&mdev->lock);
+		msgdma_irq_enable(mdev, false);
+		spin_unlock(&mdev->lock);
+	}
+
 	tasklet_schedule(&mdev->irq_tasklet);
 
 	/* Clear interrupt in mSGDMA controller */
@@ -762,6 +1486,31 @@ static void msgdma_dev_remove(struct msgdma_device *mdev)
 	list_del(&mdev->dmachan.device_node);
 }
 
+/**
+ * msgdma_pref_detect - Check the descriptor prefetcher is there
+ * @mdev: Pointer to the Altera mSGDMA device structure
+ *
+ * Return: True when the prefetcher completes its reset
+ */
+static bool msgdma_pref_detect(struct msgdma_device *mdev)
+{
+	u32 val;
+	int ret;
+
+	iowrite32(MSGDMA_PREF_CTL_RESET, mdev->pref + MSGDMA_PREF_CONTROL);
+
+	ret = readl_poll_timeout(mdev->pref + MSGDMA_PREF_CONTROL, val,
+				 (val & MSGDMA_PREF_CTL_RESET) == 0, 1, 10000);
+	if (ret) {
+		dev_warn(mdev->dev, "no descriptor prefetcher, using the FIFO\n");
+		return false;
+	}
+
+	dev_info(mdev->dev, "using the descriptor prefetcher\n");
+
+	return true;
+}
+
 static int request_and_map(struct platform_device *pdev, const char *name,
 			   struct resource **res, void __iomem **ptr,
 			   bool optional)
@@ -827,11 +1576,23 @@ static int msgdma_probe(struct platform_device *pdev)
 	if (ret)
 		return ret;
 
-	/* Map response space */
-	ret = request_and_map(pdev, "resp", &dma_res, &mdev->resp, true);
+	/* Map descriptor prefetcher space */
+	ret = request_and_map(pdev, "prefetcher", &dma_res, &mdev->pref, true);
 	if (ret)
 		return ret;
 
+	/* Fall back to the descriptor FIFO when no prefetcher answers */
+	if (mdev->pref && !msgdma_pref_detect(mdev))
+		mdev->pref = NULL;
+
+	/* Map response space, which the prefetcher consumes when present */
+	if (!mdev->pref) {
+		ret = request_and_map(pdev, "resp", &dma_res, &mdev->resp,
+				      true);
+		if (ret)
+			return ret;
+	}
+
 	platform_set_drvdata(pdev, mdev);
 
 	/* Get interrupt nr from platform data */
@@ -861,6 +1622,8 @@ static int msgdma_probe(struct platform_device *pdev)
 	dma_cap_zero(dma_dev->cap_mask);
 	dma_cap_set(DMA_MEMCPY, dma_dev->cap_mask);
 	dma_cap_set(DMA_SLAVE, dma_dev->cap_mask);
+	dma_cap_set(DMA_CYCLIC, dma_dev->cap_mask);
+	dma_cap_set(DMA_INTERLEAVE, dma_dev->cap_mask);
 
 	dma_dev->src_addr_widths = BIT(DMA_SLAVE_BUSWIDTH_4_BYTES);
 	dma_dev->dst_addr_widths = BIT(DMA_SLAVE_BUSWIDTH_4_BYTES);
@@ -879,7 +1642,11 @@ static int msgdma_probe(struct platform_device *pdev)
 	dma_dev->copy_align = DMAENGINE_ALIGN_4_BYTES;
 	dma_dev->device_prep_dma_memcpy = msgdma_prep_memcpy;
 	dma_dev->device_prep_slave_sg = msgdma_prep_slave_sg;
+	dma_dev->device_prep_dma_cyclic = msgdma_prep_dma_cyclic;
+	dma_dev->device_prep_interleaved_dma = msgdma_prep_interleaved_dma;
 	dma_dev->device_config = msgdma_dma_config;
+	dma_dev->device_terminate_all = msgdma_terminate_all;
+	dma_dev->device_synchronize = msgdma_synchronize;
 
 	dma_dev->device_alloc_chan_resources = msgdma_alloc_chan_resources;
 	dma_dev->device_free_chan_resources = msgdma_free_chan_resources;
@@ -18,7 +18,9 @@
 #include <linux/module.h>
 #include <linux/moduleparam.h>
 #include <linux/random.h>
+#include <linux/sched.h>
 #include <linux/slab.h>
+#include <linux/sort.h>
 #include <linux/wait.h>
 
 static unsigned int test_buf_size = 16384;
@@ -88,6 +90,18 @@ static bool polled;
 module_param(polled, bool, 0644);
 MODULE_PARM_DESC(polled, "Use polling for completion instead of interrupts");
 
+static bool benchmark;
+module_param(benchmark, bool, 0644);
+MODULE_PARM_DESC(benchmark, "Sweep the transfer size up to test_buf_size and report throughput and latency, without verification (default: off)");
+
+static unsigned int bench_min_size = 64;
+module_param(bench_min_size, uint, 0644);
+MODULE_PARM_DESC(bench_min_size, "Transfer size the benchmark sweep starts from, doubled at each step (default: 64)");
+
+static unsigned int bench_iterations = 1000;
+module_param(bench_iterations, uint, 0644);
+MODULE_PARM_DESC(bench_iterations, "Transfers per size of the benchmark sweep (default: 1000)");
+
 /**
  * struct dmatest_params - test parameters.
  * @buf_size:		size of the memcpy test buffer
@@ -104,6 +118,9 @@ MODULE_PARM_DESC(polled, "Use polling for completion instead of interrupts");
  * @alignment:		custom data address alignment taken as 2^alignment
  * @transfer_size:	custom transfer size in bytes
  * @polled:		use polling for completion instead of interrupts
+ * @benchmark:		sweep the transfer sizes and report the performance
+ * @bench_min_size:	first transfer size of the benchmark sweep
+ * @bench_iterations:	transfers per size of the benchmark sweep
  */
 struct dmatest_params {
 	unsigned int	buf_size;
@@ -120,6 +137,9 @@ struct dmatest_params {
 	int		alignment;
 	unsigned int	transfer_size;
 	bool		polled;
+	bool		benchmark;
+	unsigned int	bench_min_size;
+	unsigned int	bench_iterations;
 };
 
 /**
@@ -212,6 +232,26 @@ struct dmatest_done {
 	wait_queue_head_t	*wait;
 };
 
+/**
+ * struct dmatest_bench - benchmark state of a thread for one transfer size
+ * @size:	transfer size
+ * @runs:	transfers attempted
+ * @count:	transfers completed, with their latency in @lat
+ * @lat:	completion latencies in ns
+ * @len:	bytes transferred
+ * @start:	wall clock at the start of the size
+ * @exec_start:	CPU time of the thread at the start of the size
+ */
+struct dmatest_bench {
+	unsigned int	size;
+	unsigned int	runs;
+	unsigned int	count;
+	u64		*lat;
+	unsigned long long len;
+	ktime_t		start;
+	u64		exec_start;
+};
+
 struct dmatest_data {
 	u8		**raw;
 	u8		**aligned;
@@ -503,6 +543,48 @@ static unsigned long long dmatest_KBs(s64 runtime, unsigned long long len)
 	return FIXPT_TO_INT(dmatest_persec(runtime, len >> 10));
 }
 
+static void dmatest_bench_start(struct dmatest_bench *b, unsigned int size)
+{
+	b->size = size;
+	b->runs = 0;
+	b->count = 0;
+	b->len = 0;
+	b->start = ktime_get();
+	b->exec_start = current->se.sum_exec_runtime;
+}
+
+/*
+ * One line of key=value pairs per thread and size, so that the results of
+ * runs with different channel and thread counts can be collected by scripts.
+ */
+static void dmatest_bench_report(struct dmatest_bench *b,
+				 struct dmatest_thread *thread)
+{
+	struct dmatest_params *params = &thread->info->params;
+	s64 wall = ktime_to_ns(ktime_sub(ktime_get(), b->start));
+	u64 exec = current->se.sum_exec_runtime - b->exec_start;
+	unsigned long long mbs;
+
+	if (!b->count || wall <= 0)
+		return;
+
+	sort_u64(b->lat, b->count);
+
+	/* bytes per us is MB/s, kept with two decimals */
+	mbs = div64_u64(b->len * 100 * NSEC_PER_USEC, wall);
+
+	pr_info("%s: bench chan=%s channels=%u threads=%u size=%u xfers=%u failures=%u MBps=%llu.%02llu lat_p50_ns=%llu lat_p99_ns=%llu lat_p999_ns=%llu cpu_pct=%llu\n",
+		current->comm, dma_chan_name(thread->chan),
+		thread->info->nr_channels, params->threads_per_chan, b->size,
+		b->count, b->runs - b->count, mbs / 100, mbs % 100,
+		sorted_percentile_u64(b->lat, b->count, 500),
+		sorted_percentile_u64(b->lat, b->count, 990),
+		sorted_percentile_u64(b->lat, b->count, 999),
+		div64_u64(exec * 100, wall));
+
+	b->count = 0;
+}
+
 static void __dmatest_free_test_data(struct dmatest_data *d, unsigned int cnt)
 {
 	unsigned int i;
@@ -595,6 +677,8 @@ static int dmatest_func(void *data)
 	bool			is_memset = false;
 	dma_addr_t		*srcs;
 	dma_addr_t		*dma_pq;
+	struct dmatest_bench	bench = { };
+	ktime_t			xfer_start = 0;
 
 	set_freezable();
 
@@ -671,6 +755,16 @@ static int dmatest_func(void *data)
 	if (!dma_pq)
 		goto err_srcs_array;
 
+	if (params->benchmark) {
+		bench.lat = kvmalloc_array(params->bench_iterations,
+					   sizeof(*bench.lat), GFP_KERNEL);
+		if (!bench.lat)
+			goto err_pq_array;
+
+		dmatest_bench_start(&bench, max(params->bench_min_size,
+						1U << align));
+	}
+
 	/*
 	 * src and dst buffers are freed by ourselves below
 	 */
@@ -687,9 +781,20 @@ static int dmatest_func(void *data)
 		dma_addr_t *dsts;
 		unsigned int len;
 
+		if (params->benchmark &&
+		    bench.runs >= params->bench_iterations) {
+			dmatest_bench_report(&bench, thread);
+			if (bench.size > buf_size / 2)
+				break;
+			dmatest_bench_start(&bench, bench.size * 2);
+		}
+
 		total_tests++;
 
-		if (params->transfer_size) {
+		if (params->benchmark) {
+			len = bench.size;
+			bench.runs++;
+		} else if (params->transfer_size) {
 			if (params->transfer_size >= buf_size) {
 				pr_err("%u-byte transfer size must be lower than %u-buffer size\n",
 				       params->transfer_size, buf_size);
@@ -703,7 +808,7 @@ static int dmatest_func(void *data)
 		}
 
 		/* Do not alter transfer size explicitly defined by user */
-		if (!params->transfer_size) {
+		if (!params->transfer_size && !params->benchmark) {
 			len = (len >> align) << align;
 			if (!len)
 				len = 1 << align;
@@ -776,6 +881,7 @@ static int dmatest_func(void *data)
 			um->bidi_cnt++;
 		}
 
+		xfer_start = ktime_get();
 		if (thread->type == DMA_MEMCPY)
 			tx = dev->device_prep_dma_memcpy(chan,
 							 dsts[0] + dst->off,
@@ -850,6 +956,12 @@ static int dmatest_func(void *data)
 			goto error_unmap_continue;
 		}
 
+		if (params->benchmark) {
+			bench.lat[bench.count++] =
+				ktime_to_ns(ktime_sub(ktime_get(), xfer_start));
+			bench.len += len;
+		}
+
 		dmaengine_unmap_put(um);
 
 		if (params->noverify) {
@@ -904,7 +1016,13 @@ static int dmatest_func(void *data)
 	ktime = ktime_sub(ktime, filltime);
 	runtime = ktime_to_us(ktime);
 
+	/* Report the size interrupted by a stop */
+	if (params->benchmark)
+		dmatest_bench_report(&bench, thread);
+
 	ret = 0;
+	kvfree(bench.lat);
+err_pq_array:
 	kfree(dma_pq);
 err_srcs_array:
 	kfree(srcs);
@@ -1107,6 +1225,15 @@ static void add_threaded_test(struct dmatest_info *info)
 	params->alignment = alignment;
 	params->transfer_size = transfer_size;
 	params->polled = polled;
+	params->benchmark = benchmark;
+	params->bench_min_size = bench_min_size ? bench_min_size : 1;
+	params->bench_iterations = bench_iterations ? bench_iterations : 1;
+
+	/* The benchmark measures the transfers only */
+	if (params->benchmark) {
+		params->noverify = true;
+		params->norandom = true;
+	}
 
 	request_channels(info, DMA_MEMCPY);
 	request_channels(info, DMA_MEMSET);
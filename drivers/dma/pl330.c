@@ -16,6 +16,7 @@
 #include <linux/string.h>
 #include <linux/delay.h>
 #include <linux/interrupt.h>
+#include <linux/ktime.h>
 #include <linux/dma-mapping.h>
 #include <linux/dmaengine.h>
 #include <linux/amba/bus.h>
@@ -429,6 +430,11 @@ struct dma_pl330_chan {
 	struct list_head work_list;
 	/* List of completed descriptors */
 	struct list_head completed_list;
+	/*
+	 * Descriptors given back by the channel, reused before going
+	 * to the DMAC pool so that the channels don't contend on it.
+	 */
+	struct list_head free_list;
 
 	/* Pointer to the DMAC that manages this channel,
 	 * NULL if the channel is available to be acquired.
@@ -460,6 +466,15 @@ struct dma_pl330_chan {
 
 	/* for runtime pm tracking */
 	bool active;
+
+	/* Statistics, protected by lock */
+	struct {
+		u64 xfers;
+		u64 bytes;
+		u64 lat_total_ns;
+		u64 lat_max_ns;
+		u64 queue_full;
+	} stats;
 };
 
 struct pl330_dmac {
@@ -547,6 +562,8 @@ struct dma_pl330_desc {
 	unsigned peri:5;
 	/* Hook to attach to DMAC's list of reqs with due callback */
 	struct list_head rqd;
+	/* When the req was handed to the channel thread */
+	ktime_t start;
 };
 
 struct _xfer_spec {
@@ -1641,6 +1658,7 @@ static void pl330_dotask(struct tasklet_struct *t)
 static int pl330_update(struct pl330_dmac *pl330)
 {
 	struct dma_pl330_desc *descdone;
+	LIST_HEAD(done);
 	unsigned long flags;
 	void __iomem *regs;
 	u32 val;
@@ -1717,16 +1735,21 @@ static int pl330_update(struct pl330_dmac *pl330)
 		}
 	}
 
-	/* Now that we are in no hurry, do the callbacks */
-	while (!list_empty(&pl330->req_done)) {
-		descdone = list_first_entry(&pl330->req_done,
-					    struct dma_pl330_desc, rqd);
+	/*
+	 * Now that we are in no hurry, do the callbacks. They only take the
+	 * lock of their own channel, so hand them all over at once.
+	 */
+	list_splice_init(&pl330->req_done, &done);
+	spin_unlock_irqrestore(&pl330->lock, flags);
+
+	while (!list_empty(&done)) {
+		descdone = list_first_entry(&done, struct dma_pl330_desc, rqd);
 		list_del(&descdone->rqd);
-		spin_unlock_irqrestore(&pl330->lock, flags);
 		dma_pl330_rqcb(descdone, PL330_ERR_NONE);
-		spin_lock_irqsave(&pl330->lock, flags);
 	}
 
+	spin_lock_irqsave(&pl330->lock, flags);
+
 updt_exit:
 	spin_unlock_irqrestore(&pl330->lock, flags);
 
@@ -2076,8 +2099,10 @@ static inline void fill_queue(struct dma_pl330_chan *pch)
 		ret = pl330_submit_req(pch->thread, desc);
 		if (!ret) {
 			desc->status = BUSY;
+			desc->start = ktime_get();
 		} else if (ret == -EAGAIN) {
 			/* QFull or DMAC Dying */
+			pch->stats.queue_full++;
 			break;
 		} else {
 			/* Unacceptable request */
@@ -2089,6 +2114,19 @@ static inline void fill_queue(struct dma_pl330_chan *pch)
 	}
 }
 
+/* Account a completed descriptor in the channel statistics */
+static void pl330_chan_account(struct dma_pl330_chan *pch,
+			       struct dma_pl330_desc *desc)
+{
+	u64 lat = ktime_to_ns(ktime_sub(ktime_get(), desc->start));
+
+	pch->stats.xfers++;
+	pch->stats.bytes += desc->bytes_requested;
+	pch->stats.lat_total_ns += lat;
+	if (lat > pch->stats.lat_max_ns)
+		pch->stats.lat_max_ns = lat;
+}
+
 static void pl330_tasklet(struct tasklet_struct *t)
 {
 	struct dma_pl330_chan *pch = from_tasklet(pch, t, task);
@@ -2103,6 +2141,7 @@ static void pl330_tasklet(struct tasklet_struct *t)
 		if (desc->status == DONE) {
 			if (!pch->cyclic)
 				dma_cookie_complete(&desc->txd);
+			pl330_chan_account(pch, desc);
 			list_move_tail(&desc->node, &pch->completed_list);
 		}
 
@@ -2122,6 +2161,30 @@ static void pl330_tasklet(struct tasklet_struct *t)
 		spin_unlock(&pch->thread->dmac->lock);
 	}
 
+	/*
+	 * The completed descriptors can't be reused until their callback is
+	 * done, so those of a non cyclic channel are all handled with the
+	 * lock dropped once and then go to the channel free list in one go.
+	 */
+	if (!pch->cyclic && !list_empty(&pch->completed_list)) {
+		LIST_HEAD(done);
+
+		list_splice_tail_init(&pch->completed_list, &done);
+		spin_unlock_irqrestore(&pch->lock, flags);
+
+		list_for_each_entry(desc, &done, node) {
+			struct dmaengine_desc_callback cb;
+
+			dmaengine_desc_get_callback(&desc->txd, &cb);
+			dma_descriptor_unmap(&desc->txd);
+			dmaengine_desc_callback_invoke(&cb, NULL);
+			desc->status = FREE;
+		}
+
+		spin_lock_irqsave(&pch->lock, flags);
+		list_splice_tail(&done, &pch->free_list);
+	}
+
 	while (!list_empty(&pch->completed_list)) {
 		struct dmaengine_desc_callback cb;
 
@@ -2142,7 +2205,7 @@ static void pl330_tasklet(struct tasklet_struct *t)
 			}
 		} else {
 			desc->status = FREE;
-			list_move_tail(&desc->node, &pch->dmac->desc_pool);
+			list_move_tail(&desc->node, &pch->free_list);
 		}
 
 		dma_descriptor_unmap(&desc->txd);
@@ -2332,9 +2395,9 @@ static int pl330_terminate_all(struct dma_chan *chan)
 		dma_cookie_complete(&desc->txd);
 	}
 
-	list_splice_tail_init(&pch->submitted_list, &pl330->desc_pool);
-	list_splice_tail_init(&pch->work_list, &pl330->desc_pool);
-	list_splice_tail_init(&pch->completed_list, &pl330->desc_pool);
+	list_splice_tail_init(&pch->submitted_list, &pch->free_list);
+	list_splice_tail_init(&pch->work_list, &pch->free_list);
+	list_splice_tail_init(&pch->completed_list, &pch->free_list);
 	spin_unlock_irqrestore(&pch->lock, flags);
 	pm_runtime_mark_last_busy(pl330->ddma.dev);
 	if (power_down)
@@ -2381,6 +2444,7 @@ static void pl330_free_chan_resources(struct dma_chan *chan)
 	struct dma_pl330_chan *pch = to_pchan(chan);
 	struct pl330_dmac *pl330 = pch->dmac;
 	unsigned long flags;
+	LIST_HEAD(free);
 
 	tasklet_kill(&pch->task);
 
@@ -2390,10 +2454,18 @@ static void pl330_free_chan_resources(struct dma_chan *chan)
 	pl330_release_channel(pch->thread);
 	pch->thread = NULL;
 
+	spin_unlock_irqrestore(&pl330->lock, flags);
+
+	/* Give the descriptors cached by the channel back to the DMAC */
+	spin_lock_irqsave(&pch->lock, flags);
 	if (pch->cyclic)
-		list_splice_tail_init(&pch->work_list, &pch->dmac->desc_pool);
+		list_splice_tail_init(&pch->work_list, &pch->free_list);
+	list_splice_tail_init(&pch->free_list, &free);
+	spin_unlock_irqrestore(&pch->lock, flags);
 
-	spin_unlock_irqrestore(&pl330->lock, flags);
+	spin_lock_irqsave(&pl330->pool_lock, flags);
+	list_splice_tail(&free, &pl330->desc_pool);
+	spin_unlock_irqrestore(&pl330->pool_lock, flags);
 	pm_runtime_mark_last_busy(pch->dmac->ddma.dev);
 	pm_runtime_put_autosuspend(pch->dmac->ddma.dev);
 	pl330_unprep_slave_fifo(pch);
@@ -2621,8 +2693,10 @@ static struct dma_pl330_desc *pl330_get_desc(struct dma_pl330_chan *pch)
 	u8 *peri_id = pch->chan.private;
 	struct dma_pl330_desc *desc;
 
-	/* Pluck one desc from the pool of DMAC */
-	desc = pluck_desc(&pl330->desc_pool, &pl330->pool_lock);
+	/* Reuse a desc of the channel first, then pluck one from the DMAC */
+	desc = pluck_desc(&pch->free_list, &pch->lock);
+	if (!desc)
+		desc = pluck_desc(&pl330->desc_pool, &pl330->pool_lock);
 
 	/* If the DMAC pool is empty, alloc new */
 	if (!desc) {
@@ -2843,7 +2917,7 @@ pl330_prep_dma_memcpy(struct dma_chan *chan, dma_addr_t dst,
 	return &desc->txd;
 }
 
-static void __pl330_giveback_desc(struct pl330_dmac *pl330,
+static void __pl330_giveback_desc(struct dma_pl330_chan *pch,
 				  struct dma_pl330_desc *first)
 {
 	unsigned long flags;
@@ -2852,17 +2926,17 @@ static void __pl330_giveback_desc(struct pl330_dmac *pl330,
 	if (!first)
 		return;
 
-	spin_lock_irqsave(&pl330->pool_lock, flags);
+	spin_lock_irqsave(&pch->lock, flags);
 
 	while (!list_empty(&first->node)) {
 		desc = list_entry(first->node.next,
 				struct dma_pl330_desc, node);
-		list_move_tail(&desc->node, &pl330->desc_pool);
+		list_move_tail(&desc->node, &pch->free_list);
 	}
 
-	list_move_tail(&first->node, &pl330->desc_pool);
+	list_move_tail(&first->node, &pch->free_list);
 
-	spin_unlock_irqrestore(&pl330->pool_lock, flags);
+	spin_unlock_irqrestore(&pch->lock, flags);
 }
 
 static struct dma_async_tx_descriptor *
@@ -2889,12 +2963,10 @@ pl330_prep_slave_sg(struct dma_chan *chan, struct scatterlist *sgl,
 
 		desc = pl330_get_desc(pch);
 		if (!desc) {
-			struct pl330_dmac *pl330 = pch->dmac;
-
 			dev_err(pch->dmac->ddma.dev,
 				"%s:%d Unable to fetch desc\n",
 				__func__, __LINE__);
-			__pl330_giveback_desc(pl330, first);
+			__pl330_giveback_desc(pch, first);
 
 			return NULL;
 		}
@@ -2973,6 +3045,30 @@ static int pl330_debugfs_show(struct seq_file *s, void *data)
 			seq_printf(s, "%d\n", found);
 	}
 
+	seq_puts(s, "\nPL330 channel statistics:\n");
+	seq_puts(s, "CHANNEL:\tXFERS:\t\tBYTES:\t\tLAT AVG/MAX (ns):\tQFULL:\n");
+	for (pr = 0; pr < pchs; pr++) {
+		struct dma_pl330_chan *pch = &pl330->peripherals[pr];
+		u64 xfers, bytes, lat_total, lat_max, queue_full;
+		unsigned long flags;
+
+		spin_lock_irqsave(&pch->lock, flags);
+		xfers = pch->stats.xfers;
+		bytes = pch->stats.bytes;
+		lat_total = pch->stats.lat_total_ns;
+		lat_max = pch->stats.lat_max_ns;
+		queue_full = pch->stats.queue_full;
+		spin_unlock_irqrestore(&pch->lock, flags);
+
+		if (!xfers && !queue_full)
+			continue;
+
+		seq_printf(s, "%d\t\t%llu\t\t%llu\t\t%llu/%llu\t\t%llu\n",
+			   pr, xfers, bytes,
+			   xfers ? div64_u64(lat_total, xfers) : 0, lat_max,
+			   queue_full);
+	}
+
 	return 0;
 }
 
@@ -3138,6 +3234,7 @@ pl330_probe(struct amba_device *adev, const struct amba_id *id)
 		INIT_LIST_HEAD(&pch->submitted_list);
 		INIT_LIST_HEAD(&pch->work_list);
 		INIT_LIST_HEAD(&pch->completed_list);
+		INIT_LIST_HEAD(&pch->free_list);
 		spin_lock_init(&pch->lock);
 		pch->thread = NULL;
 		pch->chan.device = pd;
@@ -16,6 +16,8 @@
 #include <linux/kernel.h>
 #include <linux/mfd/altera-sysmgr.h>
 #include <linux/mfd/syscon.h>
+#include <linux/mm.h>
+#include <linux/moduleparam.h>
 #include <linux/notifier.h>
 #include <linux/of_address.h>
 #include <linux/of_irq.h>
@@ -23,6 +25,7 @@
 #include <linux/panic_notifier.h>
 #include <linux/platform_device.h>
 #include <linux/regmap.h>
+#include <linux/seq_file.h>
 #include <linux/types.h>
 #include <linux/uaccess.h>
 
@@ -32,6 +35,51 @@
 #define EDAC_MOD_STR		"altera_edac"
 #define EDAC_DEVICE		"Altera"
 
+static unsigned int ce_threshold = 16;
+module_param(ce_threshold, uint, 0644);
+MODULE_PARM_DESC(ce_threshold,
+		 "Correctable errors after which a page is offlined (0 = never)");
+
+static unsigned int ce_leak_s = 3600;
+module_param(ce_leak_s, uint, 0644);
+MODULE_PARM_DESC(ce_leak_s,
+		 "Seconds after which a correctable error is forgotten (0 = never)");
+
+static u32 __maybe_unused altr_ce_bucket_level(struct altr_ce_bucket *b,
+					       unsigned long *stamp)
+{
+	unsigned long period = ce_leak_s * HZ, leaked;
+
+	*stamp = jiffies;
+	if (!period)
+		return b->level;
+
+	leaked = (*stamp - b->stamp) / period;
+	if (leaked >= b->level)
+		return 0;
+
+	*stamp = b->stamp + leaked * period;
+	return b->level - leaked;
+}
+
+/*
+ * Add @count errors to @b, returns true when it overflows ce_threshold:
+ * the bucket is then emptied.
+ */
+static bool __maybe_unused altr_ce_bucket_add(struct altr_ce_bucket *b,
+					      u32 count)
+{
+	b->level = altr_ce_bucket_level(b, &b->stamp) + count;
+	b->max = max(b->max, b->level);
+
+	if (!ce_threshold || b->level < ce_threshold)
+		return false;
+
+	b->level = 0;
+	b->alarms++;
+	return true;
+}
+
 #ifdef CONFIG_EDAC_ALTERA_SDRAM
 static const struct altr_sdram_prv_data c5_data = {
 	.ecc_ctrl_offset    = CV_CTLCFG_OFST,
@@ -47,6 +95,9 @@ static const struct altr_sdram_prv_data c5_data = {
 	.ecc_irq_en_mask    = CV_DRAMINTR_INTREN,
 	.ecc_irq_clr_offset = CV_DRAMINTR_OFST,
 	.ecc_irq_clr_mask   = (CV_DRAMINTR_INTRCLR | CV_DRAMINTR_INTREN),
+	.ecc_irq_ce_offset  = CV_DRAMINTR_OFST,
+	.ecc_irq_ce_mask    = CV_DRAMINTR_SBEMASK,
+	.ecc_irq_ce_off     = CV_DRAMINTR_SBEMASK,
 	.ecc_cnt_rst_offset = CV_DRAMINTR_OFST,
 	.ecc_cnt_rst_mask   = CV_DRAMINTR_INTRCLR,
 	.ce_ue_trgr_offset  = CV_CTLCFG_OFST,
@@ -66,6 +117,9 @@ static const struct altr_sdram_prv_data a10_data = {
 	.ecc_irq_en_mask    = A10_ECC_IRQ_EN_MASK,
 	.ecc_irq_clr_offset = A10_INTSTAT_OFST,
 	.ecc_irq_clr_mask   = (A10_INTSTAT_SBEERR | A10_INTSTAT_DBEERR),
+	.ecc_irq_ce_offset  = A10_ERRINTEN_OFST,
+	.ecc_irq_ce_mask    = A10_ERRINTEN_SERRINTEN,
+	.ecc_irq_ce_off     = 0,
 	.ecc_cnt_rst_offset = A10_ECCCTRL1_OFST,
 	.ecc_cnt_rst_mask   = A10_ECC_CNT_RESET_MASK,
 	.ce_ue_trgr_offset  = A10_DIAGINTTEST_OFST,
@@ -77,6 +131,166 @@ static const struct altr_sdram_prv_data a10_data = {
 
 /* The SDRAM controller uses the EDAC Memory Controller framework.       */
 
+/*
+ * Track the correctable errors of the pages they hit, the least troubled of
+ * the tracked pages making room for a new one, and have the pages filling
+ * their bucket soft-offlined before they fail for good.
+ */
+static void altr_sdram_ce_page(struct altr_sdram_mc_data *drvdata,
+			       unsigned long pfn, u32 count)
+{
+	struct altr_ce_page *page, *victim = NULL;
+	unsigned long stamp, flags;
+	u32 level, min_level = U32_MAX;
+	int i;
+
+	spin_lock_irqsave(&drvdata->ce_lock, flags);
+
+	for (i = 0; i < ALTR_CE_PAGES; i++) {
+		page = &drvdata->ce_pages[i];
+		if (page->bucket.stamp && page->pfn == pfn)
+			break;
+
+		level = page->bucket.stamp ?
+			altr_ce_bucket_level(&page->bucket, &stamp) : 0;
+		if (!page->offline && level < min_level) {
+			min_level = level;
+			victim = page;
+		}
+	}
+
+	if (i == ALTR_CE_PAGES) {
+		page = victim;
+		if (!page)
+			goto out;
+
+		memset(page, 0, sizeof(*page));
+		page->pfn = pfn;
+	}
+
+	if (altr_ce_bucket_add(&page->bucket, count) && !page->offline) {
+		page->offline = true;
+		schedule_work(&drvdata->offline_work);
+	}
+out:
+	spin_unlock_irqrestore(&drvdata->ce_lock, flags);
+}
+
+static void altr_sdram_offline_work(struct work_struct *work)
+{
+	struct altr_sdram_mc_data *drvdata =
+		container_of(work, struct altr_sdram_mc_data, offline_work);
+	unsigned long pfn;
+	int i, ret;
+
+	for (i = 0; i < ALTR_CE_PAGES; i++) {
+		spin_lock_irq(&drvdata->ce_lock);
+		pfn = drvdata->ce_pages[i].pfn;
+		if (!drvdata->ce_pages[i].offline)
+			pfn = 0;
+		drvdata->ce_pages[i].offline = false;
+		spin_unlock_irq(&drvdata->ce_lock);
+
+		if (!pfn || !IS_ENABLED(CONFIG_MEMORY_FAILURE))
+			continue;
+
+		if (!pfn_valid(pfn)) {
+			edac_printk(KERN_WARNING, EDAC_MC,
+				    "Correctable errors at unknown pfn %#lx\n",
+				    pfn);
+			continue;
+		}
+
+		ret = soft_offline_page(pfn, 0);
+		edac_printk(ret ? KERN_ERR : KERN_WARNING, EDAC_MC,
+			    "Soft-offlining pfn %#lx for correctable errors: %d\n",
+			    pfn, ret);
+		if (!ret)
+			drvdata->offlined++;
+	}
+}
+
+static int altr_sdram_ce_show(struct seq_file *s, void *data)
+{
+	struct mem_ctl_info *mci = s->private;
+	struct altr_sdram_mc_data *drvdata = mci->pvt_info;
+	struct altr_ce_page *page;
+	unsigned long stamp;
+	int i;
+
+	seq_printf(s, "offlined:\t%lu\n", drvdata->offlined);
+	seq_puts(s, "pfn\t\tlevel\tmax\talarms\n");
+
+	spin_lock_irq(&drvdata->ce_lock);
+	for (i = 0; i < ALTR_CE_PAGES; i++) {
+		page = &drvdata->ce_pages[i];
+		if (!page->bucket.stamp)
+			continue;
+
+		seq_printf(s, "%#lx\t%u\t%u\t%u\n", page->pfn,
+			   altr_ce_bucket_level(&page->bucket, &stamp),
+			   page->bucket.max, page->bucket.alarms);
+	}
+	spin_unlock_irq(&drvdata->ce_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(altr_sdram_ce);
+
+/* Report the correctable error latched by the controller */
+static void altr_sdram_report_ce(struct mem_ctl_info *mci)
+{
+	struct altr_sdram_mc_data *drvdata = mci->pvt_info;
+	const struct altr_sdram_prv_data *priv = drvdata->data;
+	u32 err_count = 1, err_addr;
+
+	regmap_read(drvdata->mc_vbase, priv->ecc_saddr_offset, &err_addr);
+	if (priv->ecc_cecnt_offset)
+		regmap_read(drvdata->mc_vbase,  priv->ecc_cecnt_offset,
+			    &err_count);
+	edac_mc_handle_error(HW_EVENT_ERR_CORRECTED, mci, err_count,
+			     err_addr >> PAGE_SHIFT,
+			     err_addr & ~PAGE_MASK, 0,
+			     0, 0, -1, mci->ctl_name, "");
+	altr_sdram_ce_page(drvdata, err_addr >> PAGE_SHIFT, err_count);
+}
+
+/*
+ * During a CE storm the CE interrupt is masked and the errors are polled by
+ * the EDAC core, the UEs still raising the interrupt.
+ */
+static void altr_sdram_ce_storm_mode(struct mem_ctl_info *mci, bool storm)
+{
+	struct altr_sdram_mc_data *drvdata = mci->pvt_info;
+	const struct altr_sdram_prv_data *priv = drvdata->data;
+	u32 val = priv->ecc_irq_ce_off;
+
+	if (!storm)
+		val ^= priv->ecc_irq_ce_mask;
+
+	WRITE_ONCE(drvdata->ce_polled, storm);
+	regmap_update_bits(drvdata->mc_vbase, priv->ecc_irq_ce_offset,
+			   priv->ecc_irq_ce_mask, val);
+}
+
+static void altr_sdram_ce_storm_check(struct mem_ctl_info *mci)
+{
+	struct altr_sdram_mc_data *drvdata = mci->pvt_info;
+	const struct altr_sdram_prv_data *priv = drvdata->data;
+	u32 status, clr = priv->ecc_irq_clr_mask;
+
+	regmap_read(drvdata->mc_vbase, priv->ecc_stat_offset, &status);
+	if (!(status & priv->ecc_stat_ce_mask))
+		return;
+
+	altr_sdram_report_ce(mci);
+
+	/* don't unmask the CE interrupt while clearing the error */
+	if (priv->ecc_irq_clr_offset == priv->ecc_irq_ce_offset)
+		clr |= priv->ecc_irq_ce_off;
+	regmap_write(drvdata->mc_vbase, priv->ecc_irq_clr_offset, clr);
+}
+
 static irqreturn_t altr_sdram_mc_err_handler(int irq, void *dev_id)
 {
 	struct mem_ctl_info *mci = dev_id;
@@ -95,16 +309,10 @@ static irqreturn_t altr_sdram_mc_err_handler(int irq, void *dev_id)
 		panic("\nEDAC: [%d Uncorrectable errors @ 0x%08X]\n",
 		      err_count, err_addr);
 	}
-	if (status & priv->ecc_stat_ce_mask) {
-		regmap_read(drvdata->mc_vbase, priv->ecc_saddr_offset,
-			    &err_addr);
-		if (priv->ecc_cecnt_offset)
-			regmap_read(drvdata->mc_vbase,  priv->ecc_cecnt_offset,
-				    &err_count);
-		edac_mc_handle_error(HW_EVENT_ERR_CORRECTED, mci, err_count,
-				     err_addr >> PAGE_SHIFT,
-				     err_addr & ~PAGE_MASK, 0,
-				     0, 0, -1, mci->ctl_name, "");
+	/* left to altr_sdram_ce_storm_check() while polled */
+	if ((status & priv->ecc_stat_ce_mask) &&
+	    !READ_ONCE(drvdata->ce_polled)) {
+		altr_sdram_report_ce(mci);
 		/* Clear IRQ to resume */
 		regmap_write(drvdata->mc_vbase,	priv->ecc_irq_clr_offset,
 			     priv->ecc_irq_clr_mask);
@@ -198,6 +406,9 @@ static void altr_sdr_mc_create_debugfs_nodes(struct mem_ctl_info *mci)
 	if (!mci->debugfs)
 		return;
 
+	edac_debugfs_create_file("altr_ce_pages", 0444, mci->debugfs, mci,
+				 &altr_sdram_ce_fops);
+
 	edac_debugfs_create_file("altr_trigger", S_IWUSR, mci->debugfs, mci,
 				 &altr_sdr_mc_debug_inject_fops);
 }
@@ -372,6 +583,8 @@ static int altr_sdram_probe(struct platform_device *pdev)
 	drvdata = mci->pvt_info;
 	drvdata->mc_vbase = mc_vbase;
 	drvdata->data = priv;
+	spin_lock_init(&drvdata->ce_lock);
+	INIT_WORK(&drvdata->offline_work, altr_sdram_offline_work);
 	platform_set_drvdata(pdev, mci);
 
 	if (!devres_open_group(&pdev->dev, NULL, GFP_KERNEL)) {
@@ -388,6 +601,8 @@ static int altr_sdram_probe(struct platform_device *pdev)
 	mci->ctl_name = dev_name(&pdev->dev);
 	mci->scrub_mode = SCRUB_SW_SRC;
 	mci->dev_name = dev_name(&pdev->dev);
+	mci->ce_storm_mode = altr_sdram_ce_storm_mode;
+	mci->ce_storm_check = altr_sdram_ce_storm_check;
 
 	dimm = *mci->dimms;
 	dimm->nr_pages = ((mem_size - 1) >> PAGE_SHIFT) + 1;
@@ -452,6 +667,7 @@ static int altr_sdram_probe(struct platform_device *pdev)
 	edac_mc_del_mc(&pdev->dev);
 err:
 	devres_release_group(&pdev->dev, NULL);
+	cancel_work_sync(&drvdata->offline_work);
 free:
 	edac_mc_free(mci);
 	edac_printk(KERN_ERR, EDAC_MC,
@@ -463,8 +679,10 @@ static int altr_sdram_probe(struct platform_device *pdev)
 static int altr_sdram_remove(struct platform_device *pdev)
 {
 	struct mem_ctl_info *mci = platform_get_drvdata(pdev);
+	struct altr_sdram_mc_data *drvdata = mci->pvt_info;
 
 	edac_mc_del_mc(&pdev->dev);
+	cancel_work_sync(&drvdata->offline_work);
 	edac_mc_free(mci);
 	platform_set_drvdata(pdev, NULL);
 
@@ -553,6 +771,66 @@ static const struct edac_device_prv_data a10_ocramecc_data;
 static const struct edac_device_prv_data a10_l2ecc_data;
 #endif
 
+/*
+ * Correctable errors fill the bucket of the device, a warning telling when
+ * it overflows so degrading SRAMs get noticed before they fail for good.
+ */
+static void altr_edac_device_handle_ce(struct edac_device_ctl_info *edac_dev)
+{
+	struct altr_edac_device_dev *ad = edac_dev->pvt_info;
+
+	edac_device_handle_ce(edac_dev, 0, 0, ad->edac_dev_name);
+
+	if (altr_ce_bucket_add(&ad->ce_bucket, 1))
+		edac_printk(KERN_WARNING, EDAC_DEVICE,
+			    "%s: correctable error rate over threshold\n",
+			    ad->edac_dev_name);
+}
+
+static ssize_t altr_edac_ce_level_show(struct edac_device_ctl_info *edac_dev,
+				       char *data)
+{
+	struct altr_edac_device_dev *ad = edac_dev->pvt_info;
+	unsigned long stamp;
+
+	return sprintf(data, "%u\n",
+		       altr_ce_bucket_level(&ad->ce_bucket, &stamp));
+}
+
+static ssize_t altr_edac_ce_max_show(struct edac_device_ctl_info *edac_dev,
+				     char *data)
+{
+	struct altr_edac_device_dev *ad = edac_dev->pvt_info;
+
+	return sprintf(data, "%u\n", ad->ce_bucket.max);
+}
+
+static ssize_t altr_edac_ce_alarms_show(struct edac_device_ctl_info *edac_dev,
+					char *data)
+{
+	struct altr_edac_device_dev *ad = edac_dev->pvt_info;
+
+	return sprintf(data, "%u\n", ad->ce_bucket.alarms);
+}
+
+static struct edac_dev_sysfs_attribute altr_edac_device_sysfs_attributes[] = {
+	{
+		.attr = { .name = "ce_level", .mode = 0444 },
+		.show = altr_edac_ce_level_show,
+	},
+	{
+		.attr = { .name = "ce_level_max", .mode = 0444 },
+		.show = altr_edac_ce_max_show,
+	},
+	{
+		.attr = { .name = "ce_alarms", .mode = 0444 },
+		.show = altr_edac_ce_alarms_show,
+	},
+	{
+		.attr = { .name = NULL },
+	}
+};
+
 static irqreturn_t altr_edac_device_handler(int irq, void *dev_id)
 {
 	irqreturn_t ret_value = IRQ_NONE;
@@ -563,7 +841,7 @@ static irqreturn_t altr_edac_device_handler(int irq, void *dev_id)
 	if (irq == drvdata->sb_irq) {
 		if (priv->ce_clear_mask)
 			writel(priv->ce_clear_mask, drvdata->base);
-		edac_device_handle_ce(dci, 0, 0, drvdata->edac_dev_name);
+		altr_edac_device_handle_ce(dci);
 		ret_value = IRQ_HANDLED;
 	} else if (irq == drvdata->db_irq) {
 		if (priv->ue_clear_mask)
@@ -817,6 +1095,7 @@ static int altr_edac_device_probe(struct platform_device *pdev)
 	dci->mod_name = "Altera ECC Manager";
 	dci->dev_name = drvdata->edac_dev_name;
 
+	dci->sysfs_attributes = altr_edac_device_sysfs_attributes;
 	res = edac_device_add_device(dci);
 	if (res)
 		goto fail1;
@@ -890,7 +1169,7 @@ static irqreturn_t __maybe_unused altr_edac_a10_ecc_irq(int irq, void *dev_id)
 	if (irq == dci->sb_irq) {
 		writel(ALTR_A10_ECC_SERRPENA,
 		       base + ALTR_A10_ECC_INTSTAT_OFST);
-		edac_device_handle_ce(dci->edac_dev, 0, 0, dci->edac_dev_name);
+		altr_edac_device_handle_ce(dci->edac_dev);
 
 		return IRQ_HANDLED;
 	} else if (irq == dci->db_irq) {
@@ -1318,7 +1597,7 @@ static irqreturn_t altr_edac_a10_l2_irq(int irq, void *dev_id)
 		regmap_write(dci->edac->ecc_mgr_map,
 			     A10_SYSGMR_MPU_CLEAR_L2_ECC_OFST,
 			     A10_SYSGMR_MPU_CLEAR_L2_ECC_SB);
-		edac_device_handle_ce(dci->edac_dev, 0, 0, dci->edac_dev_name);
+		altr_edac_device_handle_ce(dci->edac_dev);
 
 		return IRQ_HANDLED;
 	} else if (irq == dci->db_irq) {
@@ -1503,7 +1782,7 @@ static irqreturn_t seu_irq_handler(int irq, void *dev_id)
 			    (u32)result.a0, (u32)result.a1, (u32)result.a2);
 
 		if ((u32)result.a2 & BIT(28))
-			edac_device_handle_ce(dci->edac_dev, 0, 0, dci->edac_dev_name);
+			altr_edac_device_handle_ce(dci->edac_dev);
 		else
 			edac_device_handle_ue(dci->edac_dev, 0, 0, dci->edac_dev_name);
 	}
@@ -1762,6 +2041,7 @@ static int altr_portb_setup(struct altr_edac_device_dev *device)
 	}
 #endif
 
+	dci->sysfs_attributes = altr_edac_device_sysfs_attributes;
 	rc = edac_device_add_device(dci);
 	if (rc) {
 		edac_printk(KERN_ERR, EDAC_DEVICE,
@@ -1823,7 +2103,7 @@ static irqreturn_t altr_edac_a10_ecc_irq_portb(int irq, void *dev_id)
 	if (irq == ad->sb_irq) {
 		writel(priv->ce_clear_mask,
 		       base + ALTR_A10_ECC_INTSTAT_OFST);
-		edac_device_handle_ce(ad->edac_dev, 0, 0, ad->edac_dev_name);
+		altr_edac_device_handle_ce(ad->edac_dev);
 		return IRQ_HANDLED;
 	} else if (irq == ad->db_irq) {
 		writel(priv->ue_clear_mask,
@@ -2010,7 +2290,7 @@ static irqreturn_t sdm_qspi_irq_handler(int irq, void *dev_id)
 		arm_smccc_smc(INTEL_SIP_SMC_REG_WRITE,
 			      dci->sdm_qspi_addr + ALTR_A10_ECC_INTSTAT_OFST,
 			      ALTR_A10_ECC_SERRPENA, 0, 0, 0, 0, 0, &result);
-		edac_device_handle_ce(dci->edac_dev, 0, 0, dci->edac_dev_name);
+		altr_edac_device_handle_ce(dci->edac_dev);
 	} else {
 		arm_smccc_smc(INTEL_SIP_SMC_REG_WRITE,
 			      dci->sdm_qspi_addr + ALTR_A10_ECC_INTSTAT_OFST,
@@ -2124,6 +2404,7 @@ static int altr_edac_device_add(struct altr_arria10_edac *edac,
 		goto err_release_group1;
 	}
 
+	dci->sysfs_attributes = altr_edac_device_sysfs_attributes;
 	rc = edac_device_add_device(dci);
 	if (rc) {
 		dev_err(edac->dev, "edac_device_add_device failed\n");
@@ -2299,6 +2580,7 @@ static int altr_edac_a10_device_add(struct altr_arria10_edac *edac,
 	}
 #endif
 
+	dci->sysfs_attributes = altr_edac_device_sysfs_attributes;
 	rc = edac_device_add_device(dci);
 	if (rc) {
 		dev_err(edac->dev, "edac_device_add_device failed\n");
@@ -9,7 +9,9 @@
 
 #include <linux/arm-smccc.h>
 #include <linux/edac.h>
+#include <linux/spinlock.h>
 #include <linux/types.h>
+#include <linux/workqueue.h>
 
 /* SDRAM Controller CtrlCfg Register */
 #define CV_CTLCFG_OFST             0x00
@@ -170,6 +172,9 @@ struct altr_sdram_prv_data {
 	int ecc_irq_en_mask;
 	int ecc_irq_clr_offset;
 	int ecc_irq_clr_mask;
+	int ecc_irq_ce_offset;
+	int ecc_irq_ce_mask;
+	int ecc_irq_ce_off;
 	int ecc_cnt_rst_offset;
 	int ecc_cnt_rst_mask;
 	struct edac_dev_sysfs_attribute *eccmgr_sysfs_attr;
@@ -180,11 +185,36 @@ struct altr_sdram_prv_data {
 };
 
 /* Altera SDRAM Memory Controller data */
+/*
+ * Leaky bucket of correctable errors: errors fill it while one leaks out
+ * every ce_leak_s seconds.
+ */
+struct altr_ce_bucket {
+	unsigned long stamp;
+	u32 level;
+	u32 max;
+	u32 alarms;
+};
+
+/* Correctable error history of a page of SDRAM */
+#define ALTR_CE_PAGES			32
+
+struct altr_ce_page {
+	unsigned long pfn;
+	struct altr_ce_bucket bucket;
+	bool offline;
+};
+
 struct altr_sdram_mc_data {
 	struct regmap *mc_vbase;
 	int sb_irq;
 	int db_irq;
 	const struct altr_sdram_prv_data *data;
+	spinlock_t ce_lock;
+	struct altr_ce_page ce_pages[ALTR_CE_PAGES];
+	struct work_struct offline_work;
+	unsigned long offlined;
+	bool ce_polled;
 };
 
 /************************** EDAC Device Defines **************************/
@@ -393,6 +423,7 @@ struct altr_edac_device_dev {
 	int sdm_qspi_db_irq;
 	u32 sdm_qspi_addr;
 	int seu_irq;
+	struct altr_ce_bucket ce_bucket;
 };
 
 struct altr_arria10_edac {
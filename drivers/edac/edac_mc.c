@@ -29,6 +29,8 @@
 #include <linux/edac.h>
 #include <linux/bitops.h>
 #include <linux/uaccess.h>
+#include <linux/percpu.h>
+#include <linux/workqueue.h>
 #include <asm/page.h>
 #include "edac_mc.h"
 #include "edac_module.h"
@@ -331,6 +333,108 @@ static int edac_mc_alloc_dimms(struct mem_ctl_info *mci)
 	return 0;
 }
 
+/*
+ * CE storms: a failing DIMM can raise correctable errors faster than they
+ * can be logged.  Once edac_mc_ce_storm errors are seen within a second,
+ * the per-error reports are replaced by a summary every
+ * EDAC_MC_STORM_REPORT, and the controllers able to do it get their CE
+ * interrupt masked and are polled instead, until the errors calm down for
+ * EDAC_MC_STORM_QUIET seconds in a row.
+ */
+#define EDAC_MC_STORM_QUIET	10
+#define EDAC_MC_STORM_REPORT	(60 * HZ)
+
+static bool edac_mc_ce_storm_polled(struct mem_ctl_info *mci)
+{
+	return mci->ce_storm_mode && mci->ce_storm_check;
+}
+
+static void edac_mc_ce_storm_summary(struct mem_ctl_info *mci,
+				     const char *what)
+{
+	edac_mc_printk(mci, KERN_WARNING, "CE storm %s: %llu errors in %us\n",
+		       what, mci->ce_storm_count,
+		       jiffies_to_msecs(jiffies - mci->ce_storm_start) /
+		       MSEC_PER_SEC);
+	mci->ce_storm_report = jiffies;
+}
+
+/*
+ * Samples the CEs of the last second, started by the first CE reported and
+ * kept running for the duration of a storm.
+ */
+static void edac_mc_ce_storm_work(struct work_struct *work)
+{
+	struct mem_ctl_info *mci = container_of(to_delayed_work(work),
+						struct mem_ctl_info,
+						storm_work);
+	unsigned int threshold = edac_mc_get_ce_storm();
+	bool polled = edac_mc_ce_storm_polled(mci);
+	unsigned int count;
+
+	mutex_lock(&mem_ctls_mutex);
+
+	if (mci->op_state == OP_OFFLINE)
+		goto out;
+
+	if (mci->ce_storm && polled)
+		mci->ce_storm_check(mci);
+
+	count = atomic_xchg(&mci->ce_storm_window, 0);
+
+	if (!mci->ce_storm) {
+		if (!threshold || count < threshold)
+			goto out;
+
+		mci->ce_storm_start = jiffies;
+		mci->ce_storm_report = jiffies;
+		mci->ce_storm_count = count;
+		mci->ce_storm_quiet = 0;
+		WRITE_ONCE(mci->ce_storm, true);
+
+		edac_mc_printk(mci, KERN_WARNING,
+			       "CE storm: %u errors in 1s, only reporting a summary%s\n",
+			       count, polled ? " and polling" : "");
+		if (polled)
+			mci->ce_storm_mode(mci, true);
+	} else {
+		mci->ce_storm_count += count;
+
+		/* a polled controller reports at most one error per poll */
+		if (count < (polled ? 1 : threshold))
+			mci->ce_storm_quiet++;
+		else
+			mci->ce_storm_quiet = 0;
+
+		if (!threshold || mci->ce_storm_quiet >= EDAC_MC_STORM_QUIET) {
+			if (polled)
+				mci->ce_storm_mode(mci, false);
+			WRITE_ONCE(mci->ce_storm, false);
+			edac_mc_ce_storm_summary(mci, "over");
+			goto out;
+		}
+
+		if (time_after(jiffies,
+			       mci->ce_storm_report + EDAC_MC_STORM_REPORT))
+			edac_mc_ce_storm_summary(mci, "ongoing");
+	}
+
+	/* keep sampling, and polling, until the storm is over */
+	edac_queue_work(&mci->storm_work, HZ);
+out:
+	mutex_unlock(&mem_ctls_mutex);
+}
+
+static void edac_mc_ce_storm_account(struct mem_ctl_info *mci, u16 count)
+{
+	if (!edac_mc_get_ce_storm() && !READ_ONCE(mci->ce_storm))
+		return;
+
+	atomic_add(count, &mci->ce_storm_window);
+	if (mci->op_state != OP_OFFLINE)
+		edac_queue_work(&mci->storm_work, HZ);
+}
+
 struct mem_ctl_info *edac_mc_alloc(unsigned int mc_num,
 				   unsigned int n_layers,
 				   struct edac_mc_layer *layers,
@@ -384,6 +488,7 @@ struct mem_ctl_info *edac_mc_alloc(unsigned int mc_num,
 	mci->nr_csrows = tot_csrows;
 	mci->num_cschannel = tot_channels;
 	mci->csbased = per_rank;
+	INIT_DELAYED_WORK(&mci->storm_work, edac_mc_ce_storm_work);
 
 	if (edac_mc_alloc_csrows(mci))
 		goto error;
@@ -706,6 +811,7 @@ struct mem_ctl_info *edac_mc_del_mc(struct device *dev)
 
 	if (mci->edac_check)
 		edac_stop_work(&mci->work);
+	edac_stop_work(&mci->storm_work);
 
 	/* remove from sysfs */
 	edac_remove_sysfs_mci_device(mci);
@@ -833,7 +939,9 @@ static void edac_ce_error(struct edac_raw_error_desc *e)
 	struct mem_ctl_info *mci = error_desc_to_mci(e);
 	unsigned long remapped_page;
 
-	if (edac_mc_get_log_ce()) {
+	edac_mc_ce_storm_account(mci, e->error_count);
+
+	if (edac_mc_get_log_ce() && !READ_ONCE(mci->ce_storm)) {
 		edac_mc_printk(mci, KERN_WARNING,
 			"%d CE %s%son %s (%s page:0x%lx offset:0x%lx grain:%ld syndrome:0x%lx%s%s)\n",
 			e->error_count, e->msg,
@@ -940,17 +1048,17 @@ void edac_raw_mc_handle_error(struct edac_raw_error_desc *e)
 }
 EXPORT_SYMBOL_GPL(edac_raw_mc_handle_error);
 
-void edac_mc_handle_error(const enum hw_event_mc_err_type type,
-			  struct mem_ctl_info *mci,
-			  const u16 error_count,
-			  const unsigned long page_frame_number,
-			  const unsigned long offset_in_page,
-			  const unsigned long syndrome,
-			  const int top_layer,
-			  const int mid_layer,
-			  const int low_layer,
-			  const char *msg,
-			  const char *other_detail)
+static void __edac_mc_handle_error(const enum hw_event_mc_err_type type,
+				   struct mem_ctl_info *mci,
+				   const u16 error_count,
+				   const unsigned long page_frame_number,
+				   const unsigned long offset_in_page,
+				   const unsigned long syndrome,
+				   const int top_layer,
+				   const int mid_layer,
+				   const int low_layer,
+				   const char *msg,
+				   const char *other_detail)
 {
 	struct dimm_info *dimm;
 	char *p, *end;
@@ -1088,4 +1196,172 @@ void edac_mc_handle_error(const enum hw_event_mc_err_type type,
 
 	edac_raw_mc_handle_error(e);
 }
+
+/*
+ * The CEs reported from interrupt context are queued to a per-CPU ring,
+ * written by its CPU with the interrupts disabled and emptied by
+ * edac_mc_ce_work, so that the labels lookup, the logging and the counters
+ * don't run in the interrupt handler.  The UEs are still reported right
+ * away, as they may have to panic.
+ */
+#define EDAC_MC_CE_RING_SIZE	16
+#define EDAC_MC_CE_STR_LEN	64
+
+struct edac_mc_ce_rec {
+	struct mem_ctl_info *mci;
+	unsigned long page_frame_number;
+	unsigned long offset_in_page;
+	unsigned long syndrome;
+	int pos[EDAC_MAX_LAYERS];
+	u16 error_count;
+	char msg[EDAC_MC_CE_STR_LEN];
+	char other_detail[EDAC_MC_CE_STR_LEN];
+};
+
+struct edac_mc_ce_ring {
+	unsigned int head;
+	unsigned int tail;
+	atomic_t lost;
+	struct edac_mc_ce_rec rec[EDAC_MC_CE_RING_SIZE];
+};
+
+static struct edac_mc_ce_ring __percpu *edac_mc_ce_rings;
+
+static bool edac_mc_is_listed(struct mem_ctl_info *mci)
+{
+	struct mem_ctl_info *p;
+
+	list_for_each_entry(p, &mc_devices, link)
+		if (p == mci)
+			return true;
+
+	return false;
+}
+
+static void edac_mc_ce_work_fn(struct work_struct *work)
+{
+	struct edac_mc_ce_ring *ring;
+	struct edac_mc_ce_rec *rec;
+	unsigned int tail, lost;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		ring = per_cpu_ptr(edac_mc_ce_rings, cpu);
+		tail = ring->tail;
+
+		mutex_lock(&mem_ctls_mutex);
+
+		while (tail != smp_load_acquire(&ring->head)) {
+			rec = &ring->rec[tail % EDAC_MC_CE_RING_SIZE];
+
+			/* the controller may be gone since */
+			if (edac_mc_is_listed(rec->mci))
+				__edac_mc_handle_error(HW_EVENT_ERR_CORRECTED,
+						       rec->mci,
+						       rec->error_count,
+						       rec->page_frame_number,
+						       rec->offset_in_page,
+						       rec->syndrome,
+						       rec->pos[0], rec->pos[1],
+						       rec->pos[2], rec->msg,
+						       rec->other_detail);
+
+			smp_store_release(&ring->tail, ++tail);
+		}
+
+		mutex_unlock(&mem_ctls_mutex);
+
+		lost = atomic_xchg(&ring->lost, 0);
+		if (lost)
+			printk_ratelimited(KERN_WARNING
+					   "EDAC " EDAC_MC ": CPU%d: %u CE reports lost\n",
+					   cpu, lost);
+	}
+}
+
+static DECLARE_WORK(edac_mc_ce_work, edac_mc_ce_work_fn);
+
+static void edac_mc_queue_ce(struct mem_ctl_info *mci,
+			     const u16 error_count,
+			     const unsigned long page_frame_number,
+			     const unsigned long offset_in_page,
+			     const unsigned long syndrome,
+			     const int top_layer,
+			     const int mid_layer,
+			     const int low_layer,
+			     const char *msg,
+			     const char *other_detail)
+{
+	struct edac_mc_ce_ring *ring;
+	struct edac_mc_ce_rec *rec;
+	unsigned long flags;
+	unsigned int head;
+
+	local_irq_save(flags);
+
+	ring = this_cpu_ptr(edac_mc_ce_rings);
+	head = ring->head;
+
+	if (head - smp_load_acquire(&ring->tail) >= EDAC_MC_CE_RING_SIZE) {
+		atomic_inc(&ring->lost);
+		/* still tell the storm detection about them */
+		edac_mc_ce_storm_account(mci, error_count);
+	} else {
+		rec = &ring->rec[head % EDAC_MC_CE_RING_SIZE];
+		rec->mci = mci;
+		rec->error_count = error_count;
+		rec->page_frame_number = page_frame_number;
+		rec->offset_in_page = offset_in_page;
+		rec->syndrome = syndrome;
+		rec->pos[0] = top_layer;
+		rec->pos[1] = mid_layer;
+		rec->pos[2] = low_layer;
+		strscpy(rec->msg, msg ?: "", sizeof(rec->msg));
+		strscpy(rec->other_detail, other_detail ?: "",
+			sizeof(rec->other_detail));
+
+		smp_store_release(&ring->head, head + 1);
+	}
+
+	local_irq_restore(flags);
+
+	schedule_work(&edac_mc_ce_work);
+}
+
+void edac_mc_handle_error(const enum hw_event_mc_err_type type,
+			  struct mem_ctl_info *mci,
+			  const u16 error_count,
+			  const unsigned long page_frame_number,
+			  const unsigned long offset_in_page,
+			  const unsigned long syndrome,
+			  const int top_layer,
+			  const int mid_layer,
+			  const int low_layer,
+			  const char *msg,
+			  const char *other_detail)
+{
+	if (type == HW_EVENT_ERR_CORRECTED && edac_mc_ce_rings &&
+	    !in_task() && !in_nmi())
+		edac_mc_queue_ce(mci, error_count, page_frame_number,
+				 offset_in_page, syndrome, top_layer,
+				 mid_layer, low_layer, msg, other_detail);
+	else
+		__edac_mc_handle_error(type, mci, error_count,
+				       page_frame_number, offset_in_page,
+				       syndrome, top_layer, mid_layer,
+				       low_layer, msg, other_detail);
+}
 EXPORT_SYMBOL_GPL(edac_mc_handle_error);
+
+/* Without the rings, the CEs are reported from the interrupt handlers. */
+void edac_mc_init(void)
+{
+	edac_mc_ce_rings = alloc_percpu(struct edac_mc_ce_ring);
+}
+
+void edac_mc_exit(void)
+{
+	cancel_work_sync(&edac_mc_ce_work);
+	free_percpu(edac_mc_ce_rings);
+	edac_mc_ce_rings = NULL;
+}
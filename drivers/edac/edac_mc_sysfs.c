@@ -27,6 +27,7 @@ static int edac_mc_log_ue = 1;
 static int edac_mc_log_ce = 1;
 static int edac_mc_panic_on_ue;
 static unsigned int edac_mc_poll_msec = 1000;
+static unsigned int edac_mc_ce_storm = 100;
 
 /* Getter functions for above */
 int edac_mc_get_log_ue(void)
@@ -44,6 +45,11 @@ int edac_mc_get_panic_on_ue(void)
 	return edac_mc_panic_on_ue;
 }
 
+unsigned int edac_mc_get_ce_storm(void)
+{
+	return READ_ONCE(edac_mc_ce_storm);
+}
+
 /* this is temporary */
 unsigned int edac_mc_get_poll_msec(void)
 {
@@ -85,6 +91,9 @@ MODULE_PARM_DESC(edac_mc_log_ce,
 module_param_call(edac_mc_poll_msec, edac_set_poll_msec, param_get_uint,
 		  &edac_mc_poll_msec, 0644);
 MODULE_PARM_DESC(edac_mc_poll_msec, "Polling period in milliseconds");
+module_param(edac_mc_ce_storm, uint, 0644);
+MODULE_PARM_DESC(edac_mc_ce_storm,
+		 "Correctable errors per second starting a CE storm: 0=off");
 
 static struct device *mci_pdev;
 
@@ -124,6 +124,8 @@ static int __init edac_init(void)
 
 	edac_debugfs_init();
 
+	edac_mc_init();
+
 	err = edac_workqueue_setup();
 	if (err) {
 		edac_printk(KERN_ERR, EDAC_MC, "Failure initializing workqueue\n");
@@ -133,6 +135,7 @@ static int __init edac_init(void)
 	return 0;
 
 err_wq:
+	edac_mc_exit();
 	edac_debugfs_exit();
 	edac_mc_sysfs_exit();
 
@@ -151,6 +154,7 @@ static void __exit edac_exit(void)
 	edac_dbg(0, "\n");
 
 	/* tear down the various subsystems */
+	edac_mc_exit();
 	edac_workqueue_teardown();
 	edac_mc_sysfs_exit();
 	edac_debugfs_exit();
@@ -32,10 +32,15 @@ extern int edac_mc_get_log_ue(void);
 extern int edac_mc_get_log_ce(void);
 extern int edac_mc_get_panic_on_ue(void);
 extern unsigned int edac_mc_get_poll_msec(void);
+extern unsigned int edac_mc_get_ce_storm(void);
 
 unsigned edac_dimm_info_location(struct dimm_info *dimm, char *buf,
 				 unsigned len);
 
+	/* on edac_mc.c */
+void edac_mc_init(void);
+void edac_mc_exit(void);
+
 	/* on edac_device.c */
 extern int edac_device_register_sysfs_main_kobj(
 				struct edac_device_ctl_info *edac_dev);
@@ -48,6 +48,49 @@ struct flash_device_info {
 	unsigned int erase_size;
 };
 
+#define RSU_SNAPSHOT_VERSION		1
+
+/**
+ * struct rsu_snapshot - state of RSU as returned by the snapshot attribute
+ * @version: layout version of this structure, RSU_SNAPSHOT_VERSION
+ * @generation: incremented every time a refresh finds the state changed
+ * @current_image: address of image currently running in flash
+ * @fail_image: address of failed image in flash
+ * @rsu_version: the interface version number of RSU firmware
+ * @state: the state of RSU system
+ * @error_location: the error offset inside the image that failed
+ * @error_details: error code
+ * @retry_counter: the current image's retry counter
+ * @max_retry: the preset max retry value
+ * @dcmf_version: Quartus dcmf0..3 versions
+ * @dcmf_status: dcmf0..3 status
+ * @spt0_address: address of spt0
+ * @spt1_address: address of spt1
+ * @size: flash sizes
+ * @erase_size: flash erase sizes
+ *
+ * All fields are native endian. Fields the firmware couldn't report hold
+ * the same invalid values the matching text attributes fail with.
+ */
+struct rsu_snapshot {
+	u32 version;
+	u32 generation;
+	u64 current_image;
+	u64 fail_image;
+	u32 rsu_version;
+	u32 state;
+	u32 error_location;
+	u32 error_details;
+	u32 retry_counter;
+	u32 max_retry;
+	u32 dcmf_version[4];
+	u32 dcmf_status[4];
+	u64 spt0_address;
+	u64 spt1_address;
+	u32 size[4];
+	u32 erase_size[4];
+} __packed;
+
 typedef void (*rsu_callback)(struct stratix10_svc_client *client,
 			     struct stratix10_svc_cb_data *data);
 /**
@@ -56,6 +99,9 @@ typedef void (*rsu_callback)(struct stratix10_svc_client *client,
  * @client: active service client
  * @completion: state for callback completion
  * @lock: a mutex to protect callback completion state
+ * @state_lock: a mutex serializing the refreshes of the cached state with
+ *	the snapshot reads, so a snapshot never mixes two refreshes
+ * @generation: number of refreshes which found the state changed
  * @status.current_image: address of image currently running in flash
  * @status.fail_image: address of failed image in flash
  * @status.version: the interface version number of RSU firmware
@@ -85,6 +131,8 @@ struct stratix10_rsu_priv {
 	struct stratix10_svc_client client;
 	struct completion completion;
 	struct mutex lock;
+	struct mutex state_lock;
+	u32 generation;
 	struct {
 		unsigned long current_image;
 		unsigned long fail_image;
@@ -432,6 +480,102 @@ static int rsu_send_msg(struct stratix10_rsu_priv *priv,
 	return ret;
 }
 
+/*
+ * Must be called with state_lock held. The generation isn't filled in, so
+ * two snapshots can be compared to tell whether the state changed.
+ */
+static void rsu_fill_snapshot(struct stratix10_rsu_priv *priv,
+			      struct rsu_snapshot *snap)
+{
+	int i;
+
+	memset(snap, 0, sizeof(*snap));
+	snap->version = RSU_SNAPSHOT_VERSION;
+	snap->current_image = priv->status.current_image;
+	snap->fail_image = priv->status.fail_image;
+	snap->rsu_version = priv->status.version;
+	snap->state = priv->status.state;
+	snap->error_location = priv->status.error_location;
+	snap->error_details = priv->status.error_details;
+	snap->retry_counter = priv->retry_counter;
+	snap->max_retry = priv->max_retry;
+	snap->dcmf_version[0] = priv->dcmf_version.dcmf0;
+	snap->dcmf_version[1] = priv->dcmf_version.dcmf1;
+	snap->dcmf_version[2] = priv->dcmf_version.dcmf2;
+	snap->dcmf_version[3] = priv->dcmf_version.dcmf3;
+	snap->dcmf_status[0] = priv->dcmf_status.dcmf0;
+	snap->dcmf_status[1] = priv->dcmf_status.dcmf1;
+	snap->dcmf_status[2] = priv->dcmf_status.dcmf2;
+	snap->dcmf_status[3] = priv->dcmf_status.dcmf3;
+	snap->spt0_address = priv->spt0_address;
+	snap->spt1_address = priv->spt1_address;
+	for (i = 0; i < ARRAY_SIZE(priv->device_info); i++) {
+		snap->size[i] = priv->device_info[i].size;
+		snap->erase_size[i] = priv->device_info[i].erase_size;
+	}
+}
+
+/**
+ * rsu_refresh() - update the cached RSU state from the firmware
+ * @priv: pointer to rsu private data
+ *
+ * The attributes are served from the state cached at probe time, which the
+ * firmware only changes on reboot or when notified. Query the parts which
+ * can change again, and tell user space with a change uevent, and a
+ * sysfs_notify() of the snapshot attribute, when they did.
+ *
+ * Returns 0 on success or a negative error code.
+ */
+static int rsu_refresh(struct stratix10_rsu_priv *priv)
+{
+	struct device *dev = priv->client.dev;
+	struct rsu_snapshot old, new;
+	char state[32], image[32];
+	char *envp[] = { state, image, NULL };
+	bool changed;
+	int ret;
+
+	mutex_lock(&priv->state_lock);
+	rsu_fill_snapshot(priv, &old);
+
+	ret = rsu_send_msg(priv, COMMAND_RSU_STATUS, 0, rsu_status_callback);
+	if (ret) {
+		dev_err(dev, "Error, getting RSU status %i\n", ret);
+		goto unlock;
+	}
+
+	ret = rsu_send_msg(priv, COMMAND_RSU_RETRY, 0, rsu_retry_callback);
+	if (ret) {
+		dev_err(dev, "Error, getting RSU retry %i\n", ret);
+		goto unlock;
+	}
+
+	ret = rsu_send_msg(priv, COMMAND_RSU_DCMF_STATUS, 0,
+			   rsu_dcmf_status_callback);
+	if (ret) {
+		dev_err(dev, "Error, getting DCMF status %i\n", ret);
+		goto unlock;
+	}
+
+unlock:
+	rsu_fill_snapshot(priv, &new);
+	changed = memcmp(&old, &new, sizeof(new));
+	if (changed)
+		priv->generation++;
+	mutex_unlock(&priv->state_lock);
+
+	/* a partial refresh may still have changed something */
+	if (changed) {
+		snprintf(state, sizeof(state), "RSU_STATE=0x%08x", new.state);
+		snprintf(image, sizeof(image), "RSU_CURRENT_IMAGE=0x%08llx",
+			 new.current_image);
+		kobject_uevent_env(&dev->kobj, KOBJ_CHANGE, envp);
+		sysfs_notify(&dev->kobj, NULL, "snapshot");
+	}
+
+	return ret;
+}
+
 /*
  * This driver exposes some optional features of the Intel Stratix 10 SoC FPGA.
  * The sysfs interfaces exposed here are FPGA Remote System Update (RSU)
@@ -676,22 +820,55 @@ static ssize_t notify_store(struct device *dev,
 	}
 
 	/* to get the updated state */
-	ret = rsu_send_msg(priv, COMMAND_RSU_STATUS,
-			   0, rsu_status_callback);
-	if (ret) {
-		dev_err(dev, "Error, getting RSU status %i\n", ret);
+	ret = rsu_refresh(priv);
+	if (ret)
 		return ret;
-	}
 
-	ret = rsu_send_msg(priv, COMMAND_RSU_RETRY, 0, rsu_retry_callback);
-	if (ret) {
-		dev_err(dev, "Error, getting RSU retry %i\n", ret);
+	return count;
+}
+
+static ssize_t refresh_store(struct device *dev,
+			     struct device_attribute *attr,
+			     const char *buf, size_t count)
+{
+	struct stratix10_rsu_priv *priv = dev_get_drvdata(dev);
+	bool refresh;
+	int ret;
+
+	if (!priv)
+		return -ENODEV;
+
+	ret = kstrtobool(buf, &refresh);
+	if (ret)
 		return ret;
+
+	if (refresh) {
+		ret = rsu_refresh(priv);
+		if (ret)
+			return ret;
 	}
 
 	return count;
 }
 
+static ssize_t snapshot_read(struct file *filp, struct kobject *kobj,
+			     struct bin_attribute *attr, char *buf,
+			     loff_t off, size_t count)
+{
+	struct stratix10_rsu_priv *priv = dev_get_drvdata(kobj_to_dev(kobj));
+	struct rsu_snapshot snap;
+
+	if (!priv)
+		return -ENODEV;
+
+	mutex_lock(&priv->state_lock);
+	rsu_fill_snapshot(priv, &snap);
+	snap.generation = priv->generation;
+	mutex_unlock(&priv->state_lock);
+
+	return memory_read_from_buffer(buf, count, &off, &snap, sizeof(snap));
+}
+
 static ssize_t size0_show(struct device *dev,
 			  struct device_attribute *attr, char *buf)
 {
@@ -862,6 +1039,7 @@ static DEVICE_ATTR_RO(erase_size2);
 static DEVICE_ATTR_RO(erase_size3);
 static DEVICE_ATTR_WO(reboot_image);
 static DEVICE_ATTR_WO(notify);
+static DEVICE_ATTR_WO(refresh);
 static DEVICE_ATTR_RO(spt0_address);
 static DEVICE_ATTR_RO(spt1_address);
 
@@ -892,12 +1070,25 @@ static struct attribute *rsu_attrs[] = {
 	&dev_attr_erase_size3.attr,
 	&dev_attr_reboot_image.attr,
 	&dev_attr_notify.attr,
+	&dev_attr_refresh.attr,
 	&dev_attr_spt0_address.attr,
 	&dev_attr_spt1_address.attr,
 	NULL
 };
 
-ATTRIBUTE_GROUPS(rsu);
+static BIN_ATTR_RO(snapshot, sizeof(struct rsu_snapshot));
+
+static struct bin_attribute *rsu_bin_attrs[] = {
+	&bin_attr_snapshot,
+	NULL
+};
+
+static const struct attribute_group rsu_group = {
+	.attrs = rsu_attrs,
+	.bin_attrs = rsu_bin_attrs,
+};
+
+__ATTRIBUTE_GROUPS(rsu);
 
 static int stratix10_rsu_probe(struct platform_device *pdev)
 {
@@ -953,6 +1144,7 @@ static int stratix10_rsu_probe(struct platform_device *pdev)
 	priv->device_info[3].erase_size = INVALID_DEVICE_INFO;
 
 	mutex_init(&priv->lock);
+	mutex_init(&priv->state_lock);
 	priv->chan = stratix10_svc_request_channel_byname(&priv->client,
 							  SVC_CLIENT_RSU);
 	if (IS_ERR(priv->chan)) {
@@ -0,0 +1,124 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Tracepoints of the Stratix10 service layer.
+ *
+ * A request is traced when a client sends it, at every SMC issued for it,
+ * at every poll of its status and once its client has been called back.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM	stratix10_svc
+
+#if !defined(_STRATIX10_SVC_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _STRATIX10_SVC_TRACE_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(svc_send,
+
+	TP_PROTO(const char *chan, u32 command, size_t size, bool urgent,
+		 int ret),
+
+	TP_ARGS(chan, command, size, urgent, ret),
+
+	TP_STRUCT__entry(
+		__string(chan, chan)
+		__field(u32, command)
+		__field(size_t, size)
+		__field(bool, urgent)
+		__field(int, ret)
+	),
+
+	TP_fast_assign(
+		__assign_str(chan, chan);
+		__entry->command = command;
+		__entry->size = size;
+		__entry->urgent = urgent;
+		__entry->ret = ret;
+	),
+
+	TP_printk("chan %s command %u size %zu%s ret %d",
+		  __get_str(chan), __entry->command, __entry->size,
+		  __entry->urgent ? " urgent" : "", __entry->ret)
+);
+
+TRACE_EVENT(svc_smc,
+
+	TP_PROTO(u32 command, unsigned long a0, unsigned long res, u64 ns),
+
+	TP_ARGS(command, a0, res, ns),
+
+	TP_STRUCT__entry(
+		__field(u32, command)
+		__field(unsigned long, a0)
+		__field(unsigned long, res)
+		__field(u64, ns)
+	),
+
+	TP_fast_assign(
+		__entry->command = command;
+		__entry->a0 = a0;
+		__entry->res = res;
+		__entry->ns = ns;
+	),
+
+	TP_printk("command %u a0 0x%lx res 0x%lx ns %llu",
+		  __entry->command, __entry->a0, __entry->res, __entry->ns)
+);
+
+TRACE_EVENT(svc_poll,
+
+	TP_PROTO(u32 command, unsigned long res, int poll_count),
+
+	TP_ARGS(command, res, poll_count),
+
+	TP_STRUCT__entry(
+		__field(u32, command)
+		__field(unsigned long, res)
+		__field(int, poll_count)
+	),
+
+	TP_fast_assign(
+		__entry->command = command;
+		__entry->res = res;
+		__entry->poll_count = poll_count;
+	),
+
+	TP_printk("command %u res 0x%lx polls left %d",
+		  __entry->command, __entry->res, __entry->poll_count)
+);
+
+TRACE_EVENT(svc_complete,
+
+	TP_PROTO(u32 command, u64 queue_us, u64 smc_us, u64 total_us),
+
+	TP_ARGS(command, queue_us, smc_us, total_us),
+
+	TP_STRUCT__entry(
+		__field(u32, command)
+		__field(u64, queue_us)
+		__field(u64, smc_us)
+		__field(u64, total_us)
+	),
+
+	TP_fast_assign(
+		__entry->command = command;
+		__entry->queue_us = queue_us;
+		__entry->smc_us = smc_us;
+		__entry->total_us = total_us;
+	),
+
+	TP_printk("command %u queue_us %llu smc_us %llu total_us %llu",
+		  __entry->command, __entry->queue_us, __entry->smc_us,
+		  __entry->total_us)
+);
+
+#endif /* _STRATIX10_SVC_TRACE_H */
+
+/* We don't want to use include/trace/events */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE	stratix10-svc-trace
+/* This part must be outside protection */
+#include <trace/define_trace.h>
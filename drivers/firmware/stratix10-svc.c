@@ -4,8 +4,12 @@
  */
 
 #include <linux/completion.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
+#include <linux/error-injection.h>
 #include <linux/genalloc.h>
+#include <linux/hashtable.h>
+#include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/kfifo.h>
 #include <linux/kthread.h>
@@ -14,6 +18,8 @@
 #include <linux/of.h>
 #include <linux/of_platform.h>
 #include <linux/platform_device.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/firmware/intel/stratix10-smc.h>
@@ -22,8 +28,16 @@
 #include <linux/iommu.h>
 #include <linux/iova.h>
 
+#define CREATE_TRACE_POINTS
+#include "stratix10-svc-trace.h"
+
 /**
- * SVC_NUM_DATA_IN_FIFO - number of struct stratix10_svc_data in the FIFO
+ * SVC_NUM_DATA_IN_FIFO - default number of struct stratix10_svc_data in the
+ * FIFO, can be overridden with the fifo_depth module parameter
+ *
+ * SVC_SDM_QUANTUM - default number of back to back commands a channel may
+ * issue before giving other channels a turn at the SDM, can be overridden
+ * with the sdm_quantum module parameter
  *
  * SVC_NUM_CHANNEL - number of channel supported by service layer driver
  *
@@ -42,14 +56,42 @@
  *
  * FPGA_CONFIG_POLL_COUNT_SLOW - number of count for polling service status for
  * slow response commands. Count is set to 58 (58*500ms=29sec)
+ *
+ * SVC_POLL_MIN_DELAY_US - first delay of the adaptive polling ramp used when
+ * there is no SDM doorbell interrupt. The delay doubles on every poll until
+ * it reaches the regular poll interval.
+ *
+ * SVC_LAT_NUM_BUCKETS - number of log2(us) buckets of the per-command latency
+ * histogram, the last bucket collects everything above ~0.5 sec.
+ *
+ * SVC_LAT_NUM_CMDS - number of command codes tracked by the histogram.
+ *
+ * SVC_MEM_HASH_BITS - log2 of the number of buckets of the VA and PA lookup
+ * tables of the allocated buffers.
+ *
+ * SVC_MEM_MAG_MIN_ORDER, SVC_MEM_MAG_MAX_ORDER - range of the power of two
+ * size classes cached in the per-channel magazines. Larger buffers always go
+ * back to the pool.
+ *
+ * SVC_MEM_MAG_DEPTH - number of freed buffers a channel keeps per size class.
  */
-#define SVC_NUM_DATA_IN_FIFO			8
+#define SVC_NUM_DATA_IN_FIFO			32
+#define SVC_SDM_QUANTUM				4
 #define SVC_NUM_CHANNEL					4
 #define FPGA_CONFIG_DATA_CLAIM_TIMEOUT_MS	2000
 #define FPGA_CONFIG_POLL_INTERVAL_MS_FAST	20
 #define FPGA_CONFIG_POLL_INTERVAL_MS_SLOW	500
 #define FPGA_CONFIG_POLL_COUNT_FAST		50
 #define FPGA_CONFIG_POLL_COUNT_SLOW		58
+#define SVC_POLL_MIN_DELAY_US			50
+#define SVC_LAT_NUM_BUCKETS			21
+#define SVC_LAT_NUM_CMDS			(COMMAND_SMC_SVC_VERSION + 1)
+#define SVC_MEM_HASH_BITS			7
+#define SVC_MEM_MAG_MIN_ORDER			6
+#define SVC_MEM_MAG_MAX_ORDER			14
+#define SVC_MEM_MAG_NUM_CLASSES			\
+	(SVC_MEM_MAG_MAX_ORDER - SVC_MEM_MAG_MIN_ORDER + 1)
+#define SVC_MEM_MAG_DEPTH			8
 #define AGILEX5_SDM_DMA_ADDR_OFFSET		0x80000000
 #define BYTE_TO_WORD_SIZE				4
 #define IOMMU_LIMIT_ADDR			0x20000000
@@ -58,6 +100,15 @@
 /* stratix10 service layer clients */
 #define STRATIX10_RSU				"stratix10-rsu"
 
+static unsigned int fifo_depth = SVC_NUM_DATA_IN_FIFO;
+module_param(fifo_depth, uint, 0444);
+MODULE_PARM_DESC(fifo_depth, "Number of requests queued per service channel");
+
+static unsigned int sdm_quantum = SVC_SDM_QUANTUM;
+module_param(sdm_quantum, uint, 0644);
+MODULE_PARM_DESC(sdm_quantum,
+		 "Commands a channel may issue in a row while others wait for the SDM");
+
 typedef void (svc_invoke_fn)(unsigned long, unsigned long, unsigned long,
 			     unsigned long, unsigned long, unsigned long,
 			     unsigned long, unsigned long,
@@ -100,17 +151,51 @@ struct stratix10_svc_sh_memory {
  * @vaddr: virtual address
  * @paddr: physical address
  * @size: size of memory
- * @node: link list head node
+ * @mag_class: magazine size class of the buffer, or -1 if it is not cached
+ * @va_node: node in the VA lookup table
+ * @pa_node: node in the PA lookup table
  *
- * This struct is used in a list that keeps track of buffers which have
- * been allocated or freed from the memory pool. Service layer driver also
- * uses this struct to transfer physical address to virtual address.
+ * This struct is used in hash tables that keep track of buffers which have
+ * been allocated from the memory pool. Service layer driver also uses this
+ * struct to transfer physical address to virtual address.
  */
 struct stratix10_svc_data_mem {
 	void *vaddr;
 	phys_addr_t paddr;
 	size_t size;
-	struct list_head node;
+	int mag_class;
+	struct hlist_node va_node;
+	struct hlist_node pa_node;
+};
+
+/**
+ * struct stratix10_svc_mem_mag - per-channel cache of freed buffers
+ * @count: number of cached buffers
+ * @mem: cached buffers, still allocated from the pool
+ */
+struct stratix10_svc_mem_mag {
+	unsigned int count;
+	struct stratix10_svc_data_mem *mem[SVC_MEM_MAG_DEPTH];
+};
+
+/**
+ * struct stratix10_svc_mem_stats - shared memory usage statistics
+ * @allocs: number of successful allocations
+ * @frees: number of frees
+ * @mag_hits: allocations served from a magazine
+ * @failures: failed allocations
+ * @live: number of buffers currently allocated by clients
+ * @in_use: bytes currently allocated by clients
+ * @high_water: highest value reached by @in_use
+ */
+struct stratix10_svc_mem_stats {
+	u64 allocs;
+	u64 frees;
+	u64 mag_hits;
+	u64 failures;
+	unsigned int live;
+	size_t in_use;
+	size_t high_water;
 };
 
 /**
@@ -123,6 +208,9 @@ struct stratix10_svc_data_mem {
  * @command: service command requested by client
  * @flag: configuration type (full or partial)
  * @arg: args to be passed via registers and not physically mapped buffers
+ * @queued: time the request was put into the FIFO
+ * @started: time the request got the SDM
+ * @smc_ns: time spent in the SMCs issued for the request
  *
  * This struct is used in service FIFO for inter-process communication.
  */
@@ -135,6 +223,32 @@ struct stratix10_svc_data {
 	u32 command;
 	u32 flag;
 	u64 arg[6];
+	ktime_t queued;
+	ktime_t started;
+	u64 smc_ns;
+};
+
+/**
+ * struct stratix10_svc_lat_hist - latency histogram of a service command
+ * @count: number of completed requests
+ * @total_us: sum of the request latencies
+ * @queue_us: sum of the times the requests waited for the SDM
+ * @smc_us: sum of the times spent in the SMCs of the requests
+ * @max_us: highest request latency
+ * @bucket: request count per log2(us) latency bucket
+ *
+ * Latency is measured from stratix10_svc_send() until the response has been
+ * handed to the client callback, so it includes queueing and polling time.
+ * What is left once the queueing and SMC times are taken out is the time
+ * spent waiting between the polls.
+ */
+struct stratix10_svc_lat_hist {
+	u64 count;
+	u64 total_us;
+	u64 queue_us;
+	u64 smc_us;
+	u64 max_us;
+	u32 bucket[SVC_LAT_NUM_BUCKETS];
 };
 
 /**
@@ -154,6 +268,13 @@ struct stratix10_svc_data {
  * @sdm_dma_addr_offset: dma addr offset to append to the IOVA sent to SDM
  * @carveout: iova_domain used to allocate iova addr that is accessible by SDM
  * @svc: manages the list of client svc drivers
+ * @sdm_irq: SDM mailbox doorbell interrupt, or negative if there is none
+ * @sdm_irq_done: signalled by the SDM doorbell interrupt
+ * @poll_min_delay_us: first delay of the adaptive polling ramp
+ * @lat_hist: per-command latency histograms, updated under @sdm_lock
+ * @debugfs_dir: debugfs directory of the service layer
+ * @mem_stats: shared memory usage statistics, updated under svc_mem_lock
+ * @nr_urgent: number of urgent requests queued on all the channels
  *
  * This struct is used to create communication channels for service clients, to
  * handle secure monitor or hypervisor call.
@@ -177,6 +298,13 @@ struct stratix10_svc_controller {
 		unsigned long limit;
 	} carveout;
 	struct stratix10_svc *svc;
+	int sdm_irq;
+	struct completion sdm_irq_done;
+	u32 poll_min_delay_us;
+	struct stratix10_svc_lat_hist *lat_hist;
+	struct dentry *debugfs_dir;
+	struct stratix10_svc_mem_stats mem_stats;
+	atomic_t nr_urgent;
 };
 
 /**
@@ -187,7 +315,10 @@ struct stratix10_svc_controller {
  * @lock: protect access to the channel
  * @task: pointer to the thread task which handles SMC or HVC call
  * @svc_fifo: svc fifo circular buffer
- * @svc_fifo_lock: svc fifo lock
+ * @svc_fifo_urgent: fifo of the requests served before those of @svc_fifo
+ * @svc_fifo_lock: svc fifo lock, for both fifos
+ * @svc_wq: wait queue the channel thread sleeps on while the FIFO is empty
+ * @mag: magazines of freed buffers per size class, protected by @lock
  *
  * This struct is used by service client to communicate with service layer, each
  * service client has its own channel created by service controller.
@@ -199,12 +330,45 @@ struct stratix10_svc_chan {
 	struct task_struct *task;
 	/* Separate fifo for every channel */
 	struct kfifo svc_fifo;
+	struct kfifo svc_fifo_urgent;
 	spinlock_t svc_fifo_lock;
+	wait_queue_head_t svc_wq;
 	spinlock_t lock;
+	struct stratix10_svc_mem_mag mag[SVC_MEM_MAG_NUM_CLASSES];
 };
 
 static LIST_HEAD(svc_ctrl);
-static LIST_HEAD(svc_data_mem);
+
+/* allocated buffers, looked up by virtual and by physical address */
+static DEFINE_SPINLOCK(svc_mem_lock);
+static DEFINE_HASHTABLE(svc_mem_va_hash, SVC_MEM_HASH_BITS);
+static DEFINE_HASHTABLE(svc_mem_pa_hash, SVC_MEM_HASH_BITS);
+
+/**
+ * svc_mem_va_to_pa() - translate virtual address to physical address
+ * @addr: to be translated virtual address, as returned to the client
+ * @paddr: returned physical address
+ *
+ * Return: true if @addr is an allocated buffer, false otherwise.
+ */
+static bool svc_mem_va_to_pa(const void *addr, phys_addr_t *paddr)
+{
+	struct stratix10_svc_data_mem *pmem;
+	unsigned long flags;
+	bool found = false;
+
+	spin_lock_irqsave(&svc_mem_lock, flags);
+	hash_for_each_possible(svc_mem_va_hash, pmem, va_node,
+			       (unsigned long)addr)
+		if (pmem->vaddr == addr) {
+			*paddr = pmem->paddr;
+			found = true;
+			break;
+		}
+	spin_unlock_irqrestore(&svc_mem_lock, flags);
+
+	return found;
+}
 
 /**
  * svc_pa_to_va() - translate physical address to virtual address
@@ -216,14 +380,52 @@ static LIST_HEAD(svc_data_mem);
 static void *svc_pa_to_va(unsigned long addr)
 {
 	struct stratix10_svc_data_mem *pmem;
+	unsigned long flags;
+	void *vaddr = NULL;
 
 	pr_debug("claim back P-addr=0x%016x\n", (unsigned int)addr);
-	list_for_each_entry(pmem, &svc_data_mem, node)
-		if (pmem->paddr == addr)
-			return pmem->vaddr;
+	spin_lock_irqsave(&svc_mem_lock, flags);
+	hash_for_each_possible(svc_mem_pa_hash, pmem, pa_node, addr)
+		if (pmem->paddr == addr) {
+			vaddr = pmem->vaddr;
+			break;
+		}
+	spin_unlock_irqrestore(&svc_mem_lock, flags);
 
-	/* physical address is not found */
-	return NULL;
+	/* NULL if the physical address is not found */
+	return vaddr;
+}
+
+/**
+ * svc_smc() - issue an SMC on behalf of a request
+ * @ctrl: pointer to service layer controller
+ * @p_data: pointer to service data structure
+ * @a0: function ID of the call
+ * @a1: argument 1 of the call
+ * @a2: argument 2 of the call
+ * @a3: argument 3 of the call
+ * @a4: argument 4 of the call
+ * @a5: argument 5 of the call
+ * @a6: argument 6 of the call
+ * @a7: argument 7 of the call
+ * @res: pointer to store response
+ *
+ * Accounts the time spent in the secure world to the request.
+ */
+static void svc_smc(struct stratix10_svc_controller *ctrl,
+		    struct stratix10_svc_data *p_data,
+		    unsigned long a0, unsigned long a1, unsigned long a2,
+		    unsigned long a3, unsigned long a4, unsigned long a5,
+		    unsigned long a6, unsigned long a7,
+		    struct arm_smccc_res *res)
+{
+	u64 start = ktime_get_ns(), ns;
+
+	ctrl->invoke_fn(a0, a1, a2, a3, a4, a5, a6, a7, res);
+
+	ns = ktime_get_ns() - start;
+	p_data->smc_ns += ns;
+	trace_svc_smc(p_data->command, a0, res->a0, ns);
 }
 
 /**
@@ -249,8 +451,8 @@ static void svc_thread_cmd_data_claim(struct stratix10_svc_controller *ctrl,
 
 	pr_debug("%s: claim back the submitted buffer\n", __func__);
 	do {
-		ctrl->invoke_fn(INTEL_SIP_SMC_FPGA_CONFIG_COMPLETED_WRITE,
-				0, 0, 0, 0, 0, 0, 0, &res);
+		svc_smc(ctrl, p_data, INTEL_SIP_SMC_FPGA_CONFIG_COMPLETED_WRITE,
+			0, 0, 0, 0, 0, 0, 0, &res);
 
 		if (res.a0 == INTEL_SIP_SMC_STATUS_OK) {
 			if (!res.a1) {
@@ -296,13 +498,26 @@ static void svc_thread_cmd_data_claim(struct stratix10_svc_controller *ctrl,
  *
  * Check whether the service at secure world has completed, and then inform the
  * response.
+ *
+ * When the SDM doorbell interrupt is available the thread sleeps until either
+ * the doorbell fires or the poll interval expires. Otherwise the delay between
+ * polls starts at poll_min_delay_us and doubles up to the poll interval, so a
+ * fast command is noticed within microseconds instead of after a full jiffy
+ * rounded msleep(). Only polls at the full interval consume @poll_count, which
+ * keeps the overall timeout unchanged.
+ *
+ * The waits are accounted as I/O waits, so the CPU frequency isn't lowered
+ * just before the SDM answers.
  */
 static void svc_cmd_poll_status(struct stratix10_svc_data *p_data,
 				struct stratix10_svc_controller *ctrl,
 				struct arm_smccc_res *res,
 				int *poll_count, int poll_interval_in_ms)
 {
+	unsigned long interval_us = poll_interval_in_ms * USEC_PER_MSEC;
+	unsigned long delay_us = ctrl->poll_min_delay_us;
 	unsigned long a0, a1, a2;
+	int token;
 
 	a0 = INTEL_SIP_SMC_FPGA_CONFIG_ISDONE;
 	a1 = (unsigned long)p_data->paddr;
@@ -311,8 +526,14 @@ static void svc_cmd_poll_status(struct stratix10_svc_data *p_data,
 	if (p_data->command == COMMAND_POLL_SERVICE_STATUS)
 		a0 = INTEL_SIP_SMC_SERVICE_COMPLETED;
 
+	token = io_schedule_prepare();
+
 	while (*poll_count) {
-		ctrl->invoke_fn(a0, a1, a2, 0, 0, 0, 0, 0, res);
+		if (ctrl->sdm_irq > 0)
+			reinit_completion(&ctrl->sdm_irq_done);
+
+		svc_smc(ctrl, p_data, a0, a1, a2, 0, 0, 0, 0, 0, res);
+		trace_svc_poll(p_data->command, res->a0, *poll_count);
 		if ((res->a0 == INTEL_SIP_SMC_STATUS_OK) ||
 		    (res->a0 == INTEL_SIP_SMC_STATUS_ERROR) ||
 		    (res->a0 == INTEL_SIP_SMC_STATUS_REJECTED))
@@ -322,9 +543,57 @@ static void svc_cmd_poll_status(struct stratix10_svc_data *p_data,
 		 * request is still in progress, go to sleep then
 		 * poll again
 		 */
+		if (ctrl->sdm_irq > 0) {
+			if (!wait_for_completion_timeout(&ctrl->sdm_irq_done,
+					msecs_to_jiffies(poll_interval_in_ms)))
+				(*poll_count)--;
+			continue;
+		}
+
+		if (delay_us && delay_us < interval_us) {
+			usleep_range(delay_us, delay_us * 2);
+			delay_us *= 2;
+			continue;
+		}
+
 		msleep(poll_interval_in_ms);
 		(*poll_count)--;
 	}
+
+	io_schedule_finish(token);
+}
+
+/**
+ * svc_record_latency() - account a completed request in its histogram
+ * @ctrl: pointer to service layer controller
+ * @p_data: pointer to service data structure
+ *
+ * Must be called with ctrl->sdm_lock held.
+ */
+static void svc_record_latency(struct stratix10_svc_controller *ctrl,
+			       struct stratix10_svc_data *p_data)
+{
+	struct stratix10_svc_lat_hist *hist;
+	u64 us, queue_us, smc_us;
+
+	us = ktime_us_delta(ktime_get(), p_data->queued);
+	queue_us = ktime_us_delta(p_data->started, p_data->queued);
+	smc_us = div_u64(p_data->smc_ns, NSEC_PER_USEC);
+	trace_svc_complete(p_data->command, queue_us, smc_us, us);
+
+	if (!ctrl->lat_hist || p_data->command >= SVC_LAT_NUM_CMDS)
+		return;
+
+	hist = &ctrl->lat_hist[p_data->command];
+
+	hist->count++;
+	hist->total_us += us;
+	hist->queue_us += queue_us;
+	hist->smc_us += smc_us;
+	if (us > hist->max_us)
+		hist->max_us = us;
+	hist->bucket[us ? min_t(u64, ilog2(us) + 1,
+				SVC_LAT_NUM_BUCKETS - 1) : 0]++;
 }
 
 /**
@@ -527,6 +796,42 @@ static void svc_thread_recv_status_ok(struct stratix10_svc_data *p_data,
 		p_data->chan->scl->receive_cb(p_data->chan->scl, cb_data);
 }
 
+/**
+ * svc_request_urgent() - BPF hook to prioritize a service request
+ * @chan_id: channel of the request: 0 for FPGA, 1 for RSU, 2 for FCS and
+ *	     3 for HWMON
+ * @command: command of the request
+ * @size: size of the request payload
+ *
+ * Called by stratix10_svc_send() before queuing the request. A BPF
+ * fmod_ret program attached here can return true to have the request served
+ * before the normal requests of its channel, and the channel owning the SDM
+ * give it up after the command in progress rather than after sdm_quantum
+ * commands.
+ *
+ * Return: false for a normal request, true for an urgent one.
+ */
+static noinline bool svc_request_urgent(u32 chan_id, u32 command, size_t size)
+{
+	return false;
+}
+ALLOW_ERROR_INJECTION(svc_request_urgent, TRUE);
+
+static bool svc_fifo_is_empty(struct stratix10_svc_chan *chan)
+{
+	return kfifo_is_empty(&chan->svc_fifo_urgent) &&
+	       kfifo_is_empty(&chan->svc_fifo);
+}
+
+/* Whether another channel has urgent requests waiting for the SDM */
+static bool svc_urgent_elsewhere(struct stratix10_svc_chan *chan)
+{
+	unsigned int queued = kfifo_len(&chan->svc_fifo_urgent) /
+			      sizeof(struct stratix10_svc_data);
+
+	return atomic_read(&chan->ctrl->nr_urgent) > queued;
+}
+
 /**
  * svc_normal_to_secure_thread() - the function to run in the kthread
  * @data: data pointer for kthread function
@@ -535,6 +840,11 @@ static void svc_thread_recv_status_ok(struct stratix10_svc_data *p_data,
  * node 0, its function stratix10_svc_secure_call_thread is used to handle
  * SMC or HVC calls between kernel driver and secure monitor software.
  *
+ * Every channel has its own thread, and the SDM is shared between them with
+ * ctrl->sdm_lock. A thread holds the lock only while it has requests queued
+ * and gives it up after sdm_quantum commands in a row, so a long bitstream
+ * transfer can not starve latency sensitive crypto or RSU requests.
+ *
  * Return: 0 for success or -ENOMEM on error.
  */
 static int svc_normal_to_secure_thread(void *data)
@@ -547,6 +857,7 @@ static int svc_normal_to_secure_thread(void *data)
 	unsigned long a0, a1, a2, a3, a4, a5, a6, a7;
 	int ret_fifo = 0;
 	bool sdm_lock_owned = false;
+	unsigned int served = 0;
 
 	pdata =  kmalloc(sizeof(*pdata), GFP_KERNEL);
 	if (!pdata)
@@ -572,9 +883,28 @@ static int svc_normal_to_secure_thread(void *data)
 
 	while (!kthread_should_stop()) {
 
-		ret_fifo = kfifo_out_spinlocked(&chan->svc_fifo,
+		if (sdm_lock_owned &&
+		    (svc_fifo_is_empty(chan) ||
+		     served >= READ_ONCE(sdm_quantum) ||
+		     svc_urgent_elsewhere(chan))) {
+			mutex_unlock(ctrl->sdm_lock);
+			sdm_lock_owned = false;
+			served = 0;
+		}
+
+		wait_event_interruptible(chan->svc_wq,
+					 !svc_fifo_is_empty(chan) ||
+					 kthread_should_stop());
+
+		ret_fifo = kfifo_out_spinlocked(&chan->svc_fifo_urgent,
 					pdata, sizeof(*pdata),
 					&chan->svc_fifo_lock);
+		if (ret_fifo)
+			atomic_dec(&ctrl->nr_urgent);
+		else
+			ret_fifo = kfifo_out_spinlocked(&chan->svc_fifo,
+						pdata, sizeof(*pdata),
+						&chan->svc_fifo_lock);
 
 		if (!ret_fifo)
 			continue;
@@ -592,10 +922,14 @@ static int svc_normal_to_secure_thread(void *data)
 		}
 
 		sdm_lock_owned = true;
+		served++;
+		pdata->started = ktime_get();
+		pdata->smc_ns = 0;
 
 		switch (pdata->command) {
 		case COMMAND_RECONFIG_DATA_CLAIM:
 			svc_thread_cmd_data_claim(ctrl, pdata, cbdata);
+			svc_record_latency(ctrl, pdata);
 			continue;
 		case COMMAND_RECONFIG:
 			a0 = INTEL_SIP_SMC_FPGA_CONFIG_START;
@@ -1143,7 +1477,7 @@ static int svc_normal_to_secure_thread(void *data)
 		pr_debug(" a3=0x%016x\n", (unsigned int)a3);
 		pr_debug(" a4=0x%016x\n", (unsigned int)a4);
 		pr_debug(" a5=0x%016x\n", (unsigned int)a5);
-		ctrl->invoke_fn(a0, a1, a2, a3, a4, a5, a6, a7, &res);
+		svc_smc(ctrl, pdata, a0, a1, a2, a3, a4, a5, a6, a7, &res);
 
 		pr_debug("%s: %s: after SMC call -- res.a0=0x%016x",
 			 __func__, chan->name, (unsigned int)res.a0);
@@ -1161,6 +1495,7 @@ static int svc_normal_to_secure_thread(void *data)
 			cbdata->kaddr2 = NULL;
 			cbdata->kaddr3 = NULL;
 			pdata->chan->scl->receive_cb(pdata->chan->scl, cbdata);
+			svc_record_latency(ctrl, pdata);
 			mutex_unlock(ctrl->sdm_lock);
 			sdm_lock_owned = false;
 			continue;
@@ -1300,6 +1635,7 @@ static int svc_normal_to_secure_thread(void *data)
 			break;
 
 		}
+		svc_record_latency(ctrl, pdata);
 	}
 	pr_debug("%s: %s: Exit thread\n", __func__, chan->name);
 	if (sdm_lock_owned == true)
@@ -1603,10 +1939,13 @@ int stratix10_svc_send(struct stratix10_svc_chan *chan, void *msg)
 {
 	struct stratix10_svc_client_msg
 		*p_msg = (struct stratix10_svc_client_msg *)msg;
-	struct stratix10_svc_data_mem *p_mem;
 	struct stratix10_svc_data *p_data;
+	struct kfifo *fifo = &chan->svc_fifo;
+	phys_addr_t paddr;
 	int ret = 0;
+	bool urgent;
 	unsigned int cpu = 0;
+	unsigned long flags;
 	phys_addr_t *src_addr;
 	phys_addr_t *dst_addr;
 
@@ -1635,7 +1974,7 @@ int stratix10_svc_send(struct stratix10_svc_chan *chan, void *msg)
 		 chan->name, p_msg->payload, p_msg->command,
 		 (unsigned int)p_msg->payload_length);
 
-	if (list_empty(&svc_data_mem)) {
+	if (hash_empty(svc_mem_va_hash)) {
 		if (p_msg->command == COMMAND_RECONFIG) {
 			struct stratix10_svc_command_config_type *ct =
 				(struct stratix10_svc_command_config_type *)
@@ -1671,31 +2010,25 @@ int stratix10_svc_send(struct stratix10_svc_chan *chan, void *msg)
 			src_addr = (phys_addr_t *)p_msg->payload;
 			p_data->paddr = *src_addr;
 			p_data->size = p_msg->payload_length;
-			list_for_each_entry(p_mem, &svc_data_mem, node)
-				if (p_mem->vaddr == p_msg->payload_output) {
-					p_data->paddr_output = p_mem->paddr;
-					p_data->size_output = p_msg->payload_length_output;
-					break;
-				}
+			if (svc_mem_va_to_pa(p_msg->payload_output, &paddr)) {
+				p_data->paddr_output = paddr;
+				p_data->size_output = p_msg->payload_length_output;
+			}
 		} else {
-			list_for_each_entry(p_mem, &svc_data_mem, node)
-				if (p_mem->vaddr == p_msg->payload) {
-					p_data->paddr = p_mem->paddr;
-					p_data->size = p_msg->payload_length;
-					if(p_msg->command == COMMAND_RECONFIG_DATA_SUBMIT && chan->ctrl->is_smmu_enabled)
-						p_data->paddr += chan->ctrl->sdm_dma_addr_offset;
-				}
-			if (p_msg->payload_output) {
-				list_for_each_entry(p_mem, &svc_data_mem, node)
-					if (p_mem->vaddr == p_msg->payload_output) {
-						p_data->paddr_output =
-							(p_msg->command == COMMAND_MBOX_SEND_CMD
-							&& chan->ctrl->is_smmu_enabled) ?
-							virt_to_phys(p_mem->vaddr) : p_mem->paddr;
-						p_data->size_output =
-							p_msg->payload_length_output;
-						break;
-					}
+			if (svc_mem_va_to_pa(p_msg->payload, &paddr)) {
+				p_data->paddr = paddr;
+				p_data->size = p_msg->payload_length;
+				if(p_msg->command == COMMAND_RECONFIG_DATA_SUBMIT && chan->ctrl->is_smmu_enabled)
+					p_data->paddr += chan->ctrl->sdm_dma_addr_offset;
+			}
+			if (p_msg->payload_output &&
+			    svc_mem_va_to_pa(p_msg->payload_output, &paddr)) {
+				p_data->paddr_output =
+					(p_msg->command == COMMAND_MBOX_SEND_CMD
+					&& chan->ctrl->is_smmu_enabled) ?
+					virt_to_phys(p_msg->payload_output) : paddr;
+				p_data->size_output =
+					p_msg->payload_length_output;
 			}
 		}
 	}
@@ -1708,6 +2041,7 @@ int stratix10_svc_send(struct stratix10_svc_chan *chan, void *msg)
 	p_data->arg[4] = p_msg->arg[4];
 	p_data->arg[5] = p_msg->arg[5];
 	p_data->chan = chan;
+	p_data->queued = ktime_get();
 	pr_debug("%s: %s: put to FIFO pa=0x%016x, cmd=%x, size=%u\n",
 			__func__,
 			chan->name,
@@ -1715,15 +2049,28 @@ int stratix10_svc_send(struct stratix10_svc_chan *chan, void *msg)
 			p_data->command,
 			(unsigned int)p_data->size);
 
-	ret = kfifo_in_spinlocked(&chan->svc_fifo, p_data,
-					sizeof(*p_data),
-					&chan->svc_fifo_lock);
-
+	urgent = svc_request_urgent(chan - chan->ctrl->chans,
+				    p_data->command, p_data->size);
+	if (urgent)
+		fifo = &chan->svc_fifo_urgent;
+
+	/* never queue a partial request into the byte FIFO */
+	spin_lock_irqsave(&chan->svc_fifo_lock, flags);
+	if (kfifo_avail(fifo) >= sizeof(*p_data))
+		ret = kfifo_in(fifo, p_data, sizeof(*p_data));
+	if (ret && urgent)
+		atomic_inc(&chan->ctrl->nr_urgent);
+	spin_unlock_irqrestore(&chan->svc_fifo_lock, flags);
+
+	trace_svc_send(chan->name, p_data->command, p_data->size, urgent,
+		       ret ? 0 : -ENOBUFS);
 	kfree(p_data);
 
 	if (!ret)
 		return -ENOBUFS;
 
+	wake_up(&chan->svc_wq);
+
 	return 0;
 }
 EXPORT_SYMBOL_GPL(stratix10_svc_send);
@@ -1758,56 +2105,109 @@ void stratix10_svc_done(struct stratix10_svc_chan *chan)
 EXPORT_SYMBOL_GPL(stratix10_svc_done);
 
 /**
- * stratix10_svc_allocate_memory() - allocate memory
- * @chan: service channel assigned to the client
- * @size: memory size requested by a specific service client
- *
- * Service layer allocates the requested number of bytes buffer from the
- * memory pool, service client uses this function to get allocated buffers.
+ * svc_mem_mag_class() - magazine size class of an allocation
+ * @size: requested size
  *
- * Return: address of allocated memory on success, or ERR_PTR() on error.
+ * Return: size class, or -1 if buffers of @size are not cached.
  */
-void *stratix10_svc_allocate_memory(struct stratix10_svc_chan *chan,
-				    size_t size)
+static int svc_mem_mag_class(size_t size)
+{
+	int order;
+
+	if (!size || size > BIT(SVC_MEM_MAG_MAX_ORDER))
+		return -1;
+
+	order = max_t(int, fls_long(size - 1), SVC_MEM_MAG_MIN_ORDER);
+
+	return order - SVC_MEM_MAG_MIN_ORDER;
+}
+
+/**
+ * svc_mem_release() - give a buffer back to the pool or the page allocator
+ * @ctrl: service controller the buffer was allocated from
+ * @pmem: buffer, no longer in the lookup tables
+ */
+static void svc_mem_release(struct stratix10_svc_controller *ctrl,
+			    struct stratix10_svc_data_mem *pmem)
+{
+	if (ctrl->is_smmu_enabled) {
+		iommu_unmap(ctrl->domain, pmem->paddr, pmem->size);
+		free_iova(&ctrl->carveout.domain,
+			  iova_pfn(&ctrl->carveout.domain, pmem->paddr));
+		free_pages((unsigned long)pmem->vaddr, get_order(pmem->size));
+	} else {
+		gen_pool_free(ctrl->genpool, (unsigned long)pmem->vaddr,
+			      pmem->size);
+	}
+	kfree(pmem);
+}
+
+/**
+ * svc_mem_mag_drain() - release the buffers cached by all channels
+ * @ctrl: service controller
+ */
+static void svc_mem_mag_drain(struct stratix10_svc_controller *ctrl)
 {
 	struct stratix10_svc_data_mem *pmem;
+	struct stratix10_svc_mem_mag *mag;
+	unsigned long flags;
+	int i, j;
+
+	for (i = 0; i < ctrl->num_chans; i++) {
+		for (j = 0; j < SVC_MEM_MAG_NUM_CLASSES; j++) {
+			mag = &ctrl->chans[i].mag[j];
+			for (;;) {
+				spin_lock_irqsave(&ctrl->chans[i].lock, flags);
+				pmem = mag->count ? mag->mem[--mag->count] : NULL;
+				spin_unlock_irqrestore(&ctrl->chans[i].lock, flags);
+				if (!pmem)
+					break;
+				svc_mem_release(ctrl, pmem);
+			}
+		}
+	}
+}
+
+static int svc_mem_alloc_backing(struct stratix10_svc_controller *ctrl,
+				 struct stratix10_svc_data_mem *pmem,
+				 size_t size)
+{
+	struct gen_pool *genpool = ctrl->genpool;
 	unsigned long va_gen_pool;
-	phys_addr_t pa;
-	struct gen_pool *genpool = chan->ctrl->genpool;
+	struct iova *alloc;
+	dma_addr_t dma_addr;
 	size_t s;
 	void *va;
 	int ret;
-	struct iova *alloc;
-	dma_addr_t dma_addr;
 
-	pmem = devm_kzalloc(chan->ctrl->dev, sizeof(*pmem), GFP_KERNEL);
-	if (!pmem)
-		return ERR_PTR(-ENOMEM);
-
-	if (chan->ctrl->is_smmu_enabled == true) {
+	if (ctrl->is_smmu_enabled == true) {
 		s = PAGE_ALIGN(size);
 		va = (void *)__get_free_pages(GFP_KERNEL | __GFP_ZERO | __GFP_DMA, get_order(s));
 		if (!va) {
 			pr_debug("%s get_free_pages_failes\n", __func__);
-			return ERR_PTR(-ENOMEM);
+			return -ENOMEM;
 		}
 
-		alloc = alloc_iova(&chan->ctrl->carveout.domain,
-					s >> chan->ctrl->carveout.shift,
-					chan->ctrl->carveout.limit >> chan->ctrl->carveout.shift,
+		alloc = alloc_iova(&ctrl->carveout.domain,
+					s >> ctrl->carveout.shift,
+					ctrl->carveout.limit >> ctrl->carveout.shift,
 					true);
+		if (!alloc) {
+			pr_debug("%s IOVA alloc failed\n", __func__);
+			free_pages((unsigned long)va, get_order(s));
+			return -ENOMEM;
+		}
 
-		dma_addr = iova_dma_addr(&chan->ctrl->carveout.domain, alloc);
+		dma_addr = iova_dma_addr(&ctrl->carveout.domain, alloc);
 
-		ret = iommu_map(chan->ctrl->domain, dma_addr, virt_to_phys(va), s,
+		ret = iommu_map(ctrl->domain, dma_addr, virt_to_phys(va), s,
 				IOMMU_READ | IOMMU_WRITE | IOMMU_MMIO | IOMMU_CACHE);
 		if (ret < 0) {
 			pr_debug("%s IOMMU map failed\n", __func__);
-			free_iova(&chan->ctrl->carveout.domain,
-						iova_pfn(&chan->ctrl->carveout.domain,
-									dma_addr));
-			free_pages((unsigned long)va, get_order(size));
-			return ERR_PTR(-ENOMEM);
+			free_iova(&ctrl->carveout.domain,
+				  iova_pfn(&ctrl->carveout.domain, dma_addr));
+			free_pages((unsigned long)va, get_order(s));
+			return -ENOMEM;
 		}
 
 		pmem->paddr = dma_addr;
@@ -1815,24 +2215,100 @@ void *stratix10_svc_allocate_memory(struct stratix10_svc_chan *chan,
 		s = roundup(size, 1 << genpool->min_alloc_order);
 
 		va_gen_pool = gen_pool_alloc(genpool, s);
-		if (!va_gen_pool)
-			return ERR_PTR(-ENOMEM);
+		if (!va_gen_pool) {
+			/* cached buffers may be what keeps the pool full */
+			svc_mem_mag_drain(ctrl);
+			va_gen_pool = gen_pool_alloc(genpool, s);
+			if (!va_gen_pool)
+				return -ENOMEM;
+		}
 
 		va = (void *)va_gen_pool;
 
 		memset(va, 0, s);
-		pa = gen_pool_virt_to_phys(genpool, va_gen_pool);
-
-		pmem->paddr = pa;
+		pmem->paddr = gen_pool_virt_to_phys(genpool, va_gen_pool);
 	}
 
 	pmem->vaddr = va;
 	pmem->size = s;
-	list_add_tail(&pmem->node, &svc_data_mem);
+
+	return 0;
+}
+
+/**
+ * stratix10_svc_allocate_memory() - allocate memory
+ * @chan: service channel assigned to the client
+ * @size: memory size requested by a specific service client
+ *
+ * Service layer allocates the requested number of bytes buffer from the
+ * memory pool, service client uses this function to get allocated buffers.
+ * Small buffers freed by a client are cached per channel and handed out
+ * again to the next allocation of the same size class.
+ *
+ * Return: address of allocated memory on success, or ERR_PTR() on error.
+ */
+void *stratix10_svc_allocate_memory(struct stratix10_svc_chan *chan,
+				    size_t size)
+{
+	struct stratix10_svc_controller *ctrl = chan->ctrl;
+	struct stratix10_svc_mem_stats *stats = &ctrl->mem_stats;
+	struct stratix10_svc_data_mem *pmem = NULL;
+	struct stratix10_svc_mem_mag *mag;
+	int class = svc_mem_mag_class(size);
+	bool mag_hit = false;
+	unsigned long flags;
+	int ret;
+
+	if (class >= 0) {
+		mag = &chan->mag[class];
+		spin_lock_irqsave(&chan->lock, flags);
+		if (mag->count)
+			pmem = mag->mem[--mag->count];
+		spin_unlock_irqrestore(&chan->lock, flags);
+
+		if (pmem) {
+			memset(pmem->vaddr, 0, pmem->size);
+			mag_hit = true;
+			goto out;
+		}
+
+		size = BIT(class + SVC_MEM_MAG_MIN_ORDER);
+	}
+
+	pmem = kzalloc(sizeof(*pmem), GFP_KERNEL);
+	if (!pmem)
+		goto err;
+
+	ret = svc_mem_alloc_backing(ctrl, pmem, size);
+	if (ret) {
+		kfree(pmem);
+		goto err;
+	}
+	pmem->mag_class = class;
+
+out:
+	spin_lock_irqsave(&svc_mem_lock, flags);
+	hash_add(svc_mem_va_hash, &pmem->va_node, (unsigned long)pmem->vaddr);
+	hash_add(svc_mem_pa_hash, &pmem->pa_node, pmem->paddr);
+	stats->allocs++;
+	if (mag_hit)
+		stats->mag_hits++;
+	stats->live++;
+	stats->in_use += pmem->size;
+	stats->high_water = max(stats->high_water, stats->in_use);
+	spin_unlock_irqrestore(&svc_mem_lock, flags);
+
 	pr_debug("%s: %s: va=%p, pa=0x%016x\n", __func__,
 		chan->name, pmem->vaddr, (unsigned int)pmem->paddr);
 
-	return (void *)va;
+	return pmem->vaddr;
+
+err:
+	spin_lock_irqsave(&svc_mem_lock, flags);
+	stats->failures++;
+	spin_unlock_irqrestore(&svc_mem_lock, flags);
+
+	return ERR_PTR(-ENOMEM);
 }
 EXPORT_SYMBOL_GPL(stratix10_svc_allocate_memory);
 
@@ -1845,29 +2321,181 @@ EXPORT_SYMBOL_GPL(stratix10_svc_allocate_memory);
  */
 void stratix10_svc_free_memory(struct stratix10_svc_chan *chan, void *kaddr)
 {
+	struct stratix10_svc_controller *ctrl = chan->ctrl;
 	struct stratix10_svc_data_mem *pmem;
+	struct stratix10_svc_mem_mag *mag;
+	unsigned long flags;
+	bool cached = false;
+
+	spin_lock_irqsave(&svc_mem_lock, flags);
+	hash_for_each_possible(svc_mem_va_hash, pmem, va_node,
+			       (unsigned long)kaddr)
+		if (pmem->vaddr == kaddr)
+			break;
+	if (pmem) {
+		hash_del(&pmem->va_node);
+		hash_del(&pmem->pa_node);
+		ctrl->mem_stats.frees++;
+		ctrl->mem_stats.live--;
+		ctrl->mem_stats.in_use -= pmem->size;
+	}
+	spin_unlock_irqrestore(&svc_mem_lock, flags);
 
-	list_for_each_entry(pmem, &svc_data_mem, node)
-		if (pmem->vaddr == kaddr) {
-			if (chan->ctrl->is_smmu_enabled) {
-				iommu_unmap(chan->ctrl->domain, pmem->paddr, pmem->size);
-				free_iova(&chan->ctrl->carveout.domain,
-							iova_pfn(&chan->ctrl->carveout.domain,
-										pmem->paddr));
-				free_pages((unsigned long)pmem->vaddr, get_order(pmem->size));
-			} else {
-				gen_pool_free(chan->ctrl->genpool,
-					(unsigned long)kaddr, pmem->size);
-				pmem->vaddr = NULL;
-			}
-			list_del(&pmem->node);
-			return;
+	if (!pmem)
+		return;
+
+	if (pmem->mag_class >= 0) {
+		mag = &chan->mag[pmem->mag_class];
+		spin_lock_irqsave(&chan->lock, flags);
+		if (mag->count < SVC_MEM_MAG_DEPTH) {
+			mag->mem[mag->count++] = pmem;
+			cached = true;
 		}
+		spin_unlock_irqrestore(&chan->lock, flags);
+	}
 
-	list_del(&svc_data_mem);
+	if (!cached)
+		svc_mem_release(ctrl, pmem);
 }
 EXPORT_SYMBOL_GPL(stratix10_svc_free_memory);
 
+/**
+ * stratix10_svc_get_memory_size() - get size of the shared memory pool
+ * @chan: service channel assigned to the client
+ *
+ * This function is used by service client to size its buffers relative to
+ * the memory block reserved by secure monitor software.
+ *
+ * Return: size of the memory pool in bytes.
+ */
+size_t stratix10_svc_get_memory_size(struct stratix10_svc_chan *chan)
+{
+	if (chan->ctrl->is_smmu_enabled)
+		return chan->ctrl->carveout.limit;
+
+	return gen_pool_size(chan->ctrl->genpool);
+}
+EXPORT_SYMBOL_GPL(stratix10_svc_get_memory_size);
+
+/**
+ * svc_sdm_irq_handler() - SDM mailbox doorbell interrupt handler
+ * @irq: interrupt number
+ * @dev_id: pointer to service layer controller
+ *
+ * Wakes up the service thread polling for the response of a command.
+ */
+static irqreturn_t svc_sdm_irq_handler(int irq, void *dev_id)
+{
+	struct stratix10_svc_controller *ctrl = dev_id;
+
+	complete(&ctrl->sdm_irq_done);
+
+	return IRQ_HANDLED;
+}
+
+static int svc_latency_show(struct seq_file *s, void *unused)
+{
+	struct stratix10_svc_controller *ctrl = s->private;
+	struct stratix10_svc_lat_hist *hist;
+	int i, j;
+
+	seq_printf(s, "doorbell irq: %s\n", ctrl->sdm_irq > 0 ? "yes" : "no");
+	seq_puts(s, "cmd\tcount\tavg_us\tqueue_us\tsmc_us\tmax_us\tbuckets (<1us, <2^n us)\n");
+
+	mutex_lock(ctrl->sdm_lock);
+	for (i = 0; i < SVC_LAT_NUM_CMDS; i++) {
+		hist = &ctrl->lat_hist[i];
+		if (!hist->count)
+			continue;
+
+		seq_printf(s, "%d\t%llu\t%llu\t%llu\t%llu\t%llu\t", i,
+			   hist->count,
+			   div64_u64(hist->total_us, hist->count),
+			   div64_u64(hist->queue_us, hist->count),
+			   div64_u64(hist->smc_us, hist->count),
+			   hist->max_us);
+		for (j = 0; j < SVC_LAT_NUM_BUCKETS; j++)
+			seq_printf(s, " %u", hist->bucket[j]);
+		seq_putc(s, '\n');
+	}
+	mutex_unlock(ctrl->sdm_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(svc_latency);
+
+static void svc_mem_largest_free(struct gen_pool *pool,
+				 struct gen_pool_chunk *chunk, void *data)
+{
+	unsigned long nbits = (chunk->end_addr - chunk->start_addr + 1) >>
+			      pool->min_alloc_order;
+	unsigned long start, end;
+	size_t *largest = data;
+
+	start = find_first_zero_bit(chunk->bits, nbits);
+	while (start < nbits) {
+		end = find_next_bit(chunk->bits, nbits, start);
+		*largest = max_t(size_t, *largest,
+				 (end - start) << pool->min_alloc_order);
+		start = find_next_zero_bit(chunk->bits, nbits, end);
+	}
+}
+
+static int svc_memory_show(struct seq_file *s, void *unused)
+{
+	struct stratix10_svc_controller *ctrl = s->private;
+	struct stratix10_svc_mem_stats stats;
+	size_t avail, largest = 0;
+	unsigned long flags;
+	int i, j;
+
+	spin_lock_irqsave(&svc_mem_lock, flags);
+	stats = ctrl->mem_stats;
+	spin_unlock_irqrestore(&svc_mem_lock, flags);
+
+	if (!ctrl->is_smmu_enabled) {
+		avail = gen_pool_avail(ctrl->genpool);
+		gen_pool_for_each_chunk(ctrl->genpool, svc_mem_largest_free,
+					&largest);
+		seq_printf(s, "pool size:\t%zu\n", gen_pool_size(ctrl->genpool));
+		seq_printf(s, "pool avail:\t%zu\n", avail);
+		seq_printf(s, "largest free:\t%zu\n", largest);
+		seq_printf(s, "fragmentation:\t%zu%%\n",
+			   avail ? 100 - div_u64((u64)largest * 100, avail) : 0);
+	}
+	seq_printf(s, "in use:\t\t%zu\n", stats.in_use);
+	seq_printf(s, "high water:\t%zu\n", stats.high_water);
+	seq_printf(s, "live buffers:\t%u\n", stats.live);
+	seq_printf(s, "allocs:\t\t%llu\n", stats.allocs);
+	seq_printf(s, "frees:\t\t%llu\n", stats.frees);
+	seq_printf(s, "magazine hits:\t%llu\n", stats.mag_hits);
+	seq_printf(s, "failures:\t%llu\n", stats.failures);
+
+	seq_puts(s, "cached buffers per class (64B, 128B, ... 16K):\n");
+	for (i = 0; i < ctrl->num_chans; i++) {
+		seq_printf(s, "%s:", ctrl->chans[i].name);
+		spin_lock_irqsave(&ctrl->chans[i].lock, flags);
+		for (j = 0; j < SVC_MEM_MAG_NUM_CLASSES; j++)
+			seq_printf(s, " %u", ctrl->chans[i].mag[j].count);
+		spin_unlock_irqrestore(&ctrl->chans[i].lock, flags);
+		seq_putc(s, '\n');
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(svc_memory);
+
+static void svc_debugfs_init(struct stratix10_svc_controller *ctrl)
+{
+	ctrl->debugfs_dir = debugfs_create_dir("stratix10_svc", NULL);
+	debugfs_create_file("latency", 0400, ctrl->debugfs_dir, ctrl,
+			    &svc_latency_fops);
+	debugfs_create_u32("poll_min_delay_us", 0600, ctrl->debugfs_dir,
+			   &ctrl->poll_min_delay_us);
+	debugfs_create_file("memory", 0400, ctrl->debugfs_dir, ctrl,
+			    &svc_memory_fops);
+}
+
 static const struct of_device_id stratix10_svc_drv_match[] = {
 	{.compatible = "intel,stratix10-svc"},
 	{.compatible = "intel,agilex-svc"},
@@ -1889,7 +2517,7 @@ static int stratix10_svc_drv_probe(struct platform_device *pdev)
 
 	svc_invoke_fn *invoke_fn;
 	size_t fifo_size;
-	int ret;
+	int ret, i;
 	unsigned long order;
 
 	/* get SMC or HVC function */
@@ -1931,7 +2559,29 @@ static int stratix10_svc_drv_probe(struct platform_device *pdev)
 	controller->genpool = genpool;
 	controller->invoke_fn = invoke_fn;
 	controller->sdm_dma_addr_offset = 0x0;
+	controller->poll_min_delay_us = SVC_POLL_MIN_DELAY_US;
 	init_completion(&controller->complete_status);
+	init_completion(&controller->sdm_irq_done);
+
+	controller->lat_hist = devm_kcalloc(dev, SVC_LAT_NUM_CMDS,
+					    sizeof(*controller->lat_hist),
+					    GFP_KERNEL);
+	if (!controller->lat_hist) {
+		ret = -ENOMEM;
+		goto err_destroy_pool;
+	}
+
+	/* the SDM doorbell is optional, fall back to polling without it */
+	controller->sdm_irq = platform_get_irq_optional(pdev, 0);
+	if (controller->sdm_irq > 0) {
+		ret = devm_request_irq(dev, controller->sdm_irq,
+				       svc_sdm_irq_handler, 0,
+				       dev_name(dev), controller);
+		if (ret) {
+			dev_warn(dev, "failed to request SDM doorbell irq\n");
+			controller->sdm_irq = -ENXIO;
+		}
+	}
 
 	if (of_device_is_compatible(node, "intel,agilex5-svc")) {
 		if (iommu_present(&platform_bus_type) &&
@@ -1981,7 +2631,7 @@ static int stratix10_svc_drv_probe(struct platform_device *pdev)
 	 */
 	controller->sdm_lock = &mailbox_lock;
 
-	fifo_size = sizeof(struct stratix10_svc_data) * SVC_NUM_DATA_IN_FIFO;
+	fifo_size = sizeof(struct stratix10_svc_data) * max(fifo_depth, 1U);
 
 	chans[0].scl = NULL;
 	chans[0].ctrl = controller;
@@ -1993,6 +2643,7 @@ static int stratix10_svc_drv_probe(struct platform_device *pdev)
 		return ret;
 	}
 	spin_lock_init(&chans[0].svc_fifo_lock);
+	init_waitqueue_head(&chans[0].svc_wq);
 
 	chans[1].scl = NULL;
 	chans[1].ctrl = controller;
@@ -2004,6 +2655,7 @@ static int stratix10_svc_drv_probe(struct platform_device *pdev)
 		return ret;
 	}
 	spin_lock_init(&chans[1].svc_fifo_lock);
+	init_waitqueue_head(&chans[1].svc_wq);
 
 	chans[2].scl = NULL;
 	chans[2].ctrl = controller;
@@ -2015,6 +2667,7 @@ static int stratix10_svc_drv_probe(struct platform_device *pdev)
 		return ret;
 	}
 	spin_lock_init(&chans[2].svc_fifo_lock);
+	init_waitqueue_head(&chans[2].svc_wq);
 
 	chans[3].scl = NULL;
 	chans[3].ctrl = controller;
@@ -2026,9 +2679,20 @@ static int stratix10_svc_drv_probe(struct platform_device *pdev)
 		return ret;
 	}
 	spin_lock_init(&chans[3].svc_fifo_lock);
+	init_waitqueue_head(&chans[3].svc_wq);
+
+	for (i = 0; i < SVC_NUM_CHANNEL; i++) {
+		ret = kfifo_alloc(&chans[i].svc_fifo_urgent, fifo_size,
+				  GFP_KERNEL);
+		if (ret) {
+			dev_err(dev, "failed to allocate urgent FIFO %d\n", i);
+			return ret;
+		}
+	}
 
 	list_add_tail(&controller->node, &svc_ctrl);
 	platform_set_drvdata(pdev, controller);
+	svc_debugfs_init(controller);
 
 	/* add svc client device(s) */
 	svc = devm_kzalloc(dev, sizeof(*svc), GFP_KERNEL);
@@ -2067,6 +2731,14 @@ static int stratix10_svc_drv_remove(struct platform_device *pdev)
 	struct stratix10_svc_controller *ctrl = platform_get_drvdata(pdev);
 	struct stratix10_svc *svc = ctrl->svc;
 
+	debugfs_remove_recursive(ctrl->debugfs_dir);
+
+	platform_device_unregister(svc->intel_svc_fcs);
+	platform_device_unregister(svc->stratix10_svc_rsu);
+
+	/* cached buffers may still be mapped through the SDM IOMMU domain */
+	svc_mem_mag_drain(ctrl);
+
 	if (ctrl->domain) {
 		put_iova_domain(&ctrl->carveout.domain);
 		iova_cache_put();
@@ -2074,15 +2746,13 @@ static int stratix10_svc_drv_remove(struct platform_device *pdev)
 		iommu_domain_free(ctrl->domain);
 	}
 
-	platform_device_unregister(svc->intel_svc_fcs);
-	platform_device_unregister(svc->stratix10_svc_rsu);
-
 	for (i = 0; i < SVC_NUM_CHANNEL; i++) {
 		if (ctrl->chans[i].task) {
 			kthread_stop(ctrl->chans[i].task);
 			ctrl->chans[i].task = NULL;
 		}
 		kfifo_free(&ctrl->chans[i].svc_fifo);
+		kfifo_free(&ctrl->chans[i].svc_fifo_urgent);
 	}
 
 	if (ctrl->genpool)
@@ -77,6 +77,8 @@
 #define CVP_TEARDOWN_MAX_RETRY 10
 /* Optional CvP config error status check for debugging */
 static bool altera_cvp_chkcfg;
+/* Optional write-combined burst transfer of V2 data blocks */
+static bool altera_cvp_burst;
 
 struct cvp_priv;
 
@@ -84,6 +86,7 @@ struct altera_cvp_conf {
 	struct fpga_manager	*mgr;
 	struct pci_dev		*pci_dev;
 	void __iomem		*map;
+	void __iomem		*map_wc;
 	void			(*write_data)(struct altera_cvp_conf *conf,
 					      u32 data);
 	char			mgr_name[64];
@@ -235,6 +238,7 @@ static int altera_cvp_v2_wait_for_credit(struct fpga_manager *mgr,
 {
 	u32 timeout = V2_CREDIT_TIMEOUT_US / V2_CHECK_CREDIT_US;
 	struct altera_cvp_conf *conf = mgr->priv;
+	unsigned int polls = 0;
 	int ret;
 	u32 val;
 	u32 credit_mask = 0xFF;
@@ -250,14 +254,16 @@ static int altera_cvp_v2_wait_for_credit(struct fpga_manager *mgr,
 		if (ret) {
 			dev_err(&conf->pci_dev->dev,
 				"Error reading CVP Credit Register\n");
-			return ret;
+			/* a positive return is a number of credits */
+			return pcibios_err_to_errno(ret);
 		}
 
-		val = val & credit_mask;
-
-		/* Return if there is space in FIFO */
-		if (val - conf->sent_packets)
-			return 0;
+		/* Return the number of blocks there is space for in FIFO */
+		val = (val - conf->sent_packets) & credit_mask;
+		if (val) {
+			fpga_mgr_stats_add_retries(mgr, polls);
+			return val;
+		}
 
 		ret = altera_cvp_chk_error(mgr, blocks * ALTERA_CVP_V2_SIZE);
 		if (ret) {
@@ -269,8 +275,10 @@ static int altera_cvp_v2_wait_for_credit(struct fpga_manager *mgr,
 
 		/* Limit the check credit byte traffic */
 		usleep_range(V2_CHECK_CREDIT_US, V2_CHECK_CREDIT_US + 1);
+		polls++;
 	} while (timeout--);
 
+	fpga_mgr_stats_add_retries(mgr, polls);
 	dev_err(&conf->pci_dev->dev, "Timeout waiting for credit\n");
 	return -ETIMEDOUT;
 }
@@ -281,6 +289,23 @@ static int altera_cvp_send_block(struct altera_cvp_conf *conf,
 	u32 mask, words = len / sizeof(u32);
 	int i, remainder;
 
+	/*
+	 * The CvP hard IP takes data written anywhere in the CvP BAR, so a V2
+	 * block can go out as one write-combined copy instead of a stream of
+	 * uncached 32-bit writes to the same address.
+	 */
+	if (conf->map_wc && altera_cvp_burst && len == conf->priv->block_size) {
+		memcpy_toio(conf->map_wc, data, len);
+		wmb();
+		return 0;
+	}
+
+	if (conf->write_data == altera_cvp_write_data_iomem) {
+		iowrite32_rep(conf->map, data, words);
+		data += words;
+		words = 0;
+	}
+
 	for (i = 0; i < words; i++)
 		conf->write_data(conf, *data++);
 
@@ -353,6 +378,7 @@ static int altera_cvp_recovery(struct fpga_manager *mgr,
 				 "%s: [%d] Tear-down failed. Retrying\n",
 				 __func__,
 				 retry);
+		fpga_mgr_stats_add_retries(mgr, 1);
 	}
 	return ret;
 }
@@ -475,6 +501,7 @@ static int altera_cvp_write(struct fpga_manager *mgr, const char *buf,
 	struct altera_cvp_conf *conf = mgr->priv;
 	size_t done, remaining, len;
 	const u32 *data;
+	int credits = 0;
 	int status = 0;
 
 	/* STEP 9 - write 32-bit data from RBF file to CVP data register */
@@ -483,22 +510,35 @@ static int altera_cvp_write(struct fpga_manager *mgr, const char *buf,
 	done = 0;
 
 	while (remaining) {
-		/* Use credit throttling if available */
-		if (conf->priv->wait_credit) {
-			status = conf->priv->wait_credit(mgr, done);
-			if (status) {
+		/*
+		 * Use credit throttling if available.  The credit register is
+		 * only read again once all blocks it allowed have been sent.
+		 */
+		if (conf->priv->wait_credit && !credits) {
+			credits = conf->priv->wait_credit(mgr, done);
+			if (credits < 0) {
 				dev_err(&conf->pci_dev->dev,
-					"Wait Credit ERR: 0x%x\n", status);
-				return status;
+					"Wait Credit ERR: 0x%x\n", credits);
+				return credits;
 			}
 		}
 
 		len = min(conf->priv->block_size, remaining);
-		/* Copy the requested host data into the transmit buffer */
 
-		memcpy(conf->send_buf, data, len);
-		altera_cvp_send_block(conf, (const u32 *)conf->send_buf,
-		conf->priv->block_size);
+		/*
+		 * Copy the requested host data into the transmit buffer,
+		 * unless it is a whole aligned block that can be sent as is.
+		 */
+		if (len == conf->priv->block_size &&
+		    IS_ALIGNED((unsigned long)data, sizeof(u32))) {
+			altera_cvp_send_block(conf, data, len);
+		} else {
+			memcpy(conf->send_buf, data, len);
+			altera_cvp_send_block(conf, (const u32 *)conf->send_buf,
+					      conf->priv->block_size);
+		}
+		if (credits)
+			credits--;
 		data += len / sizeof(u32);
 		done += len;
 		remaining -= len;
@@ -606,6 +646,25 @@ static ssize_t chkcfg_store(struct device_driver *drv, const char *buf,
 
 static DRIVER_ATTR_RW(chkcfg);
 
+static ssize_t burst_show(struct device_driver *dev, char *buf)
+{
+	return snprintf(buf, 3, "%d\n", altera_cvp_burst);
+}
+
+static ssize_t burst_store(struct device_driver *drv, const char *buf,
+			   size_t count)
+{
+	int ret;
+
+	ret = kstrtobool(buf, &altera_cvp_burst);
+	if (ret)
+		return ret;
+
+	return count;
+}
+
+static DRIVER_ATTR_RW(burst);
+
 static int altera_cvp_probe(struct pci_dev *pdev,
 			    const struct pci_device_id *dev_id);
 static void altera_cvp_remove(struct pci_dev *pdev);
@@ -710,6 +769,11 @@ static int altera_cvp_probe(struct pci_dev *pdev,
 	if (!conf->map) {
 		dev_warn(&pdev->dev, "Mapping CVP BAR failed\n");
 		conf->write_data = altera_cvp_write_data_config;
+	} else if (conf->priv->wait_credit &&
+		   pci_resource_len(pdev, CVP_BAR) >= conf->priv->block_size) {
+		/* burst transfers are optional, go on without them on error */
+		conf->map_wc = pci_iomap_wc_range(pdev, CVP_BAR, 0,
+						  conf->priv->block_size);
 	}
 
 	snprintf(conf->mgr_name, sizeof(conf->mgr_name), "%s @%s",
@@ -734,6 +798,8 @@ static int altera_cvp_probe(struct pci_dev *pdev,
 	return 0;
 
 err_unmap:
+	if (conf->map_wc)
+		pci_iounmap(pdev, conf->map_wc);
 	if (conf->map)
 		pci_iounmap(pdev, conf->map);
 	pci_release_region(pdev, CVP_BAR);
@@ -750,6 +816,8 @@ static void altera_cvp_remove(struct pci_dev *pdev)
 	u16 cmd;
 
 	fpga_mgr_unregister(mgr);
+	if (conf->map_wc)
+		pci_iounmap(pdev, conf->map_wc);
 	if (conf->map)
 		pci_iounmap(pdev, conf->map);
 	pci_release_region(pdev, CVP_BAR);
@@ -771,11 +839,17 @@ static int __init altera_cvp_init(void)
 	if (ret)
 		pr_warn("Can't create sysfs chkcfg file\n");
 
+	ret = driver_create_file(&altera_cvp_driver.driver,
+				 &driver_attr_burst);
+	if (ret)
+		pr_warn("Can't create sysfs burst file\n");
+
 	return 0;
 }
 
 static void __exit altera_cvp_exit(void)
 {
+	driver_remove_file(&altera_cvp_driver.driver, &driver_attr_burst);
 	driver_remove_file(&altera_cvp_driver.driver, &driver_attr_chkcfg);
 	pci_unregister_driver(&altera_cvp_driver);
 }
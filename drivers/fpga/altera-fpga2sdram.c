@@ -21,14 +21,30 @@
  * allows for safe reprogramming of the FPGA, assuming that the new FPGA image
  * uses the same port configuration.  Bridges must be disabled before
  * reprogramming the FPGA and re-enabled after the FPGA has been programmed.
+ *
+ * When built in with CONFIG_DMABUF_HEAPS, the bridge also exports a "fpga2sdram" DMA-BUF
+ * heap, so the buffers the fabric masters write to can be shared with user
+ * space and other drivers without a copy.  The buffers are carved out of the
+ * bridge's memory-region, or the default CMA area.  The FPGA-to-SDRAM ports
+ * go straight to the SDRAM controller, bypassing the ACP and the L2 cache,
+ * so the buffers are mapped uncached by the CPU and need no maintenance.
+ * Up to heap_pool_size bytes of released buffers are kept to serve the next
+ * allocations of the same size, as the memory-region is usually too small
+ * for the allocations not to fragment it.
  */
 
+#include <linux/dma-buf.h>
+#include <linux/dma-heap.h>
+#include <linux/dma-mapping.h>
 #include <linux/fpga/fpga-bridge.h>
 #include <linux/kernel.h>
 #include <linux/mfd/syscon.h>
 #include <linux/module.h>
 #include <linux/of_platform.h>
+#include <linux/of_reserved_mem.h>
 #include <linux/regmap.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
 
 #define ALT_SDR_CTL_FPGAPORTRST_OFST		0x80
 #define ALT_SDR_CTL_FPGAPORTRST_PORTRSTN_MSK	0x00003fff
@@ -47,6 +63,10 @@
 
 #define F2S_BRIDGE_NAME "fpga2sdram"
 
+/* dma_heap_add() isn't exported to modules */
+#define F2S_DMA_HEAP	(IS_ENABLED(CONFIG_DMABUF_HEAPS) && \
+			 IS_BUILTIN(CONFIG_SOCFPGA_FPGA_BRIDGE))
+
 struct alt_fpga2sdram_data {
 	struct device *dev;
 	struct regmap *sdrctl;
@@ -86,6 +106,233 @@ static const struct fpga_bridge_ops altera_fpga2sdram_br_ops = {
 	.enable_show = alt_fpga2sdram_enable_show,
 };
 
+#if F2S_DMA_HEAP
+static unsigned long heap_pool_size = SZ_8M;
+module_param(heap_pool_size, ulong, 0444);
+MODULE_PARM_DESC(heap_pool_size,
+		 "Size of the released DMA-BUF heap buffers kept for reuse");
+
+struct alt_fpga2sdram_buffer {
+	struct dma_heap_pool_buffer pool;
+	struct dma_heap *heap;
+	struct device *dev;
+	void *vaddr;
+	dma_addr_t dma_addr;
+};
+
+static void alt_fpga2sdram_buf_free(struct dma_heap *heap,
+				    struct dma_heap_pool_buffer *buffer)
+{
+	struct alt_fpga2sdram_buffer *buf =
+		container_of(buffer, struct alt_fpga2sdram_buffer, pool);
+
+	dma_free_coherent(buf->dev, buf->pool.len, buf->vaddr, buf->dma_addr);
+	kfree(buf);
+}
+
+static int alt_fpga2sdram_buf_attach(struct dma_buf *dmabuf,
+				     struct dma_buf_attachment *attachment)
+{
+	struct alt_fpga2sdram_buffer *buf = dmabuf->priv;
+	struct sg_table *sgt;
+	int ret;
+
+	sgt = kzalloc(sizeof(*sgt), GFP_KERNEL);
+	if (!sgt)
+		return -ENOMEM;
+
+	ret = dma_get_sgtable(buf->dev, sgt, buf->vaddr, buf->dma_addr,
+			      buf->pool.len);
+	if (ret) {
+		kfree(sgt);
+		return ret;
+	}
+
+	attachment->priv = sgt;
+
+	return 0;
+}
+
+static void alt_fpga2sdram_buf_detach(struct dma_buf *dmabuf,
+				      struct dma_buf_attachment *attachment)
+{
+	struct sg_table *sgt = attachment->priv;
+
+	sg_free_table(sgt);
+	kfree(sgt);
+}
+
+/* the CPU mapping is uncached, there is nothing to sync */
+static struct sg_table *
+alt_fpga2sdram_buf_map(struct dma_buf_attachment *attachment,
+		       enum dma_data_direction dir)
+{
+	struct sg_table *sgt = attachment->priv;
+	int ret;
+
+	ret = dma_map_sgtable(attachment->dev, sgt, dir,
+			      DMA_ATTR_SKIP_CPU_SYNC);
+	if (ret)
+		return ERR_PTR(ret);
+
+	return sgt;
+}
+
+static void alt_fpga2sdram_buf_unmap(struct dma_buf_attachment *attachment,
+				     struct sg_table *sgt,
+				     enum dma_data_direction dir)
+{
+	dma_unmap_sgtable(attachment->dev, sgt, dir, DMA_ATTR_SKIP_CPU_SYNC);
+}
+
+static int alt_fpga2sdram_buf_mmap(struct dma_buf *dmabuf,
+				   struct vm_area_struct *vma)
+{
+	struct alt_fpga2sdram_buffer *buf = dmabuf->priv;
+
+	return dma_mmap_coherent(buf->dev, vma, buf->vaddr, buf->dma_addr,
+				 buf->pool.len);
+}
+
+static int alt_fpga2sdram_buf_vmap(struct dma_buf *dmabuf,
+				   struct iosys_map *map)
+{
+	struct alt_fpga2sdram_buffer *buf = dmabuf->priv;
+
+	iosys_map_set_vaddr(map, buf->vaddr);
+
+	return 0;
+}
+
+static void alt_fpga2sdram_buf_release(struct dma_buf *dmabuf)
+{
+	struct alt_fpga2sdram_buffer *buf = dmabuf->priv;
+
+	dma_heap_pool_put(buf->heap, &buf->pool);
+}
+
+static const struct dma_buf_ops alt_fpga2sdram_buf_ops = {
+	.attach = alt_fpga2sdram_buf_attach,
+	.detach = alt_fpga2sdram_buf_detach,
+	.map_dma_buf = alt_fpga2sdram_buf_map,
+	.unmap_dma_buf = alt_fpga2sdram_buf_unmap,
+	.mmap = alt_fpga2sdram_buf_mmap,
+	.vmap = alt_fpga2sdram_buf_vmap,
+	.release = alt_fpga2sdram_buf_release,
+};
+
+static struct alt_fpga2sdram_buffer *
+alt_fpga2sdram_buf_alloc(struct dma_heap *heap, struct device *dev, size_t len)
+{
+	struct alt_fpga2sdram_buffer *buf;
+
+	buf = kzalloc(sizeof(*buf), GFP_KERNEL);
+	if (!buf)
+		return NULL;
+
+	buf->heap = heap;
+	buf->dev = dev;
+	buf->pool.len = len;
+	buf->vaddr = dma_alloc_coherent(dev, len, &buf->dma_addr, GFP_KERNEL);
+	if (!buf->vaddr) {
+		/* the pooled buffers may be what is missing */
+		dma_heap_pool_drain(heap);
+		buf->vaddr = dma_alloc_coherent(dev, len, &buf->dma_addr,
+						GFP_KERNEL);
+	}
+	if (!buf->vaddr) {
+		kfree(buf);
+		return NULL;
+	}
+
+	return buf;
+}
+
+static struct dma_buf *alt_fpga2sdram_heap_allocate(struct dma_heap *heap,
+						    unsigned long len,
+						    unsigned long fd_flags,
+						    unsigned long heap_flags)
+{
+	struct alt_fpga2sdram_data *priv = dma_heap_get_drvdata(heap);
+	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
+	struct dma_heap_pool_buffer *buffer;
+	struct alt_fpga2sdram_buffer *buf;
+	struct dma_buf *dmabuf;
+
+	len = PAGE_ALIGN(len);
+	buffer = dma_heap_pool_get(heap, len);
+	if (buffer) {
+		buf = container_of(buffer, struct alt_fpga2sdram_buffer, pool);
+		memset(buf->vaddr, 0, len);
+	} else {
+		buf = alt_fpga2sdram_buf_alloc(heap, priv->dev, len);
+		if (!buf)
+			return ERR_PTR(-ENOMEM);
+	}
+
+	exp_info.exp_name = dma_heap_get_name(heap);
+	exp_info.ops = &alt_fpga2sdram_buf_ops;
+	exp_info.size = buf->pool.len;
+	exp_info.flags = fd_flags;
+	exp_info.priv = buf;
+
+	dmabuf = dma_buf_export(&exp_info);
+	if (IS_ERR(dmabuf)) {
+		alt_fpga2sdram_buf_free(heap, &buf->pool);
+		return dmabuf;
+	}
+
+	dev_dbg(priv->dev, "allocated %zu bytes at %pad\n", buf->pool.len,
+		&buf->dma_addr);
+
+	return dmabuf;
+}
+
+static const struct dma_heap_ops alt_fpga2sdram_heap_ops = {
+	.allocate = alt_fpga2sdram_heap_allocate,
+};
+
+/*
+ * DMA-BUF heaps can't be removed, so the bridge can't be unbound.  Failing
+ * to add the heap only loses the buffer sharing.
+ */
+static void alt_fpga2sdram_heap_init(struct alt_fpga2sdram_data *priv)
+{
+	struct dma_heap_export_info exp_info = {
+		.name = F2S_BRIDGE_NAME,
+		.ops = &alt_fpga2sdram_heap_ops,
+		.priv = priv,
+	};
+	struct dma_heap *heap;
+	int ret;
+
+	ret = of_reserved_mem_device_init(priv->dev);
+	if (ret && ret != -ENODEV) {
+		dev_warn(priv->dev, "failed to set up memory-region: %d\n",
+			 ret);
+		return;
+	}
+
+	heap = dma_heap_add(&exp_info);
+	if (IS_ERR(heap)) {
+		dev_warn(priv->dev, "failed to add DMA-BUF heap: %ld\n",
+			 PTR_ERR(heap));
+		of_reserved_mem_device_release(priv->dev);
+		return;
+	}
+
+	ret = dma_heap_pool_enable(heap, heap_pool_size,
+				   alt_fpga2sdram_buf_free);
+	if (ret)
+		dev_warn(priv->dev, "failed to enable DMA-BUF heap pool: %d\n",
+			 ret);
+}
+#else
+static void alt_fpga2sdram_heap_init(struct alt_fpga2sdram_data *priv)
+{
+}
+#endif
+
 static const struct of_device_id altera_fpga_of_match[] = {
 	{ .compatible = "altr,socfpga-fpga2sdram-bridge" },
 	{},
@@ -144,6 +391,8 @@ static int alt_fpga_bridge_probe(struct platform_device *pdev)
 		}
 	}
 
+	alt_fpga2sdram_heap_init(priv);
+
 	return ret;
 }
 
@@ -164,6 +413,7 @@ static struct platform_driver altera_fpga_driver = {
 	.driver = {
 		.name	= "altera_fpga2sdram_bridge",
 		.of_match_table = of_match_ptr(altera_fpga_of_match),
+		.suppress_bind_attrs = F2S_DMA_HEAP,
 	},
 };
 
@@ -172,3 +422,4 @@ module_platform_driver(altera_fpga_driver);
 MODULE_DESCRIPTION("Altera SoCFPGA FPGA to SDRAM Bridge");
 MODULE_AUTHOR("Alan Tull <atull@opensource.altera.com>");
 MODULE_LICENSE("GPL v2");
+MODULE_IMPORT_NS(DMA_BUF);
@@ -28,130 +28,175 @@
 
 #define FREEZE_BRIDGE_NAME			"freeze"
 
+/*
+ * @req_ack: status bit of the request in flight, 0 when there is none
+ * @req_enable: whether the request in flight enables the bridge
+ */
 struct altera_freeze_br_data {
 	struct device *dev;
 	void __iomem *base_addr;
 	bool enable;
+	u32 req_ack;
+	bool req_enable;
 };
 
 /*
- * Poll status until status bit is set or we have a timeout.
+ * Check once whether the request in flight was acknowledged: returns 0 if
+ * it was, -EBUSY if it is still pending and -EINVAL on an illegal request.
  */
-static int altera_freeze_br_req_ack(struct altera_freeze_br_data *priv,
-				    u32 timeout, u32 req_ack)
+static int altera_freeze_br_check_ack(struct altera_freeze_br_data *priv)
 {
 	struct device *dev = priv->dev;
 	void __iomem *csr_illegal_req_addr = priv->base_addr +
 					     FREEZE_CSR_ILLEGAL_REQ_OFFSET;
+	u32 req_ack = priv->req_ack;
 	u32 status, illegal, ctrl;
-	int ret = -ETIMEDOUT;
-
-	do {
-		illegal = readl(csr_illegal_req_addr);
-		if (illegal) {
-			dev_err(dev, "illegal request detected 0x%x", illegal);
-
-			writel(illegal, csr_illegal_req_addr);
 
-			illegal = readl(csr_illegal_req_addr);
-			if (illegal)
-				dev_err(dev, "illegal request not cleared 0x%x",
-					illegal);
+	illegal = readl(csr_illegal_req_addr);
+	if (illegal) {
+		dev_err(dev, "illegal request detected 0x%x", illegal);
 
-			ret = -EINVAL;
-			break;
-		}
+		writel(illegal, csr_illegal_req_addr);
 
-		status = readl(priv->base_addr + FREEZE_CSR_STATUS_OFFSET);
-		dev_dbg(dev, "%s %x %x\n", __func__, status, req_ack);
-		status &= req_ack;
-		if (status) {
-			ctrl = readl(priv->base_addr + FREEZE_CSR_CTRL_OFFSET);
-			dev_dbg(dev, "%s request %x acknowledged %x %x\n",
-				__func__, req_ack, status, ctrl);
-			ret = 0;
-			break;
-		}
+		illegal = readl(csr_illegal_req_addr);
+		if (illegal)
+			dev_err(dev, "illegal request not cleared 0x%x",
+				illegal);
 
-		udelay(1);
-	} while (timeout--);
+		return -EINVAL;
+	}
 
-	if (ret == -ETIMEDOUT)
-		dev_err(dev, "%s timeout waiting for 0x%x\n",
-			__func__, req_ack);
+	status = readl(priv->base_addr + FREEZE_CSR_STATUS_OFFSET);
+	dev_dbg(dev, "%s %x %x\n", __func__, status, req_ack);
+	status &= req_ack;
+	if (status) {
+		ctrl = readl(priv->base_addr + FREEZE_CSR_CTRL_OFFSET);
+		dev_dbg(dev, "%s request %x acknowledged %x %x\n",
+			__func__, req_ack, status, ctrl);
+		return 0;
+	}
 
-	return ret;
+	return -EBUSY;
 }
 
-static int altera_freeze_br_do_freeze(struct altera_freeze_br_data *priv,
-				      u32 timeout)
+/*
+ * Issue a freeze (enable = 0) or unfreeze (enable = 1) request. Nothing is
+ * left in flight when the bridge already is in the requested state.
+ */
+static int altera_freeze_br_start(struct altera_freeze_br_data *priv,
+				  bool enable)
 {
 	struct device *dev = priv->dev;
 	void __iomem *csr_ctrl_addr = priv->base_addr +
 				      FREEZE_CSR_CTRL_OFFSET;
 	u32 status;
-	int ret;
+
+	priv->req_ack = 0;
+
+	if (enable)
+		writel(0, csr_ctrl_addr);
 
 	status = readl(priv->base_addr + FREEZE_CSR_STATUS_OFFSET);
 
 	dev_dbg(dev, "%s %d %d\n", __func__, status, readl(csr_ctrl_addr));
 
-	if (status & FREEZE_CSR_STATUS_FREEZE_REQ_DONE) {
-		dev_dbg(dev, "%s bridge already disabled %d\n",
-			__func__, status);
-		return 0;
-	} else if (!(status & FREEZE_CSR_STATUS_UNFREEZE_REQ_DONE)) {
-		dev_err(dev, "%s bridge not enabled %d\n", __func__, status);
-		return -EINVAL;
-	}
+	if (enable) {
+		if (status & FREEZE_CSR_STATUS_UNFREEZE_REQ_DONE) {
+			dev_dbg(dev, "%s bridge already enabled %d\n",
+				__func__, status);
+			return 0;
+		} else if (!(status & FREEZE_CSR_STATUS_FREEZE_REQ_DONE)) {
+			dev_err(dev, "%s bridge not frozen %d\n",
+				__func__, status);
+			return -EINVAL;
+		}
 
-	writel(FREEZE_CSR_CTRL_FREEZE_REQ, csr_ctrl_addr);
+		writel(FREEZE_CSR_CTRL_UNFREEZE_REQ, csr_ctrl_addr);
+		priv->req_ack = FREEZE_CSR_STATUS_UNFREEZE_REQ_DONE;
+	} else {
+		if (status & FREEZE_CSR_STATUS_FREEZE_REQ_DONE) {
+			dev_dbg(dev, "%s bridge already disabled %d\n",
+				__func__, status);
+			return 0;
+		} else if (!(status & FREEZE_CSR_STATUS_UNFREEZE_REQ_DONE)) {
+			dev_err(dev, "%s bridge not enabled %d\n",
+				__func__, status);
+			return -EINVAL;
+		}
 
-	ret = altera_freeze_br_req_ack(priv, timeout,
-				       FREEZE_CSR_STATUS_FREEZE_REQ_DONE);
+		writel(FREEZE_CSR_CTRL_FREEZE_REQ, csr_ctrl_addr);
+		priv->req_ack = FREEZE_CSR_STATUS_FREEZE_REQ_DONE;
+	}
 
-	if (ret)
-		writel(0, csr_ctrl_addr);
-	else
-		writel(FREEZE_CSR_CTRL_RESET_REQ, csr_ctrl_addr);
+	priv->req_enable = enable;
 
-	return ret;
+	return 0;
 }
 
-static int altera_freeze_br_do_unfreeze(struct altera_freeze_br_data *priv,
-					u32 timeout)
+/* Complete the request in flight, ret being its outcome. */
+static int altera_freeze_br_finish(struct altera_freeze_br_data *priv,
+				   int ret)
 {
 	struct device *dev = priv->dev;
 	void __iomem *csr_ctrl_addr = priv->base_addr +
 				      FREEZE_CSR_CTRL_OFFSET;
 	u32 status;
-	int ret;
 
-	writel(0, csr_ctrl_addr);
+	if (ret == -ETIMEDOUT)
+		dev_err(dev, "%s timeout waiting for 0x%x\n",
+			__func__, priv->req_ack);
 
-	status = readl(priv->base_addr + FREEZE_CSR_STATUS_OFFSET);
+	if (priv->req_enable) {
+		status = readl(priv->base_addr + FREEZE_CSR_STATUS_OFFSET);
 
-	dev_dbg(dev, "%s %d %d\n", __func__, status, readl(csr_ctrl_addr));
+		dev_dbg(dev, "%s %d %d\n", __func__, status,
+			readl(csr_ctrl_addr));
 
-	if (status & FREEZE_CSR_STATUS_UNFREEZE_REQ_DONE) {
-		dev_dbg(dev, "%s bridge already enabled %d\n",
-			__func__, status);
-		return 0;
-	} else if (!(status & FREEZE_CSR_STATUS_FREEZE_REQ_DONE)) {
-		dev_err(dev, "%s bridge not frozen %d\n", __func__, status);
-		return -EINVAL;
+		writel(0, csr_ctrl_addr);
+	} else if (ret) {
+		writel(0, csr_ctrl_addr);
+	} else {
+		writel(FREEZE_CSR_CTRL_RESET_REQ, csr_ctrl_addr);
 	}
 
-	writel(FREEZE_CSR_CTRL_UNFREEZE_REQ, csr_ctrl_addr);
+	priv->req_ack = 0;
 
-	ret = altera_freeze_br_req_ack(priv, timeout,
-				       FREEZE_CSR_STATUS_UNFREEZE_REQ_DONE);
+	return ret;
+}
 
-	status = readl(priv->base_addr + FREEZE_CSR_STATUS_OFFSET);
+static int altera_freeze_br_enable_start(struct fpga_bridge *bridge,
+					 bool enable)
+{
+	struct altera_freeze_br_data *priv = bridge->priv;
+	int ret;
 
-	dev_dbg(dev, "%s %d %d\n", __func__, status, readl(csr_ctrl_addr));
+	ret = altera_freeze_br_start(priv, enable);
+	if (!ret && !priv->req_ack)
+		priv->enable = enable;
 
-	writel(0, csr_ctrl_addr);
+	return ret;
+}
+
+static int altera_freeze_br_enable_poll(struct fpga_bridge *bridge,
+					bool timeout)
+{
+	struct altera_freeze_br_data *priv = bridge->priv;
+	bool enable = priv->req_enable;
+	int ret;
+
+	if (!priv->req_ack)
+		return 0;
+
+	ret = altera_freeze_br_check_ack(priv);
+	if (ret == -EBUSY) {
+		if (!timeout)
+			return ret;
+		ret = -ETIMEDOUT;
+	}
+
+	ret = altera_freeze_br_finish(priv, ret);
+	if (!ret)
+		priv->enable = enable;
 
 	return ret;
 }
@@ -163,26 +208,25 @@ static int altera_freeze_br_do_unfreeze(struct altera_freeze_br_data *priv,
 static int altera_freeze_br_enable_set(struct fpga_bridge *bridge,
 				       bool enable)
 {
-	struct altera_freeze_br_data *priv = bridge->priv;
 	struct fpga_image_info *info = bridge->info;
 	u32 timeout = 0;
 	int ret;
 
-	if (enable) {
-		if (info)
-			timeout = info->enable_timeout_us;
+	if (info)
+		timeout = enable ? info->enable_timeout_us :
+				   info->disable_timeout_us;
 
-		ret = altera_freeze_br_do_unfreeze(bridge->priv, timeout);
-	} else {
-		if (info)
-			timeout = info->disable_timeout_us;
+	ret = altera_freeze_br_enable_start(bridge, enable);
+	if (ret)
+		return ret;
 
-		ret = altera_freeze_br_do_freeze(bridge->priv, timeout);
+	/* Poll status until status bit is set or we have a timeout. */
+	while ((ret = altera_freeze_br_enable_poll(bridge, !timeout)) ==
+	       -EBUSY) {
+		udelay(1);
+		timeout--;
 	}
 
-	if (!ret)
-		priv->enable = enable;
-
 	return ret;
 }
 
@@ -195,6 +239,8 @@ static int altera_freeze_br_enable_show(struct fpga_bridge *bridge)
 
 static const struct fpga_bridge_ops altera_freeze_br_br_ops = {
 	.enable_set = altera_freeze_br_enable_set,
+	.enable_start = altera_freeze_br_enable_start,
+	.enable_poll = altera_freeze_br_enable_poll,
 	.enable_show = altera_freeze_br_enable_show,
 };
 
@@ -25,7 +25,7 @@ static int alt_pr_platform_probe(struct platform_device *pdev)
 	if (IS_ERR(reg_base))
 		return PTR_ERR(reg_base);
 
-	return alt_pr_register(dev, reg_base);
+	return alt_pr_register_dma(dev, reg_base, res->start);
 }
 
 static const struct of_device_id alt_pr_of_match[] = {
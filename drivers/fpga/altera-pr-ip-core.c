@@ -8,9 +8,13 @@
  *  by Alan Tull <atull@opensource.altera.com>
  */
 #include <linux/delay.h>
+#include <linux/dma-mapping.h>
+#include <linux/dmaengine.h>
 #include <linux/fpga/altera-pr-ip-core.h>
 #include <linux/fpga/fpga-mgr.h>
 #include <linux/module.h>
+#include <linux/scatterlist.h>
+#include <asm/unaligned.h>
 
 #define ALT_PR_DATA_OFST		0x00
 #define ALT_PR_CSR_OFST			0x04
@@ -25,8 +29,13 @@
 #define ALT_PR_CSR_STATUS_PR_IN_PROG	(4 << ALT_PR_CSR_STATUS_SFT)
 #define ALT_PR_CSR_STATUS_PR_SUCCESS	(5 << ALT_PR_CSR_STATUS_SFT)
 
+#define ALT_PR_DMA_TIMEOUT_MS		2000
+
 struct alt_pr_priv {
 	void __iomem *reg_base;
+	struct dma_chan *chan;
+	phys_addr_t data_phys;
+	struct completion dma_done;
 };
 
 static enum fpga_mgr_states alt_pr_fpga_state(struct fpga_manager *mgr)
@@ -111,22 +120,34 @@ static int alt_pr_fpga_write(struct fpga_manager *mgr, const char *buf,
 	if (!count)
 		return -EINVAL;
 
-	/* Write out the complete 32-bit chunks */
-	while (count >= sizeof(u32)) {
-		writel(buffer_32[i++], priv->reg_base);
-		count -= sizeof(u32);
+	/*
+	 * Write out the complete 32-bit chunks, as a burst without the
+	 * barrier writel() has on every word when the buffer is aligned.
+	 */
+	if (IS_ALIGNED((unsigned long)buf, sizeof(u32))) {
+		i = count / sizeof(u32);
+		writesl(priv->reg_base + ALT_PR_DATA_OFST, buffer_32, i);
+		count -= i * sizeof(u32);
+	} else {
+		while (count >= sizeof(u32)) {
+			writel(get_unaligned(&buffer_32[i++]), priv->reg_base);
+			count -= sizeof(u32);
+		}
 	}
 
 	/* Write out remaining non 32-bit chunks */
 	switch (count) {
 	case 3:
-		writel(buffer_32[i++] & 0x00ffffff, priv->reg_base);
+		writel(get_unaligned(&buffer_32[i++]) & 0x00ffffff,
+		       priv->reg_base);
 		break;
 	case 2:
-		writel(buffer_32[i++] & 0x0000ffff, priv->reg_base);
+		writel(get_unaligned(&buffer_32[i++]) & 0x0000ffff,
+		       priv->reg_base);
 		break;
 	case 1:
-		writel(buffer_32[i++] & 0x000000ff, priv->reg_base);
+		writel(get_unaligned(&buffer_32[i++]) & 0x000000ff,
+		       priv->reg_base);
 		break;
 	case 0:
 		break;
@@ -141,6 +162,110 @@ static int alt_pr_fpga_write(struct fpga_manager *mgr, const char *buf,
 	return 0;
 }
 
+static void alt_pr_dma_callback(void *data)
+{
+	struct alt_pr_priv *priv = data;
+
+	complete(&priv->dma_done);
+}
+
+/* The data register only takes whole words from the DMA. */
+static bool alt_pr_can_dma(struct alt_pr_priv *priv, struct sg_table *sgt)
+{
+	struct scatterlist *sg;
+	int i;
+
+	if (!priv->chan)
+		return false;
+
+	for_each_sgtable_sg(sgt, sg, i)
+		if (!IS_ALIGNED(sg->offset | sg->length, sizeof(u32)))
+			return false;
+
+	return true;
+}
+
+static int alt_pr_fpga_write_dma(struct fpga_manager *mgr,
+				 struct sg_table *sgt)
+{
+	struct alt_pr_priv *priv = mgr->priv;
+	struct device *dma_dev = priv->chan->device->dev;
+	struct dma_slave_config cfg = {
+		.direction = DMA_MEM_TO_DEV,
+		.dst_addr = priv->data_phys + ALT_PR_DATA_OFST,
+		.dst_addr_width = DMA_SLAVE_BUSWIDTH_4_BYTES,
+		.dst_maxburst = 1,
+	};
+	struct dma_async_tx_descriptor *desc;
+	dma_cookie_t cookie;
+	int ret;
+
+	ret = dmaengine_slave_config(priv->chan, &cfg);
+	if (ret)
+		return ret;
+
+	ret = dma_map_sgtable(dma_dev, sgt, DMA_TO_DEVICE, 0);
+	if (ret)
+		return ret;
+
+	desc = dmaengine_prep_slave_sg(priv->chan, sgt->sgl, sgt->nents,
+				       DMA_MEM_TO_DEV, DMA_PREP_INTERRUPT);
+	if (!desc) {
+		ret = -ENOMEM;
+		goto unmap;
+	}
+
+	reinit_completion(&priv->dma_done);
+	desc->callback = alt_pr_dma_callback;
+	desc->callback_param = priv;
+
+	cookie = dmaengine_submit(desc);
+	ret = dma_submit_error(cookie);
+	if (ret)
+		goto unmap;
+
+	dma_async_issue_pending(priv->chan);
+
+	if (!wait_for_completion_timeout(&priv->dma_done,
+				msecs_to_jiffies(ALT_PR_DMA_TIMEOUT_MS))) {
+		dmaengine_terminate_sync(priv->chan);
+		dev_err(&mgr->dev, "timed out waiting for DMA\n");
+		ret = -ETIMEDOUT;
+	}
+
+unmap:
+	dma_unmap_sgtable(dma_dev, sgt, DMA_TO_DEVICE, 0);
+
+	if (!ret && alt_pr_fpga_state(mgr) == FPGA_MGR_STATE_WRITE_ERR)
+		ret = -EIO;
+
+	return ret;
+}
+
+/*
+ * Without a DMA channel, or with a scatter list it can't handle, the
+ * entries are written one by one, as the core would do without write_sg.
+ */
+static int alt_pr_fpga_write_sg(struct fpga_manager *mgr,
+				struct sg_table *sgt)
+{
+	struct sg_mapping_iter miter;
+	int ret = 0;
+
+	if (alt_pr_can_dma(mgr->priv, sgt))
+		return alt_pr_fpga_write_dma(mgr, sgt);
+
+	sg_miter_start(&miter, sgt->sgl, sgt->nents, SG_MITER_FROM_SG);
+	while (sg_miter_next(&miter)) {
+		ret = alt_pr_fpga_write(mgr, miter.addr, miter.length);
+		if (ret)
+			break;
+	}
+	sg_miter_stop(&miter);
+
+	return ret;
+}
+
 static int alt_pr_fpga_write_complete(struct fpga_manager *mgr,
 				      struct fpga_image_info *info)
 {
@@ -173,10 +298,39 @@ static const struct fpga_manager_ops alt_pr_ops = {
 	.write_complete = alt_pr_fpga_write_complete,
 };
 
-int alt_pr_register(struct device *dev, void __iomem *reg_base)
+static const struct fpga_manager_ops alt_pr_dma_ops = {
+	.state = alt_pr_fpga_state,
+	.write_init = alt_pr_fpga_write_init,
+	.write = alt_pr_fpga_write,
+	.write_sg = alt_pr_fpga_write_sg,
+	.write_complete = alt_pr_fpga_write_complete,
+};
+
+static void alt_pr_release_dma(void *data)
+{
+	dma_release_channel(data);
+}
+
+/**
+ * alt_pr_register_dma - register a PR IP core fed by DMA
+ * @dev: device of the PR IP core
+ * @reg_base: mapping of the PR IP core registers
+ * @reg_phys: physical address of the PR IP core registers
+ *
+ * The bitstreams are streamed to the data register through the "tx" DMA
+ * channel of @dev, for instance an mSGDMA with its Avalon-ST source looped
+ * to the PR IP core.  When @dev has no such channel, the data is written by
+ * the CPU, as with alt_pr_register().
+ *
+ * Return: 0 on success, negative error code otherwise.
+ */
+int alt_pr_register_dma(struct device *dev, void __iomem *reg_base,
+			phys_addr_t reg_phys)
 {
+	const struct fpga_manager_ops *ops = &alt_pr_ops;
 	struct alt_pr_priv *priv;
 	struct fpga_manager *mgr;
+	int ret;
 	u32 val;
 
 	priv = devm_kzalloc(dev, sizeof(*priv), GFP_KERNEL);
@@ -184,6 +338,24 @@ int alt_pr_register(struct device *dev, void __iomem *reg_base)
 		return -ENOMEM;
 
 	priv->reg_base = reg_base;
+	priv->data_phys = reg_phys;
+	init_completion(&priv->dma_done);
+
+	if (reg_phys) {
+		priv->chan = dma_request_chan(dev, "tx");
+		if (IS_ERR(priv->chan)) {
+			ret = PTR_ERR(priv->chan);
+			if (ret == -EPROBE_DEFER)
+				return ret;
+			priv->chan = NULL;
+		} else {
+			ret = devm_add_action_or_reset(dev, alt_pr_release_dma,
+						       priv->chan);
+			if (ret)
+				return ret;
+			ops = &alt_pr_dma_ops;
+		}
+	}
 
 	val = readl(priv->reg_base + ALT_PR_CSR_OFST);
 
@@ -191,9 +363,15 @@ int alt_pr_register(struct device *dev, void __iomem *reg_base)
 		(val & ALT_PR_CSR_STATUS_MSK) >> ALT_PR_CSR_STATUS_SFT,
 		(int)(val & ALT_PR_CSR_PR_START));
 
-	mgr = devm_fpga_mgr_register(dev, dev_name(dev), &alt_pr_ops, priv);
+	mgr = devm_fpga_mgr_register(dev, dev_name(dev), ops, priv);
 	return PTR_ERR_OR_ZERO(mgr);
 }
+EXPORT_SYMBOL_GPL(alt_pr_register_dma);
+
+int alt_pr_register(struct device *dev, void __iomem *reg_base)
+{
+	return alt_pr_register_dma(dev, reg_base, 0);
+}
 EXPORT_SYMBOL_GPL(alt_pr_register);
 
 MODULE_AUTHOR("Matthew Gerlach <matthew.gerlach@linux.intel.com>");
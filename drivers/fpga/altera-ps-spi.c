@@ -43,9 +43,23 @@ struct altera_ps_conf {
 	struct spi_device *spi;
 	const struct altera_ps_data *data;
 	u32 info_flags;
+	bool lsb_first;
 	char mgr_name[64];
 };
 
+/*
+ * Chunks are queued two at a time, so the next one is bit reversed while
+ * the controller shifts out the previous one.
+ */
+#define ALTERA_PS_CHUNK		SZ_64K
+
+struct altera_ps_chunk {
+	struct spi_message msg;
+	struct spi_transfer xfer;
+	struct completion done;
+	bool pending;
+};
+
 /*          |   Arria 10  |   Cyclone5  |   Stratix5  |
  * t_CF2ST0 |     [; 600] |     [; 600] |     [; 600] |ns
  * t_CFG    |        [2;] |        [2;] |        [2;] |µs
@@ -140,12 +154,14 @@ static int altera_ps_write_init(struct fpga_manager *mgr,
 	for (i = 0; i < waits; i++) {
 		usleep_range(min, min + 10);
 		if (!gpiod_get_value_cansleep(conf->status)) {
+			fpga_mgr_stats_add_retries(mgr, i);
 			/* wait for min(t_ST2CK)*/
 			altera_ps_delay(conf->data->t_st2ck_us);
 			return 0;
 		}
 	}
 
+	fpga_mgr_stats_add_retries(mgr, waits);
 	dev_err(&mgr->dev, "Status pin not ready.\n");
 	return -EIO;
 }
@@ -172,30 +188,75 @@ static void rev_buf(char *buf, size_t len)
 	}
 }
 
+static void altera_ps_chunk_complete(void *context)
+{
+	complete(context);
+}
+
+static int altera_ps_chunk_wait(struct altera_ps_chunk *chunk)
+{
+	if (!chunk->pending)
+		return 0;
+
+	wait_for_completion(&chunk->done);
+	chunk->pending = false;
+
+	return chunk->msg.status;
+}
+
 static int altera_ps_write(struct fpga_manager *mgr, const char *buf,
 			   size_t count)
 {
 	struct altera_ps_conf *conf = mgr->priv;
 	const char *fw_data = buf;
 	const char *fw_data_end = fw_data + count;
+	struct altera_ps_chunk chunks[2] = { };
+	size_t max = min_t(size_t, spi_max_transfer_size(conf->spi),
+			   ALTERA_PS_CHUNK);
+	bool lsb = conf->info_flags & FPGA_MGR_BITSTREAM_LSB_FIRST;
+	/* buffers flagged LSB first are already reversed for an MSB first bus */
+	bool rev = conf->lsb_first == lsb;
+	unsigned int i = 0;
+	int ret = 0, err;
 
 	while (fw_data < fw_data_end) {
-		int ret;
-		size_t stride = min_t(size_t, fw_data_end - fw_data, SZ_4K);
+		struct altera_ps_chunk *chunk = &chunks[i];
+		size_t stride = min_t(size_t, fw_data_end - fw_data, max);
 
-		if (!(conf->info_flags & FPGA_MGR_BITSTREAM_LSB_FIRST))
+		ret = altera_ps_chunk_wait(chunk);
+		if (ret)
+			break;
+
+		if (rev)
 			rev_buf((char *)fw_data, stride);
 
-		ret = spi_write(conf->spi, fw_data, stride);
-		if (ret) {
-			dev_err(&mgr->dev, "spi error in firmware write: %d\n",
-				ret);
-			return ret;
-		}
+		chunk->xfer.tx_buf = fw_data;
+		chunk->xfer.len = stride;
+		spi_message_init_with_transfers(&chunk->msg, &chunk->xfer, 1);
+		chunk->msg.complete = altera_ps_chunk_complete;
+		chunk->msg.context = &chunk->done;
+		init_completion(&chunk->done);
+
+		ret = spi_async(conf->spi, &chunk->msg);
+		if (ret)
+			break;
+
+		chunk->pending = true;
 		fw_data += stride;
+		i ^= 1;
 	}
 
-	return 0;
+	/* the messages live on the stack */
+	for (i = 0; i < ARRAY_SIZE(chunks); i++) {
+		err = altera_ps_chunk_wait(&chunks[i]);
+		if (!ret)
+			ret = err;
+	}
+
+	if (ret)
+		dev_err(&mgr->dev, "spi error in firmware write: %d\n", ret);
+
+	return ret;
 }
 
 static int altera_ps_write_complete(struct fpga_manager *mgr,
@@ -298,6 +359,18 @@ static int altera_ps_probe(struct spi_device *spi)
 		dev_warn(&spi->dev, "Not using confd gpio");
 	}
 
+	/*
+	 * The bitstream goes out LSB first. Let the controller do it when it
+	 * can, instead of reversing every byte.
+	 */
+	if (spi->controller->mode_bits & SPI_LSB_FIRST) {
+		spi->mode |= SPI_LSB_FIRST;
+		if (spi_setup(spi))
+			spi->mode &= ~SPI_LSB_FIRST;
+		else
+			conf->lsb_first = true;
+	}
+
 	/* Register manager with unique name */
 	snprintf(conf->mgr_name, sizeof(conf->mgr_name), "%s %s",
 		 dev_driver_string(&spi->dev), dev_name(&spi->dev));
@@ -9,6 +9,7 @@
  *   Xiao Guangrong <guangrong.xiao@linux.intel.com>
  */
 
+#include <linux/dma-buf.h>
 #include <linux/dma-mapping.h>
 #include <linux/sched/signal.h>
 #include <linux/uaccess.h>
@@ -20,7 +21,7 @@ void afu_dma_region_init(struct dfl_feature_platform_data *pdata)
 {
 	struct dfl_afu *afu = dfl_fpga_pdata_get_private(pdata);
 
-	afu->dma_regions = RB_ROOT;
+	mt_init(&afu->dma_regions);
 }
 
 /**
@@ -93,23 +94,110 @@ static void afu_dma_unpin_pages(struct dfl_feature_platform_data *pdata,
 }
 
 /**
- * afu_dma_check_continuous_pages - check if pages are continuous
- * @region: dma memory region
+ * afu_dma_check_continuous_iova - check if a dma mapping is continuous
+ * @region: dma memory region, with its sgt mapped
+ *
+ * The AFU takes a single base address per buffer, so the dma addresses of
+ * the region must follow each other.  Behind an IOMMU this holds for any
+ * pages, otherwise only for physically continuous ones.
  *
- * Return true if pages of given dma memory region have continuous physical
- * address, otherwise return false.
+ * Return true if the dma mapping of given dma memory region is continuous and
+ * covers its length, otherwise return false.
  */
-static bool afu_dma_check_continuous_pages(struct dfl_afu_dma_region *region)
+static bool afu_dma_check_continuous_iova(struct dfl_afu_dma_region *region)
 {
-	int npages = region->length >> PAGE_SHIFT;
+	struct scatterlist *sg;
+	dma_addr_t next = 0;
+	u64 length = 0;
 	int i;
 
-	for (i = 0; i < npages - 1; i++)
-		if (page_to_pfn(region->pages[i]) + 1 !=
-				page_to_pfn(region->pages[i + 1]))
+	for_each_sgtable_dma_sg(region->sgt, sg, i) {
+		if (i && sg_dma_address(sg) != next)
 			return false;
+		next = sg_dma_address(sg) + sg_dma_len(sg);
+		length += sg_dma_len(sg);
+	}
+
+	return length >= region->length;
+}
+
+/**
+ * afu_dma_map_pages - map pinned pages of given dma memory region
+ * @pdata: feature device platform data
+ * @region: dma memory region with its pages pinned
+ *
+ * Map the pages through a scatter gather table, so the IOMMU, if any, can
+ * give non-continuous pages a continuous dma address range.
+ * Return 0 for success or negative error code.
+ */
+static int afu_dma_map_pages(struct dfl_feature_platform_data *pdata,
+			     struct dfl_afu_dma_region *region)
+{
+	int npages = region->length >> PAGE_SHIFT;
+	struct device *dev = &pdata->dev->dev;
+	int ret;
+
+	region->sgt = kzalloc(sizeof(*region->sgt), GFP_KERNEL);
+	if (!region->sgt)
+		return -ENOMEM;
+
+	ret = sg_alloc_table_from_pages(region->sgt, region->pages, npages, 0,
+					region->length, GFP_KERNEL);
+	if (ret)
+		goto free_sgt;
+
+	ret = dma_map_sgtable(dfl_fpga_pdata_to_parent(pdata), region->sgt,
+			      DMA_BIDIRECTIONAL, 0);
+	if (ret) {
+		dev_err(dev, "failed to map for dma\n");
+		goto free_table;
+	}
+
+	/* Only accept continuous dma addresses, return error else */
+	if (!afu_dma_check_continuous_iova(region)) {
+		dev_err(dev, "dma addresses are not continuous\n");
+		ret = -EINVAL;
+		goto unmap_sgt;
+	}
+
+	region->iova = sg_dma_address(region->sgt->sgl);
+
+	return 0;
+
+unmap_sgt:
+	dma_unmap_sgtable(dfl_fpga_pdata_to_parent(pdata), region->sgt,
+			  DMA_BIDIRECTIONAL, 0);
+free_table:
+	sg_free_table(region->sgt);
+free_sgt:
+	kfree(region->sgt);
+	region->sgt = NULL;
+	return ret;
+}
+
+/**
+ * afu_dma_region_release - unmap and free given dma memory region
+ * @pdata: feature device platform data
+ * @region: dma memory region, removed from the rbtree
+ */
+static void afu_dma_region_release(struct dfl_feature_platform_data *pdata,
+				   struct dfl_afu_dma_region *region)
+{
+	if (region->attach) {
+		dma_buf_unmap_attachment_unlocked(region->attach, region->sgt,
+						  DMA_BIDIRECTIONAL);
+		dma_buf_detach(region->dmabuf, region->attach);
+		dma_buf_put(region->dmabuf);
+	} else {
+		dma_unmap_sgtable(dfl_fpga_pdata_to_parent(pdata), region->sgt,
+				  DMA_BIDIRECTIONAL, 0);
+		sg_free_table(region->sgt);
+		kfree(region->sgt);
+		afu_dma_unpin_pages(pdata, region);
+	}
 
-	return true;
+	/* lockless lookups may still see the region */
+	kfree_rcu(region, rcu);
 }
 
 /**
@@ -132,70 +220,37 @@ static bool dma_region_check_iova(struct dfl_afu_dma_region *region,
 }
 
 /**
- * afu_dma_region_add - add given dma region to rbtree
+ * afu_dma_region_add - add given dma region to the maple tree
  * @pdata: feature device platform data
  * @region: dma region to be added
  *
- * Return 0 for success, -EEXIST if dma region has already been added.
+ * The region is stored over its whole iova range, so overlapping regions are
+ * refused by the tree itself.
  *
- * Needs to be called with pdata->lock heold.
+ * Return 0 for success, -EEXIST if dma region has already been added.
  */
 static int afu_dma_region_add(struct dfl_feature_platform_data *pdata,
 			      struct dfl_afu_dma_region *region)
 {
 	struct dfl_afu *afu = dfl_fpga_pdata_get_private(pdata);
-	struct rb_node **new, *parent = NULL;
+	int ret;
 
 	dev_dbg(&pdata->dev->dev, "add region (iova = %llx)\n",
 		(unsigned long long)region->iova);
 
-	new = &afu->dma_regions.rb_node;
-
-	while (*new) {
-		struct dfl_afu_dma_region *this;
-
-		this = container_of(*new, struct dfl_afu_dma_region, node);
-
-		parent = *new;
-
-		if (dma_region_check_iova(this, region->iova, region->length))
-			return -EEXIST;
-
-		if (region->iova < this->iova)
-			new = &((*new)->rb_left);
-		else if (region->iova > this->iova)
-			new = &((*new)->rb_right);
-		else
-			return -EEXIST;
-	}
-
-	rb_link_node(&region->node, parent, new);
-	rb_insert_color(&region->node, &afu->dma_regions);
-
-	return 0;
-}
-
-/**
- * afu_dma_region_remove - remove given dma region from rbtree
- * @pdata: feature device platform data
- * @region: dma region to be removed
- *
- * Needs to be called with pdata->lock heold.
- */
-static void afu_dma_region_remove(struct dfl_feature_platform_data *pdata,
-				  struct dfl_afu_dma_region *region)
-{
-	struct dfl_afu *afu;
+	/* the tree is indexed by unsigned long */
+	if (region->iova + region->length - 1 > ULONG_MAX)
+		return -EINVAL;
 
-	dev_dbg(&pdata->dev->dev, "del region (iova = %llx)\n",
-		(unsigned long long)region->iova);
+	ret = mtree_insert_range(&afu->dma_regions, region->iova,
+				 region->iova + region->length - 1, region,
+				 GFP_KERNEL);
 
-	afu = dfl_fpga_pdata_get_private(pdata);
-	rb_erase(&region->node, &afu->dma_regions);
+	return ret == -EBUSY ? -EEXIST : ret;
 }
 
 /**
- * afu_dma_region_destroy - destroy all regions in rbtree
+ * afu_dma_region_destroy - destroy all regions in the maple tree
  * @pdata: feature device platform data
  *
  * Needs to be called with pdata->lock heold.
@@ -203,69 +258,46 @@ static void afu_dma_region_remove(struct dfl_feature_platform_data *pdata,
 void afu_dma_region_destroy(struct dfl_feature_platform_data *pdata)
 {
 	struct dfl_afu *afu = dfl_fpga_pdata_get_private(pdata);
-	struct rb_node *node = rb_first(&afu->dma_regions);
 	struct dfl_afu_dma_region *region;
+	unsigned long index = 0;
 
-	while (node) {
-		region = container_of(node, struct dfl_afu_dma_region, node);
-
+	mt_for_each(&afu->dma_regions, region, index, ULONG_MAX) {
 		dev_dbg(&pdata->dev->dev, "del region (iova = %llx)\n",
 			(unsigned long long)region->iova);
 
-		rb_erase(node, &afu->dma_regions);
-
-		if (region->iova)
-			dma_unmap_page(dfl_fpga_pdata_to_parent(pdata),
-				       region->iova, region->length,
-				       DMA_BIDIRECTIONAL);
-
-		if (region->pages)
-			afu_dma_unpin_pages(pdata, region);
-
-		node = rb_next(node);
-		kfree(region);
+		afu_dma_region_release(pdata, region);
 	}
+
+	mtree_destroy(&afu->dma_regions);
 }
 
 /**
- * afu_dma_region_find - find the dma region from rbtree based on iova and size
+ * afu_dma_region_find - find the dma region based on iova and size
  * @pdata: feature device platform data
  * @iova: address of the dma memory area
  * @size: size of the dma memory area
  *
- * It finds the dma region from the rbtree based on @iova and @size:
+ * It finds the dma region from the maple tree based on @iova and @size:
  * - if @size == 0, it finds the dma region which starts from @iova
  * - otherwise, it finds the dma region which fully contains
  *   [@iova, @iova+size)
  * If nothing is matched returns NULL.
  *
- * Needs to be called with pdata->lock held.
+ * The lookup does not take any lock.  Needs to be called under
+ * rcu_read_lock(), the region stays valid until rcu_read_unlock().
  */
 struct dfl_afu_dma_region *
 afu_dma_region_find(struct dfl_feature_platform_data *pdata, u64 iova, u64 size)
 {
 	struct dfl_afu *afu = dfl_fpga_pdata_get_private(pdata);
-	struct rb_node *node = afu->dma_regions.rb_node;
 	struct device *dev = &pdata->dev->dev;
+	struct dfl_afu_dma_region *region;
 
-	while (node) {
-		struct dfl_afu_dma_region *region;
-
-		region = container_of(node, struct dfl_afu_dma_region, node);
-
-		if (dma_region_check_iova(region, iova, size)) {
-			dev_dbg(dev, "find region (iova = %llx)\n",
-				(unsigned long long)region->iova);
-			return region;
-		}
-
-		if (iova < region->iova)
-			node = node->rb_left;
-		else if (iova > region->iova)
-			node = node->rb_right;
-		else
-			/* the iova region is not fully covered. */
-			break;
+	region = mtree_load(&afu->dma_regions, iova);
+	if (region && dma_region_check_iova(region, iova, size)) {
+		dev_dbg(dev, "find region (iova = %llx)\n",
+			(unsigned long long)region->iova);
+		return region;
 	}
 
 	dev_dbg(dev, "region with iova %llx and size %llx is not found\n",
@@ -274,19 +306,6 @@ afu_dma_region_find(struct dfl_feature_platform_data *pdata, u64 iova, u64 size)
 	return NULL;
 }
 
-/**
- * afu_dma_region_find_iova - find the dma region from rbtree by iova
- * @pdata: feature device platform data
- * @iova: address of the dma region
- *
- * Needs to be called with pdata->lock held.
- */
-static struct dfl_afu_dma_region *
-afu_dma_region_find_iova(struct dfl_feature_platform_data *pdata, u64 iova)
-{
-	return afu_dma_region_find(pdata, iova, 0);
-}
-
 /**
  * afu_dma_map_region - map memory region for dma
  * @pdata: feature device platform data
@@ -329,39 +348,21 @@ int afu_dma_map_region(struct dfl_feature_platform_data *pdata,
 		goto free_region;
 	}
 
-	/* Only accept continuous pages, return error else */
-	if (!afu_dma_check_continuous_pages(region)) {
-		dev_err(&pdata->dev->dev, "pages are not continuous\n");
-		ret = -EINVAL;
-		goto unpin_pages;
-	}
-
-	/* As pages are continuous then start to do DMA mapping */
-	region->iova = dma_map_page(dfl_fpga_pdata_to_parent(pdata),
-				    region->pages[0], 0,
-				    region->length,
-				    DMA_BIDIRECTIONAL);
-	if (dma_mapping_error(dfl_fpga_pdata_to_parent(pdata), region->iova)) {
-		dev_err(&pdata->dev->dev, "failed to map for dma\n");
-		ret = -EFAULT;
+	ret = afu_dma_map_pages(pdata, region);
+	if (ret)
 		goto unpin_pages;
-	}
 
 	*iova = region->iova;
 
-	mutex_lock(&pdata->lock);
 	ret = afu_dma_region_add(pdata, region);
-	mutex_unlock(&pdata->lock);
 	if (ret) {
 		dev_err(&pdata->dev->dev, "failed to add dma region\n");
-		goto unmap_dma;
+		afu_dma_region_release(pdata, region);
+		return ret;
 	}
 
 	return 0;
 
-unmap_dma:
-	dma_unmap_page(dfl_fpga_pdata_to_parent(pdata),
-		       region->iova, region->length, DMA_BIDIRECTIONAL);
 unpin_pages:
 	afu_dma_unpin_pages(pdata, region);
 free_region:
@@ -369,6 +370,87 @@ int afu_dma_map_region(struct dfl_feature_platform_data *pdata,
 	return ret;
 }
 
+/**
+ * afu_dma_map_dmabuf - map an imported dma-buf for dma
+ * @pdata: feature device platform data
+ * @fd: dma-buf file descriptor
+ * @length: pointer of length of the dma-buf
+ * @iova: pointer of iova address
+ *
+ * Attach the dma-buf to the device and map it, and return dma address and
+ * size of the whole buffer via @iova and @length.  The buffer has to be
+ * mapped to a continuous dma address range, as for afu_dma_map_region().
+ * Return 0 for success, otherwise error code.
+ */
+int afu_dma_map_dmabuf(struct dfl_feature_platform_data *pdata, int fd,
+		       u64 *length, u64 *iova)
+{
+	struct device *dev = &pdata->dev->dev;
+	struct dfl_afu_dma_region *region;
+	int ret;
+
+	region = kzalloc(sizeof(*region), GFP_KERNEL);
+	if (!region)
+		return -ENOMEM;
+
+	region->dmabuf = dma_buf_get(fd);
+	if (IS_ERR(region->dmabuf)) {
+		ret = PTR_ERR(region->dmabuf);
+		goto free_region;
+	}
+
+	if (!PAGE_ALIGNED(region->dmabuf->size)) {
+		ret = -EINVAL;
+		goto put_dmabuf;
+	}
+	region->length = region->dmabuf->size;
+
+	region->attach = dma_buf_attach(region->dmabuf,
+					dfl_fpga_pdata_to_parent(pdata));
+	if (IS_ERR(region->attach)) {
+		ret = PTR_ERR(region->attach);
+		goto put_dmabuf;
+	}
+
+	region->sgt = dma_buf_map_attachment_unlocked(region->attach,
+						      DMA_BIDIRECTIONAL);
+	if (IS_ERR(region->sgt)) {
+		dev_err(dev, "failed to map dma-buf for dma\n");
+		ret = PTR_ERR(region->sgt);
+		goto detach;
+	}
+
+	if (!afu_dma_check_continuous_iova(region)) {
+		dev_err(dev, "dma addresses are not continuous\n");
+		ret = -EINVAL;
+		goto unmap_attach;
+	}
+
+	region->iova = sg_dma_address(region->sgt->sgl);
+	*iova = region->iova;
+	*length = region->length;
+
+	ret = afu_dma_region_add(pdata, region);
+	if (ret) {
+		dev_err(dev, "failed to add dma region\n");
+		afu_dma_region_release(pdata, region);
+		return ret;
+	}
+
+	return 0;
+
+unmap_attach:
+	dma_buf_unmap_attachment_unlocked(region->attach, region->sgt,
+					  DMA_BIDIRECTIONAL);
+detach:
+	dma_buf_detach(region->dmabuf, region->attach);
+put_dmabuf:
+	dma_buf_put(region->dmabuf);
+free_region:
+	kfree(region);
+	return ret;
+}
+
 /**
  * afu_dma_unmap_region - unmap dma memory region
  * @pdata: feature device platform data
@@ -379,27 +461,29 @@ int afu_dma_map_region(struct dfl_feature_platform_data *pdata,
  */
 int afu_dma_unmap_region(struct dfl_feature_platform_data *pdata, u64 iova)
 {
+	struct dfl_afu *afu = dfl_fpga_pdata_get_private(pdata);
+	MA_STATE(mas, &afu->dma_regions, iova, iova);
 	struct dfl_afu_dma_region *region;
 
-	mutex_lock(&pdata->lock);
-	region = afu_dma_region_find_iova(pdata, iova);
-	if (!region) {
-		mutex_unlock(&pdata->lock);
+	mtree_lock(&afu->dma_regions);
+	region = mas_walk(&mas);
+	if (!region || region->iova != iova) {
+		mtree_unlock(&afu->dma_regions);
 		return -EINVAL;
 	}
 
 	if (region->in_use) {
-		mutex_unlock(&pdata->lock);
+		mtree_unlock(&afu->dma_regions);
 		return -EBUSY;
 	}
 
-	afu_dma_region_remove(pdata, region);
-	mutex_unlock(&pdata->lock);
+	mas_erase(&mas);
+	mtree_unlock(&afu->dma_regions);
 
-	dma_unmap_page(dfl_fpga_pdata_to_parent(pdata),
-		       region->iova, region->length, DMA_BIDIRECTIONAL);
-	afu_dma_unpin_pages(pdata, region);
-	kfree(region);
+	dev_dbg(&pdata->dev->dev, "del region (iova = %llx)\n",
+		(unsigned long long)region->iova);
+
+	afu_dma_region_release(pdata, region);
 
 	return 0;
 }
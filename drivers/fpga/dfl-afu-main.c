@@ -737,6 +737,101 @@ afu_ioctl_dma_map(struct dfl_feature_platform_data *pdata, void __user *arg)
 	return 0;
 }
 
+static long
+afu_ioctl_dma_map_dmabuf(struct dfl_feature_platform_data *pdata,
+			 void __user *arg)
+{
+	struct dfl_fpga_port_dma_map_dmabuf map;
+	unsigned long minsz;
+	long ret;
+
+	minsz = offsetofend(struct dfl_fpga_port_dma_map_dmabuf, iova);
+
+	if (copy_from_user(&map, arg, minsz))
+		return -EFAULT;
+
+	if (map.argsz < minsz || map.flags || map.pad)
+		return -EINVAL;
+
+	ret = afu_dma_map_dmabuf(pdata, map.dmabuf_fd, &map.length, &map.iova);
+	if (ret)
+		return ret;
+
+	if (copy_to_user(arg, &map, sizeof(map))) {
+		afu_dma_unmap_region(pdata, map.iova);
+		return -EFAULT;
+	}
+
+	dev_dbg(&pdata->dev->dev, "dma map: fd=%d, len=%llx, iova=%llx\n",
+		map.dmabuf_fd, (unsigned long long)map.length,
+		(unsigned long long)map.iova);
+
+	return 0;
+}
+
+static long
+afu_ioctl_dma_batch(struct dfl_feature_platform_data *pdata, void __user *arg,
+		    bool map)
+{
+	struct dfl_fpga_port_dma_region *regions;
+	struct dfl_fpga_port_dma_batch batch;
+	unsigned long minsz;
+	long ret = 0;
+	u32 i;
+
+	minsz = offsetofend(struct dfl_fpga_port_dma_batch, regions);
+
+	if (copy_from_user(&batch, arg, minsz))
+		return -EFAULT;
+
+	if (batch.argsz < minsz || batch.flags || !batch.count ||
+	    batch.count > DFL_FPGA_DMA_BATCH_MAX)
+		return -EINVAL;
+
+	regions = memdup_user(u64_to_user_ptr(batch.regions),
+			      array_size(batch.count, sizeof(*regions)));
+	if (IS_ERR(regions))
+		return PTR_ERR(regions);
+
+	batch.done = 0;
+	for (i = 0; i < batch.count; i++) {
+		if (map) {
+			ret = afu_dma_map_region(pdata, regions[i].user_addr,
+						 regions[i].length,
+						 &regions[i].iova);
+			if (ret)
+				break;
+			batch.done++;
+		} else {
+			long err = afu_dma_unmap_region(pdata, regions[i].iova);
+
+			if (!err)
+				batch.done++;
+			else if (!ret)
+				ret = err;
+		}
+	}
+
+	if (map && !ret &&
+	    copy_to_user(u64_to_user_ptr(batch.regions), regions,
+			 array_size(batch.count, sizeof(*regions))))
+		ret = -EFAULT;
+
+	/* map all or nothing */
+	if (map && ret) {
+		for (i = 0; i < batch.done; i++)
+			afu_dma_unmap_region(pdata, regions[i].iova);
+		batch.done = 0;
+	}
+
+	if (copy_to_user(arg, &batch, minsz) && !ret)
+		ret = -EFAULT;
+
+	kfree(regions);
+
+	return ret;
+}
+
 static long
 afu_ioctl_dma_unmap(struct dfl_feature_platform_data *pdata, void __user *arg)
 {
@@ -778,6 +873,12 @@ static long afu_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
 		return afu_ioctl_dma_map(pdata, (void __user *)arg);
 	case DFL_FPGA_PORT_DMA_UNMAP:
 		return afu_ioctl_dma_unmap(pdata, (void __user *)arg);
+	case DFL_FPGA_PORT_DMA_MAP_DMABUF:
+		return afu_ioctl_dma_map_dmabuf(pdata, (void __user *)arg);
+	case DFL_FPGA_PORT_DMA_MAP_BATCH:
+		return afu_ioctl_dma_batch(pdata, (void __user *)arg, true);
+	case DFL_FPGA_PORT_DMA_UNMAP_BATCH:
+		return afu_ioctl_dma_batch(pdata, (void __user *)arg, false);
 	default:
 		/*
 		 * Let sub-feature's ioctl function to handle the cmd
@@ -954,6 +1055,7 @@ static struct platform_driver afu_driver = {
 	.driver	= {
 		.name	    = DFL_FPGA_FEATURE_DEV_PORT,
 		.dev_groups = afu_dev_groups,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.probe   = afu_probe,
 	.remove  = afu_remove,
@@ -986,3 +1088,4 @@ MODULE_DESCRIPTION("FPGA Accelerated Function Unit driver");
 MODULE_AUTHOR("Intel Corporation");
 MODULE_LICENSE("GPL v2");
 MODULE_ALIAS("platform:dfl-port");
+MODULE_IMPORT_NS(DMA_BUF);
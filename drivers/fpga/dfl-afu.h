@@ -17,6 +17,7 @@
 #ifndef __DFL_AFU_H
 #define __DFL_AFU_H
 
+#include <linux/maple_tree.h>
 #include <linux/mm.h>
 
 #include "dfl.h"
@@ -47,7 +48,10 @@ struct dfl_afu_mmio_region {
  * @length: region length.
  * @iova: region IO virtual address.
  * @pages: ptr to pages of this region.
- * @node: rb tree node.
+ * @sgt: dma mapped scatter gather table of this region.
+ * @dmabuf: imported dma-buf, for regions mapped from a dma-buf.
+ * @attach: attachment of @dmabuf to the device.
+ * @rcu: rcu head for freeing, the region may be looked up without lock.
  * @in_use: flag to indicate if this region is in_use.
  */
 struct dfl_afu_dma_region {
@@ -55,7 +59,10 @@ struct dfl_afu_dma_region {
 	u64 length;
 	u64 iova;
 	struct page **pages;
-	struct rb_node node;
+	struct sg_table *sgt;
+	struct dma_buf *dmabuf;
+	struct dma_buf_attachment *attach;
+	struct rcu_head rcu;
 	bool in_use;
 };
 
@@ -65,7 +72,7 @@ struct dfl_afu_dma_region {
  * @region_cur_offset: current region offset from start to the device fd.
  * @num_regions: num of mmio regions.
  * @regions: the mmio region linked list of this afu feature device.
- * @dma_regions: root of dma regions rb tree.
+ * @dma_regions: dma regions maple tree, indexed by iova range.
  * @num_umsgs: num of umsgs.
  * @pdata: afu platform device's pdata.
  */
@@ -74,7 +81,7 @@ struct dfl_afu {
 	int num_regions;
 	u8 num_umsgs;
 	struct list_head regions;
-	struct rb_root dma_regions;
+	struct maple_tree dma_regions;
 
 	struct dfl_feature_platform_data *pdata;
 };
@@ -97,6 +104,8 @@ void afu_dma_region_init(struct dfl_feature_platform_data *pdata);
 void afu_dma_region_destroy(struct dfl_feature_platform_data *pdata);
 int afu_dma_map_region(struct dfl_feature_platform_data *pdata,
 		       u64 user_addr, u64 length, u64 *iova);
+int afu_dma_map_dmabuf(struct dfl_feature_platform_data *pdata, int fd,
+		       u64 *length, u64 *iova);
 int afu_dma_unmap_region(struct dfl_feature_platform_data *pdata, u64 iova);
 struct dfl_afu_dma_region *
 afu_dma_region_find(struct dfl_feature_platform_data *pdata,
@@ -748,6 +748,7 @@ static struct platform_driver fme_driver = {
 	.driver	= {
 		.name       = DFL_FPGA_FEATURE_DEV_FME,
 		.dev_groups = fme_dev_groups,
+		.probe_type = PROBE_PREFER_ASYNCHRONOUS,
 	},
 	.probe   = fme_probe,
 	.remove  = fme_remove,
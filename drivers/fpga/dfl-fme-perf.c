@@ -16,6 +16,7 @@
  *   Mitchel, Henry <henry.mitchel@intel.com>
  */
 
+#include <linux/hrtimer.h>
 #include <linux/perf_event.h>
 #include "dfl.h"
 #include "dfl-fme.h"
@@ -130,6 +131,12 @@
 
 #define PERF_MAX_PORT_NUM		1U
 
+/*
+ * The counters can't raise an interrupt, sampling events are checked for
+ * having reached their period from a timer at this interval.
+ */
+#define PERF_SAMPLE_INTERVAL_NS		(1 * NSEC_PER_MSEC)
+
 /**
  * struct fme_perf_priv - priv data structure for fme perf driver
  *
@@ -139,10 +146,13 @@
  * @id: id of this fme performance report private feature.
  * @fab_users: current user number on fabric counters.
  * @fab_port_id: used to indicate current working mode of fabric counters.
- * @fab_lock: lock to protect fabric counters working mode.
+ * @fab_lock: lock to protect fabric counters working mode and FAB_CTRL.
  * @cpu: active CPU to which the PMU is bound for accesses.
  * @cpuhp_node: node for CPU hotplug notifier link.
  * @cpuhp_state: state for CPU hotplug notification;
+ * @hrtimer: timer checking sampling events for overflow.
+ * @sampling: list of started sampling events, only accessed on @cpu.
+ * @txn_flags: flags of the current pmu transaction.
  */
 struct fme_perf_priv {
 	struct device *dev;
@@ -157,6 +167,10 @@ struct fme_perf_priv {
 	unsigned int cpu;
 	struct hlist_node node;
 	enum cpuhp_state cpuhp_state;
+
+	struct hrtimer hrtimer;
+	struct list_head sampling;
+	unsigned int txn_flags;
 };
 
 /**
@@ -363,6 +377,7 @@ static bool is_fabric_event_supported(struct fme_perf_priv *priv, u32 event,
 static int fabric_event_init(struct fme_perf_priv *priv, u32 event, u32 portid)
 {
 	void __iomem *base = priv->ioaddr;
+	unsigned long flags;
 	int ret = 0;
 	u64 v;
 
@@ -377,7 +392,7 @@ static int fabric_event_init(struct fme_perf_priv *priv, u32 event, u32 portid)
 	 * so every time, a new event is initialized, driver checks
 	 * current working mode and if someone is using this counter set.
 	 */
-	spin_lock(&priv->fab_lock);
+	spin_lock_irqsave(&priv->fab_lock, flags);
 	if (priv->fab_users && priv->fab_port_id != portid) {
 		dev_dbg(priv->dev, "conflict fabric event monitoring mode.\n");
 		ret = -EOPNOTSUPP;
@@ -407,24 +422,29 @@ static int fabric_event_init(struct fme_perf_priv *priv, u32 event, u32 portid)
 	writeq(v, base + FAB_CTRL);
 
 exit:
-	spin_unlock(&priv->fab_lock);
+	spin_unlock_irqrestore(&priv->fab_lock, flags);
 	return ret;
 }
 
 static void fabric_event_destroy(struct fme_perf_priv *priv, u32 event,
 				 u32 portid)
 {
-	spin_lock(&priv->fab_lock);
+	unsigned long flags;
+
+	spin_lock_irqsave(&priv->fab_lock, flags);
 	priv->fab_users--;
-	spin_unlock(&priv->fab_lock);
+	spin_unlock_irqrestore(&priv->fab_lock, flags);
 }
 
 static u64 fabric_read_event_counter(struct fme_perf_priv *priv, u32 event,
 				     u32 portid)
 {
 	void __iomem *base = priv->ioaddr;
+	unsigned long flags;
 	u64 v;
 
+	/* the event selected in FAB_CTRL must not change until it is read */
+	spin_lock_irqsave(&priv->fab_lock, flags);
 	v = readq(base + FAB_CTRL);
 	v &= ~FAB_CTRL_EVNT;
 	v |= FIELD_PREP(FAB_CTRL_EVNT, event);
@@ -433,11 +453,14 @@ static u64 fabric_read_event_counter(struct fme_perf_priv *priv, u32 event,
 	if (readq_poll_timeout_atomic(base + FAB_CNTR, v,
 				      FIELD_GET(FAB_CNTR_EVNT, v) == event,
 				      1, PERF_TIMEOUT)) {
+		spin_unlock_irqrestore(&priv->fab_lock, flags);
 		dev_err(priv->dev, "timeout, unmatched fab event code in counter register.\n");
 		return 0;
 	}
 
 	v = fme_read_perf_cntr_reg(base + FAB_CNTR);
+	spin_unlock_irqrestore(&priv->fab_lock, flags);
+
 	return FIELD_GET(FAB_CNTR_EVNT_CNTR, v);
 }
 
@@ -792,6 +815,24 @@ static void fme_perf_event_destroy(struct perf_event *event)
 		ops->event_destroy(priv, event->hw.idx, event->hw.config_base);
 }
 
+/*
+ * All hardware events of a group have to be from this PMU, so the group can
+ * be scheduled on the counters of one FME and read at once.
+ */
+static bool fme_perf_validate_group(struct perf_event *event)
+{
+	struct perf_event *sibling, *leader = event->group_leader;
+
+	if (leader->pmu != event->pmu && !is_software_event(leader))
+		return false;
+
+	for_each_sibling_event(sibling, leader)
+		if (sibling->pmu != event->pmu && !is_software_event(sibling))
+			return false;
+
+	return true;
+}
+
 static int fme_perf_event_init(struct perf_event *event)
 {
 	struct fme_perf_priv *priv = to_fme_perf_priv(event->pmu);
@@ -806,9 +847,9 @@ static int fme_perf_event_init(struct perf_event *event)
 	/*
 	 * fme counters are shared across all cores.
 	 * Therefore, it does not support per-process mode.
-	 * Also, it does not support event sampling mode.
+	 * Sampling mode is done from a timer, see fme_perf_hrtimer().
 	 */
-	if (is_sampling_event(event) || event->attach_state & PERF_ATTACH_TASK)
+	if (event->attach_state & PERF_ATTACH_TASK)
 		return -EINVAL;
 
 	if (event->cpu < 0)
@@ -817,6 +858,9 @@ static int fme_perf_event_init(struct perf_event *event)
 	if (event->cpu != priv->cpu)
 		return -EINVAL;
 
+	if (!fme_perf_validate_group(event))
+		return -EINVAL;
+
 	eventid = get_event(event->attr.config);
 	portid = get_portid(event->attr.config);
 	evtype = get_evtype(event->attr.config);
@@ -839,7 +883,7 @@ static int fme_perf_event_init(struct perf_event *event)
 	return 0;
 }
 
-static void fme_perf_event_update(struct perf_event *event)
+static u64 fme_perf_event_update(struct perf_event *event)
 {
 	struct fme_perf_event_ops *ops = get_event_ops(event->hw.event_base);
 	struct fme_perf_priv *priv = to_fme_perf_priv(event->pmu);
@@ -847,10 +891,12 @@ static void fme_perf_event_update(struct perf_event *event)
 	u64 now, prev, delta;
 
 	now = ops->read_counter(priv, (u32)hwc->idx, hwc->config_base);
-	prev = local64_read(&hwc->prev_count);
+	prev = local64_xchg(&hwc->prev_count, now);
 	delta = now - prev;
 
 	local64_add(delta, &event->count);
+
+	return delta;
 }
 
 static void fme_perf_event_start(struct perf_event *event, int flags)
@@ -862,15 +908,39 @@ static void fme_perf_event_start(struct perf_event *event, int flags)
 
 	count = ops->read_counter(priv, (u32)hwc->idx, hwc->config_base);
 	local64_set(&hwc->prev_count, count);
+	hwc->state = 0;
+
+	if (is_sampling_event(event)) {
+		if (list_empty(&priv->sampling))
+			hrtimer_start(&priv->hrtimer,
+				      ns_to_ktime(PERF_SAMPLE_INTERVAL_NS),
+				      HRTIMER_MODE_REL_PINNED_HARD);
+		list_add_tail(&event->active_entry, &priv->sampling);
+	}
 }
 
 static void fme_perf_event_stop(struct perf_event *event, int flags)
 {
+	struct fme_perf_priv *priv = to_fme_perf_priv(event->pmu);
+	struct hw_perf_event *hwc = &event->hw;
+
+	if (hwc->state & PERF_HES_STOPPED)
+		return;
+
+	if (is_sampling_event(event)) {
+		list_del(&event->active_entry);
+		if (list_empty(&priv->sampling))
+			hrtimer_try_to_cancel(&priv->hrtimer);
+	}
+
 	fme_perf_event_update(event);
+	hwc->state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
 }
 
 static int fme_perf_event_add(struct perf_event *event, int flags)
 {
+	event->hw.state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+
 	if (flags & PERF_EF_START)
 		fme_perf_event_start(event, flags);
 
@@ -884,9 +954,126 @@ static void fme_perf_event_del(struct perf_event *event, int flags)
 
 static void fme_perf_event_read(struct perf_event *event)
 {
+	if (event->hw.state & PERF_HES_STOPPED)
+		return;
+
 	fme_perf_event_update(event);
 }
 
+/*
+ * Sampling without overflow interrupt: account what the counter moved since
+ * the last tick and emit a sample, with the registers of the code the timer
+ * interrupted, whenever the event crossed its sample period.
+ */
+static void fme_perf_event_sample(struct perf_event *event,
+				  struct pt_regs *regs)
+{
+	struct hw_perf_event *hwc = &event->hw;
+	struct perf_sample_data data;
+	s64 left;
+
+	left = local64_sub_return(fme_perf_event_update(event),
+				  &hwc->period_left);
+	if (left > 0)
+		return;
+
+	if (left <= -(s64)hwc->sample_period)
+		left = 0;
+	local64_set(&hwc->period_left, left + hwc->sample_period);
+
+	perf_sample_data_init(&data, 0, hwc->last_period);
+	hwc->last_period = hwc->sample_period;
+
+	if (perf_event_overflow(event, &data, regs))
+		fme_perf_event_stop(event, 0);
+}
+
+static enum hrtimer_restart fme_perf_hrtimer(struct hrtimer *hrtimer)
+{
+	struct fme_perf_priv *priv =
+		container_of(hrtimer, struct fme_perf_priv, hrtimer);
+	struct perf_event *event, *tmp;
+	struct pt_regs *regs = get_irq_regs();
+
+	if (list_empty(&priv->sampling))
+		return HRTIMER_NORESTART;
+
+	if (regs)
+		list_for_each_entry_safe(event, tmp, &priv->sampling,
+					 active_entry)
+			fme_perf_event_sample(event, regs);
+
+	if (list_empty(&priv->sampling))
+		return HRTIMER_NORESTART;
+
+	hrtimer_forward_now(hrtimer, ns_to_ktime(PERF_SAMPLE_INTERVAL_NS));
+
+	return HRTIMER_RESTART;
+}
+
+/*
+ * Freeze the counters while the events of a group are read, so they all
+ * count over the same time.
+ */
+static void fme_perf_freeze(struct fme_perf_priv *priv, bool freeze)
+{
+	static const struct {
+		u32 ctrl;
+		u64 bit;
+	} ctrls[] = {
+		{ CACHE_CTRL,	CACHE_FREEZE_CNTR },
+		{ FAB_CTRL,	FAB_FREEZE_CNTR },
+		{ VTD_CTRL,	VTD_FREEZE_CNTR },
+		{ VTD_SIP_CTRL,	VTD_SIP_FREEZE_CNTR },
+	};
+	void __iomem *base = priv->ioaddr;
+	unsigned long flags;
+	unsigned int i;
+	u64 v;
+
+	/* FAB_CTRL also holds the port mode and the selected event */
+	spin_lock_irqsave(&priv->fab_lock, flags);
+	for (i = 0; i < ARRAY_SIZE(ctrls); i++) {
+		/* only the fabric counters are implemented by the DPERF */
+		if (priv->id != FME_FEATURE_ID_GLOBAL_IPERF &&
+		    ctrls[i].ctrl != FAB_CTRL)
+			continue;
+
+		v = readq(base + ctrls[i].ctrl);
+		if (freeze)
+			v |= ctrls[i].bit;
+		else
+			v &= ~ctrls[i].bit;
+		writeq(v, base + ctrls[i].ctrl);
+	}
+	spin_unlock_irqrestore(&priv->fab_lock, flags);
+}
+
+static void fme_perf_start_txn(struct pmu *pmu, unsigned int txn_flags)
+{
+	struct fme_perf_priv *priv = to_fme_perf_priv(pmu);
+
+	priv->txn_flags = txn_flags;
+	if (txn_flags & PERF_PMU_TXN_READ)
+		fme_perf_freeze(priv, true);
+}
+
+static int fme_perf_commit_txn(struct pmu *pmu)
+{
+	struct fme_perf_priv *priv = to_fme_perf_priv(pmu);
+
+	if (priv->txn_flags & PERF_PMU_TXN_READ)
+		fme_perf_freeze(priv, false);
+	priv->txn_flags = 0;
+
+	return 0;
+}
+
+static void fme_perf_cancel_txn(struct pmu *pmu)
+{
+	fme_perf_commit_txn(pmu);
+}
+
 static void fme_perf_setup_hardware(struct fme_perf_priv *priv)
 {
 	void __iomem *base = priv->ioaddr;
@@ -909,6 +1096,9 @@ static int fme_perf_pmu_register(struct platform_device *pdev,
 	int ret;
 
 	spin_lock_init(&priv->fab_lock);
+	INIT_LIST_HEAD(&priv->sampling);
+	hrtimer_init(&priv->hrtimer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_HARD);
+	priv->hrtimer.function = fme_perf_hrtimer;
 
 	fme_perf_setup_hardware(priv);
 
@@ -921,8 +1111,10 @@ static int fme_perf_pmu_register(struct platform_device *pdev,
 	pmu->start =		fme_perf_event_start;
 	pmu->stop =		fme_perf_event_stop;
 	pmu->read =		fme_perf_event_read;
-	pmu->capabilities =	PERF_PMU_CAP_NO_INTERRUPT |
-				PERF_PMU_CAP_NO_EXCLUDE;
+	pmu->start_txn =	fme_perf_start_txn;
+	pmu->commit_txn =	fme_perf_commit_txn;
+	pmu->cancel_txn =	fme_perf_cancel_txn;
+	pmu->capabilities =	PERF_PMU_CAP_NO_EXCLUDE;
 
 	name = devm_kasprintf(priv->dev, GFP_KERNEL, "dfl_fme%d", pdev->id);
 
@@ -936,6 +1128,7 @@ static int fme_perf_pmu_register(struct platform_device *pdev,
 static void fme_perf_pmu_unregister(struct fme_perf_priv *priv)
 {
 	perf_pmu_unregister(&priv->pmu);
+	hrtimer_cancel(&priv->hrtimer);
 }
 
 static int fme_perf_offline_cpu(unsigned int cpu, struct hlist_node *node)
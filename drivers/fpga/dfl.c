@@ -10,9 +10,12 @@
  *   Wu Hao <hao.wu@intel.com>
  *   Xiao Guangrong <guangrong.xiao@linux.intel.com>
  */
+#include <linux/debugfs.h>
 #include <linux/dfl.h>
 #include <linux/fpga-dfl.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
+#include <linux/seq_file.h>
 #include <linux/uaccess.h>
 
 #include "dfl.h"
@@ -689,6 +692,7 @@ EXPORT_SYMBOL_GPL(dfl_fpga_dev_ops_unregister);
  * @len: max register resource length of current FIU.
  * @sub_features: a sub features linked list for feature device in enumeration.
  * @feature_num: number of sub features for feature device in enumeration.
+ * @start_ns: time the enumeration of the current feature device started at.
  */
 struct build_feature_devs_info {
 	struct device *dev;
@@ -702,6 +706,7 @@ struct build_feature_devs_info {
 	resource_size_t len;
 	struct list_head sub_features;
 	int feature_num;
+	u64 start_ns;
 };
 
 /**
@@ -764,6 +769,7 @@ static int build_info_commit_dev(struct build_feature_devs_info *binfo)
 
 	pdata->dev = fdev;
 	pdata->num = binfo->feature_num;
+	pdata->enum_ns = ktime_get_ns() - binfo->start_ns;
 	pdata->dfl_cdev = binfo->cdev;
 	pdata->id = FEATURE_DEV_ID_UNUSED;
 	mutex_init(&pdata->lock);
@@ -875,6 +881,7 @@ build_info_create_dev(struct build_feature_devs_info *binfo,
 
 	binfo->feature_dev = fdev;
 	binfo->feature_num = 0;
+	binfo->start_ns = ktime_get_ns();
 
 	INIT_LIST_HEAD(&binfo->sub_features);
 
@@ -1388,6 +1395,41 @@ static void remove_feature_devs(struct dfl_fpga_cdev *cdev)
 	device_for_each_child(&cdev->region->dev, NULL, remove_feature_dev);
 }
 
+static struct dentry *dfl_debugfs_root;
+
+static void dfl_enum_timing_show_dev(struct seq_file *s,
+				     struct dfl_feature_platform_data *pdata)
+{
+	seq_printf(s, "%s: %d features, %llu us\n", dev_name(&pdata->dev->dev),
+		   pdata->num, div_u64(pdata->enum_ns, NSEC_PER_USEC));
+}
+
+static int dfl_enum_timing_show(struct seq_file *s, void *unused)
+{
+	struct dfl_fpga_cdev *cdev = s->private;
+	struct dfl_feature_platform_data *pdata;
+
+	seq_printf(s, "total: %llu us\n", div_u64(cdev->enum_ns, NSEC_PER_USEC));
+
+	mutex_lock(&cdev->lock);
+	if (cdev->fme_dev)
+		dfl_enum_timing_show_dev(s, dev_get_platdata(cdev->fme_dev));
+	list_for_each_entry(pdata, &cdev->port_dev_list, node)
+		dfl_enum_timing_show_dev(s, pdata);
+	mutex_unlock(&cdev->lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(dfl_enum_timing);
+
+static void dfl_fpga_cdev_debugfs_init(struct dfl_fpga_cdev *cdev)
+{
+	cdev->dbgfs = debugfs_create_dir(dev_name(cdev->parent),
+					 dfl_debugfs_root);
+	debugfs_create_file("enum_timing", 0444, cdev->dbgfs, cdev,
+			    &dfl_enum_timing_fops);
+}
+
 /**
  * dfl_fpga_feature_devs_enumerate - enumerate feature devices
  * @info: information for enumeration.
@@ -1404,6 +1446,7 @@ dfl_fpga_feature_devs_enumerate(struct dfl_fpga_enum_info *info)
 	struct build_feature_devs_info *binfo;
 	struct dfl_fpga_enum_dfl *dfl;
 	struct dfl_fpga_cdev *cdev;
+	u64 start = ktime_get_ns();
 	int ret = 0;
 
 	if (!info->dev)
@@ -1452,6 +1495,9 @@ dfl_fpga_feature_devs_enumerate(struct dfl_fpga_enum_info *info)
 
 	build_info_free(binfo);
 
+	cdev->enum_ns = ktime_get_ns() - start;
+	dfl_fpga_cdev_debugfs_init(cdev);
+
 	return cdev;
 
 unregister_region_exit:
@@ -1473,6 +1519,8 @@ void dfl_fpga_feature_devs_remove(struct dfl_fpga_cdev *cdev)
 {
 	struct dfl_feature_platform_data *pdata, *ptmp;
 
+	debugfs_remove_recursive(cdev->dbgfs);
+
 	mutex_lock(&cdev->lock);
 	if (cdev->fme_dev)
 		put_device(cdev->fme_dev);
@@ -1545,9 +1593,12 @@ static int __init dfl_fpga_init(void)
 	if (ret) {
 		dfl_ids_destroy();
 		bus_unregister(&dfl_bus_type);
+		return ret;
 	}
 
-	return ret;
+	dfl_debugfs_root = debugfs_create_dir("dfl", NULL);
+
+	return 0;
 }
 
 /**
@@ -1881,6 +1932,7 @@ EXPORT_SYMBOL_GPL(dfl_feature_ioctl_set_irq);
 
 static void __exit dfl_fpga_exit(void)
 {
+	debugfs_remove_recursive(dfl_debugfs_root);
 	dfl_chardev_uinit();
 	dfl_ids_destroy();
 	bus_unregister(&dfl_bus_type);
@@ -269,6 +269,7 @@ struct dfl_feature {
  * @excl_open: set on feature device exclusive open.
  * @open_count: count for feature device open.
  * @num: number for sub features.
+ * @enum_ns: time taken to enumerate this feature device, in ns.
  * @private: ptr to feature dev private data.
  * @features: sub features of this feature dev.
  */
@@ -284,6 +285,7 @@ struct dfl_feature_platform_data {
 	int open_count;
 	void *private;
 	int num;
+	u64 enum_ns;
 	struct dfl_feature features[];
 };
 
@@ -470,6 +472,8 @@ void dfl_fpga_enum_info_free(struct dfl_fpga_enum_info *info);
  * @lock: mutex lock to protect the port device list.
  * @port_dev_list: list of all port feature devices under this container device.
  * @released_port_num: released port number under this container device.
+ * @enum_ns: time taken to enumerate all the feature devices, in ns.
+ * @dbgfs: debugfs directory of this container device.
  */
 struct dfl_fpga_cdev {
 	struct device *parent;
@@ -478,6 +482,8 @@ struct dfl_fpga_cdev {
 	struct mutex lock;
 	struct list_head port_dev_list;
 	int released_port_num;
+	u64 enum_ns;
+	struct dentry *dbgfs;
 };
 
 struct dfl_fpga_cdev *
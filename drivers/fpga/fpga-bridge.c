@@ -6,8 +6,10 @@
  *  Copyright (C) 2017 Intel Corporation
  */
 #include <linux/fpga/fpga-bridge.h>
+#include <linux/delay.h>
 #include <linux/idr.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/of_platform.h>
 #include <linux/slab.h>
@@ -26,14 +28,24 @@ static DEFINE_SPINLOCK(bridge_list_lock);
  *
  * Return: 0 for success, error code otherwise.
  */
-int fpga_bridge_enable(struct fpga_bridge *bridge)
+static int fpga_bridge_set(struct fpga_bridge *bridge, bool enable)
 {
-	dev_dbg(&bridge->dev, "enable\n");
+	ktime_t start = ktime_get();
+	int ret = 0;
 
 	if (bridge->br_ops && bridge->br_ops->enable_set)
-		return bridge->br_ops->enable_set(bridge, 1);
+		ret = bridge->br_ops->enable_set(bridge, enable);
 
-	return 0;
+	bridge->latency_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	return ret;
+}
+
+int fpga_bridge_enable(struct fpga_bridge *bridge)
+{
+	dev_dbg(&bridge->dev, "enable\n");
+
+	return fpga_bridge_set(bridge, 1);
 }
 EXPORT_SYMBOL_GPL(fpga_bridge_enable);
 
@@ -48,10 +60,7 @@ int fpga_bridge_disable(struct fpga_bridge *bridge)
 {
 	dev_dbg(&bridge->dev, "disable\n");
 
-	if (bridge->br_ops && bridge->br_ops->enable_set)
-		return bridge->br_ops->enable_set(bridge, 0);
-
-	return 0;
+	return fpga_bridge_set(bridge, 0);
 }
 EXPORT_SYMBOL_GPL(fpga_bridge_disable);
 
@@ -151,26 +160,97 @@ void fpga_bridge_put(struct fpga_bridge *bridge)
 }
 EXPORT_SYMBOL_GPL(fpga_bridge_put);
 
+static u32 fpga_bridge_timeout_us(struct fpga_bridge *bridge, bool enable)
+{
+	if (!bridge->info)
+		return 0;
+
+	return enable ? bridge->info->enable_timeout_us :
+			bridge->info->disable_timeout_us;
+}
+
+/*
+ * The bridges which can start a request without waiting for it are all
+ * started first, then polled together every microsecond until the longest
+ * of their timeouts, so that quiescing several regions takes as long as the
+ * slowest of them rather than the sum.  The other bridges are handled in
+ * list order as they are met.
+ */
+static int fpga_bridges_set(struct list_head *bridge_list, bool enable)
+{
+	struct fpga_bridge *bridge;
+	u32 timeout_us = 0;
+	ktime_t start, deadline;
+	bool pending = false, timeout;
+	int ret, err = 0;
+
+	start = ktime_get();
+	list_for_each_entry(bridge, bridge_list, node) {
+		bridge->pending = false;
+		if (err)
+			continue;
+
+		if (!bridge->br_ops || !bridge->br_ops->enable_start) {
+			dev_dbg(&bridge->dev, "%s\n", enable ? "enable" : "disable");
+			err = fpga_bridge_set(bridge, enable);
+			continue;
+		}
+
+		dev_dbg(&bridge->dev, "start %s\n", enable ? "enable" : "disable");
+		err = bridge->br_ops->enable_start(bridge, enable);
+		if (err)
+			continue;
+
+		bridge->pending = true;
+		pending = true;
+		timeout_us = max(timeout_us,
+				 fpga_bridge_timeout_us(bridge, enable));
+	}
+
+	deadline = ktime_add_us(start, timeout_us);
+	while (pending) {
+		timeout = ktime_after(ktime_get(), deadline);
+		pending = false;
+
+		list_for_each_entry(bridge, bridge_list, node) {
+			if (!bridge->pending)
+				continue;
+
+			ret = bridge->br_ops->enable_poll(bridge, timeout);
+			if (ret == -EBUSY && !timeout) {
+				pending = true;
+				continue;
+			}
+
+			bridge->pending = false;
+			bridge->latency_ns =
+				ktime_to_ns(ktime_sub(ktime_get(), start));
+			dev_dbg(&bridge->dev, "%s in %llu ns: %d\n",
+				enable ? "enabled" : "disabled",
+				bridge->latency_ns, ret);
+			if (ret && !err)
+				err = ret;
+		}
+
+		if (pending)
+			udelay(1);
+	}
+
+	return err;
+}
+
 /**
  * fpga_bridges_enable - enable bridges in a list
  * @bridge_list: list of FPGA bridges
  *
- * Enable each bridge in the list.  If list is empty, do nothing.
+ * Enable each bridge in the list.  If list is empty, do nothing.  The
+ * bridges implementing enable_start are enabled concurrently.
  *
  * Return 0 for success or empty bridge list; return error code otherwise.
  */
 int fpga_bridges_enable(struct list_head *bridge_list)
 {
-	struct fpga_bridge *bridge;
-	int ret;
-
-	list_for_each_entry(bridge, bridge_list, node) {
-		ret = fpga_bridge_enable(bridge);
-		if (ret)
-			return ret;
-	}
-
-	return 0;
+	return fpga_bridges_set(bridge_list, true);
 }
 EXPORT_SYMBOL_GPL(fpga_bridges_enable);
 
@@ -179,22 +259,14 @@ EXPORT_SYMBOL_GPL(fpga_bridges_enable);
  *
  * @bridge_list: list of FPGA bridges
  *
- * Disable each bridge in the list.  If list is empty, do nothing.
+ * Disable each bridge in the list.  If list is empty, do nothing.  The
+ * bridges implementing enable_start are disabled concurrently.
  *
  * Return 0 for success or empty bridge list; return error code otherwise.
  */
 int fpga_bridges_disable(struct list_head *bridge_list)
 {
-	struct fpga_bridge *bridge;
-	int ret;
-
-	list_for_each_entry(bridge, bridge_list, node) {
-		ret = fpga_bridge_disable(bridge);
-		if (ret)
-			return ret;
-	}
-
-	return 0;
+	return fpga_bridges_set(bridge_list, false);
 }
 EXPORT_SYMBOL_GPL(fpga_bridges_disable);
 
@@ -301,12 +373,22 @@ static ssize_t state_show(struct device *dev,
 	return scnprintf(buf, 10, "%s\n", enable ? "enabled" : "disabled");
 }
 
+static ssize_t latency_ns_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct fpga_bridge *bridge = to_fpga_bridge(dev);
+
+	return sysfs_emit(buf, "%llu\n", bridge->latency_ns);
+}
+
 static DEVICE_ATTR_RO(name);
 static DEVICE_ATTR_RO(state);
+static DEVICE_ATTR_RO(latency_ns);
 
 static struct attribute *fpga_bridge_attrs[] = {
 	&dev_attr_name.attr,
 	&dev_attr_state.attr,
+	&dev_attr_latency_ns.attr,
 	NULL,
 };
 ATTRIBUTE_GROUPS(fpga_bridge);
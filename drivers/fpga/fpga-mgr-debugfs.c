@@ -17,11 +17,17 @@
  */
 #include <linux/debugfs.h>
 #include <linux/fpga/fpga-mgr.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/uaccess.h>
 
 #if IS_ENABLED(CONFIG_FPGA_MGR_DEBUG_FS)
 
+/* bounce buffer size of the image_stream file */
+#define FPGA_MGR_STREAM_BUF_SIZE	SZ_64K
+
 static struct dentry *fpga_mgr_debugfs_root;
 
 struct fpga_mgr_debugfs {
@@ -44,7 +50,7 @@ static ssize_t fpga_mgr_firmware_write_file(struct file *file,
 		return -EBUSY;
 	}
 
-	buf = devm_kzalloc(&mgr->dev, count, GFP_KERNEL);
+	buf = devm_kzalloc(&mgr->dev, count + 1, GFP_KERNEL);
 	if (!buf) {
 		fpga_mgr_unlock(mgr);
 		return -ENOMEM;
@@ -168,6 +174,171 @@ static const struct file_operations fpga_mgr_image_fops = {
 	.llseek = default_llseek,
 };
 
+struct fpga_mgr_debugfs_stream {
+	struct fpga_manager *mgr;
+	struct fpga_mgr_stream *stream;
+	char *buf;
+};
+
+/*
+ * The image_stream file programs the FPGA with everything written between
+ * open() and close(), without ever holding more than a bounce buffer of the
+ * image in memory, so it can be fed from a pipe.
+ */
+static int fpga_mgr_image_stream_open(struct inode *inode, struct file *file)
+{
+	struct fpga_manager *mgr = inode->i_private;
+	struct fpga_mgr_debugfs *debugfs = mgr->debugfs;
+	struct fpga_mgr_debugfs_stream *ds;
+	int ret;
+
+	ds = kzalloc(sizeof(*ds), GFP_KERNEL);
+	if (!ds)
+		return -ENOMEM;
+
+	ds->buf = kmalloc(FPGA_MGR_STREAM_BUF_SIZE, GFP_KERNEL);
+	if (!ds->buf) {
+		ret = -ENOMEM;
+		goto err_free;
+	}
+
+	ret = fpga_mgr_lock(mgr);
+	if (ret) {
+		dev_err(&mgr->dev, "FPGA manager is busy\n");
+		ret = -EBUSY;
+		goto err_free;
+	}
+
+	/* If firmware interface was previously used, forget it. */
+	if (debugfs->info->firmware_name)
+		devm_kfree(&mgr->dev, debugfs->info->firmware_name);
+	debugfs->info->firmware_name = NULL;
+
+	ds->stream = fpga_mgr_stream_start(mgr, debugfs->info);
+	if (IS_ERR(ds->stream)) {
+		ret = PTR_ERR(ds->stream);
+		fpga_mgr_unlock(mgr);
+		goto err_free;
+	}
+
+	dev_info(&mgr->dev, "streaming image to %s\n", mgr->name);
+
+	ds->mgr = mgr;
+	file->private_data = ds;
+
+	return nonseekable_open(inode, file);
+
+err_free:
+	kfree(ds->buf);
+	kfree(ds);
+	return ret;
+}
+
+static ssize_t fpga_mgr_image_stream_write(struct file *file,
+					   const char __user *user_buf,
+					   size_t count, loff_t *ppos)
+{
+	struct fpga_mgr_debugfs_stream *ds = file->private_data;
+	size_t done = 0, len;
+	int ret;
+
+	while (done < count) {
+		len = min_t(size_t, count - done, FPGA_MGR_STREAM_BUF_SIZE);
+		if (copy_from_user(ds->buf, user_buf + done, len))
+			return done ? done : -EFAULT;
+
+		ret = fpga_mgr_stream_write(ds->stream, ds->buf, len);
+		if (ret) {
+			dev_err(&ds->mgr->dev,
+				"fpga_mgr_stream_write returned with value %d\n",
+				ret);
+			return ret;
+		}
+		done += len;
+	}
+
+	return done;
+}
+
+static int fpga_mgr_image_stream_release(struct inode *inode,
+					 struct file *file)
+{
+	struct fpga_mgr_debugfs_stream *ds = file->private_data;
+	int ret;
+
+	ret = fpga_mgr_stream_finish(ds->stream);
+	if (ret)
+		dev_err(&ds->mgr->dev,
+			"fpga_mgr_stream_finish returned with value %d\n", ret);
+
+	fpga_mgr_unlock(ds->mgr);
+	kfree(ds->buf);
+	kfree(ds);
+
+	return 0;
+}
+
+static const struct file_operations fpga_mgr_image_stream_fops = {
+	.open = fpga_mgr_image_stream_open,
+	.write = fpga_mgr_image_stream_write,
+	.release = fpga_mgr_image_stream_release,
+	.llseek = no_llseek,
+};
+
+static const char * const fpga_mgr_phase_names[FPGA_MGR_PHASE_MAX] = {
+	[FPGA_MGR_PHASE_PARSE_HEADER]	= "parse_header",
+	[FPGA_MGR_PHASE_WRITE_INIT]	= "write_init",
+	[FPGA_MGR_PHASE_WRITE]		= "write",
+	[FPGA_MGR_PHASE_WRITE_COMPLETE]	= "write_complete",
+};
+
+static void fpga_mgr_stats_show_load(struct seq_file *s, const char *name,
+				     const struct fpga_mgr_load_stats *load)
+{
+	int i;
+
+	seq_printf(s, "%s:\n", name);
+	for (i = 0; i < FPGA_MGR_PHASE_MAX; i++)
+		seq_printf(s, "  %-16s calls %-8llu bytes %-12llu ns %llu\n",
+			   fpga_mgr_phase_names[i], load->calls[i],
+			   load->bytes[i], load->ns[i]);
+	seq_printf(s, "  %-16s %llu\n", "retries", load->retries);
+}
+
+static int fpga_mgr_stats_show(struct seq_file *s, void *data)
+{
+	struct fpga_manager *mgr = s->private;
+	struct fpga_mgr_stats *stats = &mgr->stats;
+	struct fpga_mgr_load_stats last, total;
+	u64 loads, failures, last_ns, rate = 0;
+	int last_ret;
+
+	spin_lock(&stats->lock);
+	loads = stats->loads;
+	failures = stats->failures;
+	last = stats->last;
+	total = stats->total;
+	last_ns = stats->last_ns;
+	last_ret = stats->last_ret;
+	spin_unlock(&stats->lock);
+
+	/* whole load throughput, in KiB/s */
+	if (last_ns)
+		rate = div64_u64(last.bytes[FPGA_MGR_PHASE_WRITE] * NSEC_PER_SEC,
+				 last_ns) >> 10;
+
+	seq_printf(s, "loads:     %llu\n", loads);
+	seq_printf(s, "failures:  %llu\n", failures);
+	seq_printf(s, "last_ret:  %d\n", last_ret);
+	seq_printf(s, "last_ns:   %llu\n", last_ns);
+	seq_printf(s, "last_kbps: %llu\n", rate);
+	fpga_mgr_stats_show_load(s, "last", &last);
+	fpga_mgr_stats_show_load(s, "total", &total);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(fpga_mgr_stats);
+
 void fpga_mgr_debugfs_add(struct fpga_manager *mgr)
 {
 	struct fpga_mgr_debugfs *debugfs;
@@ -196,6 +367,12 @@ void fpga_mgr_debugfs_add(struct fpga_manager *mgr)
 	debugfs_create_file("image", 0200, debugfs->debugfs_dir, mgr,
 			    &fpga_mgr_image_fops);
 
+	debugfs_create_file("image_stream", 0200, debugfs->debugfs_dir, mgr,
+			    &fpga_mgr_image_stream_fops);
+
+	debugfs_create_file("stats", 0400, debugfs->debugfs_dir, mgr,
+			    &fpga_mgr_stats_fops);
+
 	debugfs_create_u32("flags", 0600, debugfs->debugfs_dir, &info->flags);
 
 	debugfs_create_u32("config_complete_timeout_us", 0600,
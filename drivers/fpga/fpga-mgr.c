@@ -17,8 +17,12 @@
 #include <linux/slab.h>
 #include <linux/scatterlist.h>
 #include <linux/highmem.h>
+#include <linux/ktime.h>
 #include "fpga-mgr-debugfs.h"
 
+#define CREATE_TRACE_POINTS
+#include <trace/events/fpga_mgr.h>
+
 static DEFINE_IDA(fpga_mgr_ida);
 static struct class *fpga_mgr_class;
 
@@ -46,11 +50,98 @@ static inline u64 fpga_mgr_status(struct fpga_manager *mgr)
 	return 0;
 }
 
+/* Account one low level driver op call, started at @start, to @phase. */
+static void fpga_mgr_stats_phase(struct fpga_manager *mgr,
+				 enum fpga_mgr_phase phase, size_t bytes,
+				 u64 start, int ret)
+{
+	struct fpga_mgr_stats *stats = &mgr->stats;
+	u64 ns = ktime_get_ns() - start;
+
+	spin_lock(&stats->lock);
+	stats->cur.bytes[phase] += bytes;
+	stats->cur.ns[phase] += ns;
+	stats->cur.calls[phase]++;
+	spin_unlock(&stats->lock);
+
+	trace_fpga_mgr_phase(mgr, phase, bytes, ns, ret);
+}
+
+static void fpga_mgr_stats_begin(struct fpga_manager *mgr,
+				 struct fpga_image_info *info)
+{
+	struct fpga_mgr_stats *stats = &mgr->stats;
+
+	trace_fpga_mgr_load_start(mgr, info);
+
+	spin_lock(&stats->lock);
+	memset(&stats->cur, 0, sizeof(stats->cur));
+	stats->start_ns = ktime_get_ns();
+	spin_unlock(&stats->lock);
+}
+
+static void fpga_mgr_stats_end(struct fpga_manager *mgr, int ret)
+{
+	struct fpga_mgr_stats *stats = &mgr->stats;
+	u64 ns, bytes;
+	int i;
+
+	spin_lock(&stats->lock);
+	ns = ktime_get_ns() - stats->start_ns;
+	bytes = stats->cur.bytes[FPGA_MGR_PHASE_WRITE];
+	stats->loads++;
+	if (ret)
+		stats->failures++;
+	for (i = 0; i < FPGA_MGR_PHASE_MAX; i++) {
+		stats->total.bytes[i] += stats->cur.bytes[i];
+		stats->total.ns[i] += stats->cur.ns[i];
+		stats->total.calls[i] += stats->cur.calls[i];
+	}
+	stats->total.retries += stats->cur.retries;
+	stats->last = stats->cur;
+	stats->last_ns = ns;
+	stats->last_ret = ret;
+	spin_unlock(&stats->lock);
+
+	trace_fpga_mgr_load_end(mgr, bytes, ns, ret);
+}
+
+/**
+ * fpga_mgr_stats_add_retries - account retries of the low level driver
+ * @mgr:	fpga manager
+ * @retries:	number of retries
+ *
+ * Low level drivers call this from their ops when they had to repeat a step
+ * of the load, e.g. waiting for the device to accept more data, so it shows
+ * up in the programming statistics of the manager.
+ */
+void fpga_mgr_stats_add_retries(struct fpga_manager *mgr, unsigned int retries)
+{
+	struct fpga_mgr_stats *stats = &mgr->stats;
+
+	if (!retries)
+		return;
+
+	spin_lock(&stats->lock);
+	stats->cur.retries += retries;
+	spin_unlock(&stats->lock);
+
+	trace_fpga_mgr_retry(mgr, retries);
+}
+EXPORT_SYMBOL_GPL(fpga_mgr_stats_add_retries);
+
 static inline int fpga_mgr_write(struct fpga_manager *mgr, const char *buf, size_t count)
 {
-	if (mgr->mops->write)
-		return  mgr->mops->write(mgr, buf, count);
-	return -EOPNOTSUPP;
+	u64 start = ktime_get_ns();
+	int ret;
+
+	if (!mgr->mops->write)
+		return -EOPNOTSUPP;
+
+	ret = mgr->mops->write(mgr, buf, count);
+	fpga_mgr_stats_phase(mgr, FPGA_MGR_PHASE_WRITE, count, start, ret);
+
+	return ret;
 }
 
 /*
@@ -63,8 +154,13 @@ static inline int fpga_mgr_write_complete(struct fpga_manager *mgr,
 	int ret = 0;
 
 	mgr->state = FPGA_MGR_STATE_WRITE_COMPLETE;
-	if (mgr->mops->write_complete)
+	if (mgr->mops->write_complete) {
+		u64 start = ktime_get_ns();
+
 		ret = mgr->mops->write_complete(mgr, info);
+		fpga_mgr_stats_phase(mgr, FPGA_MGR_PHASE_WRITE_COMPLETE, 0,
+				     start, ret);
+	}
 	if (ret) {
 		dev_err(&mgr->dev, "Error after writing image data to FPGA\n");
 		mgr->state = FPGA_MGR_STATE_WRITE_COMPLETE_ERR;
@@ -79,26 +175,54 @@ static inline int fpga_mgr_parse_header(struct fpga_manager *mgr,
 					struct fpga_image_info *info,
 					const char *buf, size_t count)
 {
-	if (mgr->mops->parse_header)
-		return mgr->mops->parse_header(mgr, info, buf, count);
-	return 0;
+	u64 start = ktime_get_ns();
+	int ret;
+
+	if (!mgr->mops->parse_header)
+		return 0;
+
+	ret = mgr->mops->parse_header(mgr, info, buf, count);
+	fpga_mgr_stats_phase(mgr, FPGA_MGR_PHASE_PARSE_HEADER, count, start,
+			     ret);
+
+	return ret;
 }
 
 static inline int fpga_mgr_write_init(struct fpga_manager *mgr,
 				      struct fpga_image_info *info,
 				      const char *buf, size_t count)
 {
-	if (mgr->mops->write_init)
-		return  mgr->mops->write_init(mgr, info, buf, count);
-	return 0;
+	u64 start = ktime_get_ns();
+	int ret;
+
+	if (!mgr->mops->write_init)
+		return 0;
+
+	ret = mgr->mops->write_init(mgr, info, buf, count);
+	fpga_mgr_stats_phase(mgr, FPGA_MGR_PHASE_WRITE_INIT, count, start, ret);
+
+	return ret;
 }
 
 static inline int fpga_mgr_write_sg(struct fpga_manager *mgr,
 				    struct sg_table *sgt)
 {
-	if (mgr->mops->write_sg)
-		return  mgr->mops->write_sg(mgr, sgt);
-	return -EOPNOTSUPP;
+	struct scatterlist *sg;
+	size_t count = 0;
+	u64 start;
+	int ret, i;
+
+	if (!mgr->mops->write_sg)
+		return -EOPNOTSUPP;
+
+	for_each_sgtable_sg(sgt, sg, i)
+		count += sg->length;
+
+	start = ktime_get_ns();
+	ret = mgr->mops->write_sg(mgr, sgt);
+	fpga_mgr_stats_phase(mgr, FPGA_MGR_PHASE_WRITE, count, start, ret);
+
+	return ret;
 }
 
 /**
@@ -572,18 +696,247 @@ static int fpga_mgr_firmware_load(struct fpga_manager *mgr,
  */
 int fpga_mgr_load(struct fpga_manager *mgr, struct fpga_image_info *info)
 {
+	int ret;
+
 	info->header_size = mgr->mops->initial_header_size;
 
+	fpga_mgr_stats_begin(mgr, info);
+
 	if (info->sgt)
-		return fpga_mgr_buf_load_sg(mgr, info, info->sgt);
-	if (info->buf && info->count)
-		return fpga_mgr_buf_load(mgr, info, info->buf, info->count);
-	if (info->firmware_name)
-		return fpga_mgr_firmware_load(mgr, info, info->firmware_name);
-	return -EINVAL;
+		ret = fpga_mgr_buf_load_sg(mgr, info, info->sgt);
+	else if (info->buf && info->count)
+		ret = fpga_mgr_buf_load(mgr, info, info->buf, info->count);
+	else if (info->firmware_name)
+		ret = fpga_mgr_firmware_load(mgr, info, info->firmware_name);
+	else
+		ret = -EINVAL;
+
+	fpga_mgr_stats_end(mgr, ret);
+
+	return ret;
 }
 EXPORT_SYMBOL_GPL(fpga_mgr_load);
 
+/**
+ * struct fpga_mgr_stream - state of an FPGA image load fed in pieces
+ * @mgr:	fpga manager
+ * @info:	fpga image information
+ * @header:	image header collected until write_init can be called
+ * @header_len:	bytes collected in @header
+ * @written:	image data bytes passed to the low level driver
+ * @started:	write_init has been called
+ * @error:	first error hit, returned by all further calls
+ */
+struct fpga_mgr_stream {
+	struct fpga_manager *mgr;
+	struct fpga_image_info *info;
+	char *header;
+	size_t header_len;
+	size_t written;
+	bool started;
+	int error;
+};
+
+/**
+ * fpga_mgr_stream_start - start loading an FPGA image supplied in pieces
+ * @mgr:	fpga manager
+ * @info:	fpga image information, its buf, sgt and firmware_name are not
+ *		used
+ *
+ * Unlike fpga_mgr_load(), this does not need the whole image in memory. The
+ * image is passed in consecutive pieces of any size to fpga_mgr_stream_write()
+ * and the load ends with fpga_mgr_stream_finish(). Only the image header is
+ * buffered, until the low level driver's write_init can be called with it.
+ * The low level driver must implement the linear write op. The caller must
+ * hold the manager lock until fpga_mgr_stream_finish() returns.
+ *
+ * Return: stream handle, or ERR_PTR() on error.
+ */
+struct fpga_mgr_stream *fpga_mgr_stream_start(struct fpga_manager *mgr,
+					      struct fpga_image_info *info)
+{
+	struct fpga_mgr_stream *stream;
+
+	if (!mgr->mops->write)
+		return ERR_PTR(-EOPNOTSUPP);
+
+	stream = kzalloc(sizeof(*stream), GFP_KERNEL);
+	if (!stream)
+		return ERR_PTR(-ENOMEM);
+
+	stream->mgr = mgr;
+	stream->info = info;
+	info->header_size = mgr->mops->initial_header_size;
+
+	fpga_mgr_stats_begin(mgr, info);
+
+	return stream;
+}
+EXPORT_SYMBOL_GPL(fpga_mgr_stream_start);
+
+static int fpga_mgr_stream_data(struct fpga_mgr_stream *stream,
+				const char *buf, size_t count)
+{
+	struct fpga_manager *mgr = stream->mgr;
+	size_t data_size = stream->info->data_size;
+	int ret;
+
+	if (data_size)
+		count = min(count, data_size - stream->written);
+	if (!count)
+		return 0;
+
+	ret = fpga_mgr_write(mgr, buf, count);
+	if (ret) {
+		dev_err(&mgr->dev, "Error while writing image data to FPGA\n");
+		mgr->state = FPGA_MGR_STATE_WRITE_ERR;
+		return ret;
+	}
+	stream->written += count;
+
+	return 0;
+}
+
+/*
+ * Collect the image header from the start of the stream, then parse it and
+ * call write_init on it. Returns -EAGAIN while more header bytes are needed,
+ * otherwise advances *buf and *count past the consumed bytes.
+ */
+static int fpga_mgr_stream_header(struct fpga_mgr_stream *stream,
+				  const char **buf, size_t *count)
+{
+	struct fpga_manager *mgr = stream->mgr;
+	struct fpga_image_info *info = stream->info;
+	size_t len, header_size;
+	char *new_buf;
+	int ret;
+
+	mgr->state = FPGA_MGR_STATE_PARSE_HEADER;
+	do {
+		header_size = info->header_size;
+		if (stream->header_len < header_size) {
+			new_buf = krealloc(stream->header, header_size,
+					   GFP_KERNEL);
+			if (!new_buf)
+				return -ENOMEM;
+			stream->header = new_buf;
+
+			len = min(*count, header_size - stream->header_len);
+			memcpy(stream->header + stream->header_len, *buf, len);
+			stream->header_len += len;
+			*buf += len;
+			*count -= len;
+			if (stream->header_len < header_size)
+				return -EAGAIN;
+		}
+
+		ret = fpga_mgr_parse_header(mgr, info, stream->header,
+					    stream->header_len);
+		if (ret == -EAGAIN && info->header_size <= header_size) {
+			dev_err(&mgr->dev, "Requested invalid header size\n");
+			ret = -EFAULT;
+		}
+	} while (ret == -EAGAIN && *count);
+
+	if (ret == -EAGAIN)
+		return ret;
+	if (ret) {
+		dev_err(&mgr->dev, "Error while parsing FPGA image header\n");
+		mgr->state = FPGA_MGR_STATE_PARSE_HEADER_ERR;
+		return ret;
+	}
+
+	ret = fpga_mgr_write_init_buf(mgr, info, stream->header,
+				      stream->header_len);
+	if (ret)
+		return ret;
+
+	stream->started = true;
+	mgr->state = FPGA_MGR_STATE_WRITE;
+
+	/* the collected header is also the start of the image data */
+	if (mgr->mops->skip_header)
+		return 0;
+
+	return fpga_mgr_stream_data(stream, stream->header, stream->header_len);
+}
+
+/**
+ * fpga_mgr_stream_write - write the next piece of an FPGA image
+ * @stream:	stream handle from fpga_mgr_stream_start()
+ * @buf:	image data following the previous piece
+ * @count:	byte count of @buf
+ *
+ * Return: 0 on success, negative error code otherwise. After an error the
+ * load is aborted and all further calls return the same error.
+ */
+int fpga_mgr_stream_write(struct fpga_mgr_stream *stream,
+			  const char *buf, size_t count)
+{
+	int ret;
+
+	if (stream->error)
+		return stream->error;
+
+	if (!stream->started) {
+		ret = fpga_mgr_stream_header(stream, &buf, &count);
+		if (ret == -EAGAIN)
+			return 0;
+		if (ret)
+			goto err;
+	}
+
+	ret = fpga_mgr_stream_data(stream, buf, count);
+	if (ret)
+		goto err;
+
+	return 0;
+
+err:
+	stream->error = ret;
+	return ret;
+}
+EXPORT_SYMBOL_GPL(fpga_mgr_stream_write);
+
+/**
+ * fpga_mgr_stream_finish - end an FPGA image load and free the stream
+ * @stream:	stream handle from fpga_mgr_stream_start()
+ *
+ * Calls the low level driver's write_complete if the whole image was
+ * written without error. @stream is freed in any case.
+ *
+ * Return: 0 on success, negative error code otherwise.
+ */
+int fpga_mgr_stream_finish(struct fpga_mgr_stream *stream)
+{
+	struct fpga_manager *mgr = stream->mgr;
+	struct fpga_image_info *info = stream->info;
+	int ret = stream->error;
+
+	if (!ret && !stream->started) {
+		dev_err(&mgr->dev, "FPGA image is shorter than its header\n");
+		mgr->state = FPGA_MGR_STATE_PARSE_HEADER_ERR;
+		ret = -EINVAL;
+	}
+
+	if (!ret && info->data_size && stream->written < info->data_size) {
+		dev_err(&mgr->dev, "FPGA image is shorter than its data size\n");
+		mgr->state = FPGA_MGR_STATE_WRITE_ERR;
+		ret = -EINVAL;
+	}
+
+	if (!ret)
+		ret = fpga_mgr_write_complete(mgr, info);
+
+	fpga_mgr_stats_end(mgr, ret);
+
+	kfree(stream->header);
+	kfree(stream);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(fpga_mgr_stream_finish);
+
 static const char * const state_str[] = {
 	[FPGA_MGR_STATE_UNKNOWN] =		"unknown",
 	[FPGA_MGR_STATE_POWER_OFF] =		"power off",
@@ -804,6 +1157,7 @@ fpga_mgr_register_full(struct device *parent, const struct fpga_manager_info *in
 	}
 
 	mutex_init(&mgr->ref_mutex);
+	spin_lock_init(&mgr->stats.lock);
 
 	mgr->name = info->name;
 	mgr->mops = info->mops;
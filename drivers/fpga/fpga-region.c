@@ -8,16 +8,55 @@
 #include <linux/fpga/fpga-bridge.h>
 #include <linux/fpga/fpga-mgr.h>
 #include <linux/fpga/fpga-region.h>
+#include <linux/crc32.h>
+#include <linux/firmware.h>
 #include <linux/idr.h>
 #include <linux/kernel.h>
 #include <linux/list.h>
 #include <linux/module.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+
+/* upper bound of the image_cache_size attribute */
+#define FPGA_REGION_IMAGE_CACHE_MAX	16
+/* max number of regions written to the program_group attribute */
+#define FPGA_REGION_GROUP_MAX		32
+
+/**
+ * struct fpga_region_image - FPGA image kept in memory by a region
+ * @node: entry in the region image cache, most recently used first
+ * @name: firmware name of the image
+ * @buf: image data
+ * @size: size of @buf
+ * @crc: crc32 of @buf, computed when the image was read and checked on reuse
+ * @hits: number of times the image was programmed from the cache
+ */
+struct fpga_region_image {
+	struct list_head node;
+	char *name;
+	void *buf;
+	size_t size;
+	u32 crc;
+	u64 hits;
+};
 
 static DEFINE_IDA(fpga_region_ida);
 static struct class *fpga_region_class;
 
+/*
+ * After a kexec, the fabric still runs the image the previous kernel loaded.
+ * The previous kernel shows it in the image_id attribute of the region, and
+ * passing "<region of node path>:<size>:<crc32>" here, for each region, has
+ * the first programming of that region with the very same image only enable
+ * its bridges, instead of reconfiguring the FPGA.
+ */
+static char *adopt;
+module_param(adopt, charp, 0444);
+MODULE_PARM_DESC(adopt,
+		 "Images left by the previous kernel: <of path>:<size>:<crc32>,...");
+
 struct fpga_region *
 fpga_region_class_find(struct device *start, const void *data,
 		       int (*match)(struct device *, const void *))
@@ -79,24 +118,260 @@ static void fpga_region_put(struct fpga_region *region)
 	mutex_unlock(&region->mutex);
 }
 
+static void fpga_region_image_free(struct fpga_region_image *image)
+{
+	list_del(&image->node);
+	vfree(image->buf);
+	kfree(image->name);
+	kfree(image);
+}
+
+/* Drop images beyond the cache size, least recently used first. */
+static void fpga_region_image_cache_trim(struct fpga_region *region)
+{
+	struct fpga_region_image *image, *tmp;
+	unsigned int n = 0;
+
+	list_for_each_entry_safe(image, tmp, &region->image_cache, node)
+		if (++n > region->image_cache_size)
+			fpga_region_image_free(image);
+}
+
+static void fpga_region_image_cache_flush(struct fpga_region *region)
+{
+	struct fpga_region_image *image, *tmp;
+
+	list_for_each_entry_safe(image, tmp, &region->image_cache, node)
+		fpga_region_image_free(image);
+}
+
+/*
+ * The cache is only valid for the static region it was filled for, forget
+ * everything if the compat_id of the region changed since.
+ */
+static void fpga_region_image_cache_check(struct fpga_region *region)
+{
+	struct fpga_compat_id id = { 0 };
+
+	if (region->compat_id)
+		id = *region->compat_id;
+
+	if (id.id_h != region->image_cache_id.id_h ||
+	    id.id_l != region->image_cache_id.id_l) {
+		fpga_region_image_cache_flush(region);
+		region->image_cache_id = id;
+	}
+}
+
 /**
- * fpga_region_program_fpga - program FPGA
- *
- * @region: FPGA region
- *
- * Program an FPGA using fpga image info (region->info).
- * If the region has a get_bridges function, the exclusive reference for the
- * bridges will be held if programming succeeds.  This is intended to prevent
- * reprogramming the region until the caller considers it safe to do so.
- * The caller will need to call fpga_bridges_put() before attempting to
- * reprogram the region.
+ * fpga_region_image_get - find an image in the cache or read it into it
+ * @region: FPGA region, its mutex held
+ * @name: firmware name of the image
  *
- * Return 0 for success or negative error code.
+ * Return: cached image, or ERR_PTR()
  */
-int fpga_region_program_fpga(struct fpga_region *region)
+static struct fpga_region_image *
+fpga_region_image_get(struct fpga_region *region, const char *name)
 {
 	struct device *dev = &region->dev;
-	struct fpga_image_info *info = region->info;
+	struct fpga_region_image *image;
+	const struct firmware *fw;
+	int ret;
+
+	fpga_region_image_cache_check(region);
+
+	list_for_each_entry(image, &region->image_cache, node) {
+		if (strcmp(image->name, name))
+			continue;
+
+		/*
+		 * The copy may sit in memory for a long time, don't program a
+		 * corrupted one: drop it and read the firmware again.
+		 */
+		if (crc32_le(~0, image->buf, image->size) != image->crc) {
+			dev_warn(dev, "cached %s is corrupted, reloading\n",
+				 name);
+			fpga_region_image_free(image);
+			break;
+		}
+
+		list_move(&image->node, &region->image_cache);
+		return image;
+	}
+
+	image = kzalloc(sizeof(*image), GFP_KERNEL);
+	if (!image)
+		return ERR_PTR(-ENOMEM);
+
+	image->name = kstrdup(name, GFP_KERNEL);
+	if (!image->name) {
+		ret = -ENOMEM;
+		goto err_free;
+	}
+
+	ret = request_firmware(&fw, name, dev);
+	if (ret) {
+		dev_err(dev, "Error requesting firmware %s\n", name);
+		goto err_free;
+	}
+
+	image->buf = vmalloc(fw->size);
+	if (!image->buf) {
+		release_firmware(fw);
+		ret = -ENOMEM;
+		goto err_free;
+	}
+	memcpy(image->buf, fw->data, fw->size);
+	image->size = fw->size;
+	release_firmware(fw);
+
+	image->crc = crc32_le(~0, image->buf, image->size);
+	list_add(&image->node, &region->image_cache);
+	fpga_region_image_cache_trim(region);
+
+	dev_dbg(dev, "cached %s, %zu bytes, crc %08x\n", name, image->size,
+		image->crc);
+
+	return image;
+
+err_free:
+	kfree(image->name);
+	kfree(image);
+	return ERR_PTR(ret);
+}
+
+/*
+ * Load the image described by info, taking it from the region image cache
+ * when the image is a firmware file and the cache is enabled.  The size and
+ * crc32 of the image are kept when they are known without reading it again.
+ */
+static int fpga_region_load(struct fpga_region *region,
+			    struct fpga_image_info *info)
+{
+	struct fpga_region_image *image;
+	int ret;
+
+	region->image_size = 0;
+
+	if (!region->image_cache_size || !info->firmware_name ||
+	    info->sgt || info->buf) {
+		ret = fpga_mgr_load(region->mgr, info);
+		if (!ret && !info->sgt && info->buf && info->count) {
+			region->image_size = info->count;
+			region->image_crc = crc32_le(~0, info->buf,
+						     info->count);
+		}
+		return ret;
+	}
+
+	image = fpga_region_image_get(region, info->firmware_name);
+	if (IS_ERR(image))
+		return PTR_ERR(image);
+
+	image->hits++;
+	info->buf = image->buf;
+	info->count = image->size;
+	ret = fpga_mgr_load(region->mgr, info);
+	info->buf = NULL;
+	info->count = 0;
+
+	if (!ret) {
+		region->image_size = image->size;
+		region->image_crc = image->crc;
+	}
+
+	return ret;
+}
+
+/* Find the size and crc32 given for the region in the adopt parameter. */
+static bool fpga_region_adopt_lookup(struct fpga_region *region,
+				     size_t *size, u32 *crc)
+{
+	char *list, *cur, *entry, *sep;
+	bool found = false;
+	char *path;
+
+	if (!adopt || !region->dev.of_node)
+		return false;
+
+	path = kasprintf(GFP_KERNEL, "%pOF", region->dev.of_node);
+	list = kstrdup(adopt, GFP_KERNEL);
+	if (!path || !list)
+		goto out;
+
+	cur = list;
+	while ((entry = strsep(&cur, ",")) && !found) {
+		sep = strrchr(entry, ':');
+		if (!sep || kstrtou32(sep + 1, 16, crc))
+			continue;
+		*sep = '\0';
+		sep = strrchr(entry, ':');
+		if (!sep || kstrtoul(sep + 1, 0, (unsigned long *)size))
+			continue;
+		*sep = '\0';
+		found = !strcmp(entry, path);
+	}
+
+out:
+	kfree(list);
+	kfree(path);
+	return found;
+}
+
+/*
+ * Whether info is the image the previous kernel left in the region, which
+ * then only has to be adopted.  Only the first programming of the region
+ * since boot can be skipped this way.
+ */
+static bool fpga_region_adoptable(struct fpga_region *region,
+				  struct fpga_image_info *info)
+{
+	struct fpga_region_image *image;
+	const struct firmware *fw;
+	size_t size, image_size;
+	u32 crc, image_crc;
+
+	if (region->image_loaded || info->sgt ||
+	    !fpga_region_adopt_lookup(region, &size, &crc))
+		return false;
+
+	if (info->buf && info->count) {
+		image_size = info->count;
+		image_crc = crc32_le(~0, info->buf, info->count);
+	} else if (info->firmware_name && region->image_cache_size) {
+		image = fpga_region_image_get(region, info->firmware_name);
+		if (IS_ERR(image))
+			return false;
+		image_size = image->size;
+		image_crc = image->crc;
+	} else if (info->firmware_name) {
+		if (request_firmware(&fw, info->firmware_name, &region->dev))
+			return false;
+		image_size = fw->size;
+		image_crc = crc32_le(~0, fw->data, fw->size);
+		release_firmware(fw);
+	} else {
+		return false;
+	}
+
+	if (image_size != size || image_crc != crc)
+		return false;
+
+	region->image_size = image_size;
+	region->image_crc = image_crc;
+
+	return true;
+}
+
+/*
+ * Program the region with info.  If info is not region->info, region->info
+ * points to it while the region is held, for the get_bridges function.
+ */
+static int fpga_region_program_info(struct fpga_region *region,
+				    struct fpga_image_info *info)
+{
+	struct device *dev = &region->dev;
+	struct fpga_image_info *saved_info;
 	int ret;
 
 	region = fpga_region_get(region);
@@ -105,6 +380,11 @@ int fpga_region_program_fpga(struct fpga_region *region)
 		return PTR_ERR(region);
 	}
 
+	if (!info)
+		info = region->info;
+	saved_info = region->info;
+	region->info = info;
+
 	ret = fpga_mgr_lock(region->mgr);
 	if (ret) {
 		dev_err(dev, "FPGA manager is busy\n");
@@ -123,18 +403,27 @@ int fpga_region_program_fpga(struct fpga_region *region)
 		}
 	}
 
+	if (fpga_region_adoptable(region, info)) {
+		dev_info(dev, "adopting image left by the previous kernel\n");
+		goto enable_bridges;
+	}
+
 	ret = fpga_bridges_disable(&region->bridge_list);
 	if (ret) {
 		dev_err(dev, "failed to disable bridges\n");
 		goto err_put_br;
 	}
 
-	ret = fpga_mgr_load(region->mgr, info);
+	/* whatever happens now, the previous image is gone */
+	region->image_loaded = true;
+	ret = fpga_region_load(region, info);
 	if (ret) {
 		dev_err(dev, "failed to load FPGA image\n");
 		goto err_put_br;
 	}
 
+enable_bridges:
+	region->image_loaded = true;
 	ret = fpga_bridges_enable(&region->bridge_list);
 	if (ret) {
 		dev_err(dev, "failed to enable region bridges\n");
@@ -142,6 +431,7 @@ int fpga_region_program_fpga(struct fpga_region *region)
 	}
 
 	fpga_mgr_unlock(region->mgr);
+	region->info = saved_info;
 	fpga_region_put(region);
 
 	return 0;
@@ -152,12 +442,257 @@ int fpga_region_program_fpga(struct fpga_region *region)
 err_unlock_mgr:
 	fpga_mgr_unlock(region->mgr);
 err_put_region:
+	region->info = saved_info;
 	fpga_region_put(region);
 
 	return ret;
 }
+
+/**
+ * fpga_region_program_fpga - program FPGA
+ *
+ * @region: FPGA region
+ *
+ * Program an FPGA using fpga image info (region->info).
+ * If the region has a get_bridges function, the exclusive reference for the
+ * bridges will be held if programming succeeds.  This is intended to prevent
+ * reprogramming the region until the caller considers it safe to do so.
+ * The caller will need to call fpga_bridges_put() before attempting to
+ * reprogram the region.
+ *
+ * Return 0 for success or negative error code.
+ */
+int fpga_region_program_fpga(struct fpga_region *region)
+{
+	return fpga_region_program_info(region, NULL);
+}
 EXPORT_SYMBOL_GPL(fpga_region_program_fpga);
 
+/**
+ * struct fpga_region_group_work - programming of one region of a group
+ * @work: runs the programming
+ * @group: group the region belongs to
+ * @region: FPGA region
+ * @info: image info for @region
+ * @started: the worker runs, the manager statistics are about this image
+ * @ret: result of the programming
+ */
+struct fpga_region_group_work {
+	struct work_struct work;
+	struct fpga_region_group *group;
+	struct fpga_region *region;
+	struct fpga_image_info *info;
+	bool started;
+	int ret;
+};
+
+/**
+ * struct fpga_region_group - regions programmed with one image in parallel
+ * @fw: image read for the group, if a firmware name was given
+ * @size: size of the image
+ * @done: number of regions done, successfully or not
+ * @failed: number of regions that failed
+ * @pending: number of regions not done yet
+ * @complete: completed when @pending drops to zero
+ * @num: number of regions
+ * @works: one entry per region
+ */
+struct fpga_region_group {
+	const struct firmware *fw;
+	size_t size;
+	atomic_t done;
+	atomic_t failed;
+	atomic_t pending;
+	struct completion complete;
+	unsigned int num;
+	struct fpga_region_group_work works[];
+};
+
+static void fpga_region_group_work(struct work_struct *work)
+{
+	struct fpga_region_group_work *w =
+		container_of(work, struct fpga_region_group_work, work);
+	struct fpga_region_group *group = w->group;
+
+	WRITE_ONCE(w->started, true);
+	w->ret = fpga_region_program_info(w->region, w->info);
+	if (w->ret)
+		atomic_inc(&group->failed);
+	atomic_inc(&group->done);
+
+	if (atomic_dec_and_test(&group->pending))
+		complete(&group->complete);
+}
+
+/**
+ * fpga_region_group_start - start programming several regions in parallel
+ * @regions: FPGA regions, each with its own FPGA manager
+ * @num: number of regions
+ * @info: image info used as template for all regions
+ *
+ * Each region is programmed from its own worker as fpga_region_program_fpga()
+ * would do it, with a copy of @info.  If @info names a firmware file rather
+ * than a buffer or scatter gather table, the file is read once and shared by
+ * all regions.  The device tree overlay of @info is not used.  The caller
+ * must hold references to the regions until fpga_region_group_wait()
+ * returns, and must not use @info->buf or @info->sgt until then either.
+ *
+ * Return: group handle, or ERR_PTR() on error.
+ */
+struct fpga_region_group *
+fpga_region_group_start(struct fpga_region **regions, unsigned int num,
+			const struct fpga_image_info *info)
+{
+	struct fpga_region_group *group;
+	struct fpga_image_info *rinfo;
+	unsigned int i, j;
+	int ret;
+
+	if (!num)
+		return ERR_PTR(-EINVAL);
+
+	/* programming regions of one manager in parallel would only get -EBUSY */
+	for (i = 0; i < num; i++)
+		for (j = 0; j < i; j++)
+			if (regions[i]->mgr == regions[j]->mgr)
+				return ERR_PTR(-EINVAL);
+
+	group = kzalloc(struct_size(group, works, num), GFP_KERNEL);
+	if (!group)
+		return ERR_PTR(-ENOMEM);
+
+	if (!info->sgt && !info->buf && info->firmware_name) {
+		ret = request_firmware(&group->fw, info->firmware_name,
+				       &regions[0]->dev);
+		if (ret) {
+			dev_err(&regions[0]->dev,
+				"Error requesting firmware %s\n",
+				info->firmware_name);
+			kfree(group);
+			return ERR_PTR(ret);
+		}
+		group->size = group->fw->size;
+	} else if (info->sgt) {
+		group->size = info->count;
+	} else if (info->buf && info->count) {
+		group->size = info->count;
+	} else {
+		kfree(group);
+		return ERR_PTR(-EINVAL);
+	}
+
+	for (i = 0; i < num; i++) {
+		rinfo = fpga_image_info_alloc(&regions[i]->dev);
+		if (!rinfo) {
+			group->num = i;
+			fpga_region_group_free(group);
+			return ERR_PTR(-ENOMEM);
+		}
+
+		rinfo->flags = info->flags;
+		rinfo->enable_timeout_us = info->enable_timeout_us;
+		rinfo->disable_timeout_us = info->disable_timeout_us;
+		rinfo->config_complete_timeout_us =
+			info->config_complete_timeout_us;
+		rinfo->region_id = info->region_id;
+		rinfo->data_size = info->data_size;
+		if (group->fw) {
+			rinfo->buf = group->fw->data;
+			rinfo->count = group->fw->size;
+		} else {
+			rinfo->sgt = info->sgt;
+			rinfo->buf = info->buf;
+			rinfo->count = info->count;
+		}
+
+		group->works[i].info = rinfo;
+		group->works[i].region = regions[i];
+		group->works[i].group = group;
+		INIT_WORK(&group->works[i].work, fpga_region_group_work);
+	}
+
+	group->num = num;
+	atomic_set(&group->pending, num);
+	init_completion(&group->complete);
+
+	for (i = 0; i < num; i++)
+		queue_work(system_unbound_wq, &group->works[i].work);
+
+	return group;
+}
+EXPORT_SYMBOL_GPL(fpga_region_group_start);
+
+/**
+ * fpga_region_group_progress - get the aggregate progress of a group
+ * @group: group handle from fpga_region_group_start()
+ * @progress: filled in with the progress of all regions of the group
+ */
+void fpga_region_group_progress(struct fpga_region_group *group,
+				struct fpga_region_group_progress *progress)
+{
+	struct fpga_mgr_stats *stats;
+	unsigned int i;
+
+	progress->total = group->num;
+	progress->done = atomic_read(&group->done);
+	progress->failed = atomic_read(&group->failed);
+	progress->image_size = group->size;
+	progress->bytes = 0;
+
+	for (i = 0; i < group->num; i++) {
+		if (!READ_ONCE(group->works[i].started))
+			continue;
+		stats = &group->works[i].region->mgr->stats;
+		spin_lock(&stats->lock);
+		progress->bytes += stats->cur.bytes[FPGA_MGR_PHASE_WRITE];
+		spin_unlock(&stats->lock);
+	}
+}
+EXPORT_SYMBOL_GPL(fpga_region_group_progress);
+
+/**
+ * fpga_region_group_wait - wait for a group to be programmed
+ * @group: group handle from fpga_region_group_start()
+ *
+ * As with fpga_region_program_fpga(), the bridges of regions that have a
+ * get_bridges function stay held for the regions programmed successfully.
+ *
+ * Return: 0 if all regions were programmed, else the error of the first
+ * region that failed.
+ */
+int fpga_region_group_wait(struct fpga_region_group *group)
+{
+	unsigned int i;
+	int ret = 0;
+
+	wait_for_completion(&group->complete);
+
+	for (i = 0; i < group->num; i++) {
+		if (group->works[i].ret && !ret)
+			ret = group->works[i].ret;
+	}
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(fpga_region_group_wait);
+
+/**
+ * fpga_region_group_free - free a group
+ * @group: group handle from fpga_region_group_start()
+ *
+ * Must only be called after fpga_region_group_wait() returned.
+ */
+void fpga_region_group_free(struct fpga_region_group *group)
+{
+	unsigned int i;
+
+	for (i = 0; i < group->num; i++)
+		fpga_image_info_free(group->works[i].info);
+	release_firmware(group->fw);
+	kfree(group);
+}
+EXPORT_SYMBOL_GPL(fpga_region_group_free);
+
 static ssize_t compat_id_show(struct device *dev,
 			      struct device_attribute *attr, char *buf)
 {
@@ -173,12 +708,239 @@ static ssize_t compat_id_show(struct device *dev,
 
 static DEVICE_ATTR_RO(compat_id);
 
+/* Size and crc32 of the image in the region, for the adopt parameter. */
+static ssize_t image_id_show(struct device *dev,
+			     struct device_attribute *attr, char *buf)
+{
+	struct fpga_region *region = to_fpga_region(dev);
+	ssize_t len = 0;
+
+	mutex_lock(&region->mutex);
+	if (region->image_size)
+		len = sprintf(buf, "%zu:%08x\n", region->image_size,
+			      region->image_crc);
+	mutex_unlock(&region->mutex);
+
+	return len;
+}
+
+static DEVICE_ATTR_RO(image_id);
+
+static ssize_t image_cache_size_show(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	struct fpga_region *region = to_fpga_region(dev);
+
+	return sprintf(buf, "%u\n", region->image_cache_size);
+}
+
+static ssize_t image_cache_size_store(struct device *dev,
+				      struct device_attribute *attr,
+				      const char *buf, size_t count)
+{
+	struct fpga_region *region = to_fpga_region(dev);
+	unsigned int size;
+	int ret;
+
+	ret = kstrtouint(buf, 0, &size);
+	if (ret)
+		return ret;
+
+	if (size > FPGA_REGION_IMAGE_CACHE_MAX)
+		return -EINVAL;
+
+	mutex_lock(&region->mutex);
+	region->image_cache_size = size;
+	fpga_region_image_cache_trim(region);
+	mutex_unlock(&region->mutex);
+
+	return count;
+}
+
+static DEVICE_ATTR_RW(image_cache_size);
+
+static ssize_t image_cache_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct fpga_region *region = to_fpga_region(dev);
+	struct fpga_region_image *image;
+	ssize_t len = 0;
+
+	mutex_lock(&region->mutex);
+	list_for_each_entry(image, &region->image_cache, node)
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				 "%s %zu %08x %llu\n", image->name,
+				 image->size, image->crc, image->hits);
+	mutex_unlock(&region->mutex);
+
+	return len;
+}
+
+/*
+ * Writing a firmware name reads the image into the cache ahead of time, so
+ * the first switch to it does not pay for the file read either.  Writing an
+ * empty line drops all cached images.
+ */
+static ssize_t image_cache_store(struct device *dev,
+				 struct device_attribute *attr,
+				 const char *buf, size_t count)
+{
+	struct fpga_region *region = to_fpga_region(dev);
+	struct fpga_region_image *image;
+	char *name;
+	int ret = 0;
+
+	name = kstrndup(buf, count, GFP_KERNEL);
+	if (!name)
+		return -ENOMEM;
+	strim(name);
+
+	mutex_lock(&region->mutex);
+	if (!*name) {
+		fpga_region_image_cache_flush(region);
+	} else if (!region->image_cache_size) {
+		ret = -EINVAL;
+	} else {
+		image = fpga_region_image_get(region, name);
+		if (IS_ERR(image))
+			ret = PTR_ERR(image);
+	}
+	mutex_unlock(&region->mutex);
+
+	kfree(name);
+
+	return ret ? ret : count;
+}
+
+static DEVICE_ATTR_RW(image_cache);
+
 static struct attribute *fpga_region_attrs[] = {
 	&dev_attr_compat_id.attr,
+	&dev_attr_image_id.attr,
+	&dev_attr_image_cache_size.attr,
+	&dev_attr_image_cache.attr,
 	NULL,
 };
 ATTRIBUTE_GROUPS(fpga_region);
 
+/*
+ * Group programmed through the program_group class attribute.  The mutex
+ * allows one such group at a time, the spinlock protects the group pointer
+ * and the progress of the last group against program_group_progress.
+ */
+static DEFINE_MUTEX(fpga_region_sysfs_group_lock);
+static DEFINE_SPINLOCK(fpga_region_sysfs_group_spinlock);
+static struct fpga_region_group *fpga_region_sysfs_group;
+static struct fpga_region_group_progress fpga_region_sysfs_progress;
+
+/*
+ * Writing "<firmware name> <region> [<region> ...]" programs the named
+ * regions in parallel and returns when all of them are done.  Bridges are
+ * released again for regions that hold them after programming, as there is
+ * nobody to release them later.
+ */
+static ssize_t program_group_store(struct class *class,
+				   struct class_attribute *attr,
+				   const char *buf, size_t count)
+{
+	struct fpga_region *regions[FPGA_REGION_GROUP_MAX];
+	struct fpga_image_info info = { 0 };
+	struct fpga_region_group *group;
+	unsigned int num = 0, i;
+	char *args, *p, *name;
+	struct device *dev;
+	int ret = 0;
+
+	args = kstrndup(buf, count, GFP_KERNEL);
+	if (!args)
+		return -ENOMEM;
+
+	p = strim(args);
+	info.firmware_name = strsep(&p, " \t");
+	while (p && (name = strsep(&p, " \t"))) {
+		if (!*name)
+			continue;
+		if (num == FPGA_REGION_GROUP_MAX) {
+			ret = -E2BIG;
+			goto out_put;
+		}
+		dev = class_find_device_by_name(fpga_region_class, name);
+		if (!dev) {
+			ret = -ENODEV;
+			goto out_put;
+		}
+		regions[num++] = to_fpga_region(dev);
+	}
+
+	if (!num || !*info.firmware_name) {
+		ret = -EINVAL;
+		goto out_put;
+	}
+
+	if (!mutex_trylock(&fpga_region_sysfs_group_lock)) {
+		ret = -EBUSY;
+		goto out_put;
+	}
+
+	group = fpga_region_group_start(regions, num, &info);
+	if (IS_ERR(group)) {
+		mutex_unlock(&fpga_region_sysfs_group_lock);
+		ret = PTR_ERR(group);
+		goto out_put;
+	}
+	spin_lock(&fpga_region_sysfs_group_spinlock);
+	fpga_region_sysfs_group = group;
+	spin_unlock(&fpga_region_sysfs_group_spinlock);
+
+	ret = fpga_region_group_wait(group);
+
+	/* only regions programmed successfully hold their bridges */
+	for (i = 0; i < num; i++)
+		if (regions[i]->get_bridges && !group->works[i].ret)
+			fpga_bridges_put(&regions[i]->bridge_list);
+
+	spin_lock(&fpga_region_sysfs_group_spinlock);
+	fpga_region_group_progress(group, &fpga_region_sysfs_progress);
+	fpga_region_sysfs_group = NULL;
+	spin_unlock(&fpga_region_sysfs_group_spinlock);
+
+	fpga_region_group_free(group);
+
+	mutex_unlock(&fpga_region_sysfs_group_lock);
+
+out_put:
+	for (i = 0; i < num; i++)
+		put_device(&regions[i]->dev);
+	kfree(args);
+
+	return ret ? ret : count;
+}
+
+static CLASS_ATTR_WO(program_group);
+
+/* "<done> <failed> <total> <bytes written> <bytes to write>" */
+static ssize_t program_group_progress_show(struct class *class,
+					   struct class_attribute *attr,
+					   char *buf)
+{
+	struct fpga_region_group_progress progress;
+	struct fpga_region_group *group;
+
+	spin_lock(&fpga_region_sysfs_group_spinlock);
+	group = fpga_region_sysfs_group;
+	if (group)
+		fpga_region_group_progress(group, &progress);
+	else
+		progress = fpga_region_sysfs_progress;
+	spin_unlock(&fpga_region_sysfs_group_spinlock);
+
+	return sprintf(buf, "%u %u %u %llu %llu\n", progress.done,
+		       progress.failed, progress.total, progress.bytes,
+		       (u64)progress.image_size * progress.total);
+}
+
+static CLASS_ATTR_RO(program_group_progress);
+
 /**
  * fpga_region_register_full - create and register an FPGA Region device
  * @parent: device parent
@@ -215,6 +977,9 @@ fpga_region_register_full(struct device *parent, const struct fpga_region_info *
 
 	mutex_init(&region->mutex);
 	INIT_LIST_HEAD(&region->bridge_list);
+	INIT_LIST_HEAD(&region->image_cache);
+	if (region->compat_id)
+		region->image_cache_id = *region->compat_id;
 
 	region->dev.class = fpga_region_class;
 	region->dev.parent = parent;
@@ -283,6 +1048,7 @@ static void fpga_region_dev_release(struct device *dev)
 {
 	struct fpga_region *region = to_fpga_region(dev);
 
+	fpga_region_image_cache_flush(region);
 	ida_free(&fpga_region_ida, region->dev.id);
 	kfree(region);
 }
@@ -300,11 +1066,19 @@ static int __init fpga_region_init(void)
 	fpga_region_class->dev_groups = fpga_region_groups;
 	fpga_region_class->dev_release = fpga_region_dev_release;
 
+	if (class_create_file(fpga_region_class, &class_attr_program_group) ||
+	    class_create_file(fpga_region_class,
+			      &class_attr_program_group_progress))
+		pr_warn("fpga_region: Can't create sysfs program_group files\n");
+
 	return 0;
 }
 
 static void __exit fpga_region_exit(void)
 {
+	class_remove_file(fpga_region_class,
+			  &class_attr_program_group_progress);
+	class_remove_file(fpga_region_class, &class_attr_program_group);
 	class_destroy(fpga_region_class);
 	ida_destroy(&fpga_region_ida);
 }
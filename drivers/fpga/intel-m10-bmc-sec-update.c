@@ -8,10 +8,12 @@
 #include <linux/bitfield.h>
 #include <linux/device.h>
 #include <linux/firmware.h>
+#include <linux/ktime.h>
 #include <linux/mfd/intel-m10-bmc.h>
 #include <linux/mod_devicetable.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 
 struct m10bmc_sec {
@@ -21,6 +23,8 @@ struct m10bmc_sec {
 	char *fw_name;
 	u32 fw_name_id;
 	bool cancel_request;
+	ktime_t start;
+	u32 staged;
 };
 
 static DEFINE_XARRAY_ALLOC(fw_upload_xa);
@@ -421,6 +425,9 @@ static enum fw_upload_err m10bmc_sec_prepare(struct fw_upload *fwl,
 	if (!size || size > M10BMC_STAGING_SIZE)
 		return FW_UPLOAD_ERR_INVALID_SIZE;
 
+	sec->start = ktime_get();
+	sec->staged = 0;
+
 	ret = rsu_check_idle(sec);
 	if (ret != FW_UPLOAD_ERR_NONE)
 		return ret;
@@ -483,20 +490,35 @@ static enum fw_upload_err m10bmc_sec_write(struct fw_upload *fwl, const u8 *data
 			return FW_UPLOAD_ERR_RW_ERROR;
 	}
 
+	sec->staged += blk_size;
 	*written = blk_size;
 	return FW_UPLOAD_ERR_NONE;
 }
 
+static void m10bmc_sec_report(struct m10bmc_sec *sec, ktime_t staged)
+{
+	s64 stage_us = max_t(s64, ktime_us_delta(staged, sec->start), 1);
+	s64 prog_ms = ktime_ms_delta(ktime_get(), staged);
+
+	dev_info(sec->dev,
+		 "staged %u bytes in %lld ms (%llu KiB/s), programmed in %lld ms\n",
+		 sec->staged, div_s64(stage_us, USEC_PER_MSEC),
+		 div64_u64((u64)sec->staged * USEC_PER_SEC, stage_us * SZ_1K),
+		 prog_ms);
+}
+
 static enum fw_upload_err m10bmc_sec_poll_complete(struct fw_upload *fwl)
 {
 	struct m10bmc_sec *sec = fwl->dd_handle;
 	unsigned long poll_timeout;
 	u32 doorbell, result;
+	ktime_t staged;
 	int ret;
 
 	if (sec->cancel_request)
 		return rsu_cancel(sec);
 
+	staged = ktime_get();
 	result = rsu_send_data(sec);
 	if (result != FW_UPLOAD_ERR_NONE)
 		return result;
@@ -517,6 +539,8 @@ static enum fw_upload_err m10bmc_sec_poll_complete(struct fw_upload *fwl)
 		return FW_UPLOAD_ERR_HW_ERROR;
 	}
 
+	m10bmc_sec_report(sec, staged);
+
 	return FW_UPLOAD_ERR_NONE;
 }
 
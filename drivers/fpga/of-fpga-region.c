@@ -15,6 +15,17 @@
 #include <linux/of_platform.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
+#include <linux/workqueue.h>
+
+/**
+ * struct of_fpga_region_priv - private data of a DT FPGA region
+ * @region: the FPGA region
+ * @bound_work: waits for the children added by an overlay to probe
+ */
+struct of_fpga_region_priv {
+	struct fpga_region *region;
+	struct work_struct bound_work;
+};
 
 static const struct of_device_id fpga_region_of_match[] = {
 	{ .compatible = "fpga-region", },
@@ -322,6 +333,64 @@ static int of_fpga_region_notify_pre_apply(struct fpga_region *region,
 	return ret;
 }
 
+/*
+ * The children added by an overlay are created from the OF reconfig notifier
+ * while the overlay is applied.  Drivers preferring asynchronous probing are
+ * probed in the background, so userspace is told with a change uevent on the
+ * region once they are all done, and how many ended up bound.
+ */
+static void of_fpga_region_bound_work(struct work_struct *work)
+{
+	struct of_fpga_region_priv *priv =
+		container_of(work, struct of_fpga_region_priv, bound_work);
+	struct fpga_region *region = priv->region;
+	struct device_node *child;
+	struct platform_device *pdev;
+	unsigned int devices = 0, bound = 0;
+	char devices_env[32], bound_env[32];
+	char *envp[] = { "FPGA_REGION_EVENT=bound", devices_env, bound_env,
+			 NULL };
+
+	wait_for_device_probe();
+
+	for_each_available_child_of_node(region->dev.of_node, child) {
+		if (!of_node_check_flag(child, OF_POPULATED))
+			continue;
+
+		pdev = of_find_device_by_node(child);
+		if (!pdev)
+			continue;
+
+		devices++;
+		if (device_is_bound(&pdev->dev))
+			bound++;
+		put_device(&pdev->dev);
+	}
+
+	snprintf(devices_env, sizeof(devices_env), "FPGA_REGION_DEVICES=%u",
+		 devices);
+	snprintf(bound_env, sizeof(bound_env), "FPGA_REGION_BOUND=%u", bound);
+	kobject_uevent_env(&region->dev.kobj, KOBJ_CHANGE, envp);
+}
+
+/**
+ * of_fpga_region_notify_post_apply - post-apply overlay notification
+ *
+ * @region: FPGA region that the overlay was applied to
+ * @nd: overlay notification data
+ *
+ * Called after an overlay targeted to an FPGA Region has been applied and
+ * its child devices created.  Doesn't wait for them to probe.
+ */
+static void of_fpga_region_notify_post_apply(struct fpga_region *region,
+					     struct of_overlay_notify_data *nd)
+{
+	struct of_fpga_region_priv *priv = region->priv;
+
+	if (priv)
+		queue_work(system_unbound_wq, &priv->bound_work);
+}
+
 /**
  * of_fpga_region_notify_post_remove - post-remove overlay notification
  *
@@ -334,6 +403,11 @@ static int of_fpga_region_notify_pre_apply(struct fpga_region *region,
 static void of_fpga_region_notify_post_remove(struct fpga_region *region,
 					      struct of_overlay_notify_data *nd)
 {
+	struct of_fpga_region_priv *priv = region->priv;
+
+	if (priv)
+		cancel_work_sync(&priv->bound_work);
+
 	fpga_bridges_disable(&region->bridge_list);
 	fpga_bridges_put(&region->bridge_list);
 	fpga_image_info_free(region->info);
@@ -364,7 +438,7 @@ static int of_fpga_region_notify(struct notifier_block *nb,
 		break;
 	case OF_OVERLAY_POST_APPLY:
 		pr_debug("%s OF_OVERLAY_POST_APPLY\n", __func__);
-		return NOTIFY_OK;       /* not for us */
+		break;
 	case OF_OVERLAY_PRE_REMOVE:
 		pr_debug("%s OF_OVERLAY_PRE_REMOVE\n", __func__);
 		return NOTIFY_OK;       /* not for us */
@@ -385,6 +459,10 @@ static int of_fpga_region_notify(struct notifier_block *nb,
 		ret = of_fpga_region_notify_pre_apply(region, nd);
 		break;
 
+	case OF_OVERLAY_POST_APPLY:
+		of_fpga_region_notify_post_apply(region, nd);
+		break;
+
 	case OF_OVERLAY_POST_REMOVE:
 		of_fpga_region_notify_post_remove(region, nd);
 		break;
@@ -406,20 +484,33 @@ static int of_fpga_region_probe(struct platform_device *pdev)
 {
 	struct device *dev = &pdev->dev;
 	struct device_node *np = dev->of_node;
+	struct fpga_region_info info = { };
+	struct of_fpga_region_priv *priv;
 	struct fpga_region *region;
 	struct fpga_manager *mgr;
 	int ret;
 
+	priv = devm_kzalloc(dev, sizeof(*priv), GFP_KERNEL);
+	if (!priv)
+		return -ENOMEM;
+
+	INIT_WORK(&priv->bound_work, of_fpga_region_bound_work);
+
 	/* Find the FPGA mgr specified by region or parent region. */
 	mgr = of_fpga_region_get_mgr(np);
 	if (IS_ERR(mgr))
 		return -EPROBE_DEFER;
 
-	region = fpga_region_register(dev, mgr, of_fpga_region_get_bridges);
+	info.mgr = mgr;
+	info.priv = priv;
+	info.get_bridges = of_fpga_region_get_bridges;
+
+	region = fpga_region_register_full(dev, &info);
 	if (IS_ERR(region)) {
 		ret = PTR_ERR(region);
 		goto eprobe_mgr_put;
 	}
+	priv->region = region;
 
 	of_platform_populate(np, fpga_region_of_match, NULL, &region->dev);
 	platform_set_drvdata(pdev, region);
@@ -436,8 +527,10 @@ static int of_fpga_region_probe(struct platform_device *pdev)
 static int of_fpga_region_remove(struct platform_device *pdev)
 {
 	struct fpga_region *region = platform_get_drvdata(pdev);
+	struct of_fpga_region_priv *priv = region->priv;
 	struct fpga_manager *mgr = region->mgr;
 
+	cancel_work_sync(&priv->bound_work);
 	fpga_region_unregister(region);
 	fpga_mgr_put(mgr);
 
@@ -12,6 +12,7 @@
 #include <linux/module.h>
 #include <linux/of_address.h>
 #include <linux/regmap.h>
+#include <linux/scatterlist.h>
 
 #define A10_FPGAMGR_DCLKCNT_OFST				0x08
 #define A10_FPGAMGR_DCLKSTAT_OFST				0x0c
@@ -388,6 +389,54 @@ static int socfpga_a10_fpga_write(struct fpga_manager *mgr, const char *buf,
 	return 0;
 }
 
+/*
+ * write a scattered image to the FPGA data register
+ *
+ * The data register takes whole 32-bit words, so a word split between two
+ * sg entries is assembled before it is written instead of being padded like
+ * the tail of a linear buffer.  Only the very end of the image is padded.
+ */
+static int socfpga_a10_fpga_write_sg(struct fpga_manager *mgr,
+				     struct sg_table *sgt)
+{
+	struct a10_fpga_priv *priv = mgr->priv;
+	struct sg_mapping_iter miter;
+	unsigned int carry = 0;
+	u32 word = 0;
+	const u8 *p;
+	size_t len;
+
+	sg_miter_start(&miter, sgt->sgl, sgt->nents, SG_MITER_FROM_SG);
+	while (sg_miter_next(&miter)) {
+		p = miter.addr;
+		len = miter.length;
+
+		/* finish the word started by the previous entry */
+		while (carry && len) {
+			word |= (u32)*p++ << (8 * carry++);
+			len--;
+			if (carry == sizeof(u32)) {
+				writel(word, priv->fpga_data_addr);
+				word = 0;
+				carry = 0;
+			}
+		}
+
+		iowrite32_rep(priv->fpga_data_addr, p, len / sizeof(u32));
+		p += len & ~(sizeof(u32) - 1);
+		len &= sizeof(u32) - 1;
+
+		while (len--)
+			word |= (u32)*p++ << (8 * carry++);
+	}
+	sg_miter_stop(&miter);
+
+	if (carry)
+		writel(word, priv->fpga_data_addr);
+
+	return 0;
+}
+
 static int socfpga_a10_fpga_write_complete(struct fpga_manager *mgr,
 					   struct fpga_image_info *info)
 {
@@ -462,6 +511,7 @@ static const struct fpga_manager_ops socfpga_a10_fpga_mgr_ops = {
 	.state = socfpga_a10_fpga_state,
 	.write_init = socfpga_a10_fpga_write_init,
 	.write = socfpga_a10_fpga_write,
+	.write_sg = socfpga_a10_fpga_write_sg,
 	.write_complete = socfpga_a10_fpga_write_complete,
 };
 
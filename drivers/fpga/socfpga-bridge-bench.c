@@ -0,0 +1,440 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Bandwidth and latency benchmark of the SoC FPGA bridges
+ *
+ * Reads, writes or copies blocks of a window of the bus behind the
+ * HPS-to-FPGA, lightweight HPS-to-FPGA or FPGA-to-SDRAM bridge, and logs the
+ * throughput and the latency percentiles of the blocks.
+ *
+ * The window is given as a physical address and a size, and must be backed
+ * by something answering the accesses, e.g. an on-chip memory in the fabric.
+ * Windows overlapping System RAM are refused, the benchmark writes them.
+ * The bridges are not touched, they must have been enabled beforehand, which
+ * the FPGA region does when it loads the design.
+ *
+ * The cpu engine accesses the window 32 bits at a time, the memcpy and wc
+ * engines use memcpy_{from,to}io() on a device and on a write-combining
+ * mapping of the window, and the dma engine submits memcpy transactions to a
+ * dmaengine channel.  The FPGA-to-SDRAM bridge can only be exercised by the
+ * dma engine, using a channel of a DMA controller in the fabric.
+ *
+ * Usage:
+ *   cd /sys/module/socfpga_bridge_bench/parameters
+ *   echo 0xc0000000 > base; echo 65536 > size; echo 4096 > block
+ *   echo memcpy > engine; echo write > pattern
+ *   echo 1 > run
+ */
+
+#define pr_fmt(fmt)	KBUILD_MODNAME ": " fmt
+
+#include <linux/dma-mapping.h>
+#include <linux/dmaengine.h>
+#include <linux/io.h>
+#include <linux/ioport.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/sched/signal.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/string.h>
+
+#define BRIDGE_BENCH_MAX_BLOCK		SZ_1M
+#define BRIDGE_BENCH_DMA_TIMEOUT_MS	1000
+
+enum bridge_bench_engine {
+	BRIDGE_BENCH_CPU,
+	BRIDGE_BENCH_MEMCPY,
+	BRIDGE_BENCH_WC,
+	BRIDGE_BENCH_DMA,
+};
+
+static const char * const bridge_bench_engines[] = {
+	[BRIDGE_BENCH_CPU] = "cpu",
+	[BRIDGE_BENCH_MEMCPY] = "memcpy",
+	[BRIDGE_BENCH_WC] = "wc",
+	[BRIDGE_BENCH_DMA] = "dma",
+};
+
+enum bridge_bench_pattern {
+	BRIDGE_BENCH_READ,
+	BRIDGE_BENCH_WRITE,
+	BRIDGE_BENCH_COPY,
+};
+
+static const char * const bridge_bench_patterns[] = {
+	[BRIDGE_BENCH_READ] = "read",
+	[BRIDGE_BENCH_WRITE] = "write",
+	[BRIDGE_BENCH_COPY] = "copy",
+};
+
+static unsigned long base;
+module_param(base, ulong, 0644);
+MODULE_PARM_DESC(base, "Physical address of the window");
+
+static unsigned int size = SZ_64K;
+module_param(size, uint, 0644);
+MODULE_PARM_DESC(size, "Size of the window in bytes (default: 64 KiB)");
+
+static unsigned int block = SZ_4K;
+module_param(block, uint, 0644);
+MODULE_PARM_DESC(block, "Bytes moved by each timed access (default: 4 KiB)");
+
+static unsigned int iterations = 1000;
+module_param(iterations, uint, 0644);
+MODULE_PARM_DESC(iterations, "Number of blocks moved (default: 1000)");
+
+static char engine[16] = "memcpy";
+module_param_string(engine, engine, sizeof(engine), 0644);
+MODULE_PARM_DESC(engine, "Engine moving the data: cpu, memcpy, wc or dma");
+
+static char pattern[16] = "read";
+module_param_string(pattern, pattern, sizeof(pattern), 0644);
+MODULE_PARM_DESC(pattern,
+		 "read or write the window, or copy its first half to the second one");
+
+static char channel[32];
+module_param_string(channel, channel, sizeof(channel), 0644);
+MODULE_PARM_DESC(channel,
+		 "dmaengine channel of the dma engine (default: any memcpy channel)");
+
+/**
+ * struct bridge_bench - state of a benchmark run
+ * @engine:	engine moving the data
+ * @pattern:	access pattern
+ * @limit:	size of the part of the window the blocks are taken from
+ * @win:	mapping of the window, for the CPU engines
+ * @buf:	buffer in memory the blocks are read to or written from
+ * @chan:	DMA channel, for the dma engine
+ * @win_dma:	DMA address of the window
+ * @buf_dma:	DMA address of @buf
+ * @done:	completion of the DMA transaction in flight
+ * @lat:	latency of each block, in ns
+ * @sink:	keeps the cpu engine reads from being optimized out
+ */
+struct bridge_bench {
+	enum bridge_bench_engine engine;
+	enum bridge_bench_pattern pattern;
+	u32 limit;
+	void __iomem *win;
+	void *buf;
+	struct dma_chan *chan;
+	dma_addr_t win_dma;
+	dma_addr_t buf_dma;
+	struct completion done;
+	u64 *lat;
+	u32 sink;
+};
+
+static void bridge_bench_cpu(struct bridge_bench *bb, u32 off)
+{
+	void __iomem *src = bb->win + off;
+	void __iomem *dst = bb->win + off + bb->limit;
+	u32 i;
+
+	switch (bb->pattern) {
+	case BRIDGE_BENCH_READ:
+		for (i = 0; i < block; i += 4)
+			bb->sink += readl_relaxed(src + i);
+		break;
+	case BRIDGE_BENCH_WRITE:
+		for (i = 0; i < block; i += 4)
+			writel_relaxed(i, src + i);
+		/* wait for the posted writes to land */
+		bb->sink += readl(src);
+		break;
+	case BRIDGE_BENCH_COPY:
+		for (i = 0; i < block; i += 4)
+			writel_relaxed(readl_relaxed(src + i), dst + i);
+		bb->sink += readl(dst);
+		break;
+	}
+}
+
+static void bridge_bench_memcpy(struct bridge_bench *bb, u32 off)
+{
+	void __iomem *src = bb->win + off;
+	void __iomem *dst = bb->win + off + bb->limit;
+
+	switch (bb->pattern) {
+	case BRIDGE_BENCH_READ:
+		memcpy_fromio(bb->buf, src, block);
+		break;
+	case BRIDGE_BENCH_WRITE:
+		memcpy_toio(src, bb->buf, block);
+		bb->sink += readl(src);
+		break;
+	case BRIDGE_BENCH_COPY:
+		/* there is no I/O to I/O memcpy, go through memory */
+		memcpy_fromio(bb->buf, src, block);
+		memcpy_toio(dst, bb->buf, block);
+		bb->sink += readl(dst);
+		break;
+	}
+}
+
+static void bridge_bench_dma_done(void *arg)
+{
+	complete(arg);
+}
+
+static int bridge_bench_dma(struct bridge_bench *bb, u32 off)
+{
+	struct dma_async_tx_descriptor *tx;
+	dma_addr_t src, dst;
+	dma_cookie_t cookie;
+
+	switch (bb->pattern) {
+	case BRIDGE_BENCH_READ:
+		src = bb->win_dma + off;
+		dst = bb->buf_dma;
+		break;
+	case BRIDGE_BENCH_WRITE:
+		src = bb->buf_dma;
+		dst = bb->win_dma + off;
+		break;
+	default:
+		src = bb->win_dma + off;
+		dst = bb->win_dma + off + bb->limit;
+		break;
+	}
+
+	tx = dmaengine_prep_dma_memcpy(bb->chan, dst, src, block,
+				       DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
+	if (!tx)
+		return -EIO;
+
+	reinit_completion(&bb->done);
+	tx->callback = bridge_bench_dma_done;
+	tx->callback_param = &bb->done;
+
+	cookie = dmaengine_submit(tx);
+	if (dma_submit_error(cookie))
+		return -EIO;
+
+	dma_async_issue_pending(bb->chan);
+
+	if (!wait_for_completion_timeout(&bb->done,
+			msecs_to_jiffies(BRIDGE_BENCH_DMA_TIMEOUT_MS))) {
+		dmaengine_terminate_sync(bb->chan);
+		return -ETIMEDOUT;
+	}
+
+	return 0;
+}
+
+static bool bridge_bench_filter(struct dma_chan *chan, void *param)
+{
+	return !channel[0] || sysfs_streq(dma_chan_name(chan), channel);
+}
+
+static int bridge_bench_dma_init(struct bridge_bench *bb)
+{
+	struct device *dev;
+	dma_cap_mask_t mask;
+
+	dma_cap_zero(mask);
+	dma_cap_set(DMA_MEMCPY, mask);
+	bb->chan = dma_request_channel(mask, bridge_bench_filter, NULL);
+	if (!bb->chan) {
+		pr_err("no DMA memcpy channel\n");
+		return -ENODEV;
+	}
+
+	dev = bb->chan->device->dev;
+
+	bb->buf_dma = dma_map_single(dev, bb->buf, block, DMA_BIDIRECTIONAL);
+	if (dma_mapping_error(dev, bb->buf_dma))
+		goto err_chan;
+
+	bb->win_dma = dma_map_resource(dev, base, size, DMA_BIDIRECTIONAL, 0);
+	if (dma_mapping_error(dev, bb->win_dma))
+		goto err_buf;
+
+	init_completion(&bb->done);
+
+	return 0;
+
+err_buf:
+	dma_unmap_single(dev, bb->buf_dma, block, DMA_BIDIRECTIONAL);
+err_chan:
+	dma_release_channel(bb->chan);
+	return -ENOMEM;
+}
+
+static void bridge_bench_dma_exit(struct bridge_bench *bb)
+{
+	struct device *dev = bb->chan->device->dev;
+
+	dma_unmap_resource(dev, bb->win_dma, size, DMA_BIDIRECTIONAL, 0);
+	dma_unmap_single(dev, bb->buf_dma, block, DMA_BIDIRECTIONAL);
+	dma_release_channel(bb->chan);
+}
+
+static int bridge_bench_init(struct bridge_bench *bb)
+{
+	int ret = -ENOMEM;
+
+	bb->buf = kmalloc(block, GFP_KERNEL);
+	if (!bb->buf)
+		return -ENOMEM;
+	memset(bb->buf, 0x5a, block);
+
+	bb->lat = kvmalloc_array(iterations, sizeof(*bb->lat), GFP_KERNEL);
+	if (!bb->lat)
+		goto err_buf;
+
+	switch (bb->engine) {
+	case BRIDGE_BENCH_DMA:
+		ret = bridge_bench_dma_init(bb);
+		if (ret)
+			goto err_lat;
+		return 0;
+	case BRIDGE_BENCH_WC:
+		bb->win = ioremap_wc(base, size);
+		break;
+	default:
+		bb->win = ioremap(base, size);
+		break;
+	}
+
+	if (!bb->win) {
+		pr_err("cannot map %#lx-%#lx\n", base, base + size - 1);
+		goto err_lat;
+	}
+
+	return 0;
+
+err_lat:
+	kvfree(bb->lat);
+err_buf:
+	kfree(bb->buf);
+	return ret;
+}
+
+static void bridge_bench_exit(struct bridge_bench *bb)
+{
+	if (bb->engine == BRIDGE_BENCH_DMA)
+		bridge_bench_dma_exit(bb);
+	else
+		iounmap(bb->win);
+
+	kvfree(bb->lat);
+	kfree(bb->buf);
+}
+
+static int bridge_bench_run(void)
+{
+	struct bridge_bench bb = { };
+	u64 start, t, elapsed;
+	unsigned int i;
+	u32 off = 0;
+	int ret;
+
+	ret = sysfs_match_string(bridge_bench_engines, engine);
+	if (ret < 0)
+		return ret;
+	bb.engine = ret;
+
+	ret = sysfs_match_string(bridge_bench_patterns, pattern);
+	if (ret < 0)
+		return ret;
+	bb.pattern = ret;
+
+	bb.limit = bb.pattern == BRIDGE_BENCH_COPY ? size / 2 : size;
+	if (!iterations || !block || !IS_ALIGNED(block, 4) ||
+	    block > BRIDGE_BENCH_MAX_BLOCK || block > bb.limit ||
+	    !IS_ALIGNED(base | size, 4) || base + size - 1 < base)
+		return -EINVAL;
+
+	if (region_intersects(base, size, IORESOURCE_SYSTEM_RAM,
+			      IORES_DESC_NONE) != REGION_DISJOINT) {
+		pr_err("%#lx-%#lx overlaps System RAM
+", base, base + size - 1);
+		return -EINVAL;
+	}
+
+	ret = bridge_bench_init(&bb);
+	if (ret)
+		return ret;
+
+	start = ktime_get_ns();
+	for (i = 0; i < iterations; i++) {
+		t = ktime_get_ns();
+
+		switch (bb.engine) {
+		case BRIDGE_BENCH_CPU:
+			bridge_bench_cpu(&bb, off);
+			break;
+		case BRIDGE_BENCH_MEMCPY:
+		case BRIDGE_BENCH_WC:
+			bridge_bench_memcpy(&bb, off);
+			break;
+		case BRIDGE_BENCH_DMA:
+			ret = bridge_bench_dma(&bb, off);
+			break;
+		}
+
+		bb.lat[i] = ktime_get_ns() - t;
+		if (ret)
+			goto out;
+
+		off += block;
+		if (off + block > bb.limit)
+			off = 0;
+
+		if (fatal_signal_pending(current)) {
+			ret = -EINTR;
+			goto out;
+		}
+		cond_resched();
+	}
+	elapsed = max_t(u64, ktime_get_ns() - start, 1);
+
+	sort_u64(bb.lat, iterations);
+
+	pr_info("%s %s %#lx: %u x %u bytes, %llu MB/s, latency ns min %llu p50 %llu p90 %llu p99 %llu max %llu\n",
+		bridge_bench_engines[bb.engine],
+		bridge_bench_patterns[bb.pattern], base, iterations, block,
+		div64_u64((u64)iterations * block * 1000, elapsed),
+		bb.lat[0], sorted_percentile_u64(bb.lat, iterations, 500),
+		sorted_percentile_u64(bb.lat, iterations, 900),
+		sorted_percentile_u64(bb.lat, iterations, 990),
+		bb.lat[iterations - 1]);
+
+out:
+	bridge_bench_exit(&bb);
+	if (ret)
+		pr_err("%s %s %#lx failed at block %u: %d\n",
+		       bridge_bench_engines[bb.engine],
+		       bridge_bench_patterns[bb.pattern], base, i, ret);
+
+	return ret;
+}
+
+/*
+ * Runs from the write to the parameter, under the lock of the module
+ * parameters, so the other parameters can't change under the benchmark.
+ */
+static int bridge_bench_run_set(const char *val, const struct kernel_param *kp)
+{
+	bool run;
+	int ret;
+
+	ret = kstrtobool(val, &run);
+	if (ret)
+		return ret;
+
+	return run ? bridge_bench_run() : 0;
+}
+
+static const struct kernel_param_ops bridge_bench_run_ops = {
+	.set = bridge_bench_run_set,
+};
+module_param_cb(run, &bridge_bench_run_ops, NULL, 0200);
+MODULE_PARM_DESC(run, "Write 1 to run the benchmark");
+
+MODULE_DESCRIPTION("SoC FPGA bridge bandwidth and latency benchmark");
+MODULE_LICENSE("GPL");
@@ -159,6 +159,17 @@ static void socfpga_fpga_data_writel(struct socfpga_fpga_priv *priv, u32 value)
 	writel(value, priv->fpga_data_addr);
 }
 
+/*
+ * The data register is a FIFO at a fixed address, so the words can be
+ * written back to back, without the barrier writel() issues before each of
+ * them.
+ */
+static void socfpga_fpga_data_writesl(struct socfpga_fpga_priv *priv,
+				      const void *buf, size_t words)
+{
+	writesl(priv->fpga_data_addr, buf, words);
+}
+
 static inline void socfpga_fpga_set_bitsl(struct socfpga_fpga_priv *priv,
 					  u32 offset, u32 bits)
 {
@@ -206,9 +217,10 @@ static void socfpga_fpga_clear_done_status(struct socfpga_fpga_priv *priv)
  * Set the DCLKCNT, wait for DCLKSTAT to report the count completed, and clear
  * the complete status.
  */
-static int socfpga_fpga_dclk_set_and_wait_clear(struct socfpga_fpga_priv *priv,
+static int socfpga_fpga_dclk_set_and_wait_clear(struct fpga_manager *mgr,
 						u32 count)
 {
+	struct socfpga_fpga_priv *priv = mgr->priv;
 	int timeout = 2;
 	u32 done;
 
@@ -227,14 +239,15 @@ static int socfpga_fpga_dclk_set_and_wait_clear(struct socfpga_fpga_priv *priv,
 			return 0;
 		}
 		udelay(1);
+		fpga_mgr_stats_add_retries(mgr, 1);
 	} while (timeout--);
 
 	return -ETIMEDOUT;
 }
 
-static int socfpga_fpga_wait_for_state(struct socfpga_fpga_priv *priv,
-				       u32 state)
+static int socfpga_fpga_wait_for_state(struct fpga_manager *mgr, u32 state)
 {
+	struct socfpga_fpga_priv *priv = mgr->priv;
 	int timeout = 2;
 
 	/*
@@ -245,6 +258,7 @@ static int socfpga_fpga_wait_for_state(struct socfpga_fpga_priv *priv,
 		if ((socfpga_fpga_state_get(priv) & state) != 0)
 			return 0;
 		msleep(20);
+		fpga_mgr_stats_add_retries(mgr, 1);
 	} while (timeout--);
 
 	return -ETIMEDOUT;
@@ -380,7 +394,7 @@ static int socfpga_fpga_reset(struct fpga_manager *mgr)
 	socfpga_fpga_writel(priv, SOCFPGA_FPGMGR_CTL_OFST, ctrl_reg);
 
 	/* Step 4: Wait for STATUS.MODE to report FPGA is in reset phase */
-	status = socfpga_fpga_wait_for_state(priv, SOCFPGA_FPGMGR_STAT_RESET);
+	status = socfpga_fpga_wait_for_state(mgr, SOCFPGA_FPGMGR_STAT_RESET);
 
 	/* Step 5: Set CONTROL.NCONFIGPULL to 0 to release FPGA from reset */
 	ctrl_reg &= ~SOCFPGA_FPGMGR_CTL_NCFGPULL;
@@ -400,7 +414,6 @@ static int socfpga_fpga_ops_configure_init(struct fpga_manager *mgr,
 					   struct fpga_image_info *info,
 					   const char *buf, size_t count)
 {
-	struct socfpga_fpga_priv *priv = mgr->priv;
 	int ret;
 
 	if (info->flags & FPGA_MGR_PARTIAL_RECONFIG) {
@@ -413,7 +426,7 @@ static int socfpga_fpga_ops_configure_init(struct fpga_manager *mgr,
 		return ret;
 
 	/* Step 6: Wait for FPGA to enter configuration phase */
-	if (socfpga_fpga_wait_for_state(priv, SOCFPGA_FPGMGR_STAT_CFG))
+	if (socfpga_fpga_wait_for_state(mgr, SOCFPGA_FPGMGR_STAT_CFG))
 		return -ETIMEDOUT;
 
 	/* Step 7: Clear nSTATUS interrupt */
@@ -435,16 +448,15 @@ static int socfpga_fpga_ops_configure_write(struct fpga_manager *mgr,
 {
 	struct socfpga_fpga_priv *priv = mgr->priv;
 	u32 *buffer_32 = (u32 *)buf;
-	size_t i = 0;
+	size_t i;
 
 	if (count <= 0)
 		return -EINVAL;
 
 	/* Write out the complete 32-bit chunks. */
-	while (count >= sizeof(u32)) {
-		socfpga_fpga_data_writel(priv, buffer_32[i++]);
-		count -= sizeof(u32);
-	}
+	i = count / sizeof(u32);
+	socfpga_fpga_data_writesl(priv, buf, i);
+	count -= i * sizeof(u32);
 
 	/* Write out remaining non 32-bit chunks. */
 	switch (count) {
@@ -493,11 +505,11 @@ static int socfpga_fpga_ops_configure_complete(struct fpga_manager *mgr,
 	 *  - Wait for STATUS.DCNTDONE = 1
 	 *  - Clear W1C bit in STATUS.DCNTDONE
 	 */
-	if (socfpga_fpga_dclk_set_and_wait_clear(priv, 4))
+	if (socfpga_fpga_dclk_set_and_wait_clear(mgr, 4))
 		return -ETIMEDOUT;
 
 	/* Step 13: Wait for STATUS.MODE to report USER MODE */
-	if (socfpga_fpga_wait_for_state(priv, SOCFPGA_FPGMGR_STAT_USER_MODE))
+	if (socfpga_fpga_wait_for_state(mgr, SOCFPGA_FPGMGR_STAT_USER_MODE))
 		return -ETIMEDOUT;
 
 	/* Step 14: Set CTRL.EN to 0 */
@@ -5,18 +5,27 @@
  *  Copyright (C) 2018 Intel Corporation
  */
 #include <linux/completion.h>
+#include <linux/debugfs.h>
 #include <linux/fpga/fpga-mgr.h>
 #include <linux/firmware/intel/stratix10-svc-client.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_platform.h>
+#include <linux/scatterlist.h>
 #include <linux/dma-mapping.h>
+#include <linux/ktime.h>
+#include <linux/seq_file.h>
 
 /*
  * FPGA programming requires a higher level of privilege (EL3), per the SoC
  * design.
+ *
+ * The number of buffers is derived from the size of the shared memory pool
+ * reported by the secure firmware: up to half of the pool is used so the
+ * other service clients still get memory, bounded by the values below.
  */
-#define NUM_SVC_BUFS	4
+#define NUM_SVC_BUFS_MIN	4
+#define NUM_SVC_BUFS_MAX	16
 #define SVC_BUF_SIZE	SZ_512K
 
 /* Indicates buffer is in use if set */
@@ -33,21 +42,35 @@ typedef void (*s10_callback)(struct stratix10_svc_client *client,
  * struct s10_svc_buf
  * buf:  virtual address of buf provided by service layer
  * lock: locked if buffer is in use
+ * submit_time: time the buffer was handed to the service layer
+ * num_xfers: number of times the buffer was submitted
+ * copy_ns: total time spent filling the buffer from the image
+ * sdm_ns: total time between submission and the buffer being returned
  */
 struct s10_svc_buf {
 	char *buf;
 	dma_addr_t dma_addr;
 	unsigned long lock;
+	ktime_t submit_time;
+	u64 num_xfers;
+	u64 copy_ns;
+	u64 sdm_ns;
 };
 
 struct s10_priv {
 	struct stratix10_svc_chan *chan;
 	struct stratix10_svc_client client;
 	struct completion status_return_completion;
-	struct s10_svc_buf svc_bufs[NUM_SVC_BUFS];
+	struct s10_svc_buf svc_bufs[NUM_SVC_BUFS_MAX];
+	uint num_bufs;
+	/* filled from the scatterlist, not queued yet: the queue was full */
+	struct s10_svc_buf *pending;
+	size_t pending_sz;
+	u64 stall_ns;
 	unsigned long status;
 	unsigned int fw_version;
 	bool is_smmu_enabled;
+	struct dentry *debugfs_dir;
 };
 
 static int s10_svc_send_msg(struct s10_priv *priv,
@@ -84,7 +107,7 @@ static bool s10_free_buffers(struct fpga_manager *mgr)
 	uint num_free = 0;
 	uint i;
 
-	for (i = 0; i < NUM_SVC_BUFS; i++) {
+	for (i = 0; i < priv->num_bufs; i++) {
 		if (!priv->svc_bufs[i].buf) {
 			num_free++;
 			continue;
@@ -99,7 +122,7 @@ static bool s10_free_buffers(struct fpga_manager *mgr)
 		}
 	}
 
-	return num_free == NUM_SVC_BUFS;
+	return num_free == priv->num_bufs;
 }
 
 /*
@@ -111,7 +134,7 @@ static uint s10_get_unlocked_buffer_count(struct fpga_manager *mgr)
 	uint num_free = 0;
 	uint i;
 
-	for (i = 0; i < NUM_SVC_BUFS; i++)
+	for (i = 0; i < priv->num_bufs; i++)
 		if (!priv->svc_bufs[i].lock)
 			num_free++;
 
@@ -133,8 +156,10 @@ static void s10_unlock_bufs(struct s10_priv *priv, void *kaddr)
 	if (!kaddr)
 		return;
 
-	for (i = 0; i < NUM_SVC_BUFS; i++)
+	for (i = 0; i < priv->num_bufs; i++)
 		if (priv->svc_bufs[i].buf == kaddr) {
+			priv->svc_bufs[i].sdm_ns += ktime_to_ns(ktime_sub(ktime_get(),
+						priv->svc_bufs[i].submit_time));
 			if (priv->is_smmu_enabled == true)
 				dma_unmap_single(priv->client.dev, priv->svc_bufs[i].dma_addr, SVC_BUF_SIZE, DMA_TO_DEVICE);
 			clear_bit_unlock(SVC_BUF_LOCK,
@@ -255,55 +280,126 @@ static int s10_ops_write_init(struct fpga_manager *mgr,
 		goto init_done;
 	}
 
-	/* Init buffer lock */
-	for (i = 0; i < NUM_SVC_BUFS; i++) {
+	/* Init buffer lock and per-image statistics */
+	for (i = 0; i < priv->num_bufs; i++) {
 		priv->svc_bufs[i].lock = 0;
+		priv->svc_bufs[i].num_xfers = 0;
+		priv->svc_bufs[i].copy_ns = 0;
+		priv->svc_bufs[i].sdm_ns = 0;
 	}
+	priv->stall_ns = 0;
 
 init_done:
 	stratix10_svc_done(priv->chan);
 	return ret;
 }
 
+/*
+ * s10_fill_from_sg - copy the next bytes of a scattered image into a buffer
+ * miter: iterator over the image, started by the caller
+ * dst: service layer buffer
+ * size: number of bytes to copy
+ * Returns # of bytes copied, less than size only at the end of the image.
+ */
+static size_t s10_fill_from_sg(struct sg_mapping_iter *miter, char *dst,
+			       size_t size)
+{
+	size_t done = 0, len;
+
+	while (done < size && sg_miter_next(miter)) {
+		len = min(miter->length, size - done);
+		memcpy(dst + done, miter->addr, len);
+		miter->consumed = len;
+		done += len;
+	}
+
+	return done;
+}
+
+/* Give back a buffer which didn't make it to the service layer */
+static void s10_release_buf(struct s10_priv *priv, struct s10_svc_buf *sbuf)
+{
+	if (priv->is_smmu_enabled == true)
+		dma_unmap_single(priv->client.dev, sbuf->dma_addr, SVC_BUF_SIZE,
+				 DMA_TO_DEVICE);
+	sbuf->num_xfers--;
+	clear_bit_unlock(SVC_BUF_LOCK, &sbuf->lock);
+}
+
 /*
  * s10_send_buf - send a buffer to the service layer queue
  * mgr: fpga manager struct
- * buf: fpga image buffer
+ * buf: fpga image buffer, or NULL to copy from miter
+ * miter: iterator over a scattered fpga image, used if buf is NULL
  * count: size of buf in bytes
  * Returns # of bytes transferred or -ENOBUFS if the all the buffers are in use
  * or if the service queue is full. Never returns 0.
+ *
+ * The bytes copied from miter can't be put back, so a buffer filled from it
+ * which the service queue had no room for is kept, and sent by the next call
+ * before anything else is copied.
  */
-static int s10_send_buf(struct fpga_manager *mgr, const char *buf, size_t count)
+static int s10_send_buf(struct fpga_manager *mgr, const char *buf,
+			struct sg_mapping_iter *miter, size_t count)
 {
 	struct s10_priv *priv = mgr->priv;
 	struct device *dev = priv->client.dev;
+	struct s10_svc_buf *sbuf;
 	void *svc_buf;
 	size_t xfer_sz;
+	ktime_t start;
 	int ret;
 	uint i;
 
+	if (priv->pending) {
+		sbuf = priv->pending;
+		xfer_sz = priv->pending_sz;
+		priv->pending = NULL;
+		goto submit;
+	}
+
 	/* get/lock a buffer that that's not being used */
-	for (i = 0; i < NUM_SVC_BUFS; i++)
+	for (i = 0; i < priv->num_bufs; i++)
 		if (!test_and_set_bit_lock(SVC_BUF_LOCK,
 					   &priv->svc_bufs[i].lock))
 			break;
 
-	if (i == NUM_SVC_BUFS)
+	if (i == priv->num_bufs)
 		return -ENOBUFS;
 
 	xfer_sz = count < SVC_BUF_SIZE ? count : SVC_BUF_SIZE;
 
-	svc_buf = priv->svc_bufs[i].buf;
-	memcpy(svc_buf, buf, xfer_sz);
+	sbuf = &priv->svc_bufs[i];
+	svc_buf = sbuf->buf;
+	start = ktime_get();
+	if (buf)
+		memcpy(svc_buf, buf, xfer_sz);
+	else
+		xfer_sz = s10_fill_from_sg(miter, svc_buf, xfer_sz);
+	if (!xfer_sz) {
+		clear_bit_unlock(SVC_BUF_LOCK, &sbuf->lock);
+		return -EINVAL;
+	}
 	if (priv->is_smmu_enabled == true)
-		priv->svc_bufs[i].dma_addr = dma_map_single(dev, svc_buf, SVC_BUF_SIZE, DMA_TO_DEVICE);
+		sbuf->dma_addr = dma_map_single(dev, svc_buf, SVC_BUF_SIZE, DMA_TO_DEVICE);
+	sbuf->submit_time = ktime_get();
+	sbuf->copy_ns += ktime_to_ns(ktime_sub(sbuf->submit_time, start));
+	sbuf->num_xfers++;
 
+submit:
 	ret = s10_svc_send_msg(priv, COMMAND_RECONFIG_DATA_SUBMIT,
-			       svc_buf, xfer_sz, s10_receive_callback);
+			       sbuf->buf, xfer_sz, s10_receive_callback);
+	if (ret == -ENOBUFS && !buf) {
+		priv->pending = sbuf;
+		priv->pending_sz = xfer_sz;
+		return ret;
+	}
 	if (ret < 0) {
-		dev_err(dev,
-			"Error while sending data to service layer (%d)", ret);
-		clear_bit_unlock(SVC_BUF_LOCK, &priv->svc_bufs[i].lock);
+		if (ret != -ENOBUFS)
+			dev_err(dev,
+				"Error while sending data to service layer (%d)",
+				ret);
+		s10_release_buf(priv, sbuf);
 		return ret;
 	}
 
@@ -313,34 +409,56 @@ static int s10_send_buf(struct fpga_manager *mgr, const char *buf, size_t count)
 /*
  * Send an FPGA image to privileged layers to write to the FPGA.  When done
  * sending, free all service layer buffers we allocated in write_init.
+ *
+ * Buffers are refilled and queued back to back for as long as there is a
+ * free one, so copying the next chunk of the image overlaps with the service
+ * layer thread submitting the previous ones and with the SDM consuming them.
+ * The writer only sleeps when every buffer is owned by the service layer.
+ * Each callback from the service layer completes status_return_completion
+ * once, so it is used as an event counter and is not re-armed per chunk.
+ *
+ * The image is either linear in buf or, if buf is NULL, scattered and read
+ * through miter.
  */
-static int s10_ops_write(struct fpga_manager *mgr, const char *buf,
-			 size_t count)
+static int s10_write_image(struct fpga_manager *mgr, const char *buf,
+			   struct sg_mapping_iter *miter, size_t count)
 {
 	struct s10_priv *priv = mgr->priv;
 	struct device *dev = priv->client.dev;
+	unsigned int stalls = 0;
 	long wait_status;
+	ktime_t start;
 	int sent = 0;
 	int ret = 0;
 
+	reinit_completion(&priv->status_return_completion);
+
 	/*
 	 * Loop waiting for buffers to be returned.  When a buffer is returned,
 	 * reuse it to send more data or free if if all data has been sent.
 	 */
 	while (true) {
-		reinit_completion(&priv->status_return_completion);
-
 		if (count > 0) {
-			sent = s10_send_buf(mgr, buf, count);
-			if (sent < 0)
+			sent = s10_send_buf(mgr, buf, miter, count);
+			if (sent > 0) {
+				count -= sent;
+				if (buf)
+					buf += sent;
 				continue;
+			}
 
-			count -= sent;
-			buf += sent;
+			if (sent != -ENOBUFS) {
+				ret = sent;
+				break;
+			}
+			stalls++;
 		} else {
-			if (s10_get_unlocked_buffer_count(mgr) == NUM_SVC_BUFS)
-				return 0;
+			if (s10_get_unlocked_buffer_count(mgr) == priv->num_bufs) {
+				ret = 0;
+				break;
+			}
 
+			reinit_completion(&priv->status_return_completion);
 			ret = s10_svc_send_msg(
 				priv, COMMAND_RECONFIG_DATA_CLAIM,
 				NULL, 0, s10_receive_callback);
@@ -348,9 +466,11 @@ static int s10_ops_write(struct fpga_manager *mgr, const char *buf,
 				break;
 		}
 
+		start = ktime_get();
 		wait_status = wait_for_completion_timeout(
 				&priv->status_return_completion,
 				S10_BUFFER_TIMEOUT);
+		priv->stall_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
 
 		if (test_and_clear_bit(SVC_STATUS_BUFFER_DONE, &priv->status) ||
 		    test_and_clear_bit(SVC_STATUS_BUFFER_SUBMITTED,
@@ -372,6 +492,45 @@ static int s10_ops_write(struct fpga_manager *mgr, const char *buf,
 		}
 	}
 
+	/* a buffer still waiting for room in the queue is given up */
+	if (priv->pending) {
+		s10_release_buf(priv, priv->pending);
+		priv->pending = NULL;
+	}
+
+	/* each wait for the SDM to hand back a buffer counts as a retry */
+	fpga_mgr_stats_add_retries(mgr, stalls);
+
+	return ret;
+}
+
+static int s10_ops_write(struct fpga_manager *mgr, const char *buf,
+			 size_t count)
+{
+	return s10_write_image(mgr, buf, NULL, count);
+}
+
+/*
+ * Write a scattered FPGA image.  The scatterlist is copied straight into the
+ * service layer buffers, each buffer is filled completely across sg entries
+ * so the SDM gets full sized chunks, and the pipeline is only drained once
+ * at the end of the image instead of after every sg entry.
+ */
+static int s10_ops_write_sg(struct fpga_manager *mgr, struct sg_table *sgt)
+{
+	struct sg_mapping_iter miter;
+	struct scatterlist *sg;
+	size_t count = 0;
+	int ret;
+	int i;
+
+	for_each_sgtable_sg(sgt, sg, i)
+		count += sg->length;
+
+	sg_miter_start(&miter, sgt->sgl, sgt->nents, SG_MITER_FROM_SG);
+	ret = s10_write_image(mgr, NULL, &miter, count);
+	sg_miter_stop(&miter);
+
 	return ret;
 }
 
@@ -380,6 +539,7 @@ static int s10_ops_write_complete(struct fpga_manager *mgr,
 {
 	struct s10_priv *priv = mgr->priv;
 	struct device *dev = priv->client.dev;
+	unsigned int polls = 0;
 	unsigned long timeout;
 	int ret;
 
@@ -391,6 +551,9 @@ static int s10_ops_write_complete(struct fpga_manager *mgr,
 	do {
 		reinit_completion(&priv->status_return_completion);
 
+		if (polls++)
+			fpga_mgr_stats_add_retries(mgr, 1);
+
 		ret = s10_svc_send_msg(priv, COMMAND_RECONFIG_STATUS,
 				       NULL, 0, s10_receive_callback);
 		if (ret < 0)
@@ -423,9 +586,42 @@ static int s10_ops_write_complete(struct fpga_manager *mgr,
 	return ret;
 }
 
+/*
+ * Per-buffer timing of the last image written.  sdm_ns accumulating much
+ * faster than copy_ns means the transfer is bound by the SDM, the opposite
+ * means it is bound by refilling the buffers.  stall_ns is the time the
+ * writer spent waiting for a buffer to be returned.
+ */
+static int s10_buf_stats_show(struct seq_file *s, void *unused)
+{
+	struct s10_priv *priv = s->private;
+	uint i;
+
+	seq_printf(s, "buffers: %u x %u bytes\n", priv->num_bufs, SVC_BUF_SIZE);
+	seq_printf(s, "stall_ns: %llu\n", priv->stall_ns);
+	seq_puts(s, "buf\txfers\tcopy_ns\tsdm_ns\n");
+	for (i = 0; i < priv->num_bufs; i++)
+		seq_printf(s, "%u\t%llu\t%llu\t%llu\n", i,
+			   priv->svc_bufs[i].num_xfers,
+			   priv->svc_bufs[i].copy_ns,
+			   priv->svc_bufs[i].sdm_ns);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(s10_buf_stats);
+
+static void s10_debugfs_init(struct s10_priv *priv)
+{
+	priv->debugfs_dir = debugfs_create_dir(dev_name(priv->client.dev),
+					       NULL);
+	debugfs_create_file("buf_stats", 0400, priv->debugfs_dir, priv,
+			    &s10_buf_stats_fops);
+}
+
 static const struct fpga_manager_ops s10_ops = {
 	.write_init = s10_ops_write_init,
 	.write = s10_ops_write,
+	.write_sg = s10_ops_write_sg,
 	.write_complete = s10_ops_write_complete,
 };
 
@@ -492,7 +688,14 @@ static int s10_probe(struct platform_device *pdev)
 	ret = 0;
 
 	/* Allocate buffers from the service layer's pool. */
-	for (i = 0; i < NUM_SVC_BUFS; i++) {
+	priv->num_bufs = clamp_t(size_t,
+				 stratix10_svc_get_memory_size(priv->chan) /
+				 2 / SVC_BUF_SIZE,
+				 NUM_SVC_BUFS_MIN, NUM_SVC_BUFS_MAX);
+	dev_dbg(dev, "using %u buffers of %u bytes\n", priv->num_bufs,
+		SVC_BUF_SIZE);
+
+	for (i = 0; i < priv->num_bufs; i++) {
 		kbuf = stratix10_svc_allocate_memory(priv->chan, SVC_BUF_SIZE);
 		if (IS_ERR(kbuf)) {
 			s10_free_buffers(mgr);
@@ -506,6 +709,7 @@ static int s10_probe(struct platform_device *pdev)
 
 	stratix10_svc_done(priv->chan);
 	platform_set_drvdata(pdev, mgr);
+	s10_debugfs_init(priv);
 	return 0;
 
 probe_err:
@@ -519,7 +723,9 @@ static int s10_remove(struct platform_device *pdev)
 	struct s10_priv *priv = mgr->priv;
 	int i;
 
-	for (i = 0; i < NUM_SVC_BUFS; i++) {
+	debugfs_remove_recursive(priv->debugfs_dir);
+
+	for (i = 0; i < priv->num_bufs; i++) {
 		if (priv->svc_bufs[i].buf)
 			stratix10_svc_free_memory(priv->chan,
 					  priv->svc_bufs[i].buf);
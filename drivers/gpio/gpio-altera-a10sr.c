@@ -16,10 +16,12 @@
  * struct altr_a10sr_gpio - Altera Max5 GPIO device private data structure
  * @gp:   : instance of the gpio_chip
  * @regmap: the regmap from the parent device.
+ * @a10sr: the parent device.
  */
 struct altr_a10sr_gpio {
 	struct gpio_chip gp;
 	struct regmap *regmap;
+	struct altr_a10sr *a10sr;
 };
 
 static int altr_a10sr_gpio_get(struct gpio_chip *chip, unsigned int offset)
@@ -27,7 +29,7 @@ static int altr_a10sr_gpio_get(struct gpio_chip *chip, unsigned int offset)
 	struct altr_a10sr_gpio *gpio = gpiochip_get_data(chip);
 	int ret, val;
 
-	ret = regmap_read(gpio->regmap, ALTR_A10SR_PBDSW_REG, &val);
+	ret = altr_a10sr_status_read(gpio->a10sr, ALTR_A10SR_PBDSW_REG, &val);
 	if (ret < 0)
 		return ret;
 
@@ -86,6 +88,7 @@ static int altr_a10sr_gpio_probe(struct platform_device *pdev)
 		return -ENOMEM;
 
 	gpio->regmap = a10sr->regmap;
+	gpio->a10sr = a10sr;
 
 	gpio->gp = altr_a10sr_gc;
 	gpio->gp.parent = pdev->dev.parent;
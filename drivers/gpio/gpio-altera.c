@@ -4,8 +4,12 @@
  * Based on gpio-mpc8xxx.c
  */
 
+#include <linux/hte.h>
+#include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
+#include <linux/gpio/consumer.h>
 #include <linux/gpio/driver.h>
 #include <linux/of_gpio.h> /* For of_mm_gpio_chip */
 #include <linux/platform_device.h>
@@ -16,6 +20,11 @@
 #define ALTERA_GPIO_IRQ_MASK		0x8
 #define ALTERA_GPIO_EDGE_CAP		0xc
 
+static bool threaded_irq;
+module_param(threaded_irq, bool, 0444);
+MODULE_PARM_DESC(threaded_irq,
+		 "Handle pin interrupts from a polled thread (pin handlers must be threaded)");
+
 /**
 * struct altera_gpio_chip
 * @mmchip		: memory mapped chip structure.
@@ -25,6 +34,10 @@
 *			  (rising, falling, both, high)
 * @mapped_irq		: kernel mapped irq number.
 * @irq_chip		: IRQ chip configuration
+* @irq_mask		: shadow of ALTERA_GPIO_IRQ_MASK, written under
+*			  @gpio_lock, so the handlers don't have to read it back
+* @hte			: timestamp provider of the pins
+* @hte_lines		: pins whose interrupts are timestamped
 */
 struct altera_gpio_chip {
 	struct of_mm_gpio_chip mmchip;
@@ -32,6 +45,9 @@ struct altera_gpio_chip {
 	int interrupt_trigger;
 	int mapped_irq;
 	struct irq_chip irq_chip;
+	u32 irq_mask;
+	struct hte_chip hte;
+	unsigned long hte_lines;
 };
 
 static void altera_gpio_irq_unmask(struct irq_data *d)
@@ -45,10 +61,10 @@ static void altera_gpio_irq_unmask(struct irq_data *d)
 	mm_gc = &altera_gc->mmchip;
 
 	raw_spin_lock_irqsave(&altera_gc->gpio_lock, flags);
-	intmask = readl(mm_gc->regs + ALTERA_GPIO_IRQ_MASK);
 	/* Set ALTERA_GPIO_IRQ_MASK bit to unmask */
-	intmask |= BIT(irqd_to_hwirq(d));
+	intmask = altera_gc->irq_mask | BIT(irqd_to_hwirq(d));
 	writel(intmask, mm_gc->regs + ALTERA_GPIO_IRQ_MASK);
+	WRITE_ONCE(altera_gc->irq_mask, intmask);
 	raw_spin_unlock_irqrestore(&altera_gc->gpio_lock, flags);
 }
 
@@ -63,10 +79,10 @@ static void altera_gpio_irq_mask(struct irq_data *d)
 	mm_gc = &altera_gc->mmchip;
 
 	raw_spin_lock_irqsave(&altera_gc->gpio_lock, flags);
-	intmask = readl(mm_gc->regs + ALTERA_GPIO_IRQ_MASK);
 	/* Clear ALTERA_GPIO_IRQ_MASK bit to mask */
-	intmask &= ~BIT(irqd_to_hwirq(d));
+	intmask = altera_gc->irq_mask & ~BIT(irqd_to_hwirq(d));
 	writel(intmask, mm_gc->regs + ALTERA_GPIO_IRQ_MASK);
+	WRITE_ONCE(altera_gc->irq_mask, intmask);
 	raw_spin_unlock_irqrestore(&altera_gc->gpio_lock, flags);
 }
 
@@ -181,6 +197,32 @@ static int altera_gpio_direction_output(struct gpio_chip *gc,
 	return 0;
 }
 
+/*
+ * The timestamps are taken when the bank interrupt is entered, once for all
+ * the pins found pending, which is as close to the edges as the CPU gets.
+ * hte_push_ts_ns() takes a spinlock_t, which can't be done from a chained
+ * handler on PREEMPT_RT, so there is no provider there.
+ */
+static bool altera_gpio_hte_supported(void)
+{
+	return IS_ENABLED(CONFIG_HTE) && !IS_ENABLED(CONFIG_PREEMPT_RT);
+}
+
+static void altera_gpio_hte_push(struct altera_gpio_chip *altera_gc,
+				 unsigned long status, u64 ts, int level)
+{
+	struct hte_ts_data data = {
+		.tsc = ts,
+		.raw_level = level,
+	};
+	unsigned long lines;
+	int i;
+
+	lines = status & READ_ONCE(altera_gc->hte_lines);
+	for_each_set_bit(i, &lines, altera_gc->mmchip.gc.ngpio)
+		hte_push_ts_ns(&altera_gc->hte, i, &data);
+}
+
 static void altera_gpio_irq_edge_handler(struct irq_desc *desc)
 {
 	struct altera_gpio_chip *altera_gc;
@@ -188,6 +230,7 @@ static void altera_gpio_irq_edge_handler(struct irq_desc *desc)
 	struct of_mm_gpio_chip *mm_gc;
 	struct irq_domain *irqdomain;
 	unsigned long status;
+	u64 ts = 0;
 	int i;
 
 	altera_gc = gpiochip_get_data(irq_desc_get_handler_data(desc));
@@ -195,14 +238,23 @@ static void altera_gpio_irq_edge_handler(struct irq_desc *desc)
 	mm_gc = &altera_gc->mmchip;
 	irqdomain = altera_gc->mmchip.gc.irq.domain;
 
+	if (READ_ONCE(altera_gc->hte_lines))
+		ts = ktime_get_ns();
+
 	chained_irq_enter(chip, desc);
 
+	/* acknowledge all the pending pins with a single write */
 	while ((status =
 	      (readl(mm_gc->regs + ALTERA_GPIO_EDGE_CAP) &
-	      readl(mm_gc->regs + ALTERA_GPIO_IRQ_MASK)))) {
+	      READ_ONCE(altera_gc->irq_mask)))) {
 		writel(status, mm_gc->regs + ALTERA_GPIO_EDGE_CAP);
+		if (ts)
+			altera_gpio_hte_push(altera_gc, status, ts, -1);
 		for_each_set_bit(i, &status, mm_gc->gc.ngpio)
 			generic_handle_domain_irq(irqdomain, i);
+		/* the edges caught meanwhile happened after this */
+		if (ts)
+			ts = ktime_get_ns();
 	}
 
 	chained_irq_exit(chip, desc);
@@ -215,6 +267,7 @@ static void altera_gpio_irq_leveL_high_handler(struct irq_desc *desc)
 	struct of_mm_gpio_chip *mm_gc;
 	struct irq_domain *irqdomain;
 	unsigned long status;
+	u64 ts = 0;
 	int i;
 
 	altera_gc = gpiochip_get_data(irq_desc_get_handler_data(desc));
@@ -222,10 +275,16 @@ static void altera_gpio_irq_leveL_high_handler(struct irq_desc *desc)
 	mm_gc = &altera_gc->mmchip;
 	irqdomain = altera_gc->mmchip.gc.irq.domain;
 
+	if (READ_ONCE(altera_gc->hte_lines))
+		ts = ktime_get_ns();
+
 	chained_irq_enter(chip, desc);
 
 	status = readl(mm_gc->regs + ALTERA_GPIO_DATA);
-	status &= readl(mm_gc->regs + ALTERA_GPIO_IRQ_MASK);
+	status &= READ_ONCE(altera_gc->irq_mask);
+
+	if (ts)
+		altera_gpio_hte_push(altera_gc, status, ts, 1);
 
 	for_each_set_bit(i, &status, mm_gc->gc.ngpio)
 		generic_handle_domain_irq(irqdomain, i);
@@ -233,6 +292,159 @@ static void altera_gpio_irq_leveL_high_handler(struct irq_desc *desc)
 	chained_irq_exit(chip, desc);
 }
 
+/*
+ * With threaded_irq, the pins are handled from the interrupt thread of the
+ * bank, which keeps polling the bank for as long as pins are pending instead
+ * of taking an interrupt for each of them.  The bank interrupt is asserted
+ * for as long as pins are pending, as IRQF_THREAD_POLL needs.
+ */
+static irqreturn_t altera_gpio_irq_thread(int irq, void *dev_id)
+{
+	struct altera_gpio_chip *altera_gc = dev_id;
+	struct of_mm_gpio_chip *mm_gc = &altera_gc->mmchip;
+	struct irq_domain *irqdomain = mm_gc->gc.irq.domain;
+	unsigned long status;
+	int i;
+
+	if (altera_gc->interrupt_trigger == IRQ_TYPE_LEVEL_HIGH)
+		status = readl(mm_gc->regs + ALTERA_GPIO_DATA);
+	else
+		status = readl(mm_gc->regs + ALTERA_GPIO_EDGE_CAP);
+	status &= READ_ONCE(altera_gc->irq_mask);
+	if (!status)
+		return IRQ_NONE;
+
+	if (altera_gc->interrupt_trigger != IRQ_TYPE_LEVEL_HIGH)
+		writel(status, mm_gc->regs + ALTERA_GPIO_EDGE_CAP);
+
+	for_each_set_bit(i, &status, mm_gc->gc.ngpio)
+		handle_nested_irq(irq_find_mapping(irqdomain, i));
+
+	return IRQ_HANDLED;
+}
+
+static void altera_gpio_save_regs(struct of_mm_gpio_chip *mm_gc)
+{
+	struct altera_gpio_chip *altera_gc =
+		container_of(mm_gc, struct altera_gpio_chip, mmchip);
+
+	altera_gc->irq_mask = readl(mm_gc->regs + ALTERA_GPIO_IRQ_MASK);
+}
+
+static int altera_gpio_hte_xlate(struct altera_gpio_chip *altera_gc,
+				 u32 offset, u32 *xlated_id)
+{
+	if (offset >= altera_gc->mmchip.gc.ngpio)
+		return -EINVAL;
+
+	*xlated_id = offset;
+
+	return 0;
+}
+
+static int altera_gpio_hte_xlate_of(struct hte_chip *chip,
+				    const struct of_phandle_args *args,
+				    struct hte_ts_desc *desc, u32 *xlated_id)
+{
+	if (args->args_count != 1)
+		return -EINVAL;
+
+	return altera_gpio_hte_xlate(chip->data, args->args[0], xlated_id);
+}
+
+/* the gpiolib character device identifies a line by its global number */
+static int altera_gpio_hte_xlate_plat(struct hte_chip *chip,
+				      struct hte_ts_desc *desc, u32 *xlated_id)
+{
+	struct altera_gpio_chip *altera_gc = chip->data;
+
+	return altera_gpio_hte_xlate(altera_gc,
+				     desc->attr.line_id - altera_gc->mmchip.gc.base,
+				     xlated_id);
+}
+
+static bool altera_gpio_hte_match_from_linedata(const struct hte_chip *chip,
+						const struct hte_ts_desc *desc)
+{
+	struct altera_gpio_chip *altera_gc = chip->data;
+
+	return desc->attr.line_data &&
+	       gpiod_to_chip(desc->attr.line_data) == &altera_gc->mmchip.gc;
+}
+
+static int altera_gpio_hte_request(struct hte_chip *chip,
+				   struct hte_ts_desc *desc, u32 xlated_id)
+{
+	struct altera_gpio_chip *altera_gc = chip->data;
+
+	set_bit(xlated_id, &altera_gc->hte_lines);
+
+	return 0;
+}
+
+static int altera_gpio_hte_release(struct hte_chip *chip,
+				   struct hte_ts_desc *desc, u32 xlated_id)
+{
+	struct altera_gpio_chip *altera_gc = chip->data;
+
+	clear_bit(xlated_id, &altera_gc->hte_lines);
+
+	return 0;
+}
+
+static int altera_gpio_hte_enable(struct hte_chip *chip, u32 xlated_id)
+{
+	return altera_gpio_hte_request(chip, NULL, xlated_id);
+}
+
+static int altera_gpio_hte_disable(struct hte_chip *chip, u32 xlated_id)
+{
+	return altera_gpio_hte_release(chip, NULL, xlated_id);
+}
+
+static int altera_gpio_hte_clk_src_info(struct hte_chip *chip,
+					struct hte_clk_info *ci)
+{
+	ci->hz = NSEC_PER_SEC;
+	ci->type = CLOCK_MONOTONIC;
+
+	return 0;
+}
+
+static const struct hte_ops altera_gpio_hte_ops = {
+	.request = altera_gpio_hte_request,
+	.release = altera_gpio_hte_release,
+	.enable = altera_gpio_hte_enable,
+	.disable = altera_gpio_hte_disable,
+	.get_clk_src_info = altera_gpio_hte_clk_src_info,
+};
+
+/* Failing to register the provider only loses the timestamps. */
+static void altera_gpio_hte_init(struct platform_device *pdev,
+				 struct altera_gpio_chip *altera_gc)
+{
+	struct hte_chip *hte = &altera_gc->hte;
+	int ret;
+
+	if (!altera_gpio_hte_supported())
+		return;
+
+	hte->name = dev_name(&pdev->dev);
+	hte->dev = &pdev->dev;
+	hte->ops = &altera_gpio_hte_ops;
+	hte->nlines = altera_gc->mmchip.gc.ngpio;
+	hte->xlate_of = altera_gpio_hte_xlate_of;
+	hte->xlate_plat = altera_gpio_hte_xlate_plat;
+	hte->match_from_linedata = altera_gpio_hte_match_from_linedata;
+	hte->of_hte_n_cells = 1;
+	hte->data = altera_gc;
+
+	ret = devm_hte_register_chip(hte);
+	if (ret)
+		dev_warn(&pdev->dev, "failed to register HTE provider: %d\n",
+			 ret);
+}
+
 static int altera_gpio_probe(struct platform_device *pdev)
 {
 	struct device_node *node = pdev->dev.of_node;
@@ -265,6 +477,7 @@ static int altera_gpio_probe(struct platform_device *pdev)
 	altera_gc->mmchip.gc.set		= altera_gpio_set;
 	altera_gc->mmchip.gc.owner		= THIS_MODULE;
 	altera_gc->mmchip.gc.parent		= &pdev->dev;
+	altera_gc->mmchip.save_regs		= altera_gpio_save_regs;
 
 	altera_gc->mapped_irq = platform_get_irq_optional(pdev, 0);
 
@@ -287,6 +500,14 @@ static int altera_gpio_probe(struct platform_device *pdev)
 
 	girq = &altera_gc->mmchip.gc.irq;
 	girq->chip = &altera_gc->irq_chip;
+	girq->default_type = IRQ_TYPE_NONE;
+	girq->handler = handle_bad_irq;
+	if (threaded_irq) {
+		/* the bank interrupt is requested once the chip is added */
+		girq->threaded = true;
+		goto skip_irq;
+	}
+
 	if (altera_gc->interrupt_trigger == IRQ_TYPE_LEVEL_HIGH)
 		girq->parent_handler = altera_gpio_irq_leveL_high_handler;
 	else
@@ -296,8 +517,6 @@ static int altera_gpio_probe(struct platform_device *pdev)
 				     GFP_KERNEL);
 	if (!girq->parents)
 		return -ENOMEM;
-	girq->default_type = IRQ_TYPE_NONE;
-	girq->handler = handle_bad_irq;
 	girq->parents[0] = altera_gc->mapped_irq;
 
 skip_irq:
@@ -309,6 +528,25 @@ static int altera_gpio_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, altera_gc);
 
+	if (altera_gc->mapped_irq < 0)
+		return 0;
+
+	/* the pins are timestamped from the bank interrupt, not its thread */
+	if (!threaded_irq) {
+		altera_gpio_hte_init(pdev, altera_gc);
+		return 0;
+	}
+
+	ret = request_threaded_irq(altera_gc->mapped_irq, NULL,
+				   altera_gpio_irq_thread,
+				   IRQF_ONESHOT | IRQF_THREAD_POLL,
+				   dev_name(&pdev->dev), altera_gc);
+	if (ret) {
+		dev_err(&pdev->dev, "Failed requesting the bank interrupt\n");
+		of_mm_gpiochip_remove(&altera_gc->mmchip);
+		return ret;
+	}
+
 	return 0;
 }
 
@@ -316,6 +554,8 @@ static int altera_gpio_remove(struct platform_device *pdev)
 {
 	struct altera_gpio_chip *altera_gc = platform_get_drvdata(pdev);
 
+	if (threaded_irq && altera_gc->mapped_irq >= 0)
+		free_irq(altera_gc->mapped_irq, altera_gc);
 	of_mm_gpiochip_remove(&altera_gc->mmchip);
 
 	return 0;
@@ -99,6 +99,7 @@
  */
 struct altr_a10sr_hwmon {
 	struct regmap		*regmap;
+	struct altr_a10sr	*a10sr;
 };
 
 static ssize_t altr_a10sr_read_status(struct device *dev,
@@ -117,7 +118,7 @@ static ssize_t altr_a10sr_read_status(struct device *dev,
 		mask = ALTR_A10SR_ENTIRE_REG_MASK;
 	}
 
-	ret = regmap_read(hwmon->regmap, reg, &val);
+	ret = altr_a10sr_status_read(hwmon->a10sr, reg, &val);
 	if (ret < 0)
 		return ret;
 
@@ -378,6 +379,7 @@ static int altr_a10sr_hwmon_probe(struct platform_device *pdev)
 		return -ENOMEM;
 
 	hwmon->regmap = a10sr->regmap;
+	hwmon->a10sr = a10sr;
 
 	hwmon_dev = devm_hwmon_device_register_with_groups(&pdev->dev,
 							   "a10sr_hwmon", hwmon,
@@ -13,6 +13,7 @@
 #include <linux/module.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/platform_device.h>
 
 #define ALTR_I2C_TFR_CMD	0x00	/* Transfer Command register */
@@ -50,42 +51,78 @@
 				 ALTR_I2C_ISR_TXRDY)
 
 #define ALTR_I2C_THRESHOLD	0	/* IRQ Threshold at 1 element */
+#define ALTR_I2C_THRESHOLD_HALF	2	/* IRQ Threshold at 1/2 full */
+#define ALTR_I2C_THRESHOLD_MSK	3
 #define ALTR_I2C_DFLT_FIFO_SZ	4
 #define ALTR_I2C_TIMEOUT	100000	/* 100ms */
 #define ALTR_I2C_XFER_TIMEOUT	(msecs_to_jiffies(250))
 
+/**
+ * struct altr_i2c_stats - transfer statistics of the adapter
+ * @transfers: number of transfers, each made of one or more messages
+ * @messages: number of messages transferred
+ * @bytes: number of data bytes transferred
+ * @interrupts: number of interrupts serviced
+ * @errors: number of failed transfers
+ * @busy_ns: total time spent in transfers
+ * @latency_max_ns: duration of the longest transfer
+ */
+struct altr_i2c_stats {
+	u64 transfers;
+	u64 messages;
+	u64 bytes;
+	u64 interrupts;
+	u64 errors;
+	u64 busy_ns;
+	u64 latency_max_ns;
+};
+
 /**
  * struct altr_i2c_dev - I2C device context
  * @base: pointer to register struct
- * @msg: pointer to current message
- * @msg_len: number of bytes transferred in msg
- * @msg_err: error code for completed message
+ * @msgs: messages of the current transfer
+ * @num_msgs: number of messages in msgs
+ * @tx_msg: index of the message whose commands are being queued
+ * @tx_pos: next byte of tx_msg to queue
+ * @tx_addr_done: the address of tx_msg has been queued
+ * @tx_blocked: the RX FIFO can't take the result of more read commands
+ * @rx_msg: index of the message receiving the next byte read
+ * @rx_pos: next byte of rx_msg to receive
+ * @rx_pending: number of read commands queued and not received yet
+ * @msg_err: error code for completed transfer
  * @msg_complete: xfer completion object
  * @dev: device reference
  * @adapter: core i2c abstraction
  * @i2c_clk: clock reference for i2c input clock
  * @bus_clk_rate: current i2c bus clock rate
- * @buf: ptr to msg buffer for easier use.
  * @fifo_size: size of the FIFO passed in.
  * @isr_mask: cached copy of local ISR enables.
  * @isr_status: cached copy of local ISR status.
  * @isr_mutex: mutex for IRQ thread.
+ * @stats: transfer statistics, protected by isr_mutex.
  */
 struct altr_i2c_dev {
 	void __iomem *base;
-	struct i2c_msg *msg;
-	size_t msg_len;
+	struct i2c_msg *msgs;
+	int num_msgs;
+	int tx_msg;
+	u16 tx_pos;
+	bool tx_addr_done;
+	bool tx_blocked;
+	int rx_msg;
+	u16 rx_pos;
+	u32 rx_pending;
 	int msg_err;
 	struct completion msg_complete;
 	struct device *dev;
 	struct i2c_adapter adapter;
 	struct clk *i2c_clk;
 	u32 bus_clk_rate;
-	u8 *buf;
 	u32 fifo_size;
 	u32 isr_mask;
 	u32 isr_status;
 	struct mutex isr_mutex;
+	struct altr_i2c_stats stats;
 };
 
 static void
@@ -172,51 +209,121 @@ static void altr_i2c_init(struct altr_i2c_dev *idev)
 	altr_i2c_int_enable(idev, ALTR_I2C_ALL_IRQ, false);
 }
 
+static void altr_i2c_set_thresholds(struct altr_i2c_dev *idev, u32 rxt,
+				    u32 tct)
+{
+	u32 ctrl = readl(idev->base + ALTR_I2C_CTRL);
+	u32 tmp = ctrl;
+
+	tmp &= ~((ALTR_I2C_THRESHOLD_MSK << ALTR_I2C_CTRL_RXT_SHFT) |
+		 (ALTR_I2C_THRESHOLD_MSK << ALTR_I2C_CTRL_TCT_SHFT));
+	tmp |= (rxt << ALTR_I2C_CTRL_RXT_SHFT) | (tct << ALTR_I2C_CTRL_TCT_SHFT);
+	if (tmp != ctrl)
+		writel(tmp, idev->base + ALTR_I2C_CTRL);
+}
+
 /*
- * altr_i2c_transfer - On the last byte to be transmitted, send
- * a Stop bit on the last byte.
+ * altr_i2c_fill_cmd_fifo - Queue the commands of the transfer, starting
+ * each message with a (repeated) START and sending STOP after the last
+ * byte of the last message only.  No more read commands are queued than
+ * the RX FIFO can hold.
  */
-static void altr_i2c_transfer(struct altr_i2c_dev *idev, u32 data)
+static void altr_i2c_fill_cmd_fifo(struct altr_i2c_dev *idev)
 {
-	/* On the last byte to be transmitted, send STOP */
-	if (idev->msg_len == 1)
-		data |= ALTR_I2C_TFR_CMD_STO;
-	if (idev->msg_len > 0)
-		writel(data, idev->base + ALTR_I2C_TFR_CMD);
+	u32 avail = idev->fifo_size - readl(idev->base + ALTR_I2C_TC_FIFO_LVL);
+	struct i2c_msg *msg;
+	bool read, last;
+	u32 cmd;
+
+	idev->tx_blocked = false;
+
+	while (avail && idev->tx_msg < idev->num_msgs) {
+		msg = &idev->msgs[idev->tx_msg];
+		read = (msg->flags & I2C_M_RD) != 0;
+		last = idev->tx_msg == idev->num_msgs - 1;
+
+		if (!idev->tx_addr_done) {
+			cmd = ALTR_I2C_TFR_CMD_STA | i2c_8bit_addr_from_msg(msg);
+			if (last && !msg->len)
+				cmd |= ALTR_I2C_TFR_CMD_STO;
+			idev->tx_addr_done = true;
+		} else {
+			if (read && idev->rx_pending >= idev->fifo_size) {
+				idev->tx_blocked = true;
+				break;
+			}
+
+			cmd = read ? 0 : msg->buf[idev->tx_pos];
+			if (++idev->tx_pos == msg->len && last)
+				cmd |= ALTR_I2C_TFR_CMD_STO;
+			if (read)
+				idev->rx_pending++;
+		}
+
+		writel(cmd, idev->base + ALTR_I2C_TFR_CMD);
+		avail--;
+
+		if (idev->tx_pos == msg->len) {
+			idev->tx_msg++;
+			idev->tx_pos = 0;
+			idev->tx_addr_done = false;
+		}
+	}
 }
 
 /*
- * altr_i2c_empty_rx_fifo - Fetch data from RX FIFO until end of
- * transfer. Send a Stop bit on the last byte.
+ * altr_i2c_empty_rx_fifo - Fetch data from RX FIFO into the read messages,
+ * in the order their commands were queued.
  */
 static void altr_i2c_empty_rx_fifo(struct altr_i2c_dev *idev)
 {
-	size_t rx_fifo_avail = readl(idev->base + ALTR_I2C_RX_FIFO_LVL);
-	int bytes_to_transfer = min(rx_fifo_avail, idev->msg_len);
+	u32 rx_fifo_avail = readl(idev->base + ALTR_I2C_RX_FIFO_LVL);
+	struct i2c_msg *msg;
+
+	while (rx_fifo_avail-- > 0 && idev->rx_pending) {
+		msg = &idev->msgs[idev->rx_msg];
+		while (!(msg->flags & I2C_M_RD) || idev->rx_pos == msg->len) {
+			msg = &idev->msgs[++idev->rx_msg];
+			idev->rx_pos = 0;
+		}
 
-	while (bytes_to_transfer-- > 0) {
-		*idev->buf++ = readl(idev->base + ALTR_I2C_RX_DATA);
-		idev->msg_len--;
-		altr_i2c_transfer(idev, 0);
+		msg->buf[idev->rx_pos++] = readl(idev->base + ALTR_I2C_RX_DATA);
+		idev->rx_pending--;
 	}
 }
 
 /*
- * altr_i2c_fill_tx_fifo - Fill TX FIFO from current message buffer.
+ * altr_i2c_update_irqs - Only ask for an interrupt once there is enough to
+ * do: the command FIFO half empty, the RX FIFO half full, or once the
+ * transfer is about to complete.
  */
-static int altr_i2c_fill_tx_fifo(struct altr_i2c_dev *idev)
+static void altr_i2c_update_irqs(struct altr_i2c_dev *idev)
 {
-	size_t tx_fifo_avail = idev->fifo_size - readl(idev->base +
-						       ALTR_I2C_TC_FIFO_LVL);
-	int bytes_to_transfer = min(tx_fifo_avail, idev->msg_len);
-	int ret = idev->msg_len - bytes_to_transfer;
-
-	while (bytes_to_transfer-- > 0) {
-		altr_i2c_transfer(idev, *idev->buf++);
-		idev->msg_len--;
+	bool queued = idev->tx_msg == idev->num_msgs;
+	u32 rxt = ALTR_I2C_THRESHOLD, tct = ALTR_I2C_THRESHOLD_HALF;
+	u32 mask = 0;
+
+	if (idev->rx_pending) {
+		mask |= ALTR_I2C_ISER_RXRDY_EN;
+		if (idev->rx_pending >= idev->fifo_size / 2 &&
+		    idev->fifo_size >= 4)
+			rxt = ALTR_I2C_THRESHOLD_HALF;
 	}
 
-	return ret;
+	if (queued) {
+		/* the last command is on the bus once the FIFO is empty */
+		tct = ALTR_I2C_THRESHOLD;
+		if (!idev->rx_pending)
+			mask |= ALTR_I2C_ISER_TXRDY_EN;
+	} else if (!idev->tx_blocked) {
+		/* else the RX interrupt makes room for more commands */
+		mask |= ALTR_I2C_ISER_TXRDY_EN;
+	}
+
+	altr_i2c_set_thresholds(idev, rxt, tct);
+	altr_i2c_int_enable(idev, ~mask & (ALTR_I2C_ISER_RXRDY_EN |
+					   ALTR_I2C_ISER_TXRDY_EN), false);
+	altr_i2c_int_enable(idev, mask, true);
 }
 
 static irqreturn_t altr_i2c_isr_quick(int irq, void *_dev)
@@ -235,17 +342,17 @@ static irqreturn_t altr_i2c_isr_quick(int irq, void *_dev)
 static irqreturn_t altr_i2c_isr(int irq, void *_dev)
 {
 	int ret;
-	bool read, finish = false;
+	bool finish = false;
 	struct altr_i2c_dev *idev = _dev;
 	u32 status = idev->isr_status;
 
 	mutex_lock(&idev->isr_mutex);
-	if (!idev->msg) {
+	if (!idev->msgs) {
 		dev_warn(idev->dev, "unexpected interrupt\n");
 		altr_i2c_int_clear(idev, ALTR_I2C_ALL_IRQ);
 		goto out;
 	}
-	read = (idev->msg->flags & I2C_M_RD) != 0;
+	idev->stats.interrupts++;
 
 	/* handle Lost Arbitration */
 	if (unlikely(status & ALTR_I2C_ISR_ARB)) {
@@ -258,26 +365,25 @@ static irqreturn_t altr_i2c_isr(int irq, void *_dev)
 		altr_i2c_int_clear(idev, ALTR_I2C_ISR_NACK);
 		altr_i2c_stop(idev);
 		finish = true;
-	} else if (read && unlikely(status & ALTR_I2C_ISR_RXOF)) {
+	} else if (unlikely(status & ALTR_I2C_ISR_RXOF)) {
 		/* handle RX FIFO Overflow */
 		altr_i2c_empty_rx_fifo(idev);
 		altr_i2c_int_clear(idev, ALTR_I2C_ISR_RXRDY);
 		altr_i2c_stop(idev);
 		dev_err(idev->dev, "RX FIFO Overflow\n");
+		idev->msg_err = -EIO;
 		finish = true;
-	} else if (read && (status & ALTR_I2C_ISR_RXRDY)) {
-		/* RX FIFO needs service? */
+	} else if (status & (ALTR_I2C_ISR_RXRDY | ALTR_I2C_ISR_TXRDY)) {
+		/* FIFOs need service? */
+		altr_i2c_int_clear(idev, status & (ALTR_I2C_ISR_RXRDY |
+						   ALTR_I2C_ISR_TXRDY));
 		altr_i2c_empty_rx_fifo(idev);
-		altr_i2c_int_clear(idev, ALTR_I2C_ISR_RXRDY);
-		if (!idev->msg_len)
+		altr_i2c_fill_cmd_fifo(idev);
+		if (idev->tx_msg == idev->num_msgs && !idev->rx_pending &&
+		    !readl(idev->base + ALTR_I2C_TC_FIFO_LVL))
 			finish = true;
-	} else if (!read && (status & ALTR_I2C_ISR_TXRDY)) {
-		/* TX FIFO needs service? */
-		altr_i2c_int_clear(idev, ALTR_I2C_ISR_TXRDY);
-		if (idev->msg_len > 0)
-			altr_i2c_fill_tx_fifo(idev);
 		else
-			finish = true;
+			altr_i2c_update_irqs(idev);
 	} else {
 		dev_warn(idev->dev, "Unexpected interrupt: 0x%x\n", status);
 		altr_i2c_int_clear(idev, ALTR_I2C_ALL_IRQ);
@@ -302,17 +408,51 @@ static irqreturn_t altr_i2c_isr(int irq, void *_dev)
 	return IRQ_HANDLED;
 }
 
-static int altr_i2c_xfer_msg(struct altr_i2c_dev *idev, struct i2c_msg *msg)
+/* Called with isr_mutex held, once the transfer is over. */
+static void altr_i2c_account(struct altr_i2c_dev *idev, ktime_t start)
 {
+	struct altr_i2c_stats *stats = &idev->stats;
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	int i;
+
+	stats->transfers++;
+	stats->busy_ns += ns;
+	stats->latency_max_ns = max(stats->latency_max_ns, ns);
+
+	if (idev->msg_err) {
+		stats->errors++;
+		return;
+	}
+
+	stats->messages += idev->num_msgs;
+	for (i = 0; i < idev->num_msgs; i++)
+		stats->bytes += idev->msgs[i].len;
+}
+
+/*
+ * All the messages of a transfer are queued back to back with repeated
+ * STARTs, so a run of short messages costs a few interrupts rather than
+ * one transfer each.
+ */
+static int
+altr_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
+{
+	struct altr_i2c_dev *idev = i2c_get_adapdata(adap);
 	u32 imask = ALTR_I2C_ISR_RXOF | ALTR_I2C_ISR_ARB | ALTR_I2C_ISR_NACK;
 	unsigned long time_left;
+	ktime_t start = ktime_get();
 	u32 value;
-	u8 addr = i2c_8bit_addr_from_msg(msg);
+	int ret;
 
 	mutex_lock(&idev->isr_mutex);
-	idev->msg = msg;
-	idev->msg_len = msg->len;
-	idev->buf = msg->buf;
+	idev->msgs = msgs;
+	idev->num_msgs = num;
+	idev->tx_msg = 0;
+	idev->tx_pos = 0;
+	idev->tx_addr_done = false;
+	idev->rx_msg = 0;
+	idev->rx_pos = 0;
+	idev->rx_pending = 0;
 	idev->msg_err = 0;
 	reinit_completion(&idev->msg_complete);
 	altr_i2c_core_enable(idev);
@@ -322,24 +462,15 @@ static int altr_i2c_xfer_msg(struct altr_i2c_dev *idev, struct i2c_msg *msg)
 		readl(idev->base + ALTR_I2C_RX_DATA);
 	} while (readl(idev->base + ALTR_I2C_RX_FIFO_LVL));
 
-	writel(ALTR_I2C_TFR_CMD_STA | addr, idev->base + ALTR_I2C_TFR_CMD);
-
-	if ((msg->flags & I2C_M_RD) != 0) {
-		imask |= ALTR_I2C_ISER_RXOF_EN | ALTR_I2C_ISER_RXRDY_EN;
-		altr_i2c_int_enable(idev, imask, true);
-		/* write the first byte to start the RX */
-		altr_i2c_transfer(idev, 0);
-	} else {
-		imask |= ALTR_I2C_ISR_TXRDY;
-		altr_i2c_int_enable(idev, imask, true);
-		altr_i2c_fill_tx_fifo(idev);
-	}
+	altr_i2c_fill_cmd_fifo(idev);
+	altr_i2c_update_irqs(idev);
+	altr_i2c_int_enable(idev, imask, true);
 	mutex_unlock(&idev->isr_mutex);
 
 	time_left = wait_for_completion_timeout(&idev->msg_complete,
-						ALTR_I2C_XFER_TIMEOUT);
+						num * ALTR_I2C_XFER_TIMEOUT);
 	mutex_lock(&idev->isr_mutex);
-	altr_i2c_int_enable(idev, imask, false);
+	altr_i2c_int_enable(idev, ALTR_I2C_ALL_IRQ, false);
 
 	value = readl(idev->base + ALTR_I2C_STATUS) & ALTR_I2C_STAT_CORE;
 	if (value)
@@ -351,23 +482,13 @@ static int altr_i2c_xfer_msg(struct altr_i2c_dev *idev, struct i2c_msg *msg)
 	}
 
 	altr_i2c_core_disable(idev);
-	mutex_unlock(&idev->isr_mutex);
-
-	return idev->msg_err;
-}
+	altr_i2c_account(idev, start);
 
-static int
-altr_i2c_xfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
-{
-	struct altr_i2c_dev *idev = i2c_get_adapdata(adap);
-	int i, ret;
+	ret = idev->msg_err ?: num;
+	idev->msgs = NULL;
+	mutex_unlock(&idev->isr_mutex);
 
-	for (i = 0; i < num; i++) {
-		ret = altr_i2c_xfer_msg(idev, msgs++);
-		if (ret)
-			return ret;
-	}
-	return num;
+	return ret;
 }
 
 static u32 altr_i2c_func(struct i2c_adapter *adap)
@@ -380,6 +501,50 @@ static const struct i2c_algorithm altr_i2c_algo = {
 	.functionality = altr_i2c_func,
 };
 
+#define ALTR_I2C_STAT_ATTR(field)					\
+static ssize_t field##_show(struct device *dev,				\
+			    struct device_attribute *attr, char *buf)	\
+{									\
+	struct altr_i2c_dev *idev = dev_get_drvdata(dev);		\
+	u64 val;							\
+									\
+	mutex_lock(&idev->isr_mutex);					\
+	val = idev->stats.field;					\
+	mutex_unlock(&idev->isr_mutex);					\
+									\
+	return sysfs_emit(buf, "%llu\n", val);				\
+}									\
+static DEVICE_ATTR_RO(field)
+
+ALTR_I2C_STAT_ATTR(transfers);
+ALTR_I2C_STAT_ATTR(messages);
+ALTR_I2C_STAT_ATTR(bytes);
+ALTR_I2C_STAT_ATTR(interrupts);
+ALTR_I2C_STAT_ATTR(errors);
+ALTR_I2C_STAT_ATTR(busy_ns);
+ALTR_I2C_STAT_ATTR(latency_max_ns);
+
+static struct attribute *altr_i2c_stats_attrs[] = {
+	&dev_attr_transfers.attr,
+	&dev_attr_messages.attr,
+	&dev_attr_bytes.attr,
+	&dev_attr_interrupts.attr,
+	&dev_attr_errors.attr,
+	&dev_attr_busy_ns.attr,
+	&dev_attr_latency_max_ns.attr,
+	NULL
+};
+
+static const struct attribute_group altr_i2c_stats_group = {
+	.name	= "stats",
+	.attrs	= altr_i2c_stats_attrs,
+};
+
+static const struct attribute_group *altr_i2c_groups[] = {
+	&altr_i2c_stats_group,
+	NULL
+};
+
 static int altr_i2c_probe(struct platform_device *pdev)
 {
 	struct altr_i2c_dev *idev = NULL;
@@ -488,6 +653,7 @@ static struct platform_driver altr_i2c_driver = {
 	.driver = {
 		.name = "altera-i2c",
 		.of_match_table = altr_i2c_of_match,
+		.dev_groups = altr_i2c_groups,
 	},
 };
 
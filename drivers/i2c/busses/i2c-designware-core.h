@@ -237,6 +237,13 @@ struct reset_control;
  * @set_sda_hold_time: callback to retrieve IP specific SDA hold timing
  * @mode: operation mode - DW_IC_MASTER or DW_IC_SLAVE
  * @rinfo: I²C GPIO recovery information
+ * @polling: the current transfer is polled, with the interrupts masked
+ * @poll_intr_mask: interrupt mask of the polled transfer
+ * @xfers: number of polled and interrupt-driven transfers
+ * @xfer_ns: total and longest duration of the polled and interrupt-driven
+ *	transfers
+ * @poll_fallbacks: polled transfers finished by the interrupt
+ * @debugfs: debugfs directory of the transfer statistics
  *
  * HCNT and LCNT parameters can be used if the platform knows more accurate
  * values than the one computed based only on the input clock frequency.
@@ -295,6 +302,13 @@ struct dw_i2c_dev {
 	int			(*set_sda_hold_time)(struct dw_i2c_dev *dev);
 	int			mode;
 	struct i2c_bus_recovery_info rinfo;
+	bool			polling;
+	u32			poll_intr_mask;
+	u64			xfers[2];
+	u64			xfer_ns[2];
+	u64			xfer_max_ns[2];
+	u64			poll_fallbacks;
+	struct dentry		*debugfs;
 };
 
 #define ACCESS_INTR_MASK	BIT(0)
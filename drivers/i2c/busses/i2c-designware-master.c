@@ -8,6 +8,7 @@
  * Copyright (C) 2007 MontaVista Software Inc.
  * Copyright (C) 2009 Provigent Ltd.
  */
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/err.h>
 #include <linux/errno.h>
@@ -16,10 +17,12 @@
 #include <linux/i2c.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/pm_runtime.h>
 #include <linux/regmap.h>
 #include <linux/reset.h>
+#include <linux/seq_file.h>
 
 #include "i2c-designware-core.h"
 
@@ -27,6 +30,23 @@
 #define AMD_TIMEOUT_MAX_US	250
 #define AMD_MASTERCFG_MASK	GENMASK(15, 0)
 
+/*
+ * Transfers of up to poll_max_len bytes are busy-polled, as waking up the
+ * caller from the interrupt takes longer than the few bytes on the bus.
+ */
+static unsigned int poll_max_len = 8;
+module_param(poll_max_len, uint, 0644);
+MODULE_PARM_DESC(poll_max_len,
+		 "Poll the transfers of up to this many bytes (0 = never poll)");
+
+static void i2c_dw_write_intr_mask(struct dw_i2c_dev *dev, u32 mask)
+{
+	if (dev->polling)
+		dev->poll_intr_mask = mask;
+	else
+		regmap_write(dev->map, DW_IC_INTR_MASK, mask);
+}
+
 static void i2c_dw_configure_fifo_master(struct dw_i2c_dev *dev)
 {
 	/* Configure Tx/Rx FIFO threshold levels */
@@ -249,7 +269,7 @@ static void i2c_dw_xfer_init(struct dw_i2c_dev *dev)
 
 	/* Clear and enable interrupts */
 	regmap_read(dev->map, DW_IC_CLR_INTR, &dummy);
-	regmap_write(dev->map, DW_IC_INTR_MASK, DW_IC_INTR_MASTER_MASK);
+	i2c_dw_write_intr_mask(dev, DW_IC_INTR_MASTER_MASK);
 }
 
 static int i2c_dw_check_stopbit(struct dw_i2c_dev *dev)
@@ -483,7 +503,7 @@ i2c_dw_xfer_msg(struct dw_i2c_dev *dev)
 	if (dev->msg_err)
 		intr_mask = 0;
 
-	regmap_write(dev->map,  DW_IC_INTR_MASK, intr_mask);
+	i2c_dw_write_intr_mask(dev, intr_mask);
 }
 
 static u8
@@ -505,8 +525,11 @@ i2c_dw_recv_len(struct dw_i2c_dev *dev, u8 len)
 	 * Received buffer length, re-enable TX_EMPTY interrupt
 	 * to resume the SMBUS transaction.
 	 */
-	regmap_update_bits(dev->map, DW_IC_INTR_MASK, DW_IC_INTR_TX_EMPTY,
-			   DW_IC_INTR_TX_EMPTY);
+	if (dev->polling)
+		dev->poll_intr_mask |= DW_IC_INTR_TX_EMPTY;
+	else
+		regmap_update_bits(dev->map, DW_IC_INTR_MASK,
+				   DW_IC_INTR_TX_EMPTY, DW_IC_INTR_TX_EMPTY);
 
 	return len;
 }
@@ -569,6 +592,43 @@ i2c_dw_read(struct dw_i2c_dev *dev)
 	}
 }
 
+static int i2c_dw_irq_handler_master(struct dw_i2c_dev *dev);
+
+/*
+ * Busy-poll a transfer of len bytes for twice the time it takes on the bus,
+ * then leave it to the interrupt.  Returns true if the transfer is over.
+ */
+static bool i2c_dw_poll_xfer(struct dw_i2c_dev *dev, unsigned int len)
+{
+	u32 freq = dev->timings.bus_freq_hz ?: I2C_MAX_STANDARD_MODE_FREQ;
+	u64 bus_ns = div_u64((u64)(len + dev->msgs_num) * 9 * NSEC_PER_SEC,
+			     freq);
+	ktime_t end = ktime_add_ns(ktime_get(), 2 * bus_ns + 10 * NSEC_PER_USEC);
+
+	do {
+		i2c_dw_irq_handler_master(dev);
+		if (completion_done(&dev->cmd_complete))
+			return true;
+		cpu_relax();
+	} while (ktime_before(ktime_get(), end));
+
+	dev->poll_fallbacks++;
+	WRITE_ONCE(dev->polling, false);
+	regmap_write(dev->map, DW_IC_INTR_MASK, dev->poll_intr_mask);
+
+	return false;
+}
+
+static void i2c_dw_xfer_account(struct dw_i2c_dev *dev, bool polled,
+				ktime_t start)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	dev->xfers[polled]++;
+	dev->xfer_ns[polled] += ns;
+	dev->xfer_max_ns[polled] = max(dev->xfer_max_ns[polled], ns);
+}
+
 /*
  * Prepare controller for a transaction and call i2c_dw_xfer_msg.
  */
@@ -576,7 +636,10 @@ static int
 i2c_dw_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num)
 {
 	struct dw_i2c_dev *dev = i2c_get_adapdata(adap);
-	int ret;
+	unsigned int len = 0;
+	bool polled;
+	ktime_t start;
+	int ret, i;
 
 	dev_dbg(dev->dev, "%s: msgs: %d\n", __func__, num);
 
@@ -611,11 +674,22 @@ i2c_dw_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num)
 	if (ret < 0)
 		goto done;
 
+	for (i = 0; i < num; i++)
+		len += msgs[i].len;
+	polled = len <= READ_ONCE(poll_max_len);
+
 	/* Start the transfers */
+	dev->polling = polled;
+	start = ktime_get();
 	i2c_dw_xfer_init(dev);
 
 	/* Wait for tx to complete */
-	if (!wait_for_completion_timeout(&dev->cmd_complete, adap->timeout)) {
+	if (polled && i2c_dw_poll_xfer(dev, len)) {
+		i2c_dw_xfer_account(dev, true, start);
+	} else if (wait_for_completion_timeout(&dev->cmd_complete,
+					       adap->timeout)) {
+		i2c_dw_xfer_account(dev, false, start);
+	} else {
 		dev_err(dev->dev, "controller timed out\n");
 		/* i2c_dw_init implicitly disables the adapter */
 		i2c_recover_bus(&dev->adapter);
@@ -623,6 +697,7 @@ i2c_dw_xfer(struct i2c_adapter *adap, struct i2c_msg msgs[], int num)
 		ret = -ETIMEDOUT;
 		goto done;
 	}
+	dev->polling = false;
 
 	/*
 	 * We must disable the adapter before returning and signaling the end
@@ -692,7 +767,12 @@ static u32 i2c_dw_read_clear_intrbits(struct dw_i2c_dev *dev)
 	 *
 	 * The raw version might be useful for debugging purposes.
 	 */
-	regmap_read(dev->map, DW_IC_INTR_STAT, &stat);
+	if (dev->polling) {
+		regmap_read(dev->map, DW_IC_RAW_INTR_STAT, &stat);
+		stat &= dev->poll_intr_mask;
+	} else {
+		regmap_read(dev->map, DW_IC_INTR_STAT, &stat);
+	}
 
 	/*
 	 * Do not use the IC_CLR_INTR register to clear interrupts, or
@@ -750,7 +830,7 @@ static int i2c_dw_irq_handler_master(struct dw_i2c_dev *dev)
 		 * interrupt really came from this HW (E.g. firmware has left
 		 * the HW active).
 		 */
-		regmap_write(dev->map, DW_IC_INTR_MASK, 0);
+		i2c_dw_write_intr_mask(dev, 0);
 		return 0;
 	}
 
@@ -763,7 +843,7 @@ static int i2c_dw_irq_handler_master(struct dw_i2c_dev *dev)
 		 * Anytime TX_ABRT is set, the contents of the tx/rx
 		 * buffers are flushed. Make sure to skip them.
 		 */
-		regmap_write(dev->map, DW_IC_INTR_MASK, 0);
+		i2c_dw_write_intr_mask(dev, 0);
 		goto tx_aborted;
 	}
 
@@ -783,7 +863,7 @@ static int i2c_dw_irq_handler_master(struct dw_i2c_dev *dev)
 	if (((stat & (DW_IC_INTR_TX_ABRT | DW_IC_INTR_STOP_DET)) || dev->msg_err) &&
 	     (dev->rx_outstanding == 0))
 		complete(&dev->cmd_complete);
-	else if (unlikely(dev->flags & ACCESS_INTR_MASK)) {
+	else if (unlikely(dev->flags & ACCESS_INTR_MASK) && !dev->polling) {
 		/* Workaround to trigger pending interrupt */
 		regmap_read(dev->map, DW_IC_INTR_MASK, &stat);
 		i2c_dw_disable_int(dev);
@@ -798,6 +878,10 @@ static irqreturn_t i2c_dw_isr(int this_irq, void *dev_id)
 	struct dw_i2c_dev *dev = dev_id;
 	u32 stat, enabled;
 
+	/* A polled transfer keeps the interrupts masked */
+	if (READ_ONCE(dev->polling))
+		return IRQ_NONE;
+
 	regmap_read(dev->map, DW_IC_ENABLE, &enabled);
 	regmap_read(dev->map, DW_IC_RAW_INTR_STAT, &stat);
 	dev_dbg(dev->dev, "enabled=%#x stat=%#x\n", enabled, stat);
@@ -930,6 +1014,45 @@ static int amd_i2c_adap_quirk(struct dw_i2c_dev *dev)
 	return ret;
 }
 
+static int i2c_dw_stats_show(struct seq_file *s, void *data)
+{
+	static const char * const mode[] = { "irq", "polled" };
+	struct dw_i2c_dev *dev = s->private;
+	u64 xfers, avg;
+	int i;
+
+	seq_puts(s, "mode\txfers\tavg_ns\tmax_ns\n");
+	for (i = 0; i < ARRAY_SIZE(mode); i++) {
+		xfers = READ_ONCE(dev->xfers[i]);
+		avg = xfers ? div64_u64(READ_ONCE(dev->xfer_ns[i]), xfers) : 0;
+		seq_printf(s, "%s\t%llu\t%llu\t%llu\n", mode[i], xfers, avg,
+			   READ_ONCE(dev->xfer_max_ns[i]));
+	}
+	seq_printf(s, "poll_fallbacks\t%llu\n", READ_ONCE(dev->poll_fallbacks));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(i2c_dw_stats);
+
+static void i2c_dw_debugfs_remove(void *data)
+{
+	struct dw_i2c_dev *dev = data;
+
+	debugfs_remove_recursive(dev->debugfs);
+}
+
+static void i2c_dw_debugfs_init(struct dw_i2c_dev *dev)
+{
+	char name[32];
+
+	snprintf(name, sizeof(name), "i2c_dw%d", dev->adapter.nr);
+	dev->debugfs = debugfs_create_dir(name, NULL);
+	debugfs_create_file("stats", 0444, dev->debugfs, dev,
+			    &i2c_dw_stats_fops);
+
+	devm_add_action_or_reset(dev->dev, i2c_dw_debugfs_remove, dev);
+}
+
 int i2c_dw_probe_master(struct dw_i2c_dev *dev)
 {
 	struct i2c_adapter *adap = &dev->adapter;
@@ -1005,8 +1128,12 @@ int i2c_dw_probe_master(struct dw_i2c_dev *dev)
 	if (ret)
 		dev_err(dev->dev, "failure adding adapter: %d\n", ret);
 	pm_runtime_put_noidle(dev->dev);
+	if (ret)
+		return ret;
 
-	return ret;
+	i2c_dw_debugfs_init(dev);
+
+	return 0;
 }
 EXPORT_SYMBOL_GPL(i2c_dw_probe_master);
 
@@ -10,6 +10,7 @@
 #include <linux/bitmap.h>
 #include <linux/cpu.h>
 #include <linux/crash_dump.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/efi.h>
 #include <linux/interrupt.h>
@@ -27,6 +28,7 @@
 #include <linux/of_pci.h>
 #include <linux/of_platform.h>
 #include <linux/percpu.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/syscore_ops.h>
 
@@ -95,6 +97,19 @@ struct its_device;
  * spinlock must be taken to parse data structures such as the device
  * list.
  */
+/* Command opcodes space, GICv4 ones included */
+#define ITS_CMD_NR		0x40
+
+struct its_cmd_stats {
+	u64			cmds[ITS_CMD_NR];
+	u64			batched;
+	u64			batch_syncs;
+	u64			queue_full;
+	atomic64_t		waits;
+	atomic64_t		wait_ns;
+	atomic64_t		timeouts;
+};
+
 struct its_node {
 	raw_spinlock_t		lock;
 	struct mutex		dev_alloc_lock;
@@ -119,6 +134,10 @@ struct its_node {
 	unsigned int		msi_domain_flags;
 	u32			pre_its_base; /* for Socionext Synquacer */
 	int			vlpi_redist_offset;
+	cpumask_t		sync_pending;	/* collections owed a SYNC */
+	unsigned int		nr_batched;
+	struct work_struct	sync_work;
+	struct its_cmd_stats	stats;
 };
 
 #define is_v4(its)		(!!((its)->typer & GITS_TYPER_VLPIS))
@@ -184,6 +203,19 @@ struct cpu_lpi_count {
 
 static DEFINE_PER_CPU(struct cpu_lpi_count, cpu_lpi_count);
 
+/*
+ * Number of LPI INV and MOVI commands posted without waiting for their
+ * SYNC before the ITS is synced and waited for.  0 or 1 syncs and waits
+ * for every command.
+ */
+static unsigned int its_cmd_batch = 16;
+
+static int __init its_cmd_batch_cfg(char *buf)
+{
+	return kstrtouint(buf, 0, &its_cmd_batch);
+}
+early_param("irqchip.gicv3_its_cmd_batch", its_cmd_batch_cfg);
+
 static LIST_HEAD(its_nodes);
 static DEFINE_RAW_SPINLOCK(its_lock);
 static struct rdists *gic_rdists;
@@ -1016,6 +1048,9 @@ static struct its_cmd_block *its_allocate_entry(struct its_node *its)
 	struct its_cmd_block *cmd;
 	u32 count = 1000000;	/* 1s! */
 
+	if (its_queue_full(its))
+		its->stats.queue_full++;
+
 	while (its_queue_full(its)) {
 		count--;
 		if (!count) {
@@ -1060,6 +1095,9 @@ static void its_flush_cmd(struct its_node *its, struct its_cmd_block *cmd)
 		gic_flush_dcache_to_poc(cmd, sizeof(*cmd));
 	else
 		dsb(ishst);
+
+	its->stats.cmds[le64_to_cpu((__force __le64)cmd->raw_cmd[0]) &
+			(ITS_CMD_NR - 1)]++;
 }
 
 static int its_wait_for_range_completion(struct its_node *its,
@@ -1107,6 +1145,23 @@ static int its_wait_for_range_completion(struct its_node *its,
 	return 0;
 }
 
+static int its_wait_for_cmds(struct its_node *its, u64 prev_idx,
+			     struct its_cmd_block *to)
+{
+	ktime_t start = ktime_get();
+	int ret;
+
+	ret = its_wait_for_range_completion(its, prev_idx, to);
+
+	atomic64_inc(&its->stats.waits);
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start)),
+		     &its->stats.wait_ns);
+	if (ret)
+		atomic64_inc(&its->stats.timeouts);
+
+	return ret;
+}
+
 /* Warning, macro hell follows */
 #define BUILD_SINGLE_CMD_FUNC(name, buildtype, synctype, buildfn)	\
 void name(struct its_node *its,						\
@@ -1120,6 +1175,9 @@ void name(struct its_node *its,						\
 									\
 	raw_spin_lock_irqsave(&its->lock, flags);			\
 									\
+	/* Wait for the batched commands along with this one */	\
+	its_queue_pending_syncs(its);					\
+									\
 	cmd = its_allocate_entry(its);					\
 	if (!cmd) {		/* We're soooooo screewed... */		\
 		raw_spin_unlock_irqrestore(&its->lock, flags);		\
@@ -1142,7 +1200,7 @@ post:									\
 	next_cmd = its_post_commands(its);				\
 	raw_spin_unlock_irqrestore(&its->lock, flags);			\
 									\
-	if (its_wait_for_range_completion(its, rd_idx, next_cmd))	\
+	if (its_wait_for_cmds(its, rd_idx, next_cmd))			\
 		pr_err_ratelimited("ITS cmd %ps failed\n", builder);	\
 }
 
@@ -1156,9 +1214,100 @@ static void its_build_sync_cmd(struct its_node *its,
 	its_fixup_cmd(sync_cmd);
 }
 
+/*
+ * Queue one SYNC per collection targeted by the batched commands, called
+ * with its->lock held.  They are waited for once the queue is posted.
+ */
+static void its_queue_pending_syncs(struct its_node *its)
+{
+	struct its_cmd_block *sync_cmd;
+	int cpu;
+
+	if (!its->nr_batched)
+		return;
+
+	for_each_cpu(cpu, &its->sync_pending) {
+		sync_cmd = its_allocate_entry(its);
+		if (!sync_cmd)
+			break;
+
+		its_build_sync_cmd(its, sync_cmd, &its->collections[cpu]);
+		its_flush_cmd(its, sync_cmd);
+		its->stats.batch_syncs++;
+	}
+
+	cpumask_clear(&its->sync_pending);
+	its->nr_batched = 0;
+}
+
 static BUILD_SINGLE_CMD_FUNC(its_send_single_command, its_cmd_builder_t,
 			     struct its_collection, its_build_sync_cmd)
 
+/*
+ * Post a command without waiting for it.  Its SYNC is left to the next
+ * command sent with its_send_single_command(), which the batch limit
+ * forces, or to sync_work otherwise.  The ITS executes the commands in
+ * order, the SYNC only tells us the redistributors have caught up.
+ */
+static void its_send_batched_command(struct its_node *its,
+				     its_cmd_builder_t builder,
+				     struct its_cmd_desc *desc)
+{
+	struct its_collection *sync_col;
+	struct its_cmd_block *cmd;
+	unsigned long flags;
+
+	raw_spin_lock_irqsave(&its->lock, flags);
+
+	if (its->nr_batched + 1 >= its_cmd_batch) {
+		raw_spin_unlock_irqrestore(&its->lock, flags);
+		its_send_single_command(its, builder, desc);
+		return;
+	}
+
+	cmd = its_allocate_entry(its);
+	if (!cmd) {
+		raw_spin_unlock_irqrestore(&its->lock, flags);
+		return;
+	}
+
+	sync_col = builder(its, cmd, desc);
+	its_flush_cmd(its, cmd);
+	if (sync_col)
+		cpumask_set_cpu(sync_col - its->collections,
+				&its->sync_pending);
+	its->nr_batched++;
+	its->stats.batched++;
+
+	its_post_commands(its);
+	raw_spin_unlock_irqrestore(&its->lock, flags);
+
+	schedule_work(&its->sync_work);
+}
+
+static void its_sync_work(struct work_struct *work)
+{
+	struct its_node *its = container_of(work, struct its_node, sync_work);
+	struct its_cmd_block *next_cmd;
+	unsigned long flags;
+	u64 rd_idx;
+
+	raw_spin_lock_irqsave(&its->lock, flags);
+
+	if (!its->nr_batched) {
+		raw_spin_unlock_irqrestore(&its->lock, flags);
+		return;
+	}
+
+	its_queue_pending_syncs(its);
+	rd_idx = readl_relaxed(its->base + GITS_CREADR);
+	next_cmd = its_post_commands(its);
+	raw_spin_unlock_irqrestore(&its->lock, flags);
+
+	if (its_wait_for_cmds(its, rd_idx, next_cmd))
+		pr_err_ratelimited("ITS batched cmds failed\n");
+}
+
 static void its_build_vsync_cmd(struct its_node *its,
 				struct its_cmd_block *sync_cmd,
 				struct its_vpe *sync_vpe)
@@ -1199,7 +1348,7 @@ static void its_send_inv(struct its_device *dev, u32 event_id)
 	desc.its_inv_cmd.dev = dev;
 	desc.its_inv_cmd.event_id = event_id;
 
-	its_send_single_command(dev->its, its_build_inv_cmd, &desc);
+	its_send_batched_command(dev->its, its_build_inv_cmd, &desc);
 }
 
 static void its_send_mapd(struct its_device *dev, int valid)
@@ -1235,7 +1384,7 @@ static void its_send_mapti(struct its_device *dev, u32 irq_id, u32 id)
 }
 
 static void its_send_movi(struct its_device *dev,
-			  struct its_collection *col, u32 id)
+			  struct its_collection *col, u32 id, bool batch)
 {
 	struct its_cmd_desc desc;
 
@@ -1243,7 +1392,10 @@ static void its_send_movi(struct its_device *dev,
 	desc.its_movi_cmd.col = col;
 	desc.its_movi_cmd.event_id = id;
 
-	its_send_single_command(dev->its, its_build_movi_cmd, &desc);
+	if (batch)
+		its_send_batched_command(dev->its, its_build_movi_cmd, &desc);
+	else
+		its_send_single_command(dev->its, its_build_movi_cmd, &desc);
 }
 
 static void its_send_discard(struct its_device *dev, u32 id)
@@ -1692,8 +1844,12 @@ static int its_set_affinity(struct irq_data *d, const struct cpumask *mask_val,
 
 	/* don't set the affinity when the target cpu is same as current one */
 	if (cpu != prev_cpu) {
+		/*
+		 * Moving away from a dying CPU must be complete before it
+		 * goes, anything else can be synced later.
+		 */
 		target_col = &its_dev->its->collections[cpu];
-		its_send_movi(its_dev, target_col, id);
+		its_send_movi(its_dev, target_col, id, cpu_online(prev_cpu));
 		its_dev->event_map.col_map[id] = cpu;
 		irq_data_update_effective_affinity(d, cpumask_of(cpu));
 	}
@@ -3794,7 +3950,7 @@ static void its_vpe_db_proxy_move(struct its_vpe *vpe, int from, int to)
 	its_vpe_db_proxy_map_locked(vpe);
 
 	target_col = &vpe_proxy.dev->its->collections[to];
-	its_send_movi(vpe_proxy.dev, target_col, vpe->vpe_proxy_event);
+	its_send_movi(vpe_proxy.dev, target_col, vpe->vpe_proxy_event, false);
 	vpe_proxy.dev->event_map.col_map[vpe->vpe_proxy_event] = to;
 
 	raw_spin_unlock_irqrestore(&vpe_proxy.lock, flags);
@@ -5043,6 +5199,7 @@ static int __init its_probe_one(struct resource *res,
 
 	raw_spin_lock_init(&its->lock);
 	mutex_init(&its->dev_alloc_lock);
+	INIT_WORK(&its->sync_work, its_sync_work);
 	INIT_LIST_HEAD(&its->entry);
 	INIT_LIST_HEAD(&its->its_device_list);
 	typer = gic_read_typer(its_base + GITS_TYPER);
@@ -5562,6 +5719,75 @@ int __init its_lpi_memreserve_init(void)
 	return 0;
 }
 
+static const char * const its_cmd_names[ITS_CMD_NR] = {
+	[GITS_CMD_MOVI]		= "movi",
+	[GITS_CMD_INT]		= "int",
+	[GITS_CMD_CLEAR]	= "clear",
+	[GITS_CMD_SYNC]		= "sync",
+	[GITS_CMD_MAPD]		= "mapd",
+	[GITS_CMD_MAPC]		= "mapc",
+	[GITS_CMD_MAPTI]	= "mapti",
+	[GITS_CMD_MAPI]		= "mapi",
+	[GITS_CMD_INV]		= "inv",
+	[GITS_CMD_INVALL]	= "invall",
+	[GITS_CMD_MOVALL]	= "movall",
+	[GITS_CMD_DISCARD]	= "discard",
+	[GITS_CMD_VMOVP]	= "vmovp",
+	[GITS_CMD_VSGI]		= "vsgi",
+	[GITS_CMD_VMOVI]	= "vmovi",
+	[GITS_CMD_VSYNC]	= "vsync",
+	[GITS_CMD_VMAPP]	= "vmapp",
+	[GITS_CMD_VMAPTI]	= "vmapti",
+	[GITS_CMD_VINVALL]	= "vinvall",
+	[GITS_CMD_INVDB]	= "invdb",
+};
+
+static int its_stats_show(struct seq_file *m, void *v)
+{
+	struct its_node *its;
+	int i;
+
+	list_for_each_entry(its, &its_nodes, entry) {
+		struct its_cmd_stats *stats = &its->stats;
+
+		seq_printf(m, "ITS@%pa\n", &its->phys_base);
+		for (i = 0; i < ITS_CMD_NR; i++) {
+			if (!stats->cmds[i])
+				continue;
+			if (its_cmd_names[i])
+				seq_printf(m, "  %-12s %llu\n", its_cmd_names[i],
+					   stats->cmds[i]);
+			else
+				seq_printf(m, "  0x%02x         %llu\n", i,
+					   stats->cmds[i]);
+		}
+		seq_printf(m, "  %-12s %llu\n", "batched", stats->batched);
+		seq_printf(m, "  %-12s %llu\n", "batch_syncs",
+			   stats->batch_syncs);
+		seq_printf(m, "  %-12s %lld\n", "waits",
+			   atomic64_read(&stats->waits));
+		seq_printf(m, "  %-12s %lld\n", "wait_us",
+			   div_s64(atomic64_read(&stats->wait_ns),
+				   NSEC_PER_USEC));
+		seq_printf(m, "  %-12s %lld\n", "timeouts",
+			   atomic64_read(&stats->timeouts));
+		seq_printf(m, "  %-12s %llu\n", "queue_full", stats->queue_full);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(its_stats);
+
+static int __init its_debugfs_init(void)
+{
+	if (!list_empty(&its_nodes))
+		debugfs_create_file("gic_its_stats", 0400, NULL, NULL,
+				    &its_stats_fops);
+
+	return 0;
+}
+late_initcall(its_debugfs_init);
+
 int __init its_init(struct fwnode_handle *handle, struct rdists *rdists,
 		    struct irq_domain *parent_domain)
 {
@@ -33,9 +33,12 @@
 #include <linux/acpi.h>
 #include <linux/irqdomain.h>
 #include <linux/interrupt.h>
+#include <linux/kernel_stat.h>
 #include <linux/percpu.h>
 #include <linux/seq_file.h>
 #include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/workqueue.h>
 #include <linux/irqchip.h>
 #include <linux/irqchip/chained_irq.h>
 #include <linux/irqchip/arm-gic.h>
@@ -875,6 +878,173 @@ static __init void gic_smp_init(void)
 
 	set_smp_ipi_range(base_sgi, 8);
 }
+
+/*
+ * Optional load-aware spreading of the SPIs over the online CPUs, for the
+ * systems without a user space balancer.  Every balance_interval_ms, the
+ * interrupts are sorted by the number of times they fired since the last
+ * pass and each is given to the least loaded CPU, staying where it is
+ * unless moving it evens the load out by more than half its own rate.  The
+ * per-CPU, managed and IRQF_NOBALANCING interrupts are left alone, the
+ * affinity of the others set from user space doesn't stick while balancing.
+ */
+static unsigned int balance_interval_ms;
+static bool gic_balance_ready;
+
+static void gic_balance_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(gic_balance_work, gic_balance_work_fn);
+
+/* Start, reschedule or stop the passes as the interval is changed */
+static int gic_balance_set_interval(const char *val,
+				    const struct kernel_param *kp)
+{
+	int ret = param_set_uint(val, kp);
+
+	if (ret || !READ_ONCE(gic_balance_ready))
+		return ret;
+
+	if (balance_interval_ms)
+		mod_delayed_work(system_power_efficient_wq, &gic_balance_work,
+				 msecs_to_jiffies(balance_interval_ms));
+	else
+		cancel_delayed_work_sync(&gic_balance_work);
+
+	return 0;
+}
+
+static const struct kernel_param_ops gic_balance_interval_ops = {
+	.set	= gic_balance_set_interval,
+	.get	= param_get_uint,
+};
+
+module_param_cb(balance_interval_ms, &gic_balance_interval_ops,
+		&balance_interval_ms, 0644);
+MODULE_PARM_DESC(balance_interval_ms,
+		 "Interval between two SPI rebalancing passes (0 = off)");
+
+struct gic_balance_irq {
+	unsigned int irq;
+	unsigned int rate;
+};
+
+static unsigned int *gic_balance_count;
+static struct gic_balance_irq *gic_balance_irqs;
+static u64 *gic_balance_load;
+
+static int gic_balance_cmp(const void *a, const void *b)
+{
+	const struct gic_balance_irq *ia = a, *ib = b;
+
+	/* busiest first */
+	if (ia->rate == ib->rate)
+		return 0;
+
+	return ia->rate < ib->rate ? 1 : -1;
+}
+
+static unsigned int gic_balance_pick_cpu(unsigned int cur, unsigned int rate)
+{
+	unsigned int cpu, best;
+	bool stay = cur < NR_GIC_CPU_IF && cpu_online(cur);
+
+	best = stay ? cur : cpumask_first(cpu_online_mask);
+	for_each_online_cpu(cpu) {
+		if (cpu >= NR_GIC_CPU_IF)
+			break;
+		if (gic_balance_load[cpu] < gic_balance_load[best])
+			best = cpu;
+	}
+
+	/* not worth moving the interrupt around for a small gain */
+	if (stay && gic_balance_load[cur] <= gic_balance_load[best] + rate / 2)
+		return cur;
+
+	return best;
+}
+
+static void gic_balance(struct gic_chip_data *gic)
+{
+	unsigned int hwirq, irq, count, cur, cpu, i, nr = 0;
+	struct irq_data *d;
+
+	for (hwirq = 32; hwirq < gic->gic_irqs; hwirq++) {
+		irq = irq_find_mapping(gic->domain, hwirq);
+		if (!irq || !irq_has_action(irq))
+			continue;
+
+		d = irq_get_irq_data(irq);
+		if (!d || !irqd_can_balance(d) || irqd_affinity_is_managed(d))
+			continue;
+
+		count = kstat_irqs_usr(irq);
+		gic_balance_irqs[nr].irq = irq;
+		gic_balance_irqs[nr].rate = count - gic_balance_count[hwirq];
+		gic_balance_count[hwirq] = count;
+		nr++;
+	}
+
+	sort(gic_balance_irqs, nr, sizeof(*gic_balance_irqs),
+	     gic_balance_cmp, NULL);
+
+	memset(gic_balance_load, 0, nr_cpu_ids * sizeof(*gic_balance_load));
+	/* the idle interrupts stay where they are */
+	for (i = 0; i < nr && gic_balance_irqs[i].rate; i++) {
+		irq = gic_balance_irqs[i].irq;
+		d = irq_get_irq_data(irq);
+		cur = cpumask_first(irq_data_get_effective_affinity_mask(d));
+
+		cpu = gic_balance_pick_cpu(cur, gic_balance_irqs[i].rate);
+		if (cpu != cur && irq_set_affinity(irq, cpumask_of(cpu)))
+			cpu = cur;
+
+		if (cpu < nr_cpu_ids)
+			gic_balance_load[cpu] += gic_balance_irqs[i].rate;
+	}
+}
+
+static void gic_balance_work_fn(struct work_struct *work)
+{
+	unsigned int interval;
+
+	cpus_read_lock();
+	gic_balance(&gic_data[0]);
+	cpus_read_unlock();
+
+	interval = READ_ONCE(balance_interval_ms);
+	if (interval)
+		queue_delayed_work(system_power_efficient_wq,
+				   &gic_balance_work,
+				   msecs_to_jiffies(interval));
+}
+
+static int __init gic_balance_init(void)
+{
+	struct gic_chip_data *gic = &gic_data[0];
+
+	if (!gic->domain || nr_cpu_ids == 1)
+		return 0;
+
+	gic_balance_count = kcalloc(gic->gic_irqs, sizeof(*gic_balance_count),
+				    GFP_KERNEL);
+	gic_balance_irqs = kcalloc(gic->gic_irqs, sizeof(*gic_balance_irqs),
+				   GFP_KERNEL);
+	gic_balance_load = kcalloc(nr_cpu_ids, sizeof(*gic_balance_load),
+				   GFP_KERNEL);
+	if (!gic_balance_count || !gic_balance_irqs || !gic_balance_load) {
+		kfree(gic_balance_load);
+		kfree(gic_balance_irqs);
+		kfree(gic_balance_count);
+		return -ENOMEM;
+	}
+
+	WRITE_ONCE(gic_balance_ready, true);
+	if (READ_ONCE(balance_interval_ms))
+		queue_delayed_work(system_power_efficient_wq,
+				   &gic_balance_work, HZ);
+
+	return 0;
+}
+late_initcall(gic_balance_init);
 #else
 #define gic_smp_init()		do { } while(0)
 #define gic_set_affinity	NULL
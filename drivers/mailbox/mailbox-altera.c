@@ -3,7 +3,9 @@
  * Copyright Altera Corporation (C) 2013-2014. All rights reserved
  */
 
+#include <linux/debugfs.h>
 #include <linux/device.h>
+#include <linux/hrtimer.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
@@ -11,6 +13,7 @@
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
+#include <linux/seq_file.h>
 
 #define DRIVER_NAME	"altera-mailbox"
 
@@ -36,6 +39,29 @@ enum altera_mbox_msg {
 
 #define MBOX_POLLING_MS		5	/* polling interval 5ms */
 
+/*
+ * Messages delivered per interrupt or poll at most.  The sender usually posts
+ * the next message as soon as the previous one is read, so draining them in
+ * a loop saves an interrupt per message at high rates.
+ */
+#define MBOX_RX_BUDGET		64
+
+static unsigned int rx_poll_us;
+module_param(rx_poll_us, uint, 0444);
+MODULE_PARM_DESC(rx_poll_us,
+		 "Receiver poll period in us (0 = interrupt when available)");
+
+struct altera_mbox_stats {
+	u64 msgs;		/* messages sent or received */
+	u64 events;		/* interrupts or polls that handled a message */
+	u64 batch_max;		/* most messages received in one event */
+	u64 lat_ns;		/* total send to txdone, or receive callback time */
+	u64 lat_max_ns;
+	u64 rate;		/* messages per second over the last window */
+	u64 win_msgs;
+	ktime_t win_start;
+};
+
 struct altera_mbox {
 	bool is_sender;		/* 1-sender, 0-receiver */
 	bool intr_mode;
@@ -45,8 +71,13 @@ struct altera_mbox {
 	struct mbox_controller controller;
 
 	/* If the controller supports only RX polling mode */
-	struct timer_list rxpoll_timer;
+	struct hrtimer rxpoll_timer;
+	ktime_t rxpoll_period;
 	struct mbox_chan *chan;
+
+	ktime_t tx_start;
+	struct altera_mbox_stats stats;
+	struct dentry *debugfs;
 };
 
 static struct altera_mbox *mbox_chan_to_altera_mbox(struct mbox_chan *chan)
@@ -114,28 +145,60 @@ static bool altera_mbox_is_sender(struct altera_mbox *mbox)
 	return false;
 }
 
-static void altera_mbox_rx_data(struct mbox_chan *chan)
+static void altera_mbox_account(struct altera_mbox *mbox, unsigned int msgs,
+				u64 lat_ns)
+{
+	struct altera_mbox_stats *stats = &mbox->stats;
+	ktime_t now = ktime_get();
+	s64 win;
+
+	stats->msgs += msgs;
+	stats->events++;
+	stats->batch_max = max_t(u64, stats->batch_max, msgs);
+	stats->lat_ns += lat_ns;
+	stats->lat_max_ns = max(stats->lat_max_ns, lat_ns);
+
+	stats->win_msgs += msgs;
+	win = ktime_to_ns(ktime_sub(now, stats->win_start));
+	if (win >= NSEC_PER_SEC) {
+		stats->rate = div64_u64(stats->win_msgs * NSEC_PER_SEC, win);
+		stats->win_msgs = 0;
+		stats->win_start = now;
+	}
+}
+
+static int altera_mbox_rx_data(struct mbox_chan *chan)
 {
 	struct altera_mbox *mbox = mbox_chan_to_altera_mbox(chan);
+	ktime_t start = ktime_get();
+	int count = 0;
 	u32 data[2];
 
-	if (altera_mbox_pending(mbox)) {
+	while (count < MBOX_RX_BUDGET && altera_mbox_pending(mbox)) {
 		data[MBOX_PTR] =
 			readl_relaxed(mbox->mbox_base + MAILBOX_PTR_REG);
 		data[MBOX_CMD] =
 			readl_relaxed(mbox->mbox_base + MAILBOX_CMD_REG);
 		mbox_chan_received_data(chan, (void *)data);
+		count++;
 	}
+
+	if (count)
+		altera_mbox_account(mbox, count,
+				    ktime_to_ns(ktime_sub(ktime_get(), start)));
+
+	return count;
 }
 
-static void altera_mbox_poll_rx(struct timer_list *t)
+static enum hrtimer_restart altera_mbox_poll_rx(struct hrtimer *t)
 {
-	struct altera_mbox *mbox = from_timer(mbox, t, rxpoll_timer);
+	struct altera_mbox *mbox = container_of(t, struct altera_mbox,
+						rxpoll_timer);
 
 	altera_mbox_rx_data(mbox->chan);
 
-	mod_timer(&mbox->rxpoll_timer,
-		  jiffies + msecs_to_jiffies(MBOX_POLLING_MS));
+	hrtimer_forward_now(t, mbox->rxpoll_period);
+	return HRTIMER_RESTART;
 }
 
 static irqreturn_t altera_mbox_tx_interrupt(int irq, void *p)
@@ -144,6 +207,8 @@ static irqreturn_t altera_mbox_tx_interrupt(int irq, void *p)
 	struct altera_mbox *mbox = mbox_chan_to_altera_mbox(chan);
 
 	altera_mbox_tx_intmask(mbox, false);
+	altera_mbox_account(mbox, 1,
+			    ktime_to_ns(ktime_sub(ktime_get(), mbox->tx_start)));
 	mbox_chan_txdone(chan, 0);
 
 	return IRQ_HANDLED;
@@ -181,7 +246,9 @@ static int altera_mbox_startup_receiver(struct mbox_chan *chan)
 	int ret;
 	struct altera_mbox *mbox = mbox_chan_to_altera_mbox(chan);
 
-	if (mbox->intr_mode) {
+	mbox->stats.win_start = ktime_get();
+
+	if (mbox->intr_mode && !rx_poll_us) {
 		ret = request_irq(mbox->irq, altera_mbox_rx_interrupt, 0,
 				  DRIVER_NAME, chan);
 		if (unlikely(ret)) {
@@ -194,11 +261,19 @@ static int altera_mbox_startup_receiver(struct mbox_chan *chan)
 	}
 
 polling:
+	mbox->intr_mode = false;
+	if (rx_poll_us)
+		mbox->rxpoll_period = ns_to_ktime((u64)rx_poll_us *
+						  NSEC_PER_USEC);
+	else
+		mbox->rxpoll_period = ms_to_ktime(MBOX_POLLING_MS);
+
 	/* Setup polling timer */
 	mbox->chan = chan;
-	timer_setup(&mbox->rxpoll_timer, altera_mbox_poll_rx, 0);
-	mod_timer(&mbox->rxpoll_timer,
-		  jiffies + msecs_to_jiffies(MBOX_POLLING_MS));
+	hrtimer_init(&mbox->rxpoll_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	mbox->rxpoll_timer.function = altera_mbox_poll_rx;
+	hrtimer_start(&mbox->rxpoll_timer, mbox->rxpoll_period,
+		      HRTIMER_MODE_REL);
 
 	return 0;
 }
@@ -220,8 +295,10 @@ static int altera_mbox_send_data(struct mbox_chan *chan, void *data)
 		return -EBUSY;
 
 	/* Enable interrupt before send */
-	if (mbox->intr_mode)
+	if (mbox->intr_mode) {
+		mbox->tx_start = ktime_get();
 		altera_mbox_tx_intmask(mbox, true);
+	}
 
 	/* Pointer register must write before command register */
 	writel_relaxed(udata[MBOX_PTR], mbox->mbox_base + MAILBOX_PTR_REG);
@@ -270,7 +347,7 @@ static void altera_mbox_shutdown(struct mbox_chan *chan)
 		writel_relaxed(~0, mbox->mbox_base + MAILBOX_INTMASK_REG);
 		free_irq(mbox->irq, chan);
 	} else if (!mbox->is_sender) {
-		del_timer_sync(&mbox->rxpoll_timer);
+		hrtimer_cancel(&mbox->rxpoll_timer);
 	}
 }
 
@@ -282,6 +359,40 @@ static const struct mbox_chan_ops altera_mbox_ops = {
 	.peek_data = altera_mbox_peek_data,
 };
 
+static int altera_mbox_stats_show(struct seq_file *s, void *data)
+{
+	struct altera_mbox *mbox = s->private;
+	struct altera_mbox_stats *stats = &mbox->stats;
+	u64 msgs = READ_ONCE(stats->msgs);
+
+	seq_printf(s, "mode:\t\t%s %s\n", mbox->is_sender ? "tx" : "rx",
+		   mbox->intr_mode ? "interrupt" : "polling");
+	seq_printf(s, "messages:\t%llu\n", msgs);
+	seq_printf(s, "rate:\t\t%llu/s\n", READ_ONCE(stats->rate));
+	if (!mbox->is_sender) {
+		seq_printf(s, "events:\t\t%llu\n", READ_ONCE(stats->events));
+		seq_printf(s, "max batch:\t%llu\n",
+			   READ_ONCE(stats->batch_max));
+	}
+	/* time until txdone for a sender, spent in the callbacks otherwise */
+	seq_printf(s, "%s:\t%llu ns avg, %llu ns max\n",
+		   mbox->is_sender ? "tx latency" : "rx time",
+		   msgs ? div64_u64(READ_ONCE(stats->lat_ns),
+				    mbox->is_sender ? msgs :
+				    max(READ_ONCE(stats->events), 1ULL)) : 0,
+		   READ_ONCE(stats->lat_max_ns));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(altera_mbox_stats);
+
+static void altera_mbox_debugfs_remove(void *data)
+{
+	struct altera_mbox *mbox = data;
+
+	debugfs_remove_recursive(mbox->debugfs);
+}
+
 static int altera_mbox_probe(struct platform_device *pdev)
 {
 	struct altera_mbox *mbox;
@@ -334,6 +445,12 @@ static int altera_mbox_probe(struct platform_device *pdev)
 	}
 
 	platform_set_drvdata(pdev, mbox);
+
+	mbox->debugfs = debugfs_create_dir(dev_name(&pdev->dev), NULL);
+	debugfs_create_file("stats", 0400, mbox->debugfs, mbox,
+			    &altera_mbox_stats_fops);
+	ret = devm_add_action_or_reset(&pdev->dev, altera_mbox_debugfs_remove,
+				       mbox);
 err:
 	return ret;
 }
@@ -10,6 +10,7 @@
 
 #include <linux/device-mapper.h>
 #include <linux/dm-io.h>
+#include <linux/hash.h>
 #include <linux/slab.h>
 #include <linux/sched/mm.h>
 #include <linux/jiffies.h>
@@ -58,6 +59,12 @@
  */
 #define DM_BUFIO_WRITE_ALIGN		4096
 
+/*
+ * Number of trees the buffer index is split into, see struct dm_buffer_tree.
+ */
+#define DM_BUFIO_TREE_BITS		4
+#define DM_BUFIO_TREES			(1 << DM_BUFIO_TREE_BITS)
+
 /*
  * dm_buffer->list_mode
  */
@@ -67,7 +74,8 @@
 
 /*
  * Linking of buffers:
- *	All buffers are linked to buffer_tree with their node field.
+ *	All buffers are linked to one of the trees with their node field,
+ *	the tree being picked by hashing the block number.
  *
  *	Clean buffers that are not being written (B_WRITING not set)
  *	are linked to lru[LIST_CLEAN] with their lru_list field.
@@ -80,6 +88,19 @@
  *	dirty_lru too.  They are later added to lru in the process
  *	context.
  */
+/*
+ * A part of the buffer index.
+ *
+ * The trees are only modified with both c->lock and the tree lock held, so
+ * the lookups done with c->lock held don't take the tree lock.  Cache hits
+ * only read lock the tree of the block, so that concurrent readers don't
+ * serialize on c->lock.
+ */
+struct dm_buffer_tree {
+	rwlock_t lock;
+	struct rb_root root;
+} ____cacheline_aligned_in_smp;
+
 struct dm_bufio_client {
 	struct mutex lock;
 	spinlock_t spinlock;
@@ -102,7 +123,7 @@ struct dm_bufio_client {
 
 	unsigned int minimum_buffers;
 
-	struct rb_root buffer_tree;
+	struct dm_buffer_tree trees[DM_BUFIO_TREES];
 	wait_queue_head_t free_buffer_wait;
 
 	sector_t start;
@@ -143,10 +164,11 @@ struct dm_buffer {
 	void *data;
 	unsigned char data_mode;		/* DATA_MODE_* */
 	unsigned char list_mode;		/* LIST_* */
+	unsigned char lru_referenced;		/* hit since last relinked */
 	blk_status_t read_error;
 	blk_status_t write_error;
 	unsigned int accessed;
-	unsigned int hold_count;
+	atomic_t hold_count;
 	unsigned long state;
 	unsigned long last_accessed;
 	unsigned int dirty_start;
@@ -193,6 +215,46 @@ static void dm_bufio_unlock(struct dm_bufio_client *c)
 		mutex_unlock(&c->lock);
 }
 
+/*
+ * The trees of no_sleep clients are modified from the tasklets, so bottom
+ * halves must be disabled by the readers as well.
+ */
+static void dm_bufio_tree_read_lock(struct dm_bufio_client *c,
+				    struct dm_buffer_tree *t)
+{
+	if (static_branch_unlikely(&no_sleep_enabled) && c->no_sleep)
+		read_lock_bh(&t->lock);
+	else
+		read_lock(&t->lock);
+}
+
+static void dm_bufio_tree_read_unlock(struct dm_bufio_client *c,
+				      struct dm_buffer_tree *t)
+{
+	if (static_branch_unlikely(&no_sleep_enabled) && c->no_sleep)
+		read_unlock_bh(&t->lock);
+	else
+		read_unlock(&t->lock);
+}
+
+static void dm_bufio_tree_write_lock(struct dm_bufio_client *c,
+				     struct dm_buffer_tree *t)
+{
+	if (static_branch_unlikely(&no_sleep_enabled) && c->no_sleep)
+		write_lock_bh(&t->lock);
+	else
+		write_lock(&t->lock);
+}
+
+static void dm_bufio_tree_write_unlock(struct dm_bufio_client *c,
+				       struct dm_buffer_tree *t)
+{
+	if (static_branch_unlikely(&no_sleep_enabled) && c->no_sleep)
+		write_unlock_bh(&t->lock);
+	else
+		write_unlock(&t->lock);
+}
+
 /*----------------------------------------------------------------*/
 
 /*
@@ -259,11 +321,17 @@ static void buffer_record_stack(struct dm_buffer *b)
 #endif
 
 /*----------------------------------------------------------------
- * A red/black tree acts as an index for all the buffers.
+ * Red/black trees act as an index for all the buffers.
  *--------------------------------------------------------------*/
-static struct dm_buffer *__find(struct dm_bufio_client *c, sector_t block)
+static struct dm_buffer_tree *__block_tree(struct dm_bufio_client *c,
+					   sector_t block)
 {
-	struct rb_node *n = c->buffer_tree.rb_node;
+	return &c->trees[hash_64(block, DM_BUFIO_TREE_BITS)];
+}
+
+static struct dm_buffer *__tree_find(struct dm_buffer_tree *t, sector_t block)
+{
+	struct rb_node *n = t->root.rb_node;
 	struct dm_buffer *b;
 
 	while (n) {
@@ -278,9 +346,15 @@ static struct dm_buffer *__find(struct dm_bufio_client *c, sector_t block)
 	return NULL;
 }
 
-static struct dm_buffer *__find_next(struct dm_bufio_client *c, sector_t block)
+static struct dm_buffer *__find(struct dm_bufio_client *c, sector_t block)
+{
+	return __tree_find(__block_tree(c, block), block);
+}
+
+static struct dm_buffer *__tree_find_next(struct dm_buffer_tree *t,
+					  sector_t block)
 {
-	struct rb_node *n = c->buffer_tree.rb_node;
+	struct rb_node *n = t->root.rb_node;
 	struct dm_buffer *b;
 	struct dm_buffer *best = NULL;
 
@@ -301,9 +375,27 @@ static struct dm_buffer *__find_next(struct dm_bufio_client *c, sector_t block)
 	return best;
 }
 
+static struct dm_buffer *__find_next(struct dm_bufio_client *c, sector_t block)
+{
+	struct dm_buffer *b, *best = NULL;
+	unsigned int i;
+
+	for (i = 0; i < DM_BUFIO_TREES; i++) {
+		b = __tree_find_next(&c->trees[i], block);
+		if (b && (!best || b->block < best->block)) {
+			best = b;
+			if (best->block == block)
+				break;
+		}
+	}
+
+	return best;
+}
+
 static void __insert(struct dm_bufio_client *c, struct dm_buffer *b)
 {
-	struct rb_node **new = &c->buffer_tree.rb_node, *parent = NULL;
+	struct dm_buffer_tree *t = __block_tree(c, b->block);
+	struct rb_node **new = &t->root.rb_node, *parent = NULL;
 	struct dm_buffer *found;
 
 	while (*new) {
@@ -319,13 +411,44 @@ static void __insert(struct dm_bufio_client *c, struct dm_buffer *b)
 			&found->node.rb_left : &found->node.rb_right;
 	}
 
+	dm_bufio_tree_write_lock(c, t);
 	rb_link_node(&b->node, parent, new);
-	rb_insert_color(&b->node, &c->buffer_tree);
+	rb_insert_color(&b->node, &t->root);
+	dm_bufio_tree_write_unlock(c, t);
 }
 
 static void __remove(struct dm_bufio_client *c, struct dm_buffer *b)
 {
-	rb_erase(&b->node, &c->buffer_tree);
+	struct dm_buffer_tree *t = __block_tree(c, b->block);
+
+	if (RB_EMPTY_NODE(&b->node))
+		return;
+
+	dm_bufio_tree_write_lock(c, t);
+	rb_erase(&b->node, &t->root);
+	RB_CLEAR_NODE(&b->node);
+	dm_bufio_tree_write_unlock(c, t);
+}
+
+/*
+ * Take a buffer that isn't held by anybody but the caller's @holds out of its
+ * tree, so that cache hits can't find it and hold it anymore.
+ */
+static bool __claim_buffer(struct dm_buffer *b, int holds)
+{
+	struct dm_bufio_client *c = b->c;
+	struct dm_buffer_tree *t = __block_tree(c, b->block);
+	bool claimed = false;
+
+	dm_bufio_tree_write_lock(c, t);
+	if (atomic_read(&b->hold_count) == holds) {
+		rb_erase(&b->node, &t->root);
+		RB_CLEAR_NODE(&b->node);
+		claimed = true;
+	}
+	dm_bufio_tree_write_unlock(c, t);
+
+	return claimed;
 }
 
 /*----------------------------------------------------------------*/
@@ -486,6 +609,7 @@ static struct dm_buffer *alloc_buffer(struct dm_bufio_client *c, gfp_t gfp_mask)
 		return NULL;
 
 	b->c = c;
+	RB_CLEAR_NODE(&b->node);
 
 	b->data = alloc_buffer_data(c, gfp_mask, &b->data_mode);
 	if (!b->data) {
@@ -551,6 +675,7 @@ static void __relink_lru(struct dm_buffer *b, int dirty)
 	struct dm_bufio_client *c = b->c;
 
 	b->accessed = 1;
+	b->lru_referenced = 0;
 
 	BUG_ON(!c->n_buffers[b->list_mode]);
 
@@ -793,7 +918,7 @@ static void __flush_write_list(struct list_head *write_list)
  */
 static void __make_buffer_clean(struct dm_buffer *b)
 {
-	BUG_ON(b->hold_count);
+	BUG_ON(atomic_read(&b->hold_count));
 
 	/* smp_load_acquire() pairs with read_endio()'s smp_mb__before_atomic() */
 	if (!smp_load_acquire(&b->state))	/* fast case */
@@ -810,9 +935,9 @@ static void __make_buffer_clean(struct dm_buffer *b)
  */
 static struct dm_buffer *__get_unclaimed_buffer(struct dm_bufio_client *c)
 {
-	struct dm_buffer *b;
+	struct dm_buffer *b, *tmp;
 
-	list_for_each_entry_reverse(b, &c->lru[LIST_CLEAN], lru_list) {
+	list_for_each_entry_safe_reverse(b, tmp, &c->lru[LIST_CLEAN], lru_list) {
 		BUG_ON(test_bit(B_WRITING, &b->state));
 		BUG_ON(test_bit(B_DIRTY, &b->state));
 
@@ -820,7 +945,17 @@ static struct dm_buffer *__get_unclaimed_buffer(struct dm_bufio_client *c)
 		    unlikely(test_bit_acquire(B_READING, &b->state)))
 			continue;
 
-		if (!b->hold_count) {
+		/*
+		 * Cache hits don't relink the buffers, give the ones hit
+		 * since they were last relinked a second chance.
+		 */
+		if (b->lru_referenced) {
+			b->lru_referenced = 0;
+			list_move(&b->lru_list, &c->lru[LIST_CLEAN]);
+			continue;
+		}
+
+		if (__claim_buffer(b, 0)) {
 			__make_buffer_clean(b);
 			__unlink_buffer(b);
 			return b;
@@ -834,7 +969,7 @@ static struct dm_buffer *__get_unclaimed_buffer(struct dm_bufio_client *c)
 	list_for_each_entry_reverse(b, &c->lru[LIST_DIRTY], lru_list) {
 		BUG_ON(test_bit(B_READING, &b->state));
 
-		if (!b->hold_count) {
+		if (__claim_buffer(b, 0)) {
 			__make_buffer_clean(b);
 			__unlink_buffer(b);
 			return b;
@@ -845,19 +980,60 @@ static struct dm_buffer *__get_unclaimed_buffer(struct dm_bufio_client *c)
 	return NULL;
 }
 
+/*
+ * Check whether __get_unclaimed_buffer() would find a buffer now.
+ */
+static bool __has_unclaimed_buffer(struct dm_bufio_client *c)
+{
+	bool no_sleep = static_branch_unlikely(&no_sleep_enabled) && c->no_sleep;
+	struct dm_buffer *b;
+
+	list_for_each_entry(b, &c->lru[LIST_CLEAN], lru_list)
+		if (!atomic_read(&b->hold_count) &&
+		    !(no_sleep && test_bit(B_READING, &b->state)))
+			return true;
+
+	if (no_sleep)
+		return false;
+
+	list_for_each_entry(b, &c->lru[LIST_DIRTY], lru_list)
+		if (!atomic_read(&b->hold_count))
+			return true;
+
+	return false;
+}
+
 /*
  * Wait until some other threads free some buffer or release hold count on
- * some buffer.
+ * some buffer, or on the buffer "b" if it isn't NULL.
  *
  * This function is entered with c->lock held, drops it and regains it
  * before exiting.
  */
-static void __wait_for_free_buffer(struct dm_bufio_client *c)
+static void __wait_for_free_buffer(struct dm_bufio_client *c,
+				   struct dm_buffer *b)
 {
 	DECLARE_WAITQUEUE(wait, current);
+	bool released;
 
 	add_wait_queue(&c->free_buffer_wait, &wait);
 	set_current_state(TASK_UNINTERRUPTIBLE);
+
+	/*
+	 * The hold counts are dropped without c->lock.  Check them again
+	 * now that dm_bufio_release() sees us on the wait queue, so that a
+	 * release racing with the scan of the caller isn't missed.
+	 */
+	if (b)
+		released = !atomic_read(&b->hold_count);
+	else
+		released = __has_unclaimed_buffer(c);
+	if (released) {
+		__set_current_state(TASK_RUNNING);
+		remove_wait_queue(&c->free_buffer_wait, &wait);
+		return;
+	}
+
 	dm_bufio_unlock(c);
 
 	io_schedule();
@@ -930,7 +1106,7 @@ static struct dm_buffer *__alloc_buffer_wait_no_callback(struct dm_bufio_client
 		if (b)
 			return b;
 
-		__wait_for_free_buffer(c);
+		__wait_for_free_buffer(c, NULL);
 	}
 }
 
@@ -1034,7 +1210,7 @@ static struct dm_buffer *__bufio_new(struct dm_bufio_client *c, sector_t block,
 	__check_watermark(c, write_list);
 
 	b = new_b;
-	b->hold_count = 1;
+	atomic_set(&b->hold_count, 1);
 	b->read_error = 0;
 	b->write_error = 0;
 	__link_buffer(b, block, LIST_CLEAN);
@@ -1062,12 +1238,51 @@ static struct dm_buffer *__bufio_new(struct dm_bufio_client *c, sector_t block,
 	if (nf == NF_GET && unlikely(test_bit_acquire(B_READING, &b->state)))
 		return NULL;
 
-	b->hold_count++;
+	atomic_inc(&b->hold_count);
 	__relink_lru(b, test_bit(B_DIRTY, &b->state) ||
 		     test_bit(B_WRITING, &b->state));
 	return b;
 }
 
+/*
+ * Cache hit path: look the block up with only its tree read locked and take
+ * a hold on the buffer.  The buffer isn't moved in the LRU, which needs
+ * c->lock, it is marked as referenced instead.
+ *
+ * Returns false if the block isn't cached.  Otherwise "*bp" is set to the
+ * held buffer, or to NULL if the buffer isn't to be returned for "nf", as
+ * in __bufio_new().
+ */
+static bool get_cached_buffer(struct dm_bufio_client *c, sector_t block,
+			      enum new_flag nf, struct dm_buffer **bp)
+{
+	struct dm_buffer_tree *t = __block_tree(c, block);
+	struct dm_buffer *b;
+
+	dm_bufio_tree_read_lock(c, t);
+
+	b = __tree_find(t, block);
+	if (!b) {
+		dm_bufio_tree_read_unlock(c, t);
+		return false;
+	}
+
+	if (nf == NF_PREFETCH ||
+	    (nf == NF_GET && unlikely(test_bit_acquire(B_READING, &b->state)))) {
+		b = NULL;
+	} else {
+		atomic_inc(&b->hold_count);
+		WRITE_ONCE(b->accessed, 1);
+		WRITE_ONCE(b->lru_referenced, 1);
+		WRITE_ONCE(b->last_accessed, jiffies);
+	}
+
+	dm_bufio_tree_read_unlock(c, t);
+
+	*bp = b;
+	return true;
+}
+
 /*
  * The endio routine for reading: set the error, clear the bit and wake up
  * anyone waiting on the buffer.
@@ -1094,24 +1309,30 @@ static void read_endio(struct dm_buffer *b, blk_status_t status)
 static void *new_read(struct dm_bufio_client *c, sector_t block,
 		      enum new_flag nf, struct dm_buffer **bp)
 {
-	int need_submit;
+	int need_submit = 0;
 	struct dm_buffer *b;
 
 	LIST_HEAD(write_list);
 
-	dm_bufio_lock(c);
-	b = __bufio_new(c, block, nf, &need_submit, &write_list);
-#ifdef CONFIG_DM_DEBUG_BLOCK_STACK_TRACING
-	if (b && b->hold_count == 1)
-		buffer_record_stack(b);
-#endif
-	dm_bufio_unlock(c);
+	if (!get_cached_buffer(c, block, nf, &b)) {
+		if (nf == NF_GET)
+			return NULL;
 
-	__flush_write_list(&write_list);
+		dm_bufio_lock(c);
+		b = __bufio_new(c, block, nf, &need_submit, &write_list);
+		dm_bufio_unlock(c);
+
+		__flush_write_list(&write_list);
+	}
 
 	if (!b)
 		return NULL;
 
+#ifdef CONFIG_DM_DEBUG_BLOCK_STACK_TRACING
+	if (atomic_read(&b->hold_count) == 1)
+		buffer_record_stack(b);
+#endif
+
 	if (need_submit)
 		submit_io(b, REQ_OP_READ, read_endio);
 
@@ -1165,38 +1386,41 @@ void dm_bufio_prefetch(struct dm_bufio_client *c,
 	BUG_ON(dm_bufio_in_request());
 
 	blk_start_plug(&plug);
-	dm_bufio_lock(c);
 
 	for (; n_blocks--; block++) {
 		int need_submit;
 		struct dm_buffer *b;
+
+		if (get_cached_buffer(c, block, NF_PREFETCH, &b))
+			continue;
+
+		/*
+		 * Don't grow the cache while the shrinker asks us to give
+		 * memory back, the buffers read ahead would be the first
+		 * ones to go.
+		 */
+		if (atomic_long_read(&c->need_shrink))
+			break;
+
+		dm_bufio_lock(c);
 		b = __bufio_new(c, block, NF_PREFETCH, &need_submit,
 				&write_list);
+		dm_bufio_unlock(c);
+
 		if (unlikely(!list_empty(&write_list))) {
-			dm_bufio_unlock(c);
 			blk_finish_plug(&plug);
 			__flush_write_list(&write_list);
 			blk_start_plug(&plug);
-			dm_bufio_lock(c);
 		}
 		if (unlikely(b != NULL)) {
-			dm_bufio_unlock(c);
-
 			if (need_submit)
 				submit_io(b, REQ_OP_READ, read_endio);
 			dm_bufio_release(b);
 
 			cond_resched();
-
-			if (!n_blocks)
-				goto flush_plug;
-			dm_bufio_lock(c);
 		}
 	}
 
-	dm_bufio_unlock(c);
-
-flush_plug:
 	blk_finish_plug(&plug);
 }
 EXPORT_SYMBOL_GPL(dm_bufio_prefetch);
@@ -1205,12 +1429,25 @@ void dm_bufio_release(struct dm_buffer *b)
 {
 	struct dm_bufio_client *c = b->c;
 
+	/*
+	 * Dropping a hold doesn't need c->lock unless the buffer is to be
+	 * freed.  The buffer may go away as soon as the hold is dropped, so
+	 * its errors are checked before.
+	 */
+	if (likely(!READ_ONCE(b->read_error) && !READ_ONCE(b->write_error))) {
+		int hold_count = atomic_dec_return(&b->hold_count);
+
+		BUG_ON(hold_count < 0);
+		if (!hold_count && wq_has_sleeper(&c->free_buffer_wait))
+			wake_up(&c->free_buffer_wait);
+		return;
+	}
+
 	dm_bufio_lock(c);
 
-	BUG_ON(!b->hold_count);
+	BUG_ON(!atomic_read(&b->hold_count));
 
-	b->hold_count--;
-	if (!b->hold_count) {
+	if (atomic_dec_and_test(&b->hold_count)) {
 		wake_up(&c->free_buffer_wait);
 
 		/*
@@ -1218,10 +1455,10 @@ void dm_bufio_release(struct dm_buffer *b)
 		 * to be written, free the buffer. There is no point in caching
 		 * invalid buffer.
 		 */
-		if ((b->read_error || b->write_error) &&
-		    !test_bit_acquire(B_READING, &b->state) &&
+		if (!test_bit_acquire(B_READING, &b->state) &&
 		    !test_bit(B_WRITING, &b->state) &&
-		    !test_bit(B_DIRTY, &b->state)) {
+		    !test_bit(B_DIRTY, &b->state) &&
+		    __claim_buffer(b, 0)) {
 			__unlink_buffer(b);
 			__free_buffer_wake(b);
 		}
@@ -1310,12 +1547,12 @@ int dm_bufio_write_dirty_buffers(struct dm_bufio_client *c)
 		if (test_bit(B_WRITING, &b->state)) {
 			if (buffers_processed < c->n_buffers[LIST_DIRTY]) {
 				dropped_lock = 1;
-				b->hold_count++;
+				atomic_inc(&b->hold_count);
 				dm_bufio_unlock(c);
 				wait_on_bit_io(&b->state, B_WRITING,
 					       TASK_UNINTERRUPTIBLE);
 				dm_bufio_lock(c);
-				b->hold_count--;
+				atomic_dec(&b->hold_count);
 			} else
 				wait_on_bit_io(&b->state, B_WRITING,
 					       TASK_UNINTERRUPTIBLE);
@@ -1426,8 +1663,8 @@ void dm_bufio_release_move(struct dm_buffer *b, sector_t new_block)
 retry:
 	new = __find(c, new_block);
 	if (new) {
-		if (new->hold_count) {
-			__wait_for_free_buffer(c);
+		if (!__claim_buffer(new, 0)) {
+			__wait_for_free_buffer(c, new);
 			goto retry;
 		}
 
@@ -1440,11 +1677,11 @@ void dm_bufio_release_move(struct dm_buffer *b, sector_t new_block)
 		__free_buffer_wake(new);
 	}
 
-	BUG_ON(!b->hold_count);
+	BUG_ON(!atomic_read(&b->hold_count));
 	BUG_ON(test_bit(B_READING, &b->state));
 
 	__write_dirty_buffer(b, NULL);
-	if (b->hold_count == 1) {
+	if (__claim_buffer(b, 1)) {
 		wait_on_bit_io(&b->state, B_WRITING,
 			       TASK_UNINTERRUPTIBLE);
 		set_bit(B_DIRTY, &b->state);
@@ -1457,20 +1694,21 @@ void dm_bufio_release_move(struct dm_buffer *b, sector_t new_block)
 		wait_on_bit_lock_io(&b->state, B_WRITING,
 				    TASK_UNINTERRUPTIBLE);
 		/*
-		 * Relink buffer to "new_block" so that write_callback
+		 * Set the block number to "new_block" so that write_callback
 		 * sees "new_block" as a block number.
-		 * After the write, link the buffer back to old_block.
-		 * All this must be done in bufio lock, so that block number
-		 * change isn't visible to other threads.
+		 * After the write, set it back to old_block.
+		 * The buffer is out of the tree meanwhile and all this is
+		 * done in bufio lock, so that block number change isn't
+		 * visible to other threads.
 		 */
 		old_block = b->block;
-		__unlink_buffer(b);
-		__link_buffer(b, new_block, b->list_mode);
+		__remove(c, b);
+		b->block = new_block;
 		submit_io(b, REQ_OP_WRITE, write_endio);
 		wait_on_bit_io(&b->state, B_WRITING,
 			       TASK_UNINTERRUPTIBLE);
-		__unlink_buffer(b);
-		__link_buffer(b, old_block, b->list_mode);
+		b->block = old_block;
+		__insert(c, b);
 	}
 
 	dm_bufio_unlock(c);
@@ -1480,7 +1718,8 @@ EXPORT_SYMBOL_GPL(dm_bufio_release_move);
 
 static void forget_buffer_locked(struct dm_buffer *b)
 {
-	if (likely(!b->hold_count) && likely(!smp_load_acquire(&b->state))) {
+	if (likely(!smp_load_acquire(&b->state)) &&
+	    likely(__claim_buffer(b, 0))) {
 		__unlink_buffer(b);
 		__free_buffer_wake(b);
 	}
@@ -1608,12 +1847,13 @@ static void drop_buffers(struct dm_bufio_client *c)
 		list_for_each_entry(b, &c->lru[i], lru_list) {
 			WARN_ON(!warned);
 			warned = true;
-			DMERR("leaked buffer %llx, hold count %u, list %d",
-			      (unsigned long long)b->block, b->hold_count, i);
+			DMERR("leaked buffer %llx, hold count %d, list %d",
+			      (unsigned long long)b->block,
+			      atomic_read(&b->hold_count), i);
 #ifdef CONFIG_DM_DEBUG_BLOCK_STACK_TRACING
 			stack_trace_print(b->stack_entries, b->stack_len, 1);
 			/* mark unclaimed to avoid BUG_ON below */
-			b->hold_count = 0;
+			atomic_set(&b->hold_count, 0);
 #endif
 		}
 
@@ -1646,7 +1886,7 @@ static bool __try_evict_buffer(struct dm_buffer *b, gfp_t gfp)
 			return false;
 	}
 
-	if (b->hold_count)
+	if (!__claim_buffer(b, 0))
 		return false;
 
 	__make_buffer_clean(b);
@@ -1756,7 +1996,10 @@ struct dm_bufio_client *dm_bufio_client_create(struct block_device *bdev, unsign
 		r = -ENOMEM;
 		goto bad_client;
 	}
-	c->buffer_tree = RB_ROOT;
+	for (i = 0; i < DM_BUFIO_TREES; i++) {
+		rwlock_init(&c->trees[i].lock);
+		c->trees[i].root = RB_ROOT;
+	}
 
 	c->bdev = bdev;
 	c->block_size = block_size;
@@ -1887,7 +2130,8 @@ void dm_bufio_client_destroy(struct dm_bufio_client *c)
 
 	mutex_unlock(&dm_bufio_clients_lock);
 
-	BUG_ON(!RB_EMPTY_ROOT(&c->buffer_tree));
+	for (i = 0; i < DM_BUFIO_TREES; i++)
+		BUG_ON(!RB_EMPTY_ROOT(&c->trees[i].root));
 	BUG_ON(c->need_reserved_buffers);
 
 	while (!list_empty(&c->reserved_buffers)) {
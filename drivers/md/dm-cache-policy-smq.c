@@ -44,10 +44,13 @@ struct entry {
 	bool allocated:1;
 	bool sentinel:1;
 	bool pending_work:1;
+	unsigned int hits:16;
 
 	dm_oblock_t oblock;
 };
 
+#define ENTRY_MAX_HITS ((1u << 16u) - 1u)
+
 /*----------------------------------------------------------------*/
 
 #define INDEXER_NULL ((1u << 28u) - 1u)
@@ -724,6 +727,7 @@ static void init_entry(struct entry *e)
 	e->allocated = true;
 	e->sentinel = false;
 	e->pending_work = false;
+	e->hits = 0u;
 }
 
 static struct entry *alloc_entry(struct entry_alloc *ea)
@@ -792,6 +796,8 @@ static struct entry *get_entry(struct entry_alloc *ea, unsigned int index)
 #define HOTSPOT_UPDATE_PERIOD (HZ)
 #define CACHE_UPDATE_PERIOD (60ul * HZ)
 
+#define MAX_HOT_SET_BLOCKS 16u
+
 struct smq_policy {
 	struct dm_cache_policy policy;
 
@@ -853,6 +859,23 @@ struct smq_policy {
 	unsigned long next_hotspot_period;
 	unsigned long next_cache_period;
 
+	/*
+	 * Tunables, see smq_set_config_value().  Zero means the default
+	 * behaviour.
+	 */
+	unsigned int read_promote_threshold;
+	unsigned int write_promote_threshold;
+	unsigned int sequential_threshold;
+	unsigned int writeback_limit;
+	unsigned int hot_set_blocks;
+
+	/*
+	 * The last block missed, and the number of consecutive blocks
+	 * missed before it.
+	 */
+	dm_oblock_t last_miss;
+	unsigned int nr_sequential_misses;
+
 	struct background_tracker *bg_work;
 
 	bool migrations_allowed:1;
@@ -1074,6 +1097,11 @@ static void update_promote_levels(struct smq_policy *mq)
 
 	mq->read_promote_level = NR_HOTSPOT_LEVELS - threshold_level;
 	mq->write_promote_level = (NR_HOTSPOT_LEVELS - threshold_level);
+
+	if (mq->read_promote_threshold)
+		mq->read_promote_level = mq->read_promote_threshold;
+	if (mq->write_promote_threshold)
+		mq->write_promote_level = mq->write_promote_threshold;
 }
 
 /*
@@ -1186,6 +1214,14 @@ static void queue_writeback(struct smq_policy *mq, bool idle)
 	struct policy_work work;
 	struct entry *e;
 
+	/*
+	 * Slow origins can't absorb many writebacks at once without the
+	 * foreground io suffering.
+	 */
+	if (mq->writeback_limit &&
+	    btracker_nr_writebacks_queued(mq->bg_work) >= mq->writeback_limit)
+		return;
+
 	e = q_peek(&mq->dirty, mq->dirty.nr_levels, idle);
 	if (e) {
 		mark_pending(mq, e);
@@ -1298,6 +1334,30 @@ static enum promote_result should_promote(struct smq_policy *mq, struct entry *h
 		return maybe_promote(hs_e->level >= mq->read_promote_level);
 }
 
+/*
+ * Long runs of sequential misses are better served by the origin than by
+ * promoting every block of the run.
+ */
+static bool sequential_miss(struct smq_policy *mq, dm_oblock_t oblock)
+{
+	dm_block_t b = from_oblock(oblock);
+	dm_block_t last = from_oblock(mq->last_miss);
+
+	if (!mq->sequential_threshold)
+		return false;
+
+	/* several bios may miss on the same block */
+	if (b == last + 1u) {
+		if (mq->nr_sequential_misses < UINT_MAX)
+			mq->nr_sequential_misses++;
+	} else if (b != last)
+		mq->nr_sequential_misses = 0u;
+
+	mq->last_miss = oblock;
+
+	return mq->nr_sequential_misses >= mq->sequential_threshold;
+}
+
 static dm_oblock_t to_hblock(struct smq_policy *mq, dm_oblock_t b)
 {
 	sector_t r = from_oblock(b);
@@ -1383,6 +1443,8 @@ static int __lookup(struct smq_policy *mq, dm_oblock_t oblock, dm_cblock_t *cblo
 	e = h_lookup(&mq->table, oblock);
 	if (e) {
 		stats_level_accessed(&mq->cache_stats, e->level);
+		if (e->hits < ENTRY_MAX_HITS)
+			e->hits++;
 
 		requeue(mq, e);
 		*cblock = infer_cblock(mq, e);
@@ -1391,6 +1453,13 @@ static int __lookup(struct smq_policy *mq, dm_oblock_t oblock, dm_cblock_t *cblo
 	} else {
 		stats_miss(&mq->cache_stats);
 
+		/*
+		 * Sequential runs neither pollute the hotspot queue nor get
+		 * promoted.
+		 */
+		if (sequential_miss(mq, oblock))
+			return -ENOENT;
+
 		/*
 		 * The hotspot queue only gets updated with misses.
 		 */
@@ -1642,9 +1711,141 @@ static void smq_allow_migrations(struct dm_cache_policy *p, bool allow)
 }
 
 /*
- * smq has no config values, but the old mq policy did.  To avoid breaking
- * software we continue to accept these configurables for the mq policy,
- * but they have no effect.
+ * smq config values:
+ *
+ * read_promote_threshold, write_promote_threshold: the hotspot queue level
+ *	(1 to 64) a block must have reached to be promoted on a read or write
+ *	miss, 64 meaning never.  The level is adapted to the hit rate when 0.
+ *
+ * sequential_threshold: the number of consecutive cache blocks missed
+ *	after which the misses are left to the origin.  0 disables the
+ *	detection.
+ *
+ * writeback_limit: the maximum number of writebacks in flight.  0 leaves
+ *	them limited by the migration_threshold of the target only.
+ *
+ * hot_set_blocks: the number of cached blocks (up to 16) with the most hits
+ *	listed in the status, as "hot_set <oblock>:<hits>,...".  This walks
+ *	the whole cache each time the status is read, so it is 0 by default.
+ */
+static int smq_set_config_value(struct dm_cache_policy *p,
+				const char *key, const char *value)
+{
+	struct smq_policy *mq = to_smq_policy(p);
+	unsigned int tmp, max = UINT_MAX;
+	unsigned int *tunable;
+	unsigned long flags;
+
+	if (kstrtouint(value, 10, &tmp))
+		return -EINVAL;
+
+	if (!strcasecmp(key, "read_promote_threshold")) {
+		tunable = &mq->read_promote_threshold;
+		max = NR_HOTSPOT_LEVELS;
+	} else if (!strcasecmp(key, "write_promote_threshold")) {
+		tunable = &mq->write_promote_threshold;
+		max = NR_HOTSPOT_LEVELS;
+	} else if (!strcasecmp(key, "sequential_threshold"))
+		tunable = &mq->sequential_threshold;
+	else if (!strcasecmp(key, "writeback_limit"))
+		tunable = &mq->writeback_limit;
+	else if (!strcasecmp(key, "hot_set_blocks")) {
+		tunable = &mq->hot_set_blocks;
+		max = MAX_HOT_SET_BLOCKS;
+	} else
+		return -EINVAL;
+
+	if (tmp > max)
+		return -EINVAL;
+
+	spin_lock_irqsave(&mq->lock, flags);
+	*tunable = tmp;
+	update_promote_levels(mq);
+	spin_unlock_irqrestore(&mq->lock, flags);
+
+	return 0;
+}
+
+struct hot_block {
+	dm_oblock_t oblock;
+	unsigned int hits;
+};
+
+/*
+ * Fills hot with the nr cached blocks with the most hits, most hit first.
+ */
+static unsigned int __get_hot_set(struct smq_policy *mq, struct hot_block *hot,
+				  unsigned int nr)
+{
+	unsigned int i, j, n = 0;
+	struct entry *e;
+
+	for (i = 0; i < from_cblock(mq->cache_size); i++) {
+		e = get_entry(&mq->cache_alloc, i);
+		if (!e->allocated || e->pending_work || !e->hits)
+			continue;
+
+		if (n == nr && e->hits <= hot[n - 1].hits)
+			continue;
+
+		j = n < nr ? n++ : n - 1;
+		while (j && hot[j - 1].hits < e->hits) {
+			hot[j] = hot[j - 1];
+			j--;
+		}
+		hot[j].oblock = e->oblock;
+		hot[j].hits = e->hits;
+	}
+
+	return n;
+}
+
+static int smq_emit_config_values(struct dm_cache_policy *p, char *result,
+				  unsigned int maxlen, ssize_t *sz_ptr)
+{
+	struct smq_policy *mq = to_smq_policy(p);
+	struct hot_block hot[MAX_HOT_SET_BLOCKS];
+	unsigned int i, nr_hot = 0, hot_set_blocks;
+	unsigned long flags;
+	ssize_t sz = *sz_ptr;
+
+	spin_lock_irqsave(&mq->lock, flags);
+	hot_set_blocks = mq->hot_set_blocks;
+	if (hot_set_blocks)
+		nr_hot = __get_hot_set(mq, hot, hot_set_blocks);
+
+	DMEMIT("%u read_promote_threshold %u "
+	       "write_promote_threshold %u "
+	       "sequential_threshold %u "
+	       "writeback_limit %u "
+	       "hot_set_blocks %u ",
+	       hot_set_blocks ? 12u : 10u,
+	       mq->read_promote_threshold,
+	       mq->write_promote_threshold,
+	       mq->sequential_threshold,
+	       mq->writeback_limit,
+	       hot_set_blocks);
+	spin_unlock_irqrestore(&mq->lock, flags);
+
+	if (hot_set_blocks) {
+		DMEMIT("hot_set ");
+		if (!nr_hot)
+			DMEMIT("-");
+		for (i = 0; i < nr_hot; i++)
+			DMEMIT("%s%llu:%u", i ? "," : "",
+			       (unsigned long long) from_oblock(hot[i].oblock),
+			       hot[i].hits);
+		DMEMIT(" ");
+	}
+
+	*sz_ptr = sz;
+	return 0;
+}
+
+/*
+ * The old mq policy had other config values.  To avoid breaking software
+ * we continue to accept these configurables for the mq policy, but they
+ * have no effect.
  */
 static int mq_set_config_value(struct dm_cache_policy *p,
 			       const char *key, const char *value)
@@ -1682,7 +1883,8 @@ static int mq_emit_config_values(struct dm_cache_policy *p, char *result,
 }
 
 /* Init the policy plugin interface function pointers. */
-static void init_policy_functions(struct smq_policy *mq, bool mimic_mq)
+static void init_policy_functions(struct smq_policy *mq, bool mimic_mq,
+				  bool cleaner)
 {
 	mq->policy.destroy = smq_destroy;
 	mq->policy.lookup = smq_lookup;
@@ -1701,6 +1903,9 @@ static void init_policy_functions(struct smq_policy *mq, bool mimic_mq)
 	if (mimic_mq) {
 		mq->policy.set_config_value = mq_set_config_value;
 		mq->policy.emit_config_values = mq_emit_config_values;
+	} else if (!cleaner) {
+		mq->policy.set_config_value = smq_set_config_value;
+		mq->policy.emit_config_values = smq_emit_config_values;
 	}
 }
 
@@ -1737,7 +1942,7 @@ __smq_create(dm_cblock_t cache_size, sector_t origin_size, sector_t cache_block_
 	if (!mq)
 		return NULL;
 
-	init_policy_functions(mq, mimic_mq);
+	init_policy_functions(mq, mimic_mq, cleaner);
 	mq->cache_size = cache_size;
 	mq->cache_block_size = cache_block_size;
 
@@ -1862,7 +2067,7 @@ static struct dm_cache_policy *cleaner_create(dm_cblock_t cache_size,
 
 static struct dm_cache_policy_type smq_policy_type = {
 	.name = "smq",
-	.version = {2, 0, 0},
+	.version = {2, 1, 0},
 	.hint_size = 4,
 	.owner = THIS_MODULE,
 	.create = smq_create
@@ -1886,7 +2091,7 @@ static struct dm_cache_policy_type cleaner_policy_type = {
 
 static struct dm_cache_policy_type default_policy_type = {
 	.name = "default",
-	.version = {2, 0, 0},
+	.version = {2, 1, 0},
 	.hint_size = 4,
 	.owner = THIS_MODULE,
 	.create = smq_create,
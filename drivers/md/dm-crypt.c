@@ -25,6 +25,7 @@
 #include <linux/atomic.h>
 #include <linux/scatterlist.h>
 #include <linux/rbtree.h>
+#include <linux/u64_stats_sync.h>
 #include <linux/ctype.h>
 #include <asm/page.h>
 #include <asm/unaligned.h>
@@ -142,6 +143,18 @@ enum cipher_flags {
 	CRYPT_MODE_INTEGRITY_AEAD,	/* Use authenticated mode for cipher */
 	CRYPT_IV_LARGE_SECTORS,		/* Calculate IV from sector_size, not 512B sectors */
 	CRYPT_ENCRYPT_PREPROCESS,	/* Must preprocess data for encryption (elephant) */
+	CRYPT_SYNC_SKCIPHER,		/* Requests complete before the cipher returns */
+};
+
+/*
+ * Per-cpu conversion statistics, indexed by the data direction of the bio.
+ * The time is only accounted for synchronous ciphers, as the work of the
+ * others is done elsewhere.
+ */
+struct crypt_stats {
+	u64_stats_t bytes[2];
+	u64_stats_t ns[2];
+	struct u64_stats_sync syncp;
 };
 
 /*
@@ -152,6 +165,7 @@ struct crypt_config {
 	sector_t start;
 
 	struct percpu_counter n_allocated_pages;
+	struct crypt_stats __percpu *stats;
 
 	struct workqueue_struct *io_queue;
 	struct workqueue_struct *crypt_queue;
@@ -227,6 +241,7 @@ struct crypt_config {
 };
 
 #define MIN_IOS		64
+#define MAX_BATCH_SECTORS	32
 #define MAX_TAG_SIZE	480
 #define POOL_ENTRY_SIZE	512
 
@@ -1546,6 +1561,59 @@ static void crypt_free_req(struct crypt_config *cc, void *req, struct bio *base_
 /*
  * Encrypt / decrypt data from one bio to another one (can be the same one)
  */
+static void crypt_account(struct crypt_config *cc, int dir, unsigned int bytes,
+			  u64 ns)
+{
+	struct crypt_stats *stats = get_cpu_ptr(cc->stats);
+	unsigned long flags;
+
+	flags = u64_stats_update_begin_irqsave(&stats->syncp);
+	u64_stats_add(&stats->bytes[dir], bytes);
+	u64_stats_add(&stats->ns[dir], ns);
+	u64_stats_update_end_irqrestore(&stats->syncp, flags);
+	put_cpu_ptr(cc->stats);
+}
+
+/*
+ * A synchronous cipher is done with the request when it returns, so the
+ * sectors sharing the current bio_vec of both bios are converted in a row
+ * with the same request, without accounting each of them as pending.
+ */
+static int crypt_convert_batch_skcipher(struct crypt_config *cc,
+					struct convert_context *ctx,
+					unsigned int *tag_offset)
+{
+	struct bio_vec bv_in = bio_iter_iovec(ctx->bio_in, ctx->iter_in);
+	struct bio_vec bv_out = bio_iter_iovec(ctx->bio_out, ctx->iter_out);
+	unsigned int sector_step = cc->sector_size >> SECTOR_SHIFT;
+	unsigned int n = min(bv_in.bv_len, bv_out.bv_len) / cc->sector_size;
+	u64 start = ktime_get_ns();
+	unsigned int i;
+	int r = 0;
+
+	n = clamp(n, 1U, MAX_BATCH_SECTORS);
+	for (i = 0; i < n; i++) {
+		if (i && cc->tfms_count > 1) {
+			unsigned int key_index = ctx->cc_sector & (cc->tfms_count - 1);
+
+			skcipher_request_set_tfm(ctx->r.req,
+						 cc->cipher_tfm.tfms[key_index]);
+		}
+
+		r = crypt_convert_block_skcipher(cc, ctx, ctx->r.req, *tag_offset);
+		if (r)
+			break;
+
+		ctx->cc_sector += sector_step;
+		(*tag_offset)++;
+	}
+
+	crypt_account(cc, bio_data_dir(ctx->bio_in), i * cc->sector_size,
+		      ktime_get_ns() - start);
+
+	return r;
+}
+
 static blk_status_t crypt_convert(struct crypt_config *cc,
 			 struct convert_context *ctx, bool atomic, bool reset_pending)
 {
@@ -1569,6 +1637,16 @@ static blk_status_t crypt_convert(struct crypt_config *cc,
 			return BLK_STS_DEV_RESOURCE;
 		}
 
+		if (test_bit(CRYPT_SYNC_SKCIPHER, &cc->cipher_flags)) {
+			r = crypt_convert_batch_skcipher(cc, ctx, &tag_offset);
+			if (r)
+				return BLK_STS_IOERR;
+			if (!atomic)
+				cond_resched();
+			continue;
+		}
+
+		crypt_account(cc, bio_data_dir(ctx->bio_in), cc->sector_size, 0);
 		atomic_inc(&ctx->cc_pending);
 
 		if (crypt_integrity_aead(cc))
@@ -2311,6 +2389,10 @@ static int crypt_alloc_tfms_skcipher(struct crypt_config *cc, char *ciphermode)
 	 */
 	DMDEBUG_LIMIT("%s using implementation \"%s\"", ciphermode,
 	       crypto_skcipher_alg(any_tfm(cc))->base.cra_driver_name);
+
+	if (!(crypto_skcipher_alg(any_tfm(cc))->base.cra_flags &
+	      CRYPTO_ALG_ASYNC))
+		set_bit(CRYPT_SYNC_SKCIPHER, &cc->cipher_flags);
 	return 0;
 }
 
@@ -2715,6 +2797,7 @@ static void crypt_dtr(struct dm_target *ti)
 
 	WARN_ON(percpu_counter_sum(&cc->n_allocated_pages) != 0);
 	percpu_counter_destroy(&cc->n_allocated_pages);
+	free_percpu(cc->stats);
 
 	if (cc->iv_gen_ops && cc->iv_gen_ops->dtr)
 		cc->iv_gen_ops->dtr(cc);
@@ -3171,6 +3254,7 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 	int ret;
 	size_t iv_size_padding, additional_req_size;
 	char dummy;
+	int cpu;
 
 	if (argc < 5) {
 		ti->error = "Not enough arguments";
@@ -3203,6 +3287,15 @@ static int crypt_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 	if (ret < 0)
 		goto bad;
 
+	cc->stats = alloc_percpu(struct crypt_stats);
+	if (!cc->stats) {
+		ti->error = "Cannot allocate crypt statistics";
+		ret = -ENOMEM;
+		goto bad;
+	}
+	for_each_possible_cpu(cpu)
+		u64_stats_init(&per_cpu_ptr(cc->stats, cpu)->syncp);
+
 	/* Optional parameters need to be read before cipher constructor */
 	if (argc > 5) {
 		ret = crypt_ctr_optional(ti, argc - 5, &argv[5]);
@@ -3447,6 +3540,39 @@ static char hex2asc(unsigned char c)
 	return c + '0' + ((unsigned int)(9 - c) >> 4 & 0x27);
 }
 
+/*
+ * <bytes read> <ns decrypting> <bytes written> <ns encrypting>
+ */
+static void crypt_status_stats(struct crypt_config *cc, char *result,
+			       unsigned int maxlen)
+{
+	u64 bytes[2] = { }, ns[2] = { };
+	unsigned int sz = 0;
+	int cpu, dir;
+
+	for_each_possible_cpu(cpu) {
+		struct crypt_stats *stats = per_cpu_ptr(cc->stats, cpu);
+		u64 b[2], t[2];
+		unsigned int start;
+
+		do {
+			start = u64_stats_fetch_begin(&stats->syncp);
+			for (dir = READ; dir <= WRITE; dir++) {
+				b[dir] = u64_stats_read(&stats->bytes[dir]);
+				t[dir] = u64_stats_read(&stats->ns[dir]);
+			}
+		} while (u64_stats_fetch_retry(&stats->syncp, start));
+
+		for (dir = READ; dir <= WRITE; dir++) {
+			bytes[dir] += b[dir];
+			ns[dir] += t[dir];
+		}
+	}
+
+	DMEMIT("%llu %llu %llu %llu", bytes[READ], ns[READ], bytes[WRITE],
+	       ns[WRITE]);
+}
+
 static void crypt_status(struct dm_target *ti, status_type_t type,
 			 unsigned int status_flags, char *result, unsigned int maxlen)
 {
@@ -3456,7 +3582,7 @@ static void crypt_status(struct dm_target *ti, status_type_t type,
 
 	switch (type) {
 	case STATUSTYPE_INFO:
-		result[0] = '\0';
+		crypt_status_stats(cc, result, maxlen);
 		break;
 
 	case STATUSTYPE_TABLE:
@@ -3638,7 +3764,7 @@ static void crypt_io_hints(struct dm_target *ti, struct queue_limits *limits)
 
 static struct target_type crypt_target = {
 	.name   = "crypt",
-	.version = {1, 24, 0},
+	.version = {1, 25, 0},
 	.module = THIS_MODULE,
 	.ctr    = crypt_ctr,
 	.dtr    = crypt_dtr,
@@ -16,6 +16,7 @@
 #include <linux/sort.h>
 #include <linux/rbtree.h>
 #include <linux/delay.h>
+#include <linux/hrtimer.h>
 #include <linux/random.h>
 #include <linux/reboot.h>
 #include <crypto/hash.h>
@@ -160,6 +161,23 @@ struct alg_spec {
 	unsigned int key_size;
 };
 
+/*
+ * Performance counters, reported in the status line.
+ */
+struct dm_integrity_stats {
+	atomic64_t commits;
+	atomic64_t commit_sections;
+	atomic64_t commit_flushes;
+	atomic64_t commit_ns;
+	atomic64_t tag_blocks;
+	atomic64_t tag_ns;
+	atomic64_t bitmap_writes;
+	atomic64_t bitmap_write_bios;
+	atomic64_t bitmap_flushes;
+	unsigned int max_commit_sections;
+	unsigned int min_free_sectors;	/* locked with endio_wait.lock */
+};
+
 struct dm_integrity_c {
 	struct dm_dev *dev;
 	struct dm_dev *meta_dev;
@@ -259,6 +277,9 @@ struct dm_integrity_c {
 	struct timer_list autocommit_timer;
 	unsigned int autocommit_msec;
 
+	struct hrtimer commit_batch_timer;
+	unsigned int commit_batch_usec;
+
 	wait_queue_head_t copy_to_journal_wait;
 
 	struct completion crypto_backoff;
@@ -279,6 +300,8 @@ struct dm_integrity_c {
 
 	atomic64_t number_of_mismatches;
 
+	struct dm_integrity_stats stats;
+
 	struct notifier_block reboot_notifier;
 };
 
@@ -1567,17 +1590,39 @@ static void schedule_autocommit(struct dm_integrity_c *ic)
 		mod_timer(&ic->autocommit_timer, jiffies + ic->autocommit_jiffies);
 }
 
+static enum hrtimer_restart commit_batch_fn(struct hrtimer *t)
+{
+	struct dm_integrity_c *ic = container_of(t, struct dm_integrity_c, commit_batch_timer);
+
+	if (likely(!dm_integrity_failed(ic)))
+		queue_work(ic->commit_wq, &ic->commit_work);
+
+	return HRTIMER_NORESTART;
+}
+
 static void submit_flush_bio(struct dm_integrity_c *ic, struct dm_integrity_io *dio)
 {
 	struct bio *bio;
 	unsigned long flags;
+	bool batch;
 
 	spin_lock_irqsave(&ic->endio_wait.lock, flags);
 	bio = dm_bio_from_per_bio_data(dio, sizeof(struct dm_integrity_io));
 	bio_list_add(&ic->flush_bio_list, bio);
+	/*
+	 * With commit_batch_us, the flushes arriving within that time are
+	 * completed by a single commit, unless the journal has to be written
+	 * anyway.
+	 */
+	batch = ic->commit_batch_usec && ic->free_sectors > ic->free_sectors_threshold;
+	if (batch && !hrtimer_is_queued(&ic->commit_batch_timer))
+		hrtimer_start(&ic->commit_batch_timer,
+			      ns_to_ktime((u64)ic->commit_batch_usec * NSEC_PER_USEC),
+			      HRTIMER_MODE_REL);
 	spin_unlock_irqrestore(&ic->endio_wait.lock, flags);
 
-	queue_work(ic->commit_wq, &ic->commit_work);
+	if (!batch)
+		queue_work(ic->commit_wq, &ic->commit_work);
 }
 
 static void do_endio(struct dm_integrity_c *ic, struct bio *bio)
@@ -1646,6 +1691,12 @@ static void integrity_end_io(struct bio *bio)
 	dec_in_flight(dio);
 }
 
+/*
+ * The blocks are not hashed in batches with crypto_shash_finup_mb(): the
+ * messages only share the salt, each of them goes on with its own sector
+ * number before the data, so the data of a block isn't the whole tail of its
+ * message as the batched interface needs.
+ */
 static void integrity_sector_checksum(struct dm_integrity_c *ic, sector_t sector,
 				      const char *data, char *result)
 {
@@ -1716,6 +1767,8 @@ static void integrity_metadata(struct work_struct *w)
 		char checksums_onstack[max((size_t)HASH_MAX_DIGESTSIZE, MAX_TAG_SIZE)];
 		sector_t sector;
 		unsigned int sectors_to_process;
+		unsigned int tag_blocks;
+		u64 tag_ns;
 
 		if (unlikely(ic->mode == 'R'))
 			goto skip_io;
@@ -1761,22 +1814,28 @@ static void integrity_metadata(struct work_struct *w)
 
 		sector = dio->range.logical_sector;
 		sectors_to_process = dio->range.n_sectors;
+		tag_blocks = 0;
+		tag_ns = 0;
 
 		__bio_for_each_segment(bv, bio, iter, dio->bio_details.bi_iter) {
 			unsigned int pos;
 			char *mem, *checksums_ptr;
+			u64 start;
 
 again:
 			mem = bvec_kmap_local(&bv);
 			pos = 0;
 			checksums_ptr = checksums;
+			start = ktime_get_ns();
 			do {
 				integrity_sector_checksum(ic, sector, mem + pos, checksums_ptr);
 				checksums_ptr += ic->tag_size;
 				sectors_to_process -= ic->sectors_per_block;
 				pos += ic->sectors_per_block << SECTOR_SHIFT;
 				sector += ic->sectors_per_block;
+				tag_blocks++;
 			} while (pos < bv.bv_len && sectors_to_process && checksums != checksums_onstack);
+			tag_ns += ktime_get_ns() - start;
 			kunmap_local(mem);
 
 			r = dm_integrity_rw_tag(ic, checksums, &dio->metadata_block, &dio->metadata_offset,
@@ -1808,6 +1867,9 @@ static void integrity_metadata(struct work_struct *w)
 			}
 		}
 
+		atomic64_add(tag_blocks, &ic->stats.tag_blocks);
+		atomic64_add(tag_ns, &ic->stats.tag_ns);
+
 		if (likely(checksums != checksums_onstack))
 			kfree(checksums);
 	} else {
@@ -2137,6 +2199,8 @@ static void dm_integrity_map_continue(struct dm_integrity_io *dio, bool from_map
 			}
 			range_sectors = dio->range.n_sectors >> ic->sb->log2_sectors_per_block;
 			ic->free_sectors -= range_sectors;
+			if (ic->free_sectors < ic->stats.min_free_sectors)
+				ic->stats.min_free_sectors = ic->free_sectors;
 			journal_section = ic->free_section;
 			journal_entry = ic->free_section_entry;
 
@@ -2350,8 +2414,10 @@ static void integrity_commit(struct work_struct *w)
 	unsigned int commit_start, commit_sections;
 	unsigned int i, j, n;
 	struct bio *flushes;
+	u64 start;
 
 	del_timer(&ic->autocommit_timer);
+	hrtimer_try_to_cancel(&ic->commit_batch_timer);
 
 	spin_lock_irq(&ic->endio_wait.lock);
 	flushes = bio_list_get(&ic->flush_bio_list);
@@ -2370,6 +2436,7 @@ static void integrity_commit(struct work_struct *w)
 		goto release_flush_bios;
 
 	ic->wrote_to_journal = true;
+	start = ktime_get_ns();
 
 	i = commit_start;
 	for (n = 0; n < commit_sections; n++) {
@@ -2392,6 +2459,12 @@ static void integrity_commit(struct work_struct *w)
 
 	write_journal(ic, commit_start, commit_sections);
 
+	atomic64_inc(&ic->stats.commits);
+	atomic64_add(commit_sections, &ic->stats.commit_sections);
+	atomic64_add(ktime_get_ns() - start, &ic->stats.commit_ns);
+	if (commit_sections > ic->stats.max_commit_sections)
+		WRITE_ONCE(ic->stats.max_commit_sections, commit_sections);
+
 	spin_lock_irq(&ic->endio_wait.lock);
 	ic->uncommitted_section += commit_sections;
 	wraparound_section(ic, &ic->uncommitted_section);
@@ -2407,6 +2480,7 @@ static void integrity_commit(struct work_struct *w)
 		struct bio *next = flushes->bi_next;
 		flushes->bi_next = NULL;
 		do_endio(ic, flushes);
+		atomic64_inc(&ic->stats.commit_flushes);
 		flushes = next;
 	}
 }
@@ -2796,6 +2870,9 @@ static void bitmap_block_work(struct work_struct *w)
 			   bbs->idx * (BITMAP_BLOCK_SIZE >> SECTOR_SHIFT),
 			   BITMAP_BLOCK_SIZE >> SECTOR_SHIFT, NULL);
 
+	atomic64_inc(&ic->stats.bitmap_writes);
+	atomic64_add(bio_list_size(&waiting), &ic->stats.bitmap_write_bios);
+
 	while ((bio = bio_list_pop(&waiting))) {
 		struct dm_integrity_io *dio = dm_per_bio_data(bio, sizeof(struct dm_integrity_io));
 
@@ -2841,6 +2918,8 @@ static void bitmap_flush_work(struct work_struct *work)
 	rw_journal_sectors(ic, REQ_OP_WRITE | REQ_FUA | REQ_SYNC, 0,
 			   ic->n_bitmap_blocks * (BITMAP_BLOCK_SIZE >> SECTOR_SHIFT), NULL);
 
+	atomic64_inc(&ic->stats.bitmap_flushes);
+
 	spin_lock_irq(&ic->endio_wait.lock);
 	remove_range_unlocked(ic, &range);
 	while (unlikely((bio = bio_list_pop(&ic->synchronous_bios)) != NULL)) {
@@ -3043,6 +3122,7 @@ static void replay_journal(struct dm_integrity_c *ic)
 	ic->free_section = continue_section;
 	ic->free_section_entry = 0;
 	ic->free_sectors = ic->journal_entries;
+	ic->stats.min_free_sectors = ic->free_sectors;
 
 	ic->journal_tree_root = RB_ROOT;
 	for (i = 0; i < ic->journal_entries; i++)
@@ -3082,6 +3162,7 @@ static void dm_integrity_postsuspend(struct dm_target *ti)
 	WARN_ON(unregister_reboot_notifier(&ic->reboot_notifier));
 
 	del_timer_sync(&ic->autocommit_timer);
+	hrtimer_cancel(&ic->commit_batch_timer);
 
 	if (ic->recalc_wq)
 		drain_workqueue(ic->recalc_wq);
@@ -3260,6 +3341,26 @@ static void dm_integrity_status(struct dm_target *ti, status_type_t type,
 			DMEMIT(" %llu", le64_to_cpu(ic->sb->recalc_sector));
 		else
 			DMEMIT(" -");
+		/*
+		 * commits, committed sections, largest commit in sections,
+		 * flushes completed by commits, commit time in us,
+		 * free journal entries, fewest free journal entries,
+		 * blocks checksummed, checksum time in us,
+		 * bitmap block writes, bios waiting for them, bitmap flushes
+		 */
+		DMEMIT(" %llu %llu %u %llu %llu %u %u %llu %llu %llu %llu %llu",
+		       (unsigned long long)atomic64_read(&ic->stats.commits),
+		       (unsigned long long)atomic64_read(&ic->stats.commit_sections),
+		       READ_ONCE(ic->stats.max_commit_sections),
+		       (unsigned long long)atomic64_read(&ic->stats.commit_flushes),
+		       (unsigned long long)div_u64(atomic64_read(&ic->stats.commit_ns), NSEC_PER_USEC),
+		       READ_ONCE(ic->free_sectors),
+		       READ_ONCE(ic->stats.min_free_sectors),
+		       (unsigned long long)atomic64_read(&ic->stats.tag_blocks),
+		       (unsigned long long)div_u64(atomic64_read(&ic->stats.tag_ns), NSEC_PER_USEC),
+		       (unsigned long long)atomic64_read(&ic->stats.bitmap_writes),
+		       (unsigned long long)atomic64_read(&ic->stats.bitmap_write_bios),
+		       (unsigned long long)atomic64_read(&ic->stats.bitmap_flushes));
 		break;
 
 	case STATUSTYPE_TABLE: {
@@ -3282,6 +3383,7 @@ static void dm_integrity_status(struct dm_target *ti, status_type_t type,
 		arg_count += (ic->sb->flags & cpu_to_le32(SB_FLAG_FIXED_PADDING)) != 0;
 		arg_count += (ic->sb->flags & cpu_to_le32(SB_FLAG_FIXED_HMAC)) != 0;
 		arg_count += ic->legacy_recalculate;
+		arg_count += !!ic->commit_batch_usec;
 		DMEMIT("%s %llu %u %c %u", ic->dev->name, ic->start,
 		       ic->tag_size, ic->mode, arg_count);
 		if (ic->meta_dev)
@@ -3311,6 +3413,8 @@ static void dm_integrity_status(struct dm_target *ti, status_type_t type,
 			DMEMIT(" fix_hmac");
 		if (ic->legacy_recalculate)
 			DMEMIT(" legacy_recalculate");
+		if (ic->commit_batch_usec)
+			DMEMIT(" commit_batch_us:%u", ic->commit_batch_usec);
 
 #define EMIT_ALG(a, n)							\
 		do {							\
@@ -3954,6 +4058,7 @@ static int create_journal(struct dm_integrity_c *ic, char **error)
  *		buffer_sectors
  *		journal_watermark
  *		commit_time
+ *		commit_batch_us
  *		meta_device
  *		block_size
  *		sectors_per_bit
@@ -3971,7 +4076,7 @@ static int dm_integrity_ctr(struct dm_target *ti, unsigned int argc, char **argv
 	unsigned int extra_args;
 	struct dm_arg_set as;
 	static const struct dm_arg _args[] = {
-		{0, 18, "Invalid number of feature args"},
+		{0, 19, "Invalid number of feature args"},
 	};
 	unsigned int journal_sectors, interleave_sectors, buffer_sectors, journal_watermark, sync_msec;
 	bool should_write_sb;
@@ -4070,6 +4175,8 @@ static int dm_integrity_ctr(struct dm_target *ti, unsigned int argc, char **argv
 			journal_watermark = val;
 		else if (sscanf(opt_string, "commit_time:%u%c", &val, &dummy) == 1)
 			sync_msec = val;
+		else if (sscanf(opt_string, "commit_batch_us:%u%c", &val, &dummy) == 1)
+			ic->commit_batch_usec = val;
 		else if (!strncmp(opt_string, "meta_device:", strlen("meta_device:"))) {
 			if (ic->meta_dev) {
 				dm_put_device(ti, ic->meta_dev);
@@ -4192,6 +4299,8 @@ static int dm_integrity_ctr(struct dm_target *ti, unsigned int argc, char **argv
 	ic->autocommit_jiffies = msecs_to_jiffies(sync_msec);
 	ic->autocommit_msec = sync_msec;
 	timer_setup(&ic->autocommit_timer, autocommit_fn, 0);
+	hrtimer_init(&ic->commit_batch_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	ic->commit_batch_timer.function = commit_batch_fn;
 
 	ic->io = dm_io_client_create();
 	if (IS_ERR(ic->io)) {
@@ -4619,9 +4728,44 @@ static void dm_integrity_dtr(struct dm_target *ti)
 	dm_audit_log_dtr(DM_MSG_PREFIX, ti, 1);
 }
 
+static void dm_integrity_clear_stats(struct dm_integrity_c *ic)
+{
+	struct dm_integrity_stats *stats = &ic->stats;
+
+	atomic64_set(&stats->commits, 0);
+	atomic64_set(&stats->commit_sections, 0);
+	atomic64_set(&stats->commit_flushes, 0);
+	atomic64_set(&stats->commit_ns, 0);
+	atomic64_set(&stats->tag_blocks, 0);
+	atomic64_set(&stats->tag_ns, 0);
+	atomic64_set(&stats->bitmap_writes, 0);
+	atomic64_set(&stats->bitmap_write_bios, 0);
+	atomic64_set(&stats->bitmap_flushes, 0);
+	WRITE_ONCE(stats->max_commit_sections, 0);
+
+	spin_lock_irq(&ic->endio_wait.lock);
+	stats->min_free_sectors = ic->free_sectors;
+	spin_unlock_irq(&ic->endio_wait.lock);
+}
+
+static int dm_integrity_message(struct dm_target *ti, unsigned int argc, char **argv,
+				char *result, unsigned int maxlen)
+{
+	struct dm_integrity_c *ic = ti->private;
+
+	if (argc == 1 && !strcasecmp(argv[0], "clear_stats")) {
+		dm_integrity_clear_stats(ic);
+		return 0;
+	}
+
+	DMERR("unrecognised message received: %s", argv[0]);
+
+	return -EINVAL;
+}
+
 static struct target_type integrity_target = {
 	.name			= "integrity",
-	.version		= {1, 10, 0},
+	.version		= {1, 11, 0},
 	.module			= THIS_MODULE,
 	.features		= DM_TARGET_SINGLETON | DM_TARGET_INTEGRITY,
 	.ctr			= dm_integrity_ctr,
@@ -4630,6 +4774,7 @@ static struct target_type integrity_target = {
 	.postsuspend		= dm_integrity_postsuspend,
 	.resume			= dm_integrity_resume,
 	.status			= dm_integrity_status,
+	.message		= dm_integrity_message,
 	.iterate_devices	= dm_integrity_iterate_devices,
 	.io_hints		= dm_integrity_io_hints,
 };
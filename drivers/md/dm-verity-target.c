@@ -493,6 +493,127 @@ static inline void verity_bv_skip_block(struct dm_verity *v,
 	bio_advance_iter(bio, iter, 1 << v->data_dev_block_bits);
 }
 
+/*
+ * A data block whose hash is computed along with others by
+ * crypto_shash_finup_mb().
+ */
+struct verity_pending_block {
+	sector_t block;
+	const u8 *data;
+	struct bvec_iter start;
+	u8 want_digest[HASH_MAX_DIGESTSIZE];
+	u8 real_digest[HASH_MAX_DIGESTSIZE];
+};
+
+/*
+ * Returns the data of the next data block if it can be hashed along with
+ * others, i.e. the whole block sits in one low memory bio_vec.
+ */
+static const u8 *verity_mb_block_data(struct dm_verity *v,
+				      struct dm_verity_io *io,
+				      struct bvec_iter *iter)
+{
+	struct bio *bio = dm_bio_from_per_bio_data(io, v->ti->per_io_data_size);
+	struct bio_vec bv = bio_iter_iovec(bio, *iter);
+
+	/* version 0 appends the salt to the data */
+	if (!v->shash_tfm || (!v->version && v->salt_size))
+		return NULL;
+
+	if (bv.bv_len < 1 << v->data_dev_block_bits ||
+	    PageHighMem(bv.bv_page))
+		return NULL;
+
+	return page_address(bv.bv_page) + bv.bv_offset;
+}
+
+static int verity_handle_data_hash_mismatch(struct dm_verity_io *io,
+					    sector_t cur_block,
+					    struct bvec_iter *start)
+{
+	struct dm_verity *v = io->v;
+	struct bio *bio = dm_bio_from_per_bio_data(io, v->ti->per_io_data_size);
+
+	if (static_branch_unlikely(&use_tasklet_enabled) && io->in_tasklet) {
+		/*
+		 * Error handling code (FEC included) cannot be run in a
+		 * tasklet since it may sleep, so fallback to work-queue.
+		 */
+		return -EAGAIN;
+	}
+#if defined(CONFIG_DM_VERITY_FEC)
+	if (verity_fec_decode(v, io, DM_VERITY_BLOCK_TYPE_DATA,
+			      cur_block, NULL, start) == 0)
+		return 0;
+#endif
+	if (bio->bi_status) {
+		/*
+		 * Error correction failed; Just return error
+		 */
+		return -EIO;
+	}
+	if (verity_handle_err(v, DM_VERITY_BLOCK_TYPE_DATA, cur_block))
+		return -EIO;
+
+	return 0;
+}
+
+/*
+ * Hash the pending data blocks in one go and check them.
+ */
+static int verity_verify_pending_blocks(struct dm_verity_io *io,
+					struct verity_pending_block *pending,
+					unsigned int nr_pending)
+{
+	struct dm_verity *v = io->v;
+	SHASH_DESC_ON_STACK(desc, v->shash_tfm);
+	const u8 *data[HASH_MAX_MB_MSGS];
+	u8 *outs[HASH_MAX_MB_MSGS];
+	unsigned int i;
+	int r;
+
+	for (i = 0; i < nr_pending; i++) {
+		data[i] = pending[i].data;
+		outs[i] = pending[i].real_digest;
+	}
+
+	desc->tfm = v->shash_tfm;
+	r = crypto_shash_init(desc);
+	if (likely(!r) && v->salt_size)
+		r = crypto_shash_update(desc, v->salt, v->salt_size);
+	if (likely(!r))
+		r = crypto_shash_finup_mb(desc, data,
+					  1 << v->data_dev_block_bits, outs,
+					  nr_pending);
+	shash_desc_zero(desc);
+	if (unlikely(r < 0)) {
+		DMERR("crypto_shash_finup_mb failed: %d", r);
+		return r;
+	}
+
+	for (i = 0; i < nr_pending; i++) {
+		struct verity_pending_block *p = &pending[i];
+
+		if (likely(memcmp(p->real_digest, p->want_digest,
+				  v->digest_size) == 0)) {
+			if (v->validated_blocks)
+				set_bit(p->block, v->validated_blocks);
+			continue;
+		}
+
+		/* the error handling works on the digests of the io */
+		memcpy(verity_io_want_digest(v, io), p->want_digest,
+		       v->digest_size);
+		memcpy(verity_io_real_digest(v, io), p->real_digest,
+		       v->digest_size);
+		r = verity_handle_data_hash_mismatch(io, p->block, &p->start);
+		if (unlikely(r < 0))
+			return r;
+	}
+
+	return 0;
+}
+
 /*
  * Verify one "dm_verity_io" structure.
  */
@@ -500,13 +621,13 @@ static int verity_verify_io(struct dm_verity_io *io)
 {
 	bool is_zero;
 	struct dm_verity *v = io->v;
-#if defined(CONFIG_DM_VERITY_FEC)
 	struct bvec_iter start;
-#endif
 	struct bvec_iter iter_copy;
 	struct bvec_iter *iter;
 	struct crypto_wait wait;
 	struct bio *bio = dm_bio_from_per_bio_data(io, v->ti->per_io_data_size);
+	struct verity_pending_block pending[HASH_MAX_MB_MSGS];
+	unsigned int nr_pending = 0;
 	unsigned int b;
 
 	if (static_branch_unlikely(&use_tasklet_enabled) && io->in_tasklet) {
@@ -523,6 +644,8 @@ static int verity_verify_io(struct dm_verity_io *io)
 		int r;
 		sector_t cur_block = io->block + b;
 		struct ahash_request *req = verity_io_hash_req(v, io);
+		struct verity_pending_block *p = &pending[nr_pending];
+		const u8 *data;
 
 		if (v->validated_blocks && bio->bi_status == BLK_STS_OK &&
 		    likely(test_bit(cur_block, v->validated_blocks))) {
@@ -530,8 +653,7 @@ static int verity_verify_io(struct dm_verity_io *io)
 			continue;
 		}
 
-		r = verity_hash_for_block(v, io, cur_block,
-					  verity_io_want_digest(v, io),
+		r = verity_hash_for_block(v, io, cur_block, p->want_digest,
 					  &is_zero);
 		if (unlikely(r < 0))
 			return r;
@@ -549,14 +671,33 @@ static int verity_verify_io(struct dm_verity_io *io)
 			continue;
 		}
 
+		data = verity_mb_block_data(v, io, iter);
+		if (data) {
+			p->block = cur_block;
+			p->data = data;
+			p->start = *iter;
+			verity_bv_skip_block(v, io, iter);
+
+			nr_pending++;
+			if (nr_pending < crypto_shash_mb_max_msgs(v->shash_tfm))
+				continue;
+
+			r = verity_verify_pending_blocks(io, pending,
+							 nr_pending);
+			nr_pending = 0;
+			if (unlikely(r < 0))
+				return r;
+			continue;
+		}
+
+		memcpy(verity_io_want_digest(v, io), p->want_digest,
+		       v->digest_size);
+
 		r = verity_hash_init(v, req, &wait, !io->in_tasklet);
 		if (unlikely(r < 0))
 			return r;
 
-#if defined(CONFIG_DM_VERITY_FEC)
-		if (verity_fec_is_enabled(v))
-			start = *iter;
-#endif
+		start = *iter;
 		r = verity_for_io_block(v, io, iter, &wait);
 		if (unlikely(r < 0))
 			return r;
@@ -571,31 +712,16 @@ static int verity_verify_io(struct dm_verity_io *io)
 			if (v->validated_blocks)
 				set_bit(cur_block, v->validated_blocks);
 			continue;
-		} else if (static_branch_unlikely(&use_tasklet_enabled) &&
-			   io->in_tasklet) {
-			/*
-			 * Error handling code (FEC included) cannot be run in a
-			 * tasklet since it may sleep, so fallback to work-queue.
-			 */
-			return -EAGAIN;
-#if defined(CONFIG_DM_VERITY_FEC)
-		} else if (verity_fec_decode(v, io, DM_VERITY_BLOCK_TYPE_DATA,
-					     cur_block, NULL, &start) == 0) {
-			continue;
-#endif
-		} else {
-			if (bio->bi_status) {
-				/*
-				 * Error correction failed; Just return error
-				 */
-				return -EIO;
-			}
-			if (verity_handle_err(v, DM_VERITY_BLOCK_TYPE_DATA,
-					      cur_block))
-				return -EIO;
 		}
+
+		r = verity_handle_data_hash_mismatch(io, cur_block, &start);
+		if (unlikely(r < 0))
+			return r;
 	}
 
+	if (nr_pending)
+		return verity_verify_pending_blocks(io, pending, nr_pending);
+
 	return 0;
 }
 
@@ -958,6 +1084,9 @@ static void verity_dtr(struct dm_target *ti)
 	kfree(v->root_digest);
 	kfree(v->zero_digest);
 
+	if (v->shash_tfm)
+		crypto_free_shash(v->shash_tfm);
+
 	if (v->tfm)
 		crypto_free_ahash(v->tfm);
 
@@ -1163,6 +1292,7 @@ static int verity_parse_opt_args(struct dm_arg_set *as, struct dm_verity *v,
 static int verity_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 {
 	struct dm_verity *v;
+	struct crypto_shash *shash_tfm;
 	struct dm_verity_sig_opts verify_args = {0};
 	struct dm_arg_set as;
 	unsigned int num;
@@ -1295,6 +1425,20 @@ static int verity_ctr(struct dm_target *ti, unsigned int argc, char **argv)
 	DMINFO("%s using implementation \"%s\"", v->alg_name,
 	       crypto_hash_alg_common(v->tfm)->base.cra_driver_name);
 
+	/*
+	 * When the implementation is a shash that can hash several messages
+	 * at once, use it directly to hash the data blocks of an io together.
+	 */
+	shash_tfm = crypto_alloc_shash(v->alg_name, 0, 0);
+	if (!IS_ERR(shash_tfm)) {
+		if (crypto_shash_mb_max_msgs(shash_tfm) > 1 &&
+		    !strcmp(crypto_shash_driver_name(shash_tfm),
+			    crypto_ahash_driver_name(v->tfm)))
+			v->shash_tfm = shash_tfm;
+		else
+			crypto_free_shash(shash_tfm);
+	}
+
 	v->digest_size = crypto_ahash_digestsize(v->tfm);
 	if ((1 << v->hash_dev_block_bits) < v->digest_size * 2) {
 		ti->error = "Digest size too big";
@@ -14,10 +14,24 @@
 #include <linux/mfd/altera-a10sr.h>
 #include <linux/mfd/core.h>
 #include <linux/init.h>
+#include <linux/jiffies.h>
 #include <linux/module.h>
 #include <linux/of.h>
+#include <linux/slab.h>
 #include <linux/spi/spi.h>
 
+static unsigned int status_cache_ms = 20;
+module_param(status_cache_ms, uint, 0644);
+MODULE_PARM_DESC(status_cache_ms,
+		 "Time the status registers are served from a snapshot (0 = off)");
+
+static const u8 altr_a10sr_status_regs[ALTR_A10SR_STATUS_REGS] = {
+	ALTR_A10SR_PBDSW_REG,
+	ALTR_A10SR_PWR_GOOD1_REG,
+	ALTR_A10SR_PWR_GOOD2_REG,
+	ALTR_A10SR_PWR_GOOD3_REG,
+};
+
 static const struct mfd_cell altr_a10sr_subdev_info[] = {
 	{
 		.name = "altr_a10sr_hwmon",
@@ -86,6 +100,8 @@ static bool altr_a10sr_reg_volatile(struct device *dev, unsigned int reg)
 	case ALTR_A10SR_PWR_GOOD2_REG:
 	case ALTR_A10SR_PWR_GOOD3_REG:
 	case ALTR_A10SR_HPS_RST_REG:
+	case ALTR_A10SR_SFPA_REG:
+	case ALTR_A10SR_SFPB_REG:
 	case ALTR_A10SR_I2C_M_REG:
 	case ALTR_A10SR_WARM_RST_REG:
 	case ALTR_A10SR_WR_KEY_REG:
@@ -96,11 +112,15 @@ static bool altr_a10sr_reg_volatile(struct device *dev, unsigned int reg)
 	}
 }
 
+/*
+ * The version, the LEDs and the power enables and resets only change when
+ * written: they are read from the chip once and then served from the cache.
+ */
 static const struct regmap_config altr_a10sr_regmap_config = {
 	.reg_bits = 8,
 	.val_bits = 8,
 
-	.cache_type = REGCACHE_NONE,
+	.cache_type = REGCACHE_RBTREE,
 
 	.use_single_read = true,
 	.use_single_write = true,
@@ -114,6 +134,78 @@ static const struct regmap_config altr_a10sr_regmap_config = {
 
 };
 
+static int altr_a10sr_status_refresh(struct altr_a10sr *a10sr)
+{
+	struct spi_transfer xfer[2 * ALTR_A10SR_STATUS_REGS] = { };
+	struct spi_message msg;
+	u8 *buf = a10sr->status_buf;
+	int i, ret;
+
+	/* One message of the usual command and response pairs */
+	spi_message_init(&msg);
+	for (i = 0; i < ALTR_A10SR_STATUS_REGS; i++) {
+		buf[2 * i] = altr_a10sr_status_regs[i] |
+			     altr_a10sr_regmap_config.read_flag_mask;
+
+		xfer[2 * i].tx_buf = &buf[2 * i];
+		xfer[2 * i].len = 1;
+		xfer[2 * i + 1].rx_buf = &buf[2 * i + 1];
+		xfer[2 * i + 1].len = 1;
+		xfer[2 * i + 1].cs_change = i < ALTR_A10SR_STATUS_REGS - 1;
+
+		spi_message_add_tail(&xfer[2 * i], &msg);
+		spi_message_add_tail(&xfer[2 * i + 1], &msg);
+	}
+
+	ret = spi_sync(a10sr->spi, &msg);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < ALTR_A10SR_STATUS_REGS; i++)
+		a10sr->status[i] = buf[2 * i + 1];
+	a10sr->status_time = jiffies;
+	a10sr->status_valid = true;
+
+	return 0;
+}
+
+/**
+ * altr_a10sr_status_read - Read a register, coalescing the status polls
+ * @a10sr: the MAX5 device
+ * @reg: the register to read
+ * @val: the value read
+ *
+ * The push buttons, DIP switches and power good registers are all read in
+ * a single SPI message, then served from that snapshot for status_cache_ms.
+ * Other registers are read through the regmap.
+ *
+ * Return: 0 on success, a negative error code otherwise.
+ */
+int altr_a10sr_status_read(struct altr_a10sr *a10sr, unsigned int reg,
+			   unsigned int *val)
+{
+	unsigned int ms = READ_ONCE(status_cache_ms);
+	int i, ret = 0;
+
+	for (i = 0; i < ALTR_A10SR_STATUS_REGS; i++)
+		if (altr_a10sr_status_regs[i] == reg)
+			break;
+
+	if (i == ALTR_A10SR_STATUS_REGS || !ms)
+		return regmap_read(a10sr->regmap, reg, val);
+
+	mutex_lock(&a10sr->status_lock);
+	if (!a10sr->status_valid ||
+	    time_after(jiffies, a10sr->status_time + msecs_to_jiffies(ms)))
+		ret = altr_a10sr_status_refresh(a10sr);
+	if (!ret)
+		*val = a10sr->status[i];
+	mutex_unlock(&a10sr->status_lock);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(altr_a10sr_status_read);
+
 static int altr_a10sr_spi_probe(struct spi_device *spi)
 {
 	int ret;
@@ -129,6 +221,13 @@ static int altr_a10sr_spi_probe(struct spi_device *spi)
 	spi_setup(spi);
 
 	a10sr->dev = &spi->dev;
+	a10sr->spi = spi;
+	mutex_init(&a10sr->status_lock);
+
+	a10sr->status_buf = devm_kzalloc(&spi->dev, 2 * ALTR_A10SR_STATUS_REGS,
+					 GFP_KERNEL);
+	if (!a10sr->status_buf)
+		return -ENOMEM;
 
 	spi_set_drvdata(spi, a10sr);
 
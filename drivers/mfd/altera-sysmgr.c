@@ -75,6 +75,56 @@ static int s10_protected_reg_read(void *base,
 	return (int)result.a0;
 }
 
+/**
+ * s10_protected_reg_update_bits
+ * Read-modify-write a protected SMC register in a single call.
+ * @base: Base address of System Manager.
+ * @reg:  Address offset of register
+ * @mask: Bits to update
+ * @val:  New value of the bits
+ * Return: INTEL_SIP_SMC_STATUS_OK (0) on success
+ *	   INTEL_SIP_SMC_REG_ERROR on error
+ *
+ * Falls back to a read followed by a write on firmware without
+ * INTEL_SIP_SMC_REG_UPDATE.
+ */
+static int s10_protected_reg_update_bits(void *base, unsigned int reg,
+					 unsigned int mask, unsigned int val)
+{
+	struct arm_smccc_res result;
+	unsigned long sysmgr_base = (unsigned long)base;
+	unsigned int orig;
+	int ret;
+
+	arm_smccc_smc(INTEL_SIP_SMC_REG_UPDATE, sysmgr_base + reg,
+		      mask, val, 0, 0, 0, 0, &result);
+	if (result.a0 != INTEL_SIP_SMC_RETURN_UNKNOWN_FUNCTION)
+		return (int)result.a0;
+
+	ret = s10_protected_reg_read(base, reg, &orig);
+	if (ret)
+		return ret;
+
+	return s10_protected_reg_write(base, reg, (orig & ~mask) | (val & mask));
+}
+
+/*
+ * Only the registers written by Linux alone are cached, so that reading them
+ * back before an update doesn't cost a trip to the secure world: the EMAC
+ * control and the FPGA interface enable registers.  The ECC status, the
+ * write-one-to-set/clear masks and the boot scratch registers shared with
+ * the firmware are always accessed through the SMC.
+ */
+static const struct regmap_range s10_sysmgr_cached_ranges[] = {
+	regmap_reg_range(0x44, 0x4c),
+	regmap_reg_range(0x68, 0x70),
+};
+
+static const struct regmap_access_table s10_sysmgr_volatile_table = {
+	.no_ranges = s10_sysmgr_cached_ranges,
+	.n_no_ranges = ARRAY_SIZE(s10_sysmgr_cached_ranges),
+};
+
 static struct regmap_config altr_sysmgr_regmap_cfg = {
 	.name = "altr_sysmgr",
 	.reg_bits = 32,
@@ -143,6 +193,9 @@ static int sysmgr_probe(struct platform_device *pdev)
 	if (of_device_is_compatible(np, "altr,sys-mgr-s10")) {
 		sysmgr_config.reg_read = s10_protected_reg_read;
 		sysmgr_config.reg_write = s10_protected_reg_write;
+		sysmgr_config.reg_update_bits = s10_protected_reg_update_bits;
+		sysmgr_config.volatile_table = &s10_sysmgr_volatile_table;
+		sysmgr_config.cache_type = REGCACHE_RBTREE;
 
 		/* Need physical address for SMCC call */
 		regmap = devm_regmap_init(dev, NULL,
@@ -15,5 +15,6 @@
 
 u32 altera_shrink(u8 *in, u32 in_length, u8 *out, u32 out_length, s32 version);
 int netup_jtag_io_lpt(void *device, int tms, int tdi, int read_tdo);
+void netup_jtag_shift_lpt(void *device, u32 count, const u8 *tdi, u8 *tdo);
 
 #endif /* ALTERA_EXPRT_H */
@@ -387,6 +387,32 @@ int altera_wait_msecs(struct altera_state *astate,
 	return status;
 }
 
+/*
+ * Copies count bits from src, starting at bit src_index, to dst, starting
+ * at bit dst_index. Whole bytes are copied at once when both ends are byte
+ * aligned, which is the common case of the preamble-less scans.
+ */
+static void altera_copy_bits(u8 *dst, u32 dst_index,
+				const u8 *src, u32 src_index, u32 count)
+{
+	u32 i, j, end;
+
+	if (!((dst_index | src_index) & 7) && count >= 8) {
+		memcpy(&dst[dst_index >> 3], &src[src_index >> 3], count >> 3);
+		dst_index += count & ~7;
+		src_index += count & ~7;
+		count &= 7;
+	}
+
+	end = dst_index + count;
+	for (i = dst_index, j = src_index; i < end; ++i, ++j) {
+		if (src[j >> 3] & (1 << (j & 7)))
+			dst[i >> 3] |= (1 << (i & 7));
+		else
+			dst[i >> 3] &= ~(u32)(1 << (i & 7));
+	}
+}
+
 static void altera_concatenate_data(u8 *buffer,
 				u8 *preamble_data,
 				u32 preamble_count,
@@ -400,34 +426,45 @@ static void altera_concatenate_data(u8 *buffer,
  * into one buffer for IR or DR scans.
  */
 {
-	u32 i, j, k;
+	altera_copy_bits(buffer, 0, preamble_data, 0, preamble_count);
+	altera_copy_bits(buffer, preamble_count, target_data, start_index,
+			 target_count);
+	altera_copy_bits(buffer, preamble_count + target_count,
+			 postamble_data, 0, postamble_count);
+}
 
-	for (i = 0L; i < preamble_count; ++i) {
-		if (preamble_data[i >> 3L] & (1L << (i & 7L)))
-			buffer[i >> 3L] |= (1L << (i & 7L));
-		else
-			buffer[i >> 3L] &= ~(u32)(1L << (i & 7L));
+/*
+ * Clocks count bits of tdi through the SHIFT-DR or SHIFT-IR state, raising
+ * TMS with the last one, and captures TDO into tdo unless it is NULL. tdo
+ * may be tdi, each byte is only written once all of its bits are shifted.
+ */
+static void altera_jtag_shift(struct altera_state *astate, u32 count,
+				const u8 *tdi, u8 *tdo)
+{
+	u32 i;
+	u8 in = 0, out = 0, bit;
+	int tdo_bit;
 
+	if (astate->jtag_shift) {
+		astate->jtag_shift(astate->config->dev, count, tdi, tdo);
+		return;
 	}
 
-	j = start_index;
-	k = preamble_count + target_count;
-	for (; i < k; ++i, ++j) {
-		if (target_data[j >> 3L] & (1L << (j & 7L)))
-			buffer[i >> 3L] |= (1L << (i & 7L));
-		else
-			buffer[i >> 3L] &= ~(u32)(1L << (i & 7L));
-
-	}
+	for (i = 0; i < count; i++) {
+		bit = 1 << (i & 7);
+		if (bit == 1) {
+			in = tdi[i >> 3];
+			out = tdo ? tdo[i >> 3] : 0;
+		}
 
-	j = 0L;
-	k = preamble_count + target_count + postamble_count;
-	for (; i < k; ++i, ++j) {
-		if (postamble_data[j >> 3L] & (1L << (j & 7L)))
-			buffer[i >> 3L] |= (1L << (i & 7L));
+		tdo_bit = alt_jtag_io((i == count - 1), in & bit, (tdo != NULL));
+		if (tdo_bit)
+			out |= bit;
 		else
-			buffer[i >> 3L] &= ~(u32)(1L << (i & 7L));
+			out &= ~bit;
 
+		if (tdo && (bit == 0x80 || i == count - 1))
+			tdo[i >> 3] = out;
 	}
 }
 
@@ -437,8 +474,6 @@ static int alt_jtag_drscan(struct altera_state *astate,
 			u8 *tdi,
 			u8 *tdo)
 {
-	int i = 0;
-	int tdo_bit = 0;
 	int status = 1;
 
 	/* First go to DRSHIFT state */
@@ -471,20 +506,7 @@ static int alt_jtag_drscan(struct altera_state *astate,
 
 	if (status) {
 		/* loop in the SHIFT-DR state */
-		for (i = 0; i < count; i++) {
-			tdo_bit = alt_jtag_io(
-					(i == count - 1),
-					tdi[i >> 3] & (1 << (i & 7)),
-					(tdo != NULL));
-
-			if (tdo != NULL) {
-				if (tdo_bit)
-					tdo[i >> 3] |= (1 << (i & 7));
-				else
-					tdo[i >> 3] &= ~(u32)(1 << (i & 7));
-
-			}
-		}
+		altera_jtag_shift(astate, count, tdi, tdo);
 
 		alt_jtag_io(0, 0, 0);	/* DRPAUSE */
 	}
@@ -498,8 +520,6 @@ static int alt_jtag_irscan(struct altera_state *astate,
 		    u8 *tdi,
 		    u8 *tdo)
 {
-	int i = 0;
-	int tdo_bit = 0;
 	int status = 1;
 
 	/* First go to IRSHIFT state */
@@ -535,19 +555,7 @@ static int alt_jtag_irscan(struct altera_state *astate,
 
 	if (status) {
 		/* loop in the SHIFT-IR state */
-		for (i = 0; i < count; i++) {
-			tdo_bit = alt_jtag_io(
-				      (i == count - 1),
-				      tdi[i >> 3] & (1 << (i & 7)),
-				      (tdo != NULL));
-			if (tdo != NULL) {
-				if (tdo_bit)
-					tdo[i >> 3] |= (1 << (i & 7));
-				else
-					tdo[i >> 3] &= ~(u32)(1 << (i & 7));
-
-			}
-		}
+		altera_jtag_shift(astate, count, tdi, tdo);
 
 		alt_jtag_io(0, 0, 0);	/* IRPAUSE */
 	}
@@ -565,19 +573,8 @@ static void altera_extract_target_data(u8 *buffer,
  * preamble and postamble data.
  */
 {
-	u32 i;
-	u32 j;
-	u32 k;
-
-	j = preamble_count;
-	k = start_index + target_count;
-	for (i = start_index; i < k; ++i, ++j) {
-		if (buffer[j >> 3] & (1 << (j & 7)))
-			target_data[i >> 3] |= (1 << (i & 7));
-		else
-			target_data[i >> 3] &= ~(u32)(1 << (i & 7));
-
-	}
+	altera_copy_bits(target_data, start_index, buffer, preamble_count,
+			 target_count);
 }
 
 int altera_irscan(struct altera_state *astate,
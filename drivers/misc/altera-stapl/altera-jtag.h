@@ -60,8 +60,17 @@ struct altera_jtag {
 #define ALTERA_STACK_SIZE 128
 #define ALTERA_MESSAGE_LENGTH 1024
 
+/*
+ * Optional fast path of a JTAG adapter: clocks count bits of tdi, LSB of
+ * tdi[0] first, through a SHIFT state and raises TMS with the last one.
+ * TDO is captured into tdo unless it is NULL; tdo may be tdi.
+ */
+typedef void (*altera_jtag_shift_t)(void *dev, u32 count, const u8 *tdi,
+				    u8 *tdo);
+
 struct altera_state {
 	struct altera_config	*config;
+	altera_jtag_shift_t	jtag_shift;
 	struct altera_jtag	js;
 	char			msg_buff[ALTERA_MESSAGE_LENGTH + 1];
 	long			stack[ALTERA_STACK_SIZE];
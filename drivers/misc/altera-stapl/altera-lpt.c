@@ -27,10 +27,8 @@ static int byteblaster_read(int port)
 	return data & 0xff;
 };
 
-int netup_jtag_io_lpt(void *device, int tms, int tdi, int read_tdo)
+static void byteblaster_init(void)
 {
-	int data = 0;
-	int tdo = 0;
 	int initial_lpt_ctrl = 0;
 
 	if (!lpt_hardware_initialized) {
@@ -38,6 +36,14 @@ int netup_jtag_io_lpt(void *device, int tms, int tdi, int read_tdo)
 		byteblaster_write(2, (initial_lpt_ctrl | 0x02) & 0xdf);
 		lpt_hardware_initialized = 1;
 	}
+}
+
+int netup_jtag_io_lpt(void *device, int tms, int tdi, int read_tdo)
+{
+	int data = 0;
+	int tdo = 0;
+
+	byteblaster_init();
 
 	data = ((tdi ? 0x40 : 0) | (tms ? 0x02 : 0));
 
@@ -54,3 +60,44 @@ int netup_jtag_io_lpt(void *device, int tms, int tdi, int read_tdo)
 
 	return tdo;
 }
+
+/*
+ * Shifts a whole scan in one go. The write presenting the next bit with TCK
+ * low also makes the falling edge of the previous one, which saves a port
+ * write, the slowest part of the transfer, on every bit.
+ */
+void netup_jtag_shift_lpt(void *device, u32 count, const u8 *tdi, u8 *tdo)
+{
+	int data = 0;
+	u32 i;
+	u8 in = 0, out = 0, bit;
+
+	byteblaster_init();
+
+	for (i = 0; i < count; i++) {
+		bit = 1 << (i & 7);
+		if (bit == 1) {
+			in = tdi[i >> 3];
+			out = tdo ? tdo[i >> 3] : 0;
+		}
+
+		data = (((in & bit) ? 0x40 : 0) | ((i == count - 1) ? 0x02 : 0));
+
+		byteblaster_write(0, data);
+
+		if (tdo) {
+			if (byteblaster_read(1) & 0x80)
+				out &= ~bit;
+			else
+				out |= bit;
+
+			if (bit == 0x80 || i == count - 1)
+				tdo[i >> 3] = out;
+		}
+
+		byteblaster_write(0, data | 0x01);
+	}
+
+	if (count)
+		byteblaster_write(0, data);
+}
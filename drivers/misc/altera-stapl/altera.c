@@ -2410,6 +2410,8 @@ int altera_init(struct altera_config *config, const struct firmware *fw)
 		dprintk("%s: using byteblaster!\n", __func__);
 		astate->config->jtag_io = netup_jtag_io_lpt;
 	}
+	if (astate->config->jtag_io == netup_jtag_io_lpt)
+		astate->jtag_shift = netup_jtag_shift_lpt;
 
 	altera_check_crc((u8 *)fw->data, fw->size);
 
@@ -18,12 +18,32 @@
 #include <linux/module.h>
 #include <linux/device.h>
 #include <linux/platform_device.h>
+#include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/irq.h>
 #include <linux/of.h>
 #include <linux/altera_hwmutex.h>
 
 #define DRV_NAME	"altera_hwmutex"
 
+/*
+ * A contended mutex is usually held by a Nios II or another HPS agent for a
+ * short critical section, so altera_mutex_lock() first spins for spin_us.
+ * It then sleeps between attempts, with an exponential backoff bounded by
+ * max_backoff_us.  Sleepers are woken early by local unlocks, and by the
+ * optional edge triggered interrupt the fabric may raise when the other
+ * agents unlock.
+ */
+#define MUTEX_MIN_BACKOFF_US		10
+
+static unsigned int spin_us = 10;
+module_param(spin_us, uint, 0644);
+MODULE_PARM_DESC(spin_us, "Time spent spinning on a contended mutex (us)");
+
+static unsigned int max_backoff_us = 1000;
+module_param(max_backoff_us, uint, 0644);
+MODULE_PARM_DESC(max_backoff_us,
+		 "Longest sleep between two attempts to lock a mutex (us)");
 
 static DEFINE_SPINLOCK(list_lock);	/* protect mutex_list */
 static LIST_HEAD(mutex_list);
@@ -89,7 +109,39 @@ int altera_mutex_free(struct altera_mutex *mutex)
 }
 EXPORT_SYMBOL(altera_mutex_free);
 
-static int __mutex_trylock(struct altera_mutex *mutex, u16 owner, u16 value)
+/* Called with mutex->lock held, once the mutex is ours. */
+static void altera_mutex_account_lock(struct altera_mutex *mutex,
+				      ktime_t start)
+{
+	struct altera_mutex_stats *stats = &mutex->stats;
+	u64 wait;
+
+	mutex->locked_at = ktime_get();
+	wait = ktime_to_ns(ktime_sub(mutex->locked_at, start));
+
+	stats->acquired++;
+	stats->wait_ns += wait;
+	stats->wait_max_ns = max(stats->wait_max_ns, wait);
+}
+
+/* Called with mutex->lock held, once the mutex is released. */
+static void altera_mutex_account_unlock(struct altera_mutex *mutex)
+{
+	struct altera_mutex_stats *stats = &mutex->stats;
+	u64 hold;
+
+	if (!mutex->locked_at)
+		return;
+
+	hold = ktime_to_ns(ktime_sub(ktime_get(), mutex->locked_at));
+	mutex->locked_at = 0;
+
+	stats->hold_ns += hold;
+	stats->hold_max_ns = max(stats->hold_max_ns, hold);
+}
+
+static int __mutex_trylock(struct altera_mutex *mutex, u16 owner, u16 value,
+			   ktime_t start)
 {
 	u32 read;
 	int ret = 0;
@@ -100,11 +152,20 @@ static int __mutex_trylock(struct altera_mutex *mutex, u16 owner, u16 value)
 	read = __raw_readl(mutex->regs + MUTEX_REG);
 	if (read != data)
 		ret = -1;
+	else
+		altera_mutex_account_lock(mutex, start);
 
 	mutex_unlock(&mutex->lock);
 	return ret;
 }
 
+static void altera_mutex_count(struct altera_mutex *mutex, u64 *counter)
+{
+	mutex_lock(&mutex->lock);
+	(*counter)++;
+	mutex_unlock(&mutex->lock);
+}
+
 /**
  *	altera_mutex_lock - Acquires a hardware mutex, wait until it can get it.
  *	@mutex:	the mutex to be acquired
@@ -118,13 +179,41 @@ static int __mutex_trylock(struct altera_mutex *mutex, u16 owner, u16 value)
  */
 int altera_mutex_lock(struct altera_mutex *mutex, u16 owner, u16 value)
 {
+	unsigned int backoff = MUTEX_MIN_BACKOFF_US;
+	ktime_t start, spin_end;
+	int unlocks;
+
 	if (!mutex || !mutex->requested)
 		return -EINVAL;
 
-	while (__mutex_trylock(mutex, owner, value) != 0)
-		;
+	start = ktime_get();
+	if (__mutex_trylock(mutex, owner, value, start) == 0)
+		return 0;
 
-	return 0;
+	altera_mutex_count(mutex, &mutex->stats.contended);
+
+	spin_end = ktime_add_us(start, READ_ONCE(spin_us));
+	while (ktime_before(ktime_get(), spin_end)) {
+		cpu_relax();
+		if (__mutex_trylock(mutex, owner, value, start) == 0)
+			return 0;
+	}
+
+	for (;;) {
+		/* sample before trying, not to miss an unlock in between */
+		unlocks = atomic_read(&mutex->unlocks);
+		if (__mutex_trylock(mutex, owner, value, start) == 0)
+			return 0;
+
+		altera_mutex_count(mutex, &mutex->stats.sleeps);
+		wait_event_hrtimeout(mutex->wait,
+				     atomic_read(&mutex->unlocks) != unlocks,
+				     ns_to_ktime(backoff * NSEC_PER_USEC));
+
+		backoff = min(backoff * 2,
+			      max_t(unsigned int, READ_ONCE(max_backoff_us),
+				    MUTEX_MIN_BACKOFF_US));
+	}
 }
 EXPORT_SYMBOL(altera_mutex_lock);
 
@@ -145,7 +234,7 @@ int altera_mutex_trylock(struct altera_mutex *mutex, u16 owner, u16 value)
 	if (!mutex || !mutex->requested)
 		return -EINVAL;
 
-	return __mutex_trylock(mutex, owner, value);
+	return __mutex_trylock(mutex, owner, value, ktime_get());
 }
 EXPORT_SYMBOL(altera_mutex_trylock);
 
@@ -184,7 +273,11 @@ int altera_mutex_unlock(struct altera_mutex *mutex, u16 owner)
 		return -EINVAL;
 	}
 
+	altera_mutex_account_unlock(mutex);
 	mutex_unlock(&mutex->lock);
+
+	atomic_inc(&mutex->unlocks);
+	wake_up_all(&mutex->wait);
 	return 0;
 }
 EXPORT_SYMBOL(altera_mutex_unlock);
@@ -241,10 +334,82 @@ int altera_mutex_is_locked(struct altera_mutex *mutex)
 }
 EXPORT_SYMBOL(altera_mutex_is_locked);
 
+/*
+ * The mutex core has no interrupt register, the unlock interrupt comes from
+ * the fabric and only edge triggered ones are taken: their edge is acked by
+ * the interrupt controller, while nothing here could clear a level.
+ */
+static irqreturn_t altera_mutex_irq(int irq, void *dev_id)
+{
+	struct altera_mutex *mutex = dev_id;
+
+	atomic_inc(&mutex->unlocks);
+	wake_up_all(&mutex->wait);
+
+	return IRQ_HANDLED;
+}
+
+/*
+ * The counters are bumped under mutex->lock, next to the register accesses
+ * they account for, so they are read under it too.  Each attribute carries
+ * the offset of its counter in struct altera_mutex_stats.
+ */
+static ssize_t altera_mutex_stat_show(struct device *dev,
+				      struct device_attribute *attr, char *buf)
+{
+	struct dev_ext_attribute *ea = container_of(attr,
+						    struct dev_ext_attribute,
+						    attr);
+	struct altera_mutex *mutex = dev_get_drvdata(dev);
+	u64 val;
+
+	mutex_lock(&mutex->lock);
+	val = *(u64 *)((void *)&mutex->stats + (uintptr_t)ea->var);
+	mutex_unlock(&mutex->lock);
+
+	return sysfs_emit(buf, "%llu\n", val);
+}
+
+#define ALTERA_MUTEX_STAT(field)					\
+	struct dev_ext_attribute dev_attr_##field = {			\
+		__ATTR(field, 0444, altera_mutex_stat_show, NULL),	\
+		(void *)offsetof(struct altera_mutex_stats, field)	\
+	}
+
+static ALTERA_MUTEX_STAT(acquired);
+static ALTERA_MUTEX_STAT(contended);
+static ALTERA_MUTEX_STAT(sleeps);
+static ALTERA_MUTEX_STAT(wait_ns);
+static ALTERA_MUTEX_STAT(wait_max_ns);
+static ALTERA_MUTEX_STAT(hold_ns);
+static ALTERA_MUTEX_STAT(hold_max_ns);
+
+static struct attribute *altera_mutex_stats_attrs[] = {
+	&dev_attr_acquired.attr.attr,
+	&dev_attr_contended.attr.attr,
+	&dev_attr_sleeps.attr.attr,
+	&dev_attr_wait_ns.attr.attr,
+	&dev_attr_wait_max_ns.attr.attr,
+	&dev_attr_hold_ns.attr.attr,
+	&dev_attr_hold_max_ns.attr.attr,
+	NULL
+};
+
+static const struct attribute_group altera_mutex_stats_group = {
+	.name	= "stats",
+	.attrs	= altera_mutex_stats_attrs,
+};
+
+static const struct attribute_group *altera_mutex_groups[] = {
+	&altera_mutex_stats_group,
+	NULL
+};
+
 static int altera_mutex_probe(struct platform_device *pdev)
 {
 	struct altera_mutex *mutex;
 	struct resource	*regs;
+	int irq, ret;
 
 	mutex = devm_kzalloc(&pdev->dev, sizeof(struct altera_mutex),
 		GFP_KERNEL);
@@ -262,13 +427,27 @@ static int altera_mutex_probe(struct platform_device *pdev)
 		return PTR_ERR(mutex->regs);
 
 	mutex_init(&mutex->lock);
+	init_waitqueue_head(&mutex->wait);
+	platform_set_drvdata(pdev, mutex);
+
+	/* the fabric may signal the unlocks of the other agents */
+	irq = platform_get_irq_optional(pdev, 0);
+	if (irq > 0 && !(irq_get_trigger_type(irq) & IRQ_TYPE_EDGE_BOTH)) {
+		dev_warn(&pdev->dev,
+			 "level unlock interrupt can't be acked, not using it\n");
+	} else if (irq > 0) {
+		ret = devm_request_irq(&pdev->dev, irq, altera_mutex_irq, 0,
+				       dev_name(&pdev->dev), mutex);
+		if (ret)
+			return ret;
+	} else if (irq == -EPROBE_DEFER) {
+		return irq;
+	}
 
 	spin_lock(&list_lock);
 	list_add_tail(&mutex->list, &mutex_list);
 	spin_unlock(&list_lock);
 
-	platform_set_drvdata(pdev, mutex);
-
 	return 0;
 }
 
@@ -296,6 +475,7 @@ static struct platform_driver altera_mutex_platform_driver = {
 	.driver = {
 		.name		= DRV_NAME,
 		.of_match_table	= altera_mutex_match,
+		.dev_groups	= altera_mutex_groups,
 	},
 	.remove			= altera_mutex_remove,
 };
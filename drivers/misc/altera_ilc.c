@@ -14,15 +14,30 @@
  * this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <linux/debugfs.h>
 #include <linux/device.h>
+#include <linux/fs.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
+#include <linux/iopoll.h>
 #include <linux/kernel.h>
 #include <linux/kfifo.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
+#include <linux/miscdevice.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
+#include <linux/poll.h>
+#include <linux/seq_file.h>
 #include <linux/sysfs.h>
+#include <linux/uaccess.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+#include <uapi/linux/altera_ilc.h>
+
+#define CREATE_TRACE_POINTS
+#include "altera_ilc_trace.h"
 
 #define DRV_NAME			"altera_ilc"
 #define	CTRL_REG			0x80
@@ -33,29 +48,78 @@
 #define ILC_FIFO_DEFAULT	32
 #define ILC_ENABLE			0x01
 #define	CHAR_SIZE			10
-#define POLL_INTERVAL		1
+#define VLD_POLL_US			1
+#define VLD_TIMEOUT_US		1000
 #define GET_PORT_COUNT(_val)		((_val & 0x7C) >> 2)
 #define GET_VLD_BIT(_val, _offset)	(((_val) >> _offset) & 0x1)
+#define ILC_HIST_BUCKETS	32
+
+/*
+ * Stages of the latency of an interrupt: from the fabric raising it to the
+ * handler stopping the counter, from the handler to the collection of the
+ * count, and from the collection to the reader of the character device.
+ */
+enum ilc_stage {
+	ILC_STAGE_FABRIC,
+	ILC_STAGE_WORK,
+	ILC_STAGE_READ,
+	ILC_STAGE_TOTAL,
+	ILC_STAGES
+};
+
+static const char * const ilc_stage_names[ILC_STAGES] = {
+	[ILC_STAGE_FABRIC]	= "fabric",
+	[ILC_STAGE_WORK]	= "work",
+	[ILC_STAGE_READ]	= "read",
+	[ILC_STAGE_TOTAL]	= "total",
+};
+
+/* A sample waiting for the reader, with what its latency is computed from */
+struct ilc_event {
+	struct altera_ilc_sample	sample;
+	unsigned int			offset;
+	u64				event_ns;
+};
+
+/*
+ * Besides the per-port sysfs files, every sample is appended to the stream
+ * read through the character device, which holds stream_depth samples.
+ */
+static unsigned int stream_depth = 4096;
+module_param(stream_depth, uint, 0444);
+MODULE_PARM_DESC(stream_depth,
+		 "Samples buffered for the character device (default: 4096)");
 
 struct altera_ilc {
 	struct platform_device	*pdev;
 	void __iomem			*regs;
 	unsigned int			port_count;
-	unsigned int			irq;
 	unsigned int			channel_offset;
 	unsigned int			interrupt_channels[ILC_MAX_PORTS];
 	struct kfifo			kfifos[ILC_MAX_PORTS];
 	struct device_attribute dev_attr[ILC_MAX_PORTS];
-	struct delayed_work     ilc_work;
+	struct workqueue_struct		*wq;
+	struct work_struct		ilc_work;
+	unsigned long			pending;
 	char					sysfs[ILC_MAX_PORTS][CHAR_SIZE];
 	u32						fifo_depth;
+	struct miscdevice		miscdev;
+	DECLARE_KFIFO_PTR(stream, struct ilc_event);
+	wait_queue_head_t		stream_wait;
+	struct mutex			stream_lock;
+	unsigned long			stream_open;
+	atomic_t				stream_dropped;
+	u32				freq;
+	u64				irq_ns[ILC_MAX_PORTS];
+	u32		hist[ILC_MAX_PORTS][ILC_STAGES][ILC_HIST_BUCKETS];
+	struct dentry			*dbgfs;
 };
 
 static int ilc_irq_lookup(struct altera_ilc *ilc, int irq)
 {
 	int i;
 	for (i = 0; i < ilc->port_count; i++) {
-		if (irq == platform_get_irq(ilc->pdev, i))
+		if (irq == ilc->interrupt_channels[i])
 			return i;
 	}
 	return -EPERM;
@@ -105,48 +169,239 @@ struct attribute_group altera_ilc_attr_group = {
 	.attrs = altera_ilc_attrs,
 };
 
+static ssize_t dropped_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct altera_ilc *ilc = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%d\n", atomic_read(&ilc->stream_dropped));
+}
+static DEVICE_ATTR_RO(dropped);
+
+static void ilc_hist(struct altera_ilc *ilc, unsigned int offset,
+		     enum ilc_stage stage, u64 ns)
+{
+	unsigned int n = ns ? ilog2(ns) + 1 : 0;
+
+	ilc->hist[offset][stage][min_t(unsigned int, n, ILC_HIST_BUCKETS - 1)]++;
+}
+
+static int ilc_latency_show(struct seq_file *s, void *data)
+{
+	struct altera_ilc *ilc = s->private;
+	unsigned int i, stage, n;
+	u32 count;
+
+	/* ns is the lower bound of each power of 2 bucket */
+	seq_puts(s, "# irq stage ns count\n");
+	for (i = 0; i < ilc->port_count; i++) {
+		for (stage = 0; stage < ILC_STAGES; stage++) {
+			for (n = 0; n < ILC_HIST_BUCKETS; n++) {
+				count = READ_ONCE(ilc->hist[i][stage][n]);
+				if (!count)
+					continue;
+				seq_printf(s, "%u %s %llu %u\n",
+					   ilc->interrupt_channels[i],
+					   ilc_stage_names[stage],
+					   n ? 1ULL << (n - 1) : 0, count);
+			}
+		}
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(ilc_latency);
+
+static void ilc_collect(struct altera_ilc *ilc, unsigned int offset)
+{
+	u64 irq_ns = READ_ONCE(ilc->irq_ns[offset]);
+	struct ilc_event event;
+	unsigned int ilc_value, stp_reg, vld;
+
+	/*Wait for the counter of the port to be valid*/
+	if (readl_poll_timeout(ilc->regs + VLD_REG, vld,
+			       GET_VLD_BIT(vld, offset), VLD_POLL_US,
+			       VLD_TIMEOUT_US)) {
+		dev_dbg(&ilc->pdev->dev, "No valid count for interrupt %u\n",
+			ilc->interrupt_channels[offset]);
+		atomic_inc(&ilc->stream_dropped);
+		goto clear;
+	}
+
+	/*Read counter register*/
+	ilc_value = readl(ilc->regs + (offset) * 4);
+
+	/*Putting value into kfifo*/
+	kfifo_in((&ilc->kfifos[offset]),
+		(unsigned int *)&ilc_value, sizeof(ilc_value));
+
+	event.sample.irq = ilc->interrupt_channels[offset];
+	event.sample.latency = ilc_value;
+	event.sample.timestamp = ktime_get_ns();
+	event.offset = offset;
+	event.event_ns = irq_ns;
+
+	/* without the counter clock, the latency starts at the handler */
+	if (ilc->freq) {
+		event.event_ns -= div_u64((u64)ilc_value * NSEC_PER_SEC,
+					  ilc->freq);
+		ilc_hist(ilc, offset, ILC_STAGE_FABRIC,
+			 irq_ns - event.event_ns);
+	}
+	ilc_hist(ilc, offset, ILC_STAGE_WORK, event.sample.timestamp - irq_ns);
+
+	trace_altera_ilc_sample(event.sample.irq, ilc_value, event.event_ns,
+				irq_ns);
+
+	if (!kfifo_put(&ilc->stream, event))
+		atomic_inc(&ilc->stream_dropped);
+
+clear:
+	/*Clearing stop register*/
+	stp_reg = readl(ilc->regs + STP_REG);
+	writel((~(0x1 << offset) & stp_reg), ilc->regs + STP_REG);
+}
+
+/*
+ * Drains the ports flagged by the interrupt handler.  The counter of a port
+ * becomes valid shortly after it is stopped, which is waited for here rather
+ * than by polling every jiffy.
+ */
 static void ilc_work(struct work_struct *work)
 {
-	unsigned int ilc_value, ret, offset, stp_reg;
 	struct altera_ilc *ilc =
-		container_of(work, struct altera_ilc, ilc_work.work);
-
-	offset = ilc_irq_lookup(ilc, ilc->irq);
-	if (offset < 0) {
-		dev_err(&ilc->pdev->dev, "Unable to lookup irq number\n");
-		return;
+		container_of(work, struct altera_ilc, ilc_work);
+	unsigned int offset;
+	bool collected = false;
+
+	while (ilc->pending) {
+		for_each_set_bit(offset, &ilc->pending, ilc->port_count) {
+			clear_bit(offset, &ilc->pending);
+			ilc_collect(ilc, offset);
+			collected = true;
+		}
 	}
 
-	if (GET_VLD_BIT(readl(ilc->regs + VLD_REG), offset)) {
-		/*Read counter register*/
-		ilc_value = readl(ilc->regs + (offset) * 4);
+	if (collected)
+		wake_up_interruptible(&ilc->stream_wait);
+}
+
+static int ilc_stream_open(struct inode *inode, struct file *file)
+{
+	struct altera_ilc *ilc = container_of(file->private_data,
+					      struct altera_ilc, miscdev);
+
+	/* a single reader, so that no sample is split between readers */
+	if (test_and_set_bit(0, &ilc->stream_open))
+		return -EBUSY;
+
+	file->private_data = ilc;
+
+	return stream_open(inode, file);
+}
+
+static int ilc_stream_release(struct inode *inode, struct file *file)
+{
+	struct altera_ilc *ilc = file->private_data;
+
+	clear_bit(0, &ilc->stream_open);
+
+	return 0;
+}
+
+static ssize_t ilc_stream_read(struct file *file, char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	struct altera_ilc *ilc = file->private_data;
+	struct ilc_event event;
+	size_t copied = 0;
+	int ret = 0;
+	u64 now;
+
+	if (count < sizeof(struct altera_ilc_sample))
+		return -EINVAL;
+
+	if (mutex_lock_interruptible(&ilc->stream_lock))
+		return -ERESTARTSYS;
+
+	while (kfifo_is_empty(&ilc->stream)) {
+		mutex_unlock(&ilc->stream_lock);
 
-		/*Putting value into kfifo*/
-		ret = kfifo_in((&ilc->kfifos[offset]),
-			(unsigned int *)&ilc_value, sizeof(ilc_value));
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
 
-		/*Clearing stop register*/
-		stp_reg = readl(ilc->regs + STP_REG);
-		writel((~(0x1 << offset) & stp_reg), ilc->regs + STP_REG);
+		if (wait_event_interruptible(ilc->stream_wait,
+					     !kfifo_is_empty(&ilc->stream)))
+			return -ERESTARTSYS;
 
-		return;
+		if (mutex_lock_interruptible(&ilc->stream_lock))
+			return -ERESTARTSYS;
 	}
 
-	/*Start workqueue to poll data valid*/
-	schedule_delayed_work(&ilc->ilc_work, msecs_to_jiffies(POLL_INTERVAL));
+	now = ktime_get_ns();
+	while (copied + sizeof(event.sample) <= count &&
+	       kfifo_get(&ilc->stream, &event)) {
+		if (copy_to_user(buf + copied, &event.sample,
+				 sizeof(event.sample))) {
+			ret = -EFAULT;
+			break;
+		}
+		copied += sizeof(event.sample);
+
+		ilc_hist(ilc, event.offset, ILC_STAGE_READ,
+			 now - event.sample.timestamp);
+		if (ilc->freq)
+			ilc_hist(ilc, event.offset, ILC_STAGE_TOTAL,
+				 now - event.event_ns);
+	}
+	mutex_unlock(&ilc->stream_lock);
+
+	return copied ? copied : ret;
+}
+
+static __poll_t ilc_stream_poll(struct file *file, poll_table *wait)
+{
+	struct altera_ilc *ilc = file->private_data;
+
+	poll_wait(file, &ilc->stream_wait, wait);
+
+	if (!kfifo_is_empty(&ilc->stream))
+		return EPOLLIN | EPOLLRDNORM;
+
+	return 0;
+}
+
+static const struct file_operations ilc_stream_fops = {
+	.owner		= THIS_MODULE,
+	.open		= ilc_stream_open,
+	.release	= ilc_stream_release,
+	.read		= ilc_stream_read,
+	.poll		= ilc_stream_poll,
+	.llseek		= no_llseek,
+};
+
+static void altera_ilc_release(void *data)
+{
+	struct altera_ilc *ilc = data;
+	int i;
+
+	cancel_work_sync(&ilc->ilc_work);
+	destroy_workqueue(ilc->wq);
+
+	/*Free up kfifo memory*/
+	kfifo_free(&ilc->stream);
+	for (i = 0; i < ilc->port_count; i++)
+		kfifo_free(&ilc->kfifos[i]);
 }
 
 static irqreturn_t ilc_interrupt_handler(int irq, void *p)
 {
-	unsigned int offset, stp_reg;
+	unsigned int stp_reg;
+	int offset;
 
 	struct altera_ilc *ilc = (struct altera_ilc *)p;
 
-	/*Update ILC struct*/
-	ilc->irq = irq;
-
-	dev_dbg(&ilc->pdev->dev, "Interrupt %u triggered\n",
-		ilc->irq);
+	dev_dbg(&ilc->pdev->dev, "Interrupt %u triggered\n", irq);
 
 	offset = ilc_irq_lookup(ilc, irq);
 	if (offset < 0) {
@@ -155,11 +410,13 @@ static irqreturn_t ilc_interrupt_handler(int irq, void *p)
 	}
 
 	/*Setting stop register*/
+	WRITE_ONCE(ilc->irq_ns[offset], ktime_get_ns());
 	stp_reg = readl(ilc->regs + STP_REG);
 	writel((0x1 << offset)|stp_reg, ilc->regs + STP_REG);
 
-	/*Start workqueue to poll data valid*/
-	schedule_delayed_work(&ilc->ilc_work, 0);
+	/*Start workqueue to collect the count*/
+	set_bit(offset, &ilc->pending);
+	queue_work(ilc->wq, &ilc->ilc_work);
 
 	return IRQ_RETVAL(IRQ_NONE);
 }
@@ -201,6 +458,37 @@ static int altera_ilc_probe(struct platform_device *pdev)
 		ilc->fifo_depth = ILC_FIFO_DEFAULT;
 	}
 
+	/* Clock of the counters, to convert the counts to time */
+	ilc->freq = readl(ilc->regs + FREQ_REG);
+	if (!ilc->freq)
+		dev_warn(&pdev->dev, "Counter frequency unknown, no fabric latency\n");
+
+	/*
+	 * Own worker pool, so the count collection doesn't wait behind
+	 * unrelated work; its priority and CPUs can be set from sysfs.
+	 */
+	ilc->wq = alloc_workqueue("altera_ilc_%s",
+				  WQ_ISOLATED | WQ_HIGHPRI | WQ_SYSFS, 0,
+				  dev_name(&pdev->dev));
+	if (!ilc->wq)
+		return -ENOMEM;
+
+	INIT_WORK(&ilc->ilc_work, ilc_work);
+	init_waitqueue_head(&ilc->stream_wait);
+	mutex_init(&ilc->stream_lock);
+	platform_set_drvdata(pdev, ilc);
+
+	/* Frees the kfifos once the interrupts are released */
+	ret = devm_add_action_or_reset(&pdev->dev, altera_ilc_release, ilc);
+	if (ret)
+		return ret;
+
+	ret = kfifo_alloc(&ilc->stream, max(stream_depth, 2U), GFP_KERNEL);
+	if (ret) {
+		dev_err(&pdev->dev, "Kfifo failed to initialize\n");
+		return ret;
+	}
+
 	/*Initialize Kfifo*/
 	for (i = 0; i < ilc->port_count; i++) {
 		ret = kfifo_alloc(&ilc->kfifos[i], (ilc->fifo_depth *
@@ -233,15 +521,35 @@ static int altera_ilc_probe(struct platform_device *pdev)
 		altera_ilc_attrs[i+1] = NULL;
 	}
 	ret = sysfs_create_group(&pdev->dev.kobj, &altera_ilc_attr_group);
+	if (!ret)
+		ret = device_create_file(&pdev->dev, &dev_attr_dropped);
+	if (ret)
+		dev_warn(&pdev->dev, "Failed to create sysfs files\n");
+
+	/*Setup the character device*/
+	ilc->miscdev.minor = MISC_DYNAMIC_MINOR;
+	ilc->miscdev.name = devm_kasprintf(&pdev->dev, GFP_KERNEL, "ilc-%s",
+					   dev_name(&pdev->dev));
+	ilc->miscdev.fops = &ilc_stream_fops;
+	ilc->miscdev.parent = &pdev->dev;
+	if (!ilc->miscdev.name)
+		return -ENOMEM;
 
-	/*Initialize workqueue*/
-	INIT_DELAYED_WORK(&ilc->ilc_work, ilc_work);
+	ret = misc_register(&ilc->miscdev);
+	if (ret) {
+		dev_err(&pdev->dev, "Failed to register character device\n");
+		device_remove_file(&pdev->dev, &dev_attr_dropped);
+		sysfs_remove_group(&pdev->dev.kobj, &altera_ilc_attr_group);
+		return ret;
+	}
+
+	ilc->dbgfs = debugfs_create_dir(ilc->miscdev.name, NULL);
+	debugfs_create_file("latency_hist", 0400, ilc->dbgfs, ilc,
+			    &ilc_latency_fops);
 
 	/*Global enable ILC softIP*/
 	writel(ILC_ENABLE, ilc->regs + CTRL_REG);
 
-	platform_set_drvdata(pdev, ilc);
-
 	dev_info(&pdev->dev, "Driver successfully loaded\n");
 
 	return 0;
@@ -249,17 +557,15 @@ static int altera_ilc_probe(struct platform_device *pdev)
 
 static int altera_ilc_remove(struct platform_device *pdev)
 {
-	int i;
 	struct altera_ilc *ilc = platform_get_drvdata(pdev);
 
+	debugfs_remove_recursive(ilc->dbgfs);
+	misc_deregister(&ilc->miscdev);
+
 	/*Remove sysfs interface*/
+	device_remove_file(&pdev->dev, &dev_attr_dropped);
 	sysfs_remove_group(&pdev->dev.kobj, &altera_ilc_attr_group);
 
-	/*Free up kfifo memory*/
-	for (i = 0; i < ilc->port_count; i++)
-		kfifo_free(&ilc->kfifos[i]);
-
-	platform_set_drvdata(pdev, NULL);
 	return 0;
 }
 
@@ -0,0 +1,52 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Tracepoints of the Altera Interrupt Latency Counter.
+ *
+ * A sample gives the time the fabric raised the interrupt, from the counter,
+ * and the time the handler stopped the counter.  Together with the irq and
+ * sched events of the thread consuming the interrupt, they give the whole
+ * path from the fabric to userspace.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM	altera_ilc
+
+#if !defined(_ALTERA_ILC_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _ALTERA_ILC_TRACE_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(altera_ilc_sample,
+
+	TP_PROTO(unsigned int irq, u32 cycles, u64 event_ns, u64 irq_ns),
+
+	TP_ARGS(irq, cycles, event_ns, irq_ns),
+
+	TP_STRUCT__entry(
+		__field(unsigned int, irq)
+		__field(u32, cycles)
+		__field(u64, event_ns)
+		__field(u64, irq_ns)
+	),
+
+	TP_fast_assign(
+		__entry->irq = irq;
+		__entry->cycles = cycles;
+		__entry->event_ns = event_ns;
+		__entry->irq_ns = irq_ns;
+	),
+
+	TP_printk("irq %u cycles %u event_ns %llu irq_ns %llu",
+		  __entry->irq, __entry->cycles, __entry->event_ns,
+		  __entry->irq_ns)
+);
+
+#endif /* _ALTERA_ILC_TRACE_H */
+
+/* We don't want to use include/trace/events */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE	altera_ilc_trace
+/* This part must be outside protection */
+#include <trace/define_trace.h>
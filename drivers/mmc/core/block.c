@@ -40,6 +40,7 @@
 #include <linux/pm_runtime.h>
 #include <linux/idr.h>
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <linux/mmc/ioctl.h>
 #include <linux/mmc/card.h>
@@ -137,9 +138,19 @@ struct mmc_blk_data {
 #define MMC_BLK_PART_INVALID	UINT_MAX	/* Unknown partition active */
 	int	area_type;
 
+	/*
+	 * Cache flush state and counters, only in main mmc_blk_data as the
+	 * cache is shared by all the partitions.
+	 */
+	ktime_t		flush_time;	/* start of the last cache flush */
+	unsigned long	flushes;	/* cache flushes sent to the card */
+	unsigned long	flushes_skipped; /* nothing written since the last */
+	unsigned long	flushes_delayed; /* held by the coalescing window */
+
 	/* debugfs files (only in main mmc_blk_data) */
 	struct dentry *status_dentry;
 	struct dentry *ext_csd_dentry;
+	struct dentry *flush_dentry;
 };
 
 /* Device type for RPMB character devices */
@@ -173,6 +184,11 @@ static DEFINE_MUTEX(open_lock);
 module_param(perdev_minors, int, 0444);
 MODULE_PARM_DESC(perdev_minors, "Minors numbers to allocate per device");
 
+static unsigned int flush_coalesce_us;
+module_param(flush_coalesce_us, uint, 0644);
+MODULE_PARM_DESC(flush_coalesce_us,
+		 "Minimum time between two cache flushes, in microseconds");
+
 static inline int mmc_blk_part_switch(struct mmc_card *card,
 				      unsigned int part_type);
 static void mmc_blk_rw_rq_prep(struct mmc_queue_req *mqrq,
@@ -1252,13 +1268,50 @@ static void mmc_blk_issue_secdiscard_rq(struct mmc_queue *mq,
 	blk_mq_end_request(req, status);
 }
 
+/*
+ * Tell whether a flush request needs the cache to be flushed, which it doesn't
+ * when nothing was written since the last flush.  A flush following the last
+ * one by less than flush_coalesce_us is held until then: the flushes arriving
+ * meanwhile are gathered behind it by the block layer, and all of them are
+ * served by the next cache flush.
+ */
+static bool mmc_blk_flush_needed(struct mmc_queue *mq)
+{
+	struct mmc_card *card = mq->card;
+	struct mmc_blk_data *main_md = dev_get_drvdata(&card->dev);
+	unsigned int window = READ_ONCE(flush_coalesce_us);
+	s64 elapsed;
+
+	if (!card->written_flag) {
+		main_md->flushes_skipped++;
+		return false;
+	}
+
+	if (window) {
+		elapsed = ktime_us_delta(ktime_get(), main_md->flush_time);
+		if (elapsed >= 0 && elapsed < window) {
+			main_md->flushes_delayed++;
+			fsleep(window - elapsed);
+		}
+	}
+
+	main_md->flush_time = ktime_get();
+	main_md->flushes++;
+
+	return true;
+}
+
 static void mmc_blk_issue_flush(struct mmc_queue *mq, struct request *req)
 {
 	struct mmc_blk_data *md = mq->blkdata;
 	struct mmc_card *card = md->queue.card;
 	int ret = 0;
 
-	ret = mmc_flush_cache(card->host);
+	if (mmc_cache_enabled(card->host) && mmc_blk_flush_needed(mq)) {
+		ret = mmc_flush_cache(card->host);
+		if (!ret)
+			card->written_flag = false;
+	}
 	blk_mq_end_request(req, ret ? BLK_STS_IOERR : BLK_STS_OK);
 }
 
@@ -1496,6 +1549,9 @@ static void mmc_blk_cqe_complete_rq(struct mmc_queue *mq, struct request *req)
 		err = 0;
 
 	if (err) {
+		/* the writes the flush was for are still to be flushed */
+		if (req_op(req) == REQ_OP_FLUSH)
+			mq->card->written_flag = true;
 		if (mqrq->retries++ < MMC_CQE_RETRIES)
 			blk_mq_requeue_request(req, true);
 		else
@@ -1587,6 +1643,16 @@ static int mmc_blk_cqe_issue_flush(struct mmc_queue *mq, struct request *req)
 {
 	struct mmc_queue_req *mqrq = req_to_mmc_queue_req(req);
 	struct mmc_request *mrq = mmc_blk_cqe_prep_dcmd(mqrq, req);
+	int ret;
+
+	/*
+	 * The writes still in the queue may complete after the flush, so they
+	 * need the next one.
+	 */
+	spin_lock_irq(&mq->lock);
+	if (!mq->in_flight[MMC_ISSUE_ASYNC])
+		mq->card->written_flag = false;
+	spin_unlock_irq(&mq->lock);
 
 	mrq->cmd->opcode = MMC_SWITCH;
 	mrq->cmd->arg = (MMC_SWITCH_MODE_WRITE_BYTE << 24) |
@@ -1595,7 +1661,11 @@ static int mmc_blk_cqe_issue_flush(struct mmc_queue *mq, struct request *req)
 			EXT_CSD_CMD_SET_NORMAL;
 	mrq->cmd->flags = MMC_CMD_AC | MMC_RSP_R1B;
 
-	return mmc_blk_cqe_start_req(mq->card->host, mrq);
+	ret = mmc_blk_cqe_start_req(mq->card->host, mrq);
+	if (ret)
+		mq->card->written_flag = true;
+
+	return ret;
 }
 
 static int mmc_blk_hsq_issue_rw_rq(struct mmc_queue *mq, struct request *req)
@@ -2377,15 +2447,20 @@ enum mmc_issued mmc_blk_mq_issue_rq(struct mmc_queue *mq, struct request *req)
 		switch (req_op(req)) {
 		case REQ_OP_DRV_IN:
 		case REQ_OP_DRV_OUT:
+			/* ioctl()s can write whatever they like */
+			card->written_flag = true;
 			mmc_blk_issue_drv_op(mq, req);
 			break;
 		case REQ_OP_DISCARD:
+			card->written_flag = true;
 			mmc_blk_issue_discard_rq(mq, req);
 			break;
 		case REQ_OP_SECURE_ERASE:
+			card->written_flag = true;
 			mmc_blk_issue_secdiscard_rq(mq, req);
 			break;
 		case REQ_OP_WRITE_ZEROES:
+			card->written_flag = true;
 			mmc_blk_issue_trim_rq(mq, req);
 			break;
 		case REQ_OP_FLUSH:
@@ -2400,7 +2475,8 @@ enum mmc_issued mmc_blk_mq_issue_rq(struct mmc_queue *mq, struct request *req)
 	case MMC_ISSUE_ASYNC:
 		switch (req_op(req)) {
 		case REQ_OP_FLUSH:
-			if (!mmc_cache_enabled(host)) {
+			if (!mmc_cache_enabled(host) ||
+			    !mmc_blk_flush_needed(mq)) {
 				blk_mq_end_request(req, BLK_STS_OK);
 				return MMC_REQ_FINISHED;
 			}
@@ -2934,6 +3010,18 @@ static const struct file_operations mmc_dbg_ext_csd_fops = {
 	.llseek		= default_llseek,
 };
 
+static int mmc_dbg_flush_show(struct seq_file *s, void *data)
+{
+	struct mmc_blk_data *md = s->private;
+
+	seq_printf(s, "flushes:\t%lu\n", READ_ONCE(md->flushes));
+	seq_printf(s, "skipped:\t%lu\n", READ_ONCE(md->flushes_skipped));
+	seq_printf(s, "delayed:\t%lu\n", READ_ONCE(md->flushes_delayed));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(mmc_dbg_flush);
+
 static int mmc_blk_add_debugfs(struct mmc_card *card, struct mmc_blk_data *md)
 {
 	struct dentry *root;
@@ -2960,6 +3048,9 @@ static int mmc_blk_add_debugfs(struct mmc_card *card, struct mmc_blk_data *md)
 			return -EIO;
 	}
 
+	md->flush_dentry = debugfs_create_file("flush", 0400, root, md,
+					       &mmc_dbg_flush_fops);
+
 	return 0;
 }
 
@@ -2978,6 +3069,11 @@ static void mmc_blk_remove_debugfs(struct mmc_card *card,
 		debugfs_remove(md->ext_csd_dentry);
 		md->ext_csd_dentry = NULL;
 	}
+
+	if (!IS_ERR_OR_NULL(md->flush_dentry)) {
+		debugfs_remove(md->flush_dentry);
+		md->flush_dentry = NULL;
+	}
 }
 
 #else
@@ -3007,6 +3103,9 @@ static int mmc_blk_probe(struct mmc_card *card)
 
 	mmc_fixup_device(card, mmc_blk_fixups);
 
+	/* whatever was written before us may still be in the cache */
+	card->written_flag = true;
+
 	card->complete_wq = alloc_workqueue("mmc_complete",
 					WQ_MEM_RECLAIM | WQ_HIGHPRI, 0);
 	if (!card->complete_wq) {
@@ -11,6 +11,7 @@
 
 #include <linux/scatterlist.h>
 #include <linux/list.h>
+#include <linux/sort.h>
 
 #include <linux/debugfs.h>
 #include <linux/uaccess.h>
@@ -110,6 +111,7 @@ struct mmc_test_transfer_result {
  * @testcase: number of test case
  * @result: result of test run
  * @tr_lst: transfer measurements if any as mmc_test_transfer_result
+ * @bench_lst: performance sweep points if any as mmc_test_bench_result
  */
 struct mmc_test_general_result {
 	struct list_head link;
@@ -117,6 +119,7 @@ struct mmc_test_general_result {
 	int testcase;
 	int result;
 	struct list_head tr_lst;
+	struct list_head bench_lst;
 };
 
 /**
@@ -2319,6 +2322,540 @@ static int mmc_test_profile_sglen_r_nonblock_perf(struct mmc_test_card *test)
 	return mmc_test_rw_multiple_sg_len(test, &test_data);
 }
 
+/*
+ * Performance sweep.  Every combination of the request sizes, offsets and
+ * queue depths below is timed over bench_count requests walking the test area,
+ * and the results are kept for the "bench" debugfs file, one point per line.
+ */
+#define MMC_TEST_BENCH_MAX_PARAMS	16
+#define MMC_TEST_BENCH_MAX_DEPTH	32
+#define MMC_TEST_BENCH_POLL		(HZ / 10)
+#define MMC_TEST_BENCH_TIMEOUT		(10 * HZ)
+
+static unsigned int bench_sizes[MMC_TEST_BENCH_MAX_PARAMS] = {
+	4096, 16384, 65536, 524288,
+};
+static unsigned int bench_sizes_cnt = 4;
+module_param_array(bench_sizes, uint, &bench_sizes_cnt, 0644);
+MODULE_PARM_DESC(bench_sizes,
+		 "Request sizes of the performance sweep (in bytes)");
+
+static unsigned int bench_aligns[MMC_TEST_BENCH_MAX_PARAMS];
+static unsigned int bench_aligns_cnt = 1;
+module_param_array(bench_aligns, uint, &bench_aligns_cnt, 0644);
+MODULE_PARM_DESC(bench_aligns,
+		 "Request offsets of the performance sweep from an erase boundary (in sectors)");
+
+static unsigned int bench_depths[MMC_TEST_BENCH_MAX_PARAMS] = {
+	1, 2, 4, 8,
+};
+static unsigned int bench_depths_cnt = 4;
+module_param_array(bench_depths, uint, &bench_depths_cnt, 0644);
+MODULE_PARM_DESC(bench_depths,
+		 "Outstanding requests of the performance sweep");
+
+static unsigned int bench_count = 256;
+module_param(bench_count, uint, 0644);
+MODULE_PARM_DESC(bench_count,
+		 "Requests timed for each point of the performance sweep");
+
+enum mmc_test_bench_queue {
+	MMC_TEST_BENCH_ASYNC,	/* next request prepared meanwhile */
+	MMC_TEST_BENCH_HSQ,	/* host software queue */
+	MMC_TEST_BENCH_CQE,	/* command queue engine */
+};
+
+static const char * const mmc_test_bench_queue_names[] = {
+	[MMC_TEST_BENCH_ASYNC]	= "async",
+	[MMC_TEST_BENCH_HSQ]	= "hsq",
+	[MMC_TEST_BENCH_CQE]	= "cqe",
+};
+
+static const struct {
+	const char *name;
+	unsigned int permille;
+} mmc_test_bench_lat[] = {
+	{ "min", 0 },
+	{ "p50", 500 },
+	{ "p90", 900 },
+	{ "p99", 990 },
+	{ "p999", 999 },
+	{ "max", 1000 },
+};
+
+/**
+ * struct mmc_test_bench_result - results of a point of a performance sweep.
+ * @link: double-linked list
+ * @write: whether the requests were writes
+ * @queue: how the requests were queued
+ * @size: request size (in bytes)
+ * @align: request offset from an erase boundary (in sectors)
+ * @depth: maximum number of outstanding requests
+ * @count: number of requests
+ * @ns: time taken by all the requests
+ * @rate: calculated transfer rate
+ * @iops: I/O operations per second (times 100)
+ * @lat: request latency percentiles (in ns), as listed in mmc_test_bench_lat
+ */
+struct mmc_test_bench_result {
+	struct list_head link;
+	bool write;
+	enum mmc_test_bench_queue queue;
+	unsigned int size;
+	unsigned int align;
+	unsigned int depth;
+	unsigned int count;
+	u64 ns;
+	unsigned int rate;
+	unsigned int iops;
+	u64 lat[ARRAY_SIZE(mmc_test_bench_lat)];
+};
+
+/**
+ * struct mmc_test_bench_req - a request of a performance sweep.
+ * @rq: the request
+ * @bench: the sweep the request belongs to
+ * @sg: scatterlist of the request
+ * @sg_len: length of @sg
+ * @start: time the request was started
+ * @end: time the request completed
+ */
+struct mmc_test_bench_req {
+	struct mmc_test_req rq;
+	struct mmc_test_bench *bench;
+	struct scatterlist *sg;
+	unsigned int sg_len;
+	ktime_t start;
+	ktime_t end;
+};
+
+/**
+ * struct mmc_test_bench - state of a performance sweep.
+ * @test: test information
+ * @queue: how the requests are queued
+ * @max_depth: maximum number of outstanding requests
+ * @req: @max_depth requests
+ * @count: number of requests of each point
+ * @lat: latencies of the requests of the current point
+ * @write: whether the current point writes
+ * @blocks: sectors of each request of the current point
+ * @dev_addr: address of the first request of the current point
+ * @nr_addr: number of requests of the current point fitting the test area
+ * @recovery_needed: the command queue engine asked for recovery
+ */
+struct mmc_test_bench {
+	struct mmc_test_card *test;
+	enum mmc_test_bench_queue queue;
+	unsigned int max_depth;
+	struct mmc_test_bench_req *req;
+	unsigned int count;
+	u64 *lat;
+	int write;
+	unsigned int blocks;
+	unsigned int dev_addr;
+	unsigned int nr_addr;
+	bool recovery_needed;
+};
+
+static void mmc_test_bench_done(struct mmc_request *mrq)
+{
+	struct mmc_test_bench_req *br =
+		container_of(mrq, struct mmc_test_bench_req, rq.mrq);
+
+	br->end = ktime_get();
+	complete(&mrq->completion);
+}
+
+static void mmc_test_bench_recovery_notifier(struct mmc_request *mrq)
+{
+	struct mmc_test_bench_req *br =
+		container_of(mrq, struct mmc_test_bench_req, rq.mrq);
+
+	WRITE_ONCE(br->bench->recovery_needed, true);
+}
+
+/*
+ * Fill in the request number i of the current point.  Requests go through the
+ * test area sequentially, starting over from the beginning at its end.
+ */
+static void mmc_test_bench_prep(struct mmc_test_bench *b,
+				struct mmc_test_bench_req *br, unsigned int i)
+{
+	struct mmc_request *mrq = &br->rq.mrq;
+	struct mmc_data *data = &br->rq.data;
+	unsigned int dev_addr = b->dev_addr + (i % b->nr_addr) * b->blocks;
+
+	mmc_test_req_reset(&br->rq);
+	init_completion(&mrq->completion);
+	mrq->done = mmc_test_bench_done;
+
+	if (b->queue != MMC_TEST_BENCH_CQE) {
+		mmc_test_prepare_mrq(b->test, mrq, br->sg, br->sg_len, dev_addr,
+				     b->blocks, 512, b->write);
+		return;
+	}
+
+	/* The task descriptor replaces the commands */
+	mrq->cmd = NULL;
+	mrq->stop = NULL;
+	mrq->recovery_notifier = mmc_test_bench_recovery_notifier;
+
+	data->blk_addr = dev_addr;
+	data->blksz = 512;
+	data->blocks = b->blocks;
+	data->flags = b->write ? MMC_DATA_WRITE : MMC_DATA_READ;
+	data->sg = br->sg;
+	data->sg_len = br->sg_len;
+
+	mmc_set_data_timeout(data, b->test->card);
+}
+
+/*
+ * Without a queue, the host runs a request at a time.  With a depth of 2 or
+ * more, the next request is prepared while the current one runs, as done by
+ * the block driver.
+ */
+static int mmc_test_bench_async(struct mmc_test_bench *b, unsigned int depth)
+{
+	struct mmc_test_card *test = b->test;
+	struct mmc_host *host = test->card->host;
+	struct mmc_test_bench_req *br, *prev = NULL;
+	struct mmc_request *mrq;
+	unsigned int i;
+	int ret = 0;
+
+	for (i = 0; i <= b->count; i++) {
+		br = NULL;
+		if (i < b->count) {
+			br = &b->req[i % 2];
+			mmc_test_bench_prep(b, br, i);
+			if (depth > 1)
+				mmc_pre_req(host, &br->rq.mrq);
+		}
+
+		if (prev) {
+			mrq = &prev->rq.mrq;
+			wait_for_completion(&mrq->completion);
+			b->lat[i - 1] = ktime_to_ns(ktime_sub(prev->end,
+							      prev->start));
+
+			/* only writes leave the card busy */
+			if (b->write)
+				ret = mmc_test_wait_busy(test);
+			if (!ret)
+				ret = mmc_test_check_result(test, mrq);
+			mmc_retune_release(host);
+			if (depth > 1)
+				mmc_post_req(host, mrq, 0);
+		}
+
+		if (!ret && br) {
+			br->start = ktime_get();
+			ret = mmc_start_request(host, &br->rq.mrq);
+			if (ret)
+				mmc_retune_release(host);
+		}
+
+		if (ret) {
+			if (br && depth > 1)
+				mmc_post_req(host, &br->rq.mrq, ret);
+			return ret;
+		}
+
+		prev = br;
+	}
+
+	return 0;
+}
+
+static int mmc_test_bench_wait(struct mmc_test_bench *b,
+			       struct mmc_test_bench_req *br, unsigned int i)
+{
+	struct mmc_host *host = b->test->card->host;
+	struct mmc_request *mrq = &br->rq.mrq;
+	unsigned long timeout = jiffies + MMC_TEST_BENCH_TIMEOUT;
+	int ret;
+
+	if (b->queue != MMC_TEST_BENCH_CQE) {
+		wait_for_completion(&mrq->completion);
+		b->lat[i] = ktime_to_ns(ktime_sub(br->end, br->start));
+		ret = mmc_test_check_result(b->test, mrq);
+		mmc_cqe_post_req(host, mrq);
+		return ret;
+	}
+
+	/*
+	 * Nobody times out the requests of the command queue engine for us, and
+	 * the erroneous ones are only completed by the recovery.
+	 */
+	while (!wait_for_completion_timeout(&mrq->completion,
+					    MMC_TEST_BENCH_POLL)) {
+		if (!READ_ONCE(b->recovery_needed) &&
+		    time_before(jiffies, timeout))
+			continue;
+
+		mmc_cqe_recovery(host);
+		WRITE_ONCE(b->recovery_needed, false);
+		timeout = jiffies + MMC_TEST_BENCH_TIMEOUT;
+	}
+
+	b->lat[i] = ktime_to_ns(ktime_sub(br->end, br->start));
+	ret = mrq->data->error;
+	if (!ret && mrq->data->bytes_xfered !=
+		    mrq->data->blocks * mrq->data->blksz)
+		ret = RESULT_FAIL;
+	mmc_cqe_post_req(host, mrq);
+
+	return ret;
+}
+
+/*
+ * With the host software queue or the command queue engine, up to depth
+ * requests are outstanding.  They are waited for in order, each completed
+ * request being replaced by a new one.
+ */
+static int mmc_test_bench_queued(struct mmc_test_bench *b, unsigned int depth)
+{
+	struct mmc_test_card *test = b->test;
+	struct mmc_host *host = test->card->host;
+	unsigned int issued = 0, done = 0;
+	struct mmc_test_bench_req *br;
+	struct mmc_request *mrq;
+	int ret = 0, err;
+
+	for (;;) {
+		while (!ret && issued < b->count && issued - done < depth) {
+			br = &b->req[issued % depth];
+			mrq = &br->rq.mrq;
+			mmc_test_bench_prep(b, br, issued);
+			mrq->tag = issued % depth;
+			if (b->queue == MMC_TEST_BENCH_HSQ)
+				mmc_pre_req(host, mrq);
+
+			br->start = ktime_get();
+			ret = mmc_cqe_start_req(host, mrq);
+			if (ret) {
+				if (b->queue == MMC_TEST_BENCH_HSQ)
+					mmc_post_req(host, mrq, ret);
+				break;
+			}
+			issued++;
+		}
+
+		if (done == issued)
+			break;
+
+		err = mmc_test_bench_wait(b, &b->req[done % depth], done);
+		if (!ret)
+			ret = err;
+		done++;
+	}
+
+	if (!ret && b->write)
+		ret = mmc_test_wait_busy(test);
+
+	return ret;
+}
+
+/*
+ * Time a point of the performance sweep, skipping the ones not fitting the
+ * host limits or the test area.
+ */
+static int mmc_test_bench_point(struct mmc_test_bench *b, unsigned int size,
+				unsigned int align, unsigned int depth)
+{
+	struct mmc_test_card *test = b->test;
+	struct mmc_test_area *t = &test->area;
+	struct mmc_test_bench_result res, *r;
+	struct timespec64 ts;
+	ktime_t start, end;
+	unsigned int i;
+	int ret;
+
+	b->blocks = size >> 9;
+	if (!size || size % 512 || size > t->max_tfr ||
+	    align + b->blocks > t->max_sz >> 9) {
+		pr_info("%s: Skipping %u bytes at offset %u\n",
+			mmc_hostname(test->card->host), size, align);
+		return 0;
+	}
+
+	depth = clamp(depth, 1U, b->max_depth);
+
+	for (i = 0; i < b->max_depth; i++) {
+		ret = mmc_test_map_sg(t->mem, size, b->req[i].sg, 1,
+				      t->max_segs, t->max_seg_sz,
+				      &b->req[i].sg_len, 0);
+		if (ret)
+			return ret;
+	}
+
+	b->dev_addr = t->dev_addr + align;
+	b->nr_addr = ((t->max_sz >> 9) - align) / b->blocks;
+
+	start = ktime_get();
+	if (b->queue == MMC_TEST_BENCH_ASYNC)
+		ret = mmc_test_bench_async(b, depth);
+	else
+		ret = mmc_test_bench_queued(b, depth);
+	end = ktime_get();
+	if (ret)
+		return ret;
+
+	ts = ktime_to_timespec64(ktime_sub(end, start));
+	sort_u64(b->lat, b->count);
+
+	res.write = b->write;
+	res.queue = b->queue;
+	res.size = size;
+	res.align = align;
+	res.depth = depth;
+	res.count = b->count;
+	res.ns = timespec64_to_ns(&ts);
+	res.rate = mmc_test_rate((u64)size * b->count, &ts);
+	res.iops = mmc_test_rate((u64)b->count * 100, &ts);
+	for (i = 0; i < ARRAY_SIZE(mmc_test_bench_lat); i++)
+		res.lat[i] = sorted_percentile_u64(b->lat, b->count,
+				mmc_test_bench_lat[i].permille);
+
+	pr_info("%s: %u x %u bytes at offset %u, %s depth %u took %llu.%09u "
+		"seconds (%u kB/s, %u.%02u IOPS, p50 %llu us, max %llu us)\n",
+		mmc_hostname(test->card->host), res.count, size, align,
+		mmc_test_bench_queue_names[res.queue], depth, (u64)ts.tv_sec,
+		(u32)ts.tv_nsec, res.rate / 1000, res.iops / 100,
+		res.iops % 100, div_u64(res.lat[1], NSEC_PER_USEC),
+		div_u64(res.lat[ARRAY_SIZE(res.lat) - 1], NSEC_PER_USEC));
+
+	if (test->gr) {
+		r = kmemdup(&res, sizeof(res), GFP_KERNEL);
+		if (r)
+			list_add_tail(&r->link, &test->gr->bench_lst);
+	}
+
+	return 0;
+}
+
+/*
+ * Sweep the request sizes, offsets and queue depths.  The depth is limited to
+ * 2 without a queue, and to what both the card and the host support with the
+ * command queue engine.
+ */
+static int mmc_test_bench(struct mmc_test_card *test, int write)
+{
+	struct mmc_card *card = test->card;
+	struct mmc_host *host = card->host;
+	struct mmc_test_bench b = {
+		.test = test,
+		.count = READ_ONCE(bench_count),
+		.write = write,
+	};
+	unsigned int i, s, a, d;
+	int ret, err;
+
+	if (!b.count)
+		return -EINVAL;
+
+	if (host->cqe_enabled && host->hsq_enabled) {
+		b.queue = MMC_TEST_BENCH_HSQ;
+		b.max_depth = MMC_TEST_BENCH_MAX_DEPTH;
+	} else if (host->cqe_enabled && card->reenable_cmdq) {
+		b.queue = MMC_TEST_BENCH_CQE;
+		b.max_depth = min3(card->ext_csd.cmdq_depth, host->cqe_qdepth,
+				   MMC_TEST_BENCH_MAX_DEPTH);
+	} else {
+		b.queue = MMC_TEST_BENCH_ASYNC;
+		b.max_depth = 2;
+	}
+
+	b.req = kcalloc(b.max_depth, sizeof(*b.req), GFP_KERNEL);
+	b.lat = kvmalloc_array(b.count, sizeof(*b.lat), GFP_KERNEL);
+	if (!b.req || !b.lat) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
+	for (i = 0; i < b.max_depth; i++) {
+		b.req[i].bench = &b;
+		b.req[i].sg = kmalloc_array(test->area.max_segs,
+					    sizeof(*b.req[i].sg), GFP_KERNEL);
+		if (!b.req[i].sg) {
+			ret = -ENOMEM;
+			goto out_free;
+		}
+	}
+
+	/* mmc_test_probe() turned the command queue off for legacy requests */
+	if (b.queue == MMC_TEST_BENCH_CQE) {
+		ret = mmc_cmdq_enable(card);
+		if (ret)
+			goto out_free;
+	}
+
+	for (s = 0; s < READ_ONCE(bench_sizes_cnt); s++) {
+		for (a = 0; a < READ_ONCE(bench_aligns_cnt); a++) {
+			for (d = 0; d < READ_ONCE(bench_depths_cnt); d++) {
+				ret = mmc_test_bench_point(&b, bench_sizes[s],
+							   bench_aligns[a],
+							   bench_depths[d]);
+				if (ret)
+					goto out_cmdq;
+			}
+		}
+	}
+
+out_cmdq:
+	if (b.queue == MMC_TEST_BENCH_CQE) {
+		err = mmc_cmdq_disable(card);
+		if (!ret)
+			ret = err;
+	}
+out_free:
+	if (b.req)
+		for (i = 0; i < b.max_depth; i++)
+			kfree(b.req[i].sg);
+	kfree(b.req);
+	kvfree(b.lat);
+
+	return ret;
+}
+
+/*
+ * Prepare for the read sweep.  The whole test area is written, as some cards
+ * answer reads of erased sectors without reading the flash.
+ */
+static int mmc_test_bench_prepare_read(struct mmc_test_card *test)
+{
+	struct mmc_test_area *t = &test->area;
+	int ret;
+
+	ret = mmc_test_area_init(test, 1, 0);
+	if (ret)
+		return ret;
+
+	ret = mmc_test_area_io_seq(test, t->max_tfr, t->dev_addr, 1, 0, 0,
+				   t->max_sz / t->max_tfr, false, 0);
+	if (ret)
+		mmc_test_area_cleanup(test);
+
+	return ret;
+}
+
+/*
+ * Read performance sweep.
+ */
+static int mmc_test_bench_read(struct mmc_test_card *test)
+{
+	return mmc_test_bench(test, 0);
+}
+
+/*
+ * Write performance sweep.
+ */
+static int mmc_test_bench_write(struct mmc_test_card *test)
+{
+	return mmc_test_bench(test, 1);
+}
+
 /*
  * eMMC hardware reset.
  */
@@ -2926,6 +3463,20 @@ static const struct mmc_test_case mmc_test_cases[] = {
 		.run = mmc_test_cmds_during_write_cmd23_nonblock,
 		.cleanup = mmc_test_area_cleanup,
 	},
+
+	{
+		.name = "Read performance sweep",
+		.prepare = mmc_test_bench_prepare_read,
+		.run = mmc_test_bench_read,
+		.cleanup = mmc_test_area_cleanup,
+	},
+
+	{
+		.name = "Write performance sweep",
+		.prepare = mmc_test_area_prepare_erase,
+		.run = mmc_test_bench_write,
+		.cleanup = mmc_test_area_cleanup,
+	},
 };
 
 static DEFINE_MUTEX(mmc_test_lock);
@@ -2964,6 +3515,7 @@ static void mmc_test_run(struct mmc_test_card *test, int testcase)
 		gr = kzalloc(sizeof(*gr), GFP_KERNEL);
 		if (gr) {
 			INIT_LIST_HEAD(&gr->tr_lst);
+			INIT_LIST_HEAD(&gr->bench_lst);
 
 			/* Assign data what we know already */
 			gr->card = test->card;
@@ -3030,6 +3582,7 @@ static void mmc_test_free_result(struct mmc_card *card)
 
 	list_for_each_entry_safe(gr, grs, &mmc_test_result, link) {
 		struct mmc_test_transfer_result *tr, *trs;
+		struct mmc_test_bench_result *br, *brs;
 
 		if (card && gr->card != card)
 			continue;
@@ -3039,6 +3592,11 @@ static void mmc_test_free_result(struct mmc_card *card)
 			kfree(tr);
 		}
 
+		list_for_each_entry_safe(br, brs, &gr->bench_lst, link) {
+			list_del(&br->link);
+			kfree(br);
+		}
+
 		list_del(&gr->link);
 		kfree(gr);
 	}
@@ -3155,6 +3713,46 @@ static int mtf_testlist_show(struct seq_file *sf, void *data)
 
 DEFINE_SHOW_ATTRIBUTE(mtf_testlist);
 
+/*
+ * Performance sweep results, one point per line of key=value pairs.  The rate
+ * is in bytes per second and the times in nanoseconds.
+ */
+static int mtf_bench_show(struct seq_file *sf, void *data)
+{
+	struct mmc_card *card = (struct mmc_card *)sf->private;
+	struct mmc_test_general_result *gr;
+	struct mmc_test_bench_result *br;
+	int i;
+
+	mutex_lock(&mmc_test_lock);
+
+	list_for_each_entry(gr, &mmc_test_result, link) {
+		if (gr->card != card)
+			continue;
+
+		list_for_each_entry(br, &gr->bench_lst, link) {
+			seq_printf(sf, "test=%d op=%s queue=%s size=%u align=%u depth=%u count=%u ns=%llu rate=%u iops=%u.%02u",
+				   gr->testcase + 1,
+				   br->write ? "write" : "read",
+				   mmc_test_bench_queue_names[br->queue],
+				   br->size, br->align, br->depth, br->count,
+				   br->ns, br->rate, br->iops / 100,
+				   br->iops % 100);
+			for (i = 0; i < ARRAY_SIZE(br->lat); i++)
+				seq_printf(sf, " lat_%s=%llu",
+					   mmc_test_bench_lat[i].name,
+					   br->lat[i]);
+			seq_putc(sf, '\n');
+		}
+	}
+
+	mutex_unlock(&mmc_test_lock);
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(mtf_bench);
+
 static void mmc_test_free_dbgfs_file(struct mmc_card *card)
 {
 	struct mmc_test_dbgfs_file *df, *dfs;
@@ -3211,6 +3809,11 @@ static int mmc_test_register_dbgfs_file(struct mmc_card *card)
 	if (ret)
 		goto err;
 
+	ret = __mmc_test_register_dbgfs_file(card, "bench", S_IRUGO,
+		&mtf_bench_fops);
+	if (ret)
+		goto err;
+
 err:
 	mutex_unlock(&mmc_test_lock);
 
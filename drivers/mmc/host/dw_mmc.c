@@ -39,6 +39,7 @@
 #include <linux/mmc/slot-gpio.h>
 
 #include "dw_mmc.h"
+#include "mmc_hsq.h"
 
 /* Common flag combinations */
 #define DW_MCI_DATA_ERROR_FLAGS	(SDMMC_INT_DRTO | SDMMC_INT_DCRC | \
@@ -61,6 +62,8 @@
 				 SDMMC_IDMAC_INT_TI)
 
 #define DESC_RING_BUF_SZ	PAGE_SIZE
+/* The next request gets its descriptors built while the current one runs */
+#define DESC_RINGS		2
 
 struct idmac_desc_64addr {
 	u32		des0;	/* Control Descriptor */
@@ -499,8 +502,19 @@ static void dw_mci_dmac_complete_dma(void *arg)
 	}
 }
 
-static int dw_mci_idmac_init(struct dw_mci *host)
+static void *dw_mci_ring_cpu(struct dw_mci *host, unsigned int ring)
+{
+	return host->sg_cpu + ring * DESC_RING_BUF_SZ;
+}
+
+static dma_addr_t dw_mci_ring_dma(struct dw_mci *host, unsigned int ring)
+{
+	return host->sg_dma + ring * DESC_RING_BUF_SZ;
+}
+
+static void dw_mci_idmac_init_ring(struct dw_mci *host, unsigned int ring)
 {
+	dma_addr_t ring_dma = dw_mci_ring_dma(host, ring);
 	int i;
 
 	if (host->dma_64bit_address == 1) {
@@ -510,13 +524,13 @@ static int dw_mci_idmac_init(struct dw_mci *host)
 			DESC_RING_BUF_SZ / sizeof(struct idmac_desc_64addr);
 
 		/* Forward link the descriptor list */
-		for (i = 0, p = host->sg_cpu; i < host->ring_size - 1;
-								i++, p++) {
-			p->des6 = (host->sg_dma +
+		for (i = 0, p = dw_mci_ring_cpu(host, ring);
+		     i < host->ring_size - 1; i++, p++) {
+			p->des6 = (ring_dma +
 					(sizeof(struct idmac_desc_64addr) *
 							(i + 1))) & 0xffffffff;
 
-			p->des7 = (u64)(host->sg_dma +
+			p->des7 = (u64)(ring_dma +
 					(sizeof(struct idmac_desc_64addr) *
 							(i + 1))) >> 32;
 			/* Initialize reserved and buffer size fields to "0" */
@@ -527,8 +541,8 @@ static int dw_mci_idmac_init(struct dw_mci *host)
 		}
 
 		/* Set the last descriptor as the end-of-ring descriptor */
-		p->des6 = host->sg_dma & 0xffffffff;
-		p->des7 = (u64)host->sg_dma >> 32;
+		p->des6 = ring_dma & 0xffffffff;
+		p->des7 = (u64)ring_dma >> 32;
 		p->des0 = IDMAC_DES0_ER;
 
 	} else {
@@ -538,19 +552,44 @@ static int dw_mci_idmac_init(struct dw_mci *host)
 			DESC_RING_BUF_SZ / sizeof(struct idmac_desc);
 
 		/* Forward link the descriptor list */
-		for (i = 0, p = host->sg_cpu;
+		for (i = 0, p = dw_mci_ring_cpu(host, ring);
 		     i < host->ring_size - 1;
 		     i++, p++) {
-			p->des3 = cpu_to_le32(host->sg_dma +
+			p->des3 = cpu_to_le32(ring_dma +
 					(sizeof(struct idmac_desc) * (i + 1)));
 			p->des0 = 0;
 			p->des1 = 0;
 		}
 
 		/* Set the last descriptor as the end-of-ring descriptor */
-		p->des3 = cpu_to_le32(host->sg_dma);
+		p->des3 = cpu_to_le32(ring_dma);
 		p->des0 = cpu_to_le32(IDMAC_DES0_ER);
 	}
+}
+
+static void dw_mci_idmac_set_ring(struct dw_mci *host, unsigned int ring)
+{
+	dma_addr_t ring_dma = dw_mci_ring_dma(host, ring);
+
+	/* Set the descriptor base address */
+	if (host->dma_64bit_address == 1) {
+		mci_writel(host, DBADDRL, ring_dma & 0xffffffff);
+		mci_writel(host, DBADDRU, (u64)ring_dma >> 32);
+	} else {
+		mci_writel(host, DBADDR, ring_dma);
+	}
+}
+
+static int dw_mci_idmac_init(struct dw_mci *host)
+{
+	unsigned int ring;
+
+	for (ring = 0; ring < DESC_RINGS; ring++)
+		dw_mci_idmac_init_ring(host, ring);
+
+	host->ring = 0;
+	host->next_ring_data = NULL;
+	host->next_ring_busy = false;
 
 	dw_mci_idmac_reset(host);
 
@@ -559,25 +598,20 @@ static int dw_mci_idmac_init(struct dw_mci *host)
 		mci_writel(host, IDSTS64, IDMAC_INT_CLR);
 		mci_writel(host, IDINTEN64, SDMMC_IDMAC_INT_NI |
 				SDMMC_IDMAC_INT_RI | SDMMC_IDMAC_INT_TI);
-
-		/* Set the descriptor base address */
-		mci_writel(host, DBADDRL, host->sg_dma & 0xffffffff);
-		mci_writel(host, DBADDRU, (u64)host->sg_dma >> 32);
-
 	} else {
 		/* Mask out interrupts - get Tx & Rx complete only */
 		mci_writel(host, IDSTS, IDMAC_INT_CLR);
 		mci_writel(host, IDINTEN, SDMMC_IDMAC_INT_NI |
 				SDMMC_IDMAC_INT_RI | SDMMC_IDMAC_INT_TI);
-
-		/* Set the descriptor base address */
-		mci_writel(host, DBADDR, host->sg_dma);
 	}
 
+	dw_mci_idmac_set_ring(host, host->ring);
+
 	return 0;
 }
 
 static inline int dw_mci_prepare_desc64(struct dw_mci *host,
+					 unsigned int ring,
 					 struct mmc_data *data,
 					 unsigned int sg_len)
 {
@@ -586,7 +620,7 @@ static inline int dw_mci_prepare_desc64(struct dw_mci *host,
 	u32 val;
 	int i;
 
-	desc_first = desc_last = desc = host->sg_cpu;
+	desc_first = desc_last = desc = dw_mci_ring_cpu(host, ring);
 
 	for (i = 0; i < sg_len; i++) {
 		unsigned int length = sg_dma_len(&data->sg[i]);
@@ -643,13 +677,14 @@ static inline int dw_mci_prepare_desc64(struct dw_mci *host,
 err_own_bit:
 	/* restore the descriptor chain as it's polluted */
 	dev_dbg(host->dev, "descriptor is still owned by IDMAC.\n");
-	memset(host->sg_cpu, 0, DESC_RING_BUF_SZ);
-	dw_mci_idmac_init(host);
+	memset(dw_mci_ring_cpu(host, ring), 0, DESC_RING_BUF_SZ);
+	dw_mci_idmac_init_ring(host, ring);
 	return -EINVAL;
 }
 
 
 static inline int dw_mci_prepare_desc32(struct dw_mci *host,
+					 unsigned int ring,
 					 struct mmc_data *data,
 					 unsigned int sg_len)
 {
@@ -658,7 +693,7 @@ static inline int dw_mci_prepare_desc32(struct dw_mci *host,
 	u32 val;
 	int i;
 
-	desc_first = desc_last = desc = host->sg_cpu;
+	desc_first = desc_last = desc = dw_mci_ring_cpu(host, ring);
 
 	for (i = 0; i < sg_len; i++) {
 		unsigned int length = sg_dma_len(&data->sg[i]);
@@ -717,23 +752,67 @@ static inline int dw_mci_prepare_desc32(struct dw_mci *host,
 err_own_bit:
 	/* restore the descriptor chain as it's polluted */
 	dev_dbg(host->dev, "descriptor is still owned by IDMAC.\n");
-	memset(host->sg_cpu, 0, DESC_RING_BUF_SZ);
-	dw_mci_idmac_init(host);
+	memset(dw_mci_ring_cpu(host, ring), 0, DESC_RING_BUF_SZ);
+	dw_mci_idmac_init_ring(host, ring);
 	return -EINVAL;
 }
 
-static int dw_mci_idmac_start_dma(struct dw_mci *host, unsigned int sg_len)
+static int dw_mci_idmac_prepare(struct dw_mci *host, unsigned int ring,
+				struct mmc_data *data, unsigned int sg_len)
 {
-	u32 temp;
-	int ret;
-
 	if (host->dma_64bit_address == 1)
-		ret = dw_mci_prepare_desc64(host, host->data, sg_len);
+		return dw_mci_prepare_desc64(host, ring, data, sg_len);
 	else
-		ret = dw_mci_prepare_desc32(host, host->data, sg_len);
+		return dw_mci_prepare_desc32(host, ring, data, sg_len);
+}
 
-	if (ret)
-		goto out;
+/*
+ * Build the descriptors of a request in the ring not used by the current
+ * transfer, if no other request got it first.  The ring only becomes the
+ * current one when the request starts, so it's safe to fill it while the
+ * current transfer runs.
+ */
+static void dw_mci_idmac_pre_req(struct dw_mci *host, struct mmc_data *data,
+				 unsigned int sg_len)
+{
+	unsigned int ring;
+	int ret;
+
+	spin_lock_bh(&host->lock);
+	if (host->next_ring_data || host->next_ring_busy) {
+		spin_unlock_bh(&host->lock);
+		return;
+	}
+	host->next_ring_busy = true;
+	ring = host->ring ^ 1;
+	spin_unlock_bh(&host->lock);
+
+	ret = dw_mci_idmac_prepare(host, ring, data, sg_len);
+
+	spin_lock_bh(&host->lock);
+	host->next_ring_busy = false;
+	if (!ret)
+		host->next_ring_data = data;
+	spin_unlock_bh(&host->lock);
+}
+
+static int dw_mci_idmac_start_dma(struct dw_mci *host, unsigned int sg_len)
+{
+	unsigned int ring = host->ring;
+	u32 temp;
+	int ret = 0;
+
+	if (host->data == host->next_ring_data) {
+		/* The descriptors were built by dw_mci_pre_req() */
+		ring ^= 1;
+		host->next_ring_data = NULL;
+	} else {
+		/* The previous transfer is over, so its ring can be reused */
+		ret = dw_mci_idmac_prepare(host, ring, host->data, sg_len);
+		if (ret)
+			goto out;
+	}
+	host->ring = ring;
 
 	/* drain writebuffer */
 	wmb();
@@ -741,6 +820,7 @@ static int dw_mci_idmac_start_dma(struct dw_mci *host, unsigned int sg_len)
 	/* Make sure to reset DMA in case we did PIO before this */
 	dw_mci_ctrl_reset(host, SDMMC_CTRL_DMA_RESET);
 	dw_mci_idmac_reset(host);
+	dw_mci_idmac_set_ring(host, ring);
 
 	/* Select IDMAC interface */
 	temp = mci_readl(host, CTRL);
@@ -917,6 +997,7 @@ static void dw_mci_pre_req(struct mmc_host *mmc,
 {
 	struct dw_mci_slot *slot = mmc_priv(mmc);
 	struct mmc_data *data = mrq->data;
+	int sg_len;
 
 	if (!slot->host->use_dma || !data)
 		return;
@@ -924,9 +1005,15 @@ static void dw_mci_pre_req(struct mmc_host *mmc,
 	/* This data might be unmapped at this time */
 	data->host_cookie = COOKIE_UNMAPPED;
 
-	if (dw_mci_pre_dma_transfer(slot->host, mrq->data,
-				COOKIE_PRE_MAPPED) < 0)
+	sg_len = dw_mci_pre_dma_transfer(slot->host, mrq->data,
+					 COOKIE_PRE_MAPPED);
+	if (sg_len < 0) {
 		data->host_cookie = COOKIE_UNMAPPED;
+		return;
+	}
+
+	if (slot->host->use_dma == TRANS_MODE_IDMAC)
+		dw_mci_idmac_pre_req(slot->host, data, sg_len);
 }
 
 static void dw_mci_post_req(struct mmc_host *mmc,
@@ -939,6 +1026,14 @@ static void dw_mci_post_req(struct mmc_host *mmc,
 	if (!slot->host->use_dma || !data)
 		return;
 
+	/* Drop the descriptors of a request that didn't get started */
+	if (slot->host->use_dma == TRANS_MODE_IDMAC) {
+		spin_lock_bh(&slot->host->lock);
+		if (slot->host->next_ring_data == data)
+			slot->host->next_ring_data = NULL;
+		spin_unlock_bh(&slot->host->lock);
+	}
+
 	if (data->host_cookie != COOKIE_UNMAPPED)
 		dma_unmap_sg(slot->host->dev,
 			     data->sg,
@@ -1414,6 +1509,17 @@ static void dw_mci_queue_request(struct dw_mci *host, struct dw_mci_slot *slot,
 	}
 }
 
+static void dw_mci_mmc_request_done(struct dw_mci_slot *slot,
+				    struct mmc_request *mrq)
+{
+	/* The requests of the software queue complete through it */
+	if (test_bit(DW_MMC_CARD_USE_HSQ, &slot->flags) &&
+	    mmc_hsq_finalize_request(slot->mmc, mrq))
+		return;
+
+	mmc_request_done(slot->mmc, mrq);
+}
+
 static void dw_mci_request(struct mmc_host *mmc, struct mmc_request *mrq)
 {
 	struct dw_mci_slot *slot = mmc_priv(mmc);
@@ -1429,7 +1535,7 @@ static void dw_mci_request(struct mmc_host *mmc, struct mmc_request *mrq)
 
 	if (!dw_mci_get_cd(mmc)) {
 		mrq->cmd->error = -ENOMEDIUM;
-		mmc_request_done(mmc, mrq);
+		dw_mci_mmc_request_done(slot, mrq);
 		return;
 	}
 
@@ -1893,7 +1999,7 @@ static void dw_mci_request_end(struct dw_mci *host, struct mmc_request *mrq)
 	__acquires(&host->lock)
 {
 	struct dw_mci_slot *slot;
-	struct mmc_host	*prev_mmc = host->slot->mmc;
+	struct dw_mci_slot *prev_slot = host->slot;
 
 	WARN_ON(host->cmd || host->data);
 
@@ -1917,7 +2023,7 @@ static void dw_mci_request_end(struct dw_mci *host, struct mmc_request *mrq)
 	}
 
 	spin_unlock(&host->lock);
-	mmc_request_done(prev_mmc, mrq);
+	dw_mci_mmc_request_done(prev_slot, mrq);
 	spin_lock(&host->lock);
 }
 
@@ -2975,6 +3081,29 @@ static int dw_mci_init_slot(struct dw_mci *host)
 
 	dw_mci_get_cd(mmc);
 
+	/*
+	 * Let the core queue the requests to an eMMC through the software
+	 * queue, which starts the next request right from the completion of
+	 * the previous one, instead of a round trip through the block layer
+	 * per request.  Removable cards may have a card detect GPIO that
+	 * can't be read from the completion.
+	 */
+	if (!mmc_card_is_removable(mmc)) {
+		struct mmc_hsq *hsq;
+
+		hsq = devm_kzalloc(host->dev, sizeof(*hsq), GFP_KERNEL);
+		if (!hsq) {
+			ret = -ENOMEM;
+			goto err_host_allocated;
+		}
+
+		ret = mmc_hsq_init(hsq, mmc);
+		if (ret)
+			goto err_host_allocated;
+
+		set_bit(DW_MMC_CARD_USE_HSQ, &slot->flags);
+	}
+
 	ret = mmc_add_host(mmc);
 	if (ret)
 		goto err_host_allocated;
@@ -3049,7 +3178,7 @@ static void dw_mci_init_dma(struct dw_mci *host)
 
 		/* Alloc memory for sg translation */
 		host->sg_cpu = dmam_alloc_coherent(host->dev,
-						   DESC_RING_BUF_SZ,
+						   DESC_RINGS * DESC_RING_BUF_SZ,
 						   &host->sg_dma, GFP_KERNEL);
 		if (!host->sg_cpu) {
 			dev_err(host->dev,
@@ -3515,6 +3644,9 @@ int dw_mci_runtime_suspend(struct device *dev)
 {
 	struct dw_mci *host = dev_get_drvdata(dev);
 
+	if (host->slot && test_bit(DW_MMC_CARD_USE_HSQ, &host->slot->flags))
+		mmc_hsq_suspend(host->slot->mmc);
+
 	if (host->use_dma && host->dma_ops->exit)
 		host->dma_ops->exit(host);
 
@@ -3585,6 +3717,9 @@ int dw_mci_runtime_resume(struct device *dev)
 	/* Now that slots are all setup, we can enable card detect */
 	dw_mci_enable_cd(host);
 
+	if (host->slot && test_bit(DW_MMC_CARD_USE_HSQ, &host->slot->flags))
+		mmc_hsq_resume(host->slot->mmc);
+
 	return 0;
 
 err:
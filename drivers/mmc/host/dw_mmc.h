@@ -78,6 +78,10 @@ struct dw_mci_dma_slave {
  * @sg_dma: Bus address of DMA buffer.
  * @sg_cpu: Virtual address of DMA buffer.
  * @dma_ops: Pointer to platform-specific DMA callbacks.
+ * @ring: Index of the idma descriptor ring of the current transfer.
+ * @next_ring_data: Data of the request whose descriptors are in the other
+ *	ring, ready for it to start.
+ * @next_ring_busy: Whether descriptors are being built in the other ring.
  * @cmd_status: Snapshot of SR taken upon completion of the current
  * @ring_size: Buffer size for idma descriptors.
  *	command. Only valid when EVENT_CMD_COMPLETE is pending.
@@ -184,6 +188,9 @@ struct dw_mci {
 	const struct dw_mci_dma_ops	*dma_ops;
 	/* For idmac */
 	unsigned int		ring_size;
+	unsigned int		ring;
+	struct mmc_data		*next_ring_data;
+	bool			next_ring_busy;
 
 	/* For edmac */
 	struct dw_mci_dma_slave *dms;
@@ -549,6 +556,7 @@ struct dw_mci_slot {
 #define DW_MMC_CARD_NO_LOW_PWR	2
 #define DW_MMC_CARD_NO_USE_HOLD 3
 #define DW_MMC_CARD_NEEDS_POLL	4
+#define DW_MMC_CARD_USE_HSQ	5
 	int			id;
 	int			sdio_id;
 };
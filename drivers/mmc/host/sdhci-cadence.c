@@ -153,6 +153,18 @@ struct sdhci_cdns_priv {
 	struct sdhci_cdns_phy_param phy_params[];
 };
 
+/*
+ * The controller is always run in Host Version 4 mode.  Unless the Host
+ * Controller Version register can't be trusted, the features it reports
+ * from v4.10 on (64-bit V4 addressing, Auto CMD Auto Select...) are used.
+ */
+#define SDHCI_CDNS_QUIRK_FORCE_SPEC_400	BIT(0)
+
+struct sdhci_cdns_drv_data {
+	const struct sdhci_pltfm_data pltfm_data;
+	unsigned int quirks;
+};
+
 struct sdhci_cdns_phy_cfg {
 	const char *property;
 	u32 addr;
@@ -652,19 +664,27 @@ static const struct sdhci_ops sdhci_cdns_ops = {
 	.set_uhs_signaling = sdhci_cdns_set_uhs_signaling,
 };
 
-static const struct sdhci_pltfm_data sdhci_cdns_uniphier_pltfm_data = {
-	.ops = &sdhci_cdns_ops,
-	.quirks2 = SDHCI_QUIRK2_PRESET_VALUE_BROKEN,
+static const struct sdhci_cdns_drv_data sdhci_cdns_uniphier_drv_data = {
+	.pltfm_data = {
+		.ops = &sdhci_cdns_ops,
+		.quirks2 = SDHCI_QUIRK2_PRESET_VALUE_BROKEN,
+	},
+	.quirks = SDHCI_CDNS_QUIRK_FORCE_SPEC_400,
 };
 
-static const struct sdhci_pltfm_data sdhci_cdns_pltfm_data = {
-	.ops = &sdhci_cdns_ops,
-	.quirks2 = SDHCI_QUIRK2_PRESET_VALUE_BROKEN,
+static const struct sdhci_cdns_drv_data sdhci_cdns_drv_data = {
+	.pltfm_data = {
+		.ops = &sdhci_cdns_ops,
+		.quirks2 = SDHCI_QUIRK2_PRESET_VALUE_BROKEN,
+	},
+	.quirks = SDHCI_CDNS_QUIRK_FORCE_SPEC_400,
 };
 
-static const struct sdhci_pltfm_data sdhci_cdns_agilex5_pltfm_data = {
-	.ops = &sdhci_cdns_ops,
-	.quirks2 = SDHCI_QUIRK2_40_BIT_DMA_MASK,
+static const struct sdhci_cdns_drv_data sdhci_cdns_agilex5_drv_data = {
+	.pltfm_data = {
+		.ops = &sdhci_cdns_ops,
+		.quirks2 = SDHCI_QUIRK2_40_BIT_DMA_MASK,
+	},
 };
 
 static void sdhci_cdns_hs400_enhanced_strobe(struct mmc_host *mmc,
@@ -687,17 +707,30 @@ static void sdhci_cdns_hs400_enhanced_strobe(struct mmc_host *mmc,
 					 SDHCI_CDNS_HRS06_MODE_MMC_HS400);
 }
 
+static u16 sdhci_cdns_version(struct sdhci_host *host,
+			      const struct sdhci_cdns_drv_data *data)
+{
+	u16 version = sdhci_readw(host, SDHCI_HOST_VERSION);
+
+	if (data->quirks & SDHCI_CDNS_QUIRK_FORCE_SPEC_400 ||
+	    (version & SDHCI_SPEC_VER_MASK) >> SDHCI_SPEC_VER_SHIFT <
+	    SDHCI_SPEC_400)
+		return SDHCI_SPEC_400 << SDHCI_SPEC_VER_SHIFT;
+
+	return version;
+}
+
 static int sdhci_cdns_probe(struct platform_device *pdev)
 {
 	struct sdhci_host *host;
-	const struct sdhci_pltfm_data *data;
+	const struct sdhci_cdns_drv_data *data;
 	struct sdhci_pltfm_host *pltfm_host;
 	struct sdhci_cdns_priv *priv;
 	struct clk *clk;
 	unsigned int nr_phy_params;
 	int ret;
 	struct device *dev = &pdev->dev;
-	static const u16 version = SDHCI_SPEC_400 << SDHCI_SPEC_VER_SHIFT;
+	u16 version;
 
 	clk = devm_clk_get(dev, NULL);
 	if (IS_ERR(clk))
@@ -709,10 +742,10 @@ static int sdhci_cdns_probe(struct platform_device *pdev)
 
 	data = of_device_get_match_data(dev);
 	if (!data)
-		data = &sdhci_cdns_pltfm_data;
+		data = &sdhci_cdns_drv_data;
 
 	nr_phy_params = sdhci_cdns_phy_param_count(dev->of_node);
-	host = sdhci_pltfm_init(pdev, data,
+	host = sdhci_pltfm_init(pdev, &data->pltfm_data,
 				struct_size(priv, phy_params, nr_phy_params));
 	if (IS_ERR(host)) {
 		ret = PTR_ERR(host);
@@ -730,6 +763,7 @@ static int sdhci_cdns_probe(struct platform_device *pdev)
 	host->mmc_host_ops.hs400_enhanced_strobe =
 				sdhci_cdns_hs400_enhanced_strobe;
 	sdhci_enable_v4_mode(host);
+	version = sdhci_cdns_version(host, data);
 	__sdhci_read_caps(host, &version, NULL, NULL);
 
 	sdhci_get_of_property(pdev);
@@ -797,12 +831,12 @@ static const struct dev_pm_ops sdhci_cdns_pm_ops = {
 static const struct of_device_id sdhci_cdns_match[] = {
 	{
 		.compatible = "socionext,uniphier-sd4hc",
-		.data = &sdhci_cdns_uniphier_pltfm_data,
+		.data = &sdhci_cdns_uniphier_drv_data,
 	},
 	{ .compatible = "cdns,sd4hc" },
 	{
 		.compatible = "intel,agilex5-sd4hc",
-		.data = &sdhci_cdns_agilex5_pltfm_data,
+		.data = &sdhci_cdns_agilex5_drv_data,
 	},
 	{ /* sentinel */ }
 };
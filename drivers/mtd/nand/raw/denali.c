@@ -40,6 +40,9 @@
 
 #define DENALI_INVALID_BANK	-1
 
+/* number of pages read by a pipelined read-ahead */
+#define DENALI_READ_AHEAD_PAGES	4
+
 static struct denali_chip *to_denali_chip(struct nand_chip *chip)
 {
 	return container_of(chip, struct denali_chip, chip);
@@ -545,10 +548,10 @@ static int denali_sw_ecc_fixup(struct nand_chip *chip,
 }
 
 static void denali_setup_dma64(struct denali_controller *denali,
-			       dma_addr_t dma_addr, int page, bool write)
+			       dma_addr_t dma_addr, int page, int page_count,
+			       bool write)
 {
 	u32 mode;
-	const int page_count = 1;
 
 	mode = DENALI_MAP10 | DENALI_BANK(denali) | page;
 
@@ -570,10 +573,10 @@ static void denali_setup_dma64(struct denali_controller *denali,
 }
 
 static void denali_setup_dma32(struct denali_controller *denali,
-			       dma_addr_t dma_addr, int page, bool write)
+			       dma_addr_t dma_addr, int page, int page_count,
+			       bool write)
 {
 	u32 mode;
-	const int page_count = 1;
 
 	mode = DENALI_MAP10 | DENALI_BANK(denali);
 
@@ -689,7 +692,7 @@ static int denali_dma_xfer(struct denali_controller *denali, void *buf,
 	ioread32(denali->reg + DMA_ENABLE);
 
 	denali_reset_irq(denali);
-	denali->setup_dma(denali, dma_addr, page, write);
+	denali->setup_dma(denali, dma_addr, page, 1, write);
 
 	irq_status = denali_wait_for_irq(denali, irq_mask);
 	if (!(irq_status & INTR__DMA_CMD_COMP))
@@ -720,6 +723,100 @@ static int denali_page_xfer(struct nand_chip *chip, void *buf, size_t size,
 		return denali_pio_xfer(denali, buf, size, page, write);
 }
 
+static void denali_read_ahead_invalidate(struct nand_chip *chip)
+{
+	to_denali_chip(chip)->ra_count = 0;
+}
+
+/*
+ * Read @count pages from @page on in a single pipelined DMA command, so the
+ * controller keeps the flash busy reading the next page while the previous
+ * one is transferred.  The ECC status is only reported for the whole
+ * transfer, so it is kept only if no sector needed a correction; any other
+ * page is read again on its own by the caller.
+ */
+static int denali_read_ahead_fill(struct nand_chip *chip, int page, int count)
+{
+	struct denali_controller *denali = to_denali_controller(chip);
+	struct denali_chip *dchip = to_denali_chip(chip);
+	size_t size = count * nand_to_mtd(chip)->writesize;
+	dma_addr_t dma_addr;
+	u32 irq_status, ecc_cor;
+	int ret = 0;
+
+	dchip->ra_count = 0;
+
+	dma_addr = dma_map_single(denali->dev, dchip->ra_buf, size,
+				  DMA_FROM_DEVICE);
+	if (dma_mapping_error(denali->dev, dma_addr))
+		return -ENOMEM;
+
+	denali_select_target(chip, chip->cur_cs);
+
+	iowrite32(DMA_ENABLE__FLAG, denali->reg + DMA_ENABLE);
+	ioread32(denali->reg + DMA_ENABLE);
+
+	denali_reset_irq(denali);
+	denali->setup_dma(denali, dma_addr, page, count, false);
+
+	irq_status = denali_wait_for_irq(denali, INTR__DMA_CMD_COMP);
+	if (!(irq_status & INTR__DMA_CMD_COMP) ||
+	    irq_status & (INTR__ECC_UNCOR_ERR | INTR__ERASED_PAGE))
+		ret = -EIO;
+
+	iowrite32(0, denali->reg + DMA_ENABLE);
+
+	dma_unmap_single(denali->dev, dma_addr, size, DMA_FROM_DEVICE);
+
+	if (ret)
+		return ret;
+
+	ecc_cor = ioread32(denali->reg + ECC_COR_INFO(denali->active_bank));
+	ecc_cor >>= ECC_COR_INFO__SHIFT(denali->active_bank);
+	if (ecc_cor & (ECC_COR_INFO__UNCOR_ERR | ECC_COR_INFO__MAX_ERRORS))
+		return -EIO;
+
+	dchip->ra_cs = chip->cur_cs;
+	dchip->ra_page = page;
+	dchip->ra_count = count;
+
+	return 0;
+}
+
+static bool denali_read_ahead(struct nand_chip *chip, u8 *buf, int page)
+{
+	struct denali_chip *dchip = to_denali_chip(chip);
+	struct mtd_info *mtd = nand_to_mtd(chip);
+	int pages_per_block = 1 << (chip->phys_erase_shift - chip->page_shift);
+	bool sequential;
+	int count;
+
+	sequential = dchip->ra_next == page && dchip->ra_next_cs == chip->cur_cs;
+	dchip->ra_next = page + 1;
+	dchip->ra_next_cs = chip->cur_cs;
+
+	if (!dchip->ra_buf)
+		return false;
+
+	if (!dchip->ra_count || dchip->ra_cs != chip->cur_cs ||
+	    page < dchip->ra_page || page >= dchip->ra_page + dchip->ra_count) {
+		/* random reads are not worth reading ahead */
+		if (!sequential)
+			return false;
+
+		/* the pipeline does not cross erase blocks */
+		count = min(DENALI_READ_AHEAD_PAGES,
+			    pages_per_block - (page & (pages_per_block - 1)));
+		if (count < 2 || denali_read_ahead_fill(chip, page, count))
+			return false;
+	}
+
+	memcpy(buf, dchip->ra_buf + (page - dchip->ra_page) * mtd->writesize,
+	       mtd->writesize);
+
+	return true;
+}
+
 static int denali_read_page(struct nand_chip *chip, u8 *buf,
 			    int oob_required, int page)
 {
@@ -729,6 +826,9 @@ static int denali_read_page(struct nand_chip *chip, u8 *buf,
 	int stat = 0;
 	int ret;
 
+	if (denali_read_ahead(chip, buf, page))
+		return 0;
+
 	ret = denali_page_xfer(chip, buf, mtd->writesize, page, false);
 	if (ret && ret != -EBADMSG)
 		return ret;
@@ -758,6 +858,8 @@ static int denali_write_page(struct nand_chip *chip, const u8 *buf,
 {
 	struct mtd_info *mtd = nand_to_mtd(chip);
 
+	denali_read_ahead_invalidate(chip);
+
 	return denali_page_xfer(chip, (void *)buf, mtd->writesize, page, true);
 }
 
@@ -1012,6 +1114,7 @@ static int denali_multidev_fixup(struct nand_chip *chip)
 static int denali_attach_chip(struct nand_chip *chip)
 {
 	struct denali_controller *denali = to_denali_controller(chip);
+	struct denali_chip *dchip = to_denali_chip(chip);
 	struct mtd_info *mtd = nand_to_mtd(chip);
 	int ret;
 
@@ -1030,6 +1133,18 @@ static int denali_attach_chip(struct nand_chip *chip)
 	if (ret)
 		return ret;
 
+	/*
+	 * The pipelined read-ahead relies on ECC_COR_INFO to tell if a page of
+	 * the transfer needed a correction.  Without the buffer, pages are
+	 * just read one by one.
+	 */
+	if (denali->dma_avail && denali->caps & DENALI_CAP_HW_ECC_FIXUP)
+		dchip->ra_buf = devm_kmalloc(denali->dev,
+					     DENALI_READ_AHEAD_PAGES *
+					     mtd->writesize, GFP_KERNEL);
+	dchip->ra_count = 0;
+	dchip->ra_next = -1;
+
 	return 0;
 }
 
@@ -1153,6 +1268,9 @@ static int denali_exec_op(struct nand_chip *chip,
 	if (check_only)
 		return 0;
 
+	/* raw accesses, programs and erases bypass the read-ahead buffer */
+	denali_read_ahead_invalidate(chip);
+
 	denali_select_target(chip, op->cs);
 
 	/*
@@ -319,14 +319,26 @@ struct denali_chip_sel {
 /**
  * struct denali_chip - per-chip data of Denali NAND
  *
- * @chip:  base NAND chip structure
- * @node:  node to be used to associate this chip with the controller
- * @nsels: the number of CS lines of this chip
- * @sels:  the array of per-cs data
+ * @chip:       base NAND chip structure
+ * @node:       node to be used to associate this chip with the controller
+ * @ra_buf:     buffer of the pipelined read-ahead, NULL if not used
+ * @ra_cs:      CS the pages in @ra_buf were read from
+ * @ra_page:    first page in @ra_buf
+ * @ra_count:   number of valid pages in @ra_buf
+ * @ra_next:    page following the last page read with ECC
+ * @ra_next_cs: CS of the last page read with ECC
+ * @nsels:      the number of CS lines of this chip
+ * @sels:       the array of per-cs data
  */
 struct denali_chip {
 	struct nand_chip chip;
 	struct list_head node;
+	u8 *ra_buf;
+	int ra_cs;
+	int ra_page;
+	int ra_count;
+	int ra_next;
+	int ra_next_cs;
 	unsigned int nsels;
 	struct denali_chip_sel sels[];
 };
@@ -383,7 +395,7 @@ struct denali_controller {
 	void (*host_write)(struct denali_controller *denali, u32 addr,
 			   u32 data);
 	void (*setup_dma)(struct denali_controller *denali, dma_addr_t dma_addr,
-			  int page, bool write);
+			  int page, int page_count, bool write);
 };
 
 #define DENALI_CAP_HW_ECC_FIXUP			BIT(0)
@@ -171,4 +171,15 @@ int nand_onfi_detect(struct nand_chip *chip);
 /* JEDEC functions */
 int nand_jedec_detect(struct nand_chip *chip);
 
+/* Background scrubber functions */
+#if IS_ENABLED(CONFIG_MTD_RAW_NAND_SCRUB)
+void nand_scrub_init(struct nand_chip *chip);
+void nand_scrub_cleanup(struct nand_chip *chip);
+void nand_scrub_access(struct nand_chip *chip);
+#else
+static inline void nand_scrub_init(struct nand_chip *chip) {}
+static inline void nand_scrub_cleanup(struct nand_chip *chip) {}
+static inline void nand_scrub_access(struct nand_chip *chip) {}
+#endif
+
 #endif /* __LINUX_RAWNAND_INTERNALS */
@@ -343,6 +343,7 @@ static void nand_get_device(struct nand_chip *chip)
 		mutex_lock(&chip->lock);
 		if (!chip->suspended) {
 			mutex_lock(&chip->controller->lock);
+			nand_scrub_access(chip);
 			return;
 		}
 		mutex_unlock(&chip->lock);
@@ -6410,6 +6411,8 @@ int nand_scan_with_ids(struct nand_chip *chip, unsigned int maxchips,
 	if (ret)
 		goto detach_chip;
 
+	nand_scrub_init(chip);
+
 	return 0;
 
 detach_chip:
@@ -6427,6 +6430,8 @@ EXPORT_SYMBOL(nand_scan_with_ids);
  */
 void nand_cleanup(struct nand_chip *chip)
 {
+	nand_scrub_cleanup(chip);
+
 	if (chip->ecc.engine_type == NAND_ECC_ENGINE_TYPE_SOFT) {
 		if (chip->ecc.algo == NAND_ECC_ALGO_HAMMING)
 			rawnand_sw_hamming_cleanup(chip);
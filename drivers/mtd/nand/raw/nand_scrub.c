@@ -0,0 +1,318 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Background bitflip scrubbing of raw NAND chips
+ *
+ * Once a chip has been left idle for scrub_idle_ms, the pages of its good
+ * blocks are read with ECC one at a time, scrub_interval_ms apart.  The
+ * maximum number of bitflips seen in each block is recorded, and the upper
+ * layers registered with nand_scrub_register_notifier() are told about the
+ * blocks reaching the bitflip threshold of the MTD device, so they can move
+ * the data before it becomes uncorrectable instead of finding out when a
+ * read fails.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/jiffies.h>
+#include <linux/module.h>
+#include <linux/mtd/mtd.h>
+#include <linux/notifier.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+
+#include "internals.h"
+
+#define NAND_SCRUB_UNSCANNED		U8_MAX
+#define NAND_SCRUB_UNCORRECTABLE	(U8_MAX - 1)
+
+static unsigned int scrub_interval_ms = 100;
+module_param(scrub_interval_ms, uint, 0644);
+MODULE_PARM_DESC(scrub_interval_ms,
+		 "Delay between two pages read by the scrubber (0 = paused)");
+
+static unsigned int scrub_idle_ms = 1000;
+module_param(scrub_idle_ms, uint, 0644);
+MODULE_PARM_DESC(scrub_idle_ms,
+		 "Time a chip must have been idle before it is scrubbed");
+
+static BLOCKING_NOTIFIER_HEAD(nand_scrub_chain);
+
+/**
+ * struct nand_scrub - background scrubber of a NAND chip
+ * @chip: the NAND chip
+ * @work: work reading the next page
+ * @last_access: jiffies of the last access to the chip not made by @work
+ * @buf: page buffer
+ * @bitflips: per-block maximum number of bitflips of the last scan
+ * @block: block being scanned
+ * @page: next page of @block to read
+ * @max_bitflips: maximum number of bitflips seen so far in @block
+ * @passes: number of complete scans of the chip
+ * @dfs: debugfs file
+ */
+struct nand_scrub {
+	struct nand_chip *chip;
+	struct delayed_work work;
+	unsigned long last_access;
+	u8 *buf;
+	u8 *bitflips;
+	unsigned int block;
+	unsigned int page;
+	unsigned int max_bitflips;
+	unsigned long passes;
+	struct dentry *dfs;
+};
+
+/**
+ * nand_scrub_register_notifier - Get notified of the blocks to relocate
+ * @nb: notifier block
+ *
+ * @nb is called with NAND_SCRUB_EV_BITFLIPS or NAND_SCRUB_EV_UNCORRECTABLE
+ * and a struct nand_scrub_event describing the block.
+ *
+ * Returns 0 on success, a negative error code otherwise.
+ */
+int nand_scrub_register_notifier(struct notifier_block *nb)
+{
+	return blocking_notifier_chain_register(&nand_scrub_chain, nb);
+}
+EXPORT_SYMBOL_GPL(nand_scrub_register_notifier);
+
+/**
+ * nand_scrub_unregister_notifier - Stop getting notified of blocks to relocate
+ * @nb: notifier block passed to nand_scrub_register_notifier()
+ *
+ * Returns 0 on success, a negative error code otherwise.
+ */
+int nand_scrub_unregister_notifier(struct notifier_block *nb)
+{
+	return blocking_notifier_chain_unregister(&nand_scrub_chain, nb);
+}
+EXPORT_SYMBOL_GPL(nand_scrub_unregister_notifier);
+
+static int nand_scrub_show(struct seq_file *s, void *data)
+{
+	struct nand_scrub *scrub = s->private;
+	struct nand_chip *chip = scrub->chip;
+	struct mtd_info *mtd = nand_to_mtd(chip);
+	unsigned int nblocks = nanddev_neraseblocks(&chip->base);
+	unsigned int *hist, uncorrectable = 0, unscanned = 0;
+	unsigned int i, bitflips;
+
+	hist = kcalloc(mtd->ecc_strength + 1, sizeof(*hist), GFP_KERNEL);
+	if (!hist)
+		return -ENOMEM;
+
+	for (i = 0; i < nblocks; i++) {
+		bitflips = READ_ONCE(scrub->bitflips[i]);
+		if (bitflips == NAND_SCRUB_UNSCANNED)
+			unscanned++;
+		else if (bitflips > mtd->ecc_strength)
+			uncorrectable++;
+		else
+			hist[bitflips]++;
+	}
+
+	seq_printf(s, "passes:\t\t%lu\n", READ_ONCE(scrub->passes));
+	seq_printf(s, "block:\t\t%u\n", READ_ONCE(scrub->block));
+	seq_printf(s, "threshold:\t%u\n", mtd->bitflip_threshold);
+	seq_printf(s, "unscanned:\t%u\n", unscanned);
+	seq_printf(s, "uncorrectable:\t%u\n", uncorrectable);
+	seq_puts(s, "bitflips\tblocks\n");
+	for (i = 0; i <= mtd->ecc_strength; i++)
+		if (hist[i])
+			seq_printf(s, "%u\t\t%u\n", i, hist[i]);
+
+	kfree(hist);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(nand_scrub);
+
+/*
+ * The MTD device directory only exists once the device is registered, which
+ * happens after nand_scan().  It is removed along with our file when the
+ * device is unregistered, before nand_cleanup() frees the scrubber.
+ */
+static void nand_scrub_debugfs(struct nand_scrub *scrub)
+{
+	struct mtd_info *mtd = nand_to_mtd(scrub->chip);
+
+	if (scrub->dfs || IS_ERR_OR_NULL(mtd->dbg.dfs_dir) ||
+	    !device_is_registered(&mtd->dev))
+		return;
+
+	scrub->dfs = debugfs_create_file("nand_scrub", 0400, mtd->dbg.dfs_dir,
+					 scrub, &nand_scrub_fops);
+}
+
+static void nand_scrub_notify(struct nand_scrub *scrub, unsigned int bitflips)
+{
+	struct nand_chip *chip = scrub->chip;
+	struct nand_scrub_event event = {
+		.mtd = nand_to_mtd(chip),
+		.ofs = (loff_t)scrub->block << chip->phys_erase_shift,
+		.bitflips = bitflips,
+	};
+
+	if (bitflips == NAND_SCRUB_UNCORRECTABLE)
+		blocking_notifier_call_chain(&nand_scrub_chain,
+					     NAND_SCRUB_EV_UNCORRECTABLE,
+					     &event);
+	else
+		blocking_notifier_call_chain(&nand_scrub_chain,
+					     NAND_SCRUB_EV_BITFLIPS, &event);
+}
+
+static void nand_scrub_next_block(struct nand_scrub *scrub)
+{
+	scrub->page = 0;
+	scrub->max_bitflips = 0;
+
+	if (++scrub->block == nanddev_neraseblocks(&scrub->chip->base)) {
+		scrub->block = 0;
+		scrub->passes++;
+	}
+}
+
+static void nand_scrub_page(struct nand_scrub *scrub)
+{
+	struct nand_chip *chip = scrub->chip;
+	struct mtd_info *mtd = nand_to_mtd(chip);
+	unsigned int pages_per_block = nanddev_pages_per_eraseblock(&chip->base);
+	struct mtd_req_stats stats = { };
+	struct mtd_oob_ops ops = {
+		.mode = MTD_OPS_PLACE_OOB,
+		.len = mtd->writesize,
+		.datbuf = scrub->buf,
+		.stats = &stats,
+	};
+	loff_t ofs = ((loff_t)scrub->block << chip->phys_erase_shift) +
+		     ((loff_t)scrub->page << chip->page_shift);
+	unsigned int bitflips;
+	int ret;
+
+	if (!scrub->page && mtd_block_isbad(mtd, ofs)) {
+		scrub->bitflips[scrub->block] = NAND_SCRUB_UNSCANNED;
+		nand_scrub_next_block(scrub);
+		return;
+	}
+
+	ret = mtd_read_oob(mtd, ofs, &ops);
+	if (ret == -EBADMSG) {
+		bitflips = NAND_SCRUB_UNCORRECTABLE;
+	} else if (ret && !mtd_is_bitflip(ret)) {
+		/* give up on this block until the next pass */
+		scrub->bitflips[scrub->block] = NAND_SCRUB_UNSCANNED;
+		nand_scrub_next_block(scrub);
+		return;
+	} else {
+		bitflips = stats.max_bitflips;
+	}
+
+	scrub->max_bitflips = max(scrub->max_bitflips, bitflips);
+
+	/* a block to relocate doesn't need to be read any further */
+	if (++scrub->page < pages_per_block &&
+	    scrub->max_bitflips < mtd->bitflip_threshold)
+		return;
+
+	scrub->bitflips[scrub->block] = scrub->max_bitflips;
+	if (scrub->max_bitflips >= mtd->bitflip_threshold)
+		nand_scrub_notify(scrub, scrub->max_bitflips);
+
+	nand_scrub_next_block(scrub);
+}
+
+static void nand_scrub_work(struct work_struct *work)
+{
+	struct nand_scrub *scrub = container_of(to_delayed_work(work),
+						struct nand_scrub, work);
+	unsigned long idle = msecs_to_jiffies(scrub_idle_ms);
+	unsigned long delay = msecs_to_jiffies(scrub_interval_ms);
+
+	nand_scrub_debugfs(scrub);
+
+	if (!scrub_interval_ms ||
+	    time_before(jiffies, READ_ONCE(scrub->last_access) + idle))
+		delay = max(idle, 1UL);
+	else
+		nand_scrub_page(scrub);
+
+	queue_delayed_work(system_freezable_power_efficient_wq, &scrub->work,
+			   delay);
+}
+
+/**
+ * nand_scrub_access - Note an access to the chip
+ * @chip: NAND chip object
+ *
+ * Called with the chip lock held.  Accesses made by the scrubber itself do
+ * not count.
+ */
+void nand_scrub_access(struct nand_chip *chip)
+{
+	struct nand_scrub *scrub = chip->scrub;
+
+	if (scrub && current_work() != &scrub->work.work)
+		WRITE_ONCE(scrub->last_access, jiffies);
+}
+
+/**
+ * nand_scrub_init - Start the background scrubber of a chip
+ * @chip: NAND chip object
+ *
+ * Failing to start the scrubber is not fatal, the chip works without it.
+ */
+void nand_scrub_init(struct nand_chip *chip)
+{
+	struct mtd_info *mtd = nand_to_mtd(chip);
+	unsigned int nblocks = nanddev_neraseblocks(&chip->base);
+	struct nand_scrub *scrub;
+
+	/* nothing to learn without ECC */
+	if (!mtd->ecc_strength || !nblocks)
+		return;
+
+	scrub = kzalloc(sizeof(*scrub), GFP_KERNEL);
+	if (!scrub)
+		return;
+
+	scrub->buf = kmalloc(mtd->writesize, GFP_KERNEL);
+	scrub->bitflips = kvmalloc(nblocks, GFP_KERNEL);
+	if (!scrub->buf || !scrub->bitflips) {
+		kvfree(scrub->bitflips);
+		kfree(scrub->buf);
+		kfree(scrub);
+		return;
+	}
+
+	memset(scrub->bitflips, NAND_SCRUB_UNSCANNED, nblocks);
+	scrub->chip = chip;
+	scrub->last_access = jiffies;
+	INIT_DELAYED_WORK(&scrub->work, nand_scrub_work);
+
+	chip->scrub = scrub;
+
+	queue_delayed_work(system_freezable_power_efficient_wq, &scrub->work,
+			   msecs_to_jiffies(scrub_idle_ms));
+}
+
+/**
+ * nand_scrub_cleanup - Stop the background scrubber of a chip
+ * @chip: NAND chip object
+ */
+void nand_scrub_cleanup(struct nand_chip *chip)
+{
+	struct nand_scrub *scrub = chip->scrub;
+
+	if (!scrub)
+		return;
+
+	cancel_delayed_work_sync(&scrub->work);
+	chip->scrub = NULL;
+
+	kvfree(scrub->bitflips);
+	kfree(scrub->buf);
+	kfree(scrub);
+}
@@ -356,6 +356,28 @@ static int spinand_load_page_op(struct spinand_device *spinand,
 	return spi_mem_exec_op(spinand->spimem, &op);
 }
 
+/*
+ * Move the page waiting in the data register of a sequential read to the
+ * cache, and start loading the @next page unless it's the last one.
+ */
+static int spinand_read_cache_next_op(struct spinand_device *spinand,
+				      const struct nand_pos *next)
+{
+	struct nand_device *nand = spinand_to_nand(spinand);
+	unsigned int row = next ? nanddev_pos_to_row(nand, next) : 0;
+	struct spi_mem_op rnd = SPINAND_PAGE_READ_CACHE_RANDOM_OP(row);
+	struct spi_mem_op seq = SPINAND_PAGE_READ_CACHE_SEQ_OP;
+	struct spi_mem_op last = SPINAND_PAGE_READ_CACHE_LAST_OP;
+	struct spi_mem_op *op = &last;
+
+	if (next && spinand->flags & SPINAND_HAS_READ_CACHE_RANDOM)
+		op = &rnd;
+	else if (next)
+		op = &seq;
+
+	return spi_mem_exec_op(spinand->spimem, op);
+}
+
 static int spinand_read_from_cache_op(struct spinand_device *spinand,
 				      const struct nand_page_io_req *req)
 {
@@ -630,13 +652,12 @@ static int spinand_write_page(struct spinand_device *spinand,
 	return nand_ecc_finish_io_req(nand, (struct nand_page_io_req *)req);
 }
 
-static int spinand_mtd_read(struct mtd_info *mtd, loff_t from,
-			    struct mtd_oob_ops *ops)
+static int spinand_mtd_regular_page_read(struct mtd_info *mtd, loff_t from,
+					 struct mtd_oob_ops *ops,
+					 unsigned int *max_bitflips)
 {
 	struct spinand_device *spinand = mtd_to_spinand(mtd);
 	struct nand_device *nand = mtd_to_nanddev(mtd);
-	struct mtd_ecc_stats old_stats;
-	unsigned int max_bitflips = 0;
 	struct nand_io_iter iter;
 	bool disable_ecc = false;
 	bool ecc_failed = false;
@@ -645,10 +666,6 @@ static int spinand_mtd_read(struct mtd_info *mtd, loff_t from,
 	if (ops->mode == MTD_OPS_RAW || !spinand->eccinfo.ooblayout)
 		disable_ecc = true;
 
-	mutex_lock(&spinand->lock);
-
-	old_stats = mtd->ecc_stats;
-
 	nanddev_io_for_each_page(nand, NAND_PAGE_READ, from, ops, &iter) {
 		if (disable_ecc)
 			iter.req.mode = MTD_OPS_RAW;
@@ -664,13 +681,287 @@ static int spinand_mtd_read(struct mtd_info *mtd, loff_t from,
 		if (ret == -EBADMSG)
 			ecc_failed = true;
 		else
-			max_bitflips = max_t(unsigned int, max_bitflips, ret);
+			*max_bitflips = max_t(unsigned int, *max_bitflips, ret);
+
+		ret = 0;
+		ops->retlen += iter.req.datalen;
+		ops->oobretlen += iter.req.ooblen;
+	}
+
+	if (ecc_failed && !ret)
+		ret = -EBADMSG;
+
+	return ret;
+}
+
+/*
+ * Sequential reads with READ PAGE CACHE SEQUENTIAL/RANDOM: the device loads
+ * the next page in its data register while the host reads the current one
+ * out of the cache.  A sequence doesn't cross eraseblocks, so that no
+ * device has to carry it on into another block, plane or die.
+ */
+static int spinand_mtd_cache_seq_page_read(struct mtd_info *mtd, loff_t from,
+					   struct mtd_oob_ops *ops,
+					   unsigned int *max_bitflips)
+{
+	struct spinand_device *spinand = mtd_to_spinand(mtd);
+	struct nand_device *nand = mtd_to_nanddev(mtd);
+	unsigned int pages_per_block = nanddev_pages_per_eraseblock(nand);
+	struct nand_io_iter iter;
+	struct nand_pos next;
+	bool disable_ecc = false;
+	bool ecc_failed = false;
+	bool running = false;
+	bool last;
+	u8 status;
+	int ret = 0;
+
+	if (ops->mode == MTD_OPS_RAW || !spinand->eccinfo.ooblayout)
+		disable_ecc = true;
+
+	nanddev_io_for_each_page(nand, NAND_PAGE_READ, from, ops, &iter) {
+		if (disable_ecc)
+			iter.req.mode = MTD_OPS_RAW;
+
+		last = iter.req.pos.page == pages_per_block - 1 ||
+		       (iter.dataleft == iter.req.datalen &&
+			iter.oobleft == iter.req.ooblen);
+
+		ret = nand_ecc_prepare_io_req(nand, &iter.req);
+		if (ret)
+			break;
+
+		if (!running) {
+			ret = spinand_select_target(spinand,
+						    iter.req.pos.target);
+			if (ret)
+				break;
+
+			ret = spinand_load_page_op(spinand, &iter.req);
+			if (ret)
+				break;
+
+			ret = spinand_wait(spinand,
+					   SPINAND_READ_INITIAL_DELAY_US,
+					   SPINAND_READ_POLL_DELAY_US,
+					   &status);
+			if (ret < 0)
+				break;
+		}
+
+		/* a sequence of a single page is a regular page read */
+		if (running || !last) {
+			next = iter.req.pos;
+			nanddev_pos_next_page(nand, &next);
+
+			ret = spinand_read_cache_next_op(spinand,
+							 last ? NULL : &next);
+			if (ret)
+				break;
+
+			ret = spinand_wait(spinand,
+					   SPINAND_READ_INITIAL_DELAY_US,
+					   SPINAND_READ_POLL_DELAY_US,
+					   &status);
+			if (ret < 0)
+				break;
+		}
+
+		running = !last;
+
+		spinand_ondie_ecc_save_status(nand, status);
+
+		ret = spinand_read_from_cache_op(spinand, &iter.req);
+		if (ret)
+			break;
+
+		ret = nand_ecc_finish_io_req(nand, &iter.req);
+		if (ret < 0 && ret != -EBADMSG)
+			break;
+
+		if (ret == -EBADMSG)
+			ecc_failed = true;
+		else
+			*max_bitflips = max_t(unsigned int, *max_bitflips, ret);
 
 		ret = 0;
 		ops->retlen += iter.req.datalen;
 		ops->oobretlen += iter.req.ooblen;
 	}
 
+	/* don't leave the device in the middle of a sequence */
+	if (ret && running &&
+	    !spinand_read_cache_next_op(spinand, NULL))
+		spinand_wait(spinand, SPINAND_READ_INITIAL_DELAY_US,
+			     SPINAND_READ_POLL_DELAY_US, NULL);
+
+	if (ecc_failed && !ret)
+		ret = -EBADMSG;
+
+	return ret;
+}
+
+/*
+ * Read @npages pages in continuous read mode, from the first byte of the
+ * page of @req into spinand->contbuf.  The ECC status is the one of the
+ * whole run, it only tells the maximum number of bitflips of the pages.
+ */
+static int spinand_read_cont_pages(struct spinand_device *spinand,
+				   struct nand_page_io_req *req,
+				   unsigned int npages)
+{
+	struct nand_device *nand = spinand_to_nand(spinand);
+	struct spi_mem_dirmap_desc *rdesc;
+	size_t nbytes = npages * nanddev_page_size(nand);
+	u8 status;
+	ssize_t ret;
+	int err;
+
+	ret = nand_ecc_prepare_io_req(nand, req);
+	if (ret)
+		return ret;
+
+	ret = spinand->set_cont_read(spinand, true);
+	if (ret)
+		return ret;
+
+	ret = spinand_load_page_op(spinand, req);
+	if (!ret)
+		ret = spinand_wait(spinand,
+				   SPINAND_READ_INITIAL_DELAY_US,
+				   SPINAND_READ_POLL_DELAY_US,
+				   NULL);
+	if (!ret) {
+		rdesc = spinand->dirmaps[req->pos.plane].rdesc_cont;
+		ret = spi_mem_dirmap_read(rdesc, 0, nbytes, spinand->contbuf);
+		/* deasserting the CS ends the run, it can't be resumed */
+		if (ret >= 0)
+			ret = ret == nbytes ? 0 : -EIO;
+	}
+
+	err = spinand->set_cont_read(spinand, false);
+	if (ret)
+		return ret;
+	if (err)
+		return err;
+
+	ret = spinand_read_status(spinand, &status);
+	if (ret)
+		return ret;
+
+	spinand_ondie_ecc_save_status(nand, status);
+
+	return nand_ecc_finish_io_req(nand, req);
+}
+
+static int spinand_mtd_cont_page_read(struct mtd_info *mtd, loff_t from,
+				      struct mtd_oob_ops *ops,
+				      unsigned int *max_bitflips)
+{
+	struct spinand_device *spinand = mtd_to_spinand(mtd);
+	struct nand_device *nand = mtd_to_nanddev(mtd);
+	unsigned int page_size = nanddev_page_size(nand);
+	unsigned int pages_per_block = nanddev_pages_per_eraseblock(nand);
+	struct nand_page_io_req req = {
+		.type = NAND_PAGE_READ,
+		.mode = ops->mode,
+	};
+	unsigned int npages, len;
+	bool ecc_failed = false;
+	u8 *buf = ops->datbuf;
+	int ret = 0;
+
+	if (!spinand->eccinfo.ooblayout)
+		req.mode = MTD_OPS_RAW;
+
+	while (ops->retlen < ops->len) {
+		req.dataoffs = nanddev_offs_to_pos(nand, from, &req.pos);
+		len = ops->len - ops->retlen;
+		npages = min(pages_per_block - req.pos.page,
+			     DIV_ROUND_UP(req.dataoffs + len, page_size));
+		len = min(len, npages * page_size - req.dataoffs);
+
+		ret = spinand_select_target(spinand, req.pos.target);
+		if (ret)
+			break;
+
+		if (npages == 1) {
+			req.datalen = len;
+			req.databuf.in = buf;
+			ret = spinand_read_page(spinand, &req);
+		} else {
+			ret = spinand_read_cont_pages(spinand, &req, npages);
+		}
+		if (ret < 0 && ret != -EBADMSG)
+			break;
+
+		if (npages > 1)
+			memcpy(buf, spinand->contbuf + req.dataoffs, len);
+
+		if (ret == -EBADMSG)
+			ecc_failed = true;
+		else
+			*max_bitflips = max_t(unsigned int, *max_bitflips, ret);
+
+		ret = 0;
+		ops->retlen += len;
+		from += len;
+		buf += len;
+	}
+
+	if (ecc_failed && !ret)
+		ret = -EBADMSG;
+
+	return ret;
+}
+
+/* The OOB areas aren't read out in continuous read mode */
+static bool spinand_use_cont_read(struct spinand_device *spinand,
+				  struct mtd_oob_ops *ops)
+{
+	return spinand->cont_read_possible && !ops->ooblen && !ops->oobbuf;
+}
+
+static bool spinand_use_seq_read(struct spinand_device *spinand, loff_t from,
+				 struct mtd_oob_ops *ops)
+{
+	struct nand_device *nand = spinand_to_nand(spinand);
+	unsigned int page_size = nanddev_page_size(nand);
+
+	/* nothing to overlap within a page */
+	if (!ops->len ||
+	    div_u64(from, page_size) == div_u64(from + ops->len - 1, page_size))
+		return false;
+
+	if (spinand_use_cont_read(spinand, ops))
+		return true;
+
+	return spinand->flags & (SPINAND_HAS_READ_CACHE_SEQ |
+				 SPINAND_HAS_READ_CACHE_RANDOM);
+}
+
+static int spinand_mtd_read(struct mtd_info *mtd, loff_t from,
+			    struct mtd_oob_ops *ops)
+{
+	struct spinand_device *spinand = mtd_to_spinand(mtd);
+	struct mtd_ecc_stats old_stats;
+	unsigned int max_bitflips = 0;
+	int ret;
+
+	mutex_lock(&spinand->lock);
+
+	old_stats = mtd->ecc_stats;
+
+	if (!spinand_use_seq_read(spinand, from, ops))
+		ret = spinand_mtd_regular_page_read(mtd, from, ops,
+						    &max_bitflips);
+	else if (spinand_use_cont_read(spinand, ops))
+		ret = spinand_mtd_cont_page_read(mtd, from, ops,
+						 &max_bitflips);
+	else
+		ret = spinand_mtd_cache_seq_page_read(mtd, from, ops,
+						      &max_bitflips);
+
 	if (ops->stats) {
 		ops->stats->uncorrectable_errors +=
 			mtd->ecc_stats.failed - old_stats.failed;
@@ -680,9 +971,6 @@ static int spinand_mtd_read(struct mtd_info *mtd, loff_t from,
 
 	mutex_unlock(&spinand->lock);
 
-	if (ecc_failed && !ret)
-		ret = -EBADMSG;
-
 	return ret ? ret : max_bitflips;
 }
 
@@ -881,6 +1169,19 @@ static int spinand_create_dirmap(struct spinand_device *spinand,
 
 	spinand->dirmaps[plane].rdesc = desc;
 
+	if (spinand->cont_read_possible) {
+		info.length = nanddev_eraseblock_size(nand);
+		info.op_tmpl = *spinand->op_templates.cont_read_cache;
+		desc = devm_spi_mem_dirmap_create(&spinand->spimem->spi->dev,
+						  spinand->spimem, &info);
+		if (IS_ERR(desc))
+			return PTR_ERR(desc);
+
+		spinand->dirmaps[plane].rdesc_cont = desc;
+		info.length = nanddev_page_size(nand) +
+			      nanddev_per_page_oobsize(nand);
+	}
+
 	if (nand->ecc.engine->integration != NAND_ECC_ENGINE_INTEGRATION_PIPELINED) {
 		spinand->dirmaps[plane].wdesc_ecc = spinand->dirmaps[plane].wdesc;
 		spinand->dirmaps[plane].rdesc_ecc = spinand->dirmaps[plane].rdesc;
@@ -1078,6 +1379,7 @@ int spinand_match_and_init(struct spinand_device *spinand,
 
 	for (i = 0; i < table_size; i++) {
 		const struct spinand_info *info = &table[i];
+		const struct spinand_op_variants *variants;
 		const struct spi_mem_op *op;
 
 		if (rdid_method != info->devid.method)
@@ -1111,6 +1413,13 @@ int spinand_match_and_init(struct spinand_device *spinand,
 					       info->op_variants.update_cache);
 		spinand->op_templates.update_cache = op;
 
+		op = spinand->op_templates.read_cache;
+		variants = info->cont_read.read_cache;
+		if (info->cont_read.set && variants)
+			op = spinand_select_op_variant(spinand, variants);
+		spinand->op_templates.cont_read_cache = op;
+		spinand->set_cont_read = op ? info->cont_read.set : NULL;
+
 		return 0;
 	}
 
@@ -1209,6 +1518,39 @@ static void spinand_mtd_resume(struct mtd_info *mtd)
 	spinand_ecc_enable(spinand, false);
 }
 
+/*
+ * The continuous reads need an on-die ECC engine, or none, as the OOB areas
+ * aren't read out, and a controller able to read a whole eraseblock in a
+ * single operation, deasserting the CS ending the read.
+ */
+static int spinand_cont_read_init(struct spinand_device *spinand)
+{
+	struct nand_device *nand = spinand_to_nand(spinand);
+	enum nand_ecc_engine_type engine_type = nand->ecc.ctx.conf.engine_type;
+	size_t nbytes = nanddev_eraseblock_size(nand);
+	struct spi_mem_op op;
+
+	if (!spinand->set_cont_read ||
+	    (engine_type != NAND_ECC_ENGINE_TYPE_ON_DIE &&
+	     engine_type != NAND_ECC_ENGINE_TYPE_NONE))
+		return 0;
+
+	op = *spinand->op_templates.cont_read_cache;
+	op.data.nbytes = nbytes;
+	if (spi_mem_adjust_op_size(spinand->spimem, &op) ||
+	    op.data.nbytes != nbytes ||
+	    !spi_mem_supports_op(spinand->spimem, &op))
+		return 0;
+
+	spinand->contbuf = kmalloc(nbytes, GFP_KERNEL);
+	if (!spinand->contbuf)
+		return -ENOMEM;
+
+	spinand->cont_read_possible = true;
+
+	return 0;
+}
+
 static int spinand_init(struct spinand_device *spinand)
 {
 	struct device *dev = &spinand->spimem->spi->dev;
@@ -1285,6 +1627,10 @@ static int spinand_init(struct spinand_device *spinand)
 	mtd->ecc_strength = nanddev_get_ecc_conf(nand)->strength;
 	mtd->ecc_step_size = nanddev_get_ecc_conf(nand)->step_size;
 
+	ret = spinand_cont_read_init(spinand);
+	if (ret)
+		goto err_cleanup_ecc_engine;
+
 	ret = spinand_create_dirmaps(spinand);
 	if (ret) {
 		dev_err(dev,
@@ -1305,6 +1651,7 @@ static int spinand_init(struct spinand_device *spinand)
 	spinand_manufacturer_cleanup(spinand);
 
 err_free_bufs:
+	kfree(spinand->contbuf);
 	kfree(spinand->databuf);
 	kfree(spinand->scratchbuf);
 	return ret;
@@ -1316,6 +1663,7 @@ static void spinand_cleanup(struct spinand_device *spinand)
 
 	nanddev_cleanup(nand);
 	spinand_manufacturer_cleanup(spinand);
+	kfree(spinand->contbuf);
 	kfree(spinand->databuf);
 	kfree(spinand->scratchbuf);
 }
@@ -168,6 +168,12 @@ static int micron_8_ecc_get_status(struct spinand_device *spinand,
 	return -EINVAL;
 }
 
+static int micron_set_cont_read(struct spinand_device *spinand, bool enable)
+{
+	return spinand_upd_cfg(spinand, MICRON_CFG_CR,
+			       enable ? MICRON_CFG_CR : 0);
+}
+
 static const struct spinand_info micron_spinand_table[] = {
 	/* M79A 2Gb 3.3V */
 	SPINAND_INFO("MT29F2G01ABAGD",
@@ -177,7 +183,7 @@ static const struct spinand_info micron_spinand_table[] = {
 		     SPINAND_INFO_OP_VARIANTS(&quadio_read_cache_variants,
 					      &x4_write_cache_variants,
 					      &x4_update_cache_variants),
-		     0,
+		     SPINAND_HAS_READ_CACHE_RANDOM,
 		     SPINAND_ECCINFO(&micron_8_ooblayout,
 				     micron_8_ecc_get_status)),
 	/* M79A 2Gb 1.8V */
@@ -188,7 +194,7 @@ static const struct spinand_info micron_spinand_table[] = {
 		     SPINAND_INFO_OP_VARIANTS(&quadio_read_cache_variants,
 					      &x4_write_cache_variants,
 					      &x4_update_cache_variants),
-		     0,
+		     SPINAND_HAS_READ_CACHE_RANDOM,
 		     SPINAND_ECCINFO(&micron_8_ooblayout,
 				     micron_8_ecc_get_status)),
 	/* M78A 1Gb 3.3V */
@@ -199,7 +205,7 @@ static const struct spinand_info micron_spinand_table[] = {
 		     SPINAND_INFO_OP_VARIANTS(&quadio_read_cache_variants,
 					      &x4_write_cache_variants,
 					      &x4_update_cache_variants),
-		     0,
+		     SPINAND_HAS_READ_CACHE_RANDOM,
 		     SPINAND_ECCINFO(&micron_8_ooblayout,
 				     micron_8_ecc_get_status)),
 	/* M78A 1Gb 1.8V */
@@ -210,7 +216,7 @@ static const struct spinand_info micron_spinand_table[] = {
 		     SPINAND_INFO_OP_VARIANTS(&quadio_read_cache_variants,
 					      &x4_write_cache_variants,
 					      &x4_update_cache_variants),
-		     0,
+		     SPINAND_HAS_READ_CACHE_RANDOM,
 		     SPINAND_ECCINFO(&micron_8_ooblayout,
 				     micron_8_ecc_get_status)),
 	/* M79A 4Gb 3.3V */
@@ -221,7 +227,7 @@ static const struct spinand_info micron_spinand_table[] = {
 		     SPINAND_INFO_OP_VARIANTS(&quadio_read_cache_variants,
 					      &x4_write_cache_variants,
 					      &x4_update_cache_variants),
-		     0,
+		     SPINAND_HAS_READ_CACHE_RANDOM,
 		     SPINAND_ECCINFO(&micron_8_ooblayout,
 				     micron_8_ecc_get_status),
 		     SPINAND_SELECT_TARGET(micron_select_target)),
@@ -235,7 +241,8 @@ static const struct spinand_info micron_spinand_table[] = {
 					      &x4_update_cache_variants),
 		     SPINAND_HAS_CR_FEAT_BIT,
 		     SPINAND_ECCINFO(&micron_8_ooblayout,
-				     micron_8_ecc_get_status)),
+				     micron_8_ecc_get_status),
+		     SPINAND_CONT_READ(micron_set_cont_read, NULL)),
 	/* M70A 4Gb 1.8V */
 	SPINAND_INFO("MT29F4G01ABBFD",
 		     SPINAND_ID(SPINAND_READID_METHOD_OPCODE_DUMMY, 0x35),
@@ -246,7 +253,8 @@ static const struct spinand_info micron_spinand_table[] = {
 					      &x4_update_cache_variants),
 		     SPINAND_HAS_CR_FEAT_BIT,
 		     SPINAND_ECCINFO(&micron_8_ooblayout,
-				     micron_8_ecc_get_status)),
+				     micron_8_ecc_get_status),
+		     SPINAND_CONT_READ(micron_set_cont_read, NULL)),
 	/* M70A 8Gb 3.3V */
 	SPINAND_INFO("MT29F8G01ADAFD",
 		     SPINAND_ID(SPINAND_READID_METHOD_OPCODE_DUMMY, 0x46),
@@ -258,6 +266,7 @@ static const struct spinand_info micron_spinand_table[] = {
 		     SPINAND_HAS_CR_FEAT_BIT,
 		     SPINAND_ECCINFO(&micron_8_ooblayout,
 				     micron_8_ecc_get_status),
+		     SPINAND_CONT_READ(micron_set_cont_read, NULL),
 		     SPINAND_SELECT_TARGET(micron_select_target)),
 	/* M70A 8Gb 1.8V */
 	SPINAND_INFO("MT29F8G01ADBFD",
@@ -270,6 +279,7 @@ static const struct spinand_info micron_spinand_table[] = {
 		     SPINAND_HAS_CR_FEAT_BIT,
 		     SPINAND_ECCINFO(&micron_8_ooblayout,
 				     micron_8_ecc_get_status),
+		     SPINAND_CONT_READ(micron_set_cont_read, NULL),
 		     SPINAND_SELECT_TARGET(micron_select_target)),
 	/* M69A 2Gb 3.3V */
 	SPINAND_INFO("MT29F2G01AAAED",
@@ -286,9 +296,9 @@ static const struct spinand_info micron_spinand_table[] = {
 static int micron_spinand_init(struct spinand_device *spinand)
 {
 	/*
-	 * M70A device series enable Continuous Read feature at Power-up,
-	 * which is not supported. Disable this bit to avoid any possible
-	 * failure.
+	 * M70A device series enable Continuous Read feature at Power-up.
+	 * Disable this bit, it's only set for the duration of a continuous
+	 * read.
 	 */
 	if (spinand->flags & SPINAND_HAS_CR_FEAT_BIT)
 		return spinand_upd_cfg(spinand, MICRON_CFG_CR, 0);
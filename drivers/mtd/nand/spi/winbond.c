@@ -23,6 +23,17 @@ static SPINAND_OP_VARIANTS(read_cache_variants,
 		SPINAND_PAGE_READ_FROM_CACHE_OP(true, 0, 1, NULL, 0),
 		SPINAND_PAGE_READ_FROM_CACHE_OP(false, 0, 1, NULL, 0));
 
+/*
+ * In continuous read mode, the column address cycles are dummy ones and the
+ * fast reads need one more dummy byte.  The dual/quad I/O variants aren't
+ * used, their dummy cycles aren't the same.
+ */
+static SPINAND_OP_VARIANTS(cont_read_cache_variants,
+		SPINAND_PAGE_READ_FROM_CACHE_X4_OP(0, 2, NULL, 0),
+		SPINAND_PAGE_READ_FROM_CACHE_X2_OP(0, 2, NULL, 0),
+		SPINAND_PAGE_READ_FROM_CACHE_OP(true, 0, 2, NULL, 0),
+		SPINAND_PAGE_READ_FROM_CACHE_OP(false, 0, 1, NULL, 0));
+
 static SPINAND_OP_VARIANTS(write_cache_variants,
 		SPINAND_PROG_LOAD_X4(true, 0, NULL, 0),
 		SPINAND_PROG_LOAD(true, 0, NULL, 0));
@@ -74,6 +85,12 @@ static int w25m02gv_select_target(struct spinand_device *spinand,
 	return spi_mem_exec_op(spinand->spimem, &op);
 }
 
+static int winbond_set_cont_read(struct spinand_device *spinand, bool enable)
+{
+	return spinand_upd_cfg(spinand, WINBOND_CFG_BUF_READ,
+			       enable ? 0 : WINBOND_CFG_BUF_READ);
+}
+
 static const struct spinand_info winbond_spinand_table[] = {
 	SPINAND_INFO("W25M02GV",
 		     SPINAND_ID(SPINAND_READID_METHOD_OPCODE_DUMMY, 0xab),
@@ -84,6 +101,8 @@ static const struct spinand_info winbond_spinand_table[] = {
 					      &update_cache_variants),
 		     0,
 		     SPINAND_ECCINFO(&w25m02gv_ooblayout, NULL),
+		     SPINAND_CONT_READ(winbond_set_cont_read,
+				       &cont_read_cache_variants),
 		     SPINAND_SELECT_TARGET(w25m02gv_select_target)),
 	SPINAND_INFO("W25N01GV",
 		     SPINAND_ID(SPINAND_READID_METHOD_OPCODE_DUMMY, 0xaa),
@@ -93,7 +112,9 @@ static const struct spinand_info winbond_spinand_table[] = {
 					      &write_cache_variants,
 					      &update_cache_variants),
 		     0,
-		     SPINAND_ECCINFO(&w25m02gv_ooblayout, NULL)),
+		     SPINAND_ECCINFO(&w25m02gv_ooblayout, NULL),
+		     SPINAND_CONT_READ(winbond_set_cont_read,
+				       &cont_read_cache_variants)),
 };
 
 static int winbond_spinand_init(struct spinand_device *spinand)
@@ -103,7 +124,7 @@ static int winbond_spinand_init(struct spinand_device *spinand)
 
 	/*
 	 * Make sure all dies are in buffer read mode and not continuous read
-	 * mode.
+	 * mode, which is only entered for the duration of a continuous read.
 	 */
 	for (i = 0; i < nand->memorg.ntargets; i++) {
 		spinand_select_target(spinand, i);
@@ -0,0 +1,279 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Read-ahead cache for SPI NOR flashes
+ *
+ * Reads are served from a couple of windows of the flash kept in memory.
+ * Random reads bypass the cache, while a run of sequential reads fills the
+ * window containing the read and has the following window read ahead from a
+ * work item, so parsing a file system image doesn't wait for the flash on
+ * every call.
+ *
+ * All the cache state is protected by nor->lock, which also serializes the
+ * prefetch with the writes and erases invalidating it.
+ */
+
+#include <linux/log2.h>
+#include <linux/mtd/mtd.h>
+#include <linux/mtd/spi-nor.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+
+#include "core.h"
+
+#define SPI_NOR_CACHE_WINDOWS		2
+#define SPI_NOR_CACHE_MIN_WINDOW	SZ_64K
+
+/* Number of sequential reads in a row after which the reads are cached. */
+#define SPI_NOR_CACHE_STREAM		2
+
+/**
+ * struct spi_nor_cache_window - a cached window of the flash
+ * @buf:	the data
+ * @start:	offset of the window in the flash
+ * @len:	number of valid bytes in @buf, 0 when the window is empty
+ * @used:	LRU stamp of the last read served from the window
+ */
+struct spi_nor_cache_window {
+	u8 *buf;
+	loff_t start;
+	size_t len;
+	unsigned long used;
+};
+
+/**
+ * struct spi_nor_cache - read-ahead cache of a SPI NOR flash
+ * @nor:	the flash
+ * @win:	the cached windows
+ * @size:	size of a window, a multiple of the erase size
+ * @next:	offset right after the last read
+ * @stream:	number of sequential reads in a row
+ * @clock:	LRU clock
+ * @prefetch:	offset of the window to read ahead, -1 when none
+ * @work:	read ahead work
+ */
+struct spi_nor_cache {
+	struct spi_nor *nor;
+	struct spi_nor_cache_window win[SPI_NOR_CACHE_WINDOWS];
+	size_t size;
+	loff_t next;
+	unsigned int stream;
+	unsigned long clock;
+	loff_t prefetch;
+	struct work_struct work;
+};
+
+static struct spi_nor_cache_window *
+spi_nor_cache_lookup(struct spi_nor_cache *cache, loff_t addr)
+{
+	struct spi_nor_cache_window *win;
+	int i;
+
+	for (i = 0; i < SPI_NOR_CACHE_WINDOWS; i++) {
+		win = &cache->win[i];
+		if (win->len && addr >= win->start &&
+		    addr < win->start + win->len)
+			return win;
+	}
+
+	return NULL;
+}
+
+static struct spi_nor_cache_window *
+spi_nor_cache_fill(struct spi_nor_cache *cache, loff_t start)
+{
+	struct spi_nor *nor = cache->nor;
+	struct spi_nor_cache_window *win = &cache->win[0];
+	size_t len, retlen = 0;
+	int i, ret;
+
+	for (i = 1; i < SPI_NOR_CACHE_WINDOWS; i++)
+		if (cache->win[i].used < win->used)
+			win = &cache->win[i];
+
+	len = min_t(u64, cache->size, nor->mtd.size - start);
+
+	win->len = 0;
+	ret = spi_nor_read_locked(nor, start, len, &retlen, win->buf);
+	if (ret)
+		return ERR_PTR(ret);
+
+	win->start = start;
+	win->len = len;
+	win->used = ++cache->clock;
+
+	return win;
+}
+
+static void spi_nor_cache_work(struct work_struct *work)
+{
+	struct spi_nor_cache *cache =
+		container_of(work, struct spi_nor_cache, work);
+	struct spi_nor *nor = cache->nor;
+	loff_t start;
+
+	if (spi_nor_lock_and_prep(nor))
+		return;
+
+	start = cache->prefetch;
+	cache->prefetch = -1;
+
+	if (start >= 0 && !spi_nor_cache_lookup(cache, start))
+		spi_nor_cache_fill(cache, start);
+
+	spi_nor_unlock_and_unprep(nor);
+}
+
+/**
+ * spi_nor_cache_read() - read an address range through the cache
+ * @nor:	pointer to 'struct spi_nor'
+ * @from:	offset to read from
+ * @len:	number of bytes to read
+ * @retlen:	incremented by the number of bytes read
+ * @buf:	pointer to dst buffer
+ *
+ * Must be called with the lock held by spi_nor_lock_and_prep().
+ *
+ * Return: 0 on success, -errno otherwise.
+ */
+int spi_nor_cache_read(struct spi_nor *nor, loff_t from, size_t len,
+		       size_t *retlen, u_char *buf)
+{
+	struct spi_nor_cache *cache = nor->cache;
+	struct spi_nor_cache_window *win;
+	loff_t next;
+	size_t n;
+
+	if (from == cache->next)
+		cache->stream++;
+	else
+		cache->stream = 0;
+	cache->next = from + len;
+
+	while (len) {
+		win = spi_nor_cache_lookup(cache, from);
+		if (!win) {
+			/* not worth caching what no one is going to read */
+			if (cache->stream < SPI_NOR_CACHE_STREAM)
+				return spi_nor_read_locked(nor, from, len,
+							   retlen, buf);
+
+			win = spi_nor_cache_fill(cache,
+						 round_down(from, cache->size));
+			if (IS_ERR(win))
+				return PTR_ERR(win);
+		}
+
+		n = min_t(size_t, len, win->start + win->len - from);
+		memcpy(buf, win->buf + (from - win->start), n);
+		win->used = ++cache->clock;
+
+		*retlen += n;
+		buf += n;
+		from += n;
+		len -= n;
+	}
+
+	if (cache->stream < SPI_NOR_CACHE_STREAM)
+		return 0;
+
+	next = round_down(cache->next, cache->size);
+	if (spi_nor_cache_lookup(cache, next))
+		next += cache->size;
+
+	if (next < nor->mtd.size && !spi_nor_cache_lookup(cache, next)) {
+		cache->prefetch = next;
+		schedule_work(&cache->work);
+	}
+
+	return 0;
+}
+
+/**
+ * spi_nor_cache_invalidate() - drop the cached data of an address range
+ * @nor:	pointer to 'struct spi_nor'
+ * @addr:	offset of the range
+ * @len:	length of the range
+ *
+ * Must be called with the lock held by spi_nor_lock_and_prep(), before the
+ * range gets written or erased.
+ */
+void spi_nor_cache_invalidate(struct spi_nor *nor, loff_t addr, u64 len)
+{
+	struct spi_nor_cache *cache = nor->cache;
+	struct spi_nor_cache_window *win;
+	int i;
+
+	if (!cache)
+		return;
+
+	for (i = 0; i < SPI_NOR_CACHE_WINDOWS; i++) {
+		win = &cache->win[i];
+		if (win->len && addr < win->start + win->len &&
+		    win->start < addr + len)
+			win->len = 0;
+	}
+
+	cache->stream = 0;
+}
+
+/**
+ * spi_nor_cache_suspend() - stop reading ahead
+ * @nor:	pointer to 'struct spi_nor'
+ */
+void spi_nor_cache_suspend(struct spi_nor *nor)
+{
+	if (nor->cache)
+		cancel_work_sync(&nor->cache->work);
+}
+
+static void spi_nor_cache_release(void *data)
+{
+	struct spi_nor_cache *cache = data;
+
+	cancel_work_sync(&cache->work);
+}
+
+/**
+ * spi_nor_cache_init() - set up the read-ahead cache of a flash
+ * @nor:	pointer to 'struct spi_nor'
+ *
+ * The windows are sized to the largest erase size, and at least
+ * SPI_NOR_CACHE_MIN_WINDOW, as reading ahead 4 KiB sectors wouldn't hide
+ * much of the command overhead.
+ *
+ * Return: 0 on success, -errno otherwise.
+ */
+int spi_nor_cache_init(struct spi_nor *nor)
+{
+	struct spi_nor_cache *cache;
+	u32 size = nor->mtd.erasesize;
+	int i;
+
+	if (!is_power_of_2(size) || size > nor->mtd.size)
+		return 0;
+
+	while (size < SPI_NOR_CACHE_MIN_WINDOW && size * 2 <= nor->mtd.size)
+		size *= 2;
+
+	cache = devm_kzalloc(nor->dev, sizeof(*cache), GFP_KERNEL);
+	if (!cache)
+		return -ENOMEM;
+
+	for (i = 0; i < SPI_NOR_CACHE_WINDOWS; i++) {
+		cache->win[i].buf = devm_kmalloc(nor->dev, size, GFP_KERNEL);
+		if (!cache->win[i].buf)
+			return -ENOMEM;
+	}
+
+	cache->nor = nor;
+	cache->size = size;
+	cache->next = -1;
+	cache->prefetch = -1;
+	INIT_WORK(&cache->work, spi_nor_cache_work);
+
+	nor->cache = cache;
+
+	return devm_add_action_or_reset(nor->dev, spi_nor_cache_release,
+					cache);
+}
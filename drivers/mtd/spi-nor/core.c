@@ -1452,6 +1452,8 @@ static int spi_nor_erase(struct mtd_info *mtd, struct erase_info *instr)
 	if (ret)
 		return ret;
 
+	spi_nor_cache_invalidate(nor, instr->addr, instr->len);
+
 	/* whole-chip erase? */
 	if (len == mtd->size && !(nor->flags & SNOR_F_NO_OP_CHIP_ERASE)) {
 		unsigned long timeout;
@@ -1677,18 +1679,23 @@ static const struct flash_info *spi_nor_detect(struct spi_nor *nor)
 	return info;
 }
 
-static int spi_nor_read(struct mtd_info *mtd, loff_t from, size_t len,
+/**
+ * spi_nor_read_locked() - read an address range of the flash
+ * @nor:	pointer to 'struct spi_nor'
+ * @from:	offset to read from
+ * @len:	number of bytes to read
+ * @retlen:	incremented by the number of bytes read
+ * @buf:	pointer to dst buffer
+ *
+ * Must be called with the lock held by spi_nor_lock_and_prep().
+ *
+ * Return: 0 on success, -errno otherwise.
+ */
+int spi_nor_read_locked(struct spi_nor *nor, loff_t from, size_t len,
 			size_t *retlen, u_char *buf)
 {
-	struct spi_nor *nor = mtd_to_spi_nor(mtd);
 	ssize_t ret;
 
-	dev_dbg(nor->dev, "from 0x%08x, len %zd\n", (u32)from, len);
-
-	ret = spi_nor_lock_and_prep(nor);
-	if (ret)
-		return ret;
-
 	while (len) {
 		loff_t addr = from;
 
@@ -1712,6 +1719,26 @@ static int spi_nor_read(struct mtd_info *mtd, loff_t from, size_t len,
 	ret = 0;
 
 read_err:
+	return ret;
+}
+
+static int spi_nor_read(struct mtd_info *mtd, loff_t from, size_t len,
+			size_t *retlen, u_char *buf)
+{
+	struct spi_nor *nor = mtd_to_spi_nor(mtd);
+	int ret;
+
+	dev_dbg(nor->dev, "from 0x%08x, len %zd\n", (u32)from, len);
+
+	ret = spi_nor_lock_and_prep(nor);
+	if (ret)
+		return ret;
+
+	if (nor->cache)
+		ret = spi_nor_cache_read(nor, from, len, retlen, buf);
+	else
+		ret = spi_nor_read_locked(nor, from, len, retlen, buf);
+
 	spi_nor_unlock_and_unprep(nor);
 	return ret;
 }
@@ -1735,6 +1762,8 @@ static int spi_nor_write(struct mtd_info *mtd, loff_t to, size_t len,
 	if (ret)
 		return ret;
 
+	spi_nor_cache_invalidate(nor, to, len);
+
 	for (i = 0; i < len; ) {
 		ssize_t written;
 		loff_t addr = to + i;
@@ -2811,6 +2840,8 @@ static int spi_nor_suspend(struct mtd_info *mtd)
 	struct spi_nor *nor = mtd_to_spi_nor(mtd);
 	int ret;
 
+	spi_nor_cache_suspend(nor);
+
 	/* Disable octal DTR mode if we enabled it. */
 	ret = spi_nor_octal_dtr_enable(nor, false);
 	if (ret)
@@ -2830,6 +2861,9 @@ static void spi_nor_resume(struct mtd_info *mtd)
 	ret = spi_nor_init(nor);
 	if (ret)
 		dev_err(dev, "resume() failed\n");
+
+	/* the flash may have been touched by someone else meanwhile */
+	spi_nor_cache_invalidate(nor, 0, mtd->size);
 }
 
 static int spi_nor_get_device(struct mtd_info *mtd)
@@ -2963,6 +2997,163 @@ static void spi_nor_set_mtd_info(struct spi_nor *nor)
 	mtd->_put_device = spi_nor_put_device;
 }
 
+/* Number of bytes compared to check the selected read settings. */
+#define SPI_NOR_VERIFY_LEN		256
+
+/* Single I/O reads, the ones the SFDP tables were read with */
+#define SPI_NOR_VERIFY_REF_READS	(SNOR_HWCAPS_READ | SNOR_HWCAPS_READ_FAST)
+
+static int spi_nor_read_verify_buf(struct spi_nor *nor, u8 *buf)
+{
+	size_t retlen = 0;
+	int ret;
+
+	ret = spi_nor_read_locked(nor, 0, SPI_NOR_VERIFY_LEN, &retlen, buf);
+	if (ret)
+		return ret;
+
+	return retlen == SPI_NOR_VERIFY_LEN ? 0 : -EIO;
+}
+
+/*
+ * Read the start of the flash with the fastest 1-1-1 settings, as reference
+ * for the wider ones picked by spi_nor_setup(). Those are the settings the
+ * ID and the SFDP tables were just read with, so they are known to work at
+ * the clock rate in use, with the addressing mode the flash is used in.
+ */
+static int spi_nor_read_reference(struct spi_nor *nor,
+				  const struct spi_nor_hwcaps *hwcaps, u8 *buf)
+{
+	struct spi_nor_hwcaps caps = *hwcaps;
+	int ret;
+
+	caps.mask &= ~(SNOR_HWCAPS_READ_MASK | SNOR_HWCAPS_PP_MASK) |
+		     SPI_NOR_VERIFY_REF_READS | SNOR_HWCAPS_PP;
+
+	ret = spi_nor_setup(nor, &caps);
+	if (!ret)
+		ret = spi_nor_init(nor);
+	if (!ret)
+		ret = spi_nor_read_verify_buf(nor, buf);
+
+	return ret;
+}
+
+static int spi_nor_verify_read(struct spi_nor *nor, const u8 *ref, u8 *buf)
+{
+	int ret;
+
+	memset(buf, ~ref[0], SPI_NOR_VERIFY_LEN);
+
+	ret = spi_nor_read_verify_buf(nor, buf);
+	if (ret)
+		return ret;
+
+	return memcmp(ref, buf, SPI_NOR_VERIFY_LEN) ? -EIO : 0;
+}
+
+/*
+ * Drop the read settings in use, and what can't be used without them. The
+ * 1-1-1 reads are never dropped, they are the last resort.
+ */
+static void spi_nor_drop_read(struct spi_nor *nor, struct spi_nor_hwcaps *caps)
+{
+	const struct spi_nor_read_command *read;
+	u32 mask = caps->mask & SNOR_HWCAPS_READ_MASK &
+		   ~SPI_NOR_VERIFY_REF_READS;
+	int cap, cmd;
+
+	for (cap = 0; mask && cap < 32; cap++) {
+		if (!(mask & BIT(cap)))
+			continue;
+
+		cmd = spi_nor_hwcaps_read2cmd(BIT(cap));
+		if (cmd < 0)
+			continue;
+
+		read = &nor->params->reads[cmd];
+		if (read->opcode == nor->read_opcode &&
+		    read->proto == nor->read_proto)
+			caps->mask &= ~BIT(cap);
+	}
+
+	/* Octal DTR is only enabled when reads and writes both use it. */
+	if (nor->read_proto == SNOR_PROTO_8_8_8_DTR)
+		caps->mask &= ~SNOR_HWCAPS_PP_8_8_8_DTR;
+}
+
+/*
+ * Configure and initialize the flash with the fastest settings supported by
+ * both the flash and the controller, then check that data read with them
+ * matches what the 1-1-1 reads return. A mismatch, typically from a board
+ * not wired or fast enough for the wider bus or DTR, drops the faulty read
+ * settings and retries with the next fastest ones, down to 1-1-1.
+ *
+ * The check can't tell anything on a flash whose first bytes are all the
+ * same, usually an erased one, in which case the settings are trusted.
+ */
+static int spi_nor_setup_and_verify(struct spi_nor *nor,
+				    const struct spi_nor_hwcaps *hwcaps)
+{
+	struct spi_nor_hwcaps caps = *hwcaps;
+	u8 *ref, *buf;
+	u32 mask;
+	int ret;
+
+	ret = spi_nor_setup(nor, &caps);
+	if (ret)
+		return ret;
+
+	if (nor->read_proto == SNOR_PROTO_1_1_1)
+		return spi_nor_init(nor);
+
+	ref = kmalloc(2 * SPI_NOR_VERIFY_LEN, GFP_KERNEL);
+	if (!ref)
+		return -ENOMEM;
+	buf = ref + SPI_NOR_VERIFY_LEN;
+
+	ret = spi_nor_read_reference(nor, hwcaps, ref);
+	if (ret || !memchr_inv(ref, ref[0], SPI_NOR_VERIFY_LEN)) {
+		kfree(ref);
+		ret = spi_nor_setup(nor, &caps);
+		return ret ? ret : spi_nor_init(nor);
+	}
+
+	ret = spi_nor_setup(nor, &caps);
+	while (!ret) {
+		ret = spi_nor_init(nor);
+		/* the reference was read this way, nothing to check */
+		if (ret || nor->read_proto == SNOR_PROTO_1_1_1)
+			break;
+
+		ret = spi_nor_verify_read(nor, ref, buf);
+		if (!ret)
+			break;
+
+		dev_warn(nor->dev,
+			 "read opcode 0x%02x failed verification (%d), falling back\n",
+			 nor->read_opcode, ret);
+
+		/* Back to the mode the reference was read in. */
+		ret = spi_nor_octal_dtr_enable(nor, false);
+		if (ret)
+			break;
+
+		mask = caps.mask;
+		spi_nor_drop_read(nor, &caps);
+		if (caps.mask == mask) {
+			ret = -EIO;
+			break;
+		}
+
+		ret = spi_nor_setup(nor, &caps);
+	}
+
+	kfree(ref);
+
+	return ret;
+}
+
 int spi_nor_scan(struct spi_nor *nor, const char *name,
 		 const struct spi_nor_hwcaps *hwcaps)
 {
@@ -3014,13 +3205,11 @@ int spi_nor_scan(struct spi_nor *nor, const char *name,
 	 * - set the number of dummy cycles (mode cycles + wait states).
 	 * - set the SPI protocols for register and memory accesses.
 	 * - set the number of address bytes.
+	 * Then send all the required SPI flash commands to initialize device,
+	 * and fall back to slower read settings if data can't be read back
+	 * reliably with the selected ones.
 	 */
-	ret = spi_nor_setup(nor, hwcaps);
-	if (ret)
-		return ret;
-
-	/* Send all the required SPI flash commands to initialize device */
-	ret = spi_nor_init(nor);
+	ret = spi_nor_setup_and_verify(nor, hwcaps);
 	if (ret)
 		return ret;
 
@@ -3046,7 +3235,8 @@ int spi_nor_scan(struct spi_nor *nor, const char *name,
 				mtd->eraseregions[i].erasesize,
 				mtd->eraseregions[i].erasesize / 1024,
 				mtd->eraseregions[i].numblocks);
-	return 0;
+
+	return spi_nor_cache_init(nor);
 }
 EXPORT_SYMBOL_GPL(spi_nor_scan);
 
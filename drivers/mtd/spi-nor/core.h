@@ -662,6 +662,8 @@ ssize_t spi_nor_read_data(struct spi_nor *nor, loff_t from, size_t len,
 			  u8 *buf);
 ssize_t spi_nor_write_data(struct spi_nor *nor, loff_t to, size_t len,
 			   const u8 *buf);
+int spi_nor_read_locked(struct spi_nor *nor, loff_t from, size_t len,
+			size_t *retlen, u_char *buf);
 int spi_nor_read_any_reg(struct spi_nor *nor, struct spi_mem_op *op,
 			 enum spi_nor_protocol proto);
 int spi_nor_write_any_volatile_reg(struct spi_nor *nor, struct spi_mem_op *op,
@@ -713,6 +715,29 @@ static inline struct spi_nor *mtd_to_spi_nor(struct mtd_info *mtd)
 	return container_of(mtd, struct spi_nor, mtd);
 }
 
+#ifdef CONFIG_MTD_SPI_NOR_READ_CACHE
+int spi_nor_cache_init(struct spi_nor *nor);
+int spi_nor_cache_read(struct spi_nor *nor, loff_t from, size_t len,
+		       size_t *retlen, u_char *buf);
+void spi_nor_cache_invalidate(struct spi_nor *nor, loff_t addr, u64 len);
+void spi_nor_cache_suspend(struct spi_nor *nor);
+#else
+static inline int spi_nor_cache_init(struct spi_nor *nor)
+{
+	return 0;
+}
+
+static inline int spi_nor_cache_read(struct spi_nor *nor, loff_t from,
+				     size_t len, size_t *retlen, u_char *buf)
+{
+	return spi_nor_read_locked(nor, from, len, retlen, buf);
+}
+
+static inline void spi_nor_cache_invalidate(struct spi_nor *nor, loff_t addr,
+					    u64 len) {}
+static inline void spi_nor_cache_suspend(struct spi_nor *nor) {}
+#endif
+
 #ifdef CONFIG_DEBUG_FS
 void spi_nor_debugfs_register(struct spi_nor *nor);
 void spi_nor_debugfs_shutdown(void);
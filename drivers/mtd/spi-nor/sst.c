@@ -130,6 +130,8 @@ static int sst_nor_write(struct mtd_info *mtd, loff_t to, size_t len,
 	if (ret)
 		return ret;
 
+	spi_nor_cache_invalidate(nor, to, len);
+
 	ret = spi_nor_write_enable(nor);
 	if (ret)
 		goto out;
@@ -13,6 +13,7 @@
 #include <linux/net_tstamp.h>
 #include <linux/interrupt.h>
 #include <linux/phy/phy.h>
+#include <net/xdp.h>
 
 #if defined(CONFIG_ARCH_DMA_ADDR_T_64BIT) || defined(CONFIG_MACB_USE_HWSTAMP)
 #define MACB_EXT_DESC
@@ -925,13 +926,16 @@ struct gem_tx_ts {
 /* struct macb_tx_skb - data about an skb which is being transmitted
  * @skb: skb currently being transmitted, only set for the last buffer
  *       of the frame
- * @mapping: DMA address of the skb's fragment buffer
+ * @xdpf: XDP frame currently being transmitted, in place of @skb
+ * @mapping: DMA address of the skb's fragment buffer, 0 for the XDP_TX
+ *           frames left mapped by the RX page pool
  * @size: size of the DMA mapped buffer
  * @mapped_as_page: true when buffer was mapped with skb_frag_dma_map(),
  *                  false when buffer was mapped with dma_map_single()
  */
 struct macb_tx_skb {
 	struct sk_buff		*skb;
+	struct xdp_frame	*xdpf;
 	dma_addr_t		mapping;
 	size_t			size;
 	bool			mapped_as_page;
@@ -1128,6 +1132,10 @@ struct queue_stats {
 	unsigned long tx_packets;
 	unsigned long tx_bytes;
 	unsigned long tx_dropped;
+	unsigned long rx_xdp_drop;
+	unsigned long rx_xdp_tx;
+	unsigned long rx_xdp_redirect;
+	unsigned long tx_xdp_xmit;
 };
 
 static const struct gem_statistic queue_statistics[] = {
@@ -1137,6 +1145,10 @@ static const struct gem_statistic queue_statistics[] = {
 		QUEUE_STAT_TITLE("tx_packets"),
 		QUEUE_STAT_TITLE("tx_bytes"),
 		QUEUE_STAT_TITLE("tx_dropped"),
+		QUEUE_STAT_TITLE("rx_xdp_drop"),
+		QUEUE_STAT_TITLE("rx_xdp_tx"),
+		QUEUE_STAT_TITLE("rx_xdp_redirect"),
+		QUEUE_STAT_TITLE("tx_xdp_xmit"),
 };
 
 #define QUEUE_STATS_LEN ARRAY_SIZE(queue_statistics)
@@ -1224,7 +1236,9 @@ struct macb_queue {
 	unsigned int		rx_tail;
 	unsigned int		rx_prepared_head;
 	struct macb_dma_desc	*rx_ring;
-	struct sk_buff		**rx_skbuff;
+	struct page		**rx_page;
+	struct page_pool	*page_pool;
+	struct xdp_rxq_info	xdp_rxq;
 	void			*rx_buffers;
 	struct napi_struct	napi_rx;
 	struct queue_stats stats;
@@ -1255,6 +1269,7 @@ struct macb {
 	void	(*macb_reg_writel)(struct macb *bp, int offset, u32 value);
 
 	size_t			rx_buffer_size;
+	struct bpf_prog		*xdp_prog;
 
 	unsigned int		rx_ring_size;
 	unsigned int		tx_ring_size;
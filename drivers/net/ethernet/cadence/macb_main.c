@@ -39,6 +39,8 @@
 #include <linux/ptp_classify.h>
 #include <linux/reset.h>
 #include <linux/firmware/xlnx-zynqmp.h>
+#include <linux/bpf_trace.h>
+#include <net/page_pool.h>
 #include "macb.h"
 
 /* This structure is only used for MACB on SiFive FU540 devices */
@@ -51,6 +53,15 @@ struct sifive_fu540_macb_mgmt {
 #define MACB_RX_BUFFER_SIZE	128
 #define RX_BUFFER_MULTIPLE	64  /* bytes */
 
+/* GEM RX buffers are page pool pages, with room for XDP in front */
+#define GEM_RX_HEADROOM		XDP_PACKET_HEADROOM
+
+/* gem_xdp_run() verdicts */
+#define MACB_XDP_PASS		0
+#define MACB_XDP_CONSUMED	BIT(0)
+#define MACB_XDP_TX		BIT(1)
+#define MACB_XDP_REDIRECT	BIT(2)
+
 #define DEFAULT_RX_RING_SIZE	512 /* must be power of 2 */
 #define MIN_RX_RING_SIZE	64
 #define MAX_RX_RING_SIZE	8192
@@ -988,6 +999,11 @@ static void macb_tx_unmap(struct macb *bp, struct macb_tx_skb *tx_skb, int budge
 		napi_consume_skb(tx_skb->skb, budget);
 		tx_skb->skb = NULL;
 	}
+
+	if (tx_skb->xdpf) {
+		xdp_return_frame(tx_skb->xdpf);
+		tx_skb->xdpf = NULL;
+	}
 }
 
 static void macb_set_addr(struct macb *bp, struct macb_dma_desc *desc, dma_addr_t addr)
@@ -1034,6 +1050,7 @@ static void macb_tx_error_task(struct work_struct *work)
 	struct macb		*bp = queue->bp;
 	struct macb_tx_skb	*tx_skb;
 	struct macb_dma_desc	*desc;
+	struct xdp_frame	*xdpf;
 	struct sk_buff		*skb;
 	unsigned int		tail;
 	unsigned long		flags;
@@ -1072,27 +1089,30 @@ static void macb_tx_error_task(struct work_struct *work)
 		ctrl = desc->ctrl;
 		tx_skb = macb_tx_skb(queue, tail);
 		skb = tx_skb->skb;
+		xdpf = tx_skb->xdpf;
 
 		if (ctrl & MACB_BIT(TX_USED)) {
 			/* skb is set for the last buffer of the frame */
-			while (!skb) {
+			while (!skb && !xdpf) {
 				macb_tx_unmap(bp, tx_skb, 0);
 				tail++;
 				tx_skb = macb_tx_skb(queue, tail);
 				skb = tx_skb->skb;
+				xdpf = tx_skb->xdpf;
 			}
 
 			/* ctrl still refers to the first buffer descriptor
 			 * since it's the only one written back by the hardware
 			 */
 			if (!(ctrl & MACB_BIT(TX_BUF_EXHAUSTED))) {
-				netdev_vdbg(bp->dev, "txerr skb %u (data %p) TX complete\n",
-					    macb_tx_ring_wrap(bp, tail),
-					    skb->data);
+				unsigned int len = skb ? skb->len : xdpf->len;
+
+				netdev_vdbg(bp->dev, "txerr frame %u TX complete\n",
+					    macb_tx_ring_wrap(bp, tail));
 				bp->dev->stats.tx_packets++;
 				queue->stats.tx_packets++;
-				bp->dev->stats.tx_bytes += skb->len;
-				queue->stats.tx_bytes += skb->len;
+				bp->dev->stats.tx_bytes += len;
+				queue->stats.tx_bytes += len;
 			}
 		} else {
 			/* "Buffers exhausted mid-frame" errors may only happen
@@ -1181,6 +1201,7 @@ static int macb_tx_complete(struct macb_queue *queue, int budget)
 	head = queue->tx_head;
 	for (tail = queue->tx_tail; tail != head && packets < budget; tail++) {
 		struct macb_tx_skb	*tx_skb;
+		struct xdp_frame	*xdpf;
 		struct sk_buff		*skb;
 		struct macb_dma_desc	*desc;
 		u32			ctrl;
@@ -1202,9 +1223,16 @@ static int macb_tx_complete(struct macb_queue *queue, int budget)
 		for (;; tail++) {
 			tx_skb = macb_tx_skb(queue, tail);
 			skb = tx_skb->skb;
+			xdpf = tx_skb->xdpf;
 
 			/* First, update TX stats if needed */
-			if (skb) {
+			if (xdpf) {
+				bp->dev->stats.tx_packets++;
+				queue->stats.tx_packets++;
+				bp->dev->stats.tx_bytes += xdpf->len;
+				queue->stats.tx_bytes += xdpf->len;
+				packets++;
+			} else if (skb) {
 				if (unlikely(skb_shinfo(skb)->tx_flags & SKBTX_HW_TSTAMP) &&
 				    !ptp_one_step_sync(skb) &&
 				    gem_ptp_do_txstamp(queue, skb, desc) == 0) {
@@ -1230,7 +1258,7 @@ static int macb_tx_complete(struct macb_queue *queue, int budget)
 			 * WARNING: at this point skb has been freed by
 			 * macb_tx_unmap().
 			 */
-			if (skb)
+			if (skb || xdpf)
 				break;
 		}
 	}
@@ -1248,7 +1276,7 @@ static int macb_tx_complete(struct macb_queue *queue, int budget)
 static void gem_rx_refill(struct macb_queue *queue)
 {
 	unsigned int		entry;
-	struct sk_buff		*skb;
+	struct page		*page;
 	dma_addr_t		paddr;
 	struct macb *bp = queue->bp;
 	struct macb_dma_desc *desc;
@@ -1262,25 +1290,21 @@ static void gem_rx_refill(struct macb_queue *queue)
 
 		desc = macb_rx_desc(queue, entry);
 
-		if (!queue->rx_skbuff[entry]) {
-			/* allocate sk_buff for this free entry in ring */
-			skb = netdev_alloc_skb(bp->dev, bp->rx_buffer_size);
-			if (unlikely(!skb)) {
+		if (!queue->rx_page[entry]) {
+			/* allocate a page for this free entry in ring */
+			page = page_pool_dev_alloc_pages(queue->page_pool);
+			if (unlikely(!page)) {
 				netdev_err(bp->dev,
-					   "Unable to allocate sk_buff\n");
+					   "Unable to allocate page\n");
 				break;
 			}
 
-			/* now fill corresponding descriptor entry */
-			paddr = dma_map_single(&bp->pdev->dev, skb->data,
-					       bp->rx_buffer_size,
-					       DMA_FROM_DEVICE);
-			if (dma_mapping_error(&bp->pdev->dev, paddr)) {
-				dev_kfree_skb(skb);
-				break;
-			}
+			/* now fill corresponding descriptor entry, the page
+			 * pool has mapped and synced it already
+			 */
+			paddr = page_pool_get_dma_addr(page) + GEM_RX_HEADROOM;
 
-			queue->rx_skbuff[entry] = skb;
+			queue->rx_page[entry] = page;
 
 			if (entry == bp->rx_ring_size - 1)
 				paddr |= MACB_BIT(RX_WRAP);
@@ -1290,9 +1314,6 @@ static void gem_rx_refill(struct macb_queue *queue)
 			 */
 			dma_wmb();
 			macb_set_addr(bp, desc, paddr);
-
-			/* properly align Ethernet header */
-			skb_reserve(skb, NET_IP_ALIGN);
 		} else {
 			desc->ctrl = 0;
 			dma_wmb();
@@ -1329,14 +1350,188 @@ static void discard_partial_frame(struct macb_queue *queue, unsigned int begin,
 	 */
 }
 
+static void macb_tx_kick(struct macb *bp)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&bp->lock, flags);
+	macb_writel(bp, NCR, macb_readl(bp, NCR) | MACB_BIT(TSTART));
+	spin_unlock_irqrestore(&bp->lock, flags);
+}
+
+/* With NETIF_F_HW_CSUM the controller rewrites the checksums of every frame
+ * it computes the FCS of, which is why macb_pad_and_fcs() appends the FCS of
+ * the frames not asking for offloading.  XDP frames never do.
+ */
+static int macb_xdp_pad_and_fcs(struct macb *bp, struct xdp_frame *xdpf)
+{
+	int padlen = max_t(int, ETH_ZLEN - xdpf->len, 0);
+	u8 *tail = (u8 *)xdpf->data + xdpf->len;
+	int tailroom;
+	u32 fcs;
+
+	if (!(bp->dev->features & NETIF_F_HW_CSUM))
+		return 0;
+
+	tailroom = xdpf->frame_sz - sizeof(*xdpf) - xdpf->headroom -
+		   xdpf->len - SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+
+	if (tailroom < padlen + ETH_FCS_LEN)
+		return -ENOSPC;
+
+	memset(tail, 0, padlen);
+	xdpf->len += padlen;
+	tail += padlen;
+
+	fcs = ~crc32_le(~0, xdpf->data, xdpf->len);
+	tail[0] = fcs & 0xff;
+	tail[1] = (fcs >> 8) & 0xff;
+	tail[2] = (fcs >> 16) & 0xff;
+	tail[3] = (fcs >> 24) & 0xff;
+	xdpf->len += ETH_FCS_LEN;
+
+	return 1;
+}
+
+/* Queue an XDP frame on a single descriptor of the TX ring of @queue, called
+ * with queue->tx_ptr_lock held.  The XDP_TX frames (!dma_map) are still
+ * mapped by the page pool of the same queue.
+ */
+static int macb_xdp_submit_frame(struct macb_queue *queue,
+				 struct xdp_frame *xdpf, bool dma_map)
+{
+	struct macb *bp = queue->bp;
+	struct macb_tx_skb *tx_skb;
+	struct macb_dma_desc *desc;
+	unsigned int entry;
+	dma_addr_t mapping;
+	struct page *page;
+	u32 ctrl = 0;
+	int ret;
+
+	if (CIRC_SPACE(queue->tx_head, queue->tx_tail, bp->tx_ring_size) < 1)
+		return -EBUSY;
+
+	ret = macb_xdp_pad_and_fcs(bp, xdpf);
+	if (ret < 0)
+		return ret;
+	if (ret)
+		ctrl |= MACB_BIT(TX_NOCRC);
+
+	if (xdpf->len > bp->max_tx_length)
+		return -EMSGSIZE;
+
+	entry = macb_tx_ring_wrap(bp, queue->tx_head);
+	tx_skb = &queue->tx_skb[entry];
+
+	if (dma_map) {
+		mapping = dma_map_single(&bp->pdev->dev, xdpf->data,
+					 xdpf->len, DMA_TO_DEVICE);
+		if (dma_mapping_error(&bp->pdev->dev, mapping))
+			return -ENOMEM;
+		tx_skb->mapping = mapping;
+	} else {
+		page = virt_to_page(xdpf->data);
+		mapping = page_pool_get_dma_addr(page) +
+			  (xdpf->data - page_address(page));
+		dma_sync_single_for_device(&bp->pdev->dev, mapping, xdpf->len,
+					   DMA_BIDIRECTIONAL);
+		tx_skb->mapping = 0;
+	}
+
+	tx_skb->skb = NULL;
+	tx_skb->xdpf = xdpf;
+	tx_skb->size = xdpf->len;
+	tx_skb->mapped_as_page = false;
+
+	/* Set 'TX_USED' bit in buffer descriptor after the frame to set the
+	 * end of TX queue
+	 */
+	desc = macb_tx_desc(queue, macb_tx_ring_wrap(bp, queue->tx_head + 1));
+	desc->ctrl = MACB_BIT(TX_USED);
+
+	ctrl |= xdpf->len | MACB_BIT(TX_LAST);
+	if (unlikely(entry == (bp->tx_ring_size - 1)))
+		ctrl |= MACB_BIT(TX_WRAP);
+
+	desc = macb_tx_desc(queue, entry);
+	macb_set_addr(bp, desc, mapping);
+	/* desc->addr must be visible to hardware before clearing
+	 * 'TX_USED' bit in desc->ctrl.
+	 */
+	wmb();
+	desc->ctrl = ctrl;
+
+	queue->tx_head++;
+
+	return 0;
+}
+
+static int gem_xdp_xmit_back(struct macb_queue *queue, struct xdp_buff *xdp)
+{
+	struct xdp_frame *xdpf = xdp_convert_buff_to_frame(xdp);
+	int ret;
+
+	if (unlikely(!xdpf))
+		return -EOVERFLOW;
+
+	spin_lock(&queue->tx_ptr_lock);
+	ret = macb_xdp_submit_frame(queue, xdpf, false);
+	spin_unlock(&queue->tx_ptr_lock);
+
+	return ret;
+}
+
+static unsigned int gem_xdp_run(struct macb_queue *queue,
+				struct bpf_prog *prog, struct xdp_buff *xdp)
+{
+	struct net_device *dev = queue->bp->dev;
+	u32 act;
+
+	act = bpf_prog_run_xdp(prog, xdp);
+	switch (act) {
+	case XDP_PASS:
+		return MACB_XDP_PASS;
+	case XDP_TX:
+		if (gem_xdp_xmit_back(queue, xdp))
+			goto out_failure;
+		queue->stats.rx_xdp_tx++;
+		return MACB_XDP_TX;
+	case XDP_REDIRECT:
+		if (xdp_do_redirect(dev, xdp, prog))
+			goto out_failure;
+		queue->stats.rx_xdp_redirect++;
+		return MACB_XDP_REDIRECT;
+	default:
+		bpf_warn_invalid_xdp_action(dev, prog, act);
+		fallthrough;
+	case XDP_ABORTED:
+out_failure:
+		trace_xdp_exception(dev, prog, act);
+		fallthrough;
+	case XDP_DROP:
+		break;
+	}
+
+	page_pool_recycle_direct(queue->page_pool,
+				 virt_to_head_page(xdp->data));
+	queue->stats.rx_xdp_drop++;
+
+	return MACB_XDP_CONSUMED;
+}
+
 static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
 		  int budget)
 {
+	struct bpf_prog *xdp_prog = READ_ONCE(queue->bp->xdp_prog);
 	struct macb *bp = queue->bp;
 	unsigned int		len;
 	unsigned int		entry;
 	struct sk_buff		*skb;
+	struct page		*page;
 	struct macb_dma_desc	*desc;
+	struct xdp_buff		xdp;
+	unsigned int		xdp_status = 0, res;
 	int			count = 0;
 
 	while (count < budget) {
@@ -1371,8 +1566,8 @@ static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
 			queue->stats.rx_dropped++;
 			break;
 		}
-		skb = queue->rx_skbuff[entry];
-		if (unlikely(!skb)) {
+		page = queue->rx_page[entry];
+		if (unlikely(!page)) {
 			netdev_err(bp->dev,
 				   "inconsistent Rx descriptor chain\n");
 			bp->dev->stats.rx_dropped++;
@@ -1380,14 +1575,42 @@ static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
 			break;
 		}
 		/* now everything is ready for receiving packet */
-		queue->rx_skbuff[entry] = NULL;
+		queue->rx_page[entry] = NULL;
 		len = ctrl & bp->rx_frm_len_mask;
 
 		netdev_vdbg(bp->dev, "gem_rx %u (len %u)\n", entry, len);
 
-		skb_put(skb, len);
-		dma_unmap_single(&bp->pdev->dev, addr,
-				 bp->rx_buffer_size, DMA_FROM_DEVICE);
+		dma_sync_single_for_cpu(&bp->pdev->dev, addr,
+					NET_IP_ALIGN + len,
+					page_pool_get_dma_dir(queue->page_pool));
+
+		xdp_init_buff(&xdp, PAGE_SIZE << queue->page_pool->p.order,
+			      &queue->xdp_rxq);
+		xdp_prepare_buff(&xdp, page_address(page),
+				 GEM_RX_HEADROOM + NET_IP_ALIGN, len, false);
+
+		if (xdp_prog) {
+			res = gem_xdp_run(queue, xdp_prog, &xdp);
+			if (res != MACB_XDP_PASS) {
+				xdp_status |= res;
+				bp->dev->stats.rx_packets++;
+				queue->stats.rx_packets++;
+				bp->dev->stats.rx_bytes += len;
+				queue->stats.rx_bytes += len;
+				continue;
+			}
+		}
+
+		skb = napi_build_skb(xdp.data_hard_start, xdp.frame_sz);
+		if (unlikely(!skb)) {
+			page_pool_recycle_direct(queue->page_pool, page);
+			bp->dev->stats.rx_dropped++;
+			queue->stats.rx_dropped++;
+			break;
+		}
+		skb_mark_for_recycle(skb);
+		skb_reserve(skb, xdp.data - xdp.data_hard_start);
+		skb_put(skb, xdp.data_end - xdp.data);
 
 		skb->protocol = eth_type_trans(skb, bp->dev);
 		skb_checksum_none_assert(skb);
@@ -1415,6 +1638,11 @@ static int gem_rx(struct macb_queue *queue, struct napi_struct *napi,
 		napi_gro_receive(napi, skb);
 	}
 
+	if (xdp_status & MACB_XDP_TX)
+		macb_tx_kick(bp);
+	if (xdp_status & MACB_XDP_REDIRECT)
+		xdp_do_flush();
+
 	gem_rx_refill(queue);
 
 	return count;
@@ -2013,6 +2241,7 @@ static unsigned int macb_tx_map(struct macb *bp,
 
 		/* Save info to properly release resources */
 		tx_skb->skb = NULL;
+		tx_skb->xdpf = NULL;
 		tx_skb->mapping = mapping;
 		tx_skb->size = size;
 		tx_skb->mapped_as_page = false;
@@ -2043,6 +2272,7 @@ static unsigned int macb_tx_map(struct macb *bp,
 
 			/* Save info to properly release resources */
 			tx_skb->skb = NULL;
+			tx_skb->xdpf = NULL;
 			tx_skb->mapping = mapping;
 			tx_skb->size = size;
 			tx_skb->mapped_as_page = true;
@@ -2364,36 +2594,49 @@ static void macb_init_rx_buffer_size(struct macb *bp, size_t size)
 		   bp->dev->mtu, bp->rx_buffer_size);
 }
 
+/* Size of a GEM RX buffer: headroom, frame and the skb_shared_info filled
+ * by build_skb()
+ */
+static unsigned int gem_rx_truesize(size_t rx_buffer_size)
+{
+	return SKB_DATA_ALIGN(GEM_RX_HEADROOM + rx_buffer_size) +
+	       SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+}
+
+/* XDP requires a frame to fit in a single page */
+static bool gem_xdp_mtu_ok(int mtu)
+{
+	size_t size = roundup(mtu + ETH_HLEN + ETH_FCS_LEN + NET_IP_ALIGN,
+			      RX_BUFFER_MULTIPLE);
+
+	return gem_rx_truesize(size) <= PAGE_SIZE;
+}
+
 static void gem_free_rx_buffers(struct macb *bp)
 {
-	struct sk_buff		*skb;
-	struct macb_dma_desc	*desc;
 	struct macb_queue *queue;
-	dma_addr_t		addr;
+	struct page *page;
 	unsigned int q;
 	int i;
 
 	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
-		if (!queue->rx_skbuff)
-			continue;
-
-		for (i = 0; i < bp->rx_ring_size; i++) {
-			skb = queue->rx_skbuff[i];
-
-			if (!skb)
-				continue;
-
-			desc = macb_rx_desc(queue, i);
-			addr = macb_get_addr(bp, desc);
+		if (queue->rx_page) {
+			for (i = 0; i < bp->rx_ring_size; i++) {
+				page = queue->rx_page[i];
+				if (page)
+					page_pool_put_full_page(queue->page_pool,
+								page, false);
+			}
 
-			dma_unmap_single(&bp->pdev->dev, addr, bp->rx_buffer_size,
-					DMA_FROM_DEVICE);
-			dev_kfree_skb_any(skb);
-			skb = NULL;
+			kfree(queue->rx_page);
+			queue->rx_page = NULL;
 		}
 
-		kfree(queue->rx_skbuff);
-		queue->rx_skbuff = NULL;
+		if (xdp_rxq_info_is_reg(&queue->xdp_rxq))
+			xdp_rxq_info_unreg(&queue->xdp_rxq);
+
+		page_pool_destroy(queue->page_pool);
+		queue->page_pool = NULL;
 	}
 }
 
@@ -2437,19 +2680,50 @@ static void macb_free_consistent(struct macb *bp)
 
 static int gem_alloc_rx_buffers(struct macb *bp)
 {
+	struct page_pool_params pp_params = {
+		.flags		= PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV,
+		.order		= get_order(gem_rx_truesize(bp->rx_buffer_size)),
+		.pool_size	= bp->rx_ring_size,
+		.nid		= dev_to_node(&bp->pdev->dev),
+		.dev		= &bp->pdev->dev,
+		.dma_dir	= bp->xdp_prog ? DMA_BIDIRECTIONAL :
+						 DMA_FROM_DEVICE,
+		.offset		= GEM_RX_HEADROOM,
+		.max_len	= bp->rx_buffer_size,
+	};
 	struct macb_queue *queue;
 	unsigned int q;
-	int size;
+	int size, err;
 
 	for (q = 0, queue = bp->queues; q < bp->num_queues; ++q, ++queue) {
-		size = bp->rx_ring_size * sizeof(struct sk_buff *);
-		queue->rx_skbuff = kzalloc(size, GFP_KERNEL);
-		if (!queue->rx_skbuff)
+		size = bp->rx_ring_size * sizeof(struct page *);
+		queue->rx_page = kzalloc(size, GFP_KERNEL);
+		if (!queue->rx_page)
 			return -ENOMEM;
-		else
-			netdev_dbg(bp->dev,
-				   "Allocated %d RX struct sk_buff entries at %p\n",
-				   bp->rx_ring_size, queue->rx_skbuff);
+
+		queue->page_pool = page_pool_create(&pp_params);
+		if (IS_ERR(queue->page_pool)) {
+			err = PTR_ERR(queue->page_pool);
+			queue->page_pool = NULL;
+			return err;
+		}
+
+		err = xdp_rxq_info_reg(&queue->xdp_rxq, bp->dev, q,
+				       queue->napi_rx.napi_id);
+		if (err)
+			return err;
+
+		err = xdp_rxq_info_reg_mem_model(&queue->xdp_rxq,
+						 MEM_TYPE_PAGE_POOL,
+						 queue->page_pool);
+		if (err) {
+			xdp_rxq_info_unreg(&queue->xdp_rxq);
+			return err;
+		}
+
+		netdev_dbg(bp->dev,
+			   "Allocated %d RX page entries of order %u at %p\n",
+			   bp->rx_ring_size, pp_params.order, queue->rx_page);
 	}
 	return 0;
 }
@@ -2946,9 +3220,16 @@ static int macb_close(struct net_device *dev)
 
 static int macb_change_mtu(struct net_device *dev, int new_mtu)
 {
+	struct macb *bp = netdev_priv(dev);
+
 	if (netif_running(dev))
 		return -EBUSY;
 
+	if (bp->xdp_prog && !gem_xdp_mtu_ok(new_mtu)) {
+		netdev_err(dev, "MTU %d too large for XDP\n", new_mtu);
+		return -EINVAL;
+	}
+
 	dev->mtu = new_mtu;
 
 	return 0;
@@ -3784,6 +4065,79 @@ static void macb_restore_features(struct macb *bp)
 	macb_set_rxflow_feature(bp, features);
 }
 
+static int gem_xdp_setup(struct net_device *dev, struct bpf_prog *prog,
+			 struct netlink_ext_ack *extack)
+{
+	struct macb *bp = netdev_priv(dev);
+	bool running = netif_running(dev);
+	struct bpf_prog *old_prog;
+	bool need_reset;
+
+	if (prog && !gem_xdp_mtu_ok(dev->mtu)) {
+		NL_SET_ERR_MSG_MOD(extack, "MTU too large for XDP");
+		return -EOPNOTSUPP;
+	}
+
+	/* the RX page pools are mapped bidirectionally for XDP_TX */
+	need_reset = !!bp->xdp_prog != !!prog;
+	if (running && need_reset)
+		macb_close(dev);
+
+	old_prog = xchg(&bp->xdp_prog, prog);
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	if (running && need_reset)
+		return macb_open(dev);
+
+	return 0;
+}
+
+static int gem_xdp(struct net_device *dev, struct netdev_bpf *xdp)
+{
+	struct macb *bp = netdev_priv(dev);
+
+	if (!macb_is_gem(bp))
+		return -EOPNOTSUPP;
+
+	switch (xdp->command) {
+	case XDP_SETUP_PROG:
+		return gem_xdp_setup(dev, xdp->prog, xdp->extack);
+	default:
+		return -EINVAL;
+	}
+}
+
+static int gem_xdp_xmit(struct net_device *dev, int num_frames,
+			struct xdp_frame **frames, u32 flags)
+{
+	struct macb *bp = netdev_priv(dev);
+	struct macb_queue *queue;
+	int i, nxmit = 0;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	if (unlikely(!netif_running(dev) || !netif_carrier_ok(dev)))
+		return -ENETDOWN;
+
+	queue = &bp->queues[smp_processor_id() % bp->num_queues];
+
+	spin_lock(&queue->tx_ptr_lock);
+	for (i = 0; i < num_frames; i++) {
+		if (macb_xdp_submit_frame(queue, frames[i], true))
+			break;
+		nxmit++;
+	}
+	queue->stats.tx_xdp_xmit += nxmit;
+	spin_unlock(&queue->tx_ptr_lock);
+
+	if (nxmit && (flags & XDP_XMIT_FLUSH))
+		macb_tx_kick(bp);
+
+	return nxmit;
+}
+
 static const struct net_device_ops macb_netdev_ops = {
 	.ndo_open		= macb_open,
 	.ndo_stop		= macb_close,
@@ -3799,6 +4153,8 @@ static const struct net_device_ops macb_netdev_ops = {
 #endif
 	.ndo_set_features	= macb_set_features,
 	.ndo_features_check	= macb_features_check,
+	.ndo_bpf		= gem_xdp,
+	.ndo_xdp_xmit		= gem_xdp_xmit,
 };
 
 /* Configure peripheral capabilities according to device tree
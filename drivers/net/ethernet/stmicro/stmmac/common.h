@@ -62,11 +62,28 @@
 struct stmmac_txq_stats {
 	unsigned long tx_pkt_n;
 	unsigned long tx_normal_irq_n;
+	/* AF_XDP zero-copy */
+	unsigned long tx_xsk_pkt_n;
+	unsigned long tx_xsk_done_n;
+	unsigned long tx_xsk_wakeup_n;
+	/* XDP_TX and ndo_xdp_xmit */
+	unsigned long tx_xdp_lock_busy_n;
+	unsigned long tx_xdp_pp_mapped_n;
 };
 
 struct stmmac_rxq_stats {
 	unsigned long rx_pkt_n;
 	unsigned long rx_normal_irq_n;
+	/* AF_XDP zero-copy */
+	unsigned long rx_xsk_fill_empty_n;
+	unsigned long rx_xsk_need_wakeup_n;
+	unsigned long rx_xsk_wakeup_n;
+	/* NAPI budget use and descriptor refill cost */
+	unsigned long rx_napi_poll_n;
+	unsigned long rx_napi_work_n;
+	unsigned long rx_napi_full_n;
+	unsigned long rx_refill_n;
+	unsigned long rx_refill_ns;
 };
 
 /* Extra statistic and debug information exposed by ethtool */
@@ -194,6 +211,9 @@ struct stmmac_extra_stats {
 	/* TSO */
 	unsigned long tx_tso_frames;
 	unsigned long tx_tso_nfrags;
+	unsigned long tx_tso_desc;
+	unsigned long tx_uso_frames;
+	unsigned long tx_uso_segs;
 	/* EST */
 	unsigned long mtl_est_cgce;
 	unsigned long mtl_est_hlbs;
@@ -203,6 +223,8 @@ struct stmmac_extra_stats {
 	unsigned long est_tx_overrun[MTL_MAX_TX_QUEUES];
 	unsigned long max_sdu_txq_drop[MTL_MAX_TX_QUEUES];
 	unsigned long mtl_est_txq_hlbf[MTL_MAX_TX_QUEUES];
+	unsigned long mtl_est_txq_hlbs[MTL_MAX_TX_QUEUES];
+	unsigned long est_txq_tx_pkt_n[MTL_MAX_TX_QUEUES];
 	/* per queue statistics */
 	struct stmmac_txq_stats txq_stats[MTL_MAX_TX_QUEUES];
 	struct stmmac_rxq_stats rxq_stats[MTL_MAX_RX_QUEUES];
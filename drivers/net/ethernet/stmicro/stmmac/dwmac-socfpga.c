@@ -182,12 +182,16 @@ static int smtg_crosststamp(ktime_t *device, struct system_counterval_t *system,
 	}
 	writel(acr_value, ptpaddr + PTP_ACR);
 
+	/* Keep the timestamp interrupt from consuming the snapshot, the
+	 * mutex is held until it is read so that the FIFO only holds the
+	 * snapshot of this trigger.
+	 */
+	priv->plat->int_snapshot_en = 1;
+
 	/* Clear FIFO */
 	acr_value = readl(ptpaddr + PTP_ACR);
 	acr_value |= PTP_ACR_ATSFC;
 	writel(acr_value, ptpaddr + PTP_ACR);
-	/* Release the mutex */
-	mutex_unlock(&priv->aux_ts_lock);
 
 	/* Trigger Internal snapshot signal
 	 * Create a rising edge by just toggle the GPO0 to low
@@ -205,7 +209,7 @@ static int smtg_crosststamp(ktime_t *device, struct system_counterval_t *system,
 
 	if (ret == -ETIMEDOUT) {
 		pr_err("%s: Wait for time sync operation timeout\n", __func__);
-		return ret;
+		goto out;
 	}
 
 	num_snapshot = (readl(ioaddr + XGMAC_TIMESTAMP_STATUS) &
@@ -223,7 +227,17 @@ static int smtg_crosststamp(ktime_t *device, struct system_counterval_t *system,
 	get_smtgtime(priv->mii, SMTG_HUB_ADDR, &smtg_time_ctr0, &smtg_time_ctr1);
 	system->cs = get_clocksource();
 	system->cycles = smtg_time_ctr0;
-	return 0;
+
+out:
+	/* Disable the internal snapshot trigger */
+	acr_value = readl(ptpaddr + PTP_ACR);
+	acr_value &= ~PTP_ACR_MASK;
+	writel(acr_value, ptpaddr + PTP_ACR);
+
+	priv->plat->int_snapshot_en = 0;
+	mutex_unlock(&priv->aux_ts_lock);
+
+	return ret;
 }
 
 static int socfpga_dwmac_parse_data(struct socfpga_dwmac *dwmac, struct device *dev)
@@ -434,7 +434,7 @@ int dwmac5_rxp_config(void __iomem *ioaddr, struct stmmac_tc_entry *entries,
 		      unsigned int count)
 {
 	struct stmmac_tc_entry *entry, *frag;
-	int i, ret, nve = 0;
+	int i, ret, nve = 0, len;
 	u32 curr_prio = 0;
 	u32 old_val, val;
 
@@ -461,27 +461,31 @@ int dwmac5_rxp_config(void __iomem *ioaddr, struct stmmac_tc_entry *entries,
 			break;
 
 		curr_prio = entry->prio;
-		frag = entry->frag_ptr;
-
-		/* Set special fragment requirements */
-		if (frag) {
-			entry->val.af = 0;
-			entry->val.rf = 0;
-			entry->val.nc = 1;
-			entry->val.ok_index = nve + 2;
-		}
 
-		ret = dwmac5_rxp_update_single_entry(ioaddr, entry, nve);
-		if (ret)
-			goto re_enable;
+		/* Count the fragments chained to the entry */
+		len = 1;
+		for (frag = entry->frag_ptr; frag; frag = frag->frag_ptr)
+			len++;
 
-		entry->table_pos = nve++;
-		entry->in_hw = true;
+		/* Set special fragment requirements: every word but the
+		 * last one goes on with the next, the last one holds the
+		 * actions.
+		 */
+		for (frag = entry; frag->frag_ptr; frag = frag->frag_ptr) {
+			frag->val.af = 0;
+			frag->val.rf = 0;
+			frag->val.nc = 1;
+			frag->val.ok_index = nve + len;
+		}
+
+		for (frag = entry; frag; frag = frag->frag_ptr) {
+			if (frag->in_hw)
+				continue;
 
-		if (frag && !frag->in_hw) {
 			ret = dwmac5_rxp_update_single_entry(ioaddr, frag, nve);
 			if (ret)
 				goto re_enable;
+
 			frag->table_pos = nve++;
 			frag->in_hw = true;
 		}
@@ -523,7 +527,7 @@ int dwmac5_flex_pps_config(void __iomem *ioaddr, int index,
 {
 	u32 tnsec = readl(ioaddr + MAC_PPSx_TARGET_TIME_NSEC(index));
 	u32 val = readl(ioaddr + MAC_PPS_CONTROL);
-	u64 period;
+	u64 period, width;
 
 	if (!cfg->available)
 		return -EINVAL;
@@ -547,9 +551,11 @@ int dwmac5_flex_pps_config(void __iomem *ioaddr, int index,
 
 	writel(cfg->start.tv_sec, ioaddr + MAC_PPSx_TARGET_TIME_SEC(index));
 
+	/* With binary rollover the subseconds count in 2^-31 s */
+	tnsec = cfg->start.tv_nsec;
 	if (!(systime_flags & PTP_TCR_TSCTRLSSR))
-		cfg->start.tv_nsec = (cfg->start.tv_nsec * 1000) / 465;
-	writel(cfg->start.tv_nsec, ioaddr + MAC_PPSx_TARGET_TIME_NSEC(index));
+		tnsec = div_u64((u64)tnsec << 31, NSEC_PER_SEC);
+	writel(tnsec, ioaddr + MAC_PPSx_TARGET_TIME_NSEC(index));
 
 	period = cfg->period.tv_sec * 1000000000;
 	period += cfg->period.tv_nsec;
@@ -561,11 +567,19 @@ int dwmac5_flex_pps_config(void __iomem *ioaddr, int index,
 
 	writel(period - 1, ioaddr + MAC_PPSx_INTERVAL(index));
 
-	period >>= 1;
-	if (period <= 1)
+	if (cfg->width.tv_sec || cfg->width.tv_nsec) {
+		width = cfg->width.tv_sec * 1000000000;
+		width += cfg->width.tv_nsec;
+
+		do_div(width, sub_second_inc);
+	} else {
+		width = period >> 1;
+	}
+
+	if (width <= 1 || width >= period)
 		return -EINVAL;
 
-	writel(period - 1, ioaddr + MAC_PPSx_WIDTH(index));
+	writel(width - 1, ioaddr + MAC_PPSx_WIDTH(index));
 
 	/* Finally, activate it */
 	val |= PPSCMDx(index, 0x2);
@@ -597,6 +611,18 @@ int dwmac5_est_configure(void __iomem *ioaddr, struct stmmac_est *cfg,
 	int i, ret = 0x0;
 	u32 ctrl;
 
+	/* The hardware still runs the oper list while the admin one gets
+	 * written to the software owned list. Wait for any previous switch
+	 * to be done, or the pending one would pick up a partial list.
+	 */
+	ctrl = readl(ioaddr + MTL_EST_CONTROL);
+	if (cfg->enable && (ctrl & EEST)) {
+		ret = readl_poll_timeout(ioaddr + MTL_EST_CONTROL, ctrl,
+					 !(ctrl & SSWL), 1000, USEC_PER_SEC);
+		if (ret)
+			return ret;
+	}
+
 	ret |= dwmac5_est_write(ioaddr, BTR_LOW, cfg->btr[0], false);
 	ret |= dwmac5_est_write(ioaddr, BTR_HIGH, cfg->btr[1], false);
 	ret |= dwmac5_est_write(ioaddr, TER, cfg->ter, false);
@@ -638,6 +664,7 @@ void dwmac5_est_irq_status(void __iomem *ioaddr, struct net_device *dev,
 {
 	u32 status, value, feqn, hbfq, hbfs, btrl;
 	u32 txqcnt_mask = (1 << txqcnt) - 1;
+	int i;
 
 	status = readl(ioaddr + MTL_EST_STATUS);
 
@@ -658,6 +685,11 @@ void dwmac5_est_irq_status(void __iomem *ioaddr, struct net_device *dev,
 		value = readl(ioaddr + MTL_EST_SCH_ERR);
 		value &= txqcnt_mask;
 
+		for (i = 0; i < txqcnt; i++) {
+			if (value & BIT(i))
+				x->mtl_est_txq_hlbs[i]++;
+		}
+
 		x->mtl_est_hlbs++;
 
 		/* Clear Interrupt */
@@ -675,6 +707,11 @@ void dwmac5_est_irq_status(void __iomem *ioaddr, struct net_device *dev,
 		value = readl(ioaddr + MTL_EST_FRM_SZ_ERR);
 		feqn = value & txqcnt_mask;
 
+		for (i = 0; i < txqcnt; i++) {
+			if (feqn & BIT(i))
+				x->mtl_est_txq_hlbf[i]++;
+		}
+
 		value = readl(ioaddr + MTL_EST_FRM_SZ_CAP);
 		hbfq = (value & SZ_CAP_HBFQ_MASK(txqcnt)) >> SZ_CAP_HBFQ_SHIFT;
 		hbfs = value & SZ_CAP_HBFS_MASK;
@@ -1241,7 +1241,7 @@ static int dwxgmac3_rxp_config(void __iomem *ioaddr,
 			       unsigned int count)
 {
 	struct stmmac_tc_entry *entry, *frag;
-	int i, ret, nve = 0;
+	int i, ret, nve = 0, len;
 	u32 curr_prio = 0;
 	u32 old_val, val;
 
@@ -1268,27 +1268,31 @@ static int dwxgmac3_rxp_config(void __iomem *ioaddr,
 			break;
 
 		curr_prio = entry->prio;
-		frag = entry->frag_ptr;
-
-		/* Set special fragment requirements */
-		if (frag) {
-			entry->val.af = 0;
-			entry->val.rf = 0;
-			entry->val.nc = 1;
-			entry->val.ok_index = nve + 2;
-		}
 
-		ret = dwxgmac3_rxp_update_single_entry(ioaddr, entry, nve);
-		if (ret)
-			goto re_enable;
+		/* Count the fragments chained to the entry */
+		len = 1;
+		for (frag = entry->frag_ptr; frag; frag = frag->frag_ptr)
+			len++;
 
-		entry->table_pos = nve++;
-		entry->in_hw = true;
+		/* Set special fragment requirements: every word but the
+		 * last one goes on with the next, the last one holds the
+		 * actions.
+		 */
+		for (frag = entry; frag->frag_ptr; frag = frag->frag_ptr) {
+			frag->val.af = 0;
+			frag->val.rf = 0;
+			frag->val.nc = 1;
+			frag->val.ok_index = nve + len;
+		}
+
+		for (frag = entry; frag; frag = frag->frag_ptr) {
+			if (frag->in_hw)
+				continue;
 
-		if (frag && !frag->in_hw) {
 			ret = dwxgmac3_rxp_update_single_entry(ioaddr, frag, nve);
 			if (ret)
 				goto re_enable;
+
 			frag->table_pos = nve++;
 			frag->in_hw = true;
 		}
@@ -1344,7 +1348,7 @@ static int dwxgmac2_flex_pps_config(void __iomem *ioaddr, int index,
 {
 	u32 tnsec = readl(ioaddr + XGMAC_PPSx_TARGET_TIME_NSEC(index));
 	u32 val = readl(ioaddr + XGMAC_PPS_CONTROL);
-	u64 period;
+	u64 period, width;
 
 	if (!cfg->available)
 		return -EINVAL;
@@ -1379,9 +1383,11 @@ static int dwxgmac2_flex_pps_config(void __iomem *ioaddr, int index,
 
 	writel(cfg->start.tv_sec, ioaddr + XGMAC_PPSx_TARGET_TIME_SEC(index));
 
+	/* With binary rollover the subseconds count in 2^-31 s */
+	tnsec = cfg->start.tv_nsec;
 	if (!(systime_flags & PTP_TCR_TSCTRLSSR))
-		cfg->start.tv_nsec = (cfg->start.tv_nsec * 1000) / 465;
-	writel(cfg->start.tv_nsec, ioaddr + XGMAC_PPSx_TARGET_TIME_NSEC(index));
+		tnsec = div_u64((u64)tnsec << 31, NSEC_PER_SEC);
+	writel(tnsec, ioaddr + XGMAC_PPSx_TARGET_TIME_NSEC(index));
 
 	period = cfg->period.tv_sec * 1000000000;
 	period += cfg->period.tv_nsec;
@@ -1393,11 +1399,19 @@ static int dwxgmac2_flex_pps_config(void __iomem *ioaddr, int index,
 
 	writel(period - 1, ioaddr + XGMAC_PPSx_INTERVAL(index));
 
-	period >>= 1;
-	if (period <= 1)
+	if (cfg->width.tv_sec || cfg->width.tv_nsec) {
+		width = cfg->width.tv_sec * 1000000000;
+		width += cfg->width.tv_nsec;
+
+		do_div(width, sub_second_inc);
+	} else {
+		width = period >> 1;
+	}
+
+	if (width <= 1 || width >= period)
 		return -EINVAL;
 
-	writel(period - 1, ioaddr + XGMAC_PPSx_WIDTH(index));
+	writel(width - 1, ioaddr + XGMAC_PPSx_WIDTH(index));
 
 	/* Finally, activate it */
 	writel(val, ioaddr + XGMAC_PPS_CONTROL);
@@ -1742,6 +1756,11 @@ static void dwxgmac3_est_irq_status(void __iomem *ioaddr,
 		value = readl(ioaddr + XGMAC_MTL_EST_SCH_ERR);
 		value &= txqcnt_mask;
 
+		for (i = 0; i < txqcnt; i++) {
+			if (value & BIT(i))
+				x->mtl_est_txq_hlbs[i]++;
+		}
+
 		x->mtl_est_hlbs++;
 
 		/* Clear Interrupt */
@@ -12,6 +12,7 @@
 #define STMMAC_RESOURCE_NAME   "stmmaceth"
 
 #include <linux/clk.h>
+#include <linux/dim.h>
 #include <linux/hrtimer.h>
 #include <linux/if_vlan.h>
 #include <linux/stmmac.h>
@@ -49,6 +50,8 @@ struct stmmac_tx_info {
 	unsigned len;
 	bool last_segment;
 	bool is_jumbo;
+	/* Mapping owned by the page_pool of the frame, not to be unmapped */
+	bool pp_mapped;
 	enum stmmac_txbuf_type buf_type;
 };
 
@@ -77,6 +80,9 @@ struct stmmac_tx_queue {
 	dma_addr_t dma_tx_phy;
 	dma_addr_t tx_tail_addr;
 	u32 mss;
+	/* Header slots of stmmac_uso_xmit(), one per descriptor */
+	u8 *uso_hdr;
+	dma_addr_t uso_hdr_dma;
 };
 
 struct stmmac_rx_buffer {
@@ -111,6 +117,8 @@ struct stmmac_rx_queue {
 	unsigned int state_saved;
 	struct {
 		struct sk_buff *skb;
+		struct xdp_buff xdp;
+		bool xdp_pending;
 		unsigned int len;
 		unsigned int error;
 	} state;
@@ -123,6 +131,16 @@ struct stmmac_channel {
 	struct stmmac_priv *priv_data;
 	spinlock_t lock;
 	u32 index;
+
+	/* Adaptive interrupt moderation */
+	struct dim rx_dim;
+	struct dim tx_dim;
+	u16 rx_dim_events;
+	u16 tx_dim_events;
+	u64 rx_dim_packets;
+	u64 rx_dim_bytes;
+	u64 tx_dim_packets;
+	u64 tx_dim_bytes;
 };
 
 struct stmmac_tc_entry {
@@ -149,11 +167,22 @@ struct stmmac_tc_entry {
 	} __packed val;
 };
 
+/* ethtool n-tuple rules, built on top of the Flexible RX Parser entries */
+#define STMMAC_NTUPLE_MAX	32
+
+struct stmmac_ntuple_entry {
+	struct ethtool_rx_flow_spec fs;
+	struct stmmac_tc_entry *head;
+	bool in_use;
+};
+
 #define STMMAC_PPS_MAX		4
 struct stmmac_pps_cfg {
 	bool available;
 	struct timespec64 start;
 	struct timespec64 period;
+	/* Pulse width, half the period when zero */
+	struct timespec64 width;
 };
 
 struct stmmac_rss {
@@ -209,6 +238,7 @@ struct stmmac_priv {
 	int hwts_tx_en;
 	bool tx_path_in_lpi_mode;
 	bool tso;
+	bool uso_sw;
 	bool tx_q_coe_lmt;
 	u32 tx_q_with_coe;
 	int sph;
@@ -269,6 +299,8 @@ struct stmmac_priv {
 	u32 systime_flags;
 	u32 adv_ts;
 	int use_riwt;
+	bool rx_dim_enabled;
+	bool tx_dim_enabled;
 	int irq_wake;
 	rwlock_t ptp_lock;
 	/* Protects auxiliary snapshot registers from concurrent access. */
@@ -308,6 +340,7 @@ struct stmmac_priv {
 	/* TC Handling */
 	unsigned int tc_entries_max;
 	unsigned int tc_off_max;
+	struct stmmac_ntuple_entry *ntuple_entries;
 	struct stmmac_tc_entry *tc_entries;
 	unsigned int flow_entries_max;
 	struct stmmac_flow_entry *flow_entries;
@@ -325,6 +358,8 @@ struct stmmac_priv {
 	/* XDP BPF Program */
 	unsigned long *af_xdp_zc_qps;
 	struct bpf_prog *xdp_prog;
+	/* TX queues at the top of the range dedicated to XDP, one per CPU */
+	u32 xdp_txq_cnt;
 };
 
 enum stmmac_state {
@@ -345,6 +380,7 @@ void stmmac_ptp_register(struct stmmac_priv *priv);
 void stmmac_ptp_unregister(struct stmmac_priv *priv);
 int stmmac_xdp_open(struct net_device *dev);
 void stmmac_xdp_release(struct net_device *dev);
+void stmmac_xdp_txq_update(struct stmmac_priv *priv);
 int stmmac_resume(struct device *dev);
 int stmmac_suspend(struct device *dev);
 int stmmac_dvr_remove(struct device *dev);
@@ -368,9 +404,21 @@ static inline unsigned int stmmac_rx_offset(struct stmmac_priv *priv)
 	if (stmmac_xdp_is_enabled(priv))
 		return XDP_PACKET_HEADROOM;
 
-	return 0;
+	/* headroom for the SKBs built around the RX pages */
+	return NET_SKB_PAD;
 }
 
+/* Order of the RX pages holding the offset and a buffer of @buf_sz */
+static inline unsigned int stmmac_rx_page_order(struct stmmac_priv *priv,
+						unsigned int buf_sz)
+{
+	return order_base_2(DIV_ROUND_UP(stmmac_rx_offset(priv) + buf_sz,
+					 PAGE_SIZE));
+}
+
+u32 stmmac_usec2riwt(u32 usec, struct stmmac_priv *priv);
+u32 stmmac_riwt2usec(u32 riwt, struct stmmac_priv *priv);
+
 void stmmac_disable_rx_queue(struct stmmac_priv *priv, u32 queue);
 void stmmac_enable_rx_queue(struct stmmac_priv *priv, u32 queue);
 void stmmac_disable_tx_queue(struct stmmac_priv *priv, u32 queue);
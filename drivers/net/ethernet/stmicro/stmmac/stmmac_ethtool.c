@@ -15,6 +15,7 @@
 #include <linux/phylink.h>
 #include <linux/net_tstamp.h>
 #include <asm/io.h>
+#include <asm/unaligned.h>
 
 #include "stmmac.h"
 #include "dwmac_dma.h"
@@ -35,7 +36,7 @@
 
 #define ETHTOOL_DMA_OFFSET	55
 
-#define STMMAC_QBV_STATS_CNT	2
+#define STMMAC_QBV_STATS_CNT	4
 
 struct stmmac_stats {
 	char stat_string[ETH_GSTRING_LEN];
@@ -168,6 +169,9 @@ static const struct stmmac_stats stmmac_gstrings_stats[] = {
 	/* TSO */
 	STMMAC_STAT(tx_tso_frames),
 	STMMAC_STAT(tx_tso_nfrags),
+	STMMAC_STAT(tx_tso_desc),
+	STMMAC_STAT(tx_uso_frames),
+	STMMAC_STAT(tx_uso_segs),
 	/* EST */
 	STMMAC_STAT(mtl_est_cgce),
 	STMMAC_STAT(mtl_est_hlbs),
@@ -274,12 +278,25 @@ static const struct stmmac_stats stmmac_mmc[] = {
 static const char stmmac_qstats_tx_string[][ETH_GSTRING_LEN] = {
 	"tx_pkt_n",
 	"tx_irq_n",
+	"tx_xsk_pkt_n",
+	"tx_xsk_done_n",
+	"tx_xsk_wakeup_n",
+	"tx_xdp_lock_busy_n",
+	"tx_xdp_pp_mapped_n",
 #define STMMAC_TXQ_STATS ARRAY_SIZE(stmmac_qstats_tx_string)
 };
 
 static const char stmmac_qstats_rx_string[][ETH_GSTRING_LEN] = {
 	"rx_pkt_n",
 	"rx_irq_n",
+	"rx_xsk_fill_empty_n",
+	"rx_xsk_need_wakeup_n",
+	"rx_xsk_wakeup_n",
+	"rx_napi_poll_n",
+	"rx_napi_work_n",
+	"rx_napi_full_n",
+	"rx_refill_n",
+	"rx_refill_ns",
 #define STMMAC_RXQ_STATS ARRAY_SIZE(stmmac_qstats_rx_string)
 };
 
@@ -578,6 +595,16 @@ static void stmmac_get_per_qstats(struct stmmac_priv *priv, u64 *data)
 					    xstats.est_tx_overrun[q]);
 		*data++ = (*(unsigned long *)p);
 	}
+	for (q = 0; q < tx_cnt; q++) {
+		p = (char *)priv + offsetof(struct stmmac_priv,
+					    xstats.est_txq_tx_pkt_n[q]);
+		*data++ = (*(unsigned long *)p);
+	}
+	for (q = 0; q < tx_cnt; q++) {
+		p = (char *)priv + offsetof(struct stmmac_priv,
+					    xstats.mtl_est_txq_hlbs[q]);
+		*data++ = (*(unsigned long *)p);
+	}
 }
 
 static void stmmac_get_ethtool_stats(struct net_device *dev,
@@ -695,6 +722,14 @@ static void stmmac_get_qstats_string(struct stmmac_priv *priv, u8 *data)
 		snprintf(data, ETH_GSTRING_LEN, "q%d_est_tx_overruns", q);
 		data += ETH_GSTRING_LEN;
 	}
+	for (q = 0; q < tx_cnt; q++) {
+		snprintf(data, ETH_GSTRING_LEN, "q%d_est_tx_pkts", q);
+		data += ETH_GSTRING_LEN;
+	}
+	for (q = 0; q < tx_cnt; q++) {
+		snprintf(data, ETH_GSTRING_LEN, "q%d_est_missed_windows", q);
+		data += ETH_GSTRING_LEN;
+	}
 }
 
 static void stmmac_get_strings(struct net_device *dev, u32 stringset, u8 *data)
@@ -842,7 +877,7 @@ static int stmmac_ethtool_op_set_eee(struct net_device *dev,
 	return 0;
 }
 
-static u32 stmmac_usec2riwt(u32 usec, struct stmmac_priv *priv)
+u32 stmmac_usec2riwt(u32 usec, struct stmmac_priv *priv)
 {
 	unsigned long clk = clk_get_rate(priv->plat->stmmac_clk);
 
@@ -855,7 +890,7 @@ static u32 stmmac_usec2riwt(u32 usec, struct stmmac_priv *priv)
 	return (usec * (clk / 1000000)) / 256;
 }
 
-static u32 stmmac_riwt2usec(u32 riwt, struct stmmac_priv *priv)
+u32 stmmac_riwt2usec(u32 riwt, struct stmmac_priv *priv)
 {
 	unsigned long clk = clk_get_rate(priv->plat->stmmac_clk);
 
@@ -894,6 +929,9 @@ static int __stmmac_get_coalesce(struct net_device *dev,
 		ec->tx_max_coalesced_frames = 0;
 	}
 
+	ec->use_adaptive_rx_coalesce = priv->rx_dim_enabled;
+	ec->use_adaptive_tx_coalesce = priv->tx_dim_enabled;
+
 	if (priv->use_riwt && queue < rx_cnt) {
 		ec->rx_max_coalesced_frames = priv->rx_coal_frames[queue];
 		ec->rx_coalesce_usecs = stmmac_riwt2usec(priv->rx_riwt[queue],
@@ -940,6 +978,15 @@ static int __stmmac_set_coalesce(struct net_device *dev,
 	else if (queue >= max_cnt)
 		return -EINVAL;
 
+	/* DIM needs the RX watchdog to act on, and applies to all queues */
+	if (ec->use_adaptive_rx_coalesce != priv->rx_dim_enabled ||
+	    ec->use_adaptive_tx_coalesce != priv->tx_dim_enabled) {
+		if (!all_queues)
+			return -EINVAL;
+		if (ec->use_adaptive_rx_coalesce && !priv->use_riwt)
+			return -EOPNOTSUPP;
+	}
+
 	if (priv->use_riwt && (ec->rx_coalesce_usecs > 0)) {
 		rx_riwt = stmmac_usec2riwt(ec->rx_coalesce_usecs, priv);
 
@@ -973,6 +1020,9 @@ static int __stmmac_set_coalesce(struct net_device *dev,
 	    (ec->tx_max_coalesced_frames > STMMAC_TX_MAX_FRAMES))
 		return -EINVAL;
 
+	priv->rx_dim_enabled = ec->use_adaptive_rx_coalesce;
+	priv->tx_dim_enabled = ec->use_adaptive_tx_coalesce;
+
 	if (all_queues) {
 		int i;
 
@@ -1006,15 +1056,265 @@ static int stmmac_set_per_queue_coalesce(struct net_device *dev, u32 queue,
 	return __stmmac_set_coalesce(dev, ec, queue);
 }
 
+/* The match covers the frame up to the L4 ports of an IPv4 packet without
+ * options, the header length being part of the match.
+ */
+#define STMMAC_NTUPLE_LEN	40
+
+static void stmmac_ntuple_set(u8 *data, u8 *mask, unsigned int off,
+			      const void *key, const void *key_mask,
+			      unsigned int len)
+{
+	const u8 *k = key, *m = key_mask;
+	unsigned int i;
+
+	for (i = 0; i < len; i++) {
+		data[off + i] = k[i] & m[i];
+		mask[off + i] = m[i];
+	}
+}
+
+static int stmmac_ntuple_parse(struct ethtool_rx_flow_spec *fs, u8 *data,
+			       u8 *mask)
+{
+	static const u8 ethertype_mask[2] = { 0xff, 0xff };
+	static const u8 byte_mask = 0xff;
+	static const u8 ip_ihl5 = 0x45;
+	struct ethtool_tcpip4_spec *l4, *l4_mask;
+	struct ethtool_usrip4_spec *ip, *ip_mask;
+	__be16 ethertype = htons(ETH_P_IP);
+	u8 proto;
+
+	memset(data, 0, STMMAC_NTUPLE_LEN);
+	memset(mask, 0, STMMAC_NTUPLE_LEN);
+
+	stmmac_ntuple_set(data, mask, 12, &ethertype, ethertype_mask, 2);
+	stmmac_ntuple_set(data, mask, 14, &ip_ihl5, &byte_mask, 1);
+
+	switch (fs->flow_type) {
+	case TCP_V4_FLOW:
+	case UDP_V4_FLOW:
+		l4 = &fs->h_u.tcp_ip4_spec;
+		l4_mask = &fs->m_u.tcp_ip4_spec;
+		proto = fs->flow_type == TCP_V4_FLOW ? IPPROTO_TCP : IPPROTO_UDP;
+
+		stmmac_ntuple_set(data, mask, 15, &l4->tos, &l4_mask->tos, 1);
+		stmmac_ntuple_set(data, mask, 23, &proto, &byte_mask, 1);
+		stmmac_ntuple_set(data, mask, 26, &l4->ip4src,
+				  &l4_mask->ip4src, 4);
+		stmmac_ntuple_set(data, mask, 30, &l4->ip4dst,
+				  &l4_mask->ip4dst, 4);
+		stmmac_ntuple_set(data, mask, 34, &l4->psrc, &l4_mask->psrc, 2);
+		stmmac_ntuple_set(data, mask, 36, &l4->pdst, &l4_mask->pdst, 2);
+		break;
+	case IPV4_USER_FLOW:
+		ip = &fs->h_u.usr_ip4_spec;
+		ip_mask = &fs->m_u.usr_ip4_spec;
+		if (ip_mask->ip_ver)
+			return -EOPNOTSUPP;
+
+		stmmac_ntuple_set(data, mask, 15, &ip->tos, &ip_mask->tos, 1);
+		stmmac_ntuple_set(data, mask, 23, &ip->proto, &ip_mask->proto, 1);
+		stmmac_ntuple_set(data, mask, 26, &ip->ip4src,
+				  &ip_mask->ip4src, 4);
+		stmmac_ntuple_set(data, mask, 30, &ip->ip4dst,
+				  &ip_mask->ip4dst, 4);
+		stmmac_ntuple_set(data, mask, 34, &ip->l4_4_bytes,
+				  &ip_mask->l4_4_bytes, 4);
+		break;
+	default:
+		return -EOPNOTSUPP;
+	}
+
+	return 0;
+}
+
+static struct stmmac_tc_entry *stmmac_ntuple_get_free(struct stmmac_priv *priv)
+{
+	struct stmmac_tc_entry *entry;
+	int i;
+
+	for (i = 0; i < priv->tc_entries_max; i++) {
+		entry = &priv->tc_entries[i];
+		if (!entry->in_use)
+			return entry;
+	}
+
+	return NULL;
+}
+
+static void stmmac_ntuple_release(struct stmmac_ntuple_entry *rule)
+{
+	struct stmmac_tc_entry *entry, *next;
+
+	for (entry = rule->head; entry; entry = next) {
+		next = entry->frag_ptr;
+		entry->frag_ptr = NULL;
+		entry->is_frag = false;
+		entry->in_use = false;
+	}
+
+	rule->head = NULL;
+	rule->in_use = false;
+}
+
+static int stmmac_add_ntuple(struct stmmac_priv *priv,
+			     struct ethtool_rx_flow_spec *fs)
+{
+	struct stmmac_tc_entry *entry, *prev = NULL;
+	u8 data[STMMAC_NTUPLE_LEN], mask[STMMAC_NTUPLE_LEN];
+	struct stmmac_ntuple_entry *rule;
+	unsigned int word;
+	u32 queue = 0;
+	u32 match_en;
+	int ret;
+
+	if (fs->location >= STMMAC_NTUPLE_MAX)
+		return -EINVAL;
+
+	if (fs->flow_type & (FLOW_EXT | FLOW_MAC_EXT | FLOW_RSS))
+		return -EOPNOTSUPP;
+
+	/* The RX Parser routes to a bitmap of up to 8 DMA channels */
+	if (fs->ring_cookie != RX_CLS_FLOW_DISC) {
+		queue = ethtool_get_flow_spec_ring(fs->ring_cookie);
+		if (ethtool_get_flow_spec_ring_vf(fs->ring_cookie) ||
+		    queue >= priv->plat->rx_queues_to_use ||
+		    queue >= BITS_PER_BYTE)
+			return -EINVAL;
+	}
+
+	ret = stmmac_ntuple_parse(fs, data, mask);
+	if (ret)
+		return ret;
+
+	rule = &priv->ntuple_entries[fs->location];
+	if (rule->in_use)
+		stmmac_ntuple_release(rule);
+
+	/* One RX Parser entry per word to match, chained together */
+	for (word = 0; word < STMMAC_NTUPLE_LEN / 4; word++) {
+		match_en = get_unaligned_le32(&mask[word * 4]);
+		if (!match_en)
+			continue;
+
+		entry = stmmac_ntuple_get_free(priv);
+		if (!entry) {
+			ret = -ENOSPC;
+			goto err_release;
+		}
+
+		memset(&entry->val, 0, sizeof(entry->val));
+		entry->in_use = true;
+		entry->is_frag = !!prev;
+		entry->frag_ptr = NULL;
+		entry->handle = 0;
+		entry->prio = fs->location;
+		entry->val.match_en = match_en;
+		entry->val.match_data = get_unaligned_le32(&data[word * 4]);
+		entry->val.frame_offset = word;
+
+		if (prev)
+			prev->frag_ptr = entry;
+		else
+			rule->head = entry;
+		prev = entry;
+	}
+
+	/* The last word holds the actions */
+	if (fs->ring_cookie == RX_CLS_FLOW_DISC) {
+		prev->val.rf = 1;
+	} else {
+		prev->val.af = 1;
+		prev->val.dma_ch_no = BIT(queue);
+	}
+
+	rule->fs = *fs;
+	rule->in_use = true;
+
+	ret = stmmac_rxp_config(priv, priv->hw->pcsr, priv->tc_entries,
+				priv->tc_entries_max);
+	if (ret)
+		goto err_release;
+
+	return 0;
+
+err_release:
+	/* Also drops the rule this one was replacing */
+	stmmac_ntuple_release(rule);
+	stmmac_rxp_config(priv, priv->hw->pcsr, priv->tc_entries,
+			  priv->tc_entries_max);
+	return ret;
+}
+
+static int stmmac_del_ntuple(struct stmmac_priv *priv, u32 location)
+{
+	struct stmmac_ntuple_entry *rule;
+
+	if (location >= STMMAC_NTUPLE_MAX)
+		return -EINVAL;
+
+	rule = &priv->ntuple_entries[location];
+	if (!rule->in_use)
+		return -ENOENT;
+
+	stmmac_ntuple_release(rule);
+
+	return stmmac_rxp_config(priv, priv->hw->pcsr, priv->tc_entries,
+				 priv->tc_entries_max);
+}
+
+static int stmmac_get_ntuple_all(struct stmmac_priv *priv,
+				 struct ethtool_rxnfc *rxnfc, u32 *rule_locs)
+{
+	unsigned int cnt = 0;
+	int i;
+
+	for (i = 0; i < STMMAC_NTUPLE_MAX; i++) {
+		if (!priv->ntuple_entries[i].in_use)
+			continue;
+		if (cnt == rxnfc->rule_cnt)
+			return -EMSGSIZE;
+		rule_locs[cnt++] = i;
+	}
+
+	rxnfc->rule_cnt = cnt;
+	rxnfc->data = STMMAC_NTUPLE_MAX;
+
+	return 0;
+}
+
 static int stmmac_get_rxnfc(struct net_device *dev,
 			    struct ethtool_rxnfc *rxnfc, u32 *rule_locs)
 {
 	struct stmmac_priv *priv = netdev_priv(dev);
+	int i;
 
 	switch (rxnfc->cmd) {
 	case ETHTOOL_GRXRINGS:
 		rxnfc->data = priv->plat->rx_queues_to_use;
 		break;
+	case ETHTOOL_GRXCLSRLCNT:
+		if (!priv->ntuple_entries)
+			return -EOPNOTSUPP;
+		rxnfc->rule_cnt = 0;
+		for (i = 0; i < STMMAC_NTUPLE_MAX; i++)
+			if (priv->ntuple_entries[i].in_use)
+				rxnfc->rule_cnt++;
+		rxnfc->data = STMMAC_NTUPLE_MAX;
+		break;
+	case ETHTOOL_GRXCLSRULE:
+		if (!priv->ntuple_entries)
+			return -EOPNOTSUPP;
+		if (rxnfc->fs.location >= STMMAC_NTUPLE_MAX ||
+		    !priv->ntuple_entries[rxnfc->fs.location].in_use)
+			return -ENOENT;
+		rxnfc->fs = priv->ntuple_entries[rxnfc->fs.location].fs;
+		break;
+	case ETHTOOL_GRXCLSRLALL:
+		if (!priv->ntuple_entries)
+			return -EOPNOTSUPP;
+		return stmmac_get_ntuple_all(priv, rxnfc, rule_locs);
 	default:
 		return -EOPNOTSUPP;
 	}
@@ -1022,6 +1322,24 @@ static int stmmac_get_rxnfc(struct net_device *dev,
 	return 0;
 }
 
+static int stmmac_set_rxnfc(struct net_device *dev,
+			    struct ethtool_rxnfc *rxnfc)
+{
+	struct stmmac_priv *priv = netdev_priv(dev);
+
+	if (!priv->ntuple_entries)
+		return -EOPNOTSUPP;
+
+	switch (rxnfc->cmd) {
+	case ETHTOOL_SRXCLSRLINS:
+		return stmmac_add_ntuple(priv, &rxnfc->fs);
+	case ETHTOOL_SRXCLSRLDEL:
+		return stmmac_del_ntuple(priv, rxnfc->fs.location);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
 static u32 stmmac_get_rxfh_key_size(struct net_device *dev)
 {
 	struct stmmac_priv *priv = netdev_priv(dev);
@@ -1174,7 +1492,8 @@ static int stmmac_set_tunable(struct net_device *dev,
 
 static const struct ethtool_ops stmmac_ethtool_ops = {
 	.supported_coalesce_params = ETHTOOL_COALESCE_USECS |
-				     ETHTOOL_COALESCE_MAX_FRAMES,
+				     ETHTOOL_COALESCE_MAX_FRAMES |
+				     ETHTOOL_COALESCE_USE_ADAPTIVE,
 	.begin = stmmac_check_if_running,
 	.get_drvinfo = stmmac_ethtool_getdrvinfo,
 	.get_msglevel = stmmac_ethtool_getmsglevel,
@@ -1196,6 +1515,7 @@ static const struct ethtool_ops stmmac_ethtool_ops = {
 	.set_eee = stmmac_ethtool_op_set_eee,
 	.get_sset_count	= stmmac_get_sset_count,
 	.get_rxnfc = stmmac_get_rxnfc,
+	.set_rxnfc = stmmac_set_rxnfc,
 	.get_rxfh_key_size = stmmac_get_rxfh_key_size,
 	.get_rxfh_indir_size = stmmac_get_rxfh_indir_size,
 	.get_rxfh = stmmac_get_rxfh,
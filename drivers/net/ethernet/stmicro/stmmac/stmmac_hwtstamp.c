@@ -80,7 +80,6 @@ static int init_systime(void __iomem *ioaddr, u32 sec, u32 nsec)
 static int config_addend(void __iomem *ioaddr, u32 addend)
 {
 	u32 value;
-	int limit;
 
 	writel(addend, ioaddr + PTP_TAR);
 	/* issue command to update the addend value */
@@ -88,14 +87,12 @@ static int config_addend(void __iomem *ioaddr, u32 addend)
 	value |= PTP_TCR_TSADDREG;
 	writel(value, ioaddr + PTP_TCR);
 
-	/* wait for present addend update to complete */
-	limit = 10;
-	while (limit--) {
-		if (!(readl(ioaddr + PTP_TCR) & PTP_TCR_TSADDREG))
-			break;
-		mdelay(10);
-	}
-	if (limit < 0)
+	/* wait for present addend update to complete, which only takes a
+	 * few PTP clock cycles: this runs with the PTP lock held and the
+	 * interrupts off, so poll finely rather than sleep.
+	 */
+	if (readl_poll_timeout_atomic(ioaddr + PTP_TCR, value,
+				      !(value & PTP_TCR_TSADDREG), 1, 100000))
 		return -EBUSY;
 
 	return 0;
@@ -27,10 +27,12 @@
 #include <linux/if.h>
 #include <linux/if_vlan.h>
 #include <linux/dma-mapping.h>
+#include <linux/iommu.h>
 #include <linux/slab.h>
 #include <linux/pm_runtime.h>
 #include <linux/prefetch.h>
 #include <linux/pinctrl/consumer.h>
+#include <linux/sched/clock.h>
 #ifdef CONFIG_DEBUG_FS
 #include <linux/debugfs.h>
 #include <linux/seq_file.h>
@@ -40,7 +42,9 @@
 #include <linux/udp.h>
 #include <linux/bpf_trace.h>
 #include <net/pkt_cls.h>
+#include <net/tso.h>
 #include <net/xdp_sock_drv.h>
+#include <uapi/linux/sched/types.h>
 #include "stmmac_ptp.h"
 #include "stmmac.h"
 #include "stmmac_xdp.h"
@@ -48,6 +52,8 @@
 #include <linux/of_mdio.h>
 #include "dwmac1000.h"
 #include "dwxgmac2.h"
+#define CREATE_TRACE_POINTS
+#include "stmmac_trace.h"
 #include "hwif.h"
 
 /* As long as the interface is active, we keep the timestamping counter enabled
@@ -81,6 +87,10 @@ MODULE_PARM_DESC(phyaddr, "Physical device address");
 #define STMMAC_XSK_TX_BUDGET_MAX	256
 #define STMMAC_TX_XSK_AVAIL		16
 #define STMMAC_RX_FILL_BATCH		16
+#define STMMAC_XSK_ALLOC_BATCH		32
+#define STMMAC_USO_HDR_SIZE		128
+/* A running queue always has more room than this, see stmmac_xmit() */
+#define STMMAC_USO_MAX_DESCS		(MAX_SKB_FRAGS + 1)
 
 #define STMMAC_XDP_PASS		0
 #define STMMAC_XDP_CONSUMED	BIT(0)
@@ -124,6 +134,12 @@ static unsigned int chain_mode;
 module_param(chain_mode, int, 0444);
 MODULE_PARM_DESC(chain_mode, "To use chain instead of ring mode");
 
+/* NAPI runs in softirq context unless given an RT priority for its threads */
+static int napi_rt_prio;
+module_param(napi_rt_prio, int, 0444);
+MODULE_PARM_DESC(napi_rt_prio,
+		 "SCHED_FIFO priority of the threaded NAPI (0: softirq NAPI)");
+
 static irqreturn_t stmmac_interrupt(int irq, void *dev_id);
 static irqreturn_t stmmac_mac_interrupt(int irq, void *dev_id);
 static irqreturn_t stmmac_safety_interrupt(int irq, void *dev_id);
@@ -214,10 +230,14 @@ static void __stmmac_disable_all_queues(struct stmmac_priv *priv)
 			continue;
 		}
 
-		if (queue < rx_queues_cnt)
+		if (queue < rx_queues_cnt) {
 			napi_disable(&ch->rx_napi);
-		if (queue < tx_queues_cnt)
+			cancel_work_sync(&ch->rx_dim.work);
+		}
+		if (queue < tx_queues_cnt) {
 			napi_disable(&ch->tx_napi);
+			cancel_work_sync(&ch->tx_dim.work);
+		}
 	}
 }
 
@@ -1337,6 +1357,31 @@ static int stmmac_set_bfsize(int mtu, int bufsize)
 	return ret;
 }
 
+/**
+ * stmmac_rx_bfsize - RX DMA buffer size for a given MTU
+ * @priv: driver private structure
+ * @mtu: MTU to size the buffers for
+ * Description: with XDP, the buffers must leave room in their page for the
+ * XDP headroom and for the shared info of multi-buffer frames, so jumbo
+ * frames are received over several 2 KiB buffers instead of a single one.
+ */
+static u32 stmmac_rx_bfsize(struct stmmac_priv *priv, unsigned int mtu)
+{
+	int bfsize;
+
+	bfsize = stmmac_set_16kib_bfsize(priv, mtu);
+	if (bfsize < 0)
+		bfsize = 0;
+
+	if (bfsize < BUF_SIZE_16KiB)
+		bfsize = stmmac_set_bfsize(mtu, 0);
+
+	if (stmmac_xdp_is_enabled(priv))
+		bfsize = min(bfsize, BUF_SIZE_2KiB);
+
+	return bfsize;
+}
+
 /**
  * stmmac_clear_rx_descriptors - clear RX descriptors
  * @priv: driver private structure
@@ -1506,7 +1551,8 @@ static void stmmac_free_tx_buffer(struct stmmac_priv *priv,
 	struct stmmac_tx_queue *tx_q = &dma_conf->tx_queue[queue];
 
 	if (tx_q->tx_skbuff_dma[i].buf &&
-	    tx_q->tx_skbuff_dma[i].buf_type != STMMAC_TXBUF_T_XDP_TX) {
+	    tx_q->tx_skbuff_dma[i].buf_type != STMMAC_TXBUF_T_XDP_TX &&
+	    !tx_q->tx_skbuff_dma[i].pp_mapped) {
 		if (tx_q->tx_skbuff_dma[i].map_as_page)
 			dma_unmap_page(priv->device,
 				       tx_q->tx_skbuff_dma[i].buf,
@@ -1537,6 +1583,24 @@ static void stmmac_free_tx_buffer(struct stmmac_priv *priv,
 
 	tx_q->tx_skbuff_dma[i].buf = 0;
 	tx_q->tx_skbuff_dma[i].map_as_page = false;
+	tx_q->tx_skbuff_dma[i].pp_mapped = false;
+}
+
+static void stmmac_xdp_free_buff(struct stmmac_rx_queue *rx_q,
+				 struct xdp_buff *xdp, bool allow_direct)
+{
+	struct skb_shared_info *sinfo = xdp_get_shared_info_from_buff(xdp);
+	int i;
+
+	if (unlikely(xdp_buff_has_frags(xdp))) {
+		for (i = 0; i < sinfo->nr_frags; i++)
+			page_pool_put_full_page(rx_q->page_pool,
+						skb_frag_page(&sinfo->frags[i]),
+						allow_direct);
+	}
+
+	page_pool_put_full_page(rx_q->page_pool, virt_to_head_page(xdp->data),
+				allow_direct);
 }
 
 /**
@@ -1552,6 +1616,14 @@ static void dma_free_rx_skbufs(struct stmmac_priv *priv,
 	struct stmmac_rx_queue *rx_q = &dma_conf->rx_queue[queue];
 	int i;
 
+	/* Drop the frame left half gathered by the last NAPI poll */
+	if (rx_q->state_saved) {
+		dev_kfree_skb(rx_q->state.skb);
+		if (rx_q->state.xdp_pending)
+			stmmac_xdp_free_buff(rx_q, &rx_q->state.xdp, false);
+		rx_q->state_saved = false;
+	}
+
 	for (i = 0; i < dma_conf->dma_rx_size; i++)
 		stmmac_free_rx_buffer(priv, rx_q, i);
 }
@@ -1976,6 +2048,12 @@ static void __free_dma_tx_desc_resources(struct stmmac_priv *priv,
 
 	dma_free_coherent(priv->device, size, addr, tx_q->dma_tx_phy);
 
+	if (tx_q->uso_hdr)
+		dma_free_coherent(priv->device,
+				  dma_conf->dma_tx_size * STMMAC_USO_HDR_SIZE,
+				  tx_q->uso_hdr, tx_q->uso_hdr_dma);
+	tx_q->uso_hdr = NULL;
+
 	kfree(tx_q->tx_skbuff_dma);
 	kfree(tx_q->tx_skbuff);
 }
@@ -2018,8 +2096,8 @@ static int __alloc_dma_rx_desc_resources(struct stmmac_priv *priv,
 
 	pp_params.flags = PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV;
 	pp_params.pool_size = dma_conf->dma_rx_size;
-	num_pages = DIV_ROUND_UP(dma_conf->dma_buf_sz, PAGE_SIZE);
-	pp_params.order = ilog2(num_pages);
+	pp_params.order = stmmac_rx_page_order(priv, dma_conf->dma_buf_sz);
+	num_pages = 1 << pp_params.order;
 	pp_params.nid = dev_to_node(priv->device);
 	pp_params.dev = priv->device;
 	pp_params.dma_dir = xdp_prog ? DMA_BIDIRECTIONAL : DMA_FROM_DEVICE;
@@ -2151,6 +2229,16 @@ static int __alloc_dma_tx_desc_resources(struct stmmac_priv *priv,
 	else
 		tx_q->dma_tx = addr;
 
+	if (priv->uso_sw) {
+		tx_q->uso_hdr = dma_alloc_coherent(priv->device,
+						   dma_conf->dma_tx_size *
+						   STMMAC_USO_HDR_SIZE,
+						   &tx_q->uso_hdr_dma,
+						   GFP_KERNEL);
+		if (!tx_q->uso_hdr)
+			return -ENOMEM;
+	}
+
 	return 0;
 }
 
@@ -2423,6 +2511,7 @@ static bool stmmac_xdp_xmit_zc(struct stmmac_priv *priv, u32 queue, u32 budget)
 	struct dma_desc *tx_desc = NULL;
 	struct xdp_desc xdp_desc;
 	bool work_done = true;
+	u32 frames = 0;
 
 	/* Avoids TX time-out as we are sharing with slow path */
 	txq_trans_cond_update(nq);
@@ -2509,6 +2598,7 @@ static bool stmmac_xdp_xmit_zc(struct stmmac_priv *priv, u32 queue, u32 budget)
 
 		tx_q->cur_tx = STMMAC_GET_ENTRY(tx_q->cur_tx, priv->dma_conf.dma_tx_size);
 		entry = tx_q->cur_tx;
+		frames++;
 	}
 
 	if (tx_desc) {
@@ -2516,6 +2606,11 @@ static bool stmmac_xdp_xmit_zc(struct stmmac_priv *priv, u32 queue, u32 budget)
 		xsk_tx_release(pool);
 	}
 
+	if (frames) {
+		priv->xstats.txq_stats[queue].tx_xsk_pkt_n += frames;
+		trace_stmmac_xsk_tx_submit(priv->dev, queue, frames);
+	}
+
 	/* Return true if all of the 3 conditions are met
 	 *  a) TX Budget is still available
 	 *  b) work_done = true when XSK TX desc peek is empty (no more
@@ -2610,13 +2705,17 @@ static int stmmac_tx_clean(struct stmmac_priv *priv, int budget, u32 queue)
 				priv->dev->stats.tx_packets++;
 				priv->xstats.tx_pkt_n++;
 				priv->xstats.txq_stats[queue].tx_pkt_n++;
+				/* Sent while EST gates the queue */
+				if (priv->plat->est && priv->plat->est->enable)
+					priv->xstats.est_txq_tx_pkt_n[queue]++;
 			}
 			if (skb)
 				stmmac_get_tx_hwtstamp(priv, p, skb);
 		}
 
 		if (likely(tx_q->tx_skbuff_dma[entry].buf &&
-			   tx_q->tx_skbuff_dma[entry].buf_type != STMMAC_TXBUF_T_XDP_TX)) {
+			   tx_q->tx_skbuff_dma[entry].buf_type != STMMAC_TXBUF_T_XDP_TX &&
+			   !tx_q->tx_skbuff_dma[entry].pp_mapped)) {
 			if (tx_q->tx_skbuff_dma[entry].map_as_page)
 				dma_unmap_page(priv->device,
 					       tx_q->tx_skbuff_dma[entry].buf,
@@ -2636,6 +2735,7 @@ static int stmmac_tx_clean(struct stmmac_priv *priv, int budget, u32 queue)
 
 		tx_q->tx_skbuff_dma[entry].last_segment = false;
 		tx_q->tx_skbuff_dma[entry].is_jumbo = false;
+		tx_q->tx_skbuff_dma[entry].pp_mapped = false;
 
 		if (xdpf &&
 		    tx_q->tx_skbuff_dma[entry].buf_type == STMMAC_TXBUF_T_XDP_TX) {
@@ -2670,6 +2770,9 @@ static int stmmac_tx_clean(struct stmmac_priv *priv, int budget, u32 queue)
 	netdev_tx_completed_queue(netdev_get_tx_queue(priv->dev, queue),
 				  pkts_compl, bytes_compl);
 
+	priv->channel[queue].tx_dim_packets += pkts_compl;
+	priv->channel[queue].tx_dim_bytes += bytes_compl;
+
 	if (unlikely(netif_tx_queue_stopped(netdev_get_tx_queue(priv->dev,
 								queue))) &&
 	    stmmac_tx_avail(priv, queue) > STMMAC_TX_THRESH(priv)) {
@@ -2682,8 +2785,13 @@ static int stmmac_tx_clean(struct stmmac_priv *priv, int budget, u32 queue)
 	if (tx_q->xsk_pool) {
 		bool work_done;
 
-		if (tx_q->xsk_frames_done)
+		if (tx_q->xsk_frames_done) {
 			xsk_tx_completed(tx_q->xsk_pool, tx_q->xsk_frames_done);
+			priv->xstats.txq_stats[queue].tx_xsk_done_n +=
+				tx_q->xsk_frames_done;
+			trace_stmmac_xsk_tx_complete(priv->dev, queue,
+						     tx_q->xsk_frames_done);
+		}
 
 		if (xsk_uses_need_wakeup(tx_q->xsk_pool))
 			xsk_set_tx_need_wakeup(tx_q->xsk_pool);
@@ -3056,6 +3164,56 @@ static void stmmac_init_coalesce(struct stmmac_priv *priv)
 		priv->rx_coal_frames[chan] = STMMAC_RX_FRAMES;
 }
 
+/**
+ * stmmac_rx_dim_work - apply the RX moderation picked by DIM.
+ * @work: work_struct of the channel RX DIM
+ * Description:
+ * Only the RX watchdog is tuned, the frame threshold is left to ethtool.
+ */
+static void stmmac_rx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct stmmac_channel *ch =
+		container_of(dim, struct stmmac_channel, rx_dim);
+	struct stmmac_priv *priv = ch->priv_data;
+	struct dim_cq_moder moder;
+	u32 riwt;
+
+	moder = net_dim_get_rx_moderation(dim->mode, dim->profile_ix);
+	riwt = clamp_t(u32, stmmac_usec2riwt(moder.usec, priv),
+		       MIN_DMA_RIWT, MAX_DMA_RIWT);
+
+	priv->rx_riwt[ch->index] = riwt;
+	stmmac_rx_watchdog(priv, priv->ioaddr, riwt, ch->index);
+
+	dim->state = DIM_START_MEASURE;
+}
+
+/**
+ * stmmac_tx_dim_work - apply the TX moderation picked by DIM.
+ * @work: work_struct of the channel TX DIM
+ * Description:
+ * Tunes the coalesce timer and the number of frames between two
+ * interrupt on completion bits, used from the next transmission.
+ */
+static void stmmac_tx_dim_work(struct work_struct *work)
+{
+	struct dim *dim = container_of(work, struct dim, work);
+	struct stmmac_channel *ch =
+		container_of(dim, struct stmmac_channel, tx_dim);
+	struct stmmac_priv *priv = ch->priv_data;
+	struct dim_cq_moder moder;
+
+	moder = net_dim_get_tx_moderation(dim->mode, dim->profile_ix);
+
+	priv->tx_coal_timer[ch->index] =
+		clamp_t(u32, moder.usec, 1, STMMAC_MAX_COAL_TX_TICK);
+	priv->tx_coal_frames[ch->index] =
+		clamp_t(u32, moder.pkts, 1, STMMAC_TX_MAX_FRAMES);
+
+	dim->state = DIM_START_MEASURE;
+}
+
 static void stmmac_set_rings_length(struct stmmac_priv *priv)
 {
 	u32 rx_channels_count = priv->plat->rx_queues_to_use;
@@ -3435,7 +3593,7 @@ static int stmmac_hw_setup(struct net_device *dev, bool ptp_register)
 
 	/* Configure real RX and TX queues */
 	netif_set_real_num_rx_queues(dev, priv->plat->rx_queues_to_use);
-	netif_set_real_num_tx_queues(dev, priv->plat->tx_queues_to_use);
+	stmmac_xdp_txq_update(priv);
 
 	/* Start the ball rolling... */
 	stmmac_start_all_dma(priv);
@@ -3453,6 +3611,11 @@ static int stmmac_hw_setup(struct net_device *dev, bool ptp_register)
 	if (priv->plat->use_hw_vlan)
 		stmmac_set_hw_vlan_mode(priv, priv->ioaddr, dev->features);
 
+	/* Restore the RX Parser rules lost with the reset */
+	if (priv->tc_entries)
+		stmmac_rxp_config(priv, priv->hw->pcsr, priv->tc_entries,
+				  priv->tc_entries_max);
+
 	return 0;
 }
 
@@ -3515,11 +3678,22 @@ static void stmmac_free_irq(struct net_device *dev,
 	}
 }
 
+/**
+ * stmmac_queue_cpu - CPU handling a queue in multi-vector mode
+ * @priv: driver private structure
+ * @queue: queue index
+ * Description: the queues are spread over the online CPUs, the RX and TX
+ * vectors of a queue and its NAPI threads all going to the same CPU.
+ */
+static unsigned int stmmac_queue_cpu(struct stmmac_priv *priv, u32 queue)
+{
+	return cpumask_local_spread(queue, dev_to_node(priv->device));
+}
+
 static int stmmac_request_irq_multi(struct net_device *dev)
 {
 	struct stmmac_priv *priv = netdev_priv(dev);
 	enum request_irq_err irq_err;
-	cpumask_t cpu_mask;
 	int irq_idx = 0;
 	char *int_name;
 	int ret;
@@ -3635,9 +3809,8 @@ static int stmmac_request_irq_multi(struct net_device *dev)
 			irq_idx = i;
 			goto irq_error;
 		}
-		cpumask_clear(&cpu_mask);
-		cpumask_set_cpu(i % num_online_cpus(), &cpu_mask);
-		irq_set_affinity_hint(priv->rx_irq[i], &cpu_mask);
+		irq_set_affinity_hint(priv->rx_irq[i],
+				      cpumask_of(stmmac_queue_cpu(priv, i)));
 	}
 
 	/* Request Tx MSI irq */
@@ -3665,9 +3838,8 @@ static int stmmac_request_irq_multi(struct net_device *dev)
 			irq_idx = i;
 			goto irq_error;
 		}
-		cpumask_clear(&cpu_mask);
-		cpumask_set_cpu(i % num_online_cpus(), &cpu_mask);
-		irq_set_affinity_hint(priv->tx_irq[i], &cpu_mask);
+		irq_set_affinity_hint(priv->tx_irq[i],
+				      cpumask_of(stmmac_queue_cpu(priv, i)));
 	}
 
 	return 0;
@@ -3742,6 +3914,63 @@ static int stmmac_request_irq(struct net_device *dev)
 	return ret;
 }
 
+static void stmmac_napi_thread_setup(struct stmmac_priv *priv,
+				     struct napi_struct *napi, u32 queue,
+				     int prio)
+{
+	struct sched_attr attr = {
+		.sched_policy = SCHED_FIFO,
+		.sched_priority = prio,
+	};
+
+	if (!napi->thread)
+		return;
+
+	sched_setattr_nocheck(napi->thread, &attr);
+	if (priv->plat->multi_msi_en || priv->plat->dma_cfg->multi_irq_en)
+		set_cpus_allowed_ptr(napi->thread,
+				     cpumask_of(stmmac_queue_cpu(priv, queue)));
+}
+
+/**
+ * stmmac_napi_threaded - Run the NAPI of the queues in RT threads
+ * @priv: driver private structure
+ * Description: when napi_rt_prio is set, NAPI is switched to threaded mode
+ * and its threads are given that priority.  In multi-vector mode each thread
+ * is also bound to the CPU taking the interrupts of its queue.
+ */
+static void stmmac_napi_threaded(struct stmmac_priv *priv)
+{
+	u32 maxq = max(priv->plat->rx_queues_to_use,
+		       priv->plat->tx_queues_to_use);
+	int prio = napi_rt_prio;
+	u32 queue;
+
+	if (prio <= 0)
+		return;
+
+	prio = min(prio, MAX_RT_PRIO - 1);
+	if (dev_set_threaded(priv->dev, true)) {
+		netdev_warn(priv->dev, "Failed to enable threaded NAPI\n");
+		return;
+	}
+
+	for (queue = 0; queue < maxq; queue++) {
+		struct stmmac_channel *ch = &priv->channel[queue];
+
+		if (queue < priv->plat->rx_queues_to_use)
+			stmmac_napi_thread_setup(priv, &ch->rx_napi, queue,
+						 prio);
+		if (queue < priv->plat->tx_queues_to_use)
+			stmmac_napi_thread_setup(priv, &ch->tx_napi, queue,
+						 prio);
+		if (queue < priv->plat->rx_queues_to_use &&
+		    queue < priv->plat->tx_queues_to_use)
+			stmmac_napi_thread_setup(priv, &ch->rxtx_napi, queue,
+						 prio);
+	}
+}
+
 /**
  *  stmmac_setup_dma_desc - Generate a dma_conf and allocate DMA queue
  *  @priv: driver private structure
@@ -3755,7 +3984,7 @@ static struct stmmac_dma_conf *
 stmmac_setup_dma_desc(struct stmmac_priv *priv, unsigned int mtu)
 {
 	struct stmmac_dma_conf *dma_conf;
-	int chan, bfsize, ret;
+	int chan, ret;
 
 	dma_conf = kzalloc(sizeof(*dma_conf), GFP_KERNEL);
 	if (!dma_conf) {
@@ -3764,14 +3993,7 @@ stmmac_setup_dma_desc(struct stmmac_priv *priv, unsigned int mtu)
 		return ERR_PTR(-ENOMEM);
 	}
 
-	bfsize = stmmac_set_16kib_bfsize(priv, mtu);
-	if (bfsize < 0)
-		bfsize = 0;
-
-	if (bfsize < BUF_SIZE_16KiB)
-		bfsize = stmmac_set_bfsize(mtu, 0);
-
-	dma_conf->dma_buf_sz = bfsize;
+	dma_conf->dma_buf_sz = stmmac_rx_bfsize(priv, mtu);
 	/* Chose the tx/rx size from the already defined one in the
 	 * priv struct. (if defined)
 	 */
@@ -3888,6 +4110,7 @@ static int __stmmac_open(struct net_device *dev,
 	if (ret)
 		goto irq_error;
 
+	stmmac_napi_threaded(priv);
 	stmmac_enable_all_queues(priv);
 	netif_tx_start_all_queues(priv->dev);
 	stmmac_enable_all_dma_irq(priv);
@@ -4039,8 +4262,8 @@ static void stmmac_tso_allocator(struct stmmac_priv *priv, dma_addr_t des,
 				 int total_len, bool last_segment, u32 queue)
 {
 	struct stmmac_tx_queue *tx_q = &priv->dma_conf.tx_queue[queue];
+	u32 buff_size, buff2_size;
 	struct dma_desc *desc;
-	u32 buff_size;
 	int tmp_len;
 
 	tmp_len = total_len;
@@ -4058,20 +4281,32 @@ static void stmmac_tso_allocator(struct stmmac_priv *priv, dma_addr_t des,
 			desc = &tx_q->dma_tx[tx_q->cur_tx];
 
 		curr_addr = des + (total_len - tmp_len);
-		if (priv->dma_cap.addr64 <= 32)
+		buff_size = min_t(int, tmp_len, TSO_MAX_BUFF_SIZE);
+		tmp_len -= buff_size;
+		buff2_size = 0;
+
+		if (priv->dma_cap.addr64 <= 32) {
 			desc->des0 = cpu_to_le32(curr_addr);
-		else
-			stmmac_set_desc_addr(priv, desc, curr_addr);
 
-		buff_size = tmp_len >= TSO_MAX_BUFF_SIZE ?
-			    TSO_MAX_BUFF_SIZE : tmp_len;
+			/* DES1 is free without the high address bits, so the
+			 * rest of the chunk goes on buffer 2 and large chunks
+			 * take half the descriptors.
+			 */
+			if (tmp_len > 0) {
+				buff2_size = min_t(int, tmp_len,
+						   TSO_MAX_BUFF_SIZE);
+				desc->des1 = cpu_to_le32(curr_addr + buff_size);
+				tmp_len -= buff2_size;
+			}
+		} else {
+			stmmac_set_desc_addr(priv, desc, curr_addr);
+		}
 
 		stmmac_prepare_tso_tx_desc(priv, desc, 0, buff_size,
-				0, 1,
-				(last_segment) && (tmp_len <= TSO_MAX_BUFF_SIZE),
+				buff2_size, 1,
+				(last_segment) && (tmp_len <= 0),
 				0, 0);
-
-		tmp_len -= TSO_MAX_BUFF_SIZE;
+		priv->xstats.tx_tso_desc++;
 	}
 }
 
@@ -4225,6 +4460,7 @@ static netdev_tx_t stmmac_tso_xmit(struct sk_buff *skb, struct net_device *dev)
 
 		/* If needed take extra descriptors to fill the remaining payload */
 		tmp_pay_len = pay_len - TSO_MAX_BUFF_SIZE;
+		pay_len = min_t(u32, pay_len, TSO_MAX_BUFF_SIZE);
 	} else {
 		stmmac_set_desc_addr(priv, first, des);
 		tmp_pay_len = pay_len;
@@ -4302,6 +4538,8 @@ static netdev_tx_t stmmac_tso_xmit(struct sk_buff *skb, struct net_device *dev)
 	dev->stats.tx_bytes += skb->len;
 	priv->xstats.tx_tso_frames++;
 	priv->xstats.tx_tso_nfrags += nfrags;
+	/* The first descriptor and the MSS context one, if any */
+	priv->xstats.tx_tso_desc += mss_desc ? 2 : 1;
 
 	if (priv->sarc_type)
 		stmmac_set_desc_sarc(priv, first, priv->sarc_type);
@@ -4341,10 +4579,14 @@ static netdev_tx_t stmmac_tso_xmit(struct sk_buff *skb, struct net_device *dev)
 		print_pkt(skb->data, skb_headlen(skb));
 	}
 
-	netdev_tx_sent_queue(netdev_get_tx_queue(dev, queue), skb->len);
-
-	stmmac_flush_tx_descriptors(priv, queue);
-	stmmac_tx_timer_arm(priv, queue);
+	/* Let the stack batch the doorbell when more frames are coming,
+	 * unless the queue just got stopped.
+	 */
+	if (__netdev_tx_sent_queue(netdev_get_tx_queue(dev, queue), skb->len,
+				   netdev_xmit_more())) {
+		stmmac_flush_tx_descriptors(priv, queue);
+		stmmac_tx_timer_arm(priv, queue);
+	}
 
 	return NETDEV_TX_OK;
 
@@ -4352,6 +4594,241 @@ static netdev_tx_t stmmac_tso_xmit(struct sk_buff *skb, struct net_device *dev)
 	dev_err(priv->device, "Tx dma map failed\n");
 	dev_kfree_skb(skb);
 	priv->dev->stats.tx_dropped++;
+	/* The previous frames of the batch may still wait for the doorbell */
+	if (!netdev_xmit_more()) {
+		stmmac_flush_tx_descriptors(priv, queue);
+		stmmac_tx_timer_arm(priv, queue);
+	}
+	return NETDEV_TX_OK;
+}
+
+static void stmmac_uso_unwind(struct stmmac_priv *priv,
+			      struct stmmac_tx_queue *tx_q,
+			      unsigned int entry, unsigned int end)
+{
+	struct stmmac_tx_info *info;
+	struct dma_desc *desc;
+
+	for (; entry != end;
+	     entry = STMMAC_GET_ENTRY(entry, priv->dma_conf.dma_tx_size)) {
+		info = &tx_q->tx_skbuff_dma[entry];
+		if (info->buf)
+			dma_unmap_single(priv->device, info->buf, info->len,
+					 DMA_TO_DEVICE);
+		info->buf = 0;
+		info->len = 0;
+		info->last_segment = false;
+
+		if (likely(priv->extend_desc))
+			desc = (struct dma_desc *)(tx_q->dma_etx + entry);
+		else if (tx_q->tbs & STMMAC_TBS_AVAIL)
+			desc = &tx_q->dma_entx[entry].basic;
+		else
+			desc = tx_q->dma_tx + entry;
+
+		stmmac_release_tx_desc(priv, desc, priv->mode);
+	}
+}
+
+/**
+ *  stmmac_uso_xmit - Tx entry point of the driver for UDP GSO frames
+ *  @skb : the socket buffer
+ *  @dev : device pointer
+ *  Description: this is the transmit function used for UDP GSO frames when
+ *  the core is not able to segment them (no USO before GMAC4).  Rather than
+ *  having the stack allocate an skb per datagram, the frame is segmented
+ *  straight into the ring: every datagram gets a copy of the headers, built
+ *  by tso_build_hdr() in the header slot of its first descriptor, followed by
+ *  descriptors pointing to its part of the payload.  The IP and UDP checksums
+ *  of every datagram are left to the COE.
+ */
+static netdev_tx_t stmmac_uso_xmit(struct sk_buff *skb, struct net_device *dev)
+{
+	struct stmmac_priv *priv = netdev_priv(dev);
+	unsigned int mss = skb_shinfo(skb)->gso_size;
+	u32 queue = skb_get_queue_mapping(skb);
+	unsigned int entry, first_entry, last;
+	int hdr_len, data_left, descs = 0;
+	struct dma_desc *desc, *first;
+	struct stmmac_tx_queue *tx_q;
+	bool has_vlan, set_ic;
+	struct tso_t tso;
+	dma_addr_t des;
+
+	tx_q = &priv->dma_conf.tx_queue[queue];
+
+	/* stmmac_features_check() made sure a running queue has enough room */
+	if (unlikely(stmmac_tx_avail(priv, queue) <= tso_count_descs(skb))) {
+		netif_tx_stop_queue(netdev_get_tx_queue(priv->dev, queue));
+		return NETDEV_TX_BUSY;
+	}
+
+	/* Check if VLAN can be inserted by HW */
+	has_vlan = stmmac_vlan_insert(priv, skb, tx_q);
+
+	entry = tx_q->cur_tx;
+	first_entry = entry;
+	last = entry;
+	first = NULL;
+
+	hdr_len = tso_start(skb, &tso);
+	data_left = skb->len - hdr_len;
+
+	while (data_left > 0) {
+		int seg_len = min_t(int, mss, data_left);
+		int size = seg_len;
+
+		data_left -= seg_len;
+
+		WARN_ON(tx_q->tx_skbuff[entry]);
+
+		if (likely(priv->extend_desc))
+			desc = (struct dma_desc *)(tx_q->dma_etx + entry);
+		else if (tx_q->tbs & STMMAC_TBS_AVAIL)
+			desc = &tx_q->dma_entx[entry].basic;
+		else
+			desc = tx_q->dma_tx + entry;
+
+		/* The header slot is coherent memory, there is nothing to
+		 * unmap on completion.
+		 */
+		tso_build_hdr(skb, tx_q->uso_hdr + entry * STMMAC_USO_HDR_SIZE,
+			      &tso, seg_len, !data_left);
+		des = tx_q->uso_hdr_dma + entry * STMMAC_USO_HDR_SIZE;
+		stmmac_set_desc_addr(priv, desc, des);
+
+		tx_q->tx_skbuff_dma[entry].buf = 0;
+		tx_q->tx_skbuff_dma[entry].len = hdr_len;
+		tx_q->tx_skbuff_dma[entry].map_as_page = false;
+		tx_q->tx_skbuff_dma[entry].last_segment = false;
+		tx_q->tx_skbuff_dma[entry].buf_type = STMMAC_TXBUF_T_SKB;
+
+		if (has_vlan)
+			stmmac_set_desc_vlan(priv, desc, STMMAC_VLAN_INSERT);
+
+		/* All but the very first descriptor are given to the DMA
+		 * right away, it won't go past the first one anyway.
+		 */
+		stmmac_prepare_tx_desc(priv, desc, 1, hdr_len, 1, priv->mode,
+				       first != NULL, false, hdr_len + seg_len);
+		if (!first)
+			first = desc;
+		last = entry;
+		descs++;
+
+		while (size > 0) {
+			int len = min_t(int, tso.size, size);
+
+			entry = STMMAC_GET_ENTRY(entry,
+						 priv->dma_conf.dma_tx_size);
+			WARN_ON(tx_q->tx_skbuff[entry]);
+
+			if (likely(priv->extend_desc))
+				desc = &tx_q->dma_etx[entry].basic;
+			else if (tx_q->tbs & STMMAC_TBS_AVAIL)
+				desc = &tx_q->dma_entx[entry].basic;
+			else
+				desc = tx_q->dma_tx + entry;
+
+			des = dma_map_single(priv->device, tso.data, len,
+					     DMA_TO_DEVICE);
+			if (dma_mapping_error(priv->device, des))
+				goto dma_map_err;
+
+			size -= len;
+
+			tx_q->tx_skbuff_dma[entry].buf = des;
+			tx_q->tx_skbuff_dma[entry].len = len;
+			tx_q->tx_skbuff_dma[entry].map_as_page = false;
+			tx_q->tx_skbuff_dma[entry].last_segment = !size;
+			tx_q->tx_skbuff_dma[entry].buf_type = STMMAC_TXBUF_T_SKB;
+
+			stmmac_set_desc_addr(priv, desc, des);
+			stmmac_prepare_tx_desc(priv, desc, 0, len, 1,
+					       priv->mode, 1, !size,
+					       hdr_len + seg_len);
+
+			tso_build_data(skb, &tso, len);
+			last = entry;
+			descs++;
+		}
+
+		entry = STMMAC_GET_ENTRY(entry, priv->dma_conf.dma_tx_size);
+	}
+
+	/* Only the last descriptor gets to point to the skb. */
+	tx_q->tx_skbuff[last] = skb;
+
+	tx_q->tx_count_frames += descs;
+
+	if (!priv->tx_coal_frames[queue])
+		set_ic = false;
+	else if (descs > priv->tx_coal_frames[queue])
+		set_ic = true;
+	else if ((tx_q->tx_count_frames %
+		  priv->tx_coal_frames[queue]) < descs)
+		set_ic = true;
+	else
+		set_ic = false;
+
+	if (set_ic) {
+		if (likely(priv->extend_desc))
+			desc = &tx_q->dma_etx[last].basic;
+		else if (tx_q->tbs & STMMAC_TBS_AVAIL)
+			desc = &tx_q->dma_entx[last].basic;
+		else
+			desc = &tx_q->dma_tx[last];
+
+		tx_q->tx_count_frames = 0;
+		stmmac_set_tx_ic(priv, desc);
+		priv->xstats.tx_set_ic_bit++;
+	}
+
+	tx_q->cur_tx = entry;
+
+	if (unlikely(stmmac_tx_avail(priv, queue) <= STMMAC_USO_MAX_DESCS)) {
+		netif_dbg(priv, hw, priv->dev, "%s: stop transmitted packets\n",
+			  __func__);
+		netif_tx_stop_queue(netdev_get_tx_queue(priv->dev, queue));
+	}
+
+	dev->stats.tx_bytes += skb->len;
+	priv->xstats.tx_uso_frames++;
+	priv->xstats.tx_uso_segs += skb_shinfo(skb)->gso_segs;
+
+	if (priv->sarc_type)
+		stmmac_set_desc_sarc(priv, first, priv->sarc_type);
+
+	skb_tx_timestamp(skb);
+
+	/* Everything else is in place, hand the whole chain to the DMA */
+	dma_wmb();
+	stmmac_set_tx_owner(priv, first);
+
+	if (__netdev_tx_sent_queue(netdev_get_tx_queue(dev, queue), skb->len,
+				   netdev_xmit_more())) {
+		stmmac_enable_dma_transmission(priv, priv->ioaddr);
+
+		stmmac_flush_tx_descriptors(priv, queue);
+		stmmac_tx_timer_arm(priv, queue);
+	}
+
+	return NETDEV_TX_OK;
+
+dma_map_err:
+	netdev_err(priv->dev, "Tx DMA map failed\n");
+	/* Some of the descriptors are already owned by the DMA */
+	stmmac_uso_unwind(priv, tx_q, first_entry,
+			  STMMAC_GET_ENTRY(entry, priv->dma_conf.dma_tx_size));
+	dev_kfree_skb(skb);
+	priv->dev->stats.tx_dropped++;
+	/* The previous frames of the batch may still wait for the doorbell */
+	if (!netdev_xmit_more()) {
+		stmmac_enable_dma_transmission(priv, priv->ioaddr);
+
+		stmmac_flush_tx_descriptors(priv, queue);
+		stmmac_tx_timer_arm(priv, queue);
+	}
 	return NETDEV_TX_OK;
 }
 
@@ -4393,6 +4870,9 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 			return stmmac_tso_xmit(skb, dev);
 	}
 
+	if (skb_is_gso(skb) && priv->uso_sw && (gso & SKB_GSO_UDP_L4))
+		return stmmac_uso_xmit(skb, dev);
+
 	if (priv->plat->est && priv->plat->est->enable &&
 	    priv->plat->est->max_sdu[queue] &&
 	    skb->len > priv->plat->est->max_sdu[queue]) {
@@ -4600,12 +5080,16 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 
 	stmmac_set_tx_owner(priv, first);
 
-	netdev_tx_sent_queue(netdev_get_tx_queue(dev, queue), skb->len);
-
-	stmmac_enable_dma_transmission(priv, priv->ioaddr);
+	/* Let the stack batch the doorbell when more frames are coming,
+	 * unless the queue just got stopped.
+	 */
+	if (__netdev_tx_sent_queue(netdev_get_tx_queue(dev, queue), skb->len,
+				   netdev_xmit_more())) {
+		stmmac_enable_dma_transmission(priv, priv->ioaddr);
 
-	stmmac_flush_tx_descriptors(priv, queue);
-	stmmac_tx_timer_arm(priv, queue);
+		stmmac_flush_tx_descriptors(priv, queue);
+		stmmac_tx_timer_arm(priv, queue);
+	}
 
 	return NETDEV_TX_OK;
 
@@ -4614,6 +5098,13 @@ static netdev_tx_t stmmac_xmit(struct sk_buff *skb, struct net_device *dev)
 qbv_pkt_drop:
 	dev_kfree_skb(skb);
 	priv->dev->stats.tx_dropped++;
+	/* The previous frames of the batch may still wait for the doorbell */
+	if (!netdev_xmit_more()) {
+		stmmac_enable_dma_transmission(priv, priv->ioaddr);
+
+		stmmac_flush_tx_descriptors(priv, queue);
+		stmmac_tx_timer_arm(priv, queue);
+	}
 	return NETDEV_TX_OK;
 }
 
@@ -4649,6 +5140,8 @@ static inline void stmmac_rx_refill(struct stmmac_priv *priv, u32 queue)
 	int dirty = stmmac_rx_dirty(priv, queue);
 	unsigned int entry = rx_q->dirty_rx;
 	gfp_t gfp = (GFP_ATOMIC | __GFP_NOWARN);
+	u64 start = local_clock();
+	unsigned int count = 0;
 
 	if (priv->dma_cap.host_dma_width <= 32)
 		gfp |= GFP_DMA32;
@@ -4700,11 +5193,15 @@ static inline void stmmac_rx_refill(struct stmmac_priv *priv, u32 queue)
 		stmmac_set_rx_owner(priv, p, use_rx_wd);
 
 		entry = STMMAC_GET_ENTRY(entry, priv->dma_conf.dma_rx_size);
+		count++;
 	}
 	rx_q->dirty_rx = entry;
 	rx_q->rx_tail_addr = rx_q->dma_rx_phy +
 			    (rx_q->dirty_rx * sizeof(struct dma_desc));
 	stmmac_set_rx_tail_ptr(priv, priv->ioaddr, rx_q->rx_tail_addr, queue);
+
+	priv->xstats.rxq_stats[queue].rx_refill_n += count;
+	priv->xstats.rxq_stats[queue].rx_refill_ns += local_clock() - start;
 }
 
 static unsigned int stmmac_rx_buf1_len(struct stmmac_priv *priv,
@@ -4731,6 +5228,10 @@ static unsigned int stmmac_rx_buf1_len(struct stmmac_priv *priv,
 
 	plen = stmmac_get_rx_frame_len(priv, p, coe);
 
+	/* Last descriptor of a frame spanning several buffers */
+	if (len)
+		return plen - len;
+
 	/* First descriptor and last descriptor and not split header */
 	return min_t(unsigned int, priv->dma_conf.dma_buf_sz, plen);
 }
@@ -4756,63 +5257,143 @@ static unsigned int stmmac_rx_buf2_len(struct stmmac_priv *priv,
 	return plen - len;
 }
 
+/* Redirected frames coming from a page_pool mapped for both directions in
+ * the DMA address space of this device, e.g. the RX pool of another GMAC
+ * behind the same IOMMU, can use the mapping of the pool as is.
+ */
+static bool stmmac_xdp_pp_mapped(struct stmmac_priv *priv, struct page *page)
+{
+	struct iommu_domain *domain;
+	struct page_pool *pp;
+
+	if ((page->pp_magic & ~0x3UL) != PP_SIGNATURE)
+		return false;
+
+	pp = page->pp;
+	if (!(pp->p.flags & PP_FLAG_DMA_MAP) ||
+	    pp->p.dma_dir != DMA_BIDIRECTIONAL)
+		return false;
+
+	if (pp->p.dev == priv->device)
+		return true;
+
+	domain = iommu_get_domain_for_dev(priv->device);
+
+	return domain && domain == iommu_get_domain_for_dev(pp->p.dev);
+}
+
 static int stmmac_xdp_xmit_xdpf(struct stmmac_priv *priv, int queue,
 				struct xdp_frame *xdpf, bool dma_map)
 {
 	struct stmmac_tx_queue *tx_q = &priv->dma_conf.tx_queue[queue];
-	unsigned int entry = tx_q->cur_tx;
-	struct dma_desc *tx_desc;
+	unsigned int first_entry = tx_q->cur_tx, entry = first_entry;
+	unsigned int frame_len = xdp_get_frame_len(xdpf);
+	struct dma_desc *tx_desc, *first = NULL;
+	bool from_pp = xdpf->mem.type == MEM_TYPE_PAGE_POOL;
+	struct skb_shared_info *sinfo = NULL;
+	unsigned int nr_frags = 0, i;
 	dma_addr_t dma_addr;
 	bool set_ic;
 
-	if (stmmac_tx_avail(priv, queue) < STMMAC_TX_THRESH(priv))
+	if (unlikely(xdp_frame_has_frags(xdpf))) {
+		sinfo = xdp_get_shared_info_from_frame(xdpf);
+		nr_frags = sinfo->nr_frags;
+	}
+
+	if (stmmac_tx_avail(priv, queue) < STMMAC_TX_THRESH(priv) + nr_frags)
 		return STMMAC_XDP_CONSUMED;
 
 	if (priv->plat->est && priv->plat->est->enable &&
 	    priv->plat->est->max_sdu[queue] &&
-	    xdpf->len > priv->plat->est->max_sdu[queue]) {
+	    frame_len > priv->plat->est->max_sdu[queue]) {
 		priv->xstats.max_sdu_txq_drop[queue]++;
 		return STMMAC_XDP_CONSUMED;
 	}
 
-	if (likely(priv->extend_desc))
-		tx_desc = (struct dma_desc *)(tx_q->dma_etx + entry);
-	else if (tx_q->tbs & STMMAC_TBS_AVAIL)
-		tx_desc = &tx_q->dma_entx[entry].basic;
-	else
-		tx_desc = tx_q->dma_tx + entry;
+	/* The head of the frame comes first, followed by its fragments.
+	 * Every fragment is handed to the DMA right away, the first
+	 * descriptor only once the whole frame is ready.
+	 */
+	for (i = 0; i <= nr_frags; i++) {
+		skb_frag_t *frag = i ? &sinfo->frags[i - 1] : NULL;
+		unsigned int len = frag ? skb_frag_size(frag) : xdpf->len;
+		bool last_segment = (i == nr_frags);
+		struct page *page = NULL;
+		bool pp_mapped = false;
 
-	if (dma_map) {
-		dma_addr = dma_map_single(priv->device, xdpf->data,
-					  xdpf->len, DMA_TO_DEVICE);
-		if (dma_mapping_error(priv->device, dma_addr))
-			return STMMAC_XDP_CONSUMED;
+		if (likely(priv->extend_desc))
+			tx_desc = (struct dma_desc *)(tx_q->dma_etx + entry);
+		else if (tx_q->tbs & STMMAC_TBS_AVAIL)
+			tx_desc = &tx_q->dma_entx[entry].basic;
+		else
+			tx_desc = tx_q->dma_tx + entry;
 
-		tx_q->tx_skbuff_dma[entry].buf_type = STMMAC_TXBUF_T_XDP_NDO;
-	} else {
-		struct page *page = virt_to_page(xdpf->data);
+		if (dma_map && from_pp) {
+			page = frag ? skb_frag_page(frag) :
+				      virt_to_page(xdpf->data);
+			pp_mapped = stmmac_xdp_pp_mapped(priv, page);
+		}
 
-		dma_addr = page_pool_get_dma_addr(page) + sizeof(*xdpf) +
-			   xdpf->headroom;
-		dma_sync_single_for_device(priv->device, dma_addr,
-					   xdpf->len, DMA_BIDIRECTIONAL);
+		if (pp_mapped) {
+			dma_addr = page_pool_get_dma_addr(page);
+			if (frag)
+				dma_addr += skb_frag_off(frag);
+			else
+				dma_addr += xdpf->data - page_address(page);
+			dma_sync_single_for_device(priv->device, dma_addr,
+						   len, DMA_BIDIRECTIONAL);
+
+			tx_q->tx_skbuff_dma[entry].buf_type = STMMAC_TXBUF_T_XDP_NDO;
+			priv->xstats.txq_stats[queue].tx_xdp_pp_mapped_n++;
+		} else if (dma_map) {
+			if (frag)
+				dma_addr = skb_frag_dma_map(priv->device, frag,
+							    0, len,
+							    DMA_TO_DEVICE);
+			else
+				dma_addr = dma_map_single(priv->device,
+							  xdpf->data, len,
+							  DMA_TO_DEVICE);
+			if (dma_mapping_error(priv->device, dma_addr))
+				goto dma_map_err;
 
-		tx_q->tx_skbuff_dma[entry].buf_type = STMMAC_TXBUF_T_XDP_TX;
-	}
+			tx_q->tx_skbuff_dma[entry].buf_type = STMMAC_TXBUF_T_XDP_NDO;
+		} else {
+			if (frag)
+				dma_addr = page_pool_get_dma_addr(skb_frag_page(frag)) +
+					   skb_frag_off(frag);
+			else
+				dma_addr = page_pool_get_dma_addr(virt_to_page(xdpf->data)) +
+					   sizeof(*xdpf) + xdpf->headroom;
+			dma_sync_single_for_device(priv->device, dma_addr,
+						   len, DMA_BIDIRECTIONAL);
 
-	tx_q->tx_skbuff_dma[entry].buf = dma_addr;
-	tx_q->tx_skbuff_dma[entry].map_as_page = false;
-	tx_q->tx_skbuff_dma[entry].len = xdpf->len;
-	tx_q->tx_skbuff_dma[entry].last_segment = true;
-	tx_q->tx_skbuff_dma[entry].is_jumbo = false;
+			tx_q->tx_skbuff_dma[entry].buf_type = STMMAC_TXBUF_T_XDP_TX;
+		}
 
-	tx_q->xdpf[entry] = xdpf;
+		tx_q->tx_skbuff_dma[entry].buf = dma_addr;
+		tx_q->tx_skbuff_dma[entry].map_as_page = dma_map && frag &&
+							 !pp_mapped;
+		tx_q->tx_skbuff_dma[entry].pp_mapped = pp_mapped;
+		tx_q->tx_skbuff_dma[entry].len = len;
+		tx_q->tx_skbuff_dma[entry].last_segment = last_segment;
+		tx_q->tx_skbuff_dma[entry].is_jumbo = false;
 
-	stmmac_set_desc_addr(priv, tx_desc, dma_addr);
+		/* Only the last descriptor gets to point to the frame */
+		tx_q->xdpf[entry] = last_segment ? xdpf : NULL;
 
-	stmmac_prepare_tx_desc(priv, tx_desc, 1, xdpf->len,
-			       (queue < priv->tx_q_with_coe), priv->mode,
-			       true, true, xdpf->len);
+		stmmac_set_desc_addr(priv, tx_desc, dma_addr);
+
+		stmmac_prepare_tx_desc(priv, tx_desc, !frag, len,
+				       (queue < priv->tx_q_with_coe), priv->mode,
+				       frag || !nr_frags, last_segment,
+				       frame_len);
+
+		if (!frag)
+			first = tx_desc;
+
+		entry = STMMAC_GET_ENTRY(entry, priv->dma_conf.dma_tx_size);
+	}
 
 	tx_q->tx_count_frames++;
 
@@ -4827,12 +5408,49 @@ static int stmmac_xdp_xmit_xdpf(struct stmmac_priv *priv, int queue,
 		priv->xstats.tx_set_ic_bit++;
 	}
 
+	if (nr_frags) {
+		dma_wmb();
+		stmmac_set_tx_owner(priv, first);
+	}
+
 	stmmac_enable_dma_transmission(priv, priv->ioaddr);
 
-	entry = STMMAC_GET_ENTRY(entry, priv->dma_conf.dma_tx_size);
 	tx_q->cur_tx = entry;
 
 	return STMMAC_XDP_TX;
+
+dma_map_err:
+	/* Release the descriptors already set up for this frame */
+	for (entry = first_entry; i--;
+	     entry = STMMAC_GET_ENTRY(entry, priv->dma_conf.dma_tx_size)) {
+		if (tx_q->tx_skbuff_dma[entry].map_as_page)
+			dma_unmap_page(priv->device,
+				       tx_q->tx_skbuff_dma[entry].buf,
+				       tx_q->tx_skbuff_dma[entry].len,
+				       DMA_TO_DEVICE);
+		else if (!tx_q->tx_skbuff_dma[entry].pp_mapped)
+			dma_unmap_single(priv->device,
+					 tx_q->tx_skbuff_dma[entry].buf,
+					 tx_q->tx_skbuff_dma[entry].len,
+					 DMA_TO_DEVICE);
+
+		if (priv->extend_desc)
+			tx_desc = (struct dma_desc *)(tx_q->dma_etx + entry);
+		else if (tx_q->tbs & STMMAC_TBS_AVAIL)
+			tx_desc = &tx_q->dma_entx[entry].basic;
+		else
+			tx_desc = tx_q->dma_tx + entry;
+		stmmac_clear_desc(priv, tx_desc);
+
+		tx_q->tx_skbuff_dma[entry].buf = 0;
+		tx_q->tx_skbuff_dma[entry].len = 0;
+		tx_q->tx_skbuff_dma[entry].map_as_page = false;
+		tx_q->tx_skbuff_dma[entry].pp_mapped = false;
+		tx_q->tx_skbuff_dma[entry].last_segment = false;
+		tx_q->tx_skbuff_dma[entry].buf_type = STMMAC_TXBUF_T_SKB;
+	}
+
+	return STMMAC_XDP_CONSUMED;
 }
 
 static int stmmac_xdp_get_tx_queue(struct stmmac_priv *priv,
@@ -4843,12 +5461,29 @@ static int stmmac_xdp_get_tx_queue(struct stmmac_priv *priv,
 	if (unlikely(index < 0))
 		index = 0;
 
+	if (priv->xdp_txq_cnt)
+		return priv->plat->tx_queues_to_use - priv->xdp_txq_cnt +
+		       index % priv->xdp_txq_cnt;
+
 	while (index >= priv->plat->tx_queues_to_use)
 		index -= priv->plat->tx_queues_to_use;
 
 	return index;
 }
 
+/* Take the TX queue lock for XDP, counting the times it was already held by
+ * the stack, the TX completion or another CPU.
+ */
+static void stmmac_xdp_tx_lock(struct stmmac_priv *priv,
+			       struct netdev_queue *nq, int queue, int cpu)
+{
+	if (__netif_tx_trylock(nq))
+		return;
+
+	__netif_tx_lock(nq, cpu);
+	priv->xstats.txq_stats[queue].tx_xdp_lock_busy_n++;
+}
+
 static int stmmac_xdp_xmit_back(struct stmmac_priv *priv,
 				struct xdp_buff *xdp)
 {
@@ -4864,7 +5499,7 @@ static int stmmac_xdp_xmit_back(struct stmmac_priv *priv,
 	queue = stmmac_xdp_get_tx_queue(priv, cpu);
 	nq = netdev_get_tx_queue(priv->dev, queue);
 
-	__netif_tx_lock(nq, cpu);
+	stmmac_xdp_tx_lock(priv, nq, queue, cpu);
 	/* Avoids TX time-out as we are sharing with slow path */
 	txq_trans_cond_update(nq);
 
@@ -4924,6 +5559,12 @@ static struct sk_buff *stmmac_xdp_run_prog(struct stmmac_priv *priv,
 		goto out;
 	}
 
+	/* Frames spanning several buffers need a frags aware program */
+	if (unlikely(xdp_buff_has_frags(xdp) && !prog->aux->xdp_has_frags)) {
+		res = STMMAC_XDP_CONSUMED;
+		goto out;
+	}
+
 	res = __stmmac_xdp_run_prog(priv, prog, xdp);
 out:
 	return ERR_PTR(-res);
@@ -5004,8 +5645,10 @@ static void stmmac_dispatch_skb_zc(struct stmmac_priv *priv, u32 queue,
 static bool stmmac_rx_refill_zc(struct stmmac_priv *priv, u32 queue, u32 budget)
 {
 	struct stmmac_rx_queue *rx_q = &priv->dma_conf.rx_queue[queue];
+	struct xdp_buff *batch[STMMAC_XSK_ALLOC_BATCH];
 	unsigned int entry = rx_q->dirty_rx;
 	struct dma_desc *rx_desc = NULL;
+	u32 nb_batch = 0, used = 0;
 	bool ret = true;
 
 	budget = min(budget, stmmac_rx_dirty(priv, queue));
@@ -5015,12 +5658,22 @@ static bool stmmac_rx_refill_zc(struct stmmac_priv *priv, u32 queue, u32 budget)
 		dma_addr_t dma_addr;
 		bool use_rx_wd;
 
+		/* Take the fill ring entries a batch at a time rather than
+		 * paying for a ring access per descriptor.
+		 */
 		if (!buf->xdp) {
-			buf->xdp = xsk_buff_alloc(rx_q->xsk_pool);
-			if (!buf->xdp) {
-				ret = false;
-				break;
+			if (used == nb_batch) {
+				nb_batch = min_t(u32, budget + 1,
+						 STMMAC_XSK_ALLOC_BATCH);
+				nb_batch = xsk_buff_alloc_batch(rx_q->xsk_pool,
+								batch, nb_batch);
+				used = 0;
+				if (!nb_batch) {
+					ret = false;
+					break;
+				}
 			}
+			buf->xdp = batch[used++];
 		}
 
 		if (priv->extend_desc)
@@ -5049,6 +5702,10 @@ static bool stmmac_rx_refill_zc(struct stmmac_priv *priv, u32 queue, u32 budget)
 		entry = STMMAC_GET_ENTRY(entry, priv->dma_conf.dma_rx_size);
 	}
 
+	/* Descriptors still holding a buffer left some of the batch unused */
+	while (used < nb_batch)
+		xsk_buff_free(batch[used++]);
+
 	if (rx_desc) {
 		rx_q->dirty_rx = entry;
 		rx_q->rx_tail_addr = rx_q->dma_rx_phy +
@@ -5056,6 +5713,13 @@ static bool stmmac_rx_refill_zc(struct stmmac_priv *priv, u32 queue, u32 budget)
 		stmmac_set_rx_tail_ptr(priv, priv->ioaddr, rx_q->rx_tail_addr, queue);
 	}
 
+	/* The fill ring ran dry, those descriptors are left to the DMA empty */
+	if (!ret) {
+		priv->xstats.rxq_stats[queue].rx_xsk_fill_empty_n++;
+		trace_stmmac_xsk_rx_fill_empty(priv->dev, queue,
+					       stmmac_rx_dirty(priv, queue));
+	}
+
 	return ret;
 }
 
@@ -5221,11 +5885,19 @@ static int stmmac_rx_zc(struct stmmac_priv *priv, int limit, u32 queue)
 	priv->xstats.rx_pkt_n += count;
 	priv->xstats.rxq_stats[queue].rx_pkt_n += count;
 
+	/* Give back what's left of the batch, so that an idle queue doesn't
+	 * keep asking user space for a wakeup.
+	 */
+	if (dirty && !failure)
+		failure = !stmmac_rx_refill_zc(priv, queue, dirty);
+
 	if (xsk_uses_need_wakeup(rx_q->xsk_pool)) {
-		if (failure || stmmac_rx_dirty(priv, queue) > 0)
+		if (failure || stmmac_rx_dirty(priv, queue) > 0) {
 			xsk_set_rx_need_wakeup(rx_q->xsk_pool);
-		else
+			priv->xstats.rxq_stats[queue].rx_xsk_need_wakeup_n++;
+		} else {
 			xsk_clear_rx_need_wakeup(rx_q->xsk_pool);
+		}
 
 		return (int)count;
 	}
@@ -5233,6 +5905,58 @@ static int stmmac_rx_zc(struct stmmac_priv *priv, int limit, u32 queue)
 	return failure ? limit : (int)count;
 }
 
+static int stmmac_xdp_add_frag(struct xdp_buff *xdp, struct page *page,
+			       unsigned int offset, unsigned int len)
+{
+	struct skb_shared_info *sinfo = xdp_get_shared_info_from_buff(xdp);
+
+	if (!xdp_buff_has_frags(xdp)) {
+		sinfo->nr_frags = 0;
+		sinfo->xdp_frags_size = 0;
+		xdp_buff_set_frags_flag(xdp);
+	}
+
+	if (unlikely(sinfo->nr_frags == MAX_SKB_FRAGS))
+		return -ENOSPC;
+
+	__skb_fill_page_desc_noacc(sinfo, sinfo->nr_frags++, page, offset, len);
+	sinfo->xdp_frags_size += len;
+
+	if (page_is_pfmemalloc(page))
+		xdp_buff_set_frag_pfmemalloc(xdp);
+
+	return 0;
+}
+
+static struct sk_buff *stmmac_build_skb_mb(struct xdp_buff *xdp)
+{
+	struct skb_shared_info *sinfo = xdp_get_shared_info_from_buff(xdp);
+	unsigned int nr_frags = 0;
+	struct sk_buff *skb;
+
+	/* Building the SKB clears the shared info the fragments live in */
+	if (unlikely(xdp_buff_has_frags(xdp)))
+		nr_frags = sinfo->nr_frags;
+
+	skb = napi_build_skb(xdp->data_hard_start, xdp->frame_sz);
+	if (unlikely(!skb))
+		return NULL;
+
+	/* XDP program may adjust header */
+	skb_reserve(skb, xdp->data - xdp->data_hard_start);
+	__skb_put(skb, xdp->data_end - xdp->data);
+
+	if (unlikely(nr_frags))
+		xdp_update_skb_shared_info(skb, nr_frags, sinfo->xdp_frags_size,
+					   nr_frags * xdp->frame_sz,
+					   xdp_buff_is_frag_pfmemalloc(xdp));
+
+	/* Head and fragment pages go back to the pool with the SKB */
+	skb_mark_for_recycle(skb);
+
+	return skb;
+}
+
 /**
  * stmmac_rx - manage the receive process
  * @priv: driver private structure
@@ -5251,14 +5975,28 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 	enum dma_data_direction dma_dir;
 	unsigned int desc_size;
 	struct sk_buff *skb = NULL;
+	bool xdp_pending = false;
 	struct xdp_buff xdp;
 	int xdp_status = 0;
+	bool build_skb;
+	bool xdp_mb;
 	int buf_sz;
 
 	dma_dir = page_pool_get_dma_dir(rx_q->page_pool);
-	buf_sz = DIV_ROUND_UP(priv->dma_conf.dma_buf_sz, PAGE_SIZE) * PAGE_SIZE;
+	buf_sz = PAGE_SIZE << stmmac_rx_page_order(priv,
+						 priv->dma_conf.dma_buf_sz);
 	limit = min(priv->dma_conf.dma_rx_size - 1, (unsigned int)limit);
 
+	/* The SKB can be built around the page if it fits the shared info */
+	build_skb = stmmac_rx_offset(priv) + priv->dma_conf.dma_buf_sz +
+		    SKB_DATA_ALIGN(sizeof(struct skb_shared_info)) <= buf_sz;
+
+	/* With a program attached, frames spanning several buffers are
+	 * gathered into a single multi-buffer xdp_buff before running it.
+	 * The fragments are kept in the shared info of the first page.
+	 */
+	xdp_mb = build_skb && stmmac_xdp_is_enabled(priv);
+
 	if (netif_msg_rx_status(priv)) {
 		void *rx_head;
 
@@ -5284,11 +6022,14 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 
 		if (!count && rx_q->state_saved) {
 			skb = rx_q->state.skb;
+			xdp = rx_q->state.xdp;
+			xdp_pending = rx_q->state.xdp_pending;
 			error = rx_q->state.error;
 			len = rx_q->state.len;
 		} else {
 			rx_q->state_saved = false;
 			skb = NULL;
+			xdp_pending = false;
 			error = 0;
 			len = 0;
 		}
@@ -5341,6 +6082,10 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 		if (unlikely(error)) {
 			dev_kfree_skb(skb);
 			skb = NULL;
+			if (xdp_pending) {
+				stmmac_xdp_free_buff(rx_q, &xdp, true);
+				xdp_pending = false;
+			}
 			count++;
 			continue;
 		}
@@ -5367,6 +6112,65 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 			}
 		}
 
+		if (xdp_mb) {
+			dma_sync_single_for_cpu(priv->device, buf->addr,
+						buf1_len, dma_dir);
+
+			if (!xdp_pending) {
+				xdp_init_buff(&xdp, buf_sz, &rx_q->xdp_rxq);
+				xdp_prepare_buff(&xdp, page_address(buf->page),
+						 buf->page_offset, buf1_len,
+						 false);
+				xdp_pending = true;
+			} else if (stmmac_xdp_add_frag(&xdp, buf->page,
+						       buf->page_offset,
+						       buf1_len)) {
+				/* Page left in the ring, reused on refill */
+				stmmac_xdp_free_buff(rx_q, &xdp, true);
+				xdp_pending = false;
+				priv->dev->stats.rx_dropped++;
+				error = 1;
+				if (status & rx_not_ls)
+					goto read_again;
+				count++;
+				continue;
+			}
+
+			/* Page owned by the xdp_buff until the verdict */
+			buf->page = NULL;
+
+			if (status & rx_not_ls)
+				goto read_again;
+
+			xdp_pending = false;
+			skb = stmmac_xdp_run_prog(priv, &xdp);
+			if (IS_ERR(skb)) {
+				unsigned int xdp_res = -PTR_ERR(skb);
+
+				if (xdp_res & STMMAC_XDP_CONSUMED) {
+					stmmac_xdp_free_buff(rx_q, &xdp, true);
+					priv->dev->stats.rx_dropped++;
+				} else {
+					xdp_status |= xdp_res;
+				}
+
+				skb = NULL;
+				count++;
+				continue;
+			}
+
+			skb = stmmac_build_skb_mb(&xdp);
+			if (!skb) {
+				stmmac_xdp_free_buff(rx_q, &xdp, true);
+				priv->dev->stats.rx_dropped++;
+				count++;
+				continue;
+			}
+
+			len = skb->len;
+			goto drain_data;
+		}
+
 		if (!skb) {
 			unsigned int pre_len, sync_len;
 
@@ -5423,20 +6227,61 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 			/* XDP program may expand or reduce tail */
 			buf1_len = xdp.data_end - xdp.data;
 
-			skb = napi_alloc_skb(&ch->rx_napi, buf1_len);
-			if (!skb) {
-				priv->dev->stats.rx_dropped++;
-				count++;
-				goto drain_data;
-			}
+			/*
+			 * Split headers and small frames are copied into a
+			 * small SKB and the page is recycled right away. Larger
+			 * ones keep their page as SKB head, or as first frag
+			 * behind a copy of their headers when there's no room
+			 * left in the page for the shared info.
+			 */
+			if (build_skb && buf1_len > priv->rx_copybreak) {
+				skb = napi_build_skb(xdp.data_hard_start, buf_sz);
+				if (!skb) {
+					priv->dev->stats.rx_dropped++;
+					count++;
+					goto drain_data;
+				}
 
-			/* XDP program may adjust header */
-			skb_copy_to_linear_data(skb, xdp.data, buf1_len);
-			skb_put(skb, buf1_len);
+				/* XDP program may adjust header */
+				skb_reserve(skb, xdp.data - xdp.data_hard_start);
+				skb_put(skb, buf1_len);
 
-			/* Data payload copied into SKB, page ready for recycle */
-			page_pool_recycle_direct(rx_q->page_pool, buf->page);
-			buf->page = NULL;
+				/* Page owned by the SKB, recycled once freed */
+				buf->page = NULL;
+			} else {
+				unsigned int hlen = buf1_len;
+
+				if (buf1_len > priv->rx_copybreak)
+					hlen = eth_get_headlen(priv->dev, xdp.data,
+							       priv->rx_copybreak);
+
+				skb = napi_alloc_skb(&ch->rx_napi, hlen);
+				if (!skb) {
+					priv->dev->stats.rx_dropped++;
+					count++;
+					goto drain_data;
+				}
+
+				/* XDP program may adjust header */
+				skb_copy_to_linear_data(skb, xdp.data, hlen);
+				skb_put(skb, hlen);
+
+				if (hlen < buf1_len) {
+					skb_add_rx_frag(skb, 0, buf->page,
+							xdp.data + hlen -
+							page_address(buf->page),
+							buf1_len - hlen,
+							priv->dma_conf.dma_buf_sz);
+				} else {
+					/* Data copied into SKB, page ready for recycle */
+					page_pool_recycle_direct(rx_q->page_pool,
+								 buf->page);
+				}
+				buf->page = NULL;
+			}
+
+			/* Payload pages go back to the pool with the SKB */
+			skb_mark_for_recycle(skb);
 		} else if (buf1_len) {
 			dma_sync_single_for_cpu(priv->device, buf->addr,
 						buf1_len, dma_dir);
@@ -5445,7 +6290,6 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 					priv->dma_conf.dma_buf_sz);
 
 			/* Data payload appended into SKB */
-			page_pool_release_page(rx_q->page_pool, buf->page);
 			buf->page = NULL;
 		}
 
@@ -5457,7 +6301,6 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 					priv->dma_conf.dma_buf_sz);
 
 			/* Data payload appended into SKB */
-			page_pool_release_page(rx_q->page_pool, buf->sec_page);
 			buf->sec_page = NULL;
 		}
 
@@ -5494,12 +6337,16 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 
 		priv->dev->stats.rx_packets++;
 		priv->dev->stats.rx_bytes += len;
+		ch->rx_dim_packets++;
+		ch->rx_dim_bytes += len;
 		count++;
 	}
 
 	if (status & rx_not_ls || skb) {
 		rx_q->state_saved = true;
 		rx_q->state.skb = skb;
+		rx_q->state.xdp = xdp;
+		rx_q->state.xdp_pending = xdp_pending;
 		rx_q->state.error = error;
 		rx_q->state.len = len;
 	}
@@ -5514,6 +6361,17 @@ static int stmmac_rx(struct stmmac_priv *priv, int limit, u32 queue)
 	return count;
 }
 
+static void stmmac_rx_napi_stats(struct stmmac_priv *priv, u32 queue,
+				 int work_done, int budget)
+{
+	struct stmmac_rxq_stats *stats = &priv->xstats.rxq_stats[queue];
+
+	stats->rx_napi_poll_n++;
+	stats->rx_napi_work_n += work_done;
+	if (work_done >= budget)
+		stats->rx_napi_full_n++;
+}
+
 static int stmmac_napi_poll_rx(struct napi_struct *napi, int budget)
 {
 	struct stmmac_channel *ch =
@@ -5525,9 +6383,19 @@ static int stmmac_napi_poll_rx(struct napi_struct *napi, int budget)
 	priv->xstats.napi_poll++;
 
 	work_done = stmmac_rx(priv, budget, chan);
+	stmmac_rx_napi_stats(priv, chan, work_done, budget);
 	if (work_done < budget && napi_complete_done(napi, work_done)) {
 		unsigned long flags;
 
+		if (priv->rx_dim_enabled) {
+			struct dim_sample dim_sample = {};
+
+			dim_update_sample(++ch->rx_dim_events,
+					  ch->rx_dim_packets, ch->rx_dim_bytes,
+					  &dim_sample);
+			net_dim(&ch->rx_dim, dim_sample);
+		}
+
 		spin_lock_irqsave(&ch->lock, flags);
 		stmmac_enable_dma_irq(priv, priv->ioaddr, chan, 1, 0);
 		spin_unlock_irqrestore(&ch->lock, flags);
@@ -5552,6 +6420,15 @@ static int stmmac_napi_poll_tx(struct napi_struct *napi, int budget)
 	if (work_done < budget && napi_complete_done(napi, work_done)) {
 		unsigned long flags;
 
+		if (priv->tx_dim_enabled) {
+			struct dim_sample dim_sample = {};
+
+			dim_update_sample(++ch->tx_dim_events,
+					  ch->tx_dim_packets, ch->tx_dim_bytes,
+					  &dim_sample);
+			net_dim(&ch->tx_dim, dim_sample);
+		}
+
 		spin_lock_irqsave(&ch->lock, flags);
 		stmmac_enable_dma_irq(priv, priv->ioaddr, chan, 0, 1);
 		spin_unlock_irqrestore(&ch->lock, flags);
@@ -5574,6 +6451,7 @@ static int stmmac_napi_poll_rxtx(struct napi_struct *napi, int budget)
 	tx_done = min(tx_done, budget);
 
 	rx_done = stmmac_rx_zc(priv, budget, chan);
+	stmmac_rx_napi_stats(priv, chan, rx_done, budget);
 
 	rxtx_done = max(tx_done, rx_done);
 
@@ -5654,8 +6532,9 @@ static int stmmac_change_mtu(struct net_device *dev, int new_mtu)
 
 	txfifosz /= priv->plat->tx_queues_to_use;
 
-	if (stmmac_xdp_is_enabled(priv) && new_mtu > ETH_DATA_LEN) {
-		netdev_dbg(priv->dev, "Jumbo frames not supported for XDP\n");
+	if (stmmac_xdp_is_enabled(priv) && new_mtu > ETH_DATA_LEN &&
+	    !priv->xdp_prog->aux->xdp_has_frags) {
+		netdev_dbg(priv->dev, "Jumbo frames need a frags aware XDP program\n");
 		return -EINVAL;
 	}
 
@@ -5723,6 +6602,50 @@ static netdev_features_t stmmac_fix_features(struct net_device *dev,
 			priv->tso = false;
 	}
 
+	/* stmmac_uso_xmit() relies on SG and the COE */
+	if (priv->uso_sw &&
+	    (!(features & NETIF_F_SG) || !(features & NETIF_F_CSUM_MASK)))
+		features &= ~NETIF_F_GSO_UDP_L4;
+
+	return features;
+}
+
+static netdev_features_t stmmac_features_check(struct sk_buff *skb,
+					       struct net_device *dev,
+					       netdev_features_t features)
+{
+	struct stmmac_priv *priv = netdev_priv(dev);
+	u32 queue = skb_get_queue_mapping(skb);
+	int i;
+
+	features = vlan_features_check(skb, features);
+
+	if (!priv->uso_sw || !skb_is_gso(skb) ||
+	    !(skb_shinfo(skb)->gso_type & SKB_GSO_UDP_L4))
+		return features;
+
+	/* Leave to the stack what stmmac_uso_xmit() can't segment: queues
+	 * without COE, headers not fitting in a slot, datagrams not fitting in
+	 * a descriptor buffer, or needing more descriptors than a running
+	 * queue is guaranteed to have.
+	 */
+	if ((priv->tx_q_coe_lmt && queue >= priv->tx_q_with_coe) ||
+	    skb_transport_offset(skb) + sizeof(struct udphdr) >
+	    STMMAC_USO_HDR_SIZE ||
+	    skb_shinfo(skb)->gso_size >= BUF_SIZE_2KiB ||
+	    tso_count_descs(skb) > STMMAC_USO_MAX_DESCS)
+		return features & ~NETIF_F_GSO_MASK;
+
+	/* The payload is mapped through its kernel address */
+	if (IS_ENABLED(CONFIG_HIGHMEM)) {
+		for (i = 0; i < skb_shinfo(skb)->nr_frags; i++) {
+			const skb_frag_t *frag = &skb_shinfo(skb)->frags[i];
+
+			if (PageHighMem(skb_frag_page(frag)))
+				return features & ~NETIF_F_GSO_MASK;
+		}
+	}
+
 	return features;
 }
 
@@ -6104,9 +7027,12 @@ static int stmmac_setup_tc(struct net_device *ndev, enum tc_setup_type type,
 static u16 stmmac_select_queue(struct net_device *dev, struct sk_buff *skb,
 			       struct net_device *sb_dev)
 {
+	struct stmmac_priv *priv = netdev_priv(dev);
 	int gso = skb_shinfo(skb)->gso_type;
 
-	if (gso & (SKB_GSO_TCPV4 | SKB_GSO_TCPV6 | SKB_GSO_UDP_L4)) {
+	/* Any queue with COE can run stmmac_uso_xmit() */
+	if (!priv->uso_sw &&
+	    (gso & (SKB_GSO_TCPV4 | SKB_GSO_TCPV6 | SKB_GSO_UDP_L4))) {
 		/*
 		 * There is no way to determine the number of TSO/USO
 		 * capable Queues. Let's use always the Queue 0
@@ -6518,7 +7444,7 @@ static int stmmac_xdp_xmit(struct net_device *dev, int num_frames,
 	queue = stmmac_xdp_get_tx_queue(priv, cpu);
 	nq = netdev_get_tx_queue(priv->dev, queue);
 
-	__netif_tx_lock(nq, cpu);
+	stmmac_xdp_tx_lock(priv, nq, queue, cpu);
 	/* Avoids TX time-out as we are sharing with slow path */
 	txq_trans_cond_update(nq);
 
@@ -6691,6 +7617,27 @@ void stmmac_xdp_release(struct net_device *dev)
 	netif_carrier_off(dev);
 }
 
+/**
+ * stmmac_xdp_txq_update - set the TX queues the stack can use
+ * @priv: driver private structure
+ * Description: when there are TX queues enough for the stack to keep one per
+ * CPU, XDP_TX and ndo_xdp_xmit get one per CPU as well at the top of the
+ * range, which the stack stays off. Otherwise they share the queues of the
+ * stack. Must be called with the rtnl lock held.
+ */
+void stmmac_xdp_txq_update(struct stmmac_priv *priv)
+{
+	u32 tx_cnt = priv->plat->tx_queues_to_use;
+	u32 cpus = num_possible_cpus();
+
+	if (stmmac_xdp_is_enabled(priv) && tx_cnt >= 2 * cpus)
+		priv->xdp_txq_cnt = cpus;
+	else
+		priv->xdp_txq_cnt = 0;
+
+	netif_set_real_num_tx_queues(priv->dev, tx_cnt - priv->xdp_txq_cnt);
+}
+
 int stmmac_xdp_open(struct net_device *dev)
 {
 	struct stmmac_priv *priv = netdev_priv(dev);
@@ -6704,6 +7651,9 @@ int stmmac_xdp_open(struct net_device *dev)
 	u32 chan;
 	int ret;
 
+	/* XDP being turned on or off changes the RX buffer layout */
+	priv->dma_conf.dma_buf_sz = stmmac_rx_bfsize(priv, dev->mtu);
+
 	ret = alloc_dma_desc_resources(priv, &priv->dma_conf);
 	if (ret < 0) {
 		netdev_err(dev, "%s: DMA descriptors allocation failed\n",
@@ -6806,6 +7756,7 @@ int stmmac_xsk_wakeup(struct net_device *dev, u32 queue, u32 flags)
 	struct stmmac_rx_queue *rx_q;
 	struct stmmac_tx_queue *tx_q;
 	struct stmmac_channel *ch;
+	bool missed;
 
 	if (test_bit(STMMAC_DOWN, &priv->state) ||
 	    !netif_carrier_ok(priv->dev))
@@ -6825,7 +7776,18 @@ int stmmac_xsk_wakeup(struct net_device *dev, u32 queue, u32 flags)
 	if (!rx_q->xsk_pool && !tx_q->xsk_pool)
 		return -EINVAL;
 
-	if (!napi_if_scheduled_mark_missed(&ch->rxtx_napi)) {
+	if (flags & XDP_WAKEUP_RX)
+		priv->xstats.rxq_stats[queue].rx_xsk_wakeup_n++;
+	if (flags & XDP_WAKEUP_TX)
+		priv->xstats.txq_stats[queue].tx_xsk_wakeup_n++;
+
+	/* A busy polling socket or a pending IRQ already has the NAPI
+	 * running, which then polls once more instead of being raised again.
+	 */
+	missed = napi_if_scheduled_mark_missed(&ch->rxtx_napi);
+	trace_stmmac_xsk_wakeup(priv->dev, queue, flags, missed);
+
+	if (!missed) {
 		/* EQoS does not have per-DMA channel SW interrupt,
 		 * so we schedule RX Napi straight-away.
 		 */
@@ -6842,6 +7804,7 @@ static const struct net_device_ops stmmac_netdev_ops = {
 	.ndo_stop = stmmac_release,
 	.ndo_change_mtu = stmmac_change_mtu,
 	.ndo_fix_features = stmmac_fix_features,
+	.ndo_features_check = stmmac_features_check,
 	.ndo_set_features = stmmac_set_features,
 	.ndo_set_rx_mode = stmmac_set_rx_mode,
 	.ndo_tx_timeout = stmmac_tx_timeout,
@@ -7007,6 +7970,11 @@ static void stmmac_napi_add(struct net_device *dev)
 		ch->index = queue;
 		spin_lock_init(&ch->lock);
 
+		INIT_WORK(&ch->rx_dim.work, stmmac_rx_dim_work);
+		ch->rx_dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+		INIT_WORK(&ch->tx_dim.work, stmmac_tx_dim_work);
+		ch->tx_dim.mode = DIM_CQ_PERIOD_MODE_START_FROM_EQE;
+
 		if (queue < priv->plat->rx_queues_to_use) {
 			netif_napi_add(dev, &ch->rx_napi, stmmac_napi_poll_rx);
 		}
@@ -7268,6 +8236,10 @@ int stmmac_dvr_probe(struct device *device,
 			ndev->hw_features |= NETIF_F_GSO_UDP_L4;
 		priv->tso = true;
 		dev_info(priv->device, "TSO feature enabled\n");
+	} else if (priv->plat->tx_coe) {
+		/* Segmented into the ring by stmmac_uso_xmit() */
+		ndev->hw_features |= NETIF_F_GSO_UDP_L4;
+		priv->uso_sw = true;
 	}
 
 	if (priv->dma_cap.sphen && !priv->plat->sph_disable) {
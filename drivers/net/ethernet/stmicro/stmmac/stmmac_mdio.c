@@ -45,6 +45,26 @@
 #define MII_XGMAC_PA_SHIFT		16
 #define MII_XGMAC_DA_SHIFT		21
 
+/* A frame is 64 MDC cycles, 25.6us at the 2.5MHz maximum MDC rate */
+#define MII_FRAME_US			26
+#define MII_POLL_US			10
+#define MII_TIMEOUT_US			10000
+
+/*
+ * Sleep for the duration of the frame just started before looking at the
+ * busy bit, then poll it at a finer interval than the setup waits do: most
+ * frames complete after a single wakeup.
+ */
+static int stmmac_mdio_wait_frame(void __iomem *reg, u32 busy)
+{
+	u32 v;
+
+	usleep_range(MII_FRAME_US, 2 * MII_FRAME_US);
+
+	return readl_poll_timeout(reg, v, !(v & busy), MII_POLL_US,
+				  MII_TIMEOUT_US);
+}
+
 static int stmmac_xgmac2_c45_format(struct stmmac_priv *priv, int phyaddr,
 				    int phyreg, u32 *hw_addr)
 {
@@ -130,9 +150,8 @@ static int stmmac_xgmac2_mdio_read(struct mii_bus *bus, int phyaddr, int phyreg)
 	writel(addr, priv->ioaddr + mii_address);
 	writel(value, priv->ioaddr + mii_data);
 
-	/* Wait until any existing MII operation is complete */
-	if (readl_poll_timeout(priv->ioaddr + mii_data, tmp,
-			       !(tmp & MII_XGMAC_BUSY), 100, 10000)) {
+	/* Wait until the MII operation is complete */
+	if (stmmac_mdio_wait_frame(priv->ioaddr + mii_data, MII_XGMAC_BUSY)) {
 		ret = -EBUSY;
 		goto err_disable_clks;
 	}
@@ -197,9 +216,8 @@ static int stmmac_xgmac2_mdio_write(struct mii_bus *bus, int phyaddr,
 	writel(addr, priv->ioaddr + mii_address);
 	writel(value, priv->ioaddr + mii_data);
 
-	/* Wait until any existing MII operation is complete */
-	ret = readl_poll_timeout(priv->ioaddr + mii_data, tmp,
-				 !(tmp & MII_XGMAC_BUSY), 100, 10000);
+	/* Wait until the MII operation is complete */
+	ret = stmmac_mdio_wait_frame(priv->ioaddr + mii_data, MII_XGMAC_BUSY);
 
 err_disable_clks:
 	pm_runtime_put(priv->device);
@@ -259,8 +277,7 @@ static int stmmac_mdio_read(struct mii_bus *bus, int phyaddr, int phyreg)
 	writel(data, priv->ioaddr + mii_data);
 	writel(value, priv->ioaddr + mii_address);
 
-	if (readl_poll_timeout(priv->ioaddr + mii_address, v, !(v & MII_BUSY),
-			       100, 10000)) {
+	if (stmmac_mdio_wait_frame(priv->ioaddr + mii_address, MII_BUSY)) {
 		data = -EBUSY;
 		goto err_disable_clks;
 	}
@@ -330,9 +347,8 @@ static int stmmac_mdio_write(struct mii_bus *bus, int phyaddr, int phyreg,
 	writel(data, priv->ioaddr + mii_data);
 	writel(value, priv->ioaddr + mii_address);
 
-	/* Wait until any existing MII operation is complete */
-	ret = readl_poll_timeout(priv->ioaddr + mii_address, v, !(v & MII_BUSY),
-				 100, 10000);
+	/* Wait until the MII operation is complete */
+	ret = stmmac_mdio_wait_frame(priv->ioaddr + mii_address, MII_BUSY);
 
 err_disable_clks:
 	pm_runtime_put(priv->device);
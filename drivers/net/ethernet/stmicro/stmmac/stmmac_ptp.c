@@ -11,33 +11,31 @@
 #include "stmmac_ptp.h"
 #include "dwmac4.h"
 
+/* Lead time of a PEROUT request aligned on its period */
+#define STMMAC_PEROUT_MARGIN_NS		NSEC_PER_MSEC
+
 /**
  * stmmac_adjust_freq
  *
  * @ptp: pointer to ptp_clock_info structure
- * @ppb: desired period change in parts ber billion
+ * @scaled_ppm: desired period change in scaled parts per million
  *
  * Description: this function will adjust the frequency of hardware clock.
+ * The addend is computed from the nominal one with the full 16 bit
+ * fractional resolution of @scaled_ppm, only its write needs the lock.
  */
-static int stmmac_adjust_freq(struct ptp_clock_info *ptp, s32 ppb)
+static int stmmac_adjust_freq(struct ptp_clock_info *ptp, long scaled_ppm)
 {
 	struct stmmac_priv *priv =
 	    container_of(ptp, struct stmmac_priv, ptp_clock_ops);
 	unsigned long flags;
-	u32 diff, addend;
-	int neg_adj = 0;
-	u64 adj;
-
-	if (ppb < 0) {
-		neg_adj = 1;
-		ppb = -ppb;
-	}
+	u32 addend;
+	u64 diff;
 
 	addend = priv->default_addend;
-	adj = addend;
-	adj *= ppb;
-	diff = div_u64(adj, 1000000000ULL);
-	addend = neg_adj ? (addend - diff) : (addend + diff);
+	diff = mul_u64_u64_div_u64(addend, abs(scaled_ppm),
+				   1000000ULL << 16);
+	addend = scaled_ppm < 0 ? (addend - diff) : (addend + diff);
 
 	write_lock_irqsave(&priv->ptp_lock, flags);
 	stmmac_config_addend(priv, priv->ptpaddr, addend);
@@ -183,7 +181,8 @@ static int stmmac_enable(struct ptp_clock_info *ptp,
 	switch (rq->type) {
 	case PTP_CLK_REQ_PEROUT:
 		/* Reject requests with unsupported flags */
-		if (rq->perout.flags)
+		if (rq->perout.flags & ~(PTP_PEROUT_DUTY_CYCLE |
+					 PTP_PEROUT_PHASE))
 			return -EOPNOTSUPP;
 
 		cfg = &priv->pps[rq->perout.index];
@@ -193,7 +192,33 @@ static int stmmac_enable(struct ptp_clock_info *ptp,
 		cfg->period.tv_sec = rq->perout.period.sec;
 		cfg->period.tv_nsec = rq->perout.period.nsec;
 
+		if (rq->perout.flags & PTP_PEROUT_DUTY_CYCLE) {
+			cfg->width.tv_sec = rq->perout.on.sec;
+			cfg->width.tv_nsec = rq->perout.on.nsec;
+		} else {
+			cfg->width.tv_sec = 0;
+			cfg->width.tv_nsec = 0;
+		}
+
 		write_lock_irqsave(&priv->ptp_lock, flags);
+		if (on && (rq->perout.flags & PTP_PEROUT_PHASE)) {
+			u64 period = timespec64_to_ns(&cfg->period);
+			u64 phase = timespec64_to_ns(&cfg->start);
+			u64 now = 0;
+
+			if (!period) {
+				write_unlock_irqrestore(&priv->ptp_lock, flags);
+				return -EINVAL;
+			}
+
+			/* Start on the first period boundary far enough
+			 * ahead, shifted by the phase.
+			 */
+			stmmac_get_systime(priv, priv->ptpaddr, &now);
+			now = div64_u64(now + STMMAC_PEROUT_MARGIN_NS, period);
+			cfg->start = ns_to_timespec64((now + 1) * period +
+						      phase);
+		}
 		ret = stmmac_flex_pps_config(priv, priv->ioaddr,
 					     rq->perout.index, cfg, on,
 					     priv->sub_second_inc,
@@ -272,7 +297,7 @@ static struct ptp_clock_info stmmac_ptp_clock_ops = {
 	.n_per_out = 0, /* will be overwritten in stmmac_ptp_register */
 	.n_pins = 0,
 	.pps = 0,
-	.adjfreq = stmmac_adjust_freq,
+	.adjfine = stmmac_adjust_freq,
 	.adjtime = stmmac_adjust_time,
 	.gettime64 = stmmac_get_time,
 	.settime64 = stmmac_set_time,
@@ -11,7 +11,9 @@
 #include <linux/crc32.h>
 #include <linux/ethtool.h>
 #include <linux/ip.h>
+#include <linux/module.h>
 #include <linux/phy.h>
+#include <linux/sizes.h>
 #include <linux/udp.h>
 #include <net/pkt_cls.h>
 #include <net/pkt_sched.h>
@@ -1815,6 +1817,349 @@ static int stmmac_test_tbs(struct stmmac_priv *priv)
 	return ret;
 }
 
+#define STMMAC_TSO_BENCH_FRAMES		1024
+#define STMMAC_TSO_BENCH_BURST		16
+#define STMMAC_TSO_BENCH_SIZE		SZ_32K
+#define STMMAC_TSO_BENCH_TIMEOUT	msecs_to_jiffies(1000)
+
+/* The benchmark keeps queue 0 busy for a while, so it only runs on demand */
+static bool tso_bench;
+module_param(tso_bench, bool, 0644);
+MODULE_PARM_DESC(tso_bench, "Run the TSO benchmark with the selftests");
+
+static netdev_tx_t stmmac_test_tso_bench_xmit(struct net_device *dev,
+					      struct sk_buff *skb, bool more)
+{
+	struct netdev_queue *txq = netdev_get_tx_queue(dev, 0);
+	netdev_tx_t ret = NETDEV_TX_BUSY;
+
+	local_bh_disable();
+	HARD_TX_LOCK(dev, txq, smp_processor_id());
+	if (!netif_xmit_frozen_or_drv_stopped(txq))
+		ret = netdev_start_xmit(skb, dev, txq, more);
+	HARD_TX_UNLOCK(dev, txq);
+	local_bh_enable();
+
+	return ret;
+}
+
+/*
+ * Frames sent with more set wait for the doorbell of a later frame, so a
+ * burst cut short ends with the template itself sent without it.  A busy
+ * queue needs nothing: the driver rings the doorbell when it stops it.
+ */
+static void stmmac_test_tso_bench_flush(struct stmmac_priv *priv,
+					struct sk_buff *skb)
+{
+	if (stmmac_test_tso_bench_xmit(priv->dev, skb_get(skb), false) !=
+	    NETDEV_TX_OK)
+		kfree_skb(skb);
+}
+
+/* Not a functional test: pushes bursts of TSO frames through queue 0 like
+ * pktgen would, so the pps and the descriptors each frame takes can be
+ * compared across changes of the TX path.
+ */
+static int stmmac_test_tso_bench(struct stmmac_priv *priv)
+{
+	unsigned long desc_start, frames_start, desc, frames, timeout;
+	struct stmmac_tx_queue *tx_q = &priv->dma_conf.tx_queue[0];
+	struct stmmac_packet_attrs attr = { };
+	struct sk_buff *skb, *nskb;
+	bool pending = false;
+	u64 elapsed, pps;
+	ktime_t start;
+	int i, ret = 0;
+	u32 mss;
+
+	if (!READ_ONCE(tso_bench))
+		return -EOPNOTSUPP;
+
+	if (!priv->tso || !(priv->dev->features & NETIF_F_TSO))
+		return -EOPNOTSUPP;
+
+	attr.dst = priv->dev->dev_addr;
+	attr.tcp = 1;
+	attr.max_size = STMMAC_TSO_BENCH_SIZE;
+
+	skb = stmmac_test_get_udp_skb(priv, &attr);
+	if (!skb)
+		return -ENOMEM;
+
+	mss = priv->dev->mtu - sizeof(struct iphdr) - sizeof(struct tcphdr);
+	skb_shinfo(skb)->gso_size = mss;
+	skb_shinfo(skb)->gso_type = SKB_GSO_TCPV4;
+	skb_shinfo(skb)->gso_segs = DIV_ROUND_UP(skb->len -
+						 skb_tcp_all_headers(skb), mss);
+	skb_set_queue_mapping(skb, 0);
+
+	desc_start = priv->xstats.tx_tso_desc;
+	frames_start = priv->xstats.tx_tso_frames;
+	start = ktime_get();
+
+	for (i = 0; i < STMMAC_TSO_BENCH_FRAMES; i++) {
+		bool more = ((i + 1) % STMMAC_TSO_BENCH_BURST) &&
+			    (i + 1 < STMMAC_TSO_BENCH_FRAMES);
+
+		nskb = skb_clone(skb, GFP_KERNEL);
+		if (!nskb) {
+			ret = -ENOMEM;
+			goto flush;
+		}
+
+		timeout = jiffies + STMMAC_TSO_BENCH_TIMEOUT;
+		while (stmmac_test_tso_bench_xmit(priv->dev, nskb, more) !=
+		       NETDEV_TX_OK) {
+			if (time_after(jiffies, timeout)) {
+				kfree_skb(nskb);
+				ret = -ETIMEDOUT;
+				goto flush;
+			}
+			usleep_range(10, 20);
+		}
+		pending = more;
+	}
+
+	/* Wait for the ring to drain so TX completion is accounted too */
+	timeout = jiffies + STMMAC_TSO_BENCH_TIMEOUT;
+	while (tx_q->dirty_tx != tx_q->cur_tx) {
+		if (time_after(jiffies, timeout)) {
+			ret = -ETIMEDOUT;
+			goto cleanup;
+		}
+		usleep_range(10, 20);
+	}
+
+	elapsed = max_t(u64, ktime_us_delta(ktime_get(), start), 1);
+	frames = priv->xstats.tx_tso_frames - frames_start;
+	desc = priv->xstats.tx_tso_desc - desc_start;
+	if (!frames) {
+		ret = -EINVAL;
+		goto cleanup;
+	}
+
+	pps = div64_u64((u64)frames * skb_shinfo(skb)->gso_segs * USEC_PER_SEC,
+			elapsed);
+	netdev_info(priv->dev,
+		    "TSO: %llu pps, %lu.%02lu descriptors per frame of %u segments\n",
+		    pps, desc / frames, (desc * 100 / frames) % 100,
+		    skb_shinfo(skb)->gso_segs);
+
+cleanup:
+	kfree_skb(skb);
+	return ret;
+
+flush:
+	if (pending)
+		stmmac_test_tso_bench_flush(priv, skb);
+	goto cleanup;
+}
+
+#define STMMAC_LB_BENCH_FRAMES		4096
+#define STMMAC_LB_BENCH_DPORT		9
+#define STMMAC_LB_BENCH_TIMEOUT		msecs_to_jiffies(1000)
+
+/* The benchmark floods every TX queue, so it is skipped unless asked for */
+static bool lb_bench;
+module_param(lb_bench, bool, 0644);
+MODULE_PARM_DESC(lb_bench, "Run the loopback benchmark with the selftests");
+
+struct stmmac_lb_bench {
+	struct packet_type pt;
+	atomic_t received;
+};
+
+/* Sums of the RX hot path statistics of all the RX queues */
+struct stmmac_lb_bench_stats {
+	unsigned long napi_polls;
+	unsigned long napi_work;
+	unsigned long napi_full;
+	unsigned long refills;
+	unsigned long refill_ns;
+	u64 pp_recycled;
+	u64 pp_released;
+};
+
+static void stmmac_test_lb_bench_stats(struct stmmac_priv *priv,
+				       struct stmmac_lb_bench_stats *s)
+{
+#ifdef CONFIG_PAGE_POOL_STATS
+	struct page_pool_stats pp_stats = { };
+#endif
+	u32 queue;
+
+	memset(s, 0, sizeof(*s));
+
+	for (queue = 0; queue < priv->plat->rx_queues_to_use; queue++) {
+		struct stmmac_rxq_stats *q = &priv->xstats.rxq_stats[queue];
+#ifdef CONFIG_PAGE_POOL_STATS
+		struct page_pool *pp = priv->dma_conf.rx_queue[queue].page_pool;
+#endif
+
+		s->napi_polls += q->rx_napi_poll_n;
+		s->napi_work += q->rx_napi_work_n;
+		s->napi_full += q->rx_napi_full_n;
+		s->refills += q->rx_refill_n;
+		s->refill_ns += q->rx_refill_ns;
+#ifdef CONFIG_PAGE_POOL_STATS
+		if (pp)
+			page_pool_get_stats(pp, &pp_stats);
+#endif
+	}
+
+#ifdef CONFIG_PAGE_POOL_STATS
+	/* The pages of the remote caches are accounted in ring when flushed */
+	s->pp_recycled = pp_stats.recycle_stats.cached +
+			 pp_stats.recycle_stats.ring;
+	s->pp_released = pp_stats.recycle_stats.ring_full +
+			 pp_stats.recycle_stats.released_refcnt;
+#endif
+}
+
+static int stmmac_test_lb_bench_rcv(struct sk_buff *skb,
+				    struct net_device *ndev,
+				    struct packet_type *pt,
+				    struct net_device *orig_ndev)
+{
+	struct stmmac_lb_bench *bench = pt->af_packet_priv;
+	struct {
+		struct iphdr ip;
+		struct udphdr udp;
+	} _hdr, *hdr;
+
+	hdr = skb_header_pointer(skb, 0, sizeof(_hdr), &_hdr);
+	if (hdr && hdr->ip.ihl == 5 && hdr->ip.protocol == IPPROTO_UDP &&
+	    hdr->udp.dest == htons(STMMAC_LB_BENCH_DPORT))
+		atomic_inc(&bench->received);
+
+	kfree_skb(skb);
+	return 0;
+}
+
+static int __stmmac_test_lb_bench(struct stmmac_priv *priv,
+				  struct stmmac_lb_bench *bench, u16 queue,
+				  int size)
+{
+	struct stmmac_lb_bench_stats before, after;
+	struct stmmac_packet_attrs attr = { };
+	unsigned long timeout, refills;
+	struct sk_buff *skb, *nskb;
+	u64 start, elapsed, pps;
+	int i, ret = 0;
+	u32 received;
+
+	attr.dst = priv->dev->dev_addr;
+	attr.dport = STMMAC_LB_BENCH_DPORT;
+	attr.max_size = size;
+	attr.queue_mapping = queue;
+
+	skb = stmmac_test_get_udp_skb(priv, &attr);
+	if (!skb)
+		return -ENOMEM;
+	skb_set_queue_mapping(skb, queue);
+
+	atomic_set(&bench->received, 0);
+	stmmac_test_lb_bench_stats(priv, &before);
+	start = ktime_get_ns();
+
+	for (i = 0; i < STMMAC_LB_BENCH_FRAMES; i++) {
+		timeout = jiffies + STMMAC_LB_BENCH_TIMEOUT;
+		do {
+			nskb = skb_clone(skb, GFP_KERNEL);
+			if (!nskb) {
+				ret = -ENOMEM;
+				goto cleanup;
+			}
+
+			/* A busy ring frees the clone, make a new one */
+			ret = dev_direct_xmit(nskb, queue);
+			if (ret == NETDEV_TX_BUSY) {
+				if (time_after(jiffies, timeout)) {
+					ret = -ETIMEDOUT;
+					goto cleanup;
+				}
+				usleep_range(10, 20);
+			}
+		} while (ret == NETDEV_TX_BUSY);
+
+		if (ret)
+			goto cleanup;
+	}
+
+	/* Frames dropped on the way never come back, stop waiting then */
+	timeout = jiffies + STMMAC_LB_BENCH_TIMEOUT;
+	while (atomic_read(&bench->received) < STMMAC_LB_BENCH_FRAMES &&
+	       time_before(jiffies, timeout))
+		usleep_range(10, 20);
+
+	received = atomic_read(&bench->received);
+	elapsed = max_t(u64, ktime_get_ns() - start, 1);
+	stmmac_test_lb_bench_stats(priv, &after);
+
+	if (!received) {
+		ret = -ETIMEDOUT;
+		goto cleanup;
+	}
+
+	pps = div64_u64((u64)received * NSEC_PER_SEC, elapsed);
+	refills = after.refills - before.refills;
+
+	/* One key=value line per run, meant to be parsed */
+	netdev_info(priv->dev,
+		    "lb_bench: queue=%u size=%d frames=%u received=%u pps=%llu napi_polls=%lu napi_work=%lu napi_full=%lu refills=%lu ns_per_refill=%lu pp_recycled=%llu pp_released=%llu\n",
+		    queue, size, STMMAC_LB_BENCH_FRAMES, received, pps,
+		    after.napi_polls - before.napi_polls,
+		    after.napi_work - before.napi_work,
+		    after.napi_full - before.napi_full, refills,
+		    refills ? (after.refill_ns - before.refill_ns) / refills : 0,
+		    after.pp_recycled - before.pp_recycled,
+		    after.pp_released - before.pp_released);
+
+cleanup:
+	kfree_skb(skb);
+	return ret;
+}
+
+/* Not a functional test either: loops frames of several sizes back through
+ * each TX queue and reports the rate they come back at, along with how the
+ * RX hot path coped, so it can be compared across kernel and driver updates.
+ */
+static int stmmac_test_lb_bench(struct stmmac_priv *priv)
+{
+	static const int sizes[] = { ETH_ZLEN, 512, ETH_FRAME_LEN };
+	u32 tx_cnt = priv->plat->tx_queues_to_use;
+	struct stmmac_lb_bench *bench;
+	int i, ret = 0;
+	u16 queue;
+
+	if (!READ_ONCE(lb_bench))
+		return -EOPNOTSUPP;
+
+	bench = kzalloc(sizeof(*bench), GFP_KERNEL);
+	if (!bench)
+		return -ENOMEM;
+
+	bench->pt.type = htons(ETH_P_IP);
+	bench->pt.func = stmmac_test_lb_bench_rcv;
+	bench->pt.dev = priv->dev;
+	bench->pt.af_packet_priv = bench;
+	dev_add_pack(&bench->pt);
+
+	for (queue = 0; queue < tx_cnt && !ret; queue++) {
+		for (i = 0; i < ARRAY_SIZE(sizes) && !ret; i++) {
+			if (sizes[i] > priv->dev->mtu + ETH_HLEN)
+				continue;
+
+			ret = __stmmac_test_lb_bench(priv, bench, queue,
+						     sizes[i]);
+		}
+	}
+
+	dev_remove_pack(&bench->pt);
+	kfree(bench);
+	return ret;
+}
+
 #define STMMAC_LOOPBACK_NONE	0
 #define STMMAC_LOOPBACK_MAC	1
 #define STMMAC_LOOPBACK_PHY	2
@@ -1952,6 +2297,14 @@ static const struct stmmac_test {
 		.name = "TBS (ETF Scheduler)        ",
 		.lb = STMMAC_LOOPBACK_PHY,
 		.fn = stmmac_test_tbs,
+	}, {
+		.name = "TSO Benchmark              ",
+		.lb = STMMAC_LOOPBACK_PHY,
+		.fn = stmmac_test_tso_bench,
+	}, {
+		.name = "Loopback Benchmark         ",
+		.lb = STMMAC_LOOPBACK_PHY,
+		.fn = stmmac_test_lb_bench,
 	},
 };
 
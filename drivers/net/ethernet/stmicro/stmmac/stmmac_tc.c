@@ -149,6 +149,7 @@ static int tc_fill_entry(struct stmmac_priv *priv,
 		frag->val.frame_offset = real_off + 1;
 		frag->prio = prio;
 		frag->is_frag = true;
+		frag->frag_ptr = NULL;
 	} else {
 		entry->frag_ptr = NULL;
 		entry->val.match_en = mask;
@@ -335,6 +336,12 @@ static int tc_init(struct stmmac_priv *priv)
 
 	tc_fill_all_pass_entry(&priv->tc_entries[count - 1]);
 
+	priv->ntuple_entries = devm_kcalloc(priv->device, STMMAC_NTUPLE_MAX,
+					    sizeof(*priv->ntuple_entries),
+					    GFP_KERNEL);
+	if (!priv->ntuple_entries)
+		return -ENOMEM;
+
 	dev_info(priv->device, "Enabling HW TC (entries=%d, max_off=%d)\n",
 			priv->tc_entries_max, priv->tc_off_max);
 
@@ -989,6 +996,34 @@ struct timespec64 stmmac_calc_tas_basetime(ktime_t old_base_time,
 	return time;
 }
 
+/* Time left to program the admin list before the switch */
+#define STMMAC_EST_SWITCH_MARGIN_NS	NSEC_PER_MSEC
+
+/* With a schedule already running, the admin one takes over at its first
+ * cycle boundary past the end of the current oper cycle, so the oper cycle
+ * is never cut short and the switch is hitless.
+ */
+static struct timespec64 tc_taprio_switch_time(ktime_t base_time,
+					       u64 cycle_time,
+					       ktime_t oper_base_time,
+					       u64 oper_cycle_time,
+					       ktime_t current_time)
+{
+	struct timespec64 oper_end;
+
+	current_time = ktime_add_ns(current_time, STMMAC_EST_SWITCH_MARGIN_NS);
+	if (!oper_cycle_time)
+		return stmmac_calc_tas_basetime(base_time, current_time,
+						cycle_time);
+
+	oper_end = stmmac_calc_tas_basetime(oper_base_time, current_time,
+					    oper_cycle_time);
+
+	return stmmac_calc_tas_basetime(base_time,
+					ktime_sub_ns(timespec64_to_ktime(oper_end), 1),
+					cycle_time);
+}
+
 #define FPE_FMT	"If both EST and FPE are enabled, TxQ0 must not be express "\
 		"queue. So, changing TxQ0 setting to preemptible queue.\n"
 static int tc_setup_taprio(struct stmmac_priv *priv,
@@ -999,10 +1034,10 @@ static int tc_setup_taprio(struct stmmac_priv *priv,
 	struct plat_stmmacenet_data *plat = priv->plat;
 	struct timespec64 time, current_time, qopt_time;
 	u32 txqpec = priv->plat->fpe_cfg->txqpec;
-	ktime_t current_time_ns;
+	ktime_t current_time_ns, oper_base_time = 0;
+	u64 ctr, oper_cycle_time = 0;
 	bool fpe = false;
 	int i, ret = 0;
-	u64 ctr;
 
 	if (!priv->dma_cap.estsel)
 		return -EOPNOTSUPP;
@@ -1050,6 +1085,30 @@ static int tc_setup_taprio(struct stmmac_priv *priv,
 	if (qopt->cycle_time_extension >= BIT(wid + 7))
 		return -ERANGE;
 
+	/* Reject the admin list before touching the oper one */
+	for (i = 0; i < qopt->num_entries; i++) {
+		if (qopt->entries[i].interval > GENMASK(wid, 0))
+			return -ERANGE;
+		if (qopt->entries[i].gate_mask > GENMASK(31 - wid, 0))
+			return -ERANGE;
+
+		switch (qopt->entries[i].command) {
+		case TC_TAPRIO_CMD_SET_GATES:
+			if (fpe)
+				return -EINVAL;
+			break;
+		case TC_TAPRIO_CMD_SET_AND_HOLD:
+		case TC_TAPRIO_CMD_SET_AND_RELEASE:
+			fpe = true;
+			break;
+		default:
+			return -EOPNOTSUPP;
+		}
+	}
+
+	if (fpe && !priv->dma_cap.fpesel)
+		return -EOPNOTSUPP;
+
 	if (!plat->est) {
 		plat->est = devm_kzalloc(priv->device, sizeof(*plat->est),
 					 GFP_KERNEL);
@@ -1058,6 +1117,13 @@ static int tc_setup_taprio(struct stmmac_priv *priv,
 
 		mutex_init(&priv->plat->est->lock);
 	} else {
+		if (plat->est->enable) {
+			oper_base_time = ktime_set(plat->est->btr[1],
+						   plat->est->btr[0]);
+			oper_cycle_time = (u64)plat->est->ctr[1] * NSEC_PER_SEC +
+					  plat->est->ctr[0];
+		}
+
 		memset(plat->est, 0, sizeof(*plat->est));
 	}
 
@@ -1072,27 +1138,10 @@ static int tc_setup_taprio(struct stmmac_priv *priv,
 		s64 delta_ns = qopt->entries[i].interval;
 		u32 gates = qopt->entries[i].gate_mask;
 
-		if (delta_ns > GENMASK(wid, 0))
-			return -ERANGE;
-		if (gates > GENMASK(31 - wid, 0))
-			return -ERANGE;
-
-		switch (qopt->entries[i].command) {
-		case TC_TAPRIO_CMD_SET_GATES:
-			if (fpe)
-				return -EINVAL;
-			break;
-		case TC_TAPRIO_CMD_SET_AND_HOLD:
+		if (qopt->entries[i].command == TC_TAPRIO_CMD_SET_AND_HOLD)
 			gates |= BIT(0);
-			fpe = true;
-			break;
-		case TC_TAPRIO_CMD_SET_AND_RELEASE:
+		else if (qopt->entries[i].command == TC_TAPRIO_CMD_SET_AND_RELEASE)
 			gates &= ~BIT(0);
-			fpe = true;
-			break;
-		default:
-			return -EOPNOTSUPP;
-		}
 
 		priv->plat->est->gcl[i] = delta_ns | (gates << wid);
 		priv->plat->est->ti_ns[i] = delta_ns;
@@ -1103,8 +1152,9 @@ static int tc_setup_taprio(struct stmmac_priv *priv,
 	/* Adjust for real system time */
 	priv->ptp_clock_ops.gettime64(&priv->ptp_clock_ops, &current_time);
 	current_time_ns = timespec64_to_ktime(current_time);
-	time = stmmac_calc_tas_basetime(qopt->base_time, current_time_ns,
-					qopt->cycle_time);
+	time = tc_taprio_switch_time(qopt->base_time, qopt->cycle_time,
+				     oper_base_time, oper_cycle_time,
+				     current_time_ns);
 
 	priv->plat->est->btr[0] = (u32)time.tv_nsec;
 	priv->plat->est->btr[1] = (u32)time.tv_sec;
@@ -1128,11 +1178,6 @@ static int tc_setup_taprio(struct stmmac_priv *priv,
 			plat->est->max_sdu[i] = 0;
 	}
 
-	if (fpe && !priv->dma_cap.fpesel) {
-		mutex_unlock(&priv->plat->est->lock);
-		return -EOPNOTSUPP;
-	}
-
 	if (fpe) {
 		if (!txqpec) {
 			netdev_err(priv->dev, "FPE preempt must not all 0s!\n");
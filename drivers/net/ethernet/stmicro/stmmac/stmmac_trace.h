@@ -0,0 +1,86 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * Tracepoints of the AF_XDP zero-copy path.
+ *
+ * The submit and completion events of a queue give the XSK TX completion
+ * latency, the refill and wakeup ones show what keeps the queue busy.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM	stmmac
+
+#if !defined(_STMMAC_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _STMMAC_TRACE_H
+
+#include <linux/netdevice.h>
+#include <linux/tracepoint.h>
+
+DECLARE_EVENT_CLASS(stmmac_xsk_frames,
+
+	TP_PROTO(const struct net_device *dev, u32 queue, u32 frames),
+
+	TP_ARGS(dev, queue, frames),
+
+	TP_STRUCT__entry(
+		__string(name, netdev_name(dev))
+		__field(u32, queue)
+		__field(u32, frames)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, netdev_name(dev));
+		__entry->queue = queue;
+		__entry->frames = frames;
+	),
+
+	TP_printk("dev %s queue %u frames %u",
+		  __get_str(name), __entry->queue, __entry->frames)
+);
+
+DEFINE_EVENT(stmmac_xsk_frames, stmmac_xsk_tx_submit,
+	     TP_PROTO(const struct net_device *dev, u32 queue, u32 frames),
+	     TP_ARGS(dev, queue, frames));
+
+DEFINE_EVENT(stmmac_xsk_frames, stmmac_xsk_tx_complete,
+	     TP_PROTO(const struct net_device *dev, u32 queue, u32 frames),
+	     TP_ARGS(dev, queue, frames));
+
+DEFINE_EVENT(stmmac_xsk_frames, stmmac_xsk_rx_fill_empty,
+	     TP_PROTO(const struct net_device *dev, u32 queue, u32 frames),
+	     TP_ARGS(dev, queue, frames));
+
+TRACE_EVENT(stmmac_xsk_wakeup,
+
+	TP_PROTO(const struct net_device *dev, u32 queue, u32 flags,
+		 bool missed),
+
+	TP_ARGS(dev, queue, flags, missed),
+
+	TP_STRUCT__entry(
+		__string(name, netdev_name(dev))
+		__field(u32, queue)
+		__field(u32, flags)
+		__field(bool, missed)
+	),
+
+	TP_fast_assign(
+		__assign_str(name, netdev_name(dev));
+		__entry->queue = queue;
+		__entry->flags = flags;
+		__entry->missed = missed;
+	),
+
+	TP_printk("dev %s queue %u flags 0x%x%s",
+		  __get_str(name), __entry->queue, __entry->flags,
+		  __entry->missed ? " missed" : "")
+);
+
+#endif /* _STMMAC_TRACE_H */
+
+/* We don't want to use include/trace/events */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE	stmmac_trace
+/* This part must be outside protection */
+#include <trace/define_trace.h>
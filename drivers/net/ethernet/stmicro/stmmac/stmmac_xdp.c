@@ -109,11 +109,11 @@ int stmmac_xdp_set_prog(struct stmmac_priv *priv, struct bpf_prog *prog,
 
 	if_running = netif_running(dev);
 
-	if (prog && dev->mtu > ETH_DATA_LEN) {
-		/* For now, the driver doesn't support XDP functionality with
-		 * jumbo frames so we return error.
+	if (prog && dev->mtu > ETH_DATA_LEN && !prog->aux->xdp_has_frags) {
+		/* Jumbo frames span several RX buffers, which only programs
+		 * handling multi-buffer xdp_buffs can cope with.
 		 */
-		NL_SET_ERR_MSG_MOD(extack, "Jumbo frames not supported");
+		NL_SET_ERR_MSG_MOD(extack, "Jumbo frames need a frags aware program");
 		return -EOPNOTSUPP;
 	}
 
@@ -128,8 +128,10 @@ int stmmac_xdp_set_prog(struct stmmac_priv *priv, struct bpf_prog *prog,
 	/* Disable RX SPH for XDP operation */
 	priv->sph = priv->sph_cap && !stmmac_xdp_is_enabled(priv);
 
-	if (if_running && need_update)
+	if (if_running && need_update) {
+		stmmac_xdp_txq_update(priv);
 		stmmac_xdp_open(dev);
+	}
 
 	return 0;
 }
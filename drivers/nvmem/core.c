@@ -6,6 +6,7 @@
  * Copyright (C) 2013 Maxime Ripard <maxime.ripard@free-electrons.com>
  */
 
+#include <linux/bitmap.h>
 #include <linux/device.h>
 #include <linux/export.h>
 #include <linux/fs.h>
@@ -13,6 +14,7 @@
 #include <linux/init.h>
 #include <linux/kref.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/nvmem-consumer.h>
 #include <linux/nvmem-provider.h>
 #include <linux/gpio/consumer.h>
@@ -40,6 +42,12 @@ struct nvmem_device {
 	nvmem_reg_write_t	reg_write;
 	nvmem_cell_post_process_t cell_post_process;
 	struct gpio_desc	*wp_gpio;
+	/* Content of an immutable device, one bit per word once read */
+	u8			*cache;
+	unsigned long		*cache_valid;
+	/* Bumped by every write, reads started before one aren't cached */
+	unsigned int		cache_gen;
+	struct mutex		cache_lock;
 	void *priv;
 };
 
@@ -161,22 +169,109 @@ static int nvmem_access_with_keepouts(struct nvmem_device *nvmem,
 	return 0;
 }
 
+static bool nvmem_cache_read(struct nvmem_device *nvmem, unsigned int offset,
+			     void *val, size_t bytes, unsigned int *gen)
+{
+	unsigned int first = offset / nvmem->word_size;
+	unsigned int end = DIV_ROUND_UP(offset + bytes, nvmem->word_size);
+	bool hit;
+
+	mutex_lock(&nvmem->cache_lock);
+	hit = find_next_zero_bit(nvmem->cache_valid, end, first) >= end;
+	if (hit)
+		memcpy(val, nvmem->cache + offset, bytes);
+	*gen = nvmem->cache_gen;
+	mutex_unlock(&nvmem->cache_lock);
+
+	return hit;
+}
+
+/* Only the words read in full, and while nothing was written, are cached */
+static void nvmem_cache_fill(struct nvmem_device *nvmem, unsigned int offset,
+			     const void *val, size_t bytes, unsigned int gen)
+{
+	unsigned int first = DIV_ROUND_UP(offset, nvmem->word_size);
+	unsigned int end = (offset + bytes) / nvmem->word_size;
+	unsigned int start = first * nvmem->word_size;
+
+	if (first >= end)
+		return;
+
+	mutex_lock(&nvmem->cache_lock);
+	if (gen == nvmem->cache_gen) {
+		memcpy(nvmem->cache + start, val + (start - offset),
+		       (end - first) * nvmem->word_size);
+		bitmap_set(nvmem->cache_valid, first, end - first);
+	}
+	mutex_unlock(&nvmem->cache_lock);
+}
+
+static void nvmem_cache_invalidate(struct nvmem_device *nvmem,
+				   unsigned int offset, size_t bytes)
+{
+	unsigned int first = offset / nvmem->word_size;
+	unsigned int end = DIV_ROUND_UP(offset + bytes, nvmem->word_size);
+
+	mutex_lock(&nvmem->cache_lock);
+	bitmap_clear(nvmem->cache_valid, first, end - first);
+	nvmem->cache_gen++;
+	mutex_unlock(&nvmem->cache_lock);
+}
+
 static int nvmem_reg_read(struct nvmem_device *nvmem, unsigned int offset,
 			  void *val, size_t bytes)
 {
+	bool cached = nvmem->cache && offset + bytes <= nvmem->size;
+	unsigned int gen = 0;
+	int rc;
+
+	if (cached && nvmem_cache_read(nvmem, offset, val, bytes, &gen))
+		return 0;
+
 	if (!nvmem->nkeepout)
-		return __nvmem_reg_read(nvmem, offset, val, bytes);
+		rc = __nvmem_reg_read(nvmem, offset, val, bytes);
+	else
+		rc = nvmem_access_with_keepouts(nvmem, offset, val, bytes,
+						false);
+
+	if (!rc && cached)
+		nvmem_cache_fill(nvmem, offset, val, bytes, gen);
 
-	return nvmem_access_with_keepouts(nvmem, offset, val, bytes, false);
+	return rc;
 }
 
 static int nvmem_reg_write(struct nvmem_device *nvmem, unsigned int offset,
 			   void *val, size_t bytes)
 {
+	int rc;
+
 	if (!nvmem->nkeepout)
-		return __nvmem_reg_write(nvmem, offset, val, bytes);
+		rc = __nvmem_reg_write(nvmem, offset, val, bytes);
+	else
+		rc = nvmem_access_with_keepouts(nvmem, offset, val, bytes,
+						true);
+
+	/*
+	 * Programming an OTP word changes what reads back.  The words are
+	 * invalidated once written, even partly, and reads which started
+	 * before that don't fill the cache.
+	 */
+	if (nvmem->cache && offset + bytes <= nvmem->size)
+		nvmem_cache_invalidate(nvmem, offset, bytes);
+
+	return rc;
+}
 
-	return nvmem_access_with_keepouts(nvmem, offset, val, bytes, true);
+static int nvmem_cache_init(struct nvmem_device *nvmem)
+{
+	nvmem->cache = kzalloc(nvmem->size, GFP_KERNEL);
+	nvmem->cache_valid = bitmap_zalloc(DIV_ROUND_UP(nvmem->size,
+							nvmem->word_size),
+					   GFP_KERNEL);
+	if (!nvmem->cache || !nvmem->cache_valid)
+		return -ENOMEM;
+
+	return 0;
 }
 
 #ifdef CONFIG_NVMEM_SYSFS
@@ -418,6 +513,8 @@ static void nvmem_release(struct device *dev)
 
 	ida_free(&nvmem_ida, nvmem->id);
 	gpiod_put(nvmem->wp_gpio);
+	bitmap_free(nvmem->cache_valid);
+	kfree(nvmem->cache);
 	kfree(nvmem);
 }
 
@@ -789,6 +886,7 @@ struct nvmem_device *nvmem_register(const struct nvmem_config *config)
 
 	kref_init(&nvmem->refcnt);
 	INIT_LIST_HEAD(&nvmem->cells);
+	mutex_init(&nvmem->cache_lock);
 
 	nvmem->owner = config->owner;
 	if (!nvmem->owner && config->dev->driver)
@@ -839,6 +937,12 @@ struct nvmem_device *nvmem_register(const struct nvmem_config *config)
 			goto err_put_device;
 	}
 
+	if (config->immutable && nvmem->size) {
+		rval = nvmem_cache_init(nvmem);
+		if (rval)
+			goto err_put_device;
+	}
+
 	if (config->compat) {
 		rval = nvmem_sysfs_setup_compat(nvmem, config);
 		if (rval)
@@ -221,6 +221,7 @@ static int imx_scu_ocotp_write(void *context, unsigned int offset,
 static struct nvmem_config imx_scu_ocotp_nvmem_config = {
 	.name = "imx-scu-ocotp",
 	.read_only = false,
+	.immutable = true,
 	.word_size = 4,
 	.stride = 1,
 	.owner = THIS_MODULE,
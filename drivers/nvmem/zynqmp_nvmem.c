@@ -39,6 +39,7 @@ static struct nvmem_config econfig = {
 	.word_size = 1,
 	.size = 1,
 	.read_only = true,
+	.immutable = true,
 };
 
 static const struct of_device_id zynqmp_nvmem_match[] = {
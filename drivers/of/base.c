@@ -192,11 +192,15 @@ static struct property *__of_find_property(const struct device_node *np,
 					   const char *name, int *lenp)
 {
 	struct property *pp;
+	unsigned int hash;
 
 	if (!np)
 		return NULL;
 
+	hash = of_prop_hash(name);
 	for (pp = np->properties; pp; pp = pp->next) {
+		if (pp->name_hash && hash && pp->name_hash != hash)
+			continue;
 		if (of_prop_cmp(pp->name, name) == 0) {
 			if (lenp)
 				*lenp = pp->length;
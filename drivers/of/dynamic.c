@@ -398,6 +398,7 @@ struct property *__of_prop_dup(const struct property *prop, gfp_t allocflags)
 	new->length = prop->length;
 	if (!new->name || !new->value)
 		goto err_free;
+	new->name_hash = of_prop_hash(new->name);
 
 	/* mark the property as dynamic */
 	of_property_set_flag(new, OF_DYNAMIC);
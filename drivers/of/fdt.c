@@ -165,6 +165,7 @@ static void populate_properties(const void *blob,
 		pp->name   = (char *)pname;
 		pp->length = sz;
 		pp->value  = (__be32 *)val;
+		pp->name_hash = of_prop_hash(pname);
 		*pprev     = pp;
 		pprev      = &pp->next;
 	}
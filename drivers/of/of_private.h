@@ -172,4 +172,23 @@ void fdt_init_reserved_mem(void);
 void fdt_reserved_mem_save_node(unsigned long node, const char *uname,
 			       phys_addr_t base, phys_addr_t size);
 
+/*
+ * Hash of a property name, checked by __of_find_property() before comparing
+ * the names themselves.  Never 0, which is left for properties created
+ * without one.  Names are compared case insensitively on SPARC, where it is
+ * disabled.
+ */
+static inline unsigned int of_prop_hash(const char *name)
+{
+	unsigned int hash = 2166136261U;
+
+	if (IS_ENABLED(CONFIG_SPARC))
+		return 0;
+
+	while (*name)
+		hash = (hash ^ (unsigned char)*name++) * 16777619U;
+
+	return hash ?: 1;
+}
+
 #endif /* _LINUX_OF_PRIVATE_H */
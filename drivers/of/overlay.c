@@ -65,6 +65,7 @@ struct fragment {
  * @fragments:		fragment nodes in the overlay expanded device tree
  * @symbols_fragment:	last element of @fragments[] is the  __symbols__ node
  * @cset:		changeset to apply fragments to live device tree
+ * @prepared:		resolved by of_overlay_fdt_prepare(), kept on removal
  */
 struct overlay_changeset {
 	int id;
@@ -77,6 +78,7 @@ struct overlay_changeset {
 	struct fragment *fragments;
 	bool symbols_fragment;
 	struct of_changeset cset;
+	bool prepared;
 };
 
 /* flags are sticky - once set, do not reset */
@@ -251,6 +253,7 @@ static struct property *dup_and_fixup_symbol_prop(
 	new_prop->value = kzalloc(new_prop->length, GFP_KERNEL);
 	if (!new_prop->name || !new_prop->value)
 		goto err_free_new_prop;
+	new_prop->name_hash = of_prop_hash(new_prop->name);
 
 	strcpy(new_prop->value, target_path);
 	strcpy(new_prop->value + target_path_len, path_tail);
@@ -902,13 +905,16 @@ static int of_overlay_apply(struct overlay_changeset *ovcs)
 {
 	int ret = 0, ret_revert, ret_tmp;
 
-	ret = of_resolve_phandles(ovcs->overlay_root);
-	if (ret)
-		goto out;
+	/* a prepared overlay was resolved and initialized once and for all */
+	if (!ovcs->prepared) {
+		ret = of_resolve_phandles(ovcs->overlay_root);
+		if (ret)
+			goto out;
 
-	ret = init_overlay_changeset(ovcs);
-	if (ret)
-		goto out;
+		ret = init_overlay_changeset(ovcs);
+		if (ret)
+			goto out;
+	}
 
 	ret = overlay_notify(ovcs, OF_OVERLAY_PRE_APPLY);
 	if (ret)
@@ -964,18 +970,8 @@ static int of_overlay_apply(struct overlay_changeset *ovcs)
  * the caller should call of_overlay_remove() with the value in *@ret_ovcs_id.
  */
 
-int of_overlay_fdt_apply(const void *overlay_fdt, u32 overlay_fdt_size,
-			 int *ret_ovcs_id)
+static int overlay_fdt_check(const void *overlay_fdt, u32 overlay_fdt_size)
 {
-	void *new_fdt;
-	void *new_fdt_align;
-	void *overlay_mem;
-	int ret;
-	u32 size;
-	struct overlay_changeset *ovcs;
-
-	*ret_ovcs_id = 0;
-
 	if (devicetree_corrupt()) {
 		pr_err("devicetree state suspect, refuse to apply overlay\n");
 		return -EBUSY;
@@ -987,16 +983,24 @@ int of_overlay_fdt_apply(const void *overlay_fdt, u32 overlay_fdt_size,
 		return -EINVAL;
 	}
 
-	size = fdt_totalsize(overlay_fdt);
-	if (overlay_fdt_size < size)
+	if (overlay_fdt_size < fdt_totalsize(overlay_fdt))
 		return -EINVAL;
 
-	ovcs = kzalloc(sizeof(*ovcs), GFP_KERNEL);
-	if (!ovcs)
-		return -ENOMEM;
+	return 0;
+}
 
-	of_overlay_mutex_lock();
-	mutex_lock(&of_mutex);
+/*
+ * Allocate the id of @ovcs and unflatten @overlay_fdt into it.  Must be
+ * called with the overlay and of_mutex locks held.  On error return, the
+ * caller must call free_overlay_changeset().
+ */
+static int overlay_fdt_unflatten(struct overlay_changeset *ovcs,
+				 const void *overlay_fdt)
+{
+	void *new_fdt;
+	void *new_fdt_align;
+	void *overlay_mem;
+	u32 size = fdt_totalsize(overlay_fdt);
 
 	/*
 	 * ovcs->notify_state must be set to OF_OVERLAY_INIT before allocating
@@ -1004,13 +1008,10 @@ int of_overlay_fdt_apply(const void *overlay_fdt, u32 overlay_fdt_size,
 	 */
 
 	ovcs->id = idr_alloc(&ovcs_idr, ovcs, 1, 0, GFP_KERNEL);
-	if (ovcs->id <= 0) {
-		ret = ovcs->id;
-		goto err_free_ovcs;
-	}
+	if (ovcs->id <= 0)
+		return ovcs->id;
 
 	INIT_LIST_HEAD(&ovcs->ovcs_list);
-	list_add_tail(&ovcs->ovcs_list, &ovcs_list);
 	of_changeset_init(&ovcs->cset);
 
 	/*
@@ -1018,10 +1019,8 @@ int of_overlay_fdt_apply(const void *overlay_fdt, u32 overlay_fdt_size,
 	 * will create pointers to the passed in FDT in the unflattened tree.
 	 */
 	new_fdt = kmalloc(size + FDT_ALIGN_SIZE, GFP_KERNEL);
-	if (!new_fdt) {
-		ret = -ENOMEM;
-		goto err_free_ovcs;
-	}
+	if (!new_fdt)
+		return -ENOMEM;
 	ovcs->new_fdt = new_fdt;
 
 	new_fdt_align = PTR_ALIGN(new_fdt, FDT_ALIGN_SIZE);
@@ -1031,11 +1030,38 @@ int of_overlay_fdt_apply(const void *overlay_fdt, u32 overlay_fdt_size,
 					    &ovcs->overlay_root);
 	if (!overlay_mem) {
 		pr_err("unable to unflatten overlay_fdt\n");
-		ret = -EINVAL;
-		goto err_free_ovcs;
+		return -EINVAL;
 	}
 	ovcs->overlay_mem = overlay_mem;
 
+	return 0;
+}
+
+int of_overlay_fdt_apply(const void *overlay_fdt, u32 overlay_fdt_size,
+			 int *ret_ovcs_id)
+{
+	int ret;
+	struct overlay_changeset *ovcs;
+
+	*ret_ovcs_id = 0;
+
+	ret = overlay_fdt_check(overlay_fdt, overlay_fdt_size);
+	if (ret)
+		return ret;
+
+	ovcs = kzalloc(sizeof(*ovcs), GFP_KERNEL);
+	if (!ovcs)
+		return -ENOMEM;
+
+	of_overlay_mutex_lock();
+	mutex_lock(&of_mutex);
+
+	ret = overlay_fdt_unflatten(ovcs, overlay_fdt);
+	if (ret)
+		goto err_free_ovcs;
+
+	list_add_tail(&ovcs->ovcs_list, &ovcs_list);
+
 	ret = of_overlay_apply(ovcs);
 	/*
 	 * If of_overlay_apply() error, calling free_overlay_changeset() may
@@ -1056,6 +1082,188 @@ int of_overlay_fdt_apply(const void *overlay_fdt, u32 overlay_fdt_size,
 }
 EXPORT_SYMBOL_GPL(of_overlay_fdt_apply);
 
+/**
+ * of_overlay_fdt_prepare() - Create an overlay changeset to apply later
+ * @overlay_fdt:	pointer to overlay FDT
+ * @overlay_fdt_size:	number of bytes in @overlay_fdt
+ * @ret_ovcs_id:	pointer for returning created changeset id
+ *
+ * Unflattens @overlay_fdt, resolves its phandles against the live tree and
+ * looks up the targets of its fragments, without applying it.  The changeset
+ * can then be applied with of_overlay_apply_prepared() and removed with
+ * of_overlay_remove() any number of times, only the changeset entries being
+ * rebuilt on each application, until it is freed with of_overlay_release().
+ *
+ * Return: 0 on success, or a negative error number.  *@ret_ovcs_id is set to
+ * the value of overlay changeset id on success.
+ */
+int of_overlay_fdt_prepare(const void *overlay_fdt, u32 overlay_fdt_size,
+			   int *ret_ovcs_id)
+{
+	int ret;
+	struct overlay_changeset *ovcs;
+
+	*ret_ovcs_id = 0;
+
+	ret = overlay_fdt_check(overlay_fdt, overlay_fdt_size);
+	if (ret)
+		return ret;
+
+	ovcs = kzalloc(sizeof(*ovcs), GFP_KERNEL);
+	if (!ovcs)
+		return -ENOMEM;
+
+	of_overlay_mutex_lock();
+	mutex_lock(&of_mutex);
+
+	ret = overlay_fdt_unflatten(ovcs, overlay_fdt);
+	if (ret)
+		goto err_free_ovcs;
+
+	ret = of_resolve_phandles(ovcs->overlay_root);
+	if (ret)
+		goto err_free_ovcs;
+
+	ret = init_overlay_changeset(ovcs);
+	if (ret)
+		goto err_free_ovcs;
+
+	ovcs->prepared = true;
+	*ret_ovcs_id = ovcs->id;
+	goto out_unlock;
+
+err_free_ovcs:
+	free_overlay_changeset(ovcs);
+
+out_unlock:
+	mutex_unlock(&of_mutex);
+	of_overlay_mutex_unlock();
+	return ret;
+}
+EXPORT_SYMBOL_GPL(of_overlay_fdt_prepare);
+
+/*
+ * The phandles of a prepared overlay were allocated above the ones of the
+ * live tree at the time it was resolved.  Another overlay resolved while this
+ * one was not applied may have been given the same ones.
+ */
+static int overlay_prepared_is_ok(struct overlay_changeset *ovcs)
+{
+	struct device_node *np, *live;
+	int i;
+
+	for (i = 0; i < ovcs->count; i++) {
+		if (of_node_check_flag(ovcs->fragments[i].target,
+				       OF_DETACHED)) {
+			pr_err("overlay #%d target %pOF was removed\n",
+			       ovcs->id, ovcs->fragments[i].target);
+			return 0;
+		}
+	}
+
+	for_each_of_allnodes_from(ovcs->overlay_root, np) {
+		if (!np->phandle)
+			continue;
+
+		live = of_find_node_by_phandle(np->phandle);
+		of_node_put(live);
+		if (live) {
+			pr_err("overlay #%d phandle 0x%x is in use by %pOF\n",
+			       ovcs->id, np->phandle, live);
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/**
+ * of_overlay_apply_prepared() - Apply a prepared overlay changeset
+ * @ovcs_id:	changeset id returned by of_overlay_fdt_prepare()
+ *
+ * See of_overlay_apply() for important behavior information.
+ *
+ * Return: 0 on success, or a negative error number.  -EBUSY is returned if
+ * the changeset is already applied, or if its phandles are now used by the
+ * live tree, in which case it must be released and prepared again.
+ *
+ * On error return, the changeset may be partially applied, and the caller
+ * should call of_overlay_remove() as for of_overlay_fdt_apply().
+ */
+int of_overlay_apply_prepared(int ovcs_id)
+{
+	struct overlay_changeset *ovcs;
+	int ret;
+
+	if (devicetree_corrupt()) {
+		pr_err("devicetree state suspect, refuse to apply overlay\n");
+		return -EBUSY;
+	}
+
+	of_overlay_mutex_lock();
+	mutex_lock(&of_mutex);
+
+	ovcs = idr_find(&ovcs_idr, ovcs_id);
+	if (!ovcs || !ovcs->prepared) {
+		ret = -ENODEV;
+		pr_err("apply: Could not find prepared overlay #%d\n", ovcs_id);
+		goto out_unlock;
+	}
+
+	if (!list_empty(&ovcs->ovcs_list) || !overlay_prepared_is_ok(ovcs)) {
+		ret = -EBUSY;
+		goto out_unlock;
+	}
+
+	list_add_tail(&ovcs->ovcs_list, &ovcs_list);
+
+	ret = of_overlay_apply(ovcs);
+
+out_unlock:
+	mutex_unlock(&of_mutex);
+	of_overlay_mutex_unlock();
+	return ret;
+}
+EXPORT_SYMBOL_GPL(of_overlay_apply_prepared);
+
+/**
+ * of_overlay_release() - Free a prepared overlay changeset
+ * @ovcs_id:	Pointer to changeset id returned by of_overlay_fdt_prepare()
+ *
+ * The changeset must have been removed first if it was applied.
+ *
+ * Return: 0 on success, or a negative error number.  *@ovcs_id is set to
+ * zero on success.
+ */
+int of_overlay_release(int *ovcs_id)
+{
+	struct overlay_changeset *ovcs;
+	int ret = 0;
+
+	mutex_lock(&of_mutex);
+
+	ovcs = idr_find(&ovcs_idr, *ovcs_id);
+	if (!ovcs || !ovcs->prepared) {
+		ret = -ENODEV;
+		pr_err("release: Could not find prepared overlay #%d\n",
+		       *ovcs_id);
+		goto out_unlock;
+	}
+
+	if (!list_empty(&ovcs->ovcs_list)) {
+		ret = -EBUSY;
+		goto out_unlock;
+	}
+
+	*ovcs_id = 0;
+	free_overlay_changeset(ovcs);
+
+out_unlock:
+	mutex_unlock(&of_mutex);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(of_overlay_release);
+
 /*
  * Find @np in @tree.
  *
@@ -1170,6 +1378,9 @@ static int overlay_removal_is_ok(struct overlay_changeset *remove_ovcs)
  *
  * Return: 0 on success, or a negative error number.  *@ovcs_id is set to
  * zero after reverting the changeset, even if a subsequent error occurs.
+ * A changeset created by of_overlay_fdt_prepare() is not freed and keeps its
+ * id, so that it can be applied again.  Removing it while it is not applied
+ * returns -ENODEV.
  */
 int of_overlay_remove(int *ovcs_id)
 {
@@ -1191,6 +1402,17 @@ int of_overlay_remove(int *ovcs_id)
 		goto err_unlock;
 	}
 
+	/*
+	 * A prepared changeset only counts as an overlay while applied. Once
+	 * removed, its id is only good for applying or releasing it, or the
+	 * remove notifiers would run again for an overlay which is gone.
+	 */
+	if (ovcs->prepared && list_empty(&ovcs->ovcs_list)) {
+		ret = -ENODEV;
+		pr_err("remove: overlay #%d is not applied\n", *ovcs_id);
+		goto err_unlock;
+	}
+
 	if (!overlay_removal_is_ok(ovcs)) {
 		ret = -EBUSY;
 		goto err_unlock;
@@ -1213,7 +1435,8 @@ int of_overlay_remove(int *ovcs_id)
 		pr_err("overlay remove changeset entry notify error %d\n", ret);
 	/* notify failure is not fatal, continue */
 
-	*ovcs_id = 0;
+	if (!ovcs->prepared)
+		*ovcs_id = 0;
 
 	/*
 	 * Note that the overlay memory will be kfree()ed by
@@ -1225,7 +1448,14 @@ int of_overlay_remove(int *ovcs_id)
 		if (!ret)
 			ret = ret_tmp;
 
-	free_overlay_changeset(ovcs);
+	if (ovcs->prepared) {
+		/* keep the overlay tree, rebuild the entries on next apply */
+		list_del_init(&ovcs->ovcs_list);
+		of_changeset_destroy(&ovcs->cset);
+		of_changeset_init(&ovcs->cset);
+	} else {
+		free_overlay_changeset(ovcs);
+	}
 
 err_unlock:
 	/*
@@ -1504,6 +1504,7 @@ static int __init unittest_data_add(void)
 
 #ifdef CONFIG_OF_OVERLAY
 static int __init overlay_data_apply(const char *overlay_name, int *ovcs_id);
+static int __init overlay_data_prepare(const char *overlay_name, int *ovcs_id);
 
 static int unittest_probe(struct platform_device *pdev)
 {
@@ -2413,6 +2414,42 @@ static void __init of_unittest_overlay_11(void)
 	unittest(ret == 0, "overlay test %d failed; overlay apply\n", 11);
 }
 
+/* apply and remove a prepared overlay twice */
+static void __init of_unittest_overlay_prepared(void)
+{
+	int i, ret, ovcs_id;
+
+	ret = overlay_data_prepare("overlay_5", &ovcs_id);
+	if (unittest(ret == 0, "overlay_5 prepare failed, ret = %d\n", ret))
+		return;
+
+	for (i = 0; i < 2; i++) {
+		EXPECT_BEGIN(KERN_INFO,
+			     "OF: overlay: WARNING: memory leak will occur if overlay removed, property: /testcase-data/overlay-node/test-bus/test-unittest5/status");
+
+		ret = of_overlay_apply_prepared(ovcs_id);
+
+		EXPECT_END(KERN_INFO,
+			   "OF: overlay: WARNING: memory leak will occur if overlay removed, property: /testcase-data/overlay-node/test-bus/test-unittest5/status");
+
+		if (unittest(!ret && of_unittest_device_exists(5, PDEV_OVERLAY),
+			     "prepared overlay_5 apply #%d failed, ret = %d\n",
+			     i, ret))
+			return;
+
+		ret = of_overlay_remove(&ovcs_id);
+		if (unittest(!ret && ovcs_id &&
+			     !of_unittest_device_exists(5, PDEV_OVERLAY),
+			     "prepared overlay_5 remove #%d failed, ret = %d\n",
+			     i, ret))
+			return;
+	}
+
+	ret = of_overlay_release(&ovcs_id);
+	unittest(!ret && !ovcs_id,
+		 "prepared overlay_5 release failed, ret = %d\n", ret);
+}
+
 #if IS_BUILTIN(CONFIG_I2C) && IS_ENABLED(CONFIG_OF_OVERLAY)
 
 struct unittest_i2c_bus_data {
@@ -2975,6 +3012,7 @@ static void __init of_unittest_overlay(void)
 
 	of_unittest_overlay_10();
 	of_unittest_overlay_11();
+	of_unittest_overlay_prepared();
 
 #if IS_BUILTIN(CONFIG_I2C)
 	if (unittest(of_unittest_overlay_i2c_init() == 0, "i2c init failed\n"))
@@ -3226,6 +3264,22 @@ static int __init overlay_data_apply(const char *overlay_name, int *ovcs_id)
 	return (ret == info->expected_result);
 }
 
+static int __init overlay_data_prepare(const char *overlay_name, int *ovcs_id)
+{
+	struct overlay_info *info;
+
+	for (info = overlays; info && info->name; info++)
+		if (!strcmp(overlay_name, info->name))
+			return of_overlay_fdt_prepare(info->dtb_begin,
+						      info->dtb_end -
+						      info->dtb_begin,
+						      ovcs_id);
+
+	pr_err("no overlay data for %s\n", overlay_name);
+
+	return -ENOENT;
+}
+
 /*
  * The purpose of of_unittest_overlay_high_level is to add an overlay
  * in the normal fashion.  This is a test of the whole picture,
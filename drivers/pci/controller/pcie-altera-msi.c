@@ -7,6 +7,7 @@
  * Copyright Altera Corporation (C) 2013-2015. All rights reserved
  */
 
+#include <linux/cpumask.h>
 #include <linux/interrupt.h>
 #include <linux/irqchip/chained_irq.h>
 #include <linux/init.h>
@@ -24,10 +25,32 @@
 #define MSI_INTMASK		0x8
 
 #define MAX_MSI_VECTORS		32
+#define MSI_NO_HWIRQ		MAX_MSI_VECTORS
+#define MSI_NO_VECTOR		MAX_MSI_VECTORS
 
+/*
+ * The vectors may be split evenly between several interrupts, in the order
+ * they are listed, each signalling its own range of the status register.
+ */
+struct altera_msi_parent {
+	struct altera_msi	*msi;
+	int			irq;
+	u32			mask;	/* vectors signalled on irq */
+};
+
+/*
+ * The hwirq of an MSI is fixed while the vector it is signalled on can
+ * change, to follow its affinity to the range of another interrupt.  The
+ * vector it moved from stays mapped until the device is seen using the new
+ * one.
+ */
 struct altera_msi {
 	DECLARE_BITMAP(used, MAX_MSI_VECTORS);
-	struct mutex		lock;	/* protect "used" bitmap */
+	u32			vec_used;	/* bitmap of the vectors mapped */
+	u8			vector[MAX_MSI_VECTORS];	/* of each hwirq */
+	u8			hwirq[MAX_MSI_VECTORS];	/* of each vector */
+	u8			old_vector[MAX_MSI_VECTORS];	/* of each hwirq */
+	raw_spinlock_t		lock;	/* protect the maps and INTMASK */
 	struct platform_device	*pdev;
 	struct irq_domain	*msi_domain;
 	struct irq_domain	*inner_domain;
@@ -35,7 +58,8 @@ struct altera_msi {
 	void __iomem		*vector_base;
 	phys_addr_t		vector_phy;
 	u32			num_of_vectors;
-	int			irq;
+	struct altera_msi_parent	parents[MAX_MSI_VECTORS];
+	unsigned int		num_parents;
 };
 
 static inline void msi_writel(struct altera_msi *msi, const u32 value,
@@ -49,23 +73,34 @@ static inline u32 msi_readl(struct altera_msi *msi, const u32 reg)
 	return readl_relaxed(msi->csr_base + reg);
 }
 
+static void altera_msi_complete_move(struct altera_msi *msi, u32 hwirq,
+				     u32 vector);
+
 static void altera_msi_isr(struct irq_desc *desc)
 {
 	struct irq_chip *chip = irq_desc_get_chip(desc);
+	struct altera_msi_parent *parent;
 	struct altera_msi *msi;
 	unsigned long status;
-	u32 bit;
+	u32 bit, hwirq;
 	int ret;
 
 	chained_irq_enter(chip, desc);
-	msi = irq_desc_get_handler_data(desc);
+	parent = irq_desc_get_handler_data(desc);
+	msi = parent->msi;
 
-	while ((status = msi_readl(msi, MSI_STATUS)) != 0) {
+	while ((status = msi_readl(msi, MSI_STATUS) & parent->mask) != 0) {
 		for_each_set_bit(bit, &status, msi->num_of_vectors) {
 			/* Dummy read from vector to clear the interrupt */
 			readl_relaxed(msi->vector_base + (bit * sizeof(u32)));
 
-			ret = generic_handle_domain_irq(msi->inner_domain, bit);
+			hwirq = READ_ONCE(msi->hwirq[bit]);
+			if (hwirq != MSI_NO_HWIRQ &&
+			    READ_ONCE(msi->old_vector[hwirq]) != MSI_NO_VECTOR)
+				altera_msi_complete_move(msi, hwirq, bit);
+
+			ret = generic_handle_domain_irq(msi->inner_domain,
+							hwirq);
 			if (ret)
 				dev_err_ratelimited(&msi->pdev->dev, "unexpected MSI\n");
 		}
@@ -89,20 +124,159 @@ static struct msi_domain_info altera_msi_domain_info = {
 static void altera_compose_msi_msg(struct irq_data *data, struct msi_msg *msg)
 {
 	struct altera_msi *msi = irq_data_get_irq_chip_data(data);
-	phys_addr_t addr = msi->vector_phy + (data->hwirq * sizeof(u32));
+	u32 vector = msi->vector[data->hwirq];
+	phys_addr_t addr = msi->vector_phy + (vector * sizeof(u32));
 
 	msg->address_lo = lower_32_bits(addr);
 	msg->address_hi = upper_32_bits(addr);
-	msg->data = data->hwirq;
+	msg->data = vector;
 
 	dev_dbg(&msi->pdev->dev, "msi#%d address_hi %#x address_lo %#x\n",
 		(int)data->hwirq, msg->address_hi, msg->address_lo);
 }
 
+static const struct cpumask *
+altera_msi_parent_affinity(struct altera_msi_parent *parent)
+{
+	return irq_data_get_effective_affinity_mask(irq_get_irq_data(parent->irq));
+}
+
+/*
+ * Pick a free vector in the range of an interrupt targeting @mask, the
+ * least used range first.  Called with msi->lock held.
+ */
+static int altera_msi_find_vector(struct altera_msi *msi,
+				  const struct cpumask *mask)
+{
+	struct altera_msi_parent *parent;
+	unsigned long free, best = 0;
+	int i, weight, best_weight = 0;
+
+	for (i = 0; i < msi->num_parents; i++) {
+		parent = &msi->parents[i];
+		if (mask && !cpumask_intersects(mask,
+				altera_msi_parent_affinity(parent)))
+			continue;
+
+		free = ~msi->vec_used & parent->mask;
+		weight = hweight32(free);
+		if (weight > best_weight) {
+			best = free;
+			best_weight = weight;
+		}
+	}
+
+	return best ? __ffs(best) : -ENOSPC;
+}
+
+/* Called with msi->lock held. */
+static void altera_msi_map_vector(struct altera_msi *msi, u32 hwirq,
+				  u32 vector)
+{
+	u32 mask;
+
+	msi->vec_used |= BIT(vector);
+	msi->vector[hwirq] = vector;
+	WRITE_ONCE(msi->hwirq[vector], hwirq);
+
+	mask = msi_readl(msi, MSI_INTMASK);
+	mask |= BIT(vector);
+	msi_writel(msi, mask, MSI_INTMASK);
+}
+
+/* Called with msi->lock held. */
+static void altera_msi_unmap_vector(struct altera_msi *msi, u32 vector)
+{
+	u32 mask;
+
+	mask = msi_readl(msi, MSI_INTMASK);
+	mask &= ~BIT(vector);
+	msi_writel(msi, mask, MSI_INTMASK);
+
+	WRITE_ONCE(msi->hwirq[vector], MSI_NO_HWIRQ);
+	msi->vec_used &= ~BIT(vector);
+}
+
+/* Called with msi->lock held. */
+static void altera_msi_unmap_old_vector(struct altera_msi *msi, u32 hwirq)
+{
+	if (msi->old_vector[hwirq] == MSI_NO_VECTOR)
+		return;
+
+	altera_msi_unmap_vector(msi, msi->old_vector[hwirq]);
+	WRITE_ONCE(msi->old_vector[hwirq], MSI_NO_VECTOR);
+}
+
+/*
+ * An MSI signalled on the vector it moved to shows that the device got the
+ * new message, the vector it moved from can be freed.
+ */
+static void altera_msi_complete_move(struct altera_msi *msi, u32 hwirq,
+				     u32 vector)
+{
+	raw_spin_lock(&msi->lock);
+	if (msi->vector[hwirq] == vector)
+		altera_msi_unmap_old_vector(msi, hwirq);
+	raw_spin_unlock(&msi->lock);
+}
+
+static struct altera_msi_parent *
+altera_msi_vector_parent(struct altera_msi *msi, u32 vector)
+{
+	int i;
+
+	for (i = 0; i < msi->num_parents; i++)
+		if (msi->parents[i].mask & BIT(vector))
+			break;
+
+	return &msi->parents[i];
+}
+
+/*
+ * An MSI follows its affinity by moving to a vector of the interrupt
+ * targeting it, the message written to the device then changes.  The
+ * message is only written once this returns, and the device may still use
+ * the previous one for a while, so the vector moved from is only freed by
+ * altera_msi_complete_move().  Until then, the MSI can't move again.
+ */
 static int altera_msi_set_affinity(struct irq_data *irq_data,
 				   const struct cpumask *mask, bool force)
 {
-	 return -EINVAL;
+	struct altera_msi *msi = irq_data_get_irq_chip_data(irq_data);
+	struct altera_msi_parent *parent;
+	u32 hwirq = irq_data->hwirq;
+	unsigned long flags;
+	int vector, ret = IRQ_SET_MASK_OK_DONE;
+
+	raw_spin_lock_irqsave(&msi->lock, flags);
+
+	vector = msi->vector[hwirq];
+	parent = altera_msi_vector_parent(msi, vector);
+	if (!cpumask_intersects(mask, altera_msi_parent_affinity(parent))) {
+		if (msi->old_vector[hwirq] != MSI_NO_VECTOR) {
+			raw_spin_unlock_irqrestore(&msi->lock, flags);
+			return -EBUSY;
+		}
+
+		vector = altera_msi_find_vector(msi, mask);
+		if (vector < 0) {
+			raw_spin_unlock_irqrestore(&msi->lock, flags);
+			return -EINVAL;
+		}
+
+		/* the vector moved from keeps signalling the MSI for now */
+		WRITE_ONCE(msi->old_vector[hwirq], msi->vector[hwirq]);
+		altera_msi_map_vector(msi, hwirq, vector);
+		parent = altera_msi_vector_parent(msi, vector);
+		ret = IRQ_SET_MASK_OK;
+	}
+
+	irq_data_update_effective_affinity(irq_data,
+					   altera_msi_parent_affinity(parent));
+
+	raw_spin_unlock_irqrestore(&msi->lock, flags);
+
+	return ret;
 }
 
 static struct irq_chip altera_msi_bottom_irq_chip = {
@@ -115,29 +289,37 @@ static int altera_irq_domain_alloc(struct irq_domain *domain, unsigned int virq,
 				   unsigned int nr_irqs, void *args)
 {
 	struct altera_msi *msi = domain->host_data;
-	unsigned long bit;
-	u32 mask;
+	struct altera_msi_parent *parent;
+	const struct cpumask *affinity;
+	unsigned long bit, flags;
+	int vector;
 
 	WARN_ON(nr_irqs != 1);
-	mutex_lock(&msi->lock);
+	raw_spin_lock_irqsave(&msi->lock, flags);
 
 	bit = find_first_zero_bit(msi->used, msi->num_of_vectors);
 	if (bit >= msi->num_of_vectors) {
-		mutex_unlock(&msi->lock);
+		raw_spin_unlock_irqrestore(&msi->lock, flags);
 		return -ENOSPC;
 	}
 
+	/* spread over the interrupts, those targeting the affinity first */
+	affinity = irq_data_get_affinity_mask(irq_get_irq_data(virq));
+	vector = altera_msi_find_vector(msi, affinity);
+	if (vector < 0)
+		vector = altera_msi_find_vector(msi, NULL);
+
 	set_bit(bit, msi->used);
+	altera_msi_map_vector(msi, bit, vector);
+	parent = altera_msi_vector_parent(msi, vector);
 
-	mutex_unlock(&msi->lock);
+	raw_spin_unlock_irqrestore(&msi->lock, flags);
 
 	irq_domain_set_info(domain, virq, bit, &altera_msi_bottom_irq_chip,
 			    domain->host_data, handle_simple_irq,
 			    NULL, NULL);
-
-	mask = msi_readl(msi, MSI_INTMASK);
-	mask |= 1 << bit;
-	msi_writel(msi, mask, MSI_INTMASK);
+	irq_data_update_effective_affinity(irq_domain_get_irq_data(domain, virq),
+					   altera_msi_parent_affinity(parent));
 
 	return 0;
 }
@@ -147,21 +329,20 @@ static void altera_irq_domain_free(struct irq_domain *domain,
 {
 	struct irq_data *d = irq_domain_get_irq_data(domain, virq);
 	struct altera_msi *msi = irq_data_get_irq_chip_data(d);
-	u32 mask;
+	unsigned long flags;
 
-	mutex_lock(&msi->lock);
+	raw_spin_lock_irqsave(&msi->lock, flags);
 
 	if (!test_bit(d->hwirq, msi->used)) {
 		dev_err(&msi->pdev->dev, "trying to free unused MSI#%lu\n",
 			d->hwirq);
 	} else {
 		__clear_bit(d->hwirq, msi->used);
-		mask = msi_readl(msi, MSI_INTMASK);
-		mask &= ~(1 << d->hwirq);
-		msi_writel(msi, mask, MSI_INTMASK);
+		altera_msi_unmap_old_vector(msi, d->hwirq);
+		altera_msi_unmap_vector(msi, msi->vector[d->hwirq]);
 	}
 
-	mutex_unlock(&msi->lock);
+	raw_spin_unlock_irqrestore(&msi->lock, flags);
 }
 
 static const struct irq_domain_ops msi_domain_ops = {
@@ -200,9 +381,12 @@ static void altera_free_domains(struct altera_msi *msi)
 static int altera_msi_remove(struct platform_device *pdev)
 {
 	struct altera_msi *msi = platform_get_drvdata(pdev);
+	int i;
 
 	msi_writel(msi, 0, MSI_INTMASK);
-	irq_set_chained_handler_and_data(msi->irq, NULL, NULL);
+	for (i = 0; i < msi->num_parents; i++)
+		irq_set_chained_handler_and_data(msi->parents[i].irq, NULL,
+						 NULL);
 
 	altera_free_domains(msi);
 
@@ -215,15 +399,17 @@ static int altera_msi_probe(struct platform_device *pdev)
 	struct altera_msi *msi;
 	struct device_node *np = pdev->dev.of_node;
 	struct resource *res;
-	int ret;
+	int i, count, per_irq, ret;
 
 	msi = devm_kzalloc(&pdev->dev, sizeof(struct altera_msi),
 			   GFP_KERNEL);
 	if (!msi)
 		return -ENOMEM;
 
-	mutex_init(&msi->lock);
+	raw_spin_lock_init(&msi->lock);
 	msi->pdev = pdev;
+	memset(msi->hwirq, MSI_NO_HWIRQ, sizeof(msi->hwirq));
+	memset(msi->old_vector, MSI_NO_VECTOR, sizeof(msi->old_vector));
 
 	msi->csr_base = devm_platform_ioremap_resource_byname(pdev, "csr");
 	if (IS_ERR(msi->csr_base)) {
@@ -244,19 +430,48 @@ static int altera_msi_probe(struct platform_device *pdev)
 		return -EINVAL;
 	}
 
+	if (!msi->num_of_vectors || msi->num_of_vectors > MAX_MSI_VECTORS) {
+		dev_err(&pdev->dev, "invalid number of vectors %u\n",
+			msi->num_of_vectors);
+		return -EINVAL;
+	}
+
+	count = platform_irq_count(pdev);
+	if (count < 0)
+		return count;
+	count = clamp_t(int, count, 1, msi->num_of_vectors);
+	per_irq = DIV_ROUND_UP(msi->num_of_vectors, count);
+
 	ret = altera_allocate_domains(msi);
 	if (ret)
 		return ret;
 
-	msi->irq = platform_get_irq(pdev, 0);
-	if (msi->irq < 0) {
-		ret = msi->irq;
-		goto err;
-	}
-
-	irq_set_chained_handler_and_data(msi->irq, altera_msi_isr, msi);
 	platform_set_drvdata(pdev, msi);
 
+	for (i = 0; i < count && i * per_irq < msi->num_of_vectors; i++) {
+		struct altera_msi_parent *parent = &msi->parents[i];
+		u32 last = min(msi->num_of_vectors, (i + 1) * per_irq) - 1;
+
+		parent->irq = platform_get_irq(pdev, i);
+		if (parent->irq < 0) {
+			ret = parent->irq;
+			goto err;
+		}
+
+		parent->msi = msi;
+		parent->mask = GENMASK(last, i * per_irq);
+
+		/* spread the ranges over the CPUs */
+		if (count > 1)
+			irq_set_affinity(parent->irq,
+					 cpumask_of(cpumask_local_spread(i,
+							NUMA_NO_NODE)));
+
+		irq_set_chained_handler_and_data(parent->irq, altera_msi_isr,
+						 parent);
+		msi->num_parents++;
+	}
+
 	return 0;
 
 err:
@@ -7,9 +7,11 @@
  */
 
 #include <linux/delay.h>
+#include <linux/hash.h>
 #include <linux/interrupt.h>
 #include <linux/irqchip/chained_irq.h>
 #include <linux/init.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/of_address.h>
 #include <linux/of_device.h>
@@ -68,6 +70,13 @@
 #define TLP_BYTE_COUNT(s)		(((s) >> 0) & 0xfff)
 #define TLP_HDR_SIZE			3
 #define TLP_LOOP			500
+/*
+ * Completions normally come back within a microsecond: poll without delay
+ * first, then every microsecond up to the TLP_LOOP * 5us allowed.
+ */
+#define TLP_POLL_SPIN			100
+#define TLP_TIMEOUT_NS			(TLP_LOOP * 5 * NSEC_PER_USEC)
+#define TLP_SHADOW_ENTRIES		32
 
 #define LINK_UP_TIMEOUT			HZ
 #define LINK_RETRAIN_TIMEOUT		HZ
@@ -95,6 +104,23 @@ enum altera_pcie_version {
 	ALTERA_PCIE_V3,
 };
 
+/*
+ * Read-only dwords of the configuration header, kept for the devices
+ * reached through TLPs: the PCI core reads them over and over while
+ * enumerating and walking capabilities.
+ */
+static const u8 tlp_shadow_regs[] = {
+	PCI_VENDOR_ID,
+	PCI_CLASS_REVISION,
+	PCI_CAPABILITY_LIST,
+};
+
+struct tlp_shadow {
+	u16			bdf;
+	u8			valid;	/* bitmap of tlp_shadow_regs */
+	u32			val[ARRAY_SIZE(tlp_shadow_regs)];
+};
+
 struct altera_pcie {
 	struct platform_device	*pdev;
 	void __iomem		*cra_base;
@@ -104,6 +130,8 @@ struct altera_pcie {
 	struct irq_domain	*irq_domain;
 	struct resource		bus_range;
 	const struct altera_pcie_data	*pcie_data;
+	/* serialized by pci_lock, as all configuration accesses */
+	struct tlp_shadow	shadow[TLP_SHADOW_ENTRIES];
 };
 
 struct altera_pcie_ops {
@@ -229,13 +257,46 @@ static void s10_tlp_write_tx(struct altera_pcie *pcie, u32 reg0, u32 ctrl)
 	cra_writel(pcie, ctrl, S10_RP_TX_CNTRL);
 }
 
+static struct tlp_shadow *tlp_shadow_lookup(struct altera_pcie *pcie, u8 bus,
+					    u32 devfn, int where, int *reg)
+{
+	u16 bdf = TLP_REQ_ID(bus, devfn);
+	struct tlp_shadow *shadow;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(tlp_shadow_regs); i++)
+		if (where == tlp_shadow_regs[i])
+			break;
+	if (i == ARRAY_SIZE(tlp_shadow_regs))
+		return NULL;
+
+	*reg = i;
+	shadow = &pcie->shadow[hash_32(bdf, ilog2(TLP_SHADOW_ENTRIES))];
+	if (shadow->bdf != bdf) {
+		shadow->bdf = bdf;
+		shadow->valid = 0;
+	}
+
+	return shadow;
+}
+
+static void tlp_shadow_invalidate(struct altera_pcie *pcie)
+{
+	int i;
+
+	for (i = 0; i < TLP_SHADOW_ENTRIES; i++)
+		pcie->shadow[i].valid = 0;
+}
+
 static bool altera_pcie_valid_device(struct altera_pcie *pcie,
 				     struct pci_bus *bus, int dev)
 {
 	/* If there is no link, then there is no device */
 	if (bus->number != pcie->root_bus_nr) {
-		if (!pcie->pcie_data->ops->get_link_status(pcie))
+		if (!pcie->pcie_data->ops->get_link_status(pcie)) {
+			tlp_shadow_invalidate(pcie);
 			return false;
+		}
 	}
 
 	/* access only one slot on each root port */
@@ -245,19 +306,34 @@ static bool altera_pcie_valid_device(struct altera_pcie *pcie,
 	return true;
 }
 
+static bool tlp_poll_wait(unsigned int i, u64 start)
+{
+	if (i < TLP_POLL_SPIN) {
+		cpu_relax();
+		return true;
+	}
+
+	if (ktime_get_ns() - start > TLP_TIMEOUT_NS)
+		return false;
+
+	udelay(1);
+	return true;
+}
+
 static int tlp_read_packet(struct altera_pcie *pcie, u32 *value)
 {
-	int i;
+	unsigned int i;
 	bool sop = false;
 	u32 ctrl;
 	u32 reg0, reg1;
 	u32 comp_status = 1;
+	u64 start = ktime_get_ns();
 
 	/*
 	 * Minimum 2 loops to read TLP headers and 1 loop to read data
 	 * payload.
 	 */
-	for (i = 0; i < TLP_LOOP; i++) {
+	for (i = 0; tlp_poll_wait(i, start); i++) {
 		ctrl = cra_readl(pcie, RP_RXCPL_STATUS);
 		if ((ctrl & RP_RXCPL_SOP) || (ctrl & RP_RXCPL_EOP) || sop) {
 			reg0 = cra_readl(pcie, RP_RXCPL_REG0);
@@ -278,7 +354,6 @@ static int tlp_read_packet(struct altera_pcie *pcie, u32 *value)
 				return PCIBIOS_SUCCESSFUL;
 			}
 		}
-		udelay(5);
 	}
 
 	return PCIBIOS_DEVICE_NOT_FOUND;
@@ -290,21 +365,22 @@ static int s10_tlp_read_packet(struct altera_pcie *pcie, u32 *value)
 	u32 comp_status;
 	u32 dw[4];
 	u32 count;
+	bool sop = false;
+	u64 start = ktime_get_ns();
 	struct device *dev = &pcie->pdev->dev;
 
-	for (count = 0; count < TLP_LOOP; count++) {
+	for (count = 0; tlp_poll_wait(count, start); count++) {
 		ctrl = cra_readl(pcie, S10_RP_RXCPL_STATUS);
 		if (ctrl & RP_RXCPL_SOP) {
 			/* Read first DW */
 			dw[0] = cra_readl(pcie, S10_RP_RXCPL_REG);
+			sop = true;
 			break;
 		}
-
-		udelay(5);
 	}
 
 	/* SOP detection failed, return error */
-	if (count == TLP_LOOP)
+	if (!sop)
 		return PCIBIOS_DEVICE_NOT_FOUND;
 
 	count = 1;
@@ -389,20 +465,57 @@ static int tlp_cfg_dword_read(struct altera_pcie *pcie, u8 bus, u32 devfn,
 			      int where, u8 byte_en, u32 *value)
 {
 	u32 headers[TLP_HDR_SIZE];
+	struct tlp_shadow *shadow;
+	int reg, ret;
+
+	shadow = tlp_shadow_lookup(pcie, bus, devfn, where, &reg);
+	if (shadow && (shadow->valid & BIT(reg))) {
+		*value = shadow->val[reg];
+		return PCIBIOS_SUCCESSFUL;
+	}
+
+	/* the whole dword is fetched to fill the shadow */
+	if (shadow)
+		byte_en = 0xf;
 
 	get_tlp_header(pcie, bus, devfn, where, byte_en, true,
 		       headers);
 
 	pcie->pcie_data->ops->tlp_write_pkt(pcie, headers, 0, false);
 
-	return pcie->pcie_data->ops->tlp_read_pkt(pcie, value);
+	/*
+	 * A Vendor ID of 0x0001 is the Configuration Request Retry Status of
+	 * a device not ready yet, the next read can get the real one.
+	 */
+	ret = pcie->pcie_data->ops->tlp_read_pkt(pcie, value);
+	if (ret == PCIBIOS_SUCCESSFUL && shadow &&
+	    !PCI_POSSIBLE_ERROR(*value) &&
+	    !(where == PCI_VENDOR_ID && (*value & 0xffff) == 0x0001)) {
+		shadow->val[reg] = *value;
+		shadow->valid |= BIT(reg);
+	}
+
+	return ret;
 }
 
 static int tlp_cfg_dword_write(struct altera_pcie *pcie, u8 bus, u32 devfn,
 			       int where, u8 byte_en, u32 value)
 {
 	u32 headers[TLP_HDR_SIZE];
-	int ret;
+	struct tlp_shadow *shadow;
+	int reg, ret;
+
+	/*
+	 * Bus numbers or a secondary bus reset can change what is behind a
+	 * bridge, any other write only affects the device written to.
+	 */
+	if (where == PCI_PRIMARY_BUS || where == PCI_INTERRUPT_LINE) {
+		tlp_shadow_invalidate(pcie);
+	} else {
+		shadow = tlp_shadow_lookup(pcie, bus, devfn, PCI_VENDOR_ID,
+					   &reg);
+		shadow->valid = 0;
+	}
 
 	get_tlp_header(pcie, bus, devfn, where, byte_en, false,
 		       headers);
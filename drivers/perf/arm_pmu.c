@@ -716,8 +716,21 @@ static int arm_perf_starting_cpu(unsigned int cpu, struct hlist_node *node)
 	per_cpu(cpu_armpmu, cpu) = pmu;
 
 	irq = armpmu_get_cpu_irq(pmu, cpu);
-	if (irq)
-		per_cpu(cpu_irq_ops, cpu)->enable_pmuirq(irq);
+	if (!irq)
+		return 0;
+
+	/*
+	 * The affinity of an SPI set by armpmu_request_irq() for a CPU which
+	 * wasn't online yet may not have reached the interrupt controller,
+	 * the GIC not knowing the CPU interface of a CPU it hasn't seen.
+	 * Route it again now, or the samples of this CPU would be taken on
+	 * another one, which can't read our counters.
+	 */
+	if (!irq_is_percpu_devid(irq) &&
+	    irq_force_affinity(irq, cpumask_of(cpu)) && num_possible_cpus() > 1)
+		pr_warn_once("unable to route IRQ%d to CPU%u\n", irq, cpu);
+
+	per_cpu(cpu_irq_ops, cpu)->enable_pmuirq(irq);
 
 	return 0;
 }
@@ -952,6 +965,10 @@ int armpmu_register(struct arm_pmu *pmu)
 		pmu->name, pmu->num_events,
 		has_nmi ? ", using NMIs" : "");
 
+	/* pseudo-NMIs need a GICv3 and irqchip.gicv3_pseudo_nmi=1 */
+	if (IS_ENABLED(CONFIG_ARM64_PSEUDO_NMI) && !has_nmi)
+		pr_info_once("sampling is deferred while interrupts are masked, no NMI support\n");
+
 	kvm_host_pmu_init(pmu);
 
 	return 0;
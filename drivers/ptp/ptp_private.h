@@ -14,6 +14,7 @@
 #include <linux/posix-clock.h>
 #include <linux/ptp_clock.h>
 #include <linux/ptp_clock_kernel.h>
+#include <linux/seqlock.h>
 #include <linux/time.h>
 
 #define PTP_MAX_TIMESTAMPS 128
@@ -66,7 +67,8 @@ struct ptp_vclock {
 	struct hlist_node vclock_hash_node;
 	struct cyclecounter cc;
 	struct timecounter tc;
-	struct mutex lock;	/* protects tc/cc */
+	struct mutex lock;	/* serializes the tc/cc updates */
+	seqcount_mutex_t seq;	/* lockless tc/cc readers */
 };
 
 /*
@@ -40,9 +40,39 @@ static void ptp_vclock_hash_del(struct ptp_vclock *vclock)
 	synchronize_rcu();
 }
 
+/*
+ * Reading the parent clock may sleep, so the writers read it before entering
+ * the write side of @seq, which then only covers the arithmetic.  The readers
+ * never take @lock: converting a timestamp only needs a consistent snapshot of
+ * tc/cc, which a concurrent update makes them retry.
+ */
+static u64 ptp_vclock_cyc2time(struct ptp_vclock *vclock, u64 cycles)
+{
+	unsigned int seq;
+	u64 ns;
+
+	do {
+		seq = read_seqcount_begin(&vclock->seq);
+		ns = timecounter_cyc2time(&vclock->tc, cycles);
+	} while (read_seqcount_retry(&vclock->seq, seq));
+
+	return ns;
+}
+
+/* Caller holds vclock->lock and the write side of vclock->seq. */
+static void ptp_vclock_tc_advance(struct ptp_vclock *vclock, u64 cycles)
+{
+	struct timecounter *tc = &vclock->tc;
+	u64 delta = (cycles - tc->cycle_last) & tc->cc->mask;
+
+	tc->nsec += cyclecounter_cyc2ns(tc->cc, delta, tc->mask, &tc->frac);
+	tc->cycle_last = cycles;
+}
+
 static int ptp_vclock_adjfine(struct ptp_clock_info *ptp, long scaled_ppm)
 {
 	struct ptp_vclock *vclock = info_to_vclock(ptp);
+	u64 cycles;
 	s64 adj;
 
 	adj = (s64)scaled_ppm << PTP_VCLOCK_FADJ_SHIFT;
@@ -50,8 +80,11 @@ static int ptp_vclock_adjfine(struct ptp_clock_info *ptp, long scaled_ppm)
 
 	if (mutex_lock_interruptible(&vclock->lock))
 		return -EINTR;
-	timecounter_read(&vclock->tc);
+	cycles = vclock->cc.read(&vclock->cc);
+	write_seqcount_begin(&vclock->seq);
+	ptp_vclock_tc_advance(vclock, cycles);
 	vclock->cc.mult = PTP_VCLOCK_CC_MULT + adj;
+	write_seqcount_end(&vclock->seq);
 	mutex_unlock(&vclock->lock);
 
 	return 0;
@@ -63,7 +96,9 @@ static int ptp_vclock_adjtime(struct ptp_clock_info *ptp, s64 delta)
 
 	if (mutex_lock_interruptible(&vclock->lock))
 		return -EINTR;
+	write_seqcount_begin(&vclock->seq);
 	timecounter_adjtime(&vclock->tc, delta);
+	write_seqcount_end(&vclock->seq);
 	mutex_unlock(&vclock->lock);
 
 	return 0;
@@ -75,10 +110,7 @@ static int ptp_vclock_gettime(struct ptp_clock_info *ptp,
 	struct ptp_vclock *vclock = info_to_vclock(ptp);
 	u64 ns;
 
-	if (mutex_lock_interruptible(&vclock->lock))
-		return -EINTR;
-	ns = timecounter_read(&vclock->tc);
-	mutex_unlock(&vclock->lock);
+	ns = ptp_vclock_cyc2time(vclock, vclock->cc.read(&vclock->cc));
 	*ts = ns_to_timespec64(ns);
 
 	return 0;
@@ -98,11 +130,7 @@ static int ptp_vclock_gettimex(struct ptp_clock_info *ptp,
 	if (err)
 		return err;
 
-	if (mutex_lock_interruptible(&vclock->lock))
-		return -EINTR;
-	ns = timecounter_cyc2time(&vclock->tc, timespec64_to_ns(&pts));
-	mutex_unlock(&vclock->lock);
-
+	ns = ptp_vclock_cyc2time(vclock, timespec64_to_ns(&pts));
 	*ts = ns_to_timespec64(ns);
 
 	return 0;
@@ -112,11 +140,18 @@ static int ptp_vclock_settime(struct ptp_clock_info *ptp,
 			      const struct timespec64 *ts)
 {
 	struct ptp_vclock *vclock = info_to_vclock(ptp);
+	struct timecounter *tc = &vclock->tc;
 	u64 ns = timespec64_to_ns(ts);
+	u64 cycles;
 
 	if (mutex_lock_interruptible(&vclock->lock))
 		return -EINTR;
-	timecounter_init(&vclock->tc, &vclock->cc, ns);
+	cycles = vclock->cc.read(&vclock->cc);
+	write_seqcount_begin(&vclock->seq);
+	tc->cycle_last = cycles;
+	tc->nsec = ns;
+	tc->frac = 0;
+	write_seqcount_end(&vclock->seq);
 	mutex_unlock(&vclock->lock);
 
 	return 0;
@@ -134,11 +169,7 @@ static int ptp_vclock_getcrosststamp(struct ptp_clock_info *ptp,
 	if (err)
 		return err;
 
-	if (mutex_lock_interruptible(&vclock->lock))
-		return -EINTR;
-	ns = timecounter_cyc2time(&vclock->tc, ktime_to_ns(xtstamp->device));
-	mutex_unlock(&vclock->lock);
-
+	ns = ptp_vclock_cyc2time(vclock, ktime_to_ns(xtstamp->device));
 	xtstamp->device = ns_to_ktime(ns);
 
 	return 0;
@@ -147,9 +178,15 @@ static int ptp_vclock_getcrosststamp(struct ptp_clock_info *ptp,
 static long ptp_vclock_refresh(struct ptp_clock_info *ptp)
 {
 	struct ptp_vclock *vclock = info_to_vclock(ptp);
-	struct timespec64 ts;
-
-	ptp_vclock_gettime(&vclock->info, &ts);
+	u64 cycles;
+
+	/* keep the readers within half a wrap of cycle_last */
+	mutex_lock(&vclock->lock);
+	cycles = vclock->cc.read(&vclock->cc);
+	write_seqcount_begin(&vclock->seq);
+	ptp_vclock_tc_advance(vclock, cycles);
+	write_seqcount_end(&vclock->seq);
+	mutex_unlock(&vclock->lock);
 
 	return PTP_VCLOCK_REFRESH_INTERVAL;
 }
@@ -206,6 +243,7 @@ struct ptp_vclock *ptp_vclock_register(struct ptp_clock *pclock)
 	INIT_HLIST_NODE(&vclock->vclock_hash_node);
 
 	mutex_init(&vclock->lock);
+	seqcount_mutex_init(&vclock->seq, &vclock->lock);
 
 	vclock->clock = ptp_clock_register(&vclock->info, &pclock->dev);
 	if (IS_ERR_OR_NULL(vclock->clock)) {
@@ -265,31 +303,72 @@ int ptp_get_vclocks_index(int pclock_index, int **vclock_index)
 }
 EXPORT_SYMBOL(ptp_get_vclocks_index);
 
-ktime_t ptp_convert_timestamp(const ktime_t *hwtstamp, int vclock_index)
+static struct ptp_vclock *ptp_vclock_lookup(int vclock_index)
 {
 	unsigned int hash = vclock_index % HASH_SIZE(vclock_hash);
 	struct ptp_vclock *vclock;
-	u64 ns;
+
+	hlist_for_each_entry_rcu(vclock, &vclock_hash[hash], vclock_hash_node)
+		if (vclock->clock->index == vclock_index)
+			return vclock;
+
+	return NULL;
+}
+
+ktime_t ptp_convert_timestamp(const ktime_t *hwtstamp, int vclock_index)
+{
+	struct ptp_vclock *vclock;
 	u64 vclock_ns = 0;
 
-	ns = ktime_to_ns(*hwtstamp);
+	rcu_read_lock();
+
+	vclock = ptp_vclock_lookup(vclock_index);
+	if (vclock)
+		vclock_ns = ptp_vclock_cyc2time(vclock, ktime_to_ns(*hwtstamp));
+
+	rcu_read_unlock();
+
+	return ns_to_ktime(vclock_ns);
+}
+EXPORT_SYMBOL(ptp_convert_timestamp);
+
+int ptp_convert_timestamps(ktime_t *hwtstamps, unsigned int n,
+			   int vclock_index)
+{
+	const struct timecounter *tc;
+	struct ptp_vclock *vclock;
+	unsigned int i, seq;
+	u64 ns[8];
 
 	rcu_read_lock();
 
-	hlist_for_each_entry_rcu(vclock, &vclock_hash[hash], vclock_hash_node) {
-		if (vclock->clock->index != vclock_index)
-			continue;
+	vclock = ptp_vclock_lookup(vclock_index);
+	if (!vclock) {
+		rcu_read_unlock();
+		return -ENODEV;
+	}
+	tc = &vclock->tc;
 
-		if (mutex_lock_interruptible(&vclock->lock))
-			break;
-		vclock_ns = timecounter_cyc2time(&vclock->tc, ns);
-		mutex_unlock(&vclock->lock);
-		break;
+	/* one hash lookup, and one snapshot of tc/cc per chunk */
+	while (n) {
+		unsigned int len = min_t(unsigned int, n, ARRAY_SIZE(ns));
+
+		do {
+			seq = read_seqcount_begin(&vclock->seq);
+			for (i = 0; i < len; i++)
+				ns[i] = timecounter_cyc2time(tc, hwtstamps[i]);
+		} while (read_seqcount_retry(&vclock->seq, seq));
+
+		for (i = 0; i < len; i++)
+			hwtstamps[i] = ns_to_ktime(ns[i]);
+
+		hwtstamps += len;
+		n -= len;
 	}
 
 	rcu_read_unlock();
 
-	return ns_to_ktime(vclock_ns);
+	return 0;
 }
-EXPORT_SYMBOL(ptp_convert_timestamp);
+EXPORT_SYMBOL(ptp_convert_timestamps);
 #endif
@@ -33,6 +33,7 @@
 #include <linux/idr.h>
 #include <linux/elf.h>
 #include <linux/crc32.h>
+#include <linux/ktime.h>
 #include <linux/of_reserved_mem.h>
 #include <linux/virtio_ids.h>
 #include <linux/virtio_ring.h>
@@ -1262,10 +1263,68 @@ void rproc_resource_cleanup(struct rproc *rproc)
 }
 EXPORT_SYMBOL(rproc_resource_cleanup);
 
+static void rproc_boot_phase_end(struct rproc *rproc,
+				 enum rproc_boot_phase phase, ktime_t start)
+{
+	rproc->boot_ns[phase] = ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
+/*
+ * Get the firmware image to boot with, from the cache when there is one,
+ * starting the timing of a new boot.
+ */
+static int rproc_request_firmware(struct rproc *rproc,
+				  const struct firmware **fw)
+{
+	struct device *dev = &rproc->dev;
+	ktime_t start = ktime_get();
+	int ret;
+
+	memset(rproc->boot_ns, 0, sizeof(rproc->boot_ns));
+	rproc->boot_fw_cached = !!rproc->cached_fw;
+
+	if (rproc->cached_fw) {
+		*fw = rproc->cached_fw;
+	} else {
+		ret = request_firmware(fw, rproc->firmware, dev);
+		if (ret < 0) {
+			dev_err(dev, "request_firmware failed: %d\n", ret);
+			return ret;
+		}
+
+		if (rproc->cache_fw)
+			rproc->cached_fw = *fw;
+	}
+
+	rproc_boot_phase_end(rproc, RPROC_BOOT_FIRMWARE, start);
+
+	return 0;
+}
+
+static void rproc_release_firmware(struct rproc *rproc,
+				   const struct firmware *fw)
+{
+	if (fw != rproc->cached_fw)
+		release_firmware(fw);
+}
+
+/**
+ * rproc_drop_cached_firmware() - release the cached firmware image
+ * @rproc: the remote processor
+ *
+ * Called with @rproc->lock held, or when @rproc is released.
+ */
+void rproc_drop_cached_firmware(struct rproc *rproc)
+{
+	release_firmware(rproc->cached_fw);
+	rproc->cached_fw = NULL;
+}
+
 static int rproc_start(struct rproc *rproc, const struct firmware *fw)
 {
 	struct resource_table *loaded_table;
 	struct device *dev = &rproc->dev;
+	ktime_t start = ktime_get();
 	int ret;
 
 	/* load the ELF segments to memory */
@@ -1275,6 +1334,9 @@ static int rproc_start(struct rproc *rproc, const struct firmware *fw)
 		return ret;
 	}
 
+	rproc_boot_phase_end(rproc, RPROC_BOOT_LOAD, start);
+	start = ktime_get();
+
 	/*
 	 * The starting device has been given the rproc->cached_table as the
 	 * resource table. The address of the vring along with the other
@@ -1312,6 +1374,7 @@ static int rproc_start(struct rproc *rproc, const struct firmware *fw)
 	}
 
 	rproc->state = RPROC_RUNNING;
+	rproc_boot_phase_end(rproc, RPROC_BOOT_START, start);
 
 	dev_info(dev, "remote processor %s is now up\n", rproc->name);
 
@@ -1376,6 +1439,7 @@ static int rproc_fw_boot(struct rproc *rproc, const struct firmware *fw)
 {
 	struct device *dev = &rproc->dev;
 	const char *name = rproc->firmware;
+	ktime_t start = ktime_get();
 	int ret;
 
 	ret = rproc_fw_sanity_check(rproc, fw);
@@ -1429,6 +1493,8 @@ static int rproc_fw_boot(struct rproc *rproc, const struct firmware *fw)
 		goto clean_up_resources;
 	}
 
+	rproc_boot_phase_end(rproc, RPROC_BOOT_PREPARE, start);
+
 	ret = rproc_start(rproc, fw);
 	if (ret)
 		goto clean_up_resources;
@@ -1790,7 +1856,6 @@ static int rproc_attach_recovery(struct rproc *rproc)
 static int rproc_boot_recovery(struct rproc *rproc)
 {
 	const struct firmware *firmware_p;
-	struct device *dev = &rproc->dev;
 	int ret;
 
 	ret = rproc_stop(rproc, true);
@@ -1801,16 +1866,14 @@ static int rproc_boot_recovery(struct rproc *rproc)
 	rproc->ops->coredump(rproc);
 
 	/* load firmware */
-	ret = request_firmware(&firmware_p, rproc->firmware, dev);
-	if (ret < 0) {
-		dev_err(dev, "request_firmware failed: %d\n", ret);
+	ret = rproc_request_firmware(rproc, &firmware_p);
+	if (ret < 0)
 		return ret;
-	}
 
 	/* boot the remote processor up again */
 	ret = rproc_start(rproc, firmware_p);
 
-	release_firmware(firmware_p);
+	rproc_release_firmware(rproc, firmware_p);
 
 	return ret;
 }
@@ -1943,15 +2006,13 @@ int rproc_boot(struct rproc *rproc)
 		dev_info(dev, "powering up %s\n", rproc->name);
 
 		/* load firmware */
-		ret = request_firmware(&firmware_p, rproc->firmware, dev);
-		if (ret < 0) {
-			dev_err(dev, "request_firmware failed: %d\n", ret);
+		ret = rproc_request_firmware(rproc, &firmware_p);
+		if (ret < 0)
 			goto downref_rproc;
-		}
 
 		ret = rproc_fw_boot(rproc, firmware_p);
 
-		release_firmware(firmware_p);
+		rproc_release_firmware(rproc, firmware_p);
 	}
 
 downref_rproc:
@@ -2201,6 +2262,7 @@ int rproc_set_firmware(struct rproc *rproc, const char *fw_name)
 
 	kfree_const(rproc->firmware);
 	rproc->firmware = p;
+	rproc_drop_cached_firmware(rproc);
 
 out:
 	mutex_unlock(&rproc->lock);
@@ -2360,6 +2422,7 @@ static void rproc_type_release(struct device *dev)
 	if (rproc->index >= 0)
 		ida_free(&rproc_dev_index, rproc->index);
 
+	rproc_drop_cached_firmware(rproc);
 	kfree_const(rproc->firmware);
 	kfree_const(rproc->name);
 	kfree(rproc->ops);
@@ -21,6 +21,8 @@
 #include <linux/remoteproc.h>
 #include <linux/device.h>
 #include <linux/uaccess.h>
+#include <linux/virtio_byteorder.h>
+#include <linux/virtio_ring.h>
 
 #include "remoteproc_internal.h"
 
@@ -271,6 +273,87 @@ static const struct file_operations rproc_crash_ops = {
 	.llseek = generic_file_llseek,
 };
 
+/* expose the firmware cache flag via debugfs */
+static ssize_t rproc_fw_cache_read(struct file *filp, char __user *userbuf,
+				   size_t count, loff_t *ppos)
+{
+	struct rproc *rproc = filp->private_data;
+	char *buf = rproc->cache_fw ? "enabled\n" : "disabled\n";
+
+	return simple_read_from_buffer(userbuf, count, ppos, buf, strlen(buf));
+}
+
+/*
+ * Writing a boolean to the 'firmware_cache' debugfs entry controls whether
+ * the firmware image is kept across stops, so that restarting the remote
+ * processor, e.g. to recover it, doesn't go through the firmware loader
+ * again.  Disabling the cache releases the cached image.  The default is
+ * "disabled".
+ */
+static ssize_t rproc_fw_cache_write(struct file *filp,
+				    const char __user *user_buf, size_t count,
+				    loff_t *ppos)
+{
+	struct rproc *rproc = filp->private_data;
+	bool enable;
+	int ret;
+
+	ret = kstrtobool_from_user(user_buf, count, &enable);
+	if (ret)
+		return ret;
+
+	ret = mutex_lock_interruptible(&rproc->lock);
+	if (ret)
+		return ret;
+
+	rproc->cache_fw = enable;
+	if (!enable)
+		rproc_drop_cached_firmware(rproc);
+
+	mutex_unlock(&rproc->lock);
+
+	return count;
+}
+
+static const struct file_operations rproc_fw_cache_ops = {
+	.read = rproc_fw_cache_read,
+	.write = rproc_fw_cache_write,
+	.open = simple_open,
+	.llseek = generic_file_llseek,
+};
+
+/*
+ * Names of the boot phases, for exposing the duration of the last boot via
+ * debugfs. Always keep in sync with enum rproc_boot_phase
+ */
+static const char * const rproc_boot_phase_str[] = {
+	[RPROC_BOOT_FIRMWARE]	= "firmware",
+	[RPROC_BOOT_PREPARE]	= "prepare",
+	[RPROC_BOOT_LOAD]	= "load",
+	[RPROC_BOOT_START]	= "start",
+};
+
+/* Expose the duration of the phases of the last boot via debugfs */
+static int rproc_boot_times_show(struct seq_file *seq, void *p)
+{
+	struct rproc *rproc = seq->private;
+	u64 total = 0;
+	int i;
+
+	for (i = 0; i < RPROC_BOOT_PHASES; i++) {
+		seq_printf(seq, "%s:\t%llu us%s\n", rproc_boot_phase_str[i],
+			   div_u64(rproc->boot_ns[i], NSEC_PER_USEC),
+			   i == RPROC_BOOT_FIRMWARE && rproc->boot_fw_cached ?
+			   " (cached)" : "");
+		total += rproc->boot_ns[i];
+	}
+	seq_printf(seq, "total:\t\t%llu us\n", div_u64(total, NSEC_PER_USEC));
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(rproc_boot_times);
+
 /* Expose resource table content via debugfs */
 static int rproc_rsc_table_show(struct seq_file *seq, void *p)
 {
@@ -378,6 +461,74 @@ static int rproc_carveouts_show(struct seq_file *seq, void *p)
 
 DEFINE_SHOW_ATTRIBUTE(rproc_carveouts);
 
+/*
+ * The ring indexes are read from the vring memory rather than through the
+ * virtqueue, which the virtio driver can delete at any time.  The carveout
+ * holding that memory lives as long as the vdev, under rproc->lock.
+ * Remoteproc vdevs can't negotiate VIRTIO_F_VERSION_1, so the vring is in
+ * the legacy byte order.
+ */
+static void rproc_vring_show_idx(struct seq_file *seq, struct rproc *rproc,
+				 struct rproc_vdev *rvdev, int i)
+{
+	struct rproc_vring *rvring = &rvdev->vring[i];
+	bool le = virtio_legacy_is_little_endian();
+	struct rproc_mem_entry *mem;
+	struct vring vring;
+
+	mem = rproc_find_carveout_by_name(rproc, "vdev%dvring%d", rvdev->index,
+					  i);
+	if (!mem || !mem->va)
+		return;
+
+	vring_init(&vring, rvring->num, mem->va, rvring->align);
+	seq_printf(seq, "\tAvailable index: %u\n",
+		   __virtio16_to_cpu(le, READ_ONCE(vring.avail->idx)));
+	seq_printf(seq, "\tUsed index: %u\n",
+		   __virtio16_to_cpu(le, READ_ONCE(vring.used->idx)));
+}
+
+/*
+ * Expose the notifications of the vrings, and how far their available and
+ * used rings went, via debugfs
+ */
+static int rproc_vrings_show(struct seq_file *seq, void *p)
+{
+	struct rproc *rproc = seq->private;
+	struct rproc_vdev *rvdev;
+	struct rproc_vring *rvring;
+	int ret, i;
+
+	ret = mutex_lock_interruptible(&rproc->lock);
+	if (ret)
+		return ret;
+
+	list_for_each_entry(rvdev, &rproc->rvdevs, node) {
+		for (i = 0; i < RVDEV_NUM_VRINGS; i++) {
+			rvring = &rvdev->vring[i];
+			if (!rvring->rvdev)
+				continue;
+
+			seq_printf(seq, "vdev%d vring%d:\n", rvdev->index, i);
+			seq_printf(seq, "\tNotify ID: %d\n", rvring->notifyid);
+			seq_printf(seq, "\tNumber of buffers: %d\n", rvring->num);
+			seq_printf(seq, "\tKicks: %lu\n", rvring->kicks);
+			seq_printf(seq, "\tInterrupts: %lu\n", rvring->interrupts);
+			seq_printf(seq, "\tSpurious interrupts: %lu\n",
+				   rvring->spurious);
+
+			rproc_vring_show_idx(seq, rproc, rvdev, i);
+			seq_puts(seq, "\n");
+		}
+	}
+
+	mutex_unlock(&rproc->lock);
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(rproc_vrings);
+
 void rproc_remove_trace_file(struct dentry *tfile)
 {
 	debugfs_remove(tfile);
@@ -416,6 +567,12 @@ void rproc_create_debug_dir(struct rproc *rproc)
 			    rproc, &rproc_carveouts_fops);
 	debugfs_create_file("coredump", 0600, rproc->dbg_dir,
 			    rproc, &rproc_coredump_fops);
+	debugfs_create_file("firmware_cache", 0600, rproc->dbg_dir,
+			    rproc, &rproc_fw_cache_ops);
+	debugfs_create_file("boot_times", 0400, rproc->dbg_dir,
+			    rproc, &rproc_boot_times_fops);
+	debugfs_create_file("vrings", 0400, rproc->dbg_dir,
+			    rproc, &rproc_vrings_fops);
 }
 
 void __init rproc_init_debugfs(void)
@@ -178,6 +178,7 @@ int rproc_elf_load_segments(struct rproc *rproc, const struct firmware *fw)
 		u64 filesz = elf_phdr_get_p_filesz(class, phdr);
 		u64 offset = elf_phdr_get_p_offset(class, phdr);
 		u32 type = elf_phdr_get_p_type(class, phdr);
+		bool copied = false;
 		bool is_iomem = false;
 		void *ptr;
 
@@ -218,7 +219,21 @@ int rproc_elf_load_segments(struct rproc *rproc, const struct firmware *fw)
 		}
 
 		/* put the segment where the remote processor expects it */
-		if (filesz) {
+		if (filesz && rproc->ops->load_segment) {
+			ret = rproc->ops->load_segment(rproc, da, ptr,
+						       elf_data + offset,
+						       filesz);
+			if (!ret) {
+				copied = true;
+			} else if (ret != -EOPNOTSUPP) {
+				dev_err(dev, "failed to load segment da 0x%llx: %d\n",
+					da, ret);
+				break;
+			}
+			ret = 0;
+		}
+
+		if (filesz && !copied) {
 			if (is_iomem)
 				memcpy_toio((void __iomem *)ptr, elf_data + offset, filesz);
 			else
@@ -58,6 +58,7 @@ static inline int rproc_set_feature(struct rproc *rproc, unsigned int feature)
 void rproc_release(struct kref *kref);
 int rproc_of_parse_firmware(struct device *dev, int index,
 			    const char **fw_name);
+void rproc_drop_cached_firmware(struct rproc *rproc);
 
 /* from remoteproc_virtio.c */
 irqreturn_t rproc_vq_interrupt(struct rproc *rproc, int vq_id);
@@ -70,6 +70,7 @@ static bool rproc_virtio_notify(struct virtqueue *vq)
 
 	dev_dbg(&rproc->dev, "kicking vq index: %d\n", notifyid);
 
+	rvring->kicks++;
 	rproc->ops->kick(rproc, notifyid);
 	return true;
 }
@@ -89,6 +90,7 @@ static bool rproc_virtio_notify(struct virtqueue *vq)
 irqreturn_t rproc_vq_interrupt(struct rproc *rproc, int notifyid)
 {
 	struct rproc_vring *rvring;
+	irqreturn_t ret;
 
 	dev_dbg(&rproc->dev, "vq index %d is interrupted\n", notifyid);
 
@@ -96,7 +98,12 @@ irqreturn_t rproc_vq_interrupt(struct rproc *rproc, int notifyid)
 	if (!rvring || !rvring->vq)
 		return IRQ_NONE;
 
-	return vring_interrupt(0, rvring->vq);
+	ret = vring_interrupt(0, rvring->vq);
+	rvring->interrupts++;
+	if (ret == IRQ_NONE)
+		rvring->spurious++;
+
+	return ret;
 }
 EXPORT_SYMBOL(rproc_vq_interrupt);
 
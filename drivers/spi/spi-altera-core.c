@@ -10,6 +10,7 @@
  *	Ben Dooks <ben@simtec.co.uk>
  */
 
+#include <linux/dmaengine.h>
 #include <linux/errno.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
@@ -40,6 +41,9 @@
 #define ALTERA_SPI_CONTROL_IE_MSK	0x100
 #define ALTERA_SPI_CONTROL_SSO_MSK	0x400
 
+/* Shorter transfers are not worth setting up DMA for. */
+#define ALTERA_SPI_DMA_MIN_LEN		64
+
 static int altr_spi_writel(struct altera_spi *hw, unsigned int reg,
 			   unsigned int val)
 {
@@ -93,23 +97,142 @@ static void altera_spi_tx_word(struct altera_spi *hw)
 	if (hw->tx) {
 		switch (hw->bytes_per_word) {
 		case 1:
-			txd = hw->tx[hw->count];
+			txd = hw->tx[hw->tx_count];
 			break;
 		case 2:
-			txd = (hw->tx[hw->count * 2]
-				| (hw->tx[hw->count * 2 + 1] << 8));
+			txd = (hw->tx[hw->tx_count * 2]
+				| (hw->tx[hw->tx_count * 2 + 1] << 8));
 			break;
 		case 4:
-			txd = (hw->tx[hw->count * 4]
-				| (hw->tx[hw->count * 4 + 1] << 8)
-				| (hw->tx[hw->count * 4 + 2] << 16)
-				| (hw->tx[hw->count * 4 + 3] << 24));
+			txd = (hw->tx[hw->tx_count * 4]
+				| (hw->tx[hw->tx_count * 4 + 1] << 8)
+				| (hw->tx[hw->tx_count * 4 + 2] << 16)
+				| (hw->tx[hw->tx_count * 4 + 3] << 24));
 			break;
 
 		}
 	}
 
 	altr_spi_writel(hw, ALTERA_SPI_TXDATA, txd);
+	hw->tx_count++;
+}
+
+/*
+ * Keep up to fifo_depth words in flight: as the receive FIFO is as deep as
+ * the transmit one, they can't overrun it.
+ */
+static void altera_spi_fill_tx(struct altera_spi *hw)
+{
+	while (hw->tx_count < hw->len &&
+	       hw->tx_count - hw->count < hw->fifo_depth)
+		altera_spi_tx_word(hw);
+}
+
+static bool altera_spi_rx_ready(struct altera_spi *hw)
+{
+	u32 val;
+
+	altr_spi_readl(hw, ALTERA_SPI_STATUS, &val);
+	return val & ALTERA_SPI_STATUS_RRDY_MSK;
+}
+
+/* Called with at least one word received. */
+static void altera_spi_drain_rx(struct altera_spi *hw)
+{
+	altera_spi_rx_word(hw);
+
+	/* without FIFO, no more than one word is ever in flight */
+	while (hw->fifo_depth > 1 && hw->count < hw->tx_count &&
+	       altera_spi_rx_ready(hw))
+		altera_spi_rx_word(hw);
+}
+
+static bool altera_spi_can_dma(struct spi_master *master,
+			       struct spi_device *spi, struct spi_transfer *t)
+{
+	return t->len >= ALTERA_SPI_DMA_MIN_LEN;
+}
+
+static void altera_spi_dma_rx_done(void *data)
+{
+	struct spi_master *master = data;
+
+	spi_finalize_current_transfer(master);
+}
+
+static int altera_spi_dma_config(struct spi_master *master)
+{
+	struct altera_spi *hw = spi_master_get_devdata(master);
+	enum dma_slave_buswidth width = hw->bytes_per_word;
+	struct dma_slave_config cfg = {
+		.src_addr = hw->phys_base + hw->regoff + ALTERA_SPI_RXDATA,
+		.src_addr_width = width,
+		.src_maxburst = 1,
+		.dst_addr = hw->phys_base + hw->regoff + ALTERA_SPI_TXDATA,
+		.dst_addr_width = width,
+		.dst_maxburst = 1,
+	};
+	int ret;
+
+	cfg.direction = DMA_DEV_TO_MEM;
+	ret = dmaengine_slave_config(master->dma_rx, &cfg);
+	if (ret)
+		return ret;
+
+	cfg.direction = DMA_MEM_TO_DEV;
+	return dmaengine_slave_config(master->dma_tx, &cfg);
+}
+
+/*
+ * Both directions are paced by the request lines of the core, the transfer
+ * is over once the last word has been received.
+ */
+static int altera_spi_dma_txrx(struct spi_master *master,
+			       struct spi_transfer *t)
+{
+	struct altera_spi *hw = spi_master_get_devdata(master);
+	struct dma_async_tx_descriptor *rxd, *txd;
+	int ret;
+
+	ret = altera_spi_dma_config(master);
+	if (ret)
+		return ret;
+
+	rxd = dmaengine_prep_slave_sg(master->dma_rx, t->rx_sg.sgl,
+				      t->rx_sg.nents, DMA_DEV_TO_MEM,
+				      DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
+	if (!rxd)
+		return -ENOMEM;
+
+	txd = dmaengine_prep_slave_sg(master->dma_tx, t->tx_sg.sgl,
+				      t->tx_sg.nents, DMA_MEM_TO_DEV,
+				      DMA_CTRL_ACK);
+	if (!txd) {
+		dmaengine_terminate_sync(master->dma_rx);
+		return -ENOMEM;
+	}
+
+	rxd->callback = altera_spi_dma_rx_done;
+	rxd->callback_param = master;
+
+	/* no word must be received before the receive channel is ready */
+	dmaengine_submit(rxd);
+	dma_async_issue_pending(master->dma_rx);
+	dmaengine_submit(txd);
+	dma_async_issue_pending(master->dma_tx);
+
+	dev_dbg(hw->dev, "DMA transfer of %u bytes\n", t->len);
+
+	return 1;
+}
+
+static void altera_spi_handle_err(struct spi_master *master,
+				  struct spi_message *msg)
+{
+	if (master->cur_msg_mapped) {
+		dmaengine_terminate_sync(master->dma_tx);
+		dmaengine_terminate_sync(master->dma_rx);
+	}
 }
 
 static void altera_spi_rx_word(struct altera_spi *hw)
@@ -148,22 +271,26 @@ static int altera_spi_txrx(struct spi_master *master,
 	hw->tx = t->tx_buf;
 	hw->rx = t->rx_buf;
 	hw->count = 0;
+	hw->tx_count = 0;
 	hw->bytes_per_word = DIV_ROUND_UP(t->bits_per_word, 8);
 	hw->len = t->len / hw->bytes_per_word;
 
+	if (master->cur_msg_mapped && altera_spi_can_dma(master, spi, t))
+		return altera_spi_dma_txrx(master, t);
+
 	if (hw->irq >= 0) {
 		/* enable receive interrupt */
 		hw->imr |= ALTERA_SPI_CONTROL_IRRDY_MSK;
 		altr_spi_writel(hw, ALTERA_SPI_CONTROL, hw->imr);
 
-		/* send the first byte */
-		altera_spi_tx_word(hw);
+		/* send the first words */
+		altera_spi_fill_tx(hw);
 
 		return 1;
 	}
 
 	while (hw->count < hw->len) {
-		altera_spi_tx_word(hw);
+		altera_spi_fill_tx(hw);
 
 		for (;;) {
 			altr_spi_readl(hw, ALTERA_SPI_STATUS, &val);
@@ -173,7 +300,7 @@ static int altera_spi_txrx(struct spi_master *master,
 			cpu_relax();
 		}
 
-		altera_spi_rx_word(hw);
+		altera_spi_drain_rx(hw);
 	}
 	spi_finalize_current_transfer(master);
 
@@ -185,10 +312,10 @@ irqreturn_t altera_spi_irq(int irq, void *dev)
 	struct spi_master *master = dev;
 	struct altera_spi *hw = spi_master_get_devdata(master);
 
-	altera_spi_rx_word(hw);
+	altera_spi_drain_rx(hw);
 
 	if (hw->count < hw->len) {
-		altera_spi_tx_word(hw);
+		altera_spi_fill_tx(hw);
 	} else {
 		/* disable receive interrupt */
 		hw->imr &= ~ALTERA_SPI_CONTROL_IRRDY_MSK;
@@ -209,6 +336,9 @@ void altera_spi_init_master(struct spi_master *master)
 	master->transfer_one = altera_spi_txrx;
 	master->set_cs = altera_spi_set_cs;
 
+	if (!hw->fifo_depth)
+		hw->fifo_depth = 1;
+
 	/* program defaults into the registers */
 	hw->imr = 0;		/* disable spi interrupts */
 	altr_spi_writel(hw, ALTERA_SPI_CONTROL, hw->imr);
@@ -219,4 +349,58 @@ void altera_spi_init_master(struct spi_master *master)
 }
 EXPORT_SYMBOL_GPL(altera_spi_init_master);
 
+/**
+ * altera_spi_init_dma - set up DMA for the long transfers
+ * @master: the SPI master, with hw->phys_base set
+ *
+ * DMA is used when the device has "tx" and "rx" channels wired to the
+ * request lines of the core.  Otherwise all transfers are made by PIO.
+ *
+ * Return: 0 on success, including when there is no DMA channel, or
+ * -EPROBE_DEFER when the channels are not available yet.
+ */
+int altera_spi_init_dma(struct spi_master *master)
+{
+	struct altera_spi *hw = spi_master_get_devdata(master);
+	struct dma_chan *tx, *rx;
+
+	tx = dma_request_chan(hw->dev, "tx");
+	if (IS_ERR(tx))
+		return PTR_ERR(tx) == -EPROBE_DEFER ? -EPROBE_DEFER : 0;
+
+	rx = dma_request_chan(hw->dev, "rx");
+	if (IS_ERR(rx)) {
+		dma_release_channel(tx);
+		return PTR_ERR(rx) == -EPROBE_DEFER ? -EPROBE_DEFER : 0;
+	}
+
+	master->dma_tx = tx;
+	master->dma_rx = rx;
+	master->can_dma = altera_spi_can_dma;
+	master->handle_err = altera_spi_handle_err;
+	/* the receive channel paces the transfers */
+	master->flags |= SPI_MASTER_MUST_RX | SPI_MASTER_MUST_TX;
+
+	dev_info(hw->dev, "using DMA for transfers of %d bytes or more\n",
+		 ALTERA_SPI_DMA_MIN_LEN);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(altera_spi_init_dma);
+
+/**
+ * altera_spi_release_dma - release the channels of altera_spi_init_dma()
+ * @master: the SPI master
+ */
+void altera_spi_release_dma(struct spi_master *master)
+{
+	if (master->dma_rx)
+		dma_release_channel(master->dma_rx);
+	if (master->dma_tx)
+		dma_release_channel(master->dma_tx);
+	master->dma_rx = NULL;
+	master->dma_tx = NULL;
+}
+EXPORT_SYMBOL_GPL(altera_spi_release_dma);
+
 MODULE_LICENSE("GPL");
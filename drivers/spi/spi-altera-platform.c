@@ -14,6 +14,7 @@
 #include <linux/errno.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
+#include <linux/property.h>
 #include <linux/spi/altera.h>
 #include <linux/spi/spi.h>
 #include <linux/io.h>
@@ -33,6 +34,12 @@ static const struct regmap_config spi_altera_config = {
 	.fast_io = true,
 };
 
+static void altera_spi_release_dma_action(void *master)
+{
+	altera_spi_release_dma(master);
+	spi_master_put(master);
+}
+
 static int altera_spi_probe(struct platform_device *pdev)
 {
 	const struct platform_device_id *platid = platform_get_device_id(pdev);
@@ -90,13 +97,15 @@ static int altera_spi_probe(struct platform_device *pdev)
 		if (regoff)
 			hw->regoff = regoff->start;
 	} else {
+		struct resource *mem;
 		void __iomem *res;
 
-		res = devm_platform_ioremap_resource(pdev, 0);
+		res = devm_platform_get_and_ioremap_resource(pdev, 0, &mem);
 		if (IS_ERR(res)) {
 			err = PTR_ERR(res);
 			goto exit;
 		}
+		hw->phys_base = mem->start;
 
 		hw->regmap = devm_regmap_init_mmio(&pdev->dev, res,
 						   &spi_altera_config);
@@ -107,8 +116,27 @@ static int altera_spi_probe(struct platform_device *pdev)
 		}
 	}
 
+	/* words buffered by the core when generated with a FIFO */
+	if (device_property_read_u32(&pdev->dev, "fifo-depth",
+				     &hw->fifo_depth))
+		hw->fifo_depth = 1;
+
 	altera_spi_init_master(master);
 
+	/* DMA needs the address of the registers on the bus */
+	if (type != ALTERA_SPI_TYPE_SUBDEV) {
+		err = altera_spi_init_dma(master);
+		if (err)
+			goto exit;
+
+		/* the master may be gone by the time devres is released */
+		err = devm_add_action_or_reset(&pdev->dev,
+					       altera_spi_release_dma_action,
+					       spi_master_get(master));
+		if (err)
+			goto exit;
+	}
+
 	/* irq is optional */
 	hw->irq = platform_get_irq(pdev, 0);
 	if (hw->irq >= 0) {
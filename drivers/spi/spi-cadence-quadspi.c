@@ -27,6 +27,7 @@
 #include <linux/pm_runtime.h>
 #include <linux/reset.h>
 #include <linux/sched.h>
+#include <linux/sizes.h>
 #include <linux/spi/spi.h>
 #include <linux/spi/spi-mem.h>
 #include <linux/timer.h>
@@ -46,6 +47,29 @@
 
 #define CQSPI_OP_WIDTH(part) ((part).nbytes ? ilog2((part).buswidth) : 0)
 
+/* Smallest read sent through the direct access controller in auto mode */
+#define CQSPI_DIRECT_READ_MIN		SZ_4K
+
+enum cqspi_read_mode {
+	CQSPI_READ_MODE_INDIRECT,
+	CQSPI_READ_MODE_AUTO,
+	CQSPI_READ_MODE_DIRECT,
+};
+
+enum cqspi_read_path {
+	CQSPI_READ_PATH_INDIRECT,
+	CQSPI_READ_PATH_INDIRECT_DMA,
+	CQSPI_READ_PATH_DIRECT,
+	CQSPI_READ_PATH_DIRECT_DMA,
+	CQSPI_READ_PATH_MAX,
+};
+
+struct cqspi_read_stats {
+	u64		ops;
+	u64		bytes;
+	u64		ns;
+};
+
 struct cqspi_st;
 
 struct cqspi_flash_pdata {
@@ -74,6 +98,9 @@ struct cqspi_st {
 	struct completion	rx_dma_complete;
 	dma_addr_t		mmap_phys_base;
 
+	struct dma_chan		*tx_chan;
+	struct completion	tx_dma_complete;
+
 	int			current_cs;
 	unsigned long		master_ref_clk_hz;
 	bool			is_decoded_cs;
@@ -89,6 +116,10 @@ struct cqspi_st {
 	u32			pd_dev_id;
 	bool			wr_completion;
 	bool			slow_sram;
+
+	enum cqspi_read_mode	read_mode;
+	u32			direct_read_min;
+	struct cqspi_read_stats	read_stats[CQSPI_READ_PATH_MAX];
 };
 
 struct cqspi_driver_platdata {
@@ -275,6 +306,10 @@ struct cqspi_driver_platdata {
 #define CQSPI_IRQ_STATUS_MASK		0x1FFFF
 #define CQSPI_DMA_UNALIGN		0x3
 
+/* Peripheral request sizes of the indirect write DMA, in bytes */
+#define CQSPI_TX_DMA_SINGLE		4
+#define CQSPI_TX_DMA_BURST		64
+
 #define CQSPI_REG_VERSAL_DMA_VAL		0x602
 
 static int cqspi_wait_for_bit(void __iomem *reg, const u32 mask, bool clr)
@@ -1038,6 +1073,162 @@ static int cqspi_indirect_write_execute(struct cqspi_flash_pdata *f_pdata,
 	return ret;
 }
 
+static void cqspi_tx_dma_callback(void *param)
+{
+	struct cqspi_st *cqspi = param;
+
+	complete(&cqspi->tx_dma_complete);
+}
+
+/*
+ * Let the DMA engine feed the write SRAM through the peripheral request
+ * interface of the controller instead of the CPU. The controller raises the
+ * requests as the SRAM drains, so the CPU only sleeps until the DMA and the
+ * indirect transfer complete.
+ */
+static int cqspi_indirect_write_dma(struct cqspi_flash_pdata *f_pdata,
+				    loff_t to_addr, const u8 *txbuf,
+				    const size_t n_tx)
+{
+	struct cqspi_st *cqspi = f_pdata->cqspi;
+	struct device *dev = &cqspi->pdev->dev;
+	void __iomem *reg_base = cqspi->iobase;
+	struct dma_async_tx_descriptor *tx;
+	unsigned long timeout;
+	size_t bytes_to_dma;
+	dma_cookie_t cookie;
+	struct device *ddev;
+	dma_addr_t dma_addr;
+	u8 bytes_rem;
+	u32 reg;
+	int ret;
+
+	bytes_rem = n_tx % 4;
+	bytes_to_dma = n_tx - bytes_rem;
+
+	if (!bytes_to_dma)
+		goto nondmawr;
+
+	ddev = cqspi->tx_chan->device->dev;
+	dma_addr = dma_map_single(ddev, (void *)txbuf, bytes_to_dma,
+				  DMA_TO_DEVICE);
+	if (dma_mapping_error(ddev, dma_addr)) {
+		dev_err(dev, "dma mapping failed\n");
+		return -ENOMEM;
+	}
+
+	tx = dmaengine_prep_slave_single(cqspi->tx_chan, dma_addr,
+					 bytes_to_dma, DMA_MEM_TO_DEV,
+					 DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
+	if (!tx) {
+		dev_err(dev, "device_prep_slave_single error\n");
+		ret = -EIO;
+		goto err_unmap;
+	}
+
+	tx->callback = cqspi_tx_dma_callback;
+	tx->callback_param = cqspi;
+	reinit_completion(&cqspi->tx_dma_complete);
+	cookie = dmaengine_submit(tx);
+
+	ret = dma_submit_error(cookie);
+	if (ret) {
+		dev_err(dev, "dma_submit_error %d\n", cookie);
+		ret = -EIO;
+		goto err_unmap;
+	}
+
+	reg = readl(reg_base + CQSPI_REG_CONFIG);
+	reg |= CQSPI_REG_CONFIG_DMA_MASK;
+	writel(reg, reg_base + CQSPI_REG_CONFIG);
+
+	writel((ilog2(CQSPI_TX_DMA_SINGLE) << CQSPI_REG_DMA_SINGLE_LSB) |
+	       (ilog2(CQSPI_TX_DMA_BURST) << CQSPI_REG_DMA_BURST_LSB),
+	       reg_base + CQSPI_REG_DMA);
+
+	writel(to_addr, reg_base + CQSPI_REG_INDIRECTWRSTARTADDR);
+	writel(bytes_to_dma, reg_base + CQSPI_REG_INDIRECTWRBYTES);
+
+	/* Clear all interrupts. */
+	writel(CQSPI_IRQ_STATUS_MASK, reg_base + CQSPI_REG_IRQSTATUS);
+
+	/* Only the completion, the SRAM level is handled by the DMA. */
+	writel(CQSPI_REG_IRQ_IND_COMP, reg_base + CQSPI_REG_IRQMASK);
+
+	reinit_completion(&cqspi->transfer_complete);
+	writel(CQSPI_REG_INDIRECTWR_START_MASK,
+	       reg_base + CQSPI_REG_INDIRECTWR);
+	if (cqspi->wr_delay)
+		ndelay(cqspi->wr_delay);
+
+	dma_async_issue_pending(cqspi->tx_chan);
+
+	timeout = msecs_to_jiffies(max_t(size_t, bytes_to_dma,
+					 CQSPI_TIMEOUT_MS));
+	if (!wait_for_completion_timeout(&cqspi->tx_dma_complete, timeout)) {
+		dmaengine_terminate_sync(cqspi->tx_chan);
+		dev_err(dev, "Indirect write DMA timeout\n");
+		ret = -ETIMEDOUT;
+		goto failwr;
+	}
+
+	if (!wait_for_completion_timeout(&cqspi->transfer_complete,
+					 msecs_to_jiffies(CQSPI_TIMEOUT_MS))) {
+		dev_err(dev, "Indirect write timeout\n");
+		ret = -ETIMEDOUT;
+		goto failwr;
+	}
+
+	/* Check indirect done status */
+	ret = cqspi_wait_for_bit(reg_base + CQSPI_REG_INDIRECTWR,
+				 CQSPI_REG_INDIRECTWR_DONE_MASK, 0);
+	if (ret) {
+		dev_err(dev, "Indirect write completion error (%i)\n", ret);
+		goto failwr;
+	}
+
+	/* Disable interrupt. */
+	writel(0, reg_base + CQSPI_REG_IRQMASK);
+
+	/* Clear indirect completion status */
+	writel(CQSPI_REG_INDIRECTWR_DONE_MASK, reg_base + CQSPI_REG_INDIRECTWR);
+
+	reg = readl(reg_base + CQSPI_REG_CONFIG);
+	reg &= ~CQSPI_REG_CONFIG_DMA_MASK;
+	writel(reg, reg_base + CQSPI_REG_CONFIG);
+
+	dma_unmap_single(ddev, dma_addr, bytes_to_dma, DMA_TO_DEVICE);
+
+	ret = cqspi_wait_idle(cqspi);
+	if (ret)
+		return ret;
+
+nondmawr:
+	if (bytes_rem)
+		return cqspi_indirect_write_execute(f_pdata,
+						    to_addr + bytes_to_dma,
+						    txbuf + bytes_to_dma,
+						    bytes_rem);
+
+	return 0;
+
+failwr:
+	/* Disable interrupt. */
+	writel(0, reg_base + CQSPI_REG_IRQMASK);
+
+	/* Cancel the indirect write */
+	writel(CQSPI_REG_INDIRECTWR_CANCEL_MASK,
+	       reg_base + CQSPI_REG_INDIRECTWR);
+
+	reg = readl(reg_base + CQSPI_REG_CONFIG);
+	reg &= ~CQSPI_REG_CONFIG_DMA_MASK;
+	writel(reg, reg_base + CQSPI_REG_CONFIG);
+err_unmap:
+	dma_unmap_single(ddev, dma_addr, bytes_to_dma, DMA_TO_DEVICE);
+
+	return ret;
+}
+
 static void cqspi_chipselect(struct cqspi_flash_pdata *f_pdata)
 {
 	struct cqspi_st *cqspi = f_pdata->cqspi;
@@ -1219,6 +1410,10 @@ static ssize_t cqspi_write(struct cqspi_flash_pdata *f_pdata,
 		return cqspi_wait_idle(cqspi);
 	}
 
+	if (cqspi->tx_chan && len >= CQSPI_TX_DMA_BURST &&
+	    virt_addr_valid(buf) && !((uintptr_t)buf & CQSPI_DMA_UNALIGN))
+		return cqspi_indirect_write_dma(f_pdata, to, buf, len);
+
 	return cqspi_indirect_write_execute(f_pdata, to, buf, len);
 }
 
@@ -1288,6 +1483,53 @@ static int cqspi_direct_read_execute(struct cqspi_flash_pdata *f_pdata,
 	return ret;
 }
 
+/*
+ * Controllers which don't use the direct access controller for writes keep
+ * it disabled and only turn it on around direct reads.
+ */
+static void cqspi_direct_read_enable(struct cqspi_st *cqspi, bool enable)
+{
+	void __iomem *reg_base = cqspi->iobase;
+	unsigned int reg;
+
+	if (cqspi->use_direct_mode)
+		return;
+
+	cqspi_controller_enable(cqspi, 0);
+
+	reg = readl(reg_base + CQSPI_REG_CONFIG);
+	if (enable)
+		reg |= CQSPI_REG_CONFIG_ENB_DIR_ACC_CTRL;
+	else
+		reg &= ~CQSPI_REG_CONFIG_ENB_DIR_ACC_CTRL;
+	writel(reg, reg_base + CQSPI_REG_CONFIG);
+
+	cqspi_controller_enable(cqspi, 1);
+}
+
+static bool cqspi_read_is_direct(struct cqspi_st *cqspi, const u_char *buf,
+				 loff_t from, size_t len)
+{
+	if ((from + len) > cqspi->ahb_size)
+		return false;
+
+	switch (cqspi->read_mode) {
+	case CQSPI_READ_MODE_DIRECT:
+		return true;
+	case CQSPI_READ_MODE_AUTO:
+		/*
+		 * Large reads which the memcpy DMA channel can take straight
+		 * into the buffer are the only ones the AHB path is faster
+		 * for, everything else goes through the SRAM.
+		 */
+		return len >= cqspi->direct_read_min && cqspi->rx_chan &&
+		       virt_addr_valid(buf) &&
+		       !((uintptr_t)buf & CQSPI_DMA_UNALIGN);
+	default:
+		return false;
+	}
+}
+
 static ssize_t cqspi_read(struct cqspi_flash_pdata *f_pdata,
 			  const struct spi_mem_op *op)
 {
@@ -1298,6 +1540,9 @@ static ssize_t cqspi_read(struct cqspi_flash_pdata *f_pdata,
 	size_t len = op->data.nbytes;
 	u_char *buf = op->data.buf.in;
 	u64 dma_align = (u64)(uintptr_t)buf;
+	struct cqspi_read_stats *stats;
+	enum cqspi_read_path path;
+	u64 start;
 	int ret;
 
 	ddata = of_device_get_match_data(dev);
@@ -1306,14 +1551,35 @@ static ssize_t cqspi_read(struct cqspi_flash_pdata *f_pdata,
 	if (ret)
 		return ret;
 
-	if (cqspi->use_direct_mode && ((from + len) <= cqspi->ahb_size))
-		return cqspi_direct_read_execute(f_pdata, buf, from, len);
+	start = ktime_get_ns();
 
-	if (cqspi->use_dma_read && ddata && ddata->indirect_read_dma &&
-	    virt_addr_valid(buf) && ((dma_align & CQSPI_DMA_UNALIGN) == 0))
-		return ddata->indirect_read_dma(f_pdata, buf, from, len);
+	if (cqspi_read_is_direct(cqspi, buf, from, len)) {
+		if (cqspi->rx_chan && virt_addr_valid(buf))
+			path = CQSPI_READ_PATH_DIRECT_DMA;
+		else
+			path = CQSPI_READ_PATH_DIRECT;
+
+		cqspi_direct_read_enable(cqspi, true);
+		ret = cqspi_direct_read_execute(f_pdata, buf, from, len);
+		cqspi_direct_read_enable(cqspi, false);
+	} else if (cqspi->use_dma_read && ddata && ddata->indirect_read_dma &&
+		   virt_addr_valid(buf) &&
+		   ((dma_align & CQSPI_DMA_UNALIGN) == 0)) {
+		path = CQSPI_READ_PATH_INDIRECT_DMA;
+		ret = ddata->indirect_read_dma(f_pdata, buf, from, len);
+	} else {
+		path = CQSPI_READ_PATH_INDIRECT;
+		ret = cqspi_indirect_read_execute(f_pdata, buf, from, len);
+	}
 
-	return cqspi_indirect_read_execute(f_pdata, buf, from, len);
+	if (!ret) {
+		stats = &cqspi->read_stats[path];
+		stats->ops++;
+		stats->bytes += len;
+		stats->ns += ktime_get_ns() - start;
+	}
+
+	return ret;
 }
 
 static int cqspi_mem_process(struct spi_mem *mem, const struct spi_mem_op *op)
@@ -1516,6 +1782,44 @@ static int cqspi_request_mmap_dma(struct cqspi_st *cqspi)
 	return 0;
 }
 
+/*
+ * The slave channel feeding the write SRAM is optional, without a "tx" DMA
+ * in the device tree the CPU keeps doing it.
+ */
+static int cqspi_request_tx_dma(struct cqspi_st *cqspi)
+{
+	struct device *dev = &cqspi->pdev->dev;
+	struct dma_slave_config conf = {
+		.direction = DMA_MEM_TO_DEV,
+		.dst_addr = cqspi->mmap_phys_base,
+		.dst_addr_width = DMA_SLAVE_BUSWIDTH_4_BYTES,
+		.dst_maxburst = CQSPI_TX_DMA_BURST / 4,
+	};
+	struct dma_chan *chan;
+	int ret;
+
+	chan = dma_request_chan(dev, "tx");
+	if (IS_ERR(chan)) {
+		ret = PTR_ERR(chan);
+		if (ret == -ENODEV)
+			return 0;
+
+		return dev_err_probe(dev, ret, "No Tx DMA available\n");
+	}
+
+	ret = dmaengine_slave_config(chan, &conf);
+	if (ret) {
+		dev_err(dev, "Tx DMA slave config failed %d\n", ret);
+		dma_release_channel(chan);
+		return ret;
+	}
+
+	cqspi->tx_chan = chan;
+	init_completion(&cqspi->tx_dma_complete);
+
+	return 0;
+}
+
 static const char *cqspi_get_name(struct spi_mem *mem)
 {
 	struct cqspi_st *cqspi = spi_master_get_devdata(mem->spi->master);
@@ -1524,6 +1828,132 @@ static const char *cqspi_get_name(struct spi_mem *mem)
 	return devm_kasprintf(dev, GFP_KERNEL, "%s.%d", dev_name(dev), mem->spi->chip_select);
 }
 
+static const char * const cqspi_read_mode_names[] = {
+	[CQSPI_READ_MODE_INDIRECT] = "indirect",
+	[CQSPI_READ_MODE_AUTO] = "auto",
+	[CQSPI_READ_MODE_DIRECT] = "direct",
+};
+
+static ssize_t read_mode_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	struct cqspi_st *cqspi = dev_get_drvdata(dev);
+	ssize_t len = 0;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(cqspi_read_mode_names); i++) {
+		if (i == cqspi->read_mode)
+			len += sysfs_emit_at(buf, len, "[%s] ",
+					     cqspi_read_mode_names[i]);
+		else
+			len += sysfs_emit_at(buf, len, "%s ",
+					     cqspi_read_mode_names[i]);
+	}
+	buf[len - 1] = '\n';
+
+	return len;
+}
+
+static ssize_t read_mode_store(struct device *dev,
+			       struct device_attribute *attr,
+			       const char *buf, size_t count)
+{
+	struct cqspi_st *cqspi = dev_get_drvdata(dev);
+	int mode;
+
+	mode = sysfs_match_string(cqspi_read_mode_names, buf);
+	if (mode < 0)
+		return mode;
+
+	mutex_lock(&cqspi->master->io_mutex);
+	/* the AHB reads are only worth it if they can be done by DMA */
+	if (mode != CQSPI_READ_MODE_INDIRECT && !cqspi->rx_chan)
+		cqspi_request_mmap_dma(cqspi);
+	cqspi->read_mode = mode;
+	mutex_unlock(&cqspi->master->io_mutex);
+
+	return count;
+}
+static DEVICE_ATTR_RW(read_mode);
+
+static ssize_t direct_read_min_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct cqspi_st *cqspi = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%u\n", cqspi->direct_read_min);
+}
+
+static ssize_t direct_read_min_store(struct device *dev,
+				     struct device_attribute *attr,
+				     const char *buf, size_t count)
+{
+	struct cqspi_st *cqspi = dev_get_drvdata(dev);
+	u32 val;
+	int ret;
+
+	ret = kstrtou32(buf, 0, &val);
+	if (ret)
+		return ret;
+
+	cqspi->direct_read_min = val;
+
+	return count;
+}
+static DEVICE_ATTR_RW(direct_read_min);
+
+static ssize_t read_stats_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	static const char * const names[CQSPI_READ_PATH_MAX] = {
+		[CQSPI_READ_PATH_INDIRECT] = "indirect",
+		[CQSPI_READ_PATH_INDIRECT_DMA] = "indirect_dma",
+		[CQSPI_READ_PATH_DIRECT] = "direct",
+		[CQSPI_READ_PATH_DIRECT_DMA] = "direct_dma",
+	};
+	struct cqspi_st *cqspi = dev_get_drvdata(dev);
+	struct cqspi_read_stats stats[CQSPI_READ_PATH_MAX];
+	ssize_t len = 0;
+	int i;
+
+	mutex_lock(&cqspi->master->io_mutex);
+	memcpy(stats, cqspi->read_stats, sizeof(stats));
+	mutex_unlock(&cqspi->master->io_mutex);
+
+	len += sysfs_emit_at(buf, len, "%-14s %12s %16s %16s %10s\n",
+			     "path", "ops", "bytes", "ns", "KiB/s");
+	for (i = 0; i < CQSPI_READ_PATH_MAX; i++)
+		len += sysfs_emit_at(buf, len, "%-14s %12llu %16llu %16llu %10llu\n",
+				     names[i], stats[i].ops, stats[i].bytes,
+				     stats[i].ns, stats[i].ns ?
+				     div64_u64(stats[i].bytes * NSEC_PER_SEC,
+					       stats[i].ns) >> 10 : 0);
+
+	return len;
+}
+
+static ssize_t read_stats_store(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	struct cqspi_st *cqspi = dev_get_drvdata(dev);
+
+	mutex_lock(&cqspi->master->io_mutex);
+	memset(cqspi->read_stats, 0, sizeof(cqspi->read_stats));
+	mutex_unlock(&cqspi->master->io_mutex);
+
+	return count;
+}
+static DEVICE_ATTR_RW(read_stats);
+
+static struct attribute *cqspi_attrs[] = {
+	&dev_attr_read_mode.attr,
+	&dev_attr_direct_read_min.attr,
+	&dev_attr_read_stats.attr,
+	NULL
+};
+ATTRIBUTE_GROUPS(cqspi);
+
 static const struct spi_controller_mem_ops cqspi_mem_ops = {
 	.exec_op = cqspi_exec_mem_op,
 	.get_name = cqspi_get_name,
@@ -1679,6 +2109,7 @@ static int cqspi_probe(struct platform_device *pdev)
 
 	/* write completion is supported by default */
 	cqspi->wr_completion = true;
+	cqspi->direct_read_min = CQSPI_DIRECT_READ_MIN;
 
 	ddata  = of_device_get_match_data(dev);
 	if (ddata) {
@@ -1695,6 +2126,8 @@ static int cqspi_probe(struct platform_device *pdev)
 			cqspi->wr_completion = false;
 		if (ddata->quirks & CQSPI_SLOW_SRAM)
 			cqspi->slow_sram = true;
+		if (cqspi->use_direct_mode)
+			cqspi->read_mode = CQSPI_READ_MODE_DIRECT;
 
 		if (of_device_is_compatible(pdev->dev.of_node,
 					    "xlnx,versal-ospi-1.0")) {
@@ -1730,13 +2163,23 @@ static int cqspi_probe(struct platform_device *pdev)
 			goto probe_setup_failed;
 	}
 
+	ret = cqspi_request_tx_dma(cqspi);
+	if (ret)
+		goto probe_tx_dma_failed;
+
 	ret = spi_register_master(master);
 	if (ret) {
 		dev_err(&pdev->dev, "failed to register SPI ctlr %d\n", ret);
-		goto probe_setup_failed;
+		goto probe_dma_failed;
 	}
 
 	return 0;
+probe_dma_failed:
+	if (cqspi->tx_chan)
+		dma_release_channel(cqspi->tx_chan);
+probe_tx_dma_failed:
+	if (cqspi->rx_chan)
+		dma_release_channel(cqspi->rx_chan);
 probe_setup_failed:
 	cqspi_controller_enable(cqspi, 0);
 probe_reset_failed:
@@ -1758,6 +2201,9 @@ static int cqspi_remove(struct platform_device *pdev)
 	if (cqspi->rx_chan)
 		dma_release_channel(cqspi->rx_chan);
 
+	if (cqspi->tx_chan)
+		dma_release_channel(cqspi->tx_chan);
+
 	clk_disable_unprepare(cqspi->clk);
 
 	pm_runtime_put_sync(&pdev->dev);
@@ -1864,6 +2310,7 @@ static struct platform_driver cqspi_platform_driver = {
 		.name = CQSPI_NAME,
 		.pm = &cqspi_dev_pm_ops,
 		.of_match_table = cqspi_dt_ids,
+		.dev_groups = cqspi_groups,
 	},
 };
 
@@ -8,6 +8,7 @@
 #include <linux/bitfield.h>
 #include <linux/dma-mapping.h>
 #include <linux/interrupt.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/preempt.h>
 #include <linux/highmem.h>
@@ -20,6 +21,15 @@
 
 #include "spi-dw.h"
 
+/* Transfers lasting less than this on the wire are done in polling mode */
+static unsigned int polling_limit_us = 30;
+module_param(polling_limit_us, uint, 0664);
+MODULE_PARM_DESC(polling_limit_us,
+		 "time in us to run a transfer in polling mode");
+
+/* Bounds of the learnt PIO/DMA crossover, in FIFO depths */
+#define DW_SPI_DMA_THRESH_MAX		32
+
 #ifdef CONFIG_DEBUG_FS
 #include <linux/debugfs.h>
 #endif
@@ -70,6 +80,7 @@ static int dw_spi_debugfs_init(struct dw_spi *dws)
 	dws->regset.nregs = ARRAY_SIZE(dw_spi_dbgfs_regs);
 	dws->regset.base = dws->regs;
 	debugfs_create_regset32("registers", 0400, dws->debugfs, &dws->regset);
+	debugfs_create_u32("dma_thresh", 0400, dws->debugfs, &dws->dma_thresh);
 
 	return 0;
 }
@@ -213,6 +224,46 @@ int dw_spi_check_status(struct dw_spi *dws, bool raw)
 }
 EXPORT_SYMBOL_NS_GPL(dw_spi_check_status, SPI_DW_CORE);
 
+static u64 dw_spi_ewma(u64 avg, u64 sample)
+{
+	return avg ? (avg * 7 + sample) / 8 : sample;
+}
+
+/*
+ * Learn what a DMA transfer and an interrupt refilling the FIFO cost on top
+ * of the time the data takes on the wire, and move the PIO/DMA crossover to
+ * the length where PIO needs as much time in interrupts as DMA does to set
+ * up and complete a transfer.  The crossover is only changed between two
+ * messages, as the core maps the buffers of a message all at once.
+ */
+static void dw_spi_account_xfer(struct dw_spi *dws, bool dma)
+{
+	u64 elapsed = ktime_to_ns(ktime_sub(ktime_get(), dws->xfer_start));
+	u64 overhead = elapsed > dws->xfer_wire_ns ?
+		       elapsed - dws->xfer_wire_ns : 0;
+	unsigned int refills, half = max(dws->fifo_len / 2, 1U);
+	u64 thresh;
+
+	if (!dws->master->can_dma)
+		return;
+
+	if (dma) {
+		dws->dma_overhead_ns = dw_spi_ewma(dws->dma_overhead_ns,
+						   overhead);
+	} else {
+		refills = DIV_ROUND_UP(dws->xfer_len, half);
+		dws->irq_overhead_ns = dw_spi_ewma(dws->irq_overhead_ns,
+						   div_u64(overhead, refills));
+	}
+
+	if (!dws->dma_overhead_ns || !dws->irq_overhead_ns)
+		return;
+
+	thresh = div64_u64(dws->dma_overhead_ns * half, dws->irq_overhead_ns);
+	dws->dma_thresh_next = clamp_t(u64, thresh, dws->fifo_len,
+				       dws->fifo_len * DW_SPI_DMA_THRESH_MAX);
+}
+
 static irqreturn_t dw_spi_transfer_handler(struct dw_spi *dws)
 {
 	u16 irq_status = dw_readl(dws, DW_SPI_ISR);
@@ -232,6 +283,7 @@ static irqreturn_t dw_spi_transfer_handler(struct dw_spi *dws)
 	dw_reader(dws);
 	if (!dws->rx_len) {
 		dw_spi_mask_intr(dws, 0xff);
+		dw_spi_account_xfer(dws, false);
 		spi_finalize_current_transfer(dws->master);
 	} else if (dws->rx_len <= dw_readl(dws, DW_SPI_RXFTLR)) {
 		dw_writel(dws, DW_SPI_RXFTLR, dws->rx_len - 1);
@@ -315,13 +367,11 @@ static u32 dw_spi_prepare_cr0(struct dw_spi *dws, struct spi_device *spi)
 	return cr0;
 }
 
-void dw_spi_update_config(struct dw_spi *dws, struct spi_device *spi,
+static u32 dw_spi_cfg_cr0(struct dw_spi *dws, struct spi_device *spi,
 			  struct dw_spi_cfg *cfg)
 {
 	struct dw_spi_chip_data *chip = spi_get_ctldata(spi);
 	u32 cr0 = chip->cr0;
-	u32 speed_hz;
-	u16 clk_div;
 
 	/* CTRLR0[ 4/3: 0] or CTRLR0[ 20: 16] Data Frame Size */
 	cr0 |= (cfg->dfs - 1) << dws->dfs_offset;
@@ -333,7 +383,37 @@ void dw_spi_update_config(struct dw_spi *dws, struct spi_device *spi,
 		/* CTRLR0[11:10] Transfer Mode */
 		cr0 |= FIELD_PREP(DW_HSSI_CTRLR0_TMOD_MASK, cfg->tmode);
 
+	return cr0;
+}
+
+/*
+ * Whether the controller is already set up for cfg, so that the transfer can
+ * be started without disabling the controller, which would also flush the
+ * FIFOs, to rewrite the same settings.  Only the Transmit & Receive mode
+ * doesn't use CTRLR1.
+ */
+static bool dw_spi_cfg_is_current(struct dw_spi *dws, struct spi_device *spi,
+				  struct dw_spi_cfg *cfg)
+{
+	struct dw_spi_chip_data *chip = spi_get_ctldata(spi);
+	u16 clk_div = (DIV_ROUND_UP(dws->max_freq, cfg->freq) + 1) & 0xfffe;
+
+	return cfg->tmode == DW_SPI_CTRLR0_TMOD_TR &&
+	       dws->cur_cr0 == dw_spi_cfg_cr0(dws, spi, cfg) &&
+	       dws->current_freq == dws->max_freq / clk_div &&
+	       dws->cur_rx_sample_dly == chip->rx_sample_dly;
+}
+
+void dw_spi_update_config(struct dw_spi *dws, struct spi_device *spi,
+			  struct dw_spi_cfg *cfg)
+{
+	struct dw_spi_chip_data *chip = spi_get_ctldata(spi);
+	u32 cr0 = dw_spi_cfg_cr0(dws, spi, cfg);
+	u32 speed_hz;
+	u16 clk_div;
+
 	dw_writel(dws, DW_SPI_CTRLR0, cr0);
+	dws->cur_cr0 = cr0;
 
 	if (cfg->tmode == DW_SPI_CTRLR0_TMOD_EPROMREAD ||
 	    cfg->tmode == DW_SPI_CTRLR0_TMOD_RO)
@@ -423,6 +503,7 @@ static int dw_spi_transfer_one(struct spi_controller *master,
 		.dfs = transfer->bits_per_word,
 		.freq = transfer->speed_hz,
 	};
+	bool reconfig;
 	int ret;
 
 	dws->dma_mapped = 0;
@@ -434,20 +515,31 @@ static int dw_spi_transfer_one(struct spi_controller *master,
 	dws->tx_len = transfer->len / dws->n_bytes;
 	dws->rx = transfer->rx_buf;
 	dws->rx_len = dws->tx_len;
+	dws->xfer_len = dws->tx_len;
 
 	/* Ensure the data above is visible for all CPUs */
 	smp_mb();
 
-	dw_spi_enable_chip(dws, 0);
-
-	dw_spi_update_config(dws, spi, &cfg);
-
-	transfer->effective_speed_hz = dws->current_freq;
-
 	/* Check if current transfer is a DMA transaction */
 	if (master->can_dma && master->can_dma(master, spi, transfer))
 		dws->dma_mapped = master->cur_msg_mapped;
 
+	/*
+	 * A PIO transfer with the settings of the previous one starts right
+	 * away: the previous transfer left the FIFOs empty.
+	 */
+	reconfig = dws->dma_mapped || !dw_spi_cfg_is_current(dws, spi, &cfg);
+	if (reconfig) {
+		dw_spi_enable_chip(dws, 0);
+		dw_spi_update_config(dws, spi, &cfg);
+	}
+
+	transfer->effective_speed_hz = dws->current_freq;
+	dws->xfer_wire_ns = DIV_ROUND_UP_ULL((u64)transfer->len *
+					     BITS_PER_BYTE * NSEC_PER_SEC,
+					     dws->current_freq);
+	dws->xfer_start = ktime_get();
+
 	/* For poll mode just disable all interrupts */
 	dw_spi_mask_intr(dws, 0xff);
 
@@ -457,18 +549,35 @@ static int dw_spi_transfer_one(struct spi_controller *master,
 			return ret;
 	}
 
-	dw_spi_enable_chip(dws, 1);
+	if (reconfig)
+		dw_spi_enable_chip(dws, 1);
 
-	if (dws->dma_mapped)
-		return dws->dma_ops->dma_transfer(dws, transfer);
-	else if (dws->irq == IRQ_NOTCONNECTED)
+	if (dws->dma_mapped) {
+		ret = dws->dma_ops->dma_transfer(dws, transfer);
+		if (!ret)
+			dw_spi_account_xfer(dws, true);
+		return ret;
+	} else if (dws->irq == IRQ_NOTCONNECTED ||
+		   dws->xfer_wire_ns <= (u64)polling_limit_us * NSEC_PER_USEC) {
+		/* not worth the interrupt latency */
 		return dw_spi_poll_transfer(dws, transfer);
+	}
 
 	dw_spi_irq_setup(dws);
 
 	return 1;
 }
 
+static int dw_spi_prepare_message(struct spi_controller *master,
+				  struct spi_message *msg)
+{
+	struct dw_spi *dws = spi_controller_get_devdata(master);
+
+	dws->dma_thresh = dws->dma_thresh_next;
+
+	return 0;
+}
+
 static void dw_spi_handle_err(struct spi_controller *master,
 			      struct spi_message *msg)
 {
@@ -826,6 +935,7 @@ static void dw_spi_cleanup(struct spi_device *spi)
 static void dw_spi_hw_init(struct device *dev, struct dw_spi *dws)
 {
 	dw_spi_reset_chip(dws);
+	dws->cur_cr0 = 0;
 
 	/*
 	 * Retrieve the Synopsys component version if it hasn't been specified
@@ -859,6 +969,11 @@ static void dw_spi_hw_init(struct device *dev, struct dw_spi *dws)
 		dev_dbg(dev, "Detected FIFO size: %u bytes\n", dws->fifo_len);
 	}
 
+	if (!dws->dma_thresh) {
+		dws->dma_thresh = dws->fifo_len;
+		dws->dma_thresh_next = dws->fifo_len;
+	}
+
 	/*
 	 * Detect CTRLR0.DFS field size and offset by testing the lowest bits
 	 * writability. Note DWC SSI controller also has the extended DFS, but
@@ -932,6 +1047,7 @@ int dw_spi_add_host(struct device *dev, struct dw_spi *dws)
 		master->set_cs = dws->set_cs;
 	else
 		master->set_cs = dw_spi_set_cs;
+	master->prepare_message = dw_spi_prepare_message;
 	master->transfer_one = dw_spi_transfer_one;
 	master->handle_err = dw_spi_handle_err;
 	if (dws->mem_ops.exec_op)
@@ -203,7 +203,7 @@ static bool dw_spi_can_dma(struct spi_controller *master,
 {
 	struct dw_spi *dws = spi_controller_get_devdata(master);
 
-	return xfer->len > dws->fifo_len;
+	return xfer->len > dws->dma_thresh;
 }
 
 static enum dma_slave_buswidth dw_spi_dma_convert_width(u8 n_bytes)
@@ -180,6 +180,16 @@ struct dw_spi {
 	u32			current_freq;	/* frequency in hz */
 	u32			cur_rx_sample_dly;
 	u32			def_rx_sample_dly_ns;
+	u32			cur_cr0;	/* CTRLR0 value, 0 if unknown */
+
+	/* PIO/DMA crossover learnt from the transfer durations */
+	u32			dma_thresh;	/* DMA above this length */
+	u32			dma_thresh_next; /* from the next message */
+	u64			dma_overhead_ns; /* per DMA transfer */
+	u64			irq_overhead_ns; /* per FIFO refill */
+	ktime_t			xfer_start;
+	u64			xfer_wire_ns;
+	unsigned int		xfer_len;	/* in frames */
 
 	/* Custom memory operations */
 	struct spi_controller_mem_ops mem_ops;
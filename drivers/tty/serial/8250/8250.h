@@ -51,6 +51,21 @@ struct uart_8250_dma {
 	unsigned char		tx_running;
 	unsigned char		tx_err;
 	unsigned char		rx_running;
+
+	/*
+	 * Set by the driver to receive into a ring with a cyclic transfer,
+	 * cleared when the RX channel can't do it.
+	 */
+	unsigned char		rx_cyclic;
+	/* Cyclic transfer paused while the FIFO is read by PIO */
+	unsigned char		rx_paused;
+	/* Offset in the ring of the next character to pass to the tty */
+	unsigned int		rx_tail;
+	struct timer_list	rx_timer;
+	struct uart_8250_port	*rx_port;
+
+	/* TX pending characters, two segments when wrapping */
+	struct scatterlist	tx_sg[2];
 };
 
 struct old_serial_port {
@@ -346,6 +361,7 @@ static inline int is_omap1510_8250(struct uart_8250_port *pt)
 extern int serial8250_tx_dma(struct uart_8250_port *);
 extern int serial8250_rx_dma(struct uart_8250_port *);
 extern void serial8250_rx_dma_flush(struct uart_8250_port *);
+extern void serial8250_rx_dma_resume(struct uart_8250_port *);
 extern int serial8250_request_dma(struct uart_8250_port *);
 extern void serial8250_release_dma(struct uart_8250_port *);
 
@@ -381,6 +397,7 @@ static inline int serial8250_rx_dma(struct uart_8250_port *p)
 	return -1;
 }
 static inline void serial8250_rx_dma_flush(struct uart_8250_port *p) { }
+static inline void serial8250_rx_dma_resume(struct uart_8250_port *p) { }
 static inline int serial8250_request_dma(struct uart_8250_port *p)
 {
 	return -1;
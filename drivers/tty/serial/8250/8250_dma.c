@@ -65,6 +65,105 @@ static void __dma_rx_complete(void *param)
 	tty_flip_buffer_push(tty_port);
 }
 
+/*
+ * Pass the characters the cyclic transfer stored since the last call to the
+ * tty, returns whether there were any.  Called with the port lock held.
+ */
+static bool dma_rx_cyclic_push(struct uart_8250_port *p)
+{
+	struct uart_8250_dma	*dma = p->dma;
+	struct tty_port		*tty_port = &p->port.state->port;
+	struct dma_tx_state	state;
+	unsigned int		head, count, done;
+
+	if (dmaengine_tx_status(dma->rxchan, dma->rx_cookie, &state) ==
+	    DMA_ERROR)
+		return false;
+
+	head = (dma->rx_size - state.residue) % dma->rx_size;
+	if (head == dma->rx_tail)
+		return false;
+
+	while (dma->rx_tail != head) {
+		if (head > dma->rx_tail)
+			count = head - dma->rx_tail;
+		else
+			count = dma->rx_size - dma->rx_tail;
+
+		done = tty_insert_flip_string(tty_port,
+					      dma->rx_buf + dma->rx_tail, count);
+		p->port.icount.rx += count;
+		p->port.icount.buf_overrun += count - done;
+		dma->rx_tail = (dma->rx_tail + count) % dma->rx_size;
+	}
+
+	tty_flip_buffer_push(tty_port);
+
+	return true;
+}
+
+/*
+ * A period is only completed every rx_size / 4 characters: while characters
+ * come in, pass what the ring holds at the pace of the FIFO timeout, which
+ * doesn't depend on the baud rate once the characters go by faster than a
+ * jiffy.  The timer stops once the line is idle, and is armed again by the
+ * next period completed or RX interrupt.
+ */
+static void dma_rx_cyclic_arm(struct uart_8250_port *p)
+{
+	mod_timer(&p->dma->rx_timer, jiffies + uart_poll_timeout(&p->port));
+}
+
+static void dma_rx_cyclic_complete(void *param)
+{
+	struct uart_8250_port *p = param;
+	unsigned long flags;
+
+	spin_lock_irqsave(&p->port.lock, flags);
+	if (p->dma->rx_running) {
+		dma_rx_cyclic_push(p);
+		dma_rx_cyclic_arm(p);
+	}
+	spin_unlock_irqrestore(&p->port.lock, flags);
+}
+
+static void dma_rx_cyclic_timer(struct timer_list *t)
+{
+	struct uart_8250_dma *dma = from_timer(dma, t, rx_timer);
+	struct uart_8250_port *p = dma->rx_port;
+	unsigned long flags;
+
+	spin_lock_irqsave(&p->port.lock, flags);
+	if (dma->rx_running && dma_rx_cyclic_push(p))
+		dma_rx_cyclic_arm(p);
+	spin_unlock_irqrestore(&p->port.lock, flags);
+}
+
+static int dma_rx_cyclic_start(struct uart_8250_port *p)
+{
+	struct uart_8250_dma		*dma = p->dma;
+	struct dma_async_tx_descriptor	*desc;
+
+	desc = dmaengine_prep_dma_cyclic(dma->rxchan, dma->rx_addr,
+					 dma->rx_size, dma->rx_size / 4,
+					 DMA_DEV_TO_MEM, DMA_PREP_INTERRUPT);
+	if (!desc)
+		return -EBUSY;
+
+	dma->rx_running = 1;
+	dma->rx_tail = 0;
+	desc->callback = dma_rx_cyclic_complete;
+	desc->callback_param = p;
+
+	dma->rx_cookie = dmaengine_submit(desc);
+
+	dma_async_issue_pending(dma->rxchan);
+
+	dma_rx_cyclic_arm(p);
+
+	return 0;
+}
+
 static void dma_rx_complete(void *param)
 {
 	struct uart_8250_port *p = param;
@@ -83,6 +182,8 @@ int serial8250_tx_dma(struct uart_8250_port *p)
 	struct circ_buf			*xmit = &p->port.state->xmit;
 	struct dma_async_tx_descriptor	*desc;
 	struct uart_port		*up = &p->port;
+	unsigned int			count;
+	int				nents = 1;
 	int ret;
 
 	if (dma->tx_running) {
@@ -101,14 +202,24 @@ int serial8250_tx_dma(struct uart_8250_port *p)
 		return 0;
 	}
 
-	dma->tx_size = CIRC_CNT_TO_END(xmit->head, xmit->tail, UART_XMIT_SIZE);
+	/* Send both segments of a wrapping buffer in one go */
+	dma->tx_size = uart_circ_chars_pending(xmit);
+	count = CIRC_CNT_TO_END(xmit->head, xmit->tail, UART_XMIT_SIZE);
+
+	sg_init_table(dma->tx_sg, ARRAY_SIZE(dma->tx_sg));
+	sg_dma_address(&dma->tx_sg[0]) = dma->tx_addr + xmit->tail;
+	sg_dma_len(&dma->tx_sg[0]) = count;
+	if (dma->tx_size > count) {
+		sg_dma_address(&dma->tx_sg[1]) = dma->tx_addr;
+		sg_dma_len(&dma->tx_sg[1]) = dma->tx_size - count;
+		nents = 2;
+	}
 
 	serial8250_do_prepare_tx_dma(p);
 
-	desc = dmaengine_prep_slave_single(dma->txchan,
-					   dma->tx_addr + xmit->tail,
-					   dma->tx_size, DMA_MEM_TO_DEV,
-					   DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
+	desc = dmaengine_prep_slave_sg(dma->txchan, dma->tx_sg, nents,
+				       DMA_MEM_TO_DEV,
+				       DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
 	if (!desc) {
 		ret = -EBUSY;
 		goto err;
@@ -138,11 +249,18 @@ int serial8250_rx_dma(struct uart_8250_port *p)
 	struct uart_8250_dma		*dma = p->dma;
 	struct dma_async_tx_descriptor	*desc;
 
-	if (dma->rx_running)
+	if (dma->rx_running) {
+		/* characters are coming in, pass them while they do */
+		if (dma->rx_cyclic)
+			dma_rx_cyclic_arm(p);
 		return 0;
+	}
 
 	serial8250_do_prepare_rx_dma(p);
 
+	if (dma->rx_cyclic)
+		return dma_rx_cyclic_start(p);
+
 	desc = dmaengine_prep_slave_single(dma->rxchan, dma->rx_addr,
 					   dma->rx_size, DMA_DEV_TO_MEM,
 					   DMA_PREP_INTERRUPT | DMA_CTRL_ACK);
@@ -164,6 +282,17 @@ void serial8250_rx_dma_flush(struct uart_8250_port *p)
 {
 	struct uart_8250_dma *dma = p->dma;
 
+	/*
+	 * The cyclic transfer is only paused while the characters left in the
+	 * FIFO are read by PIO, see serial8250_rx_dma_resume().  A channel
+	 * which can't be paused is left to drain the FIFO itself.
+	 */
+	if (dma->rx_running && dma->rx_cyclic) {
+		dma->rx_paused = !dmaengine_pause(dma->rxchan);
+		dma_rx_cyclic_push(p);
+		return;
+	}
+
 	if (dma->rx_running) {
 		dmaengine_pause(dma->rxchan);
 		__dma_rx_complete(p);
@@ -172,6 +301,17 @@ void serial8250_rx_dma_flush(struct uart_8250_port *p)
 }
 EXPORT_SYMBOL_GPL(serial8250_rx_dma_flush);
 
+/* Restart the cyclic transfer paused by serial8250_rx_dma_flush() */
+void serial8250_rx_dma_resume(struct uart_8250_port *p)
+{
+	struct uart_8250_dma *dma = p->dma;
+
+	if (dma->rx_paused) {
+		dmaengine_resume(dma->rxchan);
+		dma->rx_paused = 0;
+	}
+}
+
 int serial8250_request_dma(struct uart_8250_port *p)
 {
 	struct uart_8250_dma	*dma = p->dma;
@@ -214,6 +354,9 @@ int serial8250_request_dma(struct uart_8250_port *p)
 
 	dmaengine_slave_config(dma->rxchan, &dma->rxconf);
 
+	if (!dma_has_cap(DMA_CYCLIC, dma->rxchan->device->cap_mask))
+		dma->rx_cyclic = 0;
+
 	/* Get a channel for TX */
 	dma->txchan = dma_request_slave_channel_compat(mask,
 						       dma->fn, dma->tx_param,
@@ -257,6 +400,9 @@ int serial8250_request_dma(struct uart_8250_port *p)
 		goto err;
 	}
 
+	dma->rx_port = p;
+	timer_setup(&dma->rx_timer, dma_rx_cyclic_timer, 0);
+
 	dev_dbg_ratelimited(p->port.dev, "got both dma channels\n");
 
 	return 0;
@@ -276,6 +422,11 @@ void serial8250_release_dma(struct uart_8250_port *p)
 		return;
 
 	/* Release RX resources */
+	if (dma->rx_cyclic) {
+		del_timer_sync(&dma->rx_timer);
+		dma->rx_running = 0;
+		dma->rx_paused = 0;
+	}
 	dmaengine_terminate_sync(dma->rxchan);
 	dma_free_coherent(dma->rxchan->device->dev, dma->rx_size, dma->rx_buf,
 			  dma->rx_addr);
@@ -22,6 +22,7 @@
 #include <linux/pm_runtime.h>
 #include <linux/property.h>
 #include <linux/reset.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/workqueue.h>
 
@@ -38,6 +39,8 @@
 
 #define OCTEON_UART_USR	0x27 /* UART Status Register */
 
+#define DW8250_DMA_RX_RING	SZ_16K
+
 #define RZN1_UART_TDMACR 0x10c /* DMA Control Register Transmit Mode */
 #define RZN1_UART_RDMACR 0x110 /* DMA Control Register Receive Mode */
 
@@ -654,6 +657,15 @@ static int dw8250_probe(struct platform_device *pdev)
 	if (p->fifosize) {
 		data->data.dma.rxconf.src_maxburst = p->fifosize / 4;
 		data->data.dma.txconf.dst_maxburst = p->fifosize / 4;
+		/*
+		 * Without a DMA flow controller counting the characters,
+		 * receive into a ring large enough for Mbaud links rather
+		 * than restarting a transfer on every RX timeout.
+		 */
+		if (!(data->pdata->quirks & DW_UART_QUIRK_IS_DMA_FC)) {
+			data->data.dma.rx_cyclic = 1;
+			data->data.dma.rx_size = DW8250_DMA_RX_RING;
+		}
 		up->dma = &data->data.dma;
 	}
 
@@ -1910,13 +1910,16 @@ static bool handle_rx_dma(struct uart_8250_port *up, unsigned int iir)
 		 */
 		return false;
 	case UART_IIR_RDI:
-		if (!up->dma->rx_running)
+		/* the cyclic transfer keeps draining the FIFO */
+		if (!up->dma->rx_running || up->dma->rx_cyclic)
 			break;
 		fallthrough;
 	case UART_IIR_RLSI:
 	case UART_IIR_RX_TIMEOUT:
 		serial8250_rx_dma_flush(up);
-		return true;
+		/* a running cyclic transfer must be paused for the PIO reads */
+		return !(up->dma->rx_cyclic && up->dma->rx_running) ||
+		       up->dma->rx_paused;
 	}
 	return up->dma->rx_dma(up);
 }
@@ -1960,6 +1963,8 @@ int serial8250_handle_irq(struct uart_port *port, unsigned int iir)
 			pm_wakeup_event(tport->tty->dev, 0);
 		if (!up->dma || handle_rx_dma(up, iir))
 			status = serial8250_rx_chars(up, status);
+		if (up->dma)
+			serial8250_rx_dma_resume(up);
 	}
 	serial8250_modem_status(up);
 	if ((status & UART_LSR_THRE) && (up->ier & UART_IER_THRI)) {
@@ -50,6 +50,9 @@
 #define ALTERA_JTAGUART_CONTROL_AC_MSK		0x00000400
 #define ALTERA_JTAGUART_CONTROL_WSPACE_MSK	0xFFFF0000
 
+/* Characters read from the FIFO are passed to the tty in batches. */
+#define ALTERA_JTAGUART_RX_BATCH		64
+
 /*
  * Local per-uart structure.
  */
@@ -126,21 +129,34 @@ static void altera_jtaguart_set_termios(struct uart_port *port,
 static void altera_jtaguart_rx_chars(struct altera_jtaguart *pp)
 {
 	struct uart_port *port = &pp->port;
-	unsigned char ch, flag;
+	struct tty_port *tport = &port->state->port;
+	unsigned char buf[ALTERA_JTAGUART_RX_BATCH], ch;
+	unsigned int count = 0, done;
 	unsigned long status;
 
 	while ((status = readl(port->membase + ALTERA_JTAGUART_DATA_REG)) &
 	       ALTERA_JTAGUART_DATA_RVALID_MSK) {
 		ch = status & ALTERA_JTAGUART_DATA_DATA_MSK;
-		flag = TTY_NORMAL;
 		port->icount.rx++;
 
 		if (uart_handle_sysrq_char(port, ch))
 			continue;
-		uart_insert_char(port, 0, 0, ch, flag);
+
+		buf[count++] = ch;
+		if (count < ARRAY_SIZE(buf))
+			continue;
+
+		done = tty_insert_flip_string(tport, buf, count);
+		port->icount.buf_overrun += count - done;
+		count = 0;
+	}
+
+	if (count) {
+		done = tty_insert_flip_string(tport, buf, count);
+		port->icount.buf_overrun += count - done;
 	}
 
-	tty_flip_buffer_push(&port->state->port);
+	tty_flip_buffer_push(tport);
 }
 
 static void altera_jtaguart_tx_chars(struct altera_jtaguart *pp)
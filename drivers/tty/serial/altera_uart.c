@@ -15,6 +15,8 @@
 #include <linux/interrupt.h>
 #include <linux/module.h>
 #include <linux/console.h>
+#include <linux/dma-mapping.h>
+#include <linux/dmaengine.h>
 #include <linux/tty.h>
 #include <linux/tty_flip.h>
 #include <linux/serial.h>
@@ -71,6 +73,13 @@
 #define ALTERA_UART_CONTROL_RTS_MSK	0x0800	/* RTS signal */
 #define ALTERA_UART_CONTROL_EOP_MSK	0x1000	/* Interrupt on EOP */
 
+/* Characters received without error are passed to the tty in batches. */
+#define ALTERA_UART_RX_BATCH		64
+
+/* Ring the RX DMA channel cycles through, along with its periods */
+#define ALTERA_UART_DMA_RX_SIZE		4096
+#define ALTERA_UART_DMA_RX_PERIOD	256
+
 /*
  * Local per-uart structure.
  */
@@ -79,6 +88,14 @@ struct altera_uart {
 	struct timer_list tmr;
 	unsigned int sigs;	/* Local copy of line sigs */
 	unsigned short imr;	/* Local IMR mirror */
+	struct dma_chan *rx_chan;	/* RX DMA channel, if any */
+	dma_cookie_t rx_cookie;
+	u8 *rx_buf;		/* RX DMA ring */
+	dma_addr_t rx_dma;
+	unsigned int rx_head;	/* Ring offset written by the channel */
+	unsigned int rx_tail;	/* Ring offset passed to the tty */
+	bool rx_residue;	/* Channel reports partly filled periods */
+	struct timer_list dma_tmr;
 };
 
 static u32 altera_uart_readl(struct uart_port *port, int reg)
@@ -199,10 +216,25 @@ static void altera_uart_set_termios(struct uart_port *port,
 	 */
 }
 
+static void altera_uart_rx_flush(struct uart_port *port, const u8 *buf,
+				 unsigned int *count)
+{
+	unsigned int done;
+
+	if (!*count)
+		return;
+
+	done = tty_insert_flip_string(&port->state->port, buf, *count);
+	port->icount.buf_overrun += *count - done;
+	*count = 0;
+}
+
 static void altera_uart_rx_chars(struct uart_port *port)
 {
 	unsigned char ch, flag;
 	unsigned short status;
+	u8 buf[ALTERA_UART_RX_BATCH];
+	unsigned int count = 0;
 
 	while ((status = altera_uart_readl(port, ALTERA_UART_STATUS_REG)) &
 	       ALTERA_UART_STATUS_RRDY_MSK) {
@@ -210,41 +242,214 @@ static void altera_uart_rx_chars(struct uart_port *port)
 		flag = TTY_NORMAL;
 		port->icount.rx++;
 
-		if (status & ALTERA_UART_STATUS_E_MSK) {
-			altera_uart_writel(port, status,
-					   ALTERA_UART_STATUS_REG);
-
-			if (status & ALTERA_UART_STATUS_BRK_MSK) {
-				port->icount.brk++;
-				if (uart_handle_break(port))
-					continue;
-			} else if (status & ALTERA_UART_STATUS_PE_MSK) {
-				port->icount.parity++;
-			} else if (status & ALTERA_UART_STATUS_ROE_MSK) {
-				port->icount.overrun++;
-			} else if (status & ALTERA_UART_STATUS_FE_MSK) {
-				port->icount.frame++;
-			}
-
-			status &= port->read_status_mask;
-
-			if (status & ALTERA_UART_STATUS_BRK_MSK)
-				flag = TTY_BREAK;
-			else if (status & ALTERA_UART_STATUS_PE_MSK)
-				flag = TTY_PARITY;
-			else if (status & ALTERA_UART_STATUS_FE_MSK)
-				flag = TTY_FRAME;
+		if (likely(!(status & ALTERA_UART_STATUS_E_MSK))) {
+			if (uart_handle_sysrq_char(port, ch))
+				continue;
+
+			buf[count++] = ch;
+			if (count == ARRAY_SIZE(buf))
+				altera_uart_rx_flush(port, buf, &count);
+			continue;
+		}
+
+		/* keep the characters in order */
+		altera_uart_rx_flush(port, buf, &count);
+
+		altera_uart_writel(port, status, ALTERA_UART_STATUS_REG);
+
+		if (status & ALTERA_UART_STATUS_BRK_MSK) {
+			port->icount.brk++;
+			if (uart_handle_break(port))
+				continue;
+		} else if (status & ALTERA_UART_STATUS_PE_MSK) {
+			port->icount.parity++;
+		} else if (status & ALTERA_UART_STATUS_ROE_MSK) {
+			port->icount.overrun++;
+		} else if (status & ALTERA_UART_STATUS_FE_MSK) {
+			port->icount.frame++;
 		}
 
+		status &= port->read_status_mask;
+
+		if (status & ALTERA_UART_STATUS_BRK_MSK)
+			flag = TTY_BREAK;
+		else if (status & ALTERA_UART_STATUS_PE_MSK)
+			flag = TTY_PARITY;
+		else if (status & ALTERA_UART_STATUS_FE_MSK)
+			flag = TTY_FRAME;
+
 		if (uart_handle_sysrq_char(port, ch))
 			continue;
 		uart_insert_char(port, status, ALTERA_UART_STATUS_ROE_MSK, ch,
 				 flag);
 	}
 
+	altera_uart_rx_flush(port, buf, &count);
+	tty_flip_buffer_push(&port->state->port);
+}
+
+/*
+ * With DMA, the receiver only interrupts on overruns, the characters are
+ * read by the channel.
+ */
+static void altera_uart_rx_errors(struct uart_port *port)
+{
+	unsigned short status = altera_uart_readl(port, ALTERA_UART_STATUS_REG);
+
+	if (status & ALTERA_UART_STATUS_ROE_MSK) {
+		port->icount.overrun++;
+		altera_uart_writel(port, 0, ALTERA_UART_STATUS_REG);
+	}
+}
+
+/* Called with the port lock held. */
+static void altera_uart_dma_rx_push(struct altera_uart *pp)
+{
+	struct uart_port *port = &pp->port;
+	unsigned int count, done;
+
+	while (pp->rx_tail != pp->rx_head) {
+		if (pp->rx_head > pp->rx_tail)
+			count = pp->rx_head - pp->rx_tail;
+		else
+			count = ALTERA_UART_DMA_RX_SIZE - pp->rx_tail;
+
+		done = tty_insert_flip_string(&port->state->port,
+					      pp->rx_buf + pp->rx_tail, count);
+		port->icount.rx += count;
+		port->icount.buf_overrun += count - done;
+		pp->rx_tail = (pp->rx_tail + count) % ALTERA_UART_DMA_RX_SIZE;
+	}
+
 	tty_flip_buffer_push(&port->state->port);
 }
 
+static void altera_uart_dma_rx_update(struct altera_uart *pp)
+{
+	struct dma_tx_state state;
+
+	if (dmaengine_tx_status(pp->rx_chan, pp->rx_cookie, &state) ==
+	    DMA_ERROR)
+		return;
+
+	pp->rx_head = (ALTERA_UART_DMA_RX_SIZE - state.residue) %
+		      ALTERA_UART_DMA_RX_SIZE;
+}
+
+static void altera_uart_dma_rx_complete(void *data)
+{
+	struct altera_uart *pp = data;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pp->port.lock, flags);
+	if (pp->rx_residue)
+		altera_uart_dma_rx_update(pp);
+	else
+		pp->rx_head = (pp->rx_head + ALTERA_UART_DMA_RX_PERIOD) %
+			      ALTERA_UART_DMA_RX_SIZE;
+	altera_uart_dma_rx_push(pp);
+	spin_unlock_irqrestore(&pp->port.lock, flags);
+}
+
+/* Pass the characters of a period being filled, when the channel can tell. */
+static void altera_uart_dma_rx_timer(struct timer_list *t)
+{
+	struct altera_uart *pp = from_timer(pp, t, dma_tmr);
+	unsigned long flags;
+
+	spin_lock_irqsave(&pp->port.lock, flags);
+	altera_uart_dma_rx_update(pp);
+	altera_uart_dma_rx_push(pp);
+	spin_unlock_irqrestore(&pp->port.lock, flags);
+
+	mod_timer(&pp->dma_tmr, jiffies + uart_poll_timeout(&pp->port));
+}
+
+/*
+ * The receiver is serviced by DMA when the device has an "rx" channel
+ * paced by the dataavailable signal of the core, else by PIO.
+ */
+static void altera_uart_dma_rx_init(struct altera_uart *pp)
+{
+	struct uart_port *port = &pp->port;
+	struct dma_slave_config cfg = {
+		.direction = DMA_DEV_TO_MEM,
+		.src_addr = port->mapbase +
+			    (ALTERA_UART_RXDATA_REG << port->regshift),
+		.src_addr_width = DMA_SLAVE_BUSWIDTH_1_BYTE,
+		.src_maxburst = 1,
+	};
+	struct dma_async_tx_descriptor *desc;
+	struct dma_slave_caps caps;
+	struct dma_chan *chan;
+
+	if (!port->dev)
+		return;
+
+	chan = dma_request_chan(port->dev, "rx");
+	if (IS_ERR(chan))
+		return;
+
+	if (dmaengine_slave_config(chan, &cfg))
+		goto err_release;
+
+	pp->rx_buf = dma_alloc_coherent(chan->device->dev,
+					ALTERA_UART_DMA_RX_SIZE, &pp->rx_dma,
+					GFP_KERNEL);
+	if (!pp->rx_buf)
+		goto err_release;
+
+	desc = dmaengine_prep_dma_cyclic(chan, pp->rx_dma,
+					 ALTERA_UART_DMA_RX_SIZE,
+					 ALTERA_UART_DMA_RX_PERIOD,
+					 DMA_DEV_TO_MEM, DMA_PREP_INTERRUPT);
+	if (!desc)
+		goto err_free;
+
+	desc->callback = altera_uart_dma_rx_complete;
+	desc->callback_param = pp;
+
+	pp->rx_residue = !dma_get_slave_caps(chan, &caps) &&
+			 caps.residue_granularity !=
+			 DMA_RESIDUE_GRANULARITY_DESCRIPTOR;
+	pp->rx_head = 0;
+	pp->rx_tail = 0;
+	pp->rx_chan = chan;
+	pp->rx_cookie = dmaengine_submit(desc);
+	dma_async_issue_pending(chan);
+
+	if (pp->rx_residue) {
+		timer_setup(&pp->dma_tmr, altera_uart_dma_rx_timer, 0);
+		mod_timer(&pp->dma_tmr, jiffies + uart_poll_timeout(port));
+	}
+
+	dev_dbg(port->dev, "using DMA for RX\n");
+	return;
+
+err_free:
+	dma_free_coherent(chan->device->dev, ALTERA_UART_DMA_RX_SIZE,
+			  pp->rx_buf, pp->rx_dma);
+err_release:
+	dma_release_channel(chan);
+	dev_warn(port->dev, "RX DMA unavailable, using PIO\n");
+}
+
+static void altera_uart_dma_rx_release(struct altera_uart *pp)
+{
+	struct dma_chan *chan = pp->rx_chan;
+
+	if (!chan)
+		return;
+
+	if (pp->rx_residue)
+		del_timer_sync(&pp->dma_tmr);
+	dmaengine_terminate_sync(chan);
+	dma_free_coherent(chan->device->dev, ALTERA_UART_DMA_RX_SIZE,
+			  pp->rx_buf, pp->rx_dma);
+	dma_release_channel(chan);
+	pp->rx_chan = NULL;
+}
+
 static void altera_uart_tx_chars(struct uart_port *port)
 {
 	struct circ_buf *xmit = &port->state->xmit;
@@ -286,6 +491,8 @@ static irqreturn_t altera_uart_interrupt(int irq, void *data)
 	spin_lock_irqsave(&port->lock, flags);
 	if (isr & ALTERA_UART_STATUS_RRDY_MSK)
 		altera_uart_rx_chars(port);
+	if (isr & ALTERA_UART_STATUS_ROE_MSK)
+		altera_uart_rx_errors(port);
 	if (isr & ALTERA_UART_STATUS_TRDY_MSK)
 		altera_uart_tx_chars(port);
 	spin_unlock_irqrestore(&port->lock, flags);
@@ -332,10 +539,15 @@ static int altera_uart_startup(struct uart_port *port)
 		}
 	}
 
+	altera_uart_dma_rx_init(pp);
+
 	spin_lock_irqsave(&port->lock, flags);
 
 	/* Enable RX interrupts now */
-	pp->imr = ALTERA_UART_CONTROL_RRDY_MSK;
+	if (pp->rx_chan)
+		pp->imr = ALTERA_UART_CONTROL_ROE_MSK;
+	else
+		pp->imr = ALTERA_UART_CONTROL_RRDY_MSK;
 	altera_uart_update_ctrl_reg(pp);
 
 	spin_unlock_irqrestore(&port->lock, flags);
@@ -360,6 +572,8 @@ static void altera_uart_shutdown(struct uart_port *port)
 		free_irq(port->irq, port);
 	else
 		del_timer_sync(&pp->tmr);
+
+	altera_uart_dma_rx_release(pp);
 }
 
 static const char *altera_uart_type(struct uart_port *port)
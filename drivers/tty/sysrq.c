@@ -15,6 +15,7 @@
 
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
+#include <linux/console.h>
 #include <linux/sched/signal.h>
 #include <linux/sched/rt.h>
 #include <linux/sched/debug.h>
@@ -580,6 +581,8 @@ void __handle_sysrq(int key, bool check_mask)
 	orig_suppress_printk = suppress_printk;
 	suppress_printk = 0;
 
+	/* sysrq is used when the system is too wedged to run the printers */
+	console_emergency_enter();
 	rcu_sysrq_start();
 	rcu_read_lock();
 	/*
@@ -625,6 +628,7 @@ void __handle_sysrq(int key, bool check_mask)
 	}
 	rcu_read_unlock();
 	rcu_sysrq_end();
+	console_emergency_exit();
 
 	suppress_printk = orig_suppress_printk;
 }
@@ -568,6 +568,7 @@ static ssize_t uio_read(struct file *filep, char __user *buf,
 	struct uio_listener *listener = filep->private_data;
 	struct uio_device *idev = listener->dev;
 	DECLARE_WAITQUEUE(wait, current);
+	bool latency_critical = false;
 	ssize_t retval = 0;
 	s32 event_count;
 
@@ -583,6 +584,7 @@ static ssize_t uio_read(struct file *filep, char __user *buf,
 			mutex_unlock(&idev->info_lock);
 			break;
 		}
+		latency_critical = idev->info->latency_critical;
 		mutex_unlock(&idev->info_lock);
 
 		set_current_state(TASK_INTERRUPTIBLE);
@@ -608,7 +610,12 @@ static ssize_t uio_read(struct file *filep, char __user *buf,
 			retval = -ERESTARTSYS;
 			break;
 		}
-		schedule();
+
+		/* the wakeup boosts the frequency, as after an I/O wait */
+		if (latency_critical)
+			io_schedule();
+		else
+			schedule();
 	} while (1);
 
 	__set_current_state(TASK_RUNNING);
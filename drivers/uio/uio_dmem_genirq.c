@@ -37,10 +37,58 @@ struct uio_dmem_genirq_platdata {
 	unsigned int dmem_region_start;
 	unsigned int num_dmem_regions;
 	void *dmem_region_vaddr[MAX_UIO_MAPS];
+	struct page *dmem_region_page[MAX_UIO_MAPS];
+	bool dmem_cached;
 	struct mutex alloc_lock;
 	unsigned int refcnt;
 };
 
+/*
+ * With dmem_cached set, the dynamic regions are allocated with
+ * dma_alloc_pages() and mapped cacheable, userspace being responsible for
+ * syncing them through the dmem_sync attribute.
+ */
+static void *uio_dmem_genirq_alloc(struct uio_dmem_genirq_platdata *priv,
+				   int dmem_region, struct uio_mem *uiomem)
+{
+	struct device *dev = &priv->pdev->dev;
+	dma_addr_t dma_addr;
+	struct page *page;
+
+	if (!priv->dmem_cached)
+		return dma_alloc_coherent(dev, uiomem->size,
+					  (dma_addr_t *)&uiomem->addr,
+					  GFP_KERNEL);
+
+	page = dma_alloc_pages(dev, uiomem->size, &dma_addr,
+			       DMA_BIDIRECTIONAL, GFP_KERNEL);
+	if (!page)
+		return NULL;
+
+	uiomem->addr = dma_addr;
+	priv->dmem_region_page[dmem_region] = page;
+
+	return page_address(page);
+}
+
+static void uio_dmem_genirq_free(struct uio_dmem_genirq_platdata *priv,
+				 int dmem_region, struct uio_mem *uiomem)
+{
+	struct device *dev = &priv->pdev->dev;
+
+	if (priv->dmem_region_page[dmem_region]) {
+		dma_free_pages(dev, uiomem->size,
+			       priv->dmem_region_page[dmem_region],
+			       uiomem->addr, DMA_BIDIRECTIONAL);
+		priv->dmem_region_page[dmem_region] = NULL;
+	} else if (priv->dmem_region_vaddr[dmem_region]) {
+		dma_free_coherent(dev, uiomem->size,
+				  priv->dmem_region_vaddr[dmem_region],
+				  uiomem->addr);
+	}
+	priv->dmem_region_vaddr[dmem_region] = NULL;
+}
+
 static int uio_dmem_genirq_open(struct uio_info *info, struct inode *inode)
 {
 	struct uio_dmem_genirq_platdata *priv = info->priv;
@@ -55,8 +103,7 @@ static int uio_dmem_genirq_open(struct uio_info *info, struct inode *inode)
 		if (!uiomem->size)
 			break;
 
-		addr = dma_alloc_coherent(&priv->pdev->dev, uiomem->size,
-				(dma_addr_t *)&uiomem->addr, GFP_KERNEL);
+		addr = uio_dmem_genirq_alloc(priv, dmem_region, uiomem);
 		if (!addr) {
 			uiomem->addr = DMEM_MAP_ERROR;
 		}
@@ -88,11 +135,7 @@ static int uio_dmem_genirq_release(struct uio_info *info, struct inode *inode)
 	while (!priv->refcnt && uiomem < &priv->uioinfo->mem[MAX_UIO_MAPS]) {
 		if (!uiomem->size)
 			break;
-		if (priv->dmem_region_vaddr[dmem_region]) {
-			dma_free_coherent(&priv->pdev->dev, uiomem->size,
-					priv->dmem_region_vaddr[dmem_region],
-					uiomem->addr);
-		}
+		uio_dmem_genirq_free(priv, dmem_region, uiomem);
 		uiomem->addr = DMEM_MAP_ERROR;
 		++dmem_region;
 		++uiomem;
@@ -102,6 +145,31 @@ static int uio_dmem_genirq_release(struct uio_info *info, struct inode *inode)
 	return 0;
 }
 
+static int uio_dmem_genirq_mmap(struct uio_info *info,
+				struct vm_area_struct *vma)
+{
+	struct uio_dmem_genirq_platdata *priv = info->priv;
+	int mi = vma->vm_pgoff;
+	struct uio_mem *uiomem = &info->mem[mi];
+	struct page *page = priv->dmem_region_page[mi];
+
+	if (page) {
+		/* the offset of a UIO mmap() is the map index */
+		vma->vm_pgoff = 0;
+		return dma_mmap_pages(&priv->pdev->dev, vma,
+				      vma->vm_end - vma->vm_start, page);
+	}
+
+	/* same as the UIO core for UIO_MEM_PHYS */
+	if (uiomem->addr & ~PAGE_MASK)
+		return -ENODEV;
+
+	vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
+
+	return remap_pfn_range(vma, vma->vm_start, uiomem->addr >> PAGE_SHIFT,
+			       vma->vm_end - vma->vm_start, vma->vm_page_prot);
+}
+
 static irqreturn_t uio_dmem_genirq_handler(int irq, struct uio_info *dev_info)
 {
 	struct uio_dmem_genirq_platdata *priv = dev_info->priv;
@@ -144,6 +212,165 @@ static int uio_dmem_genirq_irqcontrol(struct uio_info *dev_info, s32 irq_on)
 	return 0;
 }
 
+/*
+ * dmem_sizes is the comma separated list of the dynamic region sizes, which
+ * can be changed while the device isn't open.  Regions added that way have
+ * no entry in the maps directory of the UIO device, their map index is the
+ * number of fixed regions plus their position in the list.
+ */
+static ssize_t dmem_sizes_show(struct device *dev,
+			       struct device_attribute *attr, char *buf)
+{
+	struct uio_dmem_genirq_platdata *priv = dev_get_drvdata(dev);
+	struct uio_mem *uiomem = &priv->uioinfo->mem[priv->dmem_region_start];
+	ssize_t len = 0;
+	unsigned int i;
+
+	mutex_lock(&priv->alloc_lock);
+	for (i = 0; i < priv->num_dmem_regions; i++)
+		len += sysfs_emit_at(buf, len, "%s%llu", i ? "," : "",
+				     (u64)uiomem[i].size);
+	mutex_unlock(&priv->alloc_lock);
+
+	return len + sysfs_emit_at(buf, len, "\n");
+}
+
+static ssize_t dmem_sizes_store(struct device *dev,
+				struct device_attribute *attr,
+				const char *buf, size_t count)
+{
+	struct uio_dmem_genirq_platdata *priv = dev_get_drvdata(dev);
+	struct uio_mem *uiomem = &priv->uioinfo->mem[priv->dmem_region_start];
+	unsigned int max = MAX_UIO_MAPS - priv->dmem_region_start;
+	int sizes[MAX_UIO_MAPS + 1];
+	unsigned int i, num = 0;
+	int ret = count;
+
+	get_options(buf, ARRAY_SIZE(sizes), sizes);
+
+	while (num < sizes[0] && sizes[num + 1] > 0)
+		num++;
+	if (num > max)
+		return -E2BIG;
+
+	mutex_lock(&priv->alloc_lock);
+	if (priv->refcnt) {
+		ret = -EBUSY;
+		goto out_unlock;
+	}
+
+	for (i = 0; i < max; i++) {
+		uiomem[i].memtype = UIO_MEM_PHYS;
+		uiomem[i].addr = DMEM_MAP_ERROR;
+		uiomem[i].size = i < num ? PAGE_ALIGN(sizes[i + 1]) : 0;
+	}
+	priv->num_dmem_regions = num;
+
+out_unlock:
+	mutex_unlock(&priv->alloc_lock);
+
+	return ret;
+}
+static DEVICE_ATTR_RW(dmem_sizes);
+
+static ssize_t dmem_cached_show(struct device *dev,
+				struct device_attribute *attr, char *buf)
+{
+	struct uio_dmem_genirq_platdata *priv = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%d\n", priv->dmem_cached);
+}
+
+static ssize_t dmem_cached_store(struct device *dev,
+				 struct device_attribute *attr,
+				 const char *buf, size_t count)
+{
+	struct uio_dmem_genirq_platdata *priv = dev_get_drvdata(dev);
+	bool cached;
+	int ret;
+
+	ret = kstrtobool(buf, &cached);
+	if (ret)
+		return ret;
+
+	mutex_lock(&priv->alloc_lock);
+	if (priv->refcnt)
+		ret = -EBUSY;
+	else
+		priv->dmem_cached = cached;
+	mutex_unlock(&priv->alloc_lock);
+
+	return ret ? ret : count;
+}
+static DEVICE_ATTR_RW(dmem_cached);
+
+/*
+ * Writing "<map> cpu" or "<map> device", optionally followed by an offset
+ * and a length, hands a cached dynamic region over to the CPU or back to the
+ * device.
+ */
+static ssize_t dmem_sync_store(struct device *dev,
+			       struct device_attribute *attr,
+			       const char *buf, size_t count)
+{
+	struct uio_dmem_genirq_platdata *priv = dev_get_drvdata(dev);
+	struct uio_mem *uiomem;
+	unsigned int mi;
+	size_t offset = 0, len;
+	char dir[8];
+	int ret, n;
+
+	n = sscanf(buf, "%u %7s %zu %zu", &mi, dir, &offset, &len);
+	if (n != 2 && n != 4)
+		return -EINVAL;
+
+	if (mi < priv->dmem_region_start ||
+	    mi >= priv->dmem_region_start + priv->num_dmem_regions)
+		return -EINVAL;
+
+	mutex_lock(&priv->alloc_lock);
+
+	uiomem = &priv->uioinfo->mem[mi];
+	if (n == 2)
+		len = uiomem->size;
+
+	ret = -EINVAL;
+	if (offset > uiomem->size || len > uiomem->size - offset)
+		goto out_unlock;
+
+	ret = -ENODEV;
+	if (!priv->dmem_region_page[mi]) {
+		/* coherent regions need no sync */
+		if (!priv->dmem_cached && priv->dmem_region_vaddr[mi])
+			ret = count;
+		goto out_unlock;
+	}
+
+	ret = count;
+	if (!strcmp(dir, "cpu"))
+		dma_sync_single_for_cpu(dev, uiomem->addr + offset, len,
+					DMA_BIDIRECTIONAL);
+	else if (!strcmp(dir, "device"))
+		dma_sync_single_for_device(dev, uiomem->addr + offset, len,
+					   DMA_BIDIRECTIONAL);
+	else
+		ret = -EINVAL;
+
+out_unlock:
+	mutex_unlock(&priv->alloc_lock);
+
+	return ret;
+}
+static DEVICE_ATTR_WO(dmem_sync);
+
+static struct attribute *uio_dmem_genirq_attrs[] = {
+	&dev_attr_dmem_sizes.attr,
+	&dev_attr_dmem_cached.attr,
+	&dev_attr_dmem_sync.attr,
+	NULL
+};
+ATTRIBUTE_GROUPS(uio_dmem_genirq);
+
 static void uio_dmem_genirq_pm_disable(void *data)
 {
 	struct device *dev = data;
@@ -250,13 +477,14 @@ static int uio_dmem_genirq_probe(struct platform_device *pdev)
 	}
 
 	priv->dmem_region_start = uiomem - &uioinfo->mem[0];
-	priv->num_dmem_regions = pdata->num_dynamic_regions;
+	priv->num_dmem_regions = pdata ? pdata->num_dynamic_regions : 0;
 
-	for (i = 0; i < pdata->num_dynamic_regions; ++i) {
+	for (i = 0; i < priv->num_dmem_regions; ++i) {
 		if (uiomem >= &uioinfo->mem[MAX_UIO_MAPS]) {
 			dev_warn(&pdev->dev, "device has more than "
 					__stringify(MAX_UIO_MAPS)
 					" dynamic and fixed memory regions.\n");
+			priv->num_dmem_regions = i;
 			break;
 		}
 		uiomem->memtype = UIO_MEM_PHYS;
@@ -283,8 +511,11 @@ static int uio_dmem_genirq_probe(struct platform_device *pdev)
 	uioinfo->irqcontrol = uio_dmem_genirq_irqcontrol;
 	uioinfo->open = uio_dmem_genirq_open;
 	uioinfo->release = uio_dmem_genirq_release;
+	uioinfo->mmap = uio_dmem_genirq_mmap;
 	uioinfo->priv = priv;
 
+	platform_set_drvdata(pdev, priv);
+
 	/* Enable Runtime PM for this device:
 	 * The device starts in suspended state to allow the hardware to be
 	 * turned off by default. The Runtime PM bus code should power on the
@@ -333,6 +564,7 @@ static struct platform_driver uio_dmem_genirq = {
 	.driver = {
 		.name = DRIVER_NAME,
 		.pm = &uio_dmem_genirq_dev_pm_ops,
+		.dev_groups = uio_dmem_genirq_groups,
 		.of_match_table = of_match_ptr(uio_of_genirq_match),
 	},
 };
@@ -21,6 +21,8 @@
 #include <linux/pm_runtime.h>
 #include <linux/slab.h>
 #include <linux/irq.h>
+#include <linux/hrtimer.h>
+#include <linux/ktime.h>
 
 #include <linux/of.h>
 #include <linux/of_platform.h>
@@ -28,11 +30,35 @@
 
 #define DRIVER_NAME "uio_pdrv_genirq"
 
+/* one bit per interrupt in the positive s32 written to /dev/uioX */
+#define UIO_PDRV_GENIRQ_MAX_IRQS	31
+
+/*
+ * With several interrupts, or coalescing, the last memory map is a page
+ * starting with this structure.  Each interrupt sets its bit in @pending,
+ * which userspace atomically exchanges with 0 after each read() to learn
+ * which interrupts fired.
+ */
+struct uio_pdrv_genirq_events {
+	atomic_t pending;
+};
+
 struct uio_pdrv_genirq_platdata {
 	struct uio_info *uioinfo;
 	spinlock_t lock;
 	unsigned long flags;
 	struct platform_device *pdev;
+
+	/* multiple interrupts and coalescing, protected by @lock */
+	unsigned int num_irqs;
+	int irqs[UIO_PDRV_GENIRQ_MAX_IRQS];
+	unsigned long irqs_disabled;
+	struct uio_pdrv_genirq_events *events;
+	ktime_t coalesce_interval;
+	u32 coalesce_count;
+	u32 unreported;
+	ktime_t last_notify;
+	struct hrtimer coalesce_timer;
 };
 
 /* Bits in uio_pdrv_genirq_platdata.flags */
@@ -100,6 +126,213 @@ static int uio_pdrv_genirq_irqcontrol(struct uio_info *dev_info, s32 irq_on)
 	return 0;
 }
 
+/*
+ * Called with the lock held for each interrupt.  Userspace is woken up at
+ * most once per coalesce_interval, unless coalesce_count interrupts are
+ * pending before it elapses.
+ */
+static bool uio_pdrv_genirq_coalesce(struct uio_pdrv_genirq_platdata *priv)
+{
+	ktime_t now = ktime_get();
+	ktime_t next = ktime_add(priv->last_notify, priv->coalesce_interval);
+
+	priv->unreported++;
+
+	if ((!priv->coalesce_count || priv->unreported < priv->coalesce_count) &&
+	    ktime_before(now, next)) {
+		if (!hrtimer_is_queued(&priv->coalesce_timer))
+			hrtimer_start(&priv->coalesce_timer, next,
+				      HRTIMER_MODE_ABS);
+		return false;
+	}
+
+	priv->unreported = 0;
+	priv->last_notify = now;
+	hrtimer_try_to_cancel(&priv->coalesce_timer);
+
+	return true;
+}
+
+static enum hrtimer_restart uio_pdrv_genirq_coalesce_timer(struct hrtimer *t)
+{
+	struct uio_pdrv_genirq_platdata *priv =
+		container_of(t, struct uio_pdrv_genirq_platdata, coalesce_timer);
+	unsigned long flags;
+	bool notify = false;
+
+	spin_lock_irqsave(&priv->lock, flags);
+	if (priv->unreported) {
+		priv->unreported = 0;
+		priv->last_notify = ktime_get();
+		notify = true;
+	}
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	if (notify)
+		uio_event_notify(priv->uioinfo);
+
+	return HRTIMER_NORESTART;
+}
+
+static irqreturn_t uio_pdrv_genirq_multi_handler(int irq, void *dev_id)
+{
+	struct uio_pdrv_genirq_platdata *priv = dev_id;
+	unsigned int i;
+	bool notify;
+
+	for (i = 0; i < priv->num_irqs; i++)
+		if (priv->irqs[i] == irq)
+			break;
+
+	if (i == priv->num_irqs)
+		return IRQ_NONE;
+
+	/* same as the single interrupt handler, and record which one fired */
+	spin_lock(&priv->lock);
+	if (!__test_and_set_bit(i, &priv->irqs_disabled))
+		disable_irq_nosync(irq);
+	atomic_or(BIT(i), &priv->events->pending);
+	notify = uio_pdrv_genirq_coalesce(priv);
+	spin_unlock(&priv->lock);
+
+	if (notify)
+		uio_event_notify(priv->uioinfo);
+
+	return IRQ_HANDLED;
+}
+
+static int uio_pdrv_genirq_multi_irqcontrol(struct uio_info *dev_info,
+					    s32 irq_on)
+{
+	struct uio_pdrv_genirq_platdata *priv = dev_info->priv;
+	unsigned long flags;
+	unsigned int i;
+
+	if (irq_on < 0)
+		return -EINVAL;
+
+	/*
+	 * A non-zero value is the mask of the interrupts to enable, the others
+	 * are left alone, while 0 disables them all.  With a single interrupt
+	 * this is the same as uio_pdrv_genirq_irqcontrol().
+	 */
+	spin_lock_irqsave(&priv->lock, flags);
+	for (i = 0; i < priv->num_irqs; i++) {
+		if (irq_on & BIT(i)) {
+			if (__test_and_clear_bit(i, &priv->irqs_disabled))
+				enable_irq(priv->irqs[i]);
+		} else if (!irq_on) {
+			if (!__test_and_set_bit(i, &priv->irqs_disabled))
+				disable_irq_nosync(priv->irqs[i]);
+		}
+	}
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	return 0;
+}
+
+static void uio_pdrv_genirq_unlazy(struct device *dev, int irq)
+{
+	struct irq_data *irq_data = irq_get_irq_data(irq);
+
+	/*
+	 * If a level interrupt, dont do lazy disable. Otherwise the
+	 * irq will fire again since clearing of the actual cause, on
+	 * device level, is done in userspace
+	 * irqd_is_level_type() isn't used since isn't valid until
+	 * irq is configured.
+	 */
+	if (irq_data &&
+	    irqd_get_trigger_type(irq_data) & IRQ_TYPE_LEVEL_MASK) {
+		dev_dbg(dev, "disable lazy unmask\n");
+		irq_set_status_flags(irq, IRQ_DISABLE_UNLAZY);
+	}
+}
+
+static void uio_pdrv_genirq_cancel_timer(void *data)
+{
+	struct uio_pdrv_genirq_platdata *priv = data;
+
+	hrtimer_cancel(&priv->coalesce_timer);
+}
+
+/*
+ * Use the multiple interrupts handling when the device has several
+ * interrupts, or "linux,uio-coalesce-usecs" is set.  The optional
+ * "linux,uio-coalesce-count" lets that many pending interrupts wake up
+ * userspace before the interval elapses.
+ */
+static int uio_pdrv_genirq_multi_init(struct platform_device *pdev,
+				      struct uio_pdrv_genirq_platdata *priv)
+{
+	struct device_node *node = pdev->dev.of_node;
+	u32 usecs = 0;
+	int i, ret;
+
+	ret = platform_irq_count(pdev);
+	if (ret < 0)
+		return ret;
+
+	of_property_read_u32(node, "linux,uio-coalesce-usecs", &usecs);
+	of_property_read_u32(node, "linux,uio-coalesce-count",
+			     &priv->coalesce_count);
+
+	if (!ret || (ret < 2 && !usecs))
+		return 0;
+
+	if (ret > UIO_PDRV_GENIRQ_MAX_IRQS) {
+		dev_warn(&pdev->dev, "only using the first %d interrupts\n",
+			 UIO_PDRV_GENIRQ_MAX_IRQS);
+		ret = UIO_PDRV_GENIRQ_MAX_IRQS;
+	}
+	priv->num_irqs = ret;
+
+	for (i = 0; i < priv->num_irqs; i++) {
+		ret = platform_get_irq(pdev, i);
+		if (ret < 0)
+			return ret;
+		priv->irqs[i] = ret;
+		uio_pdrv_genirq_unlazy(&pdev->dev, ret);
+	}
+
+	priv->events = (void *)devm_get_free_pages(&pdev->dev,
+						   GFP_KERNEL | __GFP_ZERO, 0);
+	if (!priv->events)
+		return -ENOMEM;
+
+	priv->coalesce_interval = us_to_ktime(usecs);
+	hrtimer_init(&priv->coalesce_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	priv->coalesce_timer.function = uio_pdrv_genirq_coalesce_timer;
+
+	priv->uioinfo->irq = UIO_IRQ_CUSTOM;
+
+	return 0;
+}
+
+static int uio_pdrv_genirq_multi_request(struct platform_device *pdev,
+					 struct uio_pdrv_genirq_platdata *priv)
+{
+	int i, ret;
+
+	ret = devm_add_action_or_reset(&pdev->dev, uio_pdrv_genirq_cancel_timer,
+				       priv);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < priv->num_irqs; i++) {
+		ret = devm_request_irq(&pdev->dev, priv->irqs[i],
+				       uio_pdrv_genirq_multi_handler, 0,
+				       priv->uioinfo->name, priv);
+		if (ret) {
+			dev_err(&pdev->dev, "unable to request IRQ %d\n",
+				priv->irqs[i]);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
 static void uio_pdrv_genirq_cleanup(void *data)
 {
 	struct device *dev = data;
@@ -134,7 +367,8 @@ static int uio_pdrv_genirq_probe(struct platform_device *pdev)
 						       "%pOFn", node);
 
 		uioinfo->version = "devicetree";
-		/* Multiple IRQs are not supported */
+		uioinfo->latency_critical =
+			of_property_read_bool(node, "linux,uio-latency-critical");
 	}
 
 	if (!uioinfo || !uioinfo->name || !uioinfo->version) {
@@ -159,6 +393,12 @@ static int uio_pdrv_genirq_probe(struct platform_device *pdev)
 	priv->flags = 0; /* interrupt is enabled to begin with */
 	priv->pdev = pdev;
 
+	if (node && !uioinfo->irq) {
+		ret = uio_pdrv_genirq_multi_init(pdev, priv);
+		if (ret)
+			return ret;
+	}
+
 	if (!uioinfo->irq) {
 		ret = platform_get_irq_optional(pdev, 0);
 		uioinfo->irq = ret;
@@ -172,22 +412,8 @@ static int uio_pdrv_genirq_probe(struct platform_device *pdev)
 		}
 	}
 
-	if (uioinfo->irq) {
-		struct irq_data *irq_data = irq_get_irq_data(uioinfo->irq);
-
-		/*
-		 * If a level interrupt, dont do lazy disable. Otherwise the
-		 * irq will fire again since clearing of the actual cause, on
-		 * device level, is done in userspace
-		 * irqd_is_level_type() isn't used since isn't valid until
-		 * irq is configured.
-		 */
-		if (irq_data &&
-		    irqd_get_trigger_type(irq_data) & IRQ_TYPE_LEVEL_MASK) {
-			dev_dbg(&pdev->dev, "disable lazy unmask\n");
-			irq_set_status_flags(uioinfo->irq, IRQ_DISABLE_UNLAZY);
-		}
-	}
+	if (uioinfo->irq && uioinfo->irq != UIO_IRQ_CUSTOM)
+		uio_pdrv_genirq_unlazy(&pdev->dev, uioinfo->irq);
 
 	uiomem = &uioinfo->mem[0];
 
@@ -213,6 +439,19 @@ static int uio_pdrv_genirq_probe(struct platform_device *pdev)
 		++uiomem;
 	}
 
+	if (priv->events) {
+		if (uiomem >= &uioinfo->mem[MAX_UIO_MAPS]) {
+			dev_err(&pdev->dev, "no memory map left for events\n");
+			return -EINVAL;
+		}
+
+		uiomem->memtype = UIO_MEM_LOGICAL;
+		uiomem->addr = (phys_addr_t)(uintptr_t)priv->events;
+		uiomem->size = PAGE_SIZE;
+		uiomem->name = "events";
+		++uiomem;
+	}
+
 	while (uiomem < &uioinfo->mem[MAX_UIO_MAPS]) {
 		uiomem->size = 0;
 		++uiomem;
@@ -227,8 +466,12 @@ static int uio_pdrv_genirq_probe(struct platform_device *pdev)
 	 * Interrupt sharing is not supported.
 	 */
 
-	uioinfo->handler = uio_pdrv_genirq_handler;
-	uioinfo->irqcontrol = uio_pdrv_genirq_irqcontrol;
+	if (priv->num_irqs) {
+		uioinfo->irqcontrol = uio_pdrv_genirq_multi_irqcontrol;
+	} else {
+		uioinfo->handler = uio_pdrv_genirq_handler;
+		uioinfo->irqcontrol = uio_pdrv_genirq_irqcontrol;
+	}
 	uioinfo->open = uio_pdrv_genirq_open;
 	uioinfo->release = uio_pdrv_genirq_release;
 	uioinfo->priv = priv;
@@ -246,8 +489,14 @@ static int uio_pdrv_genirq_probe(struct platform_device *pdev)
 		return ret;
 
 	ret = devm_uio_register_device(&pdev->dev, priv->uioinfo);
-	if (ret)
+	if (ret) {
 		dev_err(&pdev->dev, "unable to register uio device\n");
+		return ret;
+	}
+
+	/* uio_event_notify() can't be called before registration */
+	if (priv->num_irqs)
+		ret = uio_pdrv_genirq_multi_request(pdev, priv);
 
 	return ret;
 }
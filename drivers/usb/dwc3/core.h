@@ -714,6 +714,13 @@ struct dwc3_event_buffer {
  *		isochronous START TRANSFER command failure workaround
  * @start_cmd_status: the status of testing START TRANSFER command with
  *		combo_num = 'b00
+ * @irq_moderation: a bulk IN request out of this many interrupts on completion
+ * @irq_count: requests prepared without interrupt since the last one with
+ * @kick_batch: number of TRBs the controller must have left to process for
+ *		new requests to wait for the next completion to be prepared
+ * @ring_full: times requests were left pending for lack of free TRBs
+ * @ring_empty: times all TRBs completed while requests were pending
+ * @deferred_kicks: requests whose preparation waited for a completion
  */
 struct dwc3_ep {
 	struct usb_ep		endpoint;
@@ -773,6 +780,14 @@ struct dwc3_ep {
 	/* For isochronous START TRANSFER workaround only */
 	u8			combo_num;
 	int			start_cmd_status;
+
+	unsigned int		irq_moderation;
+	unsigned int		irq_count;
+	unsigned int		kick_batch;
+
+	unsigned long		ring_full;
+	unsigned long		ring_empty;
+	unsigned long		deferred_kicks;
 };
 
 enum dwc3_phy {
@@ -926,6 +941,7 @@ struct dwc3_hwparams {
  *	or unaligned OUT)
  * @direction: IN or OUT direction flag
  * @mapped: true when request has been dma-mapped
+ * @moderated: true when the endpoint interrupt moderation left out the IOC
  */
 struct dwc3_request {
 	struct usb_request	request;
@@ -956,6 +972,7 @@ struct dwc3_request {
 	unsigned int		needs_extra_trb:1;
 	unsigned int		direction:1;
 	unsigned int		mapped:1;
+	unsigned int		moderated:1;
 };
 
 /*
@@ -1119,6 +1136,7 @@ struct dwc3_scratchpad_array {
  * @suspended: set to track suspend event due to U3/L2.
  * @imod_interval: set the interrupt moderation interval in 250ns
  *			increments or 0 to disable.
+ * @evt_overflows: number of event buffer overflow events
  * @max_cfg_eps: current max number of IN eps used across all USB configs.
  * @last_fifo_depth: last fifo depth used to determine next fifo ram start
  *		     address.
@@ -1344,6 +1362,7 @@ struct dwc3 {
 	unsigned		dma_set_40_bit_mask_quirk:1;
 
 	u16			imod_interval;
+	unsigned long		evt_overflows;
 
 	int			max_cfg_eps;
 	int			last_fifo_depth;
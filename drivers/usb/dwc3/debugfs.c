@@ -957,6 +957,21 @@ static int dwc3_ep_info_register_show(struct seq_file *s, void *unused)
 	return 0;
 }
 
+static int dwc3_ring_stats_show(struct seq_file *s, void *unused)
+{
+	struct dwc3_ep		*dep = s->private;
+	struct dwc3		*dwc = dep->dwc;
+	unsigned long		flags;
+
+	spin_lock_irqsave(&dwc->lock, flags);
+	seq_printf(s, "ring_full: %lu\n", dep->ring_full);
+	seq_printf(s, "ring_empty: %lu\n", dep->ring_empty);
+	seq_printf(s, "deferred_kicks: %lu\n", dep->deferred_kicks);
+	spin_unlock_irqrestore(&dwc->lock, flags);
+
+	return 0;
+}
+
 DEFINE_SHOW_ATTRIBUTE(dwc3_tx_fifo_size);
 DEFINE_SHOW_ATTRIBUTE(dwc3_rx_fifo_size);
 DEFINE_SHOW_ATTRIBUTE(dwc3_tx_request_queue);
@@ -967,6 +982,7 @@ DEFINE_SHOW_ATTRIBUTE(dwc3_event_queue);
 DEFINE_SHOW_ATTRIBUTE(dwc3_transfer_type);
 DEFINE_SHOW_ATTRIBUTE(dwc3_trb_ring);
 DEFINE_SHOW_ATTRIBUTE(dwc3_ep_info_register);
+DEFINE_SHOW_ATTRIBUTE(dwc3_ring_stats);
 
 static const struct dwc3_ep_file_map dwc3_ep_file_map[] = {
 	{ "tx_fifo_size", &dwc3_tx_fifo_size_fops, },
@@ -979,8 +995,67 @@ static const struct dwc3_ep_file_map dwc3_ep_file_map[] = {
 	{ "transfer_type", &dwc3_transfer_type_fops, },
 	{ "trb_ring", &dwc3_trb_ring_fops, },
 	{ "GDBGEPINFO", &dwc3_ep_info_register_fops, },
+	{ "ring_stats", &dwc3_ring_stats_fops, },
 };
 
+static int dwc3_ep_irq_moderation_get(void *data, u64 *val)
+{
+	struct dwc3_ep		*dep = data;
+
+	*val = READ_ONCE(dep->irq_moderation);
+
+	return 0;
+}
+
+static int dwc3_ep_irq_moderation_set(void *data, u64 val)
+{
+	struct dwc3_ep		*dep = data;
+	struct dwc3		*dwc = dep->dwc;
+	unsigned long		flags;
+
+	if (!val || val > DWC3_TRB_NUM)
+		return -EINVAL;
+
+	spin_lock_irqsave(&dwc->lock, flags);
+	dep->irq_moderation = val;
+	dep->irq_count = 0;
+	spin_unlock_irqrestore(&dwc->lock, flags);
+
+	return 0;
+}
+
+DEFINE_DEBUGFS_ATTRIBUTE(dwc3_ep_irq_moderation_fops,
+			 dwc3_ep_irq_moderation_get,
+			 dwc3_ep_irq_moderation_set, "%llu\n");
+
+static int dwc3_ep_kick_batch_get(void *data, u64 *val)
+{
+	struct dwc3_ep		*dep = data;
+
+	*val = READ_ONCE(dep->kick_batch);
+
+	return 0;
+}
+
+static int dwc3_ep_kick_batch_set(void *data, u64 val)
+{
+	struct dwc3_ep		*dep = data;
+	struct dwc3		*dwc = dep->dwc;
+	unsigned long		flags;
+
+	if (!val || val >= DWC3_TRB_NUM)
+		return -EINVAL;
+
+	spin_lock_irqsave(&dwc->lock, flags);
+	dep->kick_batch = val;
+	spin_unlock_irqrestore(&dwc->lock, flags);
+
+	return 0;
+}
+
+DEFINE_DEBUGFS_ATTRIBUTE(dwc3_ep_kick_batch_fops, dwc3_ep_kick_batch_get,
+			 dwc3_ep_kick_batch_set, "%llu\n");
+
 void dwc3_debugfs_create_endpoint_dir(struct dwc3_ep *dep)
 {
 	struct dentry		*dir;
@@ -993,6 +1068,12 @@ void dwc3_debugfs_create_endpoint_dir(struct dwc3_ep *dep)
 
 		debugfs_create_file(name, 0444, dir, dep, fops);
 	}
+
+	/* Tunables of the bulk endpoints */
+	debugfs_create_file_unsafe("irq_moderation", 0644, dir, dep,
+				   &dwc3_ep_irq_moderation_fops);
+	debugfs_create_file_unsafe("kick_batch", 0644, dir, dep,
+				   &dwc3_ep_kick_batch_fops);
 }
 
 void dwc3_debugfs_remove_endpoint_dir(struct dwc3_ep *dep)
@@ -1000,6 +1081,52 @@ void dwc3_debugfs_remove_endpoint_dir(struct dwc3_ep *dep)
 	debugfs_lookup_and_remove(dep->name, dep->dwc->debug_root);
 }
 
+static int dwc3_imod_interval_get(void *data, u64 *val)
+{
+	struct dwc3		*dwc = data;
+
+	*val = READ_ONCE(dwc->imod_interval);
+
+	return 0;
+}
+
+static int dwc3_imod_interval_set(void *data, u64 val)
+{
+	struct dwc3		*dwc = data;
+	unsigned long		flags;
+	int			ret;
+
+	if (val > U16_MAX || !dwc3_has_imod(dwc))
+		return -EINVAL;
+
+	ret = pm_runtime_resume_and_get(dwc->dev);
+	if (ret < 0)
+		return ret;
+
+	spin_lock_irqsave(&dwc->lock, flags);
+	dwc->imod_interval = val;
+	dwc3_writel(dwc->regs, DWC3_DEV_IMOD(0), dwc->imod_interval);
+	spin_unlock_irqrestore(&dwc->lock, flags);
+
+	pm_runtime_put_sync(dwc->dev);
+
+	return 0;
+}
+
+DEFINE_DEBUGFS_ATTRIBUTE(dwc3_imod_interval_fops, dwc3_imod_interval_get,
+			 dwc3_imod_interval_set, "%llu\n");
+
+static int dwc3_evt_overflows_show(struct seq_file *s, void *unused)
+{
+	struct dwc3		*dwc = s->private;
+
+	seq_printf(s, "%lu\n", READ_ONCE(dwc->evt_overflows));
+
+	return 0;
+}
+
+DEFINE_SHOW_ATTRIBUTE(dwc3_evt_overflows);
+
 void dwc3_debugfs_init(struct dwc3 *dwc)
 {
 	struct dentry		*root;
@@ -1030,6 +1157,10 @@ void dwc3_debugfs_init(struct dwc3 *dwc)
 				&dwc3_testmode_fops);
 		debugfs_create_file("link_state", 0644, root, dwc,
 				    &dwc3_link_state_fops);
+		debugfs_create_file_unsafe("imod_interval", 0644, root, dwc,
+					   &dwc3_imod_interval_fops);
+		debugfs_create_file("evt_overflows", 0444, root, dwc,
+				    &dwc3_evt_overflows_fops);
 	}
 }
 
@@ -1219,7 +1219,8 @@ static void dwc3_prepare_one_trb(struct dwc3_ep *dep,
 	dma_addr_t		dma;
 	unsigned int		stream_id = req->request.stream_id;
 	unsigned int		short_not_ok = req->request.short_not_ok;
-	unsigned int		no_interrupt = req->request.no_interrupt;
+	unsigned int		no_interrupt = req->request.no_interrupt ||
+					       req->moderated;
 	unsigned int		is_last = req->request.is_last;
 	struct dwc3		*dwc = dep->dwc;
 	struct usb_gadget	*gadget = dwc->gadget;
@@ -1508,6 +1509,33 @@ static int dwc3_prepare_trbs_linear(struct dwc3_ep *dep,
 	return dwc3_prepare_last_sg(dep, req, req->request.length, 0);
 }
 
+/*
+ * Leave out the IOC of a bulk IN request followed by more requests, so that
+ * only one in dep->irq_moderation requests interrupts on completion.  The
+ * last request prepared always interrupts, or its completion wouldn't be
+ * seen, hence the TRBs needed by the request (one more for an extra TRB)
+ * must leave some for the next one.  OUT requests aren't moderated, a short
+ * packet completing one of them must be reported at once.
+ */
+static bool dwc3_gadget_ep_moderate(struct dwc3_ep *dep,
+		struct dwc3_request *req)
+{
+	unsigned int trbs = max(req->num_pending_sgs, 1U) + 1;
+
+	if (dep->irq_moderation <= 1 || dep->stream_capable ||
+	    !dep->direction || !usb_endpoint_xfer_bulk(dep->endpoint.desc))
+		return false;
+
+	if (list_is_last(&req->list, &dep->pending_list) ||
+	    dwc3_calc_trbs_left(dep) <= trbs ||
+	    ++dep->irq_count >= dep->irq_moderation) {
+		dep->irq_count = 0;
+		return false;
+	}
+
+	return true;
+}
+
 /*
  * dwc3_prepare_trbs - setup TRBs from requests
  * @dep: endpoint for which requests are being prepared
@@ -1567,17 +1595,26 @@ static int dwc3_prepare_trbs(struct dwc3_ep *dep)
 		req->start_sg		= req->sg;
 		req->num_queued_sgs	= 0;
 		req->num_pending_sgs	= req->request.num_mapped_sgs;
+		req->moderated		= dwc3_gadget_ep_moderate(dep, req);
 
 		if (req->num_pending_sgs > 0) {
 			ret = dwc3_prepare_trbs_sg(dep, req);
-			if (req->num_pending_sgs)
+			if (req->num_pending_sgs) {
+				dep->ring_full++;
 				return ret;
+			}
 		} else {
 			ret = dwc3_prepare_trbs_linear(dep, req);
 		}
 
-		if (!ret || !dwc3_calc_trbs_left(dep))
+		if (!ret)
+			return ret;
+
+		if (!dwc3_calc_trbs_left(dep)) {
+			if (!list_empty(&dep->pending_list))
+				dep->ring_full++;
 			return ret;
+		}
 
 		/*
 		 * Don't prepare beyond a transfer. In DWC_usb32, its transfer
@@ -1968,6 +2005,18 @@ static int __dwc3_gadget_ep_queue(struct dwc3_ep *dep, struct dwc3_request *req)
 		}
 	}
 
+	/*
+	 * While the controller has at least kick_batch TRBs left to process,
+	 * new requests wait to be prepared together on the next completion
+	 * instead of updating the transfer one by one.
+	 */
+	if (dep->kick_batch > 1 && (dep->flags & DWC3_EP_TRANSFER_STARTED) &&
+	    usb_endpoint_xfer_bulk(dep->endpoint.desc) && !dep->stream_capable &&
+	    DWC3_TRB_NUM - 1 - dwc3_calc_trbs_left(dep) >= dep->kick_batch) {
+		dep->deferred_kicks++;
+		return 0;
+	}
+
 	__dwc3_gadget_kick_transfer(dep);
 
 	return 0;
@@ -3142,6 +3191,8 @@ static int dwc3_gadget_init_endpoint(struct dwc3 *dwc, u8 epnum)
 	dwc->eps[epnum] = dep;
 	dep->combo_num = 0;
 	dep->start_cmd_status = 0;
+	dep->irq_moderation = 1;
+	dep->kick_batch = 1;
 
 	snprintf(dep->name, sizeof(dep->name), "ep%u%s", num,
 			direction ? "in" : "out");
@@ -3362,7 +3413,7 @@ static int dwc3_gadget_ep_cleanup_completed_request(struct dwc3_ep *dep,
 	 * needs to check and return the status of the completed TRBs associated
 	 * with the request. Use the status of the last TRB of the request.
 	 */
-	if (req->request.no_interrupt) {
+	if (req->request.no_interrupt || req->moderated) {
 		struct dwc3_trb *trb;
 
 		trb = dwc3_ep_prev_trb(dep, dep->trb_dequeue);
@@ -3449,6 +3500,9 @@ static bool dwc3_gadget_endpoint_trbs_complete(struct dwc3_ep *dep,
 
 	dwc3_gadget_ep_cleanup_completed_requests(dep, event, status);
 
+	if (list_empty(&dep->started_list) && !list_empty(&dep->pending_list))
+		dep->ring_empty++;
+
 	if (dep->flags & DWC3_EP_END_TRANSFER_PENDING)
 		goto out;
 
@@ -4250,7 +4304,9 @@ static void dwc3_gadget_interrupt(struct dwc3 *dwc,
 	case DWC3_DEVICE_EVENT_SOF:
 	case DWC3_DEVICE_EVENT_ERRATIC_ERROR:
 	case DWC3_DEVICE_EVENT_CMD_CMPL:
+		break;
 	case DWC3_DEVICE_EVENT_OVERFLOW:
+		dwc->evt_overflows++;
 		break;
 	default:
 		dev_WARN(dwc->dev, "UNKNOWN IRQ %d\n", event->type);
@@ -73,6 +73,10 @@ struct f_ncm {
 	struct sk_buff			*skb_tx_ndp;
 	u16				ndp_dgram_count;
 	struct hrtimer			task_timer;
+
+	/* Average time between two datagrams, to size the NTB timeout */
+	ktime_t				tx_last;
+	u64				tx_gap_avg;
 };
 
 static inline struct f_ncm *func_to_ncm(struct usb_function *f)
@@ -80,6 +84,11 @@ static inline struct f_ncm *func_to_ncm(struct usb_function *f)
 	return container_of(f, struct f_ncm, port.func);
 }
 
+static inline struct f_ncm_opts *ncm_to_opts(struct f_ncm *ncm)
+{
+	return container_of(ncm->port.func.fi, struct f_ncm_opts, func_inst);
+}
+
 /* peak (theoretical) bulk transfer rate in bits-per-second */
 static inline unsigned ncm_bitrate(struct usb_gadget *g)
 {
@@ -115,8 +124,13 @@ static inline unsigned ncm_bitrate(struct usb_gadget *g)
  */
 #define TX_MAX_NUM_DPE		32
 
-/* Delay for the transmit to wait before sending an unfilled NTB frame. */
+/*
+ * Delay for the transmit to wait before sending an unfilled NTB frame.
+ * It is twice the average time between datagrams, within these bounds,
+ * or the minimum when they come too far apart to share an NTB.
+ */
 #define TX_TIMEOUT_NSECS	300000
+#define TX_TIMEOUT_MIN_NSECS	20000
 
 #define FORMATS_SUPPORTED	(USB_CDC_NCM_NTB16_SUPPORTED |	\
 				 USB_CDC_NCM_NTB32_SUPPORTED)
@@ -949,8 +963,28 @@ static int ncm_get_alt(struct usb_function *f, unsigned intf)
 	return ncm->port.in_ep->enabled ? 1 : 0;
 }
 
+static void ncm_tx_gap_update(struct f_ncm *ncm)
+{
+	ktime_t now = ktime_get();
+	u64 gap = min_t(u64, ktime_to_ns(ktime_sub(now, ncm->tx_last)),
+			2 * TX_TIMEOUT_NSECS);
+
+	ncm->tx_last = now;
+	ncm->tx_gap_avg = ncm->tx_gap_avg - (ncm->tx_gap_avg >> 3) + (gap >> 3);
+}
+
+static u64 ncm_tx_timeout_ns(struct f_ncm *ncm)
+{
+	if (ncm->tx_gap_avg >= TX_TIMEOUT_NSECS)
+		return TX_TIMEOUT_MIN_NSECS;
+
+	return clamp_t(u64, 2 * ncm->tx_gap_avg, TX_TIMEOUT_MIN_NSECS,
+		       TX_TIMEOUT_NSECS);
+}
+
 static struct sk_buff *package_for_tx(struct f_ncm *ncm)
 {
+	struct f_ncm_opts *fopts = ncm_to_opts(ncm);
 	__le16		*ntb_iter;
 	struct sk_buff	*skb2 = NULL;
 	unsigned	ndp_pad;
@@ -979,6 +1013,8 @@ static struct sk_buff *package_for_tx(struct f_ncm *ncm)
 	/* Set the final NDP wLength */
 	new_len = opts->ndp_size +
 			(ncm->ndp_dgram_count * dgram_idx_len);
+	/* Not counting the zeroed entry */
+	fopts->tx_datagrams += ncm->ndp_dgram_count - 1;
 	ncm->ndp_dgram_count = 0;
 	/* Increment from start to wLength */
 	ntb_iter = (void *) ncm->skb_tx_ndp->data;
@@ -1003,6 +1039,9 @@ static struct sk_buff *package_for_tx(struct f_ncm *ncm)
 	/* Insert zero'd datagram. */
 	skb_put_zero(skb2, dgram_idx_len);
 
+	fopts->tx_ntbs++;
+	fopts->tx_ntb_bytes += skb2->len;
+
 	return skb2;
 }
 
@@ -1037,6 +1076,8 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 			put_unaligned_le32(crc, crc_pos);
 		}
 
+		ncm_tx_gap_update(ncm);
+
 		/* If the new skb is too big for the current NCM NTB then
 		 * set the current stored skb to be sent now and clear it
 		 * ready for new data.
@@ -1095,7 +1136,7 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 			/* Note: we skip opts->next_ndp_index */
 
 			/* Start the timer. */
-			hrtimer_start(&ncm->task_timer, TX_TIMEOUT_NSECS,
+			hrtimer_start(&ncm->task_timer, ncm_tx_timeout_ns(ncm),
 				      HRTIMER_MODE_REL_SOFT);
 		}
 
@@ -1123,6 +1164,7 @@ static struct sk_buff *ncm_wrap_ntb(struct gether *port,
 		 * because eth_start_xmit() was called with NULL skb by
 		 * ncm_tx_timeout() - hence, this is our signal to flush/send.
 		 */
+		ncm_to_opts(ncm)->tx_timeouts++;
 		skb2 = package_for_tx(ncm);
 		if (!skb2)
 			goto err;
@@ -1593,11 +1635,29 @@ USB_ETHERNET_CONFIGFS_ITEM_ATTR_QMULT(ncm);
 /* f_ncm_opts_ifname */
 USB_ETHERNET_CONFIGFS_ITEM_ATTR_IFNAME(ncm);
 
+/* configfs show methods don't get their attribute, one file has them all */
+static ssize_t ncm_opts_stats_show(struct config_item *item, char *page)
+{
+	struct f_ncm_opts *opts = to_f_ncm_opts(item);
+
+	return sprintf(page,
+		       "tx_ntbs %llu\n"
+		       "tx_datagrams %llu\n"
+		       "tx_ntb_bytes %llu\n"
+		       "tx_timeouts %llu\n",
+		       READ_ONCE(opts->tx_ntbs), READ_ONCE(opts->tx_datagrams),
+		       READ_ONCE(opts->tx_ntb_bytes),
+		       READ_ONCE(opts->tx_timeouts));
+}
+
+CONFIGFS_ATTR_RO(ncm_opts_, stats);
+
 static struct configfs_attribute *ncm_attrs[] = {
 	&ncm_opts_attr_dev_addr,
 	&ncm_opts_attr_host_addr,
 	&ncm_opts_attr_qmult,
 	&ncm_opts_attr_ifname,
+	&ncm_opts_attr_stats,
 	NULL,
 };
 
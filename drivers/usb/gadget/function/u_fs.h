@@ -278,6 +278,8 @@ struct ffs_data {
 	struct eventfd_ctx *ffs_eventfd;
 	struct workqueue_struct *io_completion_wq;
 	bool no_disconnect;
+	/* Mount option "dmabuf_depth", 0 if unlimited */
+	unsigned int dmabuf_depth;
 	struct work_struct reset_work;
 
 	/*
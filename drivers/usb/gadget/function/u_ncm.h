@@ -31,6 +31,12 @@ struct f_ncm_opts {
 	 */
 	struct mutex			lock;
 	int				refcnt;
+
+	/* TX aggregation statistics */
+	u64				tx_ntbs;
+	u64				tx_datagrams;
+	u64				tx_ntb_bytes;
+	u64				tx_timeouts;
 };
 
 #endif /* U_NCM_H */
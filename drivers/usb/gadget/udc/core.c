@@ -876,6 +876,12 @@ int usb_gadget_map_request_by_dev(struct device *dev,
 	if (req->length == 0)
 		return 0;
 
+	/* The SG list of an imported DMA-buf is mapped by its exporter */
+	if (req->sg_was_mapped) {
+		req->num_mapped_sgs = req->num_sgs;
+		return 0;
+	}
+
 	if (req->num_sgs) {
 		int     mapped;
 
@@ -924,6 +930,11 @@ void usb_gadget_unmap_request_by_dev(struct device *dev,
 	if (req->length == 0)
 		return;
 
+	if (req->sg_was_mapped) {
+		req->num_mapped_sgs = 0;
+		return;
+	}
+
 	if (req->num_mapped_sgs) {
 		dma_unmap_sg(dev, req->sg, req->num_sgs,
 				is_in ? DMA_TO_DEVICE : DMA_FROM_DEVICE);
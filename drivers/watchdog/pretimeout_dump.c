@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include <linux/kernel.h>
+#include <linux/kmsg_dump.h>
+#include <linux/module.h>
+#include <linux/nmi.h>
+#include <linux/watchdog.h>
+
+#include "watchdog_pretimeout.h"
+
+/**
+ * pretimeout_dump - Save the CPU backtraces on watchdog pretimeout event
+ * @wdd - watchdog_device
+ *
+ * The watchdog is about to reset the system, log the backtraces of all the
+ * CPUs and hand the log to the kmsg dumpers, such as pstore, so that the
+ * reason of the reset can be found after the reboot.  Waiting for the other
+ * CPUs can take longer than the time left before the reset, so the log is
+ * dumped once with the backtrace of this CPU first.
+ */
+static void pretimeout_dump(struct watchdog_device *wdd)
+{
+	pr_emerg("watchdog%d: pretimeout event, dumping CPU backtraces\n",
+		 wdd->id);
+
+	dump_stack();
+	kmsg_dump(KMSG_DUMP_OOPS);
+
+	if (trigger_allbutself_cpu_backtrace())
+		kmsg_dump(KMSG_DUMP_OOPS);
+}
+
+static struct watchdog_governor watchdog_gov_dump = {
+	.name		= "dump",
+	.pretimeout	= pretimeout_dump,
+};
+
+static int __init watchdog_gov_dump_register(void)
+{
+	return watchdog_register_governor(&watchdog_gov_dump);
+}
+
+static void __exit watchdog_gov_dump_unregister(void)
+{
+	watchdog_unregister_governor(&watchdog_gov_dump);
+}
+module_init(watchdog_gov_dump_register);
+module_exit(watchdog_gov_dump_unregister);
+
+MODULE_DESCRIPTION("Backtrace dumping watchdog pretimeout governor");
+MODULE_LICENSE("GPL");
@@ -30,6 +30,7 @@
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
 #include <linux/cdev.h>		/* For character device */
+#include <linux/cpu.h>		/* For cpus_read_lock */
 #include <linux/errno.h>	/* For the -ENODEV/... values */
 #include <linux/fs.h>		/* For file operations */
 #include <linux/init.h>		/* For __init/__exit/... */
@@ -39,10 +40,12 @@
 #include <linux/miscdevice.h>	/* For handling misc devices */
 #include <linux/module.h>	/* For module stuff/... */
 #include <linux/mutex.h>	/* For mutexes */
+#include <linux/percpu.h>	/* For the per-CPU heartbeats */
 #include <linux/slab.h>		/* For memory functions */
 #include <linux/types.h>	/* For standard types (like size_t) */
 #include <linux/watchdog.h>	/* For watchdog specific items */
 #include <linux/uaccess.h>	/* For copy_to_user/put_user/... */
+#include <linux/workqueue.h>	/* For the per-CPU heartbeats */
 
 #include "watchdog_core.h"
 #include "watchdog_pretimeout.h"
@@ -61,6 +64,71 @@ static bool handle_boot_enabled =
 
 static unsigned open_timeout = CONFIG_WATCHDOG_OPEN_TIMEOUT;
 
+static bool cpu_heartbeat;
+
+/*
+ * With cpu_heartbeat, the kernel feeds the watchdogs itself, but only once
+ * every online CPU ran the work queued on it by the previous keepalive.  A
+ * CPU only ever writes its own heartbeat, and all the keepalives run on
+ * watchdog_kworker, so no lock is needed.
+ */
+struct watchdog_cpu_beat {
+	struct work_struct work;
+	ktime_t queued;
+	ktime_t beat;
+};
+
+static DEFINE_PER_CPU(struct watchdog_cpu_beat, watchdog_cpu_beats);
+
+static void watchdog_cpu_beat_work(struct work_struct *work)
+{
+	struct watchdog_cpu_beat *b =
+		container_of(work, struct watchdog_cpu_beat, work);
+
+	WRITE_ONCE(b->beat, ktime_get());
+}
+
+/*
+ * watchdog_cpus_alive - check that all the CPUs made progress
+ * @wdd: The watchdog device about to be pinged
+ *
+ * Return: false if a CPU didn't run its heartbeat work for longer than the
+ * keepalive interval of @wdd, true otherwise.
+ */
+static bool watchdog_cpus_alive(struct watchdog_device *wdd)
+{
+	unsigned int hw_heartbeat_ms = min_not_zero(wdd->timeout * 1000,
+						    wdd->max_hw_heartbeat_ms);
+	s64 max_delay_ms = hw_heartbeat_ms / 2;
+	ktime_t now = ktime_get();
+	bool alive = true;
+	int cpu;
+
+	if (!cpu_heartbeat)
+		return true;
+
+	cpus_read_lock();
+	for_each_online_cpu(cpu) {
+		struct watchdog_cpu_beat *b = per_cpu_ptr(&watchdog_cpu_beats,
+							  cpu);
+
+		if (ktime_before(READ_ONCE(b->beat), b->queued)) {
+			if (ktime_ms_delta(now, b->queued) > max_delay_ms) {
+				pr_warn_ratelimited("watchdog%d: CPU%d stalled, not pinging\n",
+						    wdd->id, cpu);
+				alive = false;
+			}
+			continue;
+		}
+
+		b->queued = now;
+		queue_work_on(cpu, system_highpri_wq, &b->work);
+	}
+	cpus_read_unlock();
+
+	return alive;
+}
+
 static bool watchdog_past_open_deadline(struct watchdog_core_data *data)
 {
 	return ktime_after(ktime_get(), data->open_deadline);
@@ -68,7 +136,7 @@ static bool watchdog_past_open_deadline(struct watchdog_core_data *data)
 
 static void watchdog_set_open_deadline(struct watchdog_core_data *data)
 {
-	data->open_deadline = open_timeout ?
+	data->open_deadline = open_timeout && !cpu_heartbeat ?
 		ktime_get() + ktime_set(open_timeout, 0) : KTIME_MAX;
 }
 
@@ -220,8 +288,12 @@ static void watchdog_ping_work(struct kthread_work *work)
 	wd_data = container_of(work, struct watchdog_core_data, work);
 
 	mutex_lock(&wd_data->lock);
-	if (watchdog_worker_should_ping(wd_data))
-		__watchdog_ping(wd_data->wdd);
+	if (watchdog_worker_should_ping(wd_data)) {
+		if (watchdog_cpus_alive(wd_data->wdd))
+			__watchdog_ping(wd_data->wdd);
+		else
+			watchdog_update_worker(wd_data->wdd);
+	}
 	mutex_unlock(&wd_data->lock);
 }
 
@@ -1072,6 +1144,16 @@ static int watchdog_cdev_register(struct watchdog_device *wdd)
 	wd_data->last_hw_keepalive = ktime_sub(ktime_get(), 1);
 	watchdog_set_open_deadline(wd_data);
 
+	/* The kernel feeds the watchdog from now on, start it */
+	if (cpu_heartbeat && !watchdog_hw_running(wdd)) {
+		err = wdd->ops->start(wdd);
+		trace_watchdog_start(wdd, err);
+		if (err)
+			pr_err("watchdog%d failed to start: %d\n", wdd->id, err);
+		else
+			set_bit(WDOG_HW_RUNNING, &wdd->status);
+	}
+
 	/*
 	 * If the watchdog is running, prevent its driver from being unloaded,
 	 * and schedule an immediate ping.
@@ -1079,7 +1161,7 @@ static int watchdog_cdev_register(struct watchdog_device *wdd)
 	if (watchdog_hw_running(wdd)) {
 		__module_get(wdd->ops->owner);
 		get_device(&wd_data->dev);
-		if (handle_boot_enabled)
+		if (handle_boot_enabled || cpu_heartbeat)
 			hrtimer_start(&wd_data->timer, 0,
 				      HRTIMER_MODE_REL_HARD);
 		else
@@ -1208,6 +1290,11 @@ EXPORT_SYMBOL_GPL(watchdog_set_last_hw_keepalive);
 int __init watchdog_dev_init(void)
 {
 	int err;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		INIT_WORK(&per_cpu_ptr(&watchdog_cpu_beats, cpu)->work,
+			  watchdog_cpu_beat_work);
 
 	watchdog_kworker = kthread_create_worker(0, "watchdogd");
 	if (IS_ERR(watchdog_kworker)) {
@@ -1305,3 +1392,7 @@ module_param(open_timeout, uint, 0644);
 MODULE_PARM_DESC(open_timeout,
 	"Maximum time (in seconds, 0 means infinity) for userspace to take over a running watchdog (default="
 	__MODULE_STRING(CONFIG_WATCHDOG_OPEN_TIMEOUT) ")");
+
+module_param(cpu_heartbeat, bool, 0444);
+MODULE_PARM_DESC(cpu_heartbeat,
+	"Watchdog core starts and feeds the watchdogs as long as all the CPUs make progress (default=0)");
@@ -73,6 +73,9 @@ struct erofs_mount_opts {
 
 	/* threshold for decompression synchronously */
 	unsigned int max_sync_decompress_pages;
+
+	/* number of CPUs the pclusters of a request are decompressed on */
+	unsigned int max_decompress_threads;
 #endif
 	unsigned int mount_opt;
 };
@@ -1237,26 +1237,130 @@ static int z_erofs_decompress_pcluster(struct z_erofs_decompress_backend *be,
 	return err;
 }
 
-static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
-				     struct page **pagepool)
+/*
+ * Pclusters of a queue are independent from each other, so when there are
+ * several of them (typically for readahead), they are shared out between
+ * the caller and up to sbi->opt.max_decompress_threads - 1 helpers picking
+ * the next pcluster to decompress from the queue.
+ */
+#define Z_EROFS_MAX_DECOMPRESS_THREADS	8
+
+struct z_erofs_decompress_ctx {
+	const struct z_erofs_decompressqueue *io;
+	spinlock_t lock;
+	z_erofs_next_pcluster_t owned;
+	atomic_t nr_helpers;
+	struct completion done;
+};
+
+struct z_erofs_decompress_helper {
+	struct work_struct work;
+	struct z_erofs_decompress_ctx *ctx;
+};
+
+static struct z_erofs_pcluster *
+z_erofs_pick_pcluster(struct z_erofs_decompress_ctx *ctx)
+{
+	struct z_erofs_pcluster *pcl = NULL;
+
+	spin_lock(&ctx->lock);
+	if (ctx->owned != Z_EROFS_PCLUSTER_TAIL) {
+		DBG_BUGON(ctx->owned == Z_EROFS_PCLUSTER_NIL);
+
+		pcl = container_of(ctx->owned, struct z_erofs_pcluster, next);
+		ctx->owned = READ_ONCE(pcl->next);
+	}
+	spin_unlock(&ctx->lock);
+	return pcl;
+}
+
+static void z_erofs_decompress_pclusters(struct z_erofs_decompress_ctx *ctx,
+					 struct page **pagepool)
 {
 	struct z_erofs_decompress_backend be = {
-		.sb = io->sb,
+		.sb = ctx->io->sb,
 		.pagepool = pagepool,
 		.decompressed_secondary_bvecs =
 			LIST_HEAD_INIT(be.decompressed_secondary_bvecs),
 	};
+
+	while ((be.pcl = z_erofs_pick_pcluster(ctx))) {
+		z_erofs_decompress_pcluster(&be, ctx->io->eio ? -EIO : 0);
+		erofs_workgroup_put(&be.pcl->obj);
+	}
+}
+
+static void z_erofs_decompress_helper_work(struct work_struct *work)
+{
+	struct z_erofs_decompress_helper *helper =
+		container_of(work, struct z_erofs_decompress_helper, work);
+	struct z_erofs_decompress_ctx *ctx = helper->ctx;
+	struct page *pagepool = NULL;
+
+	z_erofs_decompress_pclusters(ctx, &pagepool);
+	erofs_release_pages(&pagepool);
+
+	if (atomic_dec_and_test(&ctx->nr_helpers))
+		complete(&ctx->done);
+}
+
+static unsigned int z_erofs_nr_decompress_helpers(
+				const struct z_erofs_decompressqueue *io)
+{
+	unsigned int max = min3(EROFS_SB(io->sb)->opt.max_decompress_threads,
+				num_online_cpus(), Z_EROFS_MAX_DECOMPRESS_THREADS);
 	z_erofs_next_pcluster_t owned = io->head;
+	unsigned int nr = 0;
 
-	while (owned != Z_EROFS_PCLUSTER_TAIL) {
-		DBG_BUGON(owned == Z_EROFS_PCLUSTER_NIL);
+	/* count the pclusters which could be given to a helper */
+	while (owned != Z_EROFS_PCLUSTER_TAIL && nr < max) {
+		owned = READ_ONCE(container_of(owned, struct z_erofs_pcluster,
+					       next)->next);
+		++nr;
+	}
+	return nr ? nr - 1 : 0;
+}
 
-		be.pcl = container_of(owned, struct z_erofs_pcluster, next);
-		owned = READ_ONCE(be.pcl->next);
+static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
+				     struct page **pagepool)
+{
+	struct z_erofs_decompress_helper helpers[Z_EROFS_MAX_DECOMPRESS_THREADS];
+	struct z_erofs_decompress_ctx ctx = {
+		.io = io,
+		.owned = io->head,
+	};
+	unsigned int i, nr = z_erofs_nr_decompress_helpers(io);
 
-		z_erofs_decompress_pcluster(&be, io->eio ? -EIO : 0);
-		erofs_workgroup_put(&be.pcl->obj);
+	spin_lock_init(&ctx.lock);
+	atomic_set(&ctx.nr_helpers, nr);
+	init_completion(&ctx.done);
+
+	for (i = 0; i < nr; ++i) {
+		helpers[i].ctx = &ctx;
+		INIT_WORK_ONSTACK(&helpers[i].work,
+				  z_erofs_decompress_helper_work);
+		queue_work(z_erofs_workqueue, &helpers[i].work);
 	}
+
+	z_erofs_decompress_pclusters(&ctx, pagepool);
+
+	if (!nr)
+		return;
+
+	/*
+	 * The queue is empty now.  Helpers which haven't started yet would
+	 * have nothing left to do, and may be waiting behind the caller if it
+	 * runs on z_erofs_workqueue too, so take them back.
+	 */
+	for (i = 0; i < nr; ++i)
+		if (cancel_work(&helpers[i].work) &&
+		    atomic_dec_and_test(&ctx.nr_helpers))
+			complete(&ctx.done);
+
+	wait_for_completion(&ctx.done);
+
+	for (i = 0; i < nr; ++i)
+		destroy_work_on_stack(&helpers[i].work);
 }
 
 static void z_erofs_decompressqueue_work(struct work_struct *work)
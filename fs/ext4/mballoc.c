@@ -2947,6 +2947,13 @@ int ext4_seq_mb_stats_show(struct seq_file *seq, void *offset)
 	seq_printf(seq, "\t\t2^n_hits: %u\n", atomic_read(&sbi->s_bal_2orders));
 	seq_printf(seq, "\t\tbreaks: %u\n", atomic_read(&sbi->s_bal_breaks));
 	seq_printf(seq, "\t\tlost: %u\n", atomic_read(&sbi->s_mb_lost_chunks));
+	if (sbi->s_stripe) {
+		seq_printf(seq, "\tstripe: %lu\n", sbi->s_stripe);
+		seq_printf(seq, "\t\taligned: %u\n",
+			   atomic_read(&sbi->s_bal_stripe_aligned));
+		seq_printf(seq, "\t\tunaligned: %u\n",
+			   atomic_read(&sbi->s_bal_stripe_unaligned));
+	}
 
 	seq_printf(seq, "\tbuddies_generated: %u/%u\n",
 		   atomic_read(&sbi->s_mb_buddies_generated),
@@ -4251,6 +4258,16 @@ static void ext4_mb_collect_stats(struct ext4_allocation_context *ac)
 			atomic_inc(&sbi->s_bal_goals);
 		if (ac->ac_found > sbi->s_mb_max_to_scan)
 			atomic_inc(&sbi->s_bal_breaks);
+		if (sbi->s_stripe &&
+		    EXT4_C2B(sbi, ac->ac_b_ex.fe_len) >= sbi->s_stripe) {
+			ext4_fsblk_t start = ext4_grp_offs_to_block(ac->ac_sb,
+								   &ac->ac_b_ex);
+
+			if (do_div(start, sbi->s_stripe))
+				atomic_inc(&sbi->s_bal_stripe_unaligned);
+			else
+				atomic_inc(&sbi->s_bal_stripe_aligned);
+		}
 	}
 
 	if (ac->ac_op == EXT4_MB_HISTORY_ALLOC)
@@ -1591,7 +1591,7 @@ enum {
 	Opt_dioread_nolock, Opt_dioread_lock,
 	Opt_discard, Opt_nodiscard, Opt_init_itable, Opt_noinit_itable,
 	Opt_max_dir_size_kb, Opt_nojournal_checksum, Opt_nombcache,
-	Opt_no_prefetch_block_bitmaps, Opt_mb_optimize_scan,
+	Opt_no_prefetch_block_bitmaps, Opt_mb_optimize_scan, Opt_erase_align,
 	Opt_errors, Opt_data, Opt_data_err, Opt_jqfmt, Opt_dax_type,
 #ifdef CONFIG_EXT4_DEBUG
 	Opt_fc_debug_max_replay, Opt_fc_debug_force
@@ -1734,6 +1734,7 @@ static const struct fs_parameter_spec ext4_param_specs[] = {
 	fsparam_flag	("no_prefetch_block_bitmaps",
 						Opt_no_prefetch_block_bitmaps),
 	fsparam_s32	("mb_optimize_scan",	Opt_mb_optimize_scan),
+	fsparam_flag	("erase_align",		Opt_erase_align),
 	fsparam_string	("check",		Opt_removed),	/* mount option from ext2/3 */
 	fsparam_flag	("nocheck",		Opt_removed),	/* mount option from ext2/3 */
 	fsparam_flag	("reservation",		Opt_removed),	/* mount option from ext2/3 */
@@ -1828,6 +1829,8 @@ static const struct mount_opts {
 	{Opt_nombcache, EXT4_MOUNT_NO_MBCACHE, MOPT_SET},
 	{Opt_no_prefetch_block_bitmaps, EXT4_MOUNT_NO_PREFETCH_BLOCK_BITMAPS,
 	 MOPT_SET},
+	{Opt_erase_align, EXT4_MOUNT2_ERASE_ALIGN,
+	 MOPT_SET | MOPT_2 | MOPT_EXT4_ONLY},
 #ifdef CONFIG_EXT4_DEBUG
 	{Opt_fc_debug_force, EXT4_MOUNT2_JOURNAL_FAST_COMMIT,
 	 MOPT_SET | MOPT_2 | MOPT_EXT4_ONLY},
@@ -3505,20 +3508,32 @@ static ext4_fsblk_t descriptor_loc(struct super_block *sb,
  * If the super block value is greater than blocks per group return 0.
  * Allocator needs it be less than blocks per group.
  *
+ * With the erase_align mount option and no stripe set anywhere else, the
+ * discard granularity of the device is used instead.  For eMMC and SD
+ * cards, that is the preferred erase size, so allocations are packed into
+ * erase units instead of being scattered over the ones already in use.
+ *
  */
 static unsigned long ext4_get_stripe_size(struct ext4_sb_info *sbi)
 {
 	unsigned long stride = le16_to_cpu(sbi->s_es->s_raid_stride);
 	unsigned long stripe_width =
 			le32_to_cpu(sbi->s_es->s_raid_stripe_width);
+	unsigned long erase = 0;
 	int ret;
 
+	if (test_opt2(sbi->s_sb, ERASE_ALIGN))
+		erase = bdev_discard_granularity(sbi->s_sb->s_bdev) >>
+			sbi->s_sb->s_blocksize_bits;
+
 	if (sbi->s_stripe && sbi->s_stripe <= sbi->s_blocks_per_group)
 		ret = sbi->s_stripe;
 	else if (stripe_width && stripe_width <= sbi->s_blocks_per_group)
 		ret = stripe_width;
 	else if (stride && stride <= sbi->s_blocks_per_group)
 		ret = stride;
+	else if (erase && erase <= sbi->s_blocks_per_group)
+		ret = erase;
 	else
 		ret = 0;
 
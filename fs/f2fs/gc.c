@@ -28,6 +28,64 @@ static struct kmem_cache *victim_entry_slab;
 static unsigned int count_bits(const unsigned long *addr,
 				unsigned int offset, unsigned int len);
 
+static void f2fs_gc_dev_stat(struct f2fs_sb_info *sbi, u64 *ios,
+				u64 *wr_ios, u64 *wr_nsecs)
+{
+	int ndevs = f2fs_is_multi_device(sbi) ? sbi->s_ndevs : 1;
+	struct block_device *bdev;
+	int i;
+
+	*ios = *wr_ios = *wr_nsecs = 0;
+
+	for (i = 0; i < ndevs; i++) {
+		bdev = f2fs_is_multi_device(sbi) ? FDEV(i).bdev :
+							sbi->sb->s_bdev;
+		bdev = bdev_whole(bdev);
+
+		*ios += part_stat_read(bdev, ios[STAT_READ]) +
+			part_stat_read(bdev, ios[STAT_WRITE]) +
+			part_stat_read(bdev, ios[STAT_DISCARD]) +
+			part_stat_read(bdev, ios[STAT_FLUSH]);
+		*wr_ios += part_stat_read(bdev, ios[STAT_WRITE]);
+		*wr_nsecs += part_stat_read(bdev, nsecs[STAT_WRITE]);
+	}
+}
+
+/*
+ * The in-flight counters checked by is_idle() only account for the IOs of
+ * this file system, while the disks under it may be shared with the other
+ * partitions of an eMMC.  Note whether the disks completed any request
+ * since the last check, and the mean latency of their writes, unless
+ * @gc_io tells these requests were issued by the garbage collection.
+ *
+ * Returns true when the disks have been idle for the GC idle interval.
+ */
+static bool f2fs_gc_dev_idle(struct f2fs_sb_info *sbi,
+				struct f2fs_gc_kthread *gc_th, bool gc_io)
+{
+	u64 ios, wr_ios, wr_nsecs;
+
+	f2fs_gc_dev_stat(sbi, &ios, &wr_ios, &wr_nsecs);
+
+	if (!gc_io && ios != gc_th->dev_ios) {
+		if (wr_ios > gc_th->dev_wr_ios) {
+			gc_th->dev_wr_lat = div64_u64(wr_nsecs -
+						gc_th->dev_wr_nsecs,
+				(wr_ios - gc_th->dev_wr_ios) * NSEC_PER_USEC);
+			gc_th->dev_wr_lat_peak = max(gc_th->dev_wr_lat_peak,
+							gc_th->dev_wr_lat);
+		}
+		gc_th->dev_busy = jiffies;
+	}
+
+	gc_th->dev_ios = ios;
+	gc_th->dev_wr_ios = wr_ios;
+	gc_th->dev_wr_nsecs = wr_nsecs;
+
+	return time_after_eq(jiffies, gc_th->dev_busy +
+				sbi->interval_time[GC_TIME] * HZ);
+}
+
 static int gc_thread_func(void *data)
 {
 	struct f2fs_sb_info *sbi = data;
@@ -88,8 +146,8 @@ static int gc_thread_func(void *data)
 		 * 0. GC is not conducted currently.
 		 * 1. There are enough dirty segments.
 		 * 2. IO subsystem is idle by checking the # of writeback pages.
-		 * 3. IO subsystem is idle by checking the # of requests in
-		 *    bdev's request list.
+		 * 3. IO subsystem is idle by checking the # of requests
+		 *    completed by the disks under the file system.
 		 *
 		 * Note) We have to avoid triggering GCs frequently.
 		 * Because it is possible that some segments can be
@@ -118,6 +176,19 @@ static int gc_thread_func(void *data)
 			goto next;
 		}
 
+		/*
+		 * Look at the disks again after an idle interval, rather
+		 * than after the usual sleep time, so the next idle window
+		 * is not missed.
+		 */
+		if (!f2fs_gc_dev_idle(sbi, gc_th, false)) {
+			wait_ms = min_t(unsigned int, wait_ms,
+				sbi->interval_time[GC_TIME] * MSEC_PER_SEC);
+			f2fs_up_write(&sbi->gc_lock);
+			stat_dev_skip_bggc_count(sbi);
+			goto next;
+		}
+
 		if (has_enough_invalid_blocks(sbi))
 			decrease_sleep_time(gc_th, &wait_ms);
 		else
@@ -146,6 +217,9 @@ static int gc_thread_func(void *data)
 		if (foreground)
 			wake_up_all(&gc_th->fggc_wq);
 
+		/* don't take our own requests for someone else's */
+		f2fs_gc_dev_idle(sbi, gc_th, true);
+
 		trace_f2fs_background_gc(sbi->sb, wait_ms,
 				prefree_segments(sbi), free_segments(sbi));
 
@@ -186,6 +260,12 @@ int f2fs_start_gc_thread(struct f2fs_sb_info *sbi)
 
 	gc_th->gc_wake = 0;
 
+	gc_th->dev_busy = jiffies;
+	gc_th->dev_wr_lat = 0;
+	gc_th->dev_wr_lat_peak = 0;
+	f2fs_gc_dev_stat(sbi, &gc_th->dev_ios, &gc_th->dev_wr_ios,
+					&gc_th->dev_wr_nsecs);
+
 	sbi->gc_thread = gc_th;
 	init_waitqueue_head(&sbi->gc_thread->gc_wait_queue_head);
 	init_waitqueue_head(&sbi->gc_thread->fggc_wq);
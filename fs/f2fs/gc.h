@@ -45,6 +45,14 @@ struct f2fs_gc_kthread {
 	/* for changing gc mode */
 	unsigned int gc_wake;
 
+	/* for device idle detection */
+	unsigned long dev_busy;		/* jiffies the disks were seen busy */
+	u64 dev_ios;			/* # of requests of the disks */
+	u64 dev_wr_ios;			/* # of them being writes */
+	u64 dev_wr_nsecs;		/* time spent on those writes */
+	u64 dev_wr_lat;			/* last mean write latency (us) */
+	u64 dev_wr_lat_peak;		/* highest dev_wr_lat seen */
+
 	/* for GC_MERGE mount option */
 	wait_queue_head_t fggc_wq;		/*
 						 * caller of f2fs_balance_fs()
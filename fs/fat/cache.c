@@ -14,6 +14,9 @@
 
 /* this must be > 0. */
 #define FAT_MAX_CACHE	8
+/* for the files of at least FAT_LARGE_FILE clusters */
+#define FAT_MAX_CACHE_LARGE	64
+#define FAT_LARGE_FILE		16384
 
 struct fat_cache {
 	struct list_head cache_list;
@@ -31,6 +34,13 @@ struct fat_cache_id {
 
 static inline int fat_max_cache(struct inode *inode)
 {
+	/*
+	 * A seek in a large file walks the cluster chain from the nearest
+	 * cached fragment, so remember more of them.
+	 */
+	if ((i_size_read(inode) >> MSDOS_SB(inode->i_sb)->cluster_bits) >=
+	    FAT_LARGE_FILE)
+		return FAT_MAX_CACHE_LARGE;
 	return FAT_MAX_CACHE;
 }
 
@@ -4,6 +4,7 @@
  */
 
 #include <linux/blkdev.h>
+#include <linux/sched/mm.h>
 #include <linux/sched/signal.h>
 #include <linux/backing-dev-defs.h>
 #include "fat.h"
@@ -463,6 +464,8 @@ static void fat_collect_bhs(struct buffer_head **bhs, int *nr_bhs,
 	}
 }
 
+static void fat_build_free_bitmap(struct super_block *sb);
+
 int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 {
 	struct super_block *sb = inode->i_sb;
@@ -481,6 +484,9 @@ int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 		return -ENOSPC;
 	}
 
+	if (!sbi->free_bitmap_tried)
+		fat_build_free_bitmap(sb);
+
 	err = nr_bhs = idx_clus = 0;
 	count = FAT_START_ENT;
 	fatent_init(&prev_ent);
@@ -489,6 +495,19 @@ int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 	while (count < sbi->max_cluster) {
 		if (fatent.entry >= sbi->max_cluster)
 			fatent.entry = FAT_START_ENT;
+		if (sbi->free_bitmap) {
+			/* skip the blocks without any free entry */
+			unsigned long next = find_next_bit(sbi->free_bitmap,
+							   sbi->max_cluster,
+							   fatent.entry);
+
+			count += next - fatent.entry;
+			fatent.entry = next;
+			if (count >= sbi->max_cluster)
+				break;
+			if (next >= sbi->max_cluster)
+				continue;
+		}
 		fatent_set_entry(&fatent, fatent.entry);
 		err = fat_ent_read_block(sb, &fatent);
 		if (err)
@@ -506,6 +525,8 @@ int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 
 				fat_collect_bhs(bhs, &nr_bhs, &fatent);
 
+				if (sbi->free_bitmap)
+					__clear_bit(entry, sbi->free_bitmap);
 				sbi->prev_free = entry;
 				if (sbi->free_clusters != -1)
 					sbi->free_clusters--;
@@ -520,6 +541,8 @@ int fat_alloc_clusters(struct inode *inode, int *cluster, int nr_cluster)
 				 * so we can still use the prev_ent.
 				 */
 				prev_ent = fatent;
+			} else if (sbi->free_bitmap) {
+				__clear_bit(fatent.entry, sbi->free_bitmap);
 			}
 			count++;
 			if (count == sbi->max_cluster)
@@ -595,6 +618,8 @@ int fat_free_clusters(struct inode *inode, int cluster)
 		}
 
 		ops->ent_put(&fatent, FAT_ENT_FREE);
+		if (sbi->free_bitmap)
+			__set_bit(fatent.entry, sbi->free_bitmap);
 		if (sbi->free_clusters != -1) {
 			sbi->free_clusters++;
 			dirty_fsinfo = 1;
@@ -752,6 +777,63 @@ int fat_count_free_clusters(struct super_block *sb)
 	return err;
 }
 
+/*
+ * Record the free clusters in a bitmap, so fat_alloc_clusters() doesn't have
+ * to read the blocks of the FAT without any free entry.  It is built once,
+ * on the first allocation, from a full scan of the FAT, which also counts
+ * the free clusters.  Without enough memory for it, the allocator keeps on
+ * scanning the FAT.
+ *
+ * Called with the FAT locked.
+ */
+static void fat_build_free_bitmap(struct super_block *sb)
+{
+	struct msdos_sb_info *sbi = MSDOS_SB(sb);
+	const struct fatent_operations *ops = sbi->fatent_ops;
+	struct fat_entry fatent;
+	struct fatent_ra fatent_ra;
+	unsigned long *bitmap;
+	unsigned int nofs_flags;
+	int free = 0;
+
+	sbi->free_bitmap_tried = 1;
+
+	nofs_flags = memalloc_nofs_save();
+	bitmap = kvcalloc(BITS_TO_LONGS(sbi->max_cluster), sizeof(long),
+			  GFP_KERNEL | __GFP_NOWARN);
+	memalloc_nofs_restore(nofs_flags);
+	if (!bitmap)
+		return;
+
+	fatent_init(&fatent);
+	fatent_set_entry(&fatent, FAT_START_ENT);
+	fat_ra_init(sb, &fatent_ra, &fatent, sbi->max_cluster);
+	while (fatent.entry < sbi->max_cluster) {
+		/* readahead of fat blocks */
+		fat_ent_reada(sb, &fatent_ra, &fatent);
+
+		if (fat_ent_read_block(sb, &fatent)) {
+			fatent_brelse(&fatent);
+			kvfree(bitmap);
+			return;
+		}
+
+		do {
+			if (ops->ent_get(&fatent) == FAT_ENT_FREE) {
+				__set_bit(fatent.entry, bitmap);
+				free++;
+			}
+		} while (fat_ent_next(sbi, &fatent));
+		cond_resched();
+	}
+	fatent_brelse(&fatent);
+
+	sbi->free_bitmap = bitmap;
+	sbi->free_clusters = free;
+	sbi->free_clus_valid = 1;
+	mark_fsinfo_dirty(sb);
+}
+
 static int fat_trim_clusters(struct super_block *sb, u32 clus, u32 nr_clus)
 {
 	struct msdos_sb_info *sbi = MSDOS_SB(sb);
@@ -739,6 +739,8 @@ static void fat_put_super(struct super_block *sb)
 	iput(sbi->fsinfo_inode);
 	iput(sbi->fat_inode);
 
+	kvfree(sbi->free_bitmap);
+
 	call_rcu(&sbi->rcu, delayed_free);
 }
 
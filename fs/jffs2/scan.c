@@ -18,12 +18,16 @@
 #include <linux/pagemap.h>
 #include <linux/crc32.h>
 #include <linux/compiler.h>
+#include <linux/workqueue.h>
 #include "nodelist.h"
 #include "summary.h"
 #include "debug.h"
 
 #define DEFAULT_EMPTY_SCAN_SIZE 256
 
+/* Maximum number of eraseblocks read in parallel ahead of the scan */
+#define JFFS2_SCAN_AHEAD_WORKERS 4
+
 #define noisy_printk(noise, fmt, ...)					\
 do {									\
 	if (*(noise)) {							\
@@ -36,8 +40,34 @@ do {									\
 
 static uint32_t pseudo_random;
 
+/*
+ * An eraseblock read ahead by a worker while the previous ones are scanned.
+ * The worker guesses what the scan is going to look at: the summary if there
+ * is one, only the beginning of the block if it looks free, else the whole
+ * block.  jffs2_fill_scan_buf() serves the scan from the ranges that were
+ * read and goes to the flash for the rest, so a wrong guess only costs time.
+ */
+struct jffs2_scan_slot {
+	struct work_struct work;
+	struct completion done;
+	struct jffs2_sb_info *c;
+	struct jffs2_eraseblock *jeb;
+	unsigned char *buf;
+	uint32_t head;		/* [0, head) of the block is in buf */
+	uint32_t tail;		/* [tail, sector_size) of the block is in buf */
+};
+
+struct jffs2_scan_ahead {
+	int nr_slots;
+	struct jffs2_scan_slot slot[];
+};
+
 static int jffs2_scan_eraseblock (struct jffs2_sb_info *c, struct jffs2_eraseblock *jeb,
-				  unsigned char *buf, uint32_t buf_size, struct jffs2_summary *s);
+				  unsigned char *buf, uint32_t buf_size, struct jffs2_summary *s,
+				  const struct jffs2_scan_slot *slot);
+static int jffs2_fill_scan_buf(struct jffs2_sb_info *c,
+			       const struct jffs2_scan_slot *slot, void *buf,
+			       uint32_t ofs, uint32_t len);
 
 /* These helper functions _must_ increase ofs and also do the dirty/used space accounting.
  * Returning an error will abort the mount - bad checksums etc. should just mark the space
@@ -88,6 +118,144 @@ static int file_dirty(struct jffs2_sb_info *c, struct jffs2_eraseblock *jeb)
 	return 0;
 }
 
+/* Does the beginning of the block hold nothing more than a cleanmarker? */
+static bool jffs2_scan_ahead_free(unsigned char *buf, uint32_t len)
+{
+	struct jffs2_unknown_node *node = (void *)buf;
+	uint32_t ofs = 0;
+
+	if (je16_to_cpu(node->magic) == JFFS2_MAGIC_BITMASK &&
+	    je16_to_cpu(node->nodetype) == JFFS2_NODETYPE_CLEANMARKER)
+		ofs = PAD(sizeof(*node));
+
+	for (; ofs < len; ofs += 4)
+		if (*(uint32_t *)(&buf[ofs]) != 0xFFFFFFFF)
+			return false;
+
+	return true;
+}
+
+/* Read the summary of the block, like jffs2_scan_eraseblock() would */
+static bool jffs2_scan_ahead_summary(struct jffs2_scan_slot *slot)
+{
+	struct jffs2_sb_info *c = slot->c;
+	uint32_t ofs = slot->jeb->offset;
+	struct jffs2_sum_marker *sm;
+	uint32_t len, sumofs;
+
+	len = c->wbuf_pagesize ? c->wbuf_pagesize : sizeof(*sm);
+	if (len > c->sector_size ||
+	    jffs2_fill_scan_buf(c, NULL, slot->buf + c->sector_size - len,
+				ofs + c->sector_size - len, len))
+		return false;
+
+	slot->tail = c->sector_size - len;
+
+	sm = (void *)slot->buf + c->sector_size - sizeof(*sm);
+	if (je32_to_cpu(sm->magic) != JFFS2_SUM_MAGIC)
+		return false;
+
+	sumofs = je32_to_cpu(sm->offset);
+	if (sumofs >= slot->tail)
+		return sumofs < c->sector_size;
+
+	if (jffs2_fill_scan_buf(c, NULL, slot->buf + sumofs, ofs + sumofs,
+				slot->tail - sumofs))
+		return false;
+
+	slot->tail = sumofs;
+	return true;
+}
+
+static void jffs2_scan_ahead_work(struct work_struct *work)
+{
+	struct jffs2_scan_slot *slot =
+		container_of(work, struct jffs2_scan_slot, work);
+	struct jffs2_sb_info *c = slot->c;
+	uint32_t ofs = slot->jeb->offset;
+	uint32_t head = EMPTY_SCAN_SIZE(c->sector_size);
+
+	slot->head = 0;
+	slot->tail = c->sector_size;
+
+	if (jffs2_sum_active() && jffs2_scan_ahead_summary(slot))
+		goto out;
+
+	if (jffs2_fill_scan_buf(c, NULL, slot->buf, ofs, head))
+		goto out;
+	slot->head = head;
+
+	if (!jffs2_scan_ahead_free(slot->buf, head) &&
+	    !jffs2_fill_scan_buf(c, NULL, slot->buf + head, ofs + head,
+				 c->sector_size - head))
+		slot->head = c->sector_size;
+ out:
+	complete(&slot->done);
+}
+
+static void jffs2_scan_ahead_queue(struct jffs2_sb_info *c,
+				   struct jffs2_scan_slot *slot, int block)
+{
+	slot->jeb = &c->blocks[block];
+	reinit_completion(&slot->done);
+	queue_work(system_unbound_wq, &slot->work);
+}
+
+static void jffs2_scan_ahead_stop(struct jffs2_scan_ahead *scan)
+{
+	int i;
+
+	if (!scan)
+		return;
+
+	for (i = 0; i < scan->nr_slots; i++) {
+		flush_work(&scan->slot[i].work);
+		kfree(scan->slot[i].buf);
+	}
+	kfree(scan);
+}
+
+/*
+ * Eraseblocks are only read ahead when the scan reads into a buffer: when the
+ * flash is pointed to, there is nothing to read ahead.  If the memory can't
+ * be found, the blocks are just read by the scan itself.
+ */
+static struct jffs2_scan_ahead *jffs2_scan_ahead_start(struct jffs2_sb_info *c)
+{
+	struct jffs2_scan_ahead *scan;
+	int i, nr_slots;
+
+	nr_slots = 2 * min_t(int, num_online_cpus(), JFFS2_SCAN_AHEAD_WORKERS);
+	nr_slots = min_t(int, nr_slots, c->nr_blocks);
+	if (nr_slots < 2)
+		return NULL;
+
+	scan = kzalloc(struct_size(scan, slot, nr_slots), GFP_KERNEL);
+	if (!scan)
+		return NULL;
+
+	for (i = 0; i < nr_slots; i++) {
+		struct jffs2_scan_slot *slot = &scan->slot[i];
+
+		slot->buf = kmalloc(c->sector_size, GFP_KERNEL | __GFP_NOWARN);
+		if (!slot->buf) {
+			jffs2_scan_ahead_stop(scan);
+			return NULL;
+		}
+		slot->c = c;
+		INIT_WORK(&slot->work, jffs2_scan_ahead_work);
+		init_completion(&slot->done);
+		scan->nr_slots++;
+	}
+
+	for (i = 0; i < nr_slots; i++)
+		jffs2_scan_ahead_queue(c, &scan->slot[i], i);
+
+	jffs2_dbg(1, "Reading %d eraseblocks ahead of the scan\n", nr_slots);
+
+	return scan;
+}
+
 int jffs2_scan_medium(struct jffs2_sb_info *c)
 {
 	int i, ret;
@@ -95,6 +263,8 @@ int jffs2_scan_medium(struct jffs2_sb_info *c)
 	unsigned char *flashbuf = NULL;
 	uint32_t buf_size = 0;
 	struct jffs2_summary *s = NULL; /* summary info collected by the scan process */
+	struct jffs2_scan_ahead *scan = NULL;
+	struct jffs2_scan_slot *slot = NULL;
 #ifndef __ECOS
 	size_t pointlen, try_size;
 
@@ -140,20 +310,31 @@ int jffs2_scan_medium(struct jffs2_sb_info *c)
 		}
 	}
 
+	if (buf_size)
+		scan = jffs2_scan_ahead_start(c);
+
 	for (i=0; i<c->nr_blocks; i++) {
 		struct jffs2_eraseblock *jeb = &c->blocks[i];
 
 		cond_resched();
 
+		if (scan) {
+			slot = &scan->slot[i % scan->nr_slots];
+			wait_for_completion(&slot->done);
+		}
+
 		/* reset summary info for next eraseblock scan */
 		jffs2_sum_reset_collected(s);
 
 		ret = jffs2_scan_eraseblock(c, jeb, buf_size?flashbuf:(flashbuf+jeb->offset),
-						buf_size, s);
+						buf_size, s, slot);
 
 		if (ret < 0)
 			goto out;
 
+		if (scan && i + scan->nr_slots < c->nr_blocks)
+			jffs2_scan_ahead_queue(c, slot, i + scan->nr_slots);
+
 		jffs2_dbg_acct_paranoia_check_nolock(c, jeb);
 
 		/* Now decide which list to put it on */
@@ -275,6 +456,7 @@ int jffs2_scan_medium(struct jffs2_sb_info *c)
 	}
 	ret = 0;
  out:
+	jffs2_scan_ahead_stop(scan);
 	jffs2_sum_reset_collected(s);
 	kfree(s);
  out_buf:
@@ -287,12 +469,23 @@ int jffs2_scan_medium(struct jffs2_sb_info *c)
 	return ret;
 }
 
-static int jffs2_fill_scan_buf(struct jffs2_sb_info *c, void *buf,
+static int jffs2_fill_scan_buf(struct jffs2_sb_info *c,
+			       const struct jffs2_scan_slot *slot, void *buf,
 			       uint32_t ofs, uint32_t len)
 {
 	int ret;
 	size_t retlen;
 
+	if (slot && ofs >= slot->jeb->offset &&
+	    ofs + len <= slot->jeb->offset + c->sector_size) {
+		uint32_t start = ofs - slot->jeb->offset;
+
+		if (start + len <= slot->head || start >= slot->tail) {
+			memcpy(buf, slot->buf + start, len);
+			return 0;
+		}
+	}
+
 	ret = jffs2_flash_read(c, ofs, len, &retlen, buf);
 	if (ret) {
 		jffs2_dbg(1, "mtd->read(0x%x bytes from 0x%x) returned %d\n",
@@ -443,7 +636,8 @@ static int jffs2_scan_xref_node(struct jffs2_sb_info *c, struct jffs2_eraseblock
 /* Called with 'buf_size == 0' if buf is in fact a pointer _directly_ into
    the flash, XIP-style */
 static int jffs2_scan_eraseblock (struct jffs2_sb_info *c, struct jffs2_eraseblock *jeb,
-				  unsigned char *buf, uint32_t buf_size, struct jffs2_summary *s) {
+				  unsigned char *buf, uint32_t buf_size, struct jffs2_summary *s,
+				  const struct jffs2_scan_slot *slot) {
 	struct jffs2_unknown_node *node;
 	struct jffs2_unknown_node crcnode;
 	uint32_t ofs, prevofs, max_ofs;
@@ -502,7 +696,7 @@ static int jffs2_scan_eraseblock (struct jffs2_sb_info *c, struct jffs2_eraseblo
 				buf_len = sizeof(*sm);
 
 			/* Read as much as we want into the _end_ of the preallocated buffer */
-			err = jffs2_fill_scan_buf(c, buf + buf_size - buf_len, 
+			err = jffs2_fill_scan_buf(c, slot, buf + buf_size - buf_len, 
 						  jeb->offset + c->sector_size - buf_len,
 						  buf_len);				
 			if (err)
@@ -527,7 +721,7 @@ static int jffs2_scan_eraseblock (struct jffs2_sb_info *c, struct jffs2_eraseblo
 				}
 				if (buf_len < sumlen) {
 					/* Need to read more so that the entire summary node is present */
-					err = jffs2_fill_scan_buf(c, sumptr, 
+					err = jffs2_fill_scan_buf(c, slot, sumptr, 
 								  jeb->offset + c->sector_size - sumlen,
 								  sumlen - buf_len);				
 					if (err) {
@@ -562,7 +756,7 @@ static int jffs2_scan_eraseblock (struct jffs2_sb_info *c, struct jffs2_eraseblo
 		buf_len = c->sector_size;
 	} else {
 		buf_len = EMPTY_SCAN_SIZE(c->sector_size);
-		err = jffs2_fill_scan_buf(c, buf, buf_ofs, buf_len);
+		err = jffs2_fill_scan_buf(c, slot, buf, buf_ofs, buf_len);
 		if (err)
 			return err;
 	}
@@ -653,7 +847,7 @@ static int jffs2_scan_eraseblock (struct jffs2_sb_info *c, struct jffs2_eraseblo
 			jffs2_dbg(1, "Fewer than %zd bytes (node header) left to end of buf. Reading 0x%x at 0x%08x\n",
 				  sizeof(struct jffs2_unknown_node),
 				  buf_len, ofs);
-			err = jffs2_fill_scan_buf(c, buf, ofs, buf_len);
+			err = jffs2_fill_scan_buf(c, slot, buf, ofs, buf_len);
 			if (err)
 				return err;
 			buf_ofs = ofs;
@@ -714,7 +908,7 @@ static int jffs2_scan_eraseblock (struct jffs2_sb_info *c, struct jffs2_eraseblo
 			scan_end = buf_len;
 			jffs2_dbg(1, "Reading another 0x%x at 0x%08x\n",
 				  buf_len, ofs);
-			err = jffs2_fill_scan_buf(c, buf, ofs, buf_len);
+			err = jffs2_fill_scan_buf(c, slot, buf, ofs, buf_len);
 			if (err)
 				return err;
 			buf_ofs = ofs;
@@ -803,7 +997,7 @@ static int jffs2_scan_eraseblock (struct jffs2_sb_info *c, struct jffs2_eraseblo
 				jffs2_dbg(1, "Fewer than %zd bytes (inode node) left to end of buf. Reading 0x%x at 0x%08x\n",
 					  sizeof(struct jffs2_raw_inode),
 					  buf_len, ofs);
-				err = jffs2_fill_scan_buf(c, buf, ofs, buf_len);
+				err = jffs2_fill_scan_buf(c, slot, buf, ofs, buf_len);
 				if (err)
 					return err;
 				buf_ofs = ofs;
@@ -820,7 +1014,7 @@ static int jffs2_scan_eraseblock (struct jffs2_sb_info *c, struct jffs2_eraseblo
 				jffs2_dbg(1, "Fewer than %d bytes (dirent node) left to end of buf. Reading 0x%x at 0x%08x\n",
 					  je32_to_cpu(node->totlen), buf_len,
 					  ofs);
-				err = jffs2_fill_scan_buf(c, buf, ofs, buf_len);
+				err = jffs2_fill_scan_buf(c, slot, buf, ofs, buf_len);
 				if (err)
 					return err;
 				buf_ofs = ofs;
@@ -838,7 +1032,7 @@ static int jffs2_scan_eraseblock (struct jffs2_sb_info *c, struct jffs2_eraseblo
 				jffs2_dbg(1, "Fewer than %d bytes (xattr node) left to end of buf. Reading 0x%x at 0x%08x\n",
 					  je32_to_cpu(node->totlen), buf_len,
 					  ofs);
-				err = jffs2_fill_scan_buf(c, buf, ofs, buf_len);
+				err = jffs2_fill_scan_buf(c, slot, buf, ofs, buf_len);
 				if (err)
 					return err;
 				buf_ofs = ofs;
@@ -855,7 +1049,7 @@ static int jffs2_scan_eraseblock (struct jffs2_sb_info *c, struct jffs2_eraseblo
 				jffs2_dbg(1, "Fewer than %d bytes (xref node) left to end of buf. Reading 0x%x at 0x%08x\n",
 					  je32_to_cpu(node->totlen), buf_len,
 					  ofs);
-				err = jffs2_fill_scan_buf(c, buf, ofs, buf_len);
+				err = jffs2_fill_scan_buf(c, slot, buf, ofs, buf_len);
 				if (err)
 					return err;
 				buf_ofs = ofs;
@@ -966,6 +966,7 @@ struct nfs_server *nfs_alloc_server(void)
 	INIT_LIST_HEAD(&server->ss_copies);
 
 	atomic_set(&server->active, 0);
+	spin_lock_init(&server->ra_lock);
 
 	server->io_stats = nfs_alloc_iostats();
 	if (!server->io_stats) {
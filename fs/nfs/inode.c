@@ -1043,6 +1043,11 @@ struct nfs_open_context *alloc_nfs_open_context(struct dentry *dentry,
 	ctx->lock_context.open_context = ctx;
 	INIT_LIST_HEAD(&ctx->list);
 	ctx->mdsthreshold = NULL;
+	spin_lock_init(&ctx->ra_lock);
+	ctx->ra_pages = 0;
+	ctx->ra_bw = 0;
+	ctx->ra_bytes = 0;
+	ctx->ra_start = 0;
 	return ctx;
 }
 EXPORT_SYMBOL_GPL(alloc_nfs_open_context);
@@ -17,6 +17,7 @@
 #include <linux/slab.h>
 #include <linux/task_io_accounting_ops.h>
 #include <linux/pagemap.h>
+#include <linux/sizes.h>
 #include <linux/sunrpc/clnt.h>
 #include <linux/nfs_fs.h>
 #include <linux/nfs_page.h>
@@ -31,6 +32,14 @@
 
 #define NFSDBG_FACILITY		NFSDBG_PAGECACHE
 
+/* Bounds of the read-ahead window set by nfs_readahead_tune() */
+#define NFS_RA_MIN_PAGES	VM_READAHEAD_PAGES
+#define NFS_RA_MAX_PAGES	(SZ_16M >> PAGE_SHIFT)
+/* The READ bandwidth is sampled over at least that long */
+#define NFS_RA_PERIOD		(100 * NSEC_PER_MSEC)
+/* A period longer than this had no READ for a while and is dropped */
+#define NFS_RA_PERIOD_IDLE	NSEC_PER_SEC
+
 static const struct nfs_pgio_completion_ops nfs_async_read_completion_ops;
 static const struct nfs_rw_ops nfs_rw_read_ops;
 
@@ -222,6 +231,56 @@ static const struct nfs_pgio_completion_ops nfs_async_read_completion_ops = {
 	.completion = nfs_read_completion,
 };
 
+/*
+ * Scale the read-ahead window of a file to the bandwidth-delay product of its
+ * READs.  It is set to twice the bandwidth the file reached over the last
+ * period times the lowest round trip seen to the server: it doubles as long
+ * as it is what limits the bandwidth, and settles at twice the BDP once the
+ * link is full, so that a high latency link still gets enough READs in
+ * flight.  The lowest round trip leaves out the queueing the READs in flight
+ * add, which would otherwise grow the window with itself.
+ */
+static void nfs_readahead_tune(struct rpc_task *task,
+			       struct nfs_pgio_header *hdr, u32 count)
+{
+	struct nfs_server *server = NFS_SERVER(hdr->inode);
+	struct nfs_open_context *ctx = hdr->args.context;
+	ktime_t now = ktime_get();
+	u64 elapsed, rtt_ns, pages;
+	u32 rtt;
+
+	if (!task->tk_rqstp || !ctx || !count)
+		return;
+	rtt = max_t(u32, ktime_to_us(task->tk_rqstp->rq_rtt), 1);
+
+	spin_lock(&server->ra_lock);
+	if (!server->ra_min_rtt || rtt < server->ra_min_rtt)
+		server->ra_min_rtt = rtt;
+	rtt = server->ra_min_rtt;
+	spin_unlock(&server->ra_lock);
+	rtt_ns = (u64)rtt * NSEC_PER_USEC;
+
+	spin_lock(&ctx->ra_lock);
+	elapsed = ktime_to_ns(ktime_sub(now, ctx->ra_start));
+	if (elapsed > max_t(u64, NFS_RA_PERIOD_IDLE, 4 * rtt_ns)) {
+		ctx->ra_start = now;
+		ctx->ra_bytes = 0;
+		goto out;
+	}
+
+	ctx->ra_bytes += count;
+	if (elapsed < max_t(u64, NFS_RA_PERIOD, 2 * rtt_ns))
+		goto out;
+
+	ctx->ra_bw = div64_u64(ctx->ra_bytes * NSEC_PER_SEC, elapsed);
+	pages = div_u64(2 * ctx->ra_bw * rtt, USEC_PER_SEC) >> PAGE_SHIFT;
+	ctx->ra_pages = clamp_t(u64, pages, NFS_RA_MIN_PAGES, NFS_RA_MAX_PAGES);
+	ctx->ra_start = now;
+	ctx->ra_bytes = 0;
+out:
+	spin_unlock(&ctx->ra_lock);
+}
+
 /*
  * This is the callback from RPC telling us whether a reply was
  * received or some error occurred (timeout or socket shutdown).
@@ -235,6 +294,7 @@ static int nfs_readpage_done(struct rpc_task *task,
 		return status;
 
 	nfs_add_stats(inode, NFSIOS_SERVERREADBYTES, hdr->res.count);
+	nfs_readahead_tune(task, hdr, hdr->res.count);
 	trace_nfs_readpage_done(task, hdr);
 
 	if (task->tk_status == -ESTALE) {
@@ -407,6 +467,7 @@ void nfs_readahead(struct readahead_control *ractl)
 	struct file *file = ractl->file;
 	struct nfs_readdesc desc;
 	struct inode *inode = ractl->mapping->host;
+	unsigned long ra_pages = inode_to_bdi(inode)->ra_pages;
 	struct page *page;
 	int ret;
 
@@ -426,6 +487,11 @@ void nfs_readahead(struct readahead_control *ractl)
 	} else
 		desc.ctx = get_nfs_open_context(nfs_file_open_context(file));
 
+	/* Size the next windows, unless read_ahead_kb disabled read-ahead */
+	if (ractl->ra && ra_pages)
+		ractl->ra->ra_pages = max_t(unsigned long, ra_pages,
+					    READ_ONCE(desc.ctx->ra_pages));
+
 	nfs_pageio_init_read(&desc.pgio, inode, false,
 			     &nfs_async_read_completion_ops);
 
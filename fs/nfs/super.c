@@ -706,6 +706,9 @@ int nfs_show_stats(struct seq_file *m, struct dentry *root)
 	seq_puts(m, "\n\tbytes:\t");
 	for (i = 0; i < __NFSIOS_BYTESMAX; i++)
 		seq_printf(m, "%Lu ", totals.bytes[i]);
+
+	/* lowest READ round trip (us) the read-ahead windows are sized with */
+	seq_printf(m, "\n\treadahead:\t%u", READ_ONCE(nfss->ra_min_rtt));
 #ifdef CONFIG_NFS_FSCACHE
 	if (nfss->options & NFS_OPTION_FSCACHE) {
 		seq_puts(m, "\n\tfsc:\t");
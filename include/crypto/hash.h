@@ -162,6 +162,9 @@ struct shash_desc {
 
 #define HASH_MAX_STATESIZE	512
 
+/* Maximum number of messages crypto_shash_finup_mb() hashes in one call */
+#define HASH_MAX_MB_MSGS	2
+
 #define SHASH_DESC_ON_STACK(shash, ctx)					     \
 	char __##shash##_desc[sizeof(struct shash_desc) + HASH_MAX_DESCSIZE] \
 		__aligned(__alignof__(struct shash_desc));		     \
@@ -174,6 +177,12 @@ struct shash_desc {
  * @final: see struct ahash_alg
  * @finup: see struct ahash_alg
  * @digest: see struct ahash_alg
+ * @finup_mb: Finish the hashing of several messages of the same length,
+ *	      all continuing from the state in the descriptor, and write
+ *	      their message digests.  Implementations that can interleave
+ *	      the messages are faster than one @finup per message.  May
+ *	      return -EOPNOTSUPP to make the caller use @finup instead, e.g.
+ *	      when the SIMD unit can't be used.  Optional.
  * @export: see struct ahash_alg
  * @import: see struct ahash_alg
  * @setkey: see struct ahash_alg
@@ -193,6 +202,8 @@ struct shash_desc {
  * @descsize: Size of the operational state for the message digest. This state
  * 	      size is the memory size that needs to be allocated for
  *	      shash_desc.__ctx
+ * @mb_max_msgs: Maximum number of messages @finup_mb takes, at most
+ *	      HASH_MAX_MB_MSGS.  Set to 1 when there is no @finup_mb.
  * @base: internally used
  */
 struct shash_alg {
@@ -204,6 +215,9 @@ struct shash_alg {
 		     unsigned int len, u8 *out);
 	int (*digest)(struct shash_desc *desc, const u8 *data,
 		      unsigned int len, u8 *out);
+	int (*finup_mb)(struct shash_desc *desc, const u8 * const data[],
+			unsigned int len, u8 * const outs[],
+			unsigned int num_msgs);
 	int (*export)(struct shash_desc *desc, void *out);
 	int (*import)(struct shash_desc *desc, const void *in);
 	int (*setkey)(struct crypto_shash *tfm, const u8 *key,
@@ -212,6 +226,7 @@ struct shash_alg {
 	void (*exit_tfm)(struct crypto_shash *tfm);
 
 	unsigned int descsize;
+	unsigned int mb_max_msgs;
 
 	/* These fields must match hash_alg_common. */
 	unsigned int digestsize
@@ -790,6 +805,18 @@ static inline unsigned int crypto_shash_digestsize(struct crypto_shash *tfm)
 	return crypto_shash_alg(tfm)->digestsize;
 }
 
+/**
+ * crypto_shash_mb_max_msgs() - obtain the number of messages hashed at once
+ * @tfm: cipher handle
+ *
+ * Return: maximum number of messages crypto_shash_finup_mb() hashes in one
+ *	   call of the implementation, 1 when it can't interleave messages
+ */
+static inline unsigned int crypto_shash_mb_max_msgs(struct crypto_shash *tfm)
+{
+	return crypto_shash_alg(tfm)->mb_max_msgs;
+}
+
 static inline unsigned int crypto_shash_statesize(struct crypto_shash *tfm)
 {
 	return crypto_shash_alg(tfm)->statesize;
@@ -998,6 +1025,27 @@ int crypto_shash_final(struct shash_desc *desc, u8 *out);
 int crypto_shash_finup(struct shash_desc *desc, const u8 *data,
 		       unsigned int len, u8 *out);
 
+/**
+ * crypto_shash_finup_mb() - calculate message digests of several buffers
+ * @desc: operational state handle that all the messages continue from
+ * @data: the buffers to hash, one per message
+ * @len: length of each buffer
+ * @outs: output buffers, one per message
+ * @num_msgs: number of messages, at most crypto_shash_mb_max_msgs()
+ *
+ * Compute crypto_shash_finup() of each buffer starting from the state of
+ * @desc, which is left unchanged.  This is typically used to hash the blocks
+ * of a file or device that all start with the same salt, the implementation
+ * interleaving the messages to make better use of the CPU.
+ *
+ * Context: Any context.
+ * Return: 0 if the message digests were created successfully; < 0 if an
+ *	   error occurred
+ */
+int crypto_shash_finup_mb(struct shash_desc *desc, const u8 * const data[],
+			  unsigned int len, u8 * const outs[],
+			  unsigned int num_msgs);
+
 static inline void shash_desc_zero(struct shash_desc *desc)
 {
 	memzero_explicit(desc,
@@ -17,7 +17,19 @@
 #define _ALTERA_MUTEX_H
 
 #include <linux/device.h>
+#include <linux/ktime.h>
 #include <linux/platform_device.h>
+#include <linux/wait.h>
+
+struct altera_mutex_stats {
+	u64			acquired;
+	u64			contended;
+	u64			sleeps;
+	u64			wait_ns;
+	u64			wait_max_ns;
+	u64			hold_ns;
+	u64			hold_max_ns;
+};
 
 struct altera_mutex {
 	struct list_head	list;
@@ -25,6 +37,11 @@ struct altera_mutex {
 	struct mutex		lock;
 	void __iomem		*regs;
 	bool			requested;
+	/* waiters, woken on local unlocks and on the unlock interrupt */
+	wait_queue_head_t	wait;
+	atomic_t		unlocks;
+	ktime_t			locked_at;
+	struct altera_mutex_stats stats;
 };
 
 extern struct altera_mutex *altera_mutex_request(struct device_node *mutex_np);
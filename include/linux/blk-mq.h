@@ -114,6 +114,12 @@ struct request {
 	u64 start_time_ns;
 	/* Time that I/O was submitted to the device. */
 	u64 io_start_time_ns;
+#ifdef CONFIG_BLK_DEBUG_FS_LATENCY
+	/* Time that the request was passed to ->queue_rq(). */
+	u64 dispatch_time_ns;
+	/* Time that the driver reported the request as completed. */
+	u64 complete_time_ns;
+#endif
 
 #ifdef CONFIG_BLK_WBT
 	unsigned short wbt_flags;
@@ -438,6 +444,13 @@ struct blk_mq_hw_ctx {
 	/** @sched_debugfs_dir:	debugfs directory for the scheduler. */
 	struct dentry		*sched_debugfs_dir;
 #endif
+#ifdef CONFIG_BLK_DEBUG_FS_LATENCY
+	/**
+	 * @lat_hist: per-cpu latency histograms of the requests completed
+	 * while QUEUE_FLAG_LAT_HIST is set.
+	 */
+	struct blk_mq_lat_hist __percpu *lat_hist;
+#endif
 
 	/**
 	 * @hctx_list: if this hctx is not in use, this is an entry in
@@ -23,6 +23,7 @@ struct console_font;
 struct module;
 struct tty_struct;
 struct notifier_block;
+struct task_struct;
 
 enum con_scroll {
 	SM_UP,
@@ -153,6 +154,7 @@ struct console {
 	uint	ospeed;
 	u64	seq;
 	unsigned long dropped;
+	struct task_struct *thread;
 	void	*data;
 	struct	 console *next;
 };
@@ -178,6 +180,8 @@ extern struct console *console_drivers;
 extern void console_lock(void);
 extern int console_trylock(void);
 extern void console_unlock(void);
+extern void console_emergency_enter(void);
+extern void console_emergency_exit(void);
 extern void console_conditional_schedule(void);
 extern void console_unblank(void);
 extern void console_flush_on_panic(enum con_flush_mode mode);
@@ -10,6 +10,7 @@
 #define _DMA_HEAPS_H
 
 #include <linux/cdev.h>
+#include <linux/list.h>
 #include <linux/types.h>
 
 struct dma_heap;
@@ -41,6 +42,18 @@ struct dma_heap_export_info {
 	void *priv;
 };
 
+/**
+ * struct dma_heap_pool_buffer - buffer cached by the pool of a heap
+ * @list:	entry in the pool, owned by the pool while the buffer is cached
+ * @len:	size of the buffer, PAGE_ALIGNed
+ *
+ * Embedded in the buffers of the heaps using dma_heap_pool_enable().
+ */
+struct dma_heap_pool_buffer {
+	struct list_head list;
+	size_t len;
+};
+
 /**
  * dma_heap_get_drvdata() - get per-heap driver data
  * @heap: DMA-Heap to retrieve private data for
@@ -65,4 +78,13 @@ const char *dma_heap_get_name(struct dma_heap *heap);
  */
 struct dma_heap *dma_heap_add(const struct dma_heap_export_info *exp_info);
 
+int dma_heap_pool_enable(struct dma_heap *heap, size_t max_bytes,
+			 void (*free)(struct dma_heap *heap,
+				      struct dma_heap_pool_buffer *buffer));
+struct dma_heap_pool_buffer *dma_heap_pool_get(struct dma_heap *heap,
+					       size_t len);
+void dma_heap_pool_put(struct dma_heap *heap,
+		       struct dma_heap_pool_buffer *buffer);
+void dma_heap_pool_drain(struct dma_heap *heap);
+
 #endif /* _DMA_HEAPS_H */
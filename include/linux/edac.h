@@ -527,6 +527,14 @@ struct mem_ctl_info {
 	/* pointer to edac checking routine */
 	void (*edac_check) (struct mem_ctl_info * mci);
 
+	/*
+	 * Optional CE storm handling: ce_storm_mode() masks (storm = true)
+	 * and unmasks the CE interrupt, and ce_storm_check() is called once
+	 * a second to collect the CEs while the interrupt is masked.
+	 */
+	void (*ce_storm_mode)(struct mem_ctl_info *mci, bool storm);
+	void (*ce_storm_check)(struct mem_ctl_info *mci);
+
 	/*
 	 * Remaps memory pages: controller pages to physical pages.
 	 * For most MC's, this will be NULL.
@@ -576,6 +584,14 @@ struct mem_ctl_info {
 	u32 ce_noinfo_count, ue_noinfo_count;
 	u32 ue_mc, ce_mc;
 
+	/* CE storm detection, see edac_mc_ce_storm_work() */
+	struct delayed_work storm_work;
+	atomic_t ce_storm_window;
+	bool ce_storm;
+	unsigned int ce_storm_quiet;
+	unsigned long ce_storm_start, ce_storm_report;
+	u64 ce_storm_count;
+
 	struct completion complete;
 
 	/* Additional top controller level attributes, but specified
@@ -424,6 +424,15 @@ void *stratix10_svc_allocate_memory(struct stratix10_svc_chan *chan,
  */
 void stratix10_svc_free_memory(struct stratix10_svc_chan *chan, void *kaddr);
 
+/**
+ * stratix10_svc_get_memory_size() - get size of the shared memory pool
+ * @chan: service channel assigned to the client
+ *
+ * Return: number of bytes in the memory pool the service layer allocates
+ * client buffers from, as reported by the secure monitor software.
+ */
+size_t stratix10_svc_get_memory_size(struct stratix10_svc_chan *chan);
+
 /**
  * stratix10_svc_send() - send a message to the remote
  * @chan: service channel assigned to the client
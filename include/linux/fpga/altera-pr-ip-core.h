@@ -13,5 +13,7 @@
 #include <linux/io.h>
 
 int alt_pr_register(struct device *dev, void __iomem *reg_base);
+int alt_pr_register_dma(struct device *dev, void __iomem *reg_base,
+			phys_addr_t reg_phys);
 
 #endif /* _ALT_PR_IP_CORE_H */
@@ -12,12 +12,21 @@ struct fpga_bridge;
  * struct fpga_bridge_ops - ops for low level FPGA bridge drivers
  * @enable_show: returns the FPGA bridge's status
  * @enable_set: set an FPGA bridge as enabled or disabled
+ * @enable_start: optional, start enabling or disabling an FPGA bridge
+ *	without waiting for it to complete, so that fpga_bridges_enable() and
+ *	fpga_bridges_disable() can wait for several bridges at once
+ * @enable_poll: required with @enable_start, returns 0 once the request is
+ *	complete, -EBUSY while it is pending or an error code. When @timeout
+ *	is set the request must be abandoned if it is still pending, and
+ *	-ETIMEDOUT returned.
  * @fpga_bridge_remove: set FPGA into a specific state during driver remove
  * @groups: optional attribute groups.
  */
 struct fpga_bridge_ops {
 	int (*enable_show)(struct fpga_bridge *bridge);
 	int (*enable_set)(struct fpga_bridge *bridge, bool enable);
+	int (*enable_start)(struct fpga_bridge *bridge, bool enable);
+	int (*enable_poll)(struct fpga_bridge *bridge, bool timeout);
 	void (*fpga_bridge_remove)(struct fpga_bridge *bridge);
 	const struct attribute_group **groups;
 };
@@ -47,6 +56,8 @@ struct fpga_bridge_info {
  * @br_ops: pointer to struct of FPGA bridge ops
  * @info: fpga image specific information
  * @node: FPGA bridge list node
+ * @latency_ns: time the last enable or disable took
+ * @pending: used by fpga_bridges_enable() and fpga_bridges_disable()
  * @priv: low level driver private date
  */
 struct fpga_bridge {
@@ -56,6 +67,8 @@ struct fpga_bridge {
 	const struct fpga_bridge_ops *br_ops;
 	struct fpga_image_info *info;
 	struct list_head node;
+	u64 latency_ns;
+	bool pending;
 	void *priv;
 };
 
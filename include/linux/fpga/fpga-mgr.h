@@ -10,6 +10,7 @@
 
 #include <linux/mutex.h>
 #include <linux/platform_device.h>
+#include <linux/spinlock.h>
 
 struct fpga_manager;
 struct sg_table;
@@ -196,6 +197,60 @@ struct fpga_manager_ops {
 #define FPGA_MGR_STATUS_IP_PROTOCOL_ERR		BIT(3)
 #define FPGA_MGR_STATUS_FIFO_OVERFLOW_ERR	BIT(4)
 
+/**
+ * enum fpga_mgr_phase - phases of an FPGA image load
+ * @FPGA_MGR_PHASE_PARSE_HEADER: parse_header op
+ * @FPGA_MGR_PHASE_WRITE_INIT: write_init op
+ * @FPGA_MGR_PHASE_WRITE: write or write_sg op
+ * @FPGA_MGR_PHASE_WRITE_COMPLETE: write_complete op
+ * @FPGA_MGR_PHASE_MAX: number of phases
+ */
+enum fpga_mgr_phase {
+	FPGA_MGR_PHASE_PARSE_HEADER,
+	FPGA_MGR_PHASE_WRITE_INIT,
+	FPGA_MGR_PHASE_WRITE,
+	FPGA_MGR_PHASE_WRITE_COMPLETE,
+	FPGA_MGR_PHASE_MAX,
+};
+
+/**
+ * struct fpga_mgr_load_stats - programming statistics
+ * @bytes: bytes passed to each phase
+ * @ns: time spent in each phase
+ * @calls: number of calls of each phase op
+ * @retries: retries reported by the low level driver
+ */
+struct fpga_mgr_load_stats {
+	u64 bytes[FPGA_MGR_PHASE_MAX];
+	u64 ns[FPGA_MGR_PHASE_MAX];
+	u64 calls[FPGA_MGR_PHASE_MAX];
+	u64 retries;
+};
+
+/**
+ * struct fpga_mgr_stats - programming statistics of an fpga manager
+ * @lock: protects the fields below
+ * @loads: number of image loads
+ * @failures: number of image loads that failed
+ * @cur: statistics of the load in progress
+ * @last: statistics of the last finished load
+ * @total: statistics accumulated over all loads
+ * @start_ns: start time of the load in progress
+ * @last_ns: duration of the last load
+ * @last_ret: return value of the last load
+ */
+struct fpga_mgr_stats {
+	spinlock_t lock;
+	u64 loads;
+	u64 failures;
+	struct fpga_mgr_load_stats cur;
+	struct fpga_mgr_load_stats last;
+	struct fpga_mgr_load_stats total;
+	u64 start_ns;
+	u64 last_ns;
+	int last_ret;
+};
+
 /**
  * struct fpga_manager - fpga manager structure
  * @name: name of low level fpga manager
@@ -204,6 +259,7 @@ struct fpga_manager_ops {
  * @state: state of fpga manager
  * @compat_id: FPGA manager id for compatibility check.
  * @mops: pointer to struct of fpga manager ops
+ * @stats: programming statistics
  * @priv: low level driver private date
  */
 struct fpga_manager {
@@ -213,6 +269,7 @@ struct fpga_manager {
 	enum fpga_mgr_states state;
 	struct fpga_compat_id *compat_id;
 	const struct fpga_manager_ops *mops;
+	struct fpga_mgr_stats stats;
 	void *priv;
 #if IS_ENABLED(CONFIG_FPGA_MGR_DEBUG_FS)
 	void *debugfs;
@@ -227,6 +284,16 @@ void fpga_image_info_free(struct fpga_image_info *info);
 
 int fpga_mgr_load(struct fpga_manager *mgr, struct fpga_image_info *info);
 
+struct fpga_mgr_stream;
+
+struct fpga_mgr_stream *fpga_mgr_stream_start(struct fpga_manager *mgr,
+					      struct fpga_image_info *info);
+int fpga_mgr_stream_write(struct fpga_mgr_stream *stream,
+			  const char *buf, size_t count);
+int fpga_mgr_stream_finish(struct fpga_mgr_stream *stream);
+
+void fpga_mgr_stats_add_retries(struct fpga_manager *mgr, unsigned int retries);
+
 int fpga_mgr_lock(struct fpga_manager *mgr);
 void fpga_mgr_unlock(struct fpga_manager *mgr);
 
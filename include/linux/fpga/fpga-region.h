@@ -38,6 +38,12 @@ struct fpga_region_info {
  * @compat_id: FPGA region id for compatibility check.
  * @priv: private data
  * @get_bridges: optional function to get bridges to a list
+ * @image_cache: images read from firmware files, most recently used first
+ * @image_cache_size: max number of images in @image_cache, 0 disables it
+ * @image_cache_id: compat_id the images in @image_cache were cached for
+ * @image_loaded: the region was programmed, or adopted, since boot
+ * @image_size: size of the image in the region, 0 if unknown
+ * @image_crc: crc32 of the image in the region
  */
 struct fpga_region {
 	struct device dev;
@@ -48,16 +54,48 @@ struct fpga_region {
 	struct fpga_compat_id *compat_id;
 	void *priv;
 	int (*get_bridges)(struct fpga_region *region);
+	struct list_head image_cache;
+	unsigned int image_cache_size;
+	struct fpga_compat_id image_cache_id;
+	bool image_loaded;
+	size_t image_size;
+	u32 image_crc;
 };
 
 #define to_fpga_region(d) container_of(d, struct fpga_region, dev)
 
+struct fpga_region_group;
+
+/**
+ * struct fpga_region_group_progress - progress of a group of regions
+ * @total: number of regions in the group
+ * @done: number of regions done, successfully or not
+ * @failed: number of regions that failed
+ * @image_size: size of the image loaded into each region
+ * @bytes: image bytes written so far, summed over all regions
+ */
+struct fpga_region_group_progress {
+	unsigned int total;
+	unsigned int done;
+	unsigned int failed;
+	size_t image_size;
+	u64 bytes;
+};
+
 struct fpga_region *
 fpga_region_class_find(struct device *start, const void *data,
 		       int (*match)(struct device *, const void *));
 
 int fpga_region_program_fpga(struct fpga_region *region);
 
+struct fpga_region_group *
+fpga_region_group_start(struct fpga_region **regions, unsigned int num,
+			const struct fpga_image_info *info);
+void fpga_region_group_progress(struct fpga_region_group *group,
+				struct fpga_region_group_progress *progress);
+int fpga_region_group_wait(struct fpga_region_group *group);
+void fpga_region_group_free(struct fpga_region_group *group);
+
 struct fpga_region *
 fpga_region_register_full(struct device *parent, const struct fpga_region_info *info);
 
@@ -35,6 +35,7 @@
 struct device;
 struct device_node;
 struct gen_pool;
+struct gen_pool_cache;
 
 /**
  * typedef genpool_algo_t: Allocation callback function type definition
@@ -64,6 +65,9 @@ struct gen_pool {
 	void *data;
 
 	const char *name;
+
+	struct gen_pool_cache __percpu *cache;	/* per-CPU free objects */
+	size_t cache_size;		/* size of the cached objects */
 };
 
 /*
@@ -79,6 +83,20 @@ struct gen_pool_chunk {
 	unsigned long bits[];		/* bitmap for allocating memory chunk */
 };
 
+/*
+ *  Allocation statistics of a pool, see gen_pool_get_stats().
+ */
+struct gen_pool_stats {
+	size_t avail;			/* bytes free in the chunk bitmaps */
+	size_t largest_free;		/* largest free contiguous range */
+	size_t cached;			/* bytes held by the per-CPU caches */
+	unsigned long hits;		/* allocations served by a cache */
+	unsigned long misses;		/* cacheable allocations scanning */
+	unsigned long overflows;	/* frees not fitting in a cache */
+	u64 scan_ns;			/* time spent by the missed scans */
+	u64 scan_max_ns;		/* longest of the missed scans */
+};
+
 /*
  *  gen_pool data descriptor for gen_pool_first_fit_align.
  */
@@ -179,6 +197,9 @@ extern size_t gen_pool_size(struct gen_pool *);
 
 extern void gen_pool_set_algo(struct gen_pool *pool, genpool_algo_t algo,
 		void *data);
+extern int gen_pool_enable_cache(struct gen_pool *pool, size_t size);
+extern void gen_pool_get_stats(struct gen_pool *pool,
+		struct gen_pool_stats *stats);
 
 extern unsigned long gen_pool_first_fit(unsigned long *map, unsigned long size,
 		unsigned long start, unsigned int nr, void *data,
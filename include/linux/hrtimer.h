@@ -191,6 +191,9 @@ enum  hrtimer_base_type {
  * @hang_detected:	The last hrtimer interrupt detected a hang
  * @softirq_activated:	displays, if the softirq is raised - update of softirq
  *			related settings is not required then.
+ * @nr_grouped:		Total number of timers expired within their slack,
+ *			ahead of their hard expiry time, by the interrupt of
+ *			another timer
  * @nr_events:		Total number of hrtimer interrupt events
  * @nr_retries:		Total number of hrtimer interrupt retries
  * @nr_hangs:		Total number of hrtimer interrupt hangs
@@ -220,6 +223,7 @@ struct hrtimer_cpu_base {
 					in_hrtirq		: 1,
 					hang_detected		: 1,
 					softirq_activated       : 1;
+	unsigned int			nr_grouped;
 #ifdef CONFIG_HIGH_RES_TIMERS
 	unsigned int			nr_events;
 	unsigned short			nr_retries;
@@ -67,6 +67,10 @@
  *                later.
  * IRQF_NO_DEBUG - Exclude from runnaway detection for IPI and similar handlers,
  *		   depends on IRQF_PERCPU.
+ * IRQF_THREAD_POLL - Keep the line masked and call the thread handler again
+ *                for as long as it returns IRQ_HANDLED, at most poll budget
+ *                times, before unmasking the line. The line must stay
+ *                asserted while the device has work. Depends on IRQF_ONESHOT.
  */
 #define IRQF_SHARED		0x00000080
 #define IRQF_PROBE_SHARED	0x00000100
@@ -82,6 +86,7 @@
 #define IRQF_COND_SUSPEND	0x00040000
 #define IRQF_NO_AUTOEN		0x00080000
 #define IRQF_NO_DEBUG		0x00100000
+#define IRQF_THREAD_POLL	0x00200000
 
 #define IRQF_TIMER		(__IRQF_TIMER | IRQF_NO_SUSPEND | IRQF_NO_THREAD)
 
@@ -114,6 +119,10 @@ typedef irqreturn_t (*irq_handler_t)(int, void *);
  * @thread_flags:	flags related to @thread
  * @thread_mask:	bitmask for keeping track of @thread activity
  * @dir:	pointer to the proc/irq/NN/name entry
+ * @poll_budget:	IRQF_THREAD_POLL handler calls before unmasking the line
+ * @poll_wakeups:	IRQF_THREAD_POLL thread wakeups by the interrupt
+ * @polls:	IRQF_THREAD_POLL handler calls made with the line masked
+ * @poll_exhausted:	number of times @poll_budget was exhausted
  */
 struct irqaction {
 	irq_handler_t		handler;
@@ -129,6 +138,10 @@ struct irqaction {
 	unsigned long		thread_mask;
 	const char		*name;
 	struct proc_dir_entry	*dir;
+	unsigned int		poll_budget;
+	unsigned long		poll_wakeups;
+	unsigned long		polls;
+	unsigned long		poll_exhausted;
 } ____cacheline_internodealigned_in_smp;
 
 extern irqreturn_t no_action(int cpl, void *dev_id);
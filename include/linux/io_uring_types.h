@@ -353,6 +353,8 @@ struct io_ring_ctx {
 
 	struct list_head		defer_list;
 	unsigned			sq_thread_idle;
+	/* SQEs submitted by the SQPOLL thread, under ->uring_lock */
+	unsigned long			sq_submitted;
 	/* protected by ->completion_lock */
 	unsigned			evfd_last_cq_tail;
 };
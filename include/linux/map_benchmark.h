@@ -15,6 +15,17 @@
 #define DMA_MAP_TO_DEVICE       1
 #define DMA_MAP_FROM_DEVICE     2
 
+/* What the "map" and "unmap" latencies measure */
+#define DMA_MAP_MODE_MAP	0	/* dma_map_single / dma_unmap_single */
+#define DMA_MAP_MODE_SYNC	1	/* dma_sync_single_for_device / _cpu */
+#define DMA_MAP_MODE_SG		2	/* dma_map_sg / dma_unmap_sg */
+
+/*
+ * Latency histogram buckets, bucket n counts the latencies below
+ * 2^n * 100ns not counted by a lower one, the last one all the others.
+ */
+#define DMA_MAP_HIST_BUCKETS	16
+
 struct map_benchmark {
 	__u64 avg_map_100ns; /* average map latency in 100ns */
 	__u64 map_stddev; /* standard deviation of map latency */
@@ -27,5 +38,9 @@ struct map_benchmark {
 	__u32 dma_dir; /* DMA data direction */
 	__u32 dma_trans_ns; /* time for DMA transmission in ns */
 	__u32 granule;  /* how many PAGE_SIZE will do map/unmap once a time */
+	__u32 mode; /* DMA_MAP_MODE_* */
+	__u32 sync_len; /* bytes synced in sync mode, 0 for the whole buffer */
+	__u64 map_hist[DMA_MAP_HIST_BUCKETS]; /* map latency histogram */
+	__u64 unmap_hist[DMA_MAP_HIST_BUCKETS]; /* as above */
 };
 #endif /* _KERNEL_DMA_BENCHMARK_H */
@@ -13,6 +13,7 @@
 #include <linux/completion.h>
 #include <linux/list.h>
 #include <linux/mfd/core.h>
+#include <linux/mutex.h>
 #include <linux/regmap.h>
 #include <linux/slab.h>
 
@@ -119,14 +120,32 @@
 #define ALTR_A10SR_WR_KEY_REG         0x1C    /* HPS Warm Reset Key */
 #define ALTR_A10SR_PMBUS_REG          0x1E    /* HPS PM Bus */
 
+/* Read-only status registers, read together by altr_a10sr_status_read() */
+#define ALTR_A10SR_STATUS_REGS        4
+
 /**
  * struct altr_a10sr - Altera Max5 MFD device private data structure
  * @dev:  : this device
  * @regmap: the regmap assigned to the parent device.
+ * @spi: the SPI device of the MAX5
+ * @status_lock: protects the status snapshot
+ * @status_time: jiffies the snapshot was taken at
+ * @status_valid: the snapshot has been taken
+ * @status: snapshot of the status registers
+ * @status_buf: DMA-safe commands and responses of the snapshot transfers
  */
 struct altr_a10sr {
 	struct device *dev;
 	struct regmap *regmap;
+	struct spi_device *spi;
+	struct mutex status_lock;
+	unsigned long status_time;
+	bool status_valid;
+	u8 status[ALTR_A10SR_STATUS_REGS];
+	u8 *status_buf;
 };
 
+int altr_a10sr_status_read(struct altr_a10sr *a10sr, unsigned int reg,
+			   unsigned int *val);
+
 #endif /* __MFD_ALTERA_A10SR_H */
@@ -575,12 +575,18 @@ struct per_cpu_pages {
 	spinlock_t lock;	/* Protects lists field */
 	int count;		/* number of pages in the list */
 	int high;		/* high watermark, emptying needed */
+	int high_min;		/* lowest value high decays to */
+	int high_max;		/* highest value high grows to */
 	int batch;		/* chunk size for buddy add/remove */
 	short free_factor;	/* batch scaling factor during free */
+	short alloc_factor;	/* batch scaling factor during refill */
 #ifdef CONFIG_NUMA
 	short expire;		/* When 0, remote pagesets are drained */
 #endif
 
+	unsigned long refills;	/* lists refilled from the buddy */
+	unsigned long drains;	/* lists drained to the buddy */
+
 	/* Lists of pages, one per migrate type stored on the pcp-lists */
 	struct list_head lists[NR_PCP_LISTS];
 } ____cacheline_aligned_in_smp;
@@ -733,6 +739,7 @@ struct zone {
 	 * faster access
 	 */
 	int pageset_high;
+	int pageset_high_max;
 	int pageset_batch;
 
 #ifndef CONFIG_SPARSEMEM
@@ -1251,6 +1251,7 @@ struct nand_secure_region {
  * @controller: The hardware controller	structure which is shared among multiple
  *              independent devices
  * @ecc: The ECC controller structure
+ * @scrub: Background scrubber state, NULL if not running
  * @priv: Chip private data
  */
 struct nand_chip {
@@ -1304,6 +1305,7 @@ struct nand_chip {
 	/* Externals */
 	struct nand_controller *controller;
 	struct nand_ecc_ctrl ecc;
+	struct nand_scrub *scrub;
 	void *priv;
 };
 
@@ -1603,4 +1605,37 @@ static inline void *nand_get_data_buf(struct nand_chip *chip)
 int rawnand_dt_parse_gpio_cs(struct device *dev, struct gpio_desc ***cs_array,
 			     unsigned int *ncs_array);
 
+struct notifier_block;
+
+/* Events of the background scrubber */
+#define NAND_SCRUB_EV_BITFLIPS		0
+#define NAND_SCRUB_EV_UNCORRECTABLE	1
+
+/**
+ * struct nand_scrub_event - Block found by the background scrubber
+ * @mtd: MTD device of the NAND chip
+ * @ofs: offset of the block in @mtd
+ * @bitflips: maximum number of bitflips seen in a page of the block
+ */
+struct nand_scrub_event {
+	struct mtd_info *mtd;
+	loff_t ofs;
+	unsigned int bitflips;
+};
+
+#if IS_ENABLED(CONFIG_MTD_RAW_NAND_SCRUB)
+int nand_scrub_register_notifier(struct notifier_block *nb);
+int nand_scrub_unregister_notifier(struct notifier_block *nb);
+#else
+static inline int nand_scrub_register_notifier(struct notifier_block *nb)
+{
+	return 0;
+}
+
+static inline int nand_scrub_unregister_notifier(struct notifier_block *nb)
+{
+	return 0;
+}
+#endif
+
 #endif /* __LINUX_MTD_RAWNAND_H */
@@ -338,6 +338,7 @@ enum spi_nor_cmd_ext {
 struct flash_info;
 struct spi_nor_manufacturer;
 struct spi_nor_flash_parameter;
+struct spi_nor_cache;
 
 /**
  * struct spi_nor - Structure for defining the SPI NOR layer
@@ -369,6 +370,7 @@ struct spi_nor_flash_parameter;
  *                      settings that can be overwritten by the spi_nor_fixups
  *                      hooks, or dynamically when parsing the SFDP tables.
  * @dirmap:		pointers to struct spi_mem_dirmap_desc for reads/writes.
+ * @cache:		read-ahead cache, NULL when disabled
  * @priv:		pointer to the private data
  */
 struct spi_nor {
@@ -403,6 +405,8 @@ struct spi_nor {
 		struct spi_mem_dirmap_desc *wdesc;
 	} dirmap;
 
+	struct spi_nor_cache *cache;
+
 	void *priv;
 };
 
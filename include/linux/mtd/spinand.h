@@ -62,6 +62,24 @@
 		   SPI_MEM_OP_NO_DUMMY,					\
 		   SPI_MEM_OP_NO_DATA)
 
+#define SPINAND_PAGE_READ_CACHE_RANDOM_OP(addr)				\
+	SPI_MEM_OP(SPI_MEM_OP_CMD(0x30, 1),				\
+		   SPI_MEM_OP_ADDR(3, addr, 1),				\
+		   SPI_MEM_OP_NO_DUMMY,					\
+		   SPI_MEM_OP_NO_DATA)
+
+#define SPINAND_PAGE_READ_CACHE_SEQ_OP					\
+	SPI_MEM_OP(SPI_MEM_OP_CMD(0x31, 1),				\
+		   SPI_MEM_OP_NO_ADDR,					\
+		   SPI_MEM_OP_NO_DUMMY,					\
+		   SPI_MEM_OP_NO_DATA)
+
+#define SPINAND_PAGE_READ_CACHE_LAST_OP					\
+	SPI_MEM_OP(SPI_MEM_OP_CMD(0x3f, 1),				\
+		   SPI_MEM_OP_NO_ADDR,					\
+		   SPI_MEM_OP_NO_DUMMY,					\
+		   SPI_MEM_OP_NO_DATA)
+
 #define SPINAND_PAGE_READ_FROM_CACHE_OP(fast, addr, ndummy, buf, len)	\
 	SPI_MEM_OP(SPI_MEM_OP_CMD(fast ? 0x0b : 0x03, 1),		\
 		   SPI_MEM_OP_ADDR(2, addr, 1),				\
@@ -309,6 +327,8 @@ struct spinand_ecc_info {
 
 #define SPINAND_HAS_QE_BIT		BIT(0)
 #define SPINAND_HAS_CR_FEAT_BIT		BIT(1)
+#define SPINAND_HAS_READ_CACHE_SEQ	BIT(2)
+#define SPINAND_HAS_READ_CACHE_RANDOM	BIT(3)
 
 /**
  * struct spinand_ondie_ecc_conf - private SPI-NAND on-die ECC engine structure
@@ -333,6 +353,12 @@ struct spinand_ondie_ecc_conf {
  * @op_variants.update_cache: variants of the update-cache operation
  * @select_target: function used to select a target/die. Required only for
  *		   multi-die chips
+ * @cont_read: continuous read mode, in which the data of the pages following
+ *	       the one loaded with PAGE READ is streamed by a single read from
+ *	       cache operation, without their OOB area
+ * @cont_read.set: function entering or leaving the continuous read mode
+ * @cont_read.read_cache: variants of the read-cache operation in continuous
+ *			  read mode, NULL when they aren't different
  *
  * Each SPI NAND manufacturer driver should have a spinand_info table
  * describing all the chips supported by the driver.
@@ -351,6 +377,10 @@ struct spinand_info {
 	} op_variants;
 	int (*select_target)(struct spinand_device *spinand,
 			     unsigned int target);
+	struct {
+		int (*set)(struct spinand_device *spinand, bool enable);
+		const struct spinand_op_variants *read_cache;
+	} cont_read;
 };
 
 #define SPINAND_ID(__method, ...)					\
@@ -376,6 +406,12 @@ struct spinand_info {
 #define SPINAND_SELECT_TARGET(__func)					\
 	.select_target = __func,
 
+#define SPINAND_CONT_READ(__set, __read_cache)				\
+	.cont_read = {							\
+		.set = __set,						\
+		.read_cache = __read_cache,				\
+	}
+
 #define SPINAND_INFO(__model, __id, __memorg, __eccreq, __op_variants,	\
 		     __flags, ...)					\
 	{								\
@@ -393,6 +429,7 @@ struct spinand_dirmap {
 	struct spi_mem_dirmap_desc *rdesc;
 	struct spi_mem_dirmap_desc *wdesc_ecc;
 	struct spi_mem_dirmap_desc *rdesc_ecc;
+	struct spi_mem_dirmap_desc *rdesc_cont;
 };
 
 /**
@@ -406,14 +443,20 @@ struct spinand_dirmap {
  * @op_templates.read_cache: read cache op template
  * @op_templates.write_cache: write cache op template
  * @op_templates.update_cache: update cache op template
+ * @op_templates.cont_read_cache: read cache op template in continuous read
+ *				  mode
  * @select_target: select a specific target/die. Usually called before sending
  *		   a command addressing a page or an eraseblock embedded in
  *		   this die. Only required if your chip exposes several dies
  * @cur_target: currently selected target/die
+ * @set_cont_read: enter or leave the continuous read mode
+ * @cont_read_possible: continuous reads can be used with this controller and
+ *			ECC engine
  * @eccinfo: on-die ECC information
  * @cfg_cache: config register cache. One entry per die
  * @databuf: bounce buffer for data
  * @oobbuf: bounce buffer for OOB data
+ * @contbuf: bounce buffer for the continuous reads, the size of an eraseblock
  * @scratchbuf: buffer used for everything but page accesses. This is needed
  *		because the spi-mem interface explicitly requests that buffers
  *		passed in spi_mem_op be DMA-able, so we can't based the bufs on
@@ -432,6 +475,7 @@ struct spinand_device {
 		const struct spi_mem_op *read_cache;
 		const struct spi_mem_op *write_cache;
 		const struct spi_mem_op *update_cache;
+		const struct spi_mem_op *cont_read_cache;
 	} op_templates;
 
 	struct spinand_dirmap *dirmaps;
@@ -440,11 +484,15 @@ struct spinand_device {
 			     unsigned int target);
 	unsigned int cur_target;
 
+	int (*set_cont_read)(struct spinand_device *spinand, bool enable);
+	bool cont_read_possible;
+
 	struct spinand_ecc_info eccinfo;
 
 	u8 *cfg_cache;
 	u8 *databuf;
 	u8 *oobbuf;
+	u8 *contbuf;
 	u8 *scratchbuf;
 	const struct spinand_manufacturer *manufacturer;
 	void *priv;
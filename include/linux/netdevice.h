@@ -335,9 +335,11 @@ struct gro_list {
 
 /*
  * size of gro hash buckets, must less than bit number of
- * napi_struct::gro_bitmask
+ * napi_struct::gro_bitmask.  GRO_HASH_BUCKETS is the default number used,
+ * net_device::gro_hash_buckets, up to GRO_HASH_BUCKETS_MAX.
  */
 #define GRO_HASH_BUCKETS	8
+#define GRO_HASH_BUCKETS_MAX	32
 
 /*
  * Structure for NAPI scheduling similar to tasklet but with weighting
@@ -360,7 +362,11 @@ struct napi_struct {
 	int			poll_owner;
 #endif
 	struct net_device	*dev;
-	struct gro_list		gro_hash[GRO_HASH_BUCKETS];
+	struct gro_list		gro_hash[GRO_HASH_BUCKETS_MAX];
+	/* GRO outcomes, only updated by the poll of the instance */
+	unsigned long		gro_merged;	/* merged into a held skb */
+	unsigned long		gro_held;	/* held as a new flow */
+	unsigned long		gro_evicted;	/* flushed by a new flow */
 	struct sk_buff		*skb;
 	struct list_head	rx_list; /* Pending GRO_NORMAL skbs */
 	int			rx_count; /* length of rx_list */
@@ -1889,6 +1895,8 @@ enum netdev_ml_priv_type {
  *	@real_num_rx_queues: 	Number of RX queues currently active in device
  *	@xdp_prog:		XDP sockets filter program pointer
  *	@gro_flush_timeout:	timeout for GRO layer in NAPI
+ *	@gro_hash_buckets:	number of GRO flow buckets of the NAPI instances,
+ *				a power of 2 up to GRO_HASH_BUCKETS_MAX
  *	@napi_defer_hard_irqs:	If not zero, provides a counter that would
  *				allow to avoid NIC hard IRQ, on busy queues.
  *
@@ -2195,6 +2203,7 @@ struct net_device {
 
 	struct bpf_prog __rcu	*xdp_prog;
 	unsigned long		gro_flush_timeout;
+	unsigned int		gro_hash_buckets;
 	int			napi_defer_hard_irqs;
 #define GRO_LEGACY_MAX_SIZE	65536u
 /* TCP minimal MSS is 8 (TCP_MIN_GSO_SIZE),
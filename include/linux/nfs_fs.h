@@ -90,6 +90,14 @@ struct nfs_open_context {
 
 	struct list_head list;
 	struct nfs4_threshold	*mdsthreshold;
+
+	/* READ bandwidth estimate used to size the read-ahead window */
+	spinlock_t ra_lock;
+	unsigned int ra_pages;		/* read-ahead window */
+	u64 ra_bw;			/* READ bandwidth (bytes/s) */
+	u64 ra_bytes;			/* bytes read in this period */
+	ktime_t ra_start;		/* start of this period */
+
 	struct rcu_head	rcu_head;
 };
 
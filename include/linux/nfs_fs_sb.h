@@ -187,6 +187,10 @@ struct nfs_server {
 	__u64			maxfilesize;	/* maximum file size */
 	struct timespec64	time_delta;	/* smallest time granularity */
 	unsigned long		mount_time;	/* when this fs was mounted */
+
+	/* READ round trip used to size the read-ahead windows */
+	spinlock_t		ra_lock;
+	u32			ra_min_rtt;	/* lowest READ round trip (us) */
 	struct super_block	*super;		/* VFS super block */
 	dev_t			s_dev;		/* superblock dev numbers */
 	struct nfs_auth_info	auth_info;	/* parsed auth flavors */
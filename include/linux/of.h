@@ -33,6 +33,7 @@ struct property {
 	int	length;
 	void	*value;
 	struct property *next;
+	unsigned int name_hash;	/* of_prop_hash() of name, 0 if not computed */
 #if defined(CONFIG_OF_DYNAMIC) || defined(CONFIG_SPARC)
 	unsigned long _flags;
 #endif
@@ -1572,6 +1573,10 @@ struct of_overlay_notify_data {
 int of_overlay_fdt_apply(const void *overlay_fdt, u32 overlay_fdt_size,
 			 int *ovcs_id);
 int of_overlay_remove(int *ovcs_id);
+int of_overlay_fdt_prepare(const void *overlay_fdt, u32 overlay_fdt_size,
+			   int *ovcs_id);
+int of_overlay_apply_prepared(int ovcs_id);
+int of_overlay_release(int *ovcs_id);
 int of_overlay_remove_all(void);
 
 int of_overlay_notifier_register(struct notifier_block *nb);
@@ -1590,6 +1595,22 @@ static inline int of_overlay_remove(int *ovcs_id)
 	return -ENOTSUPP;
 }
 
+static inline int of_overlay_fdt_prepare(const void *overlay_fdt,
+					 u32 overlay_fdt_size, int *ovcs_id)
+{
+	return -ENOTSUPP;
+}
+
+static inline int of_overlay_apply_prepared(int ovcs_id)
+{
+	return -ENOTSUPP;
+}
+
+static inline int of_overlay_release(int *ovcs_id)
+{
+	return -ENOTSUPP;
+}
+
 static inline int of_overlay_remove_all(void)
 {
 	return -ENOTSUPP;
@@ -312,6 +312,8 @@ struct pmu {
 	atomic_t			exclusive_cnt; /* < 0: cpu; > 0: tsk */
 	int				task_ctx_nr;
 	int				hrtimer_interval_ms;
+	/* pinned groups need CAP_PERFMON, keeping the counters for monitoring */
+	int				pinned_restricted;
 
 	/* number of address filters this PMU can do */
 	unsigned int			nr_addr_filters;
@@ -911,6 +913,10 @@ struct perf_cpu_context {
 	ktime_t				hrtimer_interval;
 	unsigned int			hrtimer_active;
 
+	/* multiplexing rotations done, and the time they took */
+	u64				nr_rotations;
+	u64				rotate_ns;
+
 #ifdef CONFIG_CGROUP_PERF
 	struct perf_cgroup		*cgrp;
 	struct list_head		cgrp_cpuctx_entry;
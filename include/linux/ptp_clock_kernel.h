@@ -390,12 +390,30 @@ int ptp_get_vclocks_index(int pclock_index, int **vclock_index);
  * Returns converted timestamp, or 0 on error.
  */
 ktime_t ptp_convert_timestamp(const ktime_t *hwtstamp, int vclock_index);
+
+/**
+ * ptp_convert_timestamps() - convert timestamps to a ptp vclock time
+ *
+ * @hwtstamps:    timestamps, converted in place
+ * @n:            number of timestamps
+ * @vclock_index: phc index of ptp vclock.
+ *
+ * Cheaper than calling ptp_convert_timestamp() on each timestamp of a
+ * batch, the vclock is looked up once.
+ *
+ * Returns 0 on success, or -ENODEV if there is no such vclock.
+ */
+int ptp_convert_timestamps(ktime_t *hwtstamps, unsigned int n,
+			   int vclock_index);
 #else
 static inline int ptp_get_vclocks_index(int pclock_index, int **vclock_index)
 { return 0; }
 static inline ktime_t ptp_convert_timestamp(const ktime_t *hwtstamp,
 					    int vclock_index)
 { return 0; }
+static inline int ptp_convert_timestamps(ktime_t *hwtstamps, unsigned int n,
+					 int vclock_index)
+{ return -ENODEV; }
 
 #endif
 
@@ -376,6 +376,10 @@ enum rsc_handling_status {
  *			  by external entity
  * @load:		load firmware to memory, where the remote processor
  *			expects to find it
+ * @load_segment:	optional hook copying a segment of the firmware to
+ *			its kernel mapping @va at device address @da, e.g.
+ *			with a DMA engine; rproc_elf_load_segments() falls
+ *			back to the CPU when it returns -EOPNOTSUPP
  * @sanity_check:	sanity check the fw image
  * @get_boot_addr:	get boot address to entry point specified in firmware
  * @panic:	optional callback to react to system panic, core will delay
@@ -399,6 +403,8 @@ struct rproc_ops {
 	struct resource_table *(*get_loaded_rsc_table)(
 				struct rproc *rproc, size_t *size);
 	int (*load)(struct rproc *rproc, const struct firmware *fw);
+	int (*load_segment)(struct rproc *rproc, u64 da, void *va,
+			    const void *src, size_t len);
 	int (*sanity_check)(struct rproc *rproc, const struct firmware *fw);
 	u64 (*get_boot_addr)(struct rproc *rproc, const struct firmware *fw);
 	unsigned long (*panic)(struct rproc *rproc);
@@ -436,6 +442,26 @@ enum rproc_state {
 	RPROC_LAST	= 7,
 };
 
+/**
+ * enum rproc_boot_phase - phases of a remote processor boot
+ * @RPROC_BOOT_FIRMWARE:	getting the firmware image
+ * @RPROC_BOOT_PREPARE:		preparing the device and allocating the
+ *				resources of the firmware
+ * @RPROC_BOOT_LOAD:		loading the firmware segments
+ * @RPROC_BOOT_START:		starting the device and its subdevices
+ * @RPROC_BOOT_PHASES:		just keep this one at the end
+ *
+ * The values are used as indices to rproc->boot_ns and to the phase names
+ * of the "boot_times" debugfs file.
+ */
+enum rproc_boot_phase {
+	RPROC_BOOT_FIRMWARE,
+	RPROC_BOOT_PREPARE,
+	RPROC_BOOT_LOAD,
+	RPROC_BOOT_START,
+	RPROC_BOOT_PHASES,
+};
+
 /**
  * enum rproc_crash_type - remote processor crash types
  * @RPROC_MMUFAULT:	iommu fault
@@ -545,6 +571,10 @@ enum rproc_features {
  * @cdev: character device of the rproc
  * @cdev_put_on_release: flag to indicate if remoteproc should be shutdown on @char_dev release
  * @features: indicate remoteproc features
+ * @cache_fw: flag to keep the firmware image across stops
+ * @cached_fw: firmware image of @firmware kept when @cache_fw is set
+ * @boot_fw_cached: flag telling the last boot used @cached_fw
+ * @boot_ns: time spent in each &enum rproc_boot_phase by the last boot
  */
 struct rproc {
 	struct list_head node;
@@ -586,6 +616,10 @@ struct rproc {
 	struct cdev cdev;
 	bool cdev_put_on_release;
 	DECLARE_BITMAP(features, RPROC_MAX_FEATURES);
+	bool cache_fw;
+	const struct firmware *cached_fw;
+	bool boot_fw_cached;
+	u64 boot_ns[RPROC_BOOT_PHASES];
 };
 
 /**
@@ -619,6 +653,9 @@ struct rproc_subdev {
  * @notifyid: rproc-specific unique vring index
  * @rvdev: remote vdev
  * @vq: the virtqueue of this vring
+ * @kicks: number of times the remote processor was notified
+ * @interrupts: number of notifications from the remote processor
+ * @spurious: number of those notifications with no used buffer
  */
 struct rproc_vring {
 	void *va;
@@ -628,6 +665,9 @@ struct rproc_vring {
 	int notifyid;
 	struct rproc_vdev *rvdev;
 	struct virtqueue *vq;
+	unsigned long kicks;
+	unsigned long interrupts;
+	unsigned long spurious;
 };
 
 /**
@@ -537,6 +537,8 @@ struct sched_statistics {
 	u64				nr_wakeups_affine_attempts;
 	u64				nr_wakeups_passive;
 	u64				nr_wakeups_idle;
+	u64				nr_wakeups_cache_hot;
+	u64				nr_wakeups_llc_remote;
 
 #ifdef CONFIG_SCHED_CORE
 	u64				core_forceidle_sum;
@@ -56,6 +56,9 @@ struct kmem_cache_cpu {
 #ifdef CONFIG_SLUB_STATS
 	unsigned stat[NR_SLUB_STAT_ITEMS];
 #endif
+#ifdef CONFIG_SYSFS
+	int profile_skip;	/* Events left before the next profile sample */
+#endif
 };
 
 #ifdef CONFIG_SLUB_CPU_PARTIAL
@@ -116,6 +119,7 @@ struct kmem_cache {
 	struct list_head list;	/* List of slab caches */
 #ifdef CONFIG_SYSFS
 	struct kobject kobj;	/* For sysfs */
+	struct slub_profile *profile;	/* Sampled call sites, alloc_profile */
 #endif
 #ifdef CONFIG_SLAB_FREELIST_HARDENED
 	unsigned long random;
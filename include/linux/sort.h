@@ -13,4 +13,8 @@ void sort(void *base, size_t num, size_t size,
 	  cmp_func_t cmp_func,
 	  swap_func_t swap_func);
 
+void sort_u64(u64 *base, size_t num);
+u64 sorted_percentile_u64(const u64 *sorted, size_t num,
+			  unsigned int permille);
+
 #endif
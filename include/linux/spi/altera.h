@@ -33,8 +33,13 @@ struct altera_spi {
 	int irq;
 	int len;
 	int count;
+	int tx_count;
 	int bytes_per_word;
 	u32 imr;
+	/* words the core can buffer, 1 when generated without FIFO */
+	unsigned int fifo_depth;
+	/* bus address of the registers, for DMA */
+	phys_addr_t phys_base;
 
 	/* data buffers */
 	const unsigned char *tx;
@@ -47,4 +52,6 @@ struct altera_spi {
 
 extern irqreturn_t altera_spi_irq(int irq, void *dev);
 extern void altera_spi_init_master(struct spi_master *master);
+extern int altera_spi_init_dma(struct spi_master *master);
+extern void altera_spi_release_dma(struct spi_master *master);
 #endif /* __LINUX_SPI_ALTERA_H */
@@ -87,6 +87,7 @@ dma_addr_t swiotlb_map(struct device *dev, phys_addr_t phys,
  * @for_alloc:  %true if the pool is used for memory allocation
  * @nareas:  The area number in the pool.
  * @area_nslabs: The slot number in the area.
+ * @map_failed: The number of mappings that failed for lack of free slots.
  */
 struct io_tlb_mem {
 	phys_addr_t start;
@@ -102,6 +103,7 @@ struct io_tlb_mem {
 	unsigned int area_nslabs;
 	struct io_tlb_area *areas;
 	struct io_tlb_slot *slots;
+	atomic_long_t map_failed;
 };
 extern struct io_tlb_mem io_tlb_default_mem;
 
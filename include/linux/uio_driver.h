@@ -94,6 +94,8 @@ struct uio_device {
  * @open:		open operation for this uio device
  * @release:		release operation for this uio device
  * @irqcontrol:		disable/enable irqs when 0/1 is written to /dev/uioX
+ * @latency_critical:	readers of /dev/uioX wait for the device as for I/O,
+ *			so cpufreq keeps their CPU's frequency up meanwhile
  */
 struct uio_info {
 	struct uio_device	*uio_dev;
@@ -109,6 +111,7 @@ struct uio_info {
 	int (*open)(struct uio_info *info, struct inode *inode);
 	int (*release)(struct uio_info *info, struct inode *inode);
 	int (*irqcontrol)(struct uio_info *info, s32 irq_on);
+	bool latency_critical;
 };
 
 extern int __must_check
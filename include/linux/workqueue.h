@@ -136,6 +136,12 @@ struct workqueue_attrs {
 	 */
 	int nice;
 
+	/**
+	 * @rt_priority: SCHED_FIFO priority of the workers, 0 for SCHED_NORMAL
+	 * at @nice
+	 */
+	int rt_priority;
+
 	/**
 	 * @cpumask: allowed CPUs
 	 */
@@ -149,6 +155,15 @@ struct workqueue_attrs {
 	 * doesn't participate in pool hash calculations or equality comparisons.
 	 */
 	bool no_numa;
+
+	/**
+	 * @isolated: never share the worker pools with other workqueues
+	 *
+	 * Like ``no_numa``, ``isolated`` only modifies how
+	 * :c:func:`apply_workqueue_attrs` selects pools and doesn't participate
+	 * in pool hash calculations or equality comparisons.
+	 */
+	bool isolated;
 };
 
 static inline struct delayed_work *to_delayed_work(struct work_struct *work)
@@ -344,6 +359,15 @@ enum {
 	 */
 	WQ_POWER_EFFICIENT	= 1 << 7,
 
+	/*
+	 * Unbound workqueue with worker pools of its own, never shared with
+	 * the other workqueues, so that its work items don't wait behind
+	 * unrelated ones.  Combined with WQ_SYSFS, the priority (nice or
+	 * rt_priority) and CPU affinity of its workers can be set from
+	 * /sys/devices/virtual/workqueue/.
+	 */
+	WQ_ISOLATED		= 1 << 8,
+
 	__WQ_DRAINING		= 1 << 16, /* internal: workqueue is draining */
 	__WQ_ORDERED		= 1 << 17, /* internal: workqueue is ordered */
 	__WQ_LEGACY		= 1 << 18, /* internal: create*_workqueue() */
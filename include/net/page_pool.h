@@ -71,6 +71,19 @@ struct pp_alloc_cache {
 	struct page *cache[PP_ALLOC_CACHE_SIZE];
 };
 
+/*
+ * Pages recycled outside of the alloc side protection, typically freed on
+ * another CPU than the one running RX-NAPI, are first gathered in a per-CPU
+ * cache and moved PP_REMOTE_BATCH at a time into the ptr_ring.  The ring
+ * producer lock is then taken once per batch instead of once per page.
+ */
+#define PP_REMOTE_BATCH		16
+struct pp_remote_cache {
+	spinlock_t lock;
+	u32 count;
+	struct page *cache[PP_REMOTE_BATCH];
+};
+
 struct page_pool_params {
 	unsigned int	flags;
 	unsigned int	order;
@@ -94,6 +107,9 @@ struct page_pool_alloc_stats {
 		    */
 	u64 refill; /* allocations via successful refill */
 	u64 waive;  /* failed refills due to numa zone mismatch */
+	u64 remote_drain; /* refills from the remote caches, the ptr ring
+			   * being empty
+			   */
 };
 
 struct page_pool_recycle_stats {
@@ -106,6 +122,8 @@ struct page_pool_recycle_stats {
 	u64 released_refcnt; /* page released because of elevated
 			      * refcnt
 			      */
+	u64 remote;	/* recycling placed page in a remote cache */
+	u64 remote_flush; /* remote cache batch moved to the ptr ring */
 };
 
 /* This struct wraps the above stats structs so users of the
@@ -190,9 +208,11 @@ struct page_pool {
 	 * Use ptr_ring, as it separates consumer and producer
 	 * effeciently, it a way that doesn't bounce cache-lines.
 	 *
-	 * TODO: Implement bulk return pages into this structure.
+	 * Pages not recycled in bulk reach it through the per-CPU
+	 * remote caches.
 	 */
 	struct ptr_ring ring;
+	struct pp_remote_cache __percpu *remote;
 
 #ifdef CONFIG_PAGE_POOL_STATS
 	/* recycle stats are per-cpu to avoid locking */
@@ -0,0 +1,119 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM fpga_mgr
+
+#if !defined(_TRACE_FPGA_MGR_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_FPGA_MGR_H
+
+#include <linux/fpga/fpga-mgr.h>
+#include <linux/tracepoint.h>
+
+TRACE_DEFINE_ENUM(FPGA_MGR_PHASE_PARSE_HEADER);
+TRACE_DEFINE_ENUM(FPGA_MGR_PHASE_WRITE_INIT);
+TRACE_DEFINE_ENUM(FPGA_MGR_PHASE_WRITE);
+TRACE_DEFINE_ENUM(FPGA_MGR_PHASE_WRITE_COMPLETE);
+
+#define show_fpga_mgr_phase(phase)					\
+	__print_symbolic(phase,						\
+		{ FPGA_MGR_PHASE_PARSE_HEADER,	"parse_header" },	\
+		{ FPGA_MGR_PHASE_WRITE_INIT,	"write_init" },		\
+		{ FPGA_MGR_PHASE_WRITE,		"write" },		\
+		{ FPGA_MGR_PHASE_WRITE_COMPLETE, "write_complete" })
+
+TRACE_EVENT(fpga_mgr_load_start,
+
+	TP_PROTO(struct fpga_manager *mgr, struct fpga_image_info *info),
+
+	TP_ARGS(mgr, info),
+
+	TP_STRUCT__entry(
+		__string(	dev,		dev_name(&mgr->dev)	)
+		__field(	u32,		flags			)
+		__field(	size_t,		count			)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev, dev_name(&mgr->dev));
+		__entry->flags = info->flags;
+		__entry->count = info->count;
+	),
+
+	TP_printk("%s flags=0x%x count=%zu",
+		  __get_str(dev), __entry->flags, __entry->count)
+);
+
+TRACE_EVENT(fpga_mgr_load_end,
+
+	TP_PROTO(struct fpga_manager *mgr, u64 bytes, u64 ns, int ret),
+
+	TP_ARGS(mgr, bytes, ns, ret),
+
+	TP_STRUCT__entry(
+		__string(	dev,		dev_name(&mgr->dev)	)
+		__field(	u64,		bytes			)
+		__field(	u64,		ns			)
+		__field(	int,		ret			)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev, dev_name(&mgr->dev));
+		__entry->bytes = bytes;
+		__entry->ns = ns;
+		__entry->ret = ret;
+	),
+
+	TP_printk("%s bytes=%llu ns=%llu ret=%d",
+		  __get_str(dev), __entry->bytes, __entry->ns, __entry->ret)
+);
+
+TRACE_EVENT(fpga_mgr_phase,
+
+	TP_PROTO(struct fpga_manager *mgr, enum fpga_mgr_phase phase,
+		 size_t bytes, u64 ns, int ret),
+
+	TP_ARGS(mgr, phase, bytes, ns, ret),
+
+	TP_STRUCT__entry(
+		__string(	dev,		dev_name(&mgr->dev)	)
+		__field(	int,		phase			)
+		__field(	size_t,		bytes			)
+		__field(	u64,		ns			)
+		__field(	int,		ret			)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev, dev_name(&mgr->dev));
+		__entry->phase = phase;
+		__entry->bytes = bytes;
+		__entry->ns = ns;
+		__entry->ret = ret;
+	),
+
+	TP_printk("%s %s bytes=%zu ns=%llu ret=%d",
+		  __get_str(dev), show_fpga_mgr_phase(__entry->phase),
+		  __entry->bytes, __entry->ns, __entry->ret)
+);
+
+TRACE_EVENT(fpga_mgr_retry,
+
+	TP_PROTO(struct fpga_manager *mgr, unsigned int retries),
+
+	TP_ARGS(mgr, retries),
+
+	TP_STRUCT__entry(
+		__string(	dev,		dev_name(&mgr->dev)	)
+		__field(	unsigned int,	retries			)
+	),
+
+	TP_fast_assign(
+		__assign_str(dev, dev_name(&mgr->dev));
+		__entry->retries = retries;
+	),
+
+	TP_printk("%s retries=%u", __get_str(dev), __entry->retries)
+);
+
+#endif /* _TRACE_FPGA_MGR_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
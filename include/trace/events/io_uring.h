@@ -684,6 +684,62 @@ TRACE_EVENT(io_uring_local_work_run,
 	TP_printk("ring %p, count %d, loops %u", __entry->ctx, __entry->count, __entry->loops)
 );
 
+DECLARE_EVENT_CLASS(io_uring_worker,
+
+	TP_PROTO(void *wq, int node, int acct, unsigned int nr_workers),
+
+	TP_ARGS(wq, node, acct, nr_workers),
+
+	TP_STRUCT__entry (
+		__field(void *,		wq		)
+		__field(int,		node		)
+		__field(int,		acct		)
+		__field(unsigned int,	nr_workers	)
+	),
+
+	TP_fast_assign(
+		__entry->wq		= wq;
+		__entry->node		= node;
+		__entry->acct		= acct;
+		__entry->nr_workers	= nr_workers;
+	),
+
+	TP_printk("wq %p, node %d, %s, workers %u", __entry->wq,
+		  __entry->node, __entry->acct ? "unbound" : "bound",
+		  __entry->nr_workers)
+);
+
+/**
+ * io_uring_worker_create - called when an io-wq worker is started
+ *
+ * @wq:		pointer to the io-wq
+ * @node:	NUMA node of the worker pool
+ * @acct:	0 for the bounded pool, 1 for the unbounded one
+ * @nr_workers:	workers of the pool, this one included
+ */
+DEFINE_EVENT(io_uring_worker, io_uring_worker_create,
+
+	TP_PROTO(void *wq, int node, int acct, unsigned int nr_workers),
+
+	TP_ARGS(wq, node, acct, nr_workers)
+);
+
+/**
+ * io_uring_worker_exit - called when an io-wq worker exits
+ *
+ * @wq:		pointer to the io-wq
+ * @node:	NUMA node of the worker pool
+ * @acct:	0 for the bounded pool, 1 for the unbounded one
+ * @nr_workers:	workers left in the pool, or still counted in it when the
+ *		whole io-wq is being torn down
+ */
+DEFINE_EVENT(io_uring_worker, io_uring_worker_exit,
+
+	TP_PROTO(void *wq, int node, int acct, unsigned int nr_workers),
+
+	TP_ARGS(wq, node, acct, nr_workers)
+);
+
 #endif /* _TRACE_IO_URING_H */
 
 /* This part must be outside protection */
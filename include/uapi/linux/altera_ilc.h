@@ -0,0 +1,26 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+/*
+ * Altera Interrupt Latency Counter stream interface
+ *
+ * Reading the character device of an ILC returns its samples as an array of
+ * struct altera_ilc_sample, in the order they were collected.
+ */
+
+#ifndef _UAPI_LINUX_ALTERA_ILC_H
+#define _UAPI_LINUX_ALTERA_ILC_H
+
+#include <linux/types.h>
+
+/**
+ * struct altera_ilc_sample - one latency measurement
+ * @irq:	Linux interrupt number of the port, as named in ilc_data/
+ * @latency:	counter value, in cycles of the ILC clock
+ * @timestamp:	CLOCK_MONOTONIC time the sample was collected at, in ns
+ */
+struct altera_ilc_sample {
+	__u32 irq;
+	__u32 latency;
+	__u64 timestamp;
+};
+
+#endif /* _UAPI_LINUX_ALTERA_ILC_H */
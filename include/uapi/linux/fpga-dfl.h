@@ -210,6 +210,75 @@ struct dfl_fpga_irq_set {
 					     DFL_PORT_BASE + 8,	\
 					     struct dfl_fpga_irq_set)
 
+/**
+ * DFL_FPGA_PORT_DMA_MAP_DMABUF - _IOWR(DFL_FPGA_MAGIC, DFL_PORT_BASE + 9,
+ *					struct dfl_fpga_port_dma_map_dmabuf)
+ *
+ * Map the whole dma-buf given by dmabuf_fd for dma by the AFU. Driver fills
+ * the length and the iova in provided struct dfl_fpga_port_dma_map_dmabuf.
+ * The buffer must be mappable to a continuous range of IO virtual addresses.
+ * It is unmapped with DFL_FPGA_PORT_DMA_UNMAP.
+ * Return: 0 on success, -errno on failure.
+ */
+struct dfl_fpga_port_dma_map_dmabuf {
+	/* Input */
+	__u32 argsz;		/* Structure length */
+	__u32 flags;		/* Zero for now */
+	__s32 dmabuf_fd;	/* dma-buf file descriptor */
+	__u32 pad;		/* Zero */
+	/* Output */
+	__u64 length;		/* Length of mapping (bytes) */
+	__u64 iova;		/* IO virtual address */
+};
+
+#define DFL_FPGA_PORT_DMA_MAP_DMABUF	_IO(DFL_FPGA_MAGIC, DFL_PORT_BASE + 9)
+
+/**
+ * struct dfl_fpga_port_dma_region - one entry of a dma batch.
+ *
+ * @user_addr: Process virtual address, input of DMA_MAP_BATCH.
+ * @length: Length of mapping (bytes), input of DMA_MAP_BATCH.
+ * @iova: IO virtual address, output of DMA_MAP_BATCH, input of
+ *	  DMA_UNMAP_BATCH.
+ */
+struct dfl_fpga_port_dma_region {
+	__u64 user_addr;
+	__u64 length;
+	__u64 iova;
+};
+
+#define DFL_FPGA_DMA_BATCH_MAX	256
+
+/**
+ * DFL_FPGA_PORT_DMA_MAP_BATCH - _IOWR(DFL_FPGA_MAGIC, DFL_PORT_BASE + 10,
+ *					struct dfl_fpga_port_dma_batch)
+ *
+ * Map count dma memory regions as DFL_FPGA_PORT_DMA_MAP would do it, and
+ * fill in their iova. Either all regions are mapped or none.
+ *
+ * DFL_FPGA_PORT_DMA_UNMAP_BATCH - _IOWR(DFL_FPGA_MAGIC, DFL_PORT_BASE + 11,
+ *					struct dfl_fpga_port_dma_batch)
+ *
+ * Unmap count dma memory regions per their iova. All regions are tried, the
+ * first error is returned and done is set to the number of regions unmapped.
+ *
+ * count is at most DFL_FPGA_DMA_BATCH_MAX.
+ * Return: 0 on success, -errno on failure.
+ */
+struct dfl_fpga_port_dma_batch {
+	/* Input */
+	__u32 argsz;		/* Structure length */
+	__u32 flags;		/* Zero for now */
+	__u32 count;		/* Number of regions */
+	/* Output */
+	__u32 done;		/* Number of regions mapped or unmapped */
+	/* Input */
+	__u64 regions;		/* Userspace address of region array */
+};
+
+#define DFL_FPGA_PORT_DMA_MAP_BATCH	_IO(DFL_FPGA_MAGIC, DFL_PORT_BASE + 10)
+#define DFL_FPGA_PORT_DMA_UNMAP_BATCH	_IO(DFL_FPGA_MAGIC, DFL_PORT_BASE + 11)
+
 /* IOCTLs for FME file descriptor */
 
 /**
@@ -427,6 +427,86 @@ struct fcs_sdos_data_ext {
 	uint32_t dst_size;
 };
 
+/**
+ * struct fcs_crypto_batch_op - one operation of a crypto batch
+ * @cmd: INTEL_FCS_DEV_CRYPTO_AES_CRYPT_CMD, INTEL_FCS_DEV_CRYPTO_GET_DIGEST_CMD
+ *	 or INTEL_FCS_DEV_CRYPTO_MAC_VERIFY_CMD
+ * @data: the virtual address of the operation parameters, laid out as for
+ *	  the matching single operation ioctl. Status and output sizes are
+ *	  written back to it.
+ */
+struct fcs_crypto_batch_op {
+	uint32_t cmd;
+	struct intel_fcs_dev_ioctl *data;
+};
+
+/**
+ * struct fcs_crypto_batch - submit several crypto operations at once
+ * @ops: the virtual address of an array of operations
+ * @count: number of entries in @ops
+ * @completed: number of operations processed, returned by the driver
+ *
+ * Each operation must fit a single SDM transaction (INIT + FINALIZE), larger
+ * payloads have to use the single operation ioctls.
+ */
+struct fcs_crypto_batch {
+	struct fcs_crypto_batch_op *ops;
+	uint32_t count;
+	uint32_t completed;
+};
+
+/* max number of buffers registered with INTEL_FCS_DEV_REGISTER_BUFFER */
+#define INTEL_FCS_FIXED_BUF_MAX		16
+
+/**
+ * struct fcs_fixed_buffer - shared memory buffer registered once and reused
+ * @index: buffer index, returned on register and passed on unregister
+ * @size: buffer size in bytes, rounded up to a page, at most 4MB
+ * @offset: mmap() offset of the buffer, returned on register
+ *
+ * The buffer is allocated from the service layer shared memory and stays
+ * allocated until it is unregistered or the file is closed. Data written
+ * through the mapping is seen by the SDM without any copy.
+ */
+struct fcs_fixed_buffer {
+	uint32_t index;
+	uint32_t size;
+	uint64_t offset;
+};
+
+/**
+ * struct fcs_fixed_crypt - crypto operation on registered buffers
+ * @cmd: INTEL_FCS_DEV_CRYPTO_AES_CRYPT_CMD or
+ *	 INTEL_FCS_DEV_CRYPTO_GET_DIGEST_CMD
+ * @sid: session ID
+ * @cid: context ID
+ * @kuid: key UID
+ * @src_index: registered buffer holding the input
+ * @src_size: size of the input
+ * @dst_index: registered buffer receiving the output
+ * @dst_size: size of the output, returned by the driver
+ * @cpara_size: size of @cpara, AES only
+ * @cpara: AES crypto parameter
+ * @sha_op_mode: SHA operating mode, digest only
+ * @sha_digest_sz: SHA digest size, digest only
+ *
+ * @src_index and @dst_index may refer to the same buffer.
+ */
+struct fcs_fixed_crypt {
+	uint32_t cmd;
+	uint32_t sid;
+	uint32_t cid;
+	uint32_t kuid;
+	uint32_t src_index;
+	uint32_t src_size;
+	uint32_t dst_index;
+	uint32_t dst_size;
+	int cpara_size;
+	struct fcs_acs_crypt_parameter cpara;
+	int sha_op_mode;
+	int sha_digest_sz;
+};
+
 /**
  * struct intel_fcs_dev_ioctl: common structure passed to Linux
  *	kernel driver for all commands.
@@ -443,6 +523,7 @@ struct fcs_sdos_data_ext {
  * @d_decryption: AES decryption (SDOS)
  * @rn_gen: random number generator result
  * @sdos_data_ext: SDOS ext data
+ * @batch: batch of crypto operations
  */
 struct intel_fcs_dev_ioctl {
 	/* used for return status code */
@@ -475,6 +556,9 @@ struct intel_fcs_dev_ioctl {
 		struct fcs_ecdsa_sha2_data	ecdsa_sha2_data;
 		struct fcs_random_number_gen_ext	rn_gen_ext;
 		struct fcs_sdos_data_ext	data_sdos_ext;
+		struct fcs_crypto_batch		batch;
+		struct fcs_fixed_buffer		f_buf;
+		struct fcs_fixed_crypt		f_crypt;
 	} com_paras;
 
 	int mbox_status;
@@ -549,6 +633,10 @@ enum intel_fcs_command_code {
 	INTEL_FCS_DEV_CRYPTO_ECDSA_SHA2_DATA_SIGNING_SMMU_CMD,
 	INTEL_FCS_DEV_CRYPTO_ECDSA_SHA2_DATA_VERIFY_SMMU_CMD,
 	INTEL_FCS_DEV_CHECK_SMMU_ENABLED_CMD,
+	INTEL_FCS_DEV_CRYPTO_BATCH_CMD,
+	INTEL_FCS_DEV_REGISTER_BUFFER_CMD,
+	INTEL_FCS_DEV_UNREGISTER_BUFFER_CMD,
+	INTEL_FCS_DEV_CRYPTO_FIXED_CMD,
 };
 
 #define INTEL_FCS_DEV_VERSION_REQUEST \
@@ -707,5 +795,21 @@ enum intel_fcs_command_code {
 	_IOWR(INTEL_FCS_IOCTL, \
 	      INTEL_FCS_DEV_CRYPTO_ECDSA_SHA2_DATA_VERIFY_SMMU_CMD, struct intel_fcs_dev_ioctl)
 
+#define INTEL_FCS_DEV_CRYPTO_BATCH \
+	_IOWR(INTEL_FCS_IOCTL, \
+	      INTEL_FCS_DEV_CRYPTO_BATCH_CMD, struct intel_fcs_dev_ioctl)
+
+#define INTEL_FCS_DEV_REGISTER_BUFFER \
+	_IOWR(INTEL_FCS_IOCTL, \
+	      INTEL_FCS_DEV_REGISTER_BUFFER_CMD, struct intel_fcs_dev_ioctl)
+
+#define INTEL_FCS_DEV_UNREGISTER_BUFFER \
+	_IOWR(INTEL_FCS_IOCTL, \
+	      INTEL_FCS_DEV_UNREGISTER_BUFFER_CMD, struct intel_fcs_dev_ioctl)
+
+#define INTEL_FCS_DEV_CRYPTO_FIXED \
+	_IOWR(INTEL_FCS_IOCTL, \
+	      INTEL_FCS_DEV_CRYPTO_FIXED_CMD, struct intel_fcs_dev_ioctl)
+
 #endif
 
@@ -27,7 +27,26 @@ struct udmabuf_create_list {
 	struct udmabuf_create_item list[];
 };
 
+/*
+ * Sync several byte ranges of a udmabuf in one call, as DMA_BUF_IOCTL_SYNC
+ * does for the whole buffer.  @flags are the DMA_BUF_SYNC_* flags of
+ * struct dma_buf_sync, @ranges points to @count struct udmabuf_sync_range.
+ */
+struct udmabuf_sync_range {
+	__u64 offset;
+	__u64 size;
+};
+
+struct udmabuf_sync_ranges {
+	__u32 fd;
+	__u32 flags;
+	__u32 count;
+	__u32 __pad;
+	__u64 ranges;
+};
+
 #define UDMABUF_CREATE       _IOW('u', 0x42, struct udmabuf_create)
 #define UDMABUF_CREATE_LIST  _IOW('u', 0x43, struct udmabuf_create_list)
+#define UDMABUF_SYNC_RANGES  _IOW('u', 0x44, struct udmabuf_sync_ranges)
 
 #endif /* _UAPI_LINUX_UDMABUF_H */
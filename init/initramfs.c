@@ -15,8 +15,12 @@
 #include <linux/mm.h>
 #include <linux/namei.h>
 #include <linux/init_syscalls.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/sizes.h>
 #include <linux/task_work.h>
 #include <linux/umh.h>
+#include <linux/wait.h>
 
 static __initdata bool csum_present;
 static __initdata u32 io_csum;
@@ -482,6 +486,92 @@ static long __init flush_buffer(void *bufv, unsigned long len)
 	return origLen;
 }
 
+/*
+ * The output of the decompressor is handed over to an unpacker thread, so
+ * that the files of the archive are created on another CPU while the next
+ * chunk is being decompressed.  Only the unpacker runs the cpio state
+ * machine while a decompressor is running.
+ */
+#define UNPACK_QUEUE_MAX	SZ_4M	/* bytes queued to the unpacker */
+
+struct unpack_chunk {
+	struct list_head list;
+	unsigned long len;
+	char data[];
+};
+
+static __initdata struct task_struct *unpack_task;
+static __initdata LIST_HEAD(unpack_queue);
+static __initdata DEFINE_SPINLOCK(unpack_lock);
+static __initdata DECLARE_WAIT_QUEUE_HEAD(unpack_wait);
+static unsigned long unpack_queued __initdata;	/* bytes in unpack_queue */
+static unsigned long unpack_bytes __initdata;	/* bytes of cpio archive */
+
+static int __init unpack_thread(void *unused)
+{
+	struct unpack_chunk *chunk;
+
+	for (;;) {
+		wait_event(unpack_wait, !list_empty(&unpack_queue) ||
+					kthread_should_stop());
+
+		spin_lock(&unpack_lock);
+		chunk = list_first_entry_or_null(&unpack_queue,
+						 struct unpack_chunk, list);
+		if (chunk)
+			list_del(&chunk->list);
+		spin_unlock(&unpack_lock);
+		if (!chunk)
+			break;
+
+		flush_buffer(chunk->data, chunk->len);
+
+		spin_lock(&unpack_lock);
+		unpack_queued -= chunk->len;
+		spin_unlock(&unpack_lock);
+		wake_up_all(&unpack_wait);
+		kfree(chunk);
+	}
+
+	return 0;
+}
+
+/* Wait for the unpacker to be done with everything queued so far. */
+static void __init unpack_drain(void)
+{
+	if (unpack_task)
+		wait_event(unpack_wait, !READ_ONCE(unpack_queued));
+}
+
+static long __init queue_buffer(void *bufv, unsigned long len)
+{
+	struct unpack_chunk *chunk;
+
+	unpack_bytes += len;
+	if (!unpack_task)
+		return flush_buffer(bufv, len);
+	if (READ_ONCE(message))
+		return -1;
+
+	chunk = kmalloc(struct_size(chunk, data, len), GFP_KERNEL);
+	if (!chunk) {
+		unpack_drain();
+		return flush_buffer(bufv, len);
+	}
+	chunk->len = len;
+	memcpy(chunk->data, bufv, len);
+
+	wait_event(unpack_wait, READ_ONCE(unpack_queued) < UNPACK_QUEUE_MAX);
+
+	spin_lock(&unpack_lock);
+	list_add_tail(&chunk->list, &unpack_queue);
+	unpack_queued += len;
+	spin_unlock(&unpack_lock);
+	wake_up_all(&unpack_wait);
+
+	return len;
+}
+
 static unsigned long my_inptr __initdata; /* index of next byte to be processed in inbuf */
 
 #include <linux/decompress/generic.h>
@@ -492,6 +582,8 @@ static char * __init unpack_to_rootfs(char *buf, unsigned long len)
 	decompress_fn decompress;
 	const char *compress_name;
 	static __initdata char msg_buf[64];
+	unsigned long in_len = len;
+	ktime_t start = ktime_get();
 
 	header_buf = kmalloc(110, GFP_KERNEL);
 	symlink_buf = kmalloc(PATH_MAX + N_ALIGN(PATH_MAX) + 1, GFP_KERNEL);
@@ -500,14 +592,22 @@ static char * __init unpack_to_rootfs(char *buf, unsigned long len)
 	if (!header_buf || !symlink_buf || !name_buf)
 		panic_show_mem("can't allocate buffers");
 
+	if (num_online_cpus() > 1) {
+		unpack_task = kthread_run(unpack_thread, NULL, "initramfs");
+		if (IS_ERR(unpack_task))
+			unpack_task = NULL;
+	}
+
 	state = Start;
 	this_header = 0;
 	message = NULL;
+	unpack_bytes = 0;
 	while (!message && len) {
 		loff_t saved_offset = this_header;
 		if (*buf == '0' && !(this_header & 3)) {
 			state = Start;
 			written = write_buffer(buf, len);
+			unpack_bytes += written;
 			buf += written;
 			len -= written;
 			continue;
@@ -522,10 +622,11 @@ static char * __init unpack_to_rootfs(char *buf, unsigned long len)
 		decompress = decompress_method(buf, len, &compress_name);
 		pr_debug("Detected %s compressed data\n", compress_name);
 		if (decompress) {
-			int res = decompress(buf, len, NULL, flush_buffer, NULL,
+			int res = decompress(buf, len, NULL, queue_buffer, NULL,
 				   &my_inptr, error);
 			if (res)
 				error("decompressor failed");
+			unpack_drain();
 		} else if (compress_name) {
 			if (!message) {
 				snprintf(msg_buf, sizeof msg_buf,
@@ -541,7 +642,15 @@ static char * __init unpack_to_rootfs(char *buf, unsigned long len)
 		buf += my_inptr;
 		len -= my_inptr;
 	}
+	if (unpack_task) {
+		kthread_stop(unpack_task);
+		unpack_task = NULL;
+	}
 	dir_utime();
+	if (!message)
+		pr_info("Unpacked %lu KiB of initramfs from %lu KiB in %lld ms\n",
+			unpack_bytes >> 10, in_len >> 10,
+			ktime_ms_delta(ktime_get(), start));
 	kfree(name_buf);
 	kfree(symlink_buf);
 	kfree(header_buf);
@@ -1165,7 +1165,9 @@ struct blacklist_entry {
 
 static __initdata_or_module LIST_HEAD(blacklisted_initcalls);
 
-static int __init initcall_blacklist(char *str)
+static __initdata LIST_HEAD(async_initcalls);
+
+static void __init initcall_list_add(char *str, struct list_head *list)
 {
 	char *str_entry;
 	struct blacklist_entry *entry;
@@ -1174,7 +1176,6 @@ static int __init initcall_blacklist(char *str)
 	do {
 		str_entry = strsep(&str, ",");
 		if (str_entry) {
-			pr_debug("blacklisting initcall %s\n", str_entry);
 			entry = memblock_alloc(sizeof(*entry),
 					       SMP_CACHE_BYTES);
 			if (!entry)
@@ -1186,20 +1187,19 @@ static int __init initcall_blacklist(char *str)
 				panic("%s: Failed to allocate %zu bytes\n",
 				      __func__, strlen(str_entry) + 1);
 			strcpy(entry->buf, str_entry);
-			list_add(&entry->next, &blacklisted_initcalls);
+			list_add(&entry->next, list);
 		}
 	} while (str_entry);
-
-	return 1;
 }
 
-static bool __init_or_module initcall_blacklisted(initcall_t fn)
+static bool __init_or_module initcall_listed(initcall_t fn,
+					     struct list_head *list)
 {
 	struct blacklist_entry *entry;
 	char fn_name[KSYM_SYMBOL_LEN];
 	unsigned long addr;
 
-	if (list_empty(&blacklisted_initcalls))
+	if (list_empty(list))
 		return false;
 
 	addr = (unsigned long) dereference_function_descriptor(fn);
@@ -1211,15 +1211,40 @@ static bool __init_or_module initcall_blacklisted(initcall_t fn)
 	 */
 	strreplace(fn_name, ' ', '\0');
 
-	list_for_each_entry(entry, &blacklisted_initcalls, next) {
-		if (!strcmp(fn_name, entry->buf)) {
-			pr_debug("initcall %s blacklisted\n", fn_name);
+	list_for_each_entry(entry, list, next) {
+		if (!strcmp(fn_name, entry->buf))
 			return true;
-		}
 	}
 
 	return false;
 }
+
+static int __init initcall_blacklist(char *str)
+{
+	pr_debug("blacklisting initcalls %s\n", str);
+	initcall_list_add(str, &blacklisted_initcalls);
+	return 1;
+}
+
+static bool __init_or_module initcall_blacklisted(initcall_t fn)
+{
+	if (!initcall_listed(fn, &blacklisted_initcalls))
+		return false;
+
+	pr_debug("initcall %ps blacklisted\n", fn);
+	return true;
+}
+
+static int __init initcall_async(char *str)
+{
+	initcall_list_add(str, &async_initcalls);
+	return 1;
+}
+
+static bool __init initcall_is_async(initcall_t fn)
+{
+	return initcall_listed(fn, &async_initcalls);
+}
 #else
 static int __init initcall_blacklist(char *str)
 {
@@ -1231,14 +1256,30 @@ static bool __init_or_module initcall_blacklisted(initcall_t fn)
 {
 	return false;
 }
+
+static int __init initcall_async(char *str)
+{
+	pr_warn("initcall_async requires CONFIG_KALLSYMS\n");
+	return 0;
+}
+
+static bool __init initcall_is_async(initcall_t fn)
+{
+	return false;
+}
 #endif
 __setup("initcall_blacklist=", initcall_blacklist);
+__setup("initcall_async=", initcall_async);
 
 static __init_or_module void
 trace_initcall_start_cb(void *data, initcall_t fn)
 {
 	ktime_t *calltime = data;
 
+	/* do_async_initcall() times the initcalls it runs itself */
+	if (current_is_async())
+		return;
+
 	printk(KERN_DEBUG "calling  %pS @ %i\n", fn, task_pid_nr(current));
 	*calltime = ktime_get();
 }
@@ -1248,6 +1289,9 @@ trace_initcall_finish_cb(void *data, initcall_t fn, int ret)
 {
 	ktime_t rettime, *calltime = data;
 
+	if (current_is_async())
+		return;
+
 	rettime = ktime_get();
 	printk(KERN_DEBUG "initcall %pS returned %d after %lld usecs\n",
 		 fn, ret, (unsigned long long)ktime_us_delta(rettime, *calltime));
@@ -1354,9 +1398,36 @@ static int __init ignore_unknown_bootoption(char *param, char *val,
 	return 0;
 }
 
+static ASYNC_DOMAIN_EXCLUSIVE(initcall_domain);
+
+/*
+ * The initcalls listed in initcall_async= run concurrently with the other
+ * initcalls of their level, which waits for them before completing.  Their
+ * calling and returned lines carry the PID of the async worker running
+ * them, which is what a boot chart needs to draw them apart.
+ */
+static void __init do_async_initcall(void *data, async_cookie_t cookie)
+{
+	initcall_t fn = (initcall_t)data;
+	ktime_t calltime;
+	int ret;
+
+	if (initcall_debug)
+		printk(KERN_DEBUG "calling  %pS @ %i\n", fn,
+		       task_pid_nr(current));
+	calltime = ktime_get();
+
+	ret = do_one_initcall(fn);
+
+	if (initcall_debug)
+		printk(KERN_DEBUG "initcall %pS returned %d after %lld usecs\n",
+		       fn, ret, ktime_us_delta(ktime_get(), calltime));
+}
+
 static void __init do_initcall_level(int level, char *command_line)
 {
 	initcall_entry_t *fn;
+	initcall_t call;
 
 	parse_args(initcall_level_names[level],
 		   command_line, __start___param,
@@ -1365,8 +1436,15 @@ static void __init do_initcall_level(int level, char *command_line)
 		   NULL, ignore_unknown_bootoption);
 
 	trace_initcall_level(initcall_level_names[level]);
-	for (fn = initcall_levels[level]; fn < initcall_levels[level+1]; fn++)
-		do_one_initcall(initcall_from_entry(fn));
+	for (fn = initcall_levels[level]; fn < initcall_levels[level+1]; fn++) {
+		call = initcall_from_entry(fn);
+		if (initcall_is_async(call))
+			async_schedule_domain(do_async_initcall, (void *)call,
+					      &initcall_domain);
+		else
+			do_one_initcall(call);
+	}
+	async_synchronize_full_domain(&initcall_domain);
 }
 
 static void __init do_initcalls(void)
@@ -14,6 +14,7 @@
 #include "fdinfo.h"
 #include "cancel.h"
 #include "rsrc.h"
+#include "kbuf.h"
 
 #ifdef CONFIG_PROC_FS
 static __cold int io_uring_show_cred(struct seq_file *m, unsigned int id,
@@ -152,6 +153,16 @@ static __cold void __io_uring_show_fdinfo(struct io_ring_ctx *ctx,
 
 	seq_printf(m, "SqThread:\t%d\n", sq_pid);
 	seq_printf(m, "SqThreadCpu:\t%d\n", sq_cpu);
+	if (has_lock && (ctx->flags & IORING_SETUP_SQPOLL)) {
+		struct io_sq_data *sq = ctx->sq_data;
+
+		seq_printf(m, "SqSubmitted:\t%lu\n", ctx->sq_submitted);
+		seq_printf(m, "SqSleeps:\t%lu\n", READ_ONCE(sq->sleeps));
+		seq_printf(m, "SqAvgGapUs:\t%llu\n",
+			   div_u64(READ_ONCE(sq->avg_gap_ns), NSEC_PER_USEC));
+		seq_printf(m, "SqIdleUs:\t%llu\n",
+			   div_u64(io_sqd_idle_ns(sq), NSEC_PER_USEC));
+	}
 	seq_printf(m, "UserFiles:\t%u\n", ctx->nr_user_files);
 	for (i = 0; has_lock && i < ctx->nr_user_files; i++) {
 		struct file *f = io_file_from_index(&ctx->file_table, i);
@@ -176,6 +187,8 @@ static __cold void __io_uring_show_fdinfo(struct io_ring_ctx *ctx,
 		xa_for_each(&ctx->personalities, index, cred)
 			io_uring_show_cred(m, index, cred);
 	}
+	if (has_lock)
+		io_kbuf_show_fdinfo(m, ctx);
 
 	seq_puts(m, "PollList:\n");
 	for (i = 0; i < (1U << ctx->cancel_table.hash_bits); i++) {
@@ -13,15 +13,20 @@
 #include <linux/slab.h>
 #include <linux/rculist_nulls.h>
 #include <linux/cpu.h>
+#include <linux/cpuset.h>
 #include <linux/task_work.h>
 #include <linux/audit.h>
 #include <uapi/linux/io_uring.h>
 
+#include <trace/events/io_uring.h>
+
 #include "io-wq.h"
 #include "slist.h"
 #include "io_uring.h"
 
 #define WORKER_IDLE_TIMEOUT	(5 * HZ)
+/* idle timeout of the workers beyond the recent demand, see io_wqe_worker() */
+#define WORKER_EXCESS_TIMEOUT	(HZ / 2)
 
 enum {
 	IO_WORKER_F_UP		= 1,	/* up and active */
@@ -76,6 +81,8 @@ struct io_worker {
 struct io_wqe_acct {
 	unsigned nr_workers;
 	unsigned max_workers;
+	/* most workers running at once lately, decays as workers time out */
+	unsigned busy_peak;
 	int index;
 	atomic_t nr_running;
 	raw_spinlock_t lock;
@@ -220,6 +227,10 @@ static void io_worker_exit(struct io_worker *worker)
 {
 	struct io_wqe *wqe = worker->wqe;
 	struct io_wq *wq = wqe->wq;
+	struct io_wqe_acct *acct = io_wqe_get_acct(worker);
+
+	trace_io_uring_worker_exit(wq, wqe->node, acct->index,
+				   READ_ONCE(acct->nr_workers));
 
 	while (1) {
 		struct callback_head *cb = task_work_cancel_match(wq->task,
@@ -295,6 +306,15 @@ static bool io_wqe_activate_free_worker(struct io_wqe *wqe,
 	return false;
 }
 
+static void io_wqe_acct_inc_running(struct io_wqe_acct *acct)
+{
+	unsigned int running = atomic_inc_return(&acct->nr_running);
+
+	/* racy, but it's a heuristic */
+	if (running > READ_ONCE(acct->busy_peak))
+		WRITE_ONCE(acct->busy_peak, running);
+}
+
 /*
  * We need a worker. If we find a free one, we're good. If not, and we're
  * below the max number of workers, create one.
@@ -315,16 +335,14 @@ static bool io_wqe_create_worker(struct io_wqe *wqe, struct io_wqe_acct *acct)
 	}
 	acct->nr_workers++;
 	raw_spin_unlock(&wqe->lock);
-	atomic_inc(&acct->nr_running);
+	io_wqe_acct_inc_running(acct);
 	atomic_inc(&wqe->wq->worker_refs);
 	return create_io_worker(wqe->wq, wqe, acct->index);
 }
 
 static void io_wqe_inc_running(struct io_worker *worker)
 {
-	struct io_wqe_acct *acct = io_wqe_get_acct(worker);
-
-	atomic_inc(&acct->nr_running);
+	io_wqe_acct_inc_running(io_wqe_get_acct(worker));
 }
 
 static void create_worker_cb(struct callback_head *cb)
@@ -628,6 +646,7 @@ static int io_wqe_worker(void *data)
 	struct io_wq *wq = wqe->wq;
 	bool last_timeout = false;
 	char buf[TASK_COMM_LEN];
+	long timeout;
 
 	worker->flags |= (IO_WORKER_F_UP | IO_WORKER_F_RUNNING);
 
@@ -645,16 +664,26 @@ static int io_wqe_worker(void *data)
 		/* timed out, exit unless we're the last worker */
 		if (last_timeout && acct->nr_workers > 1) {
 			acct->nr_workers--;
+			/* the demand dropped, let the pool follow */
+			acct->busy_peak -= acct->busy_peak / 4;
 			raw_spin_unlock(&wqe->lock);
 			__set_current_state(TASK_RUNNING);
 			break;
 		}
 		last_timeout = false;
+		/*
+		 * The workers beyond the peak of recent demand, left over from
+		 * a burst of blocking work, go away quickly.  The others stay
+		 * for WORKER_IDLE_TIMEOUT, as the peak shrinks with each exit,
+		 * so the pool doesn't oscillate with a bursty load.
+		 */
+		timeout = acct->nr_workers > acct->busy_peak + 1 ?
+			  WORKER_EXCESS_TIMEOUT : WORKER_IDLE_TIMEOUT;
 		__io_worker_idle(wqe, worker);
 		raw_spin_unlock(&wqe->lock);
 		if (io_run_task_work())
 			continue;
-		ret = schedule_timeout(WORKER_IDLE_TIMEOUT);
+		ret = schedule_timeout(timeout);
 		if (signal_pending(current)) {
 			struct ksignal ksig;
 
@@ -711,11 +740,16 @@ void io_wq_worker_sleeping(struct task_struct *tsk)
 static void io_init_new_worker(struct io_wqe *wqe, struct io_worker *worker,
 			       struct task_struct *tsk)
 {
+	struct io_wqe_acct *acct = io_wqe_get_acct(worker);
+
 	tsk->worker_private = worker;
 	worker->task = tsk;
 	set_cpus_allowed_ptr(tsk, wqe->cpu_mask);
 	tsk->flags |= PF_NO_SETAFFINITY;
 
+	trace_io_uring_worker_create(wqe->wq, wqe->node, acct->index,
+				     READ_ONCE(acct->nr_workers));
+
 	raw_spin_lock(&wqe->lock);
 	hlist_nulls_add_head_rcu(&worker->nulls_node, &wqe->free_list);
 	list_add_tail_rcu(&worker->all_list, &wqe->all_list);
@@ -1145,6 +1179,8 @@ static int io_wqe_hash_wake(struct wait_queue_entry *wait, unsigned mode,
 struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 {
 	int ret, node, i;
+	cpumask_var_t allowed;
+	unsigned int nr_cpus;
 	struct io_wq *wq;
 
 	if (WARN_ON_ONCE(!data->free_work || !data->do_work))
@@ -1152,9 +1188,14 @@ struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 	if (WARN_ON_ONCE(!bounded))
 		return ERR_PTR(-EINVAL);
 
+	if (!alloc_cpumask_var(&allowed, GFP_KERNEL))
+		return ERR_PTR(-ENOMEM);
+	cpuset_cpus_allowed(data->task, allowed);
+
+	ret = -ENOMEM;
 	wq = kzalloc(struct_size(wq, wqes, nr_node_ids), GFP_KERNEL);
 	if (!wq)
-		return ERR_PTR(-ENOMEM);
+		goto err_mask;
 	ret = cpuhp_state_add_instance_nocalls(io_wq_online, &wq->cpuhp_node);
 	if (ret)
 		goto err_wq;
@@ -1177,9 +1218,16 @@ struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 		wq->wqes[node] = wqe;
 		if (!alloc_cpumask_var(&wqe->cpu_mask, GFP_KERNEL))
 			goto err;
-		cpumask_copy(wqe->cpu_mask, cpumask_of_node(node));
+		/*
+		 * Keep the workers within the cpuset of the task, and size
+		 * the bounded pool of a node to the CPUs it may use there.
+		 */
+		if (!cpumask_and(wqe->cpu_mask, cpumask_of_node(node), allowed))
+			cpumask_copy(wqe->cpu_mask, allowed);
+		nr_cpus = max(cpumask_weight(wqe->cpu_mask), 1U);
 		wqe->node = alloc_node;
-		wqe->acct[IO_WQ_ACCT_BOUND].max_workers = bounded;
+		wqe->acct[IO_WQ_ACCT_BOUND].max_workers =
+					min(bounded, 4 * nr_cpus);
 		wqe->acct[IO_WQ_ACCT_UNBOUND].max_workers =
 					task_rlimit(current, RLIMIT_NPROC);
 		INIT_LIST_HEAD(&wqe->wait.entry);
@@ -1201,6 +1249,7 @@ struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 	wq->task = get_task_struct(data->task);
 	atomic_set(&wq->worker_refs, 1);
 	init_completion(&wq->worker_done);
+	free_cpumask_var(allowed);
 	return wq;
 err:
 	io_wq_put_hash(data->hash);
@@ -1213,6 +1262,8 @@ struct io_wq *io_wq_create(unsigned bounded, struct io_wq_data *data)
 	}
 err_wq:
 	kfree(wq);
+err_mask:
+	free_cpumask_var(allowed);
 	return ERR_PTR(ret);
 }
 
@@ -24,6 +24,13 @@ enum {
 	 * removed and the result is set on req->cqe.res.
 	 */
 	IOU_STOP_MULTISHOT	= -ECANCELED,
+
+	/*
+	 * Also only with IO_URING_F_MULTISHOT: the multishot request has
+	 * more to do, but yields to the other task_work. The poll runner
+	 * requeues it, still owning the request. Not a valid error code.
+	 */
+	IOU_REQUEUE		= -3072,
 };
 
 struct io_uring_cqe *__io_get_cqe(struct io_ring_ctx *ctx, bool overflow);
@@ -7,6 +7,7 @@
 #include <linux/slab.h>
 #include <linux/namei.h>
 #include <linux/poll.h>
+#include <linux/seq_file.h>
 #include <linux/io_uring.h>
 
 #include <uapi/linux/io_uring.h>
@@ -77,7 +78,46 @@ void io_kbuf_recycle_legacy(struct io_kiocb *req, unsigned issue_flags)
 	return;
 }
 
-unsigned int __io_put_kbuf(struct io_kiocb *req, unsigned issue_flags)
+static struct io_uring_buf *io_ring_head_to_buf(struct io_buffer_list *bl,
+						__u16 head)
+{
+	struct io_uring_buf *buf;
+
+	head &= bl->mask;
+	if (head < IO_BUFFER_LIST_BUF_PER_PAGE)
+		return &bl->buf_ring->bufs[head];
+
+	buf = page_address(bl->buf_pages[head / IO_BUFFER_LIST_BUF_PER_PAGE]);
+	return buf + (head & (IO_BUFFER_LIST_BUF_PER_PAGE - 1));
+}
+
+/*
+ * Consume @len bytes of the buffer at the head of an IOBL_INC ring, which
+ * moves on to the next one only once exhausted.  A failed or empty transfer
+ * leaves it as it was.  Returns true if the buffer was fully consumed.
+ */
+bool io_kbuf_inc_commit(struct io_buffer_list *bl, int len)
+{
+	struct io_uring_buf *buf;
+	u32 buf_len;
+
+	if (len <= 0)
+		return false;
+
+	buf = io_ring_head_to_buf(bl, bl->head);
+	buf_len = READ_ONCE(buf->len);
+	if (len < buf_len) {
+		WRITE_ONCE(buf->addr, READ_ONCE(buf->addr) + len);
+		WRITE_ONCE(buf->len, buf_len - len);
+		return false;
+	}
+
+	bl->head++;
+	return true;
+}
+
+unsigned int __io_put_kbuf(struct io_kiocb *req, int len,
+			   unsigned issue_flags)
 {
 	unsigned int cflags;
 
@@ -95,17 +135,18 @@ unsigned int __io_put_kbuf(struct io_kiocb *req, unsigned issue_flags)
 	 */
 	if (req->flags & REQ_F_BUFFER_RING) {
 		/* no buffers to recycle for this case */
-		cflags = __io_put_kbuf_list(req, NULL);
+		cflags = __io_put_kbuf_list(req, len, NULL);
 	} else if (issue_flags & IO_URING_F_UNLOCKED) {
 		struct io_ring_ctx *ctx = req->ctx;
 
 		spin_lock(&ctx->completion_lock);
-		cflags = __io_put_kbuf_list(req, &ctx->io_buffers_comp);
+		cflags = __io_put_kbuf_list(req, len, &ctx->io_buffers_comp);
 		spin_unlock(&ctx->completion_lock);
 	} else {
 		lockdep_assert_held(&req->ctx->uring_lock);
 
-		cflags = __io_put_kbuf_list(req, &req->ctx->io_buffers_cache);
+		cflags = __io_put_kbuf_list(req, len,
+					    &req->ctx->io_buffers_cache);
 	}
 	return cflags;
 }
@@ -139,15 +180,7 @@ static void __user *io_ring_buffer_select(struct io_kiocb *req, size_t *len,
 	if (unlikely(smp_load_acquire(&br->tail) == head))
 		return NULL;
 
-	head &= bl->mask;
-	if (head < IO_BUFFER_LIST_BUF_PER_PAGE) {
-		buf = &br->bufs[head];
-	} else {
-		int off = head & (IO_BUFFER_LIST_BUF_PER_PAGE - 1);
-		int index = head / IO_BUFFER_LIST_BUF_PER_PAGE;
-		buf = page_address(bl->buf_pages[index]);
-		buf += off;
-	}
+	buf = io_ring_head_to_buf(bl, head);
 	if (*len == 0 || *len > buf->len)
 		*len = buf->len;
 	req->flags |= REQ_F_BUFFER_RING;
@@ -163,7 +196,7 @@ static void __user *io_ring_buffer_select(struct io_kiocb *req, size_t *len,
 		 * io-wq context and there may be further retries in async hybrid
 		 * mode. For the locked case, the caller must call commit when
 		 * the transfer completes (or if we get -EAGAIN and must poll of
-		 * retry).
+		 * retry). An IOBL_INC buffer is then consumed whole as well.
 		 */
 		req->buf_list = NULL;
 		bl->head++;
@@ -186,11 +219,87 @@ void __user *io_buffer_select(struct io_kiocb *req, size_t *len,
 			ret = io_ring_buffer_select(req, len, bl, issue_flags);
 		else
 			ret = io_provided_buffer_select(req, len, bl);
+		if (!ret)
+			bl->nr_starved++;
 	}
 	io_ring_submit_unlock(req->ctx, issue_flags);
 	return ret;
 }
 
+/*
+ * Map up to @nr_iovs buffers from the head of a ring for a bundle receive.
+ * As for the locked case of io_ring_buffer_select(), nothing is consumed
+ * yet, io_kbuf_commit_bundle() and the buffer put do that once the amount
+ * of data received is known.  Returns the number of buffers mapped, 0 if
+ * the group can't be used for a bundle and a single buffer must be selected
+ * instead.
+ */
+int io_ring_buffers_peek(struct io_kiocb *req, struct iovec *iov, int nr_iovs,
+			 unsigned int issue_flags)
+{
+	struct io_ring_ctx *ctx = req->ctx;
+	struct io_buffer_list *bl;
+	struct io_uring_buf *buf;
+	int i, nr = 0;
+
+	/* io-wq has to consume its buffer upfront, one at a time */
+	if (issue_flags & IO_URING_F_UNLOCKED || !file_can_poll(req->file))
+		return 0;
+
+	io_ring_submit_lock(ctx, issue_flags);
+
+	bl = io_buffer_get_list(ctx, req->buf_index);
+	if (!bl || !bl->buf_nr_pages || bl->flags & IOBL_INC)
+		goto out;
+
+	nr = min_t(__u16, smp_load_acquire(&bl->buf_ring->tail) - bl->head,
+		   nr_iovs);
+	for (i = 0; i < nr; i++) {
+		buf = io_ring_head_to_buf(bl, bl->head + i);
+		iov[i].iov_base = u64_to_user_ptr(READ_ONCE(buf->addr));
+		iov[i].iov_len = READ_ONCE(buf->len);
+		if (!i)
+			req->buf_index = buf->bid;
+	}
+	if (nr) {
+		req->flags |= REQ_F_BUFFER_RING;
+		req->buf_list = bl;
+	}
+out:
+	io_ring_submit_unlock(ctx, issue_flags);
+	return nr;
+}
+
+static void io_kbuf_show_bl(struct seq_file *m, struct io_buffer_list *bl)
+{
+	if (!bl->buf_nr_pages && list_empty(&bl->buf_list) && !bl->nr_starved)
+		return;
+
+	seq_printf(m, "%5u: ", bl->bgid);
+	if (bl->buf_nr_pages)
+		seq_printf(m, "ring entries=%u head=%u tail=%u%s",
+			   bl->nr_entries, bl->head,
+			   smp_load_acquire(&bl->buf_ring->tail),
+			   bl->flags & IOBL_INC ? " inc" : "");
+	else
+		seq_puts(m, "classic");
+	seq_printf(m, " starved=%u\n", bl->nr_starved);
+}
+
+/* Must be called with the ctx->uring_lock held. */
+void io_kbuf_show_fdinfo(struct seq_file *m, struct io_ring_ctx *ctx)
+{
+	struct io_buffer_list *bl;
+	unsigned long index;
+	int i;
+
+	seq_puts(m, "BufGroups:\n");
+	for (i = 0; ctx->io_bl && i < BGID_ARRAY; i++)
+		io_kbuf_show_bl(m, &ctx->io_bl[i]);
+	xa_for_each(&ctx->io_bl_xa, index, bl)
+		io_kbuf_show_bl(m, bl);
+}
+
 static __cold int io_init_bl_list(struct io_ring_ctx *ctx)
 {
 	int i;
@@ -226,6 +335,7 @@ static int __io_remove_buffers(struct io_ring_ctx *ctx,
 		kvfree(bl->buf_pages);
 		bl->buf_pages = NULL;
 		bl->buf_nr_pages = 0;
+		bl->flags = 0;
 		/* make sure it's seen as empty */
 		INIT_LIST_HEAD(&bl->buf_list);
 		return i;
@@ -482,7 +592,9 @@ int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
 	if (copy_from_user(&reg, arg, sizeof(reg)))
 		return -EFAULT;
 
-	if (reg.pad || reg.resv[0] || reg.resv[1] || reg.resv[2])
+	if (reg.resv[0] || reg.resv[1] || reg.resv[2])
+		return -EINVAL;
+	if (reg.flags & ~IOU_PBUF_RING_INC)
 		return -EINVAL;
 	if (!reg.ring_addr)
 		return -EFAULT;
@@ -526,6 +638,8 @@ int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
 	bl->nr_entries = reg.ring_entries;
 	bl->buf_ring = br;
 	bl->mask = reg.ring_entries - 1;
+	if (reg.flags & IOU_PBUF_RING_INC)
+		bl->flags |= IOBL_INC;
 	io_buffer_add_list(ctx, bl, reg.bgid);
 	return 0;
 }
@@ -537,7 +651,7 @@ int io_unregister_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
 
 	if (copy_from_user(&reg, arg, sizeof(reg)))
 		return -EFAULT;
-	if (reg.pad || reg.resv[0] || reg.resv[1] || reg.resv[2])
+	if (reg.flags || reg.resv[0] || reg.resv[1] || reg.resv[2])
 		return -EINVAL;
 
 	bl = io_buffer_get_list(ctx, reg.bgid);
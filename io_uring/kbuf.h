@@ -4,6 +4,9 @@
 
 #include <uapi/linux/io_uring.h>
 
+struct iovec;
+struct seq_file;
+
 struct io_buffer_list {
 	/*
 	 * If ->buf_nr_pages is set, then buf_pages/buf_ring are used. If not,
@@ -23,8 +26,15 @@ struct io_buffer_list {
 	__u16 nr_entries;
 	__u16 head;
 	__u16 mask;
+	__u16 flags;
+
+	/* buffer selections which found the group empty */
+	unsigned int nr_starved;
 };
 
+/* buffers of the ring are consumed incrementally, IOU_PBUF_RING_INC */
+#define IOBL_INC	(1U << 0)
+
 struct io_buffer {
 	struct list_head list;
 	__u64 addr;
@@ -35,6 +45,8 @@ struct io_buffer {
 
 void __user *io_buffer_select(struct io_kiocb *req, size_t *len,
 			      unsigned int issue_flags);
+int io_ring_buffers_peek(struct io_kiocb *req, struct iovec *iov, int nr_iovs,
+			 unsigned int issue_flags);
 void io_destroy_buffers(struct io_ring_ctx *ctx);
 
 int io_remove_buffers_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe);
@@ -46,7 +58,10 @@ int io_provide_buffers(struct io_kiocb *req, unsigned int issue_flags);
 int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg);
 int io_unregister_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg);
 
-unsigned int __io_put_kbuf(struct io_kiocb *req, unsigned issue_flags);
+unsigned int __io_put_kbuf(struct io_kiocb *req, int len,
+			   unsigned issue_flags);
+bool io_kbuf_inc_commit(struct io_buffer_list *bl, int len);
+void io_kbuf_show_fdinfo(struct seq_file *m, struct io_ring_ctx *ctx);
 
 void io_kbuf_recycle_legacy(struct io_kiocb *req, unsigned issue_flags);
 
@@ -77,6 +92,16 @@ static inline void io_kbuf_recycle_ring(struct io_kiocb *req)
 	}
 }
 
+/*
+ * Consume the first @nbufs - 1 buffers of a bundle mapped by
+ * io_ring_buffers_peek(), the put of the request's buffer does the last.
+ */
+static inline void io_kbuf_commit_bundle(struct io_kiocb *req, int nbufs)
+{
+	if ((req->flags & REQ_F_BUFFER_RING) && req->buf_list && nbufs > 1)
+		req->buf_list->head += nbufs - 1;
+}
+
 static inline bool io_do_buffer_select(struct io_kiocb *req)
 {
 	if (!(req->flags & REQ_F_BUFFER_SELECT))
@@ -92,15 +117,20 @@ static inline void io_kbuf_recycle(struct io_kiocb *req, unsigned issue_flags)
 		io_kbuf_recycle_ring(req);
 }
 
-static inline unsigned int __io_put_kbuf_list(struct io_kiocb *req,
+static inline unsigned int __io_put_kbuf_list(struct io_kiocb *req, int len,
 					      struct list_head *list)
 {
 	unsigned int ret = IORING_CQE_F_BUFFER | (req->buf_index << IORING_CQE_BUFFER_SHIFT);
 
 	if (req->flags & REQ_F_BUFFER_RING) {
-		if (req->buf_list) {
-			req->buf_index = req->buf_list->bgid;
-			req->buf_list->head++;
+		struct io_buffer_list *bl = req->buf_list;
+
+		if (bl) {
+			req->buf_index = bl->bgid;
+			if (!(bl->flags & IOBL_INC))
+				bl->head++;
+			else if (!io_kbuf_inc_commit(bl, len))
+				ret |= IORING_CQE_F_BUF_MORE;
 		}
 		req->flags &= ~REQ_F_BUFFER_RING;
 	} else {
@@ -118,15 +148,20 @@ static inline unsigned int io_put_kbuf_comp(struct io_kiocb *req)
 
 	if (!(req->flags & (REQ_F_BUFFER_SELECTED|REQ_F_BUFFER_RING)))
 		return 0;
-	return __io_put_kbuf_list(req, &req->ctx->io_buffers_comp);
+	return __io_put_kbuf_list(req, req->cqe.res,
+				  &req->ctx->io_buffers_comp);
 }
 
-static inline unsigned int io_put_kbuf(struct io_kiocb *req,
+/*
+ * @len is the number of bytes transferred to the buffer, what an
+ * incrementally consumed buffer ring entry gets used up by.
+ */
+static inline unsigned int io_put_kbuf(struct io_kiocb *req, int len,
 				       unsigned issue_flags)
 {
 
 	if (!(req->flags & (REQ_F_BUFFER_SELECTED|REQ_F_BUFFER_RING)))
 		return 0;
-	return __io_put_kbuf(req, issue_flags);
+	return __io_put_kbuf(req, len, issue_flags);
 }
 #endif
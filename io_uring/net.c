@@ -64,6 +64,7 @@ struct io_sr_msg {
 	/* initialised and used only by !msg send variants */
 	u16				addr_len;
 	u16				buf_group;
+	u16				nr_multishot_loops;
 	void __user			*addr;
 	void __user			*msg_control;
 	/* used only for send zerocopy */
@@ -555,7 +556,15 @@ int io_recvmsg_prep_async(struct io_kiocb *req)
 	return ret;
 }
 
-#define RECVMSG_FLAGS (IORING_RECVSEND_POLL_FIRST | IORING_RECV_MULTISHOT)
+#define RECVMSG_FLAGS (IORING_RECVSEND_POLL_FIRST | IORING_RECV_MULTISHOT | \
+		       IORING_RECVSEND_BUNDLE)
+
+/*
+ * Number of CQEs a multishot receive or accept posts in a row before
+ * letting the other task_work run, a busy socket would otherwise keep the
+ * task to itself for as long as data keeps coming.
+ */
+#define MULTISHOT_MAX_RETRY	32
 
 int io_recvmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 {
@@ -592,12 +601,21 @@ int io_recvmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 		 */
 		sr->buf_group = req->buf_index;
 	}
+	if (sr->flags & IORING_RECVSEND_BUNDLE) {
+		if (req->opcode == IORING_OP_RECVMSG)
+			return -EINVAL;
+		if (!(req->flags & REQ_F_BUFFER_SELECT))
+			return -EINVAL;
+		if (sr->msg_flags & MSG_WAITALL)
+			return -EINVAL;
+	}
 
 #ifdef CONFIG_COMPAT
 	if (req->ctx->compat)
 		sr->msg_flags |= MSG_CMSG_COMPAT;
 #endif
 	sr->done_io = 0;
+	sr->nr_multishot_loops = 0;
 	return 0;
 }
 
@@ -620,6 +638,8 @@ static inline bool io_recv_finish(struct io_kiocb *req, int *ret,
 				  unsigned int cflags, bool mshot_finished,
 				  unsigned issue_flags)
 {
+	struct io_sr_msg *sr = io_kiocb_to_cmd(req, struct io_sr_msg);
+
 	if (!(req->flags & REQ_F_APOLL_MULTISHOT)) {
 		io_req_set_res(req, *ret, cflags);
 		*ret = IOU_OK;
@@ -630,7 +650,16 @@ static inline bool io_recv_finish(struct io_kiocb *req, int *ret,
 		if (io_post_aux_cqe(req->ctx, req->cqe.user_data, *ret,
 				    cflags | IORING_CQE_F_MORE, false)) {
 			io_recv_prep_retry(req);
-			return false;
+			/*
+			 * Only the poll-driven issue can be requeued, the
+			 * initial one and io-wq just keep going.
+			 */
+			if (!(issue_flags & IO_URING_F_MULTISHOT) ||
+			    ++sr->nr_multishot_loops < MULTISHOT_MAX_RETRY)
+				return false;
+			sr->nr_multishot_loops = 0;
+			*ret = IOU_REQUEUE;
+			return true;
 		}
 		/*
 		 * Otherwise stop multishot but use the current result.
@@ -828,7 +857,7 @@ int io_recvmsg(struct io_kiocb *req, unsigned int issue_flags)
 	else
 		io_kbuf_recycle(req, issue_flags);
 
-	cflags = io_put_kbuf(req, issue_flags);
+	cflags = io_put_kbuf(req, ret, issue_flags);
 	if (kmsg->msg.msg_inq)
 		cflags |= IORING_CQE_F_SOCK_NONEMPTY;
 
@@ -846,15 +875,26 @@ int io_recvmsg(struct io_kiocb *req, unsigned int issue_flags)
 	return ret;
 }
 
+/* Number of buffers of a bundle holding @ret bytes. */
+static int io_bundle_nbufs(const struct iovec *iov, int nr_iovs, int ret)
+{
+	int nbufs = 0;
+
+	while (ret > 0 && nbufs < nr_iovs)
+		ret -= iov[nbufs++].iov_len;
+
+	return nbufs;
+}
+
 int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 {
 	struct io_sr_msg *sr = io_kiocb_to_cmd(req, struct io_sr_msg);
 	struct msghdr msg;
 	struct socket *sock;
-	struct iovec iov;
+	struct iovec iov, iovs[UIO_FASTIOV];
 	unsigned int cflags;
 	unsigned flags;
-	int ret, min_ret = 0;
+	int ret, min_ret = 0, nr_iovs;
 	bool force_nonblock = issue_flags & IO_URING_F_NONBLOCK;
 	size_t len = sr->len;
 
@@ -867,18 +907,32 @@ int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 		return -ENOTSOCK;
 
 retry_multishot:
+	nr_iovs = 0;
 	if (io_do_buffer_select(req)) {
 		void __user *buf;
 
-		buf = io_buffer_select(req, &len, issue_flags);
-		if (!buf)
-			return -ENOBUFS;
-		sr->buf = buf;
+		if (sr->flags & IORING_RECVSEND_BUNDLE)
+			nr_iovs = io_ring_buffers_peek(req, iovs, UIO_FASTIOV,
+						       issue_flags);
+		if (!nr_iovs) {
+			buf = io_buffer_select(req, &len, issue_flags);
+			if (!buf)
+				return -ENOBUFS;
+			sr->buf = buf;
+		}
 	}
 
-	ret = import_single_range(ITER_DEST, sr->buf, len, &iov, &msg.msg_iter);
-	if (unlikely(ret))
-		goto out_free;
+	if (nr_iovs) {
+		iov_iter_init(&msg.msg_iter, ITER_DEST, iovs, nr_iovs,
+			      iov_length(iovs, nr_iovs));
+		if (sr->len)
+			iov_iter_truncate(&msg.msg_iter, sr->len);
+	} else {
+		ret = import_single_range(ITER_DEST, sr->buf, len, &iov,
+					  &msg.msg_iter);
+		if (unlikely(ret))
+			goto out_free;
+	}
 
 	msg.msg_name = NULL;
 	msg.msg_namelen = 0;
@@ -927,7 +981,9 @@ int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 	else
 		io_kbuf_recycle(req, issue_flags);
 
-	cflags = io_put_kbuf(req, issue_flags);
+	if (nr_iovs && ret > 0)
+		io_kbuf_commit_bundle(req, io_bundle_nbufs(iovs, nr_iovs, ret));
+	cflags = io_put_kbuf(req, ret, issue_flags);
 	if (msg.msg_inq)
 		cflags |= IORING_CQE_F_SOCK_NONEMPTY;
 
@@ -1302,7 +1358,7 @@ int io_accept(struct io_kiocb *req, unsigned int issue_flags)
 	unsigned int file_flags = force_nonblock ? O_NONBLOCK : 0;
 	bool fixed = !!accept->file_slot;
 	struct file *file;
-	int ret, fd;
+	int ret, fd, nr_loops = 0;
 
 retry:
 	if (!fixed) {
@@ -1344,10 +1400,14 @@ int io_accept(struct io_kiocb *req, unsigned int issue_flags)
 
 	if (ret < 0)
 		return ret;
-	if (io_post_aux_cqe(ctx, req->cqe.user_data, ret, IORING_CQE_F_MORE, false))
+	if (!io_post_aux_cqe(ctx, req->cqe.user_data, ret, IORING_CQE_F_MORE,
+			     false))
+		return -ECANCELED;
+	if (!(issue_flags & IO_URING_F_MULTISHOT) ||
+	    ++nr_loops < MULTISHOT_MAX_RETRY)
 		goto retry;
 
-	return -ECANCELED;
+	return IOU_REQUEUE;
 }
 
 int io_socket_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
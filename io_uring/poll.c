@@ -224,8 +224,11 @@ enum {
 	IOU_POLL_NO_ACTION = 1,
 	IOU_POLL_REMOVE_POLL_USE_RES = 2,
 	IOU_POLL_REISSUE = 3,
+	IOU_POLL_REQUEUE = 4,
 };
 
+static void __io_poll_execute(struct io_kiocb *req, int mask);
+
 /*
  * All poll tw should go through this. Checks for poll events, manages
  * references, does rewait, etc.
@@ -234,7 +237,8 @@ enum {
  * require, which is either spurious wakeup or multishot CQE is served.
  * IOU_POLL_DONE when it's done with the request, then the mask is stored in
  * req->cqe.res. IOU_POLL_REMOVE_POLL_USE_RES indicates to remove multishot
- * poll and that the result is stored in req->cqe.
+ * poll and that the result is stored in req->cqe. IOU_POLL_REQUEUE asks for
+ * the task_work to be queued again, the references being kept.
  */
 static int io_poll_check_events(struct io_kiocb *req, bool *locked)
 {
@@ -307,6 +311,8 @@ static int io_poll_check_events(struct io_kiocb *req, bool *locked)
 			int ret = io_poll_issue(req, locked);
 			if (ret == IOU_STOP_MULTISHOT)
 				return IOU_POLL_REMOVE_POLL_USE_RES;
+			if (ret == IOU_REQUEUE)
+				return IOU_POLL_REQUEUE;
 			if (ret < 0)
 				return ret;
 		}
@@ -359,6 +365,11 @@ static void io_apoll_task_func(struct io_kiocb *req, bool *locked)
 	ret = io_poll_check_events(req, locked);
 	if (ret == IOU_POLL_NO_ACTION)
 		return;
+	if (ret == IOU_POLL_REQUEUE) {
+		/* vfs_poll() again once the other task_work had its turn */
+		__io_poll_execute(req, 0);
+		return;
+	}
 
 	io_tw_lock(req->ctx, locked);
 	io_poll_remove_entries(req);
@@ -7,6 +7,7 @@
 #include <linux/errno.h>
 #include <linux/file.h>
 #include <linux/mm.h>
+#include <linux/moduleparam.h>
 #include <linux/slab.h>
 #include <linux/audit.h>
 #include <linux/security.h>
@@ -19,6 +20,14 @@
 
 #define IORING_SQPOLL_CAP_ENTRIES_VALUE 8
 
+/* shortest spin of the adaptive idle, a few wakeup latencies */
+#define IORING_SQPOLL_IDLE_MIN_NS	(50 * NSEC_PER_USEC)
+
+static bool adaptive_idle;
+module_param(adaptive_idle, bool, 0644);
+MODULE_PARM_DESC(adaptive_idle,
+		 "Size the SQPOLL idle spin to the submission interarrival time");
+
 enum {
 	IO_SQ_THREAD_SHOULD_STOP = 0,
 	IO_SQ_THREAD_SHOULD_PARK,
@@ -159,6 +168,44 @@ static struct io_sq_data *io_get_sq_data(struct io_uring_params *p,
 	return sqd;
 }
 
+/*
+ * With adaptive_idle, the thread no longer spins for sq_thread_idle once
+ * the rings are idle, but for a few times the average gap between two
+ * loops finding work, so a ring submitting every few microseconds doesn't
+ * keep a CPU busy for a whole second after its last submission.
+ * sq_thread_idle remains the upper bound.
+ */
+u64 io_sqd_idle_ns(struct io_sq_data *sqd)
+{
+	u64 max_ns = jiffies_to_nsecs(sqd->sq_thread_idle);
+
+	if (!READ_ONCE(adaptive_idle))
+		return max_ns;
+
+	return clamp_t(u64, 4 * READ_ONCE(sqd->avg_gap_ns),
+		       IORING_SQPOLL_IDLE_MIN_NS, max_ns);
+}
+
+static void io_sqd_note_work(struct io_sq_data *sqd)
+{
+	u64 now = ktime_get_ns();
+	u64 gap = min_t(u64, now - sqd->last_work_ns,
+			jiffies_to_nsecs(sqd->sq_thread_idle));
+
+	sqd->avg_gap_ns = sqd->avg_gap_ns - (sqd->avg_gap_ns >> 3) + (gap >> 3);
+	sqd->last_work_ns = now;
+}
+
+static bool io_sqd_idle_expired(struct io_sq_data *sqd, unsigned long timeout)
+{
+	if (time_after(jiffies, timeout))
+		return true;
+	if (!READ_ONCE(adaptive_idle))
+		return false;
+
+	return ktime_get_ns() - sqd->last_work_ns > io_sqd_idle_ns(sqd);
+}
+
 static inline bool io_sqd_events_pending(struct io_sq_data *sqd)
 {
 	return READ_ONCE(sqd->state);
@@ -191,6 +238,8 @@ static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 		if (to_submit && likely(!percpu_ref_is_dying(&ctx->refs)) &&
 		    !(ctx->flags & IORING_SETUP_R_DISABLED))
 			ret = io_submit_sqes(ctx, to_submit);
+		if (ret > 0)
+			ctx->sq_submitted += ret;
 		mutex_unlock(&ctx->uring_lock);
 
 		if (to_submit && wq_has_sleeper(&ctx->sqo_sq_wait))
@@ -236,6 +285,7 @@ static int io_sq_thread(void *data)
 	current->flags |= PF_NO_SETAFFINITY;
 
 	mutex_lock(&sqd->lock);
+	sqd->last_work_ns = ktime_get_ns();
 	while (1) {
 		bool cap_entries, sqt_spin = false;
 
@@ -252,12 +302,17 @@ static int io_sq_thread(void *data)
 			if (!sqt_spin && (ret > 0 || !wq_list_empty(&ctx->iopoll_list)))
 				sqt_spin = true;
 		}
+		/* don't always serve the same ring first */
+		if (cap_entries)
+			list_rotate_left(&sqd->ctx_list);
 		if (io_run_task_work())
 			sqt_spin = true;
 
-		if (sqt_spin || !time_after(jiffies, timeout)) {
-			if (sqt_spin)
+		if (sqt_spin || !io_sqd_idle_expired(sqd, timeout)) {
+			if (sqt_spin) {
+				io_sqd_note_work(sqd);
 				timeout = jiffies + sqd->sq_thread_idle;
+			}
 			if (unlikely(need_resched())) {
 				mutex_unlock(&sqd->lock);
 				cond_resched();
@@ -292,9 +347,11 @@ static int io_sq_thread(void *data)
 			}
 
 			if (needs_sched) {
+				sqd->sleeps++;
 				mutex_unlock(&sqd->lock);
 				schedule();
 				mutex_lock(&sqd->lock);
+				sqd->last_work_ns = ktime_get_ns();
 			}
 			list_for_each_entry(ctx, &sqd->ctx_list, sqd_list)
 				atomic_andnot(IORING_SQ_NEED_WAKEUP,
@@ -18,6 +18,11 @@ struct io_sq_data {
 
 	unsigned long		state;
 	struct completion	exited;
+
+	/* adaptive idle, see io_sqd_idle_expired() */
+	u64			last_work_ns;
+	u64			avg_gap_ns;
+	unsigned long		sleeps;
 };
 
 int io_sq_offload_create(struct io_ring_ctx *ctx, struct io_uring_params *p);
@@ -28,3 +33,4 @@ void io_sq_thread_unpark(struct io_sq_data *sqd);
 void io_put_sq_data(struct io_sq_data *sqd);
 int io_sqpoll_wait_sq(struct io_ring_ctx *ctx);
 int io_sqpoll_wq_cpu_affinity(struct io_ring_ctx *ctx, cpumask_var_t mask);
+u64 io_sqd_idle_ns(struct io_sq_data *sqd);
@@ -406,23 +406,68 @@ void dma_direct_free_pages(struct device *dev, size_t size,
 
 #if defined(CONFIG_ARCH_HAS_SYNC_DMA_FOR_DEVICE) || \
     defined(CONFIG_SWIOTLB)
-void dma_direct_sync_sg_for_device(struct device *dev,
-		struct scatterlist *sgl, int nents, enum dma_data_direction dir)
+/*
+ * The cache maintenance of physically contiguous segments, as the pages of
+ * a large buffer often are, is done with a single call covering them all.
+ * Segments bounced through swiotlb are kept apart, as their cache
+ * maintenance must stay ordered with the bounce copy, and the P2PDMA bus
+ * address segments need none.  @bounce is false when the swiotlb segments
+ * were just copied by their mapping and only need the cache maintenance.
+ */
+static void __dma_direct_sync_sg_for_device(struct device *dev,
+		struct scatterlist *sgl, int nents, enum dma_data_direction dir,
+		bool bounce)
 {
+	phys_addr_t start = 0;
 	struct scatterlist *sg;
+	size_t len = 0;
 	int i;
 
 	for_each_sg(sgl, sg, nents, i) {
 		phys_addr_t paddr = dma_to_phys(dev, sg_dma_address(sg));
 
-		if (unlikely(is_swiotlb_buffer(dev, paddr)))
-			swiotlb_sync_single_for_device(dev, paddr, sg->length,
-						       dir);
+		if (sg_is_dma_bus_address(sg))
+			continue;
+
+		if (unlikely(is_swiotlb_buffer(dev, paddr))) {
+			if (bounce)
+				swiotlb_sync_single_for_device(dev, paddr,
+							       sg->length, dir);
+
+			if (!dev_is_dma_coherent(dev))
+				arch_sync_dma_for_device(paddr, sg->length,
+						dir);
+			continue;
+		}
+
+		if (dev_is_dma_coherent(dev))
+			continue;
+
+		if (len && paddr == start + len) {
+			len += sg->length;
+			continue;
+		}
 
-		if (!dev_is_dma_coherent(dev))
-			arch_sync_dma_for_device(paddr, sg->length,
-					dir);
+		if (len)
+			arch_sync_dma_for_device(start, len, dir);
+		start = paddr;
+		len = sg->length;
 	}
+
+	if (len)
+		arch_sync_dma_for_device(start, len, dir);
+}
+
+void dma_direct_sync_sg_for_device(struct device *dev,
+		struct scatterlist *sgl, int nents, enum dma_data_direction dir)
+{
+	__dma_direct_sync_sg_for_device(dev, sgl, nents, dir, true);
+}
+#else
+static inline void __dma_direct_sync_sg_for_device(struct device *dev,
+		struct scatterlist *sgl, int nents, enum dma_data_direction dir,
+		bool bounce)
+{
 }
 #endif
 
@@ -432,23 +477,39 @@ void dma_direct_sync_sg_for_device(struct device *dev,
 void dma_direct_sync_sg_for_cpu(struct device *dev,
 		struct scatterlist *sgl, int nents, enum dma_data_direction dir)
 {
+	phys_addr_t start = 0;
 	struct scatterlist *sg;
+	size_t len = 0;
 	int i;
 
 	for_each_sg(sgl, sg, nents, i) {
 		phys_addr_t paddr = dma_to_phys(dev, sg_dma_address(sg));
 
-		if (!dev_is_dma_coherent(dev))
-			arch_sync_dma_for_cpu(paddr, sg->length, dir);
+		if (unlikely(is_swiotlb_buffer(dev, paddr))) {
+			if (!dev_is_dma_coherent(dev))
+				arch_sync_dma_for_cpu(paddr, sg->length, dir);
 
-		if (unlikely(is_swiotlb_buffer(dev, paddr)))
 			swiotlb_sync_single_for_cpu(dev, paddr, sg->length,
 						    dir);
+		} else if (!dev_is_dma_coherent(dev)) {
+			/* Same coalescing as for the device */
+			if (len && paddr == start + len) {
+				len += sg->length;
+			} else {
+				if (len)
+					arch_sync_dma_for_cpu(start, len, dir);
+				start = paddr;
+				len = sg->length;
+			}
+		}
 
 		if (dir == DMA_FROM_DEVICE)
 			arch_dma_mark_clean(paddr, sg->length);
 	}
 
+	if (len)
+		arch_sync_dma_for_cpu(start, len, dir);
+
 	if (!dev_is_dma_coherent(dev))
 		arch_sync_dma_for_cpu_all();
 }
@@ -477,10 +538,15 @@ int dma_direct_map_sg(struct device *dev, struct scatterlist *sgl, int nents,
 		enum dma_data_direction dir, unsigned long attrs)
 {
 	struct pci_p2pdma_map_state p2pdma_state = {};
+	unsigned long map_attrs = attrs;
 	enum pci_p2pdma_map_type map;
 	struct scatterlist *sg;
 	int i, ret;
 
+	/* do the cache maintenance of the whole list at once, see below */
+	if (!dev_is_dma_coherent(dev))
+		map_attrs |= DMA_ATTR_SKIP_CPU_SYNC;
+
 	for_each_sg(sgl, sg, nents, i) {
 		if (is_pci_p2pdma_page(sg_page(sg))) {
 			map = pci_p2pdma_map_segment(&p2pdma_state, dev, sg);
@@ -502,7 +568,7 @@ int dma_direct_map_sg(struct device *dev, struct scatterlist *sgl, int nents,
 		}
 
 		sg->dma_address = dma_direct_map_page(dev, sg_page(sg),
-				sg->offset, sg->length, dir, attrs);
+				sg->offset, sg->length, dir, map_attrs);
 		if (sg->dma_address == DMA_MAPPING_ERROR) {
 			ret = -EIO;
 			goto out_unmap;
@@ -510,6 +576,14 @@ int dma_direct_map_sg(struct device *dev, struct scatterlist *sgl, int nents,
 		sg_dma_len(sg) = sg->length;
 	}
 
+	/*
+	 * The contiguous segments get a single maintenance call, which may be
+	 * large enough for the cache to be cleaned a cheaper way.  The swiotlb
+	 * segments were already bounced by their mapping.
+	 */
+	if (map_attrs != attrs && !(attrs & DMA_ATTR_SKIP_CPU_SYNC))
+		__dma_direct_sync_sg_for_device(dev, sgl, nents, dir, false);
+
 	return nents;
 
 out_unmap:
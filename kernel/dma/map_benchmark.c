@@ -11,11 +11,13 @@
 #include <linux/dma-mapping.h>
 #include <linux/kernel.h>
 #include <linux/kthread.h>
+#include <linux/log2.h>
 #include <linux/map_benchmark.h>
 #include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/pci.h>
 #include <linux/platform_device.h>
+#include <linux/scatterlist.h>
 #include <linux/slab.h>
 #include <linux/timekeeping.h>
 
@@ -29,21 +31,84 @@ struct map_benchmark_data {
 	atomic64_t sum_sq_map;
 	atomic64_t sum_sq_unmap;
 	atomic64_t loops;
+	atomic64_t map_hist[DMA_MAP_HIST_BUCKETS];
+	atomic64_t unmap_hist[DMA_MAP_HIST_BUCKETS];
 };
 
+static void map_benchmark_hist(atomic64_t *hist, u64 lat_100ns)
+{
+	unsigned int n = lat_100ns ? ilog2(lat_100ns) + 1 : 0;
+
+	atomic64_inc(&hist[min_t(unsigned int, n, DMA_MAP_HIST_BUCKETS - 1)]);
+}
+
+/*
+ * Set up what the benchmark maps: a single buffer, mapped here once and for
+ * all in sync mode, or a list of its pages in sg mode.
+ */
+static int map_benchmark_setup(struct map_benchmark_data *map, void *buf,
+			       u64 size, dma_addr_t *dma_addr,
+			       struct sg_table *sgt)
+{
+	int npages = map->bparam.granule;
+	struct scatterlist *sg;
+	int i, ret;
+
+	switch (map->bparam.mode) {
+	case DMA_MAP_MODE_SYNC:
+		*dma_addr = dma_map_single(map->dev, buf, size, map->dir);
+		if (unlikely(dma_mapping_error(map->dev, *dma_addr))) {
+			pr_err("dma_map_single failed on %s\n",
+				dev_name(map->dev));
+			return -ENOMEM;
+		}
+		break;
+	case DMA_MAP_MODE_SG:
+		ret = sg_alloc_table(sgt, npages, GFP_KERNEL);
+		if (ret)
+			return ret;
+
+		for_each_sg(sgt->sgl, sg, npages, i)
+			sg_set_buf(sg, buf + i * PAGE_SIZE, PAGE_SIZE);
+		break;
+	}
+
+	return 0;
+}
+
+static void map_benchmark_teardown(struct map_benchmark_data *map,
+				   u64 size, dma_addr_t dma_addr,
+				   struct sg_table *sgt)
+{
+	switch (map->bparam.mode) {
+	case DMA_MAP_MODE_SYNC:
+		dma_unmap_single(map->dev, dma_addr, size, map->dir);
+		break;
+	case DMA_MAP_MODE_SG:
+		sg_free_table(sgt);
+		break;
+	}
+}
+
 static int map_benchmark_thread(void *data)
 {
 	void *buf;
-	dma_addr_t dma_addr;
+	dma_addr_t dma_addr = 0;
 	struct map_benchmark_data *map = data;
 	int npages = map->bparam.granule;
 	u64 size = npages * PAGE_SIZE;
+	u64 sync_len = map->bparam.sync_len ? map->bparam.sync_len : size;
+	struct sg_table sgt;
 	int ret = 0;
 
 	buf = alloc_pages_exact(size, GFP_KERNEL);
 	if (!buf)
 		return -ENOMEM;
 
+	ret = map_benchmark_setup(map, buf, size, &dma_addr, &sgt);
+	if (ret)
+		goto out_free;
+
 	while (!kthread_should_stop())  {
 		u64 map_100ns, unmap_100ns, map_sq, unmap_sq;
 		ktime_t map_stime, map_etime, unmap_stime, unmap_etime;
@@ -59,12 +124,29 @@ static int map_benchmark_thread(void *data)
 			memset(buf, 0x66, size);
 
 		map_stime = ktime_get();
-		dma_addr = dma_map_single(map->dev, buf, size, map->dir);
-		if (unlikely(dma_mapping_error(map->dev, dma_addr))) {
-			pr_err("dma_map_single failed on %s\n",
-				dev_name(map->dev));
-			ret = -ENOMEM;
-			goto out;
+		switch (map->bparam.mode) {
+		case DMA_MAP_MODE_SYNC:
+			dma_sync_single_range_for_device(map->dev, dma_addr, 0,
+							 sync_len, map->dir);
+			break;
+		case DMA_MAP_MODE_SG:
+			ret = dma_map_sgtable(map->dev, &sgt, map->dir, 0);
+			if (unlikely(ret)) {
+				pr_err("dma_map_sgtable failed on %s\n",
+					dev_name(map->dev));
+				goto out;
+			}
+			break;
+		default:
+			dma_addr = dma_map_single(map->dev, buf, size,
+						  map->dir);
+			if (unlikely(dma_mapping_error(map->dev, dma_addr))) {
+				pr_err("dma_map_single failed on %s\n",
+					dev_name(map->dev));
+				ret = -ENOMEM;
+				goto out;
+			}
+			break;
 		}
 		map_etime = ktime_get();
 		map_delta = ktime_sub(map_etime, map_stime);
@@ -73,7 +155,18 @@ static int map_benchmark_thread(void *data)
 		ndelay(map->bparam.dma_trans_ns);
 
 		unmap_stime = ktime_get();
-		dma_unmap_single(map->dev, dma_addr, size, map->dir);
+		switch (map->bparam.mode) {
+		case DMA_MAP_MODE_SYNC:
+			dma_sync_single_range_for_cpu(map->dev, dma_addr, 0,
+						      sync_len, map->dir);
+			break;
+		case DMA_MAP_MODE_SG:
+			dma_unmap_sgtable(map->dev, &sgt, map->dir, 0);
+			break;
+		default:
+			dma_unmap_single(map->dev, dma_addr, size, map->dir);
+			break;
+		}
 		unmap_etime = ktime_get();
 		unmap_delta = ktime_sub(unmap_etime, unmap_stime);
 
@@ -89,9 +182,13 @@ static int map_benchmark_thread(void *data)
 		atomic64_add(map_sq, &map->sum_sq_map);
 		atomic64_add(unmap_sq, &map->sum_sq_unmap);
 		atomic64_inc(&map->loops);
+		map_benchmark_hist(map->map_hist, map_100ns);
+		map_benchmark_hist(map->unmap_hist, unmap_100ns);
 	}
 
 out:
+	map_benchmark_teardown(map, size, dma_addr, &sgt);
+out_free:
 	free_pages_exact(buf, size);
 	return ret;
 }
@@ -131,6 +228,10 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 	atomic64_set(&map->sum_sq_map, 0);
 	atomic64_set(&map->sum_sq_unmap, 0);
 	atomic64_set(&map->loops, 0);
+	for (i = 0; i < DMA_MAP_HIST_BUCKETS; i++) {
+		atomic64_set(&map->map_hist[i], 0);
+		atomic64_set(&map->unmap_hist[i], 0);
+	}
 
 	for (i = 0; i < threads; i++) {
 		get_task_struct(tsk[i]);
@@ -169,6 +270,11 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 		map->bparam.unmap_stddev = int_sqrt64(unmap_variance);
 	}
 
+	for (i = 0; i < DMA_MAP_HIST_BUCKETS; i++) {
+		map->bparam.map_hist[i] = atomic64_read(&map->map_hist[i]);
+		map->bparam.unmap_hist[i] = atomic64_read(&map->unmap_hist[i]);
+	}
+
 out:
 	for (i = 0; i < threads; i++)
 		put_task_struct(tsk[i]);
@@ -218,6 +324,17 @@ static long map_benchmark_ioctl(struct file *file, unsigned int cmd,
 			return -EINVAL;
 		}
 
+		if (map->bparam.mode > DMA_MAP_MODE_SG) {
+			pr_err("invalid benchmark mode\n");
+			return -EINVAL;
+		}
+
+		if (map->bparam.sync_len >
+		    (u64)map->bparam.granule * PAGE_SIZE) {
+			pr_err("invalid sync length\n");
+			return -EINVAL;
+		}
+
 		switch (map->bparam.dma_dir) {
 		case DMA_MAP_BIDIRECTIONAL:
 			map->dir = DMA_BIDIRECTIONAL;
@@ -85,13 +85,18 @@ static unsigned long default_nareas;
  *
  * @used:	The number of used IO TLB block.
  * @index:	The slot index to start searching in this area for next round.
+ * @contended:	The number of times the lock was found taken by another CPU.
  * @lock:	The lock to protect the above data structures in the map and
  *		unmap calls.
+ * @bounced:	The number of bytes copied to and from the slots of this area.
+ *		Updated without the lock, as the copies don't take it.
  */
 struct io_tlb_area {
 	unsigned long used;
 	unsigned int index;
+	unsigned long contended;
 	spinlock_t lock;
+	atomic_long_t bounced;
 };
 
 /*
@@ -304,7 +309,10 @@ static void swiotlb_init_io_tlb_mem(struct io_tlb_mem *mem, phys_addr_t start,
 		spin_lock_init(&mem->areas[i].lock);
 		mem->areas[i].index = 0;
 		mem->areas[i].used = 0;
+		mem->areas[i].contended = 0;
+		atomic_long_set(&mem->areas[i].bounced, 0);
 	}
+	atomic_long_set(&mem->map_failed, 0);
 
 	for (i = 0; i < mem->nslabs; i++) {
 		mem->slots[i].list = IO_TLB_SEGSIZE - io_tlb_offset(i);
@@ -562,6 +570,8 @@ static void swiotlb_bounce(struct device *dev, phys_addr_t tlb_addr, size_t size
 	if (orig_addr == INVALID_PHYS_ADDR)
 		return;
 
+	atomic_long_add(size, &mem->areas[index / mem->area_nslabs].bounced);
+
 	tlb_offset = tlb_addr & (IO_TLB_SIZE - 1);
 	orig_addr_offset = swiotlb_align_offset(dev, orig_addr);
 	if (tlb_offset < orig_addr_offset) {
@@ -640,6 +650,22 @@ static unsigned int wrap_area_index(struct io_tlb_mem *mem, unsigned int index)
 	return index;
 }
 
+/*
+ * Take the lock of an area, accounting for the times another CPU holds it:
+ * a pool with too few areas for its users shows up there first.
+ */
+static unsigned long swiotlb_area_lock(struct io_tlb_area *area)
+	__acquires(&area->lock)
+{
+	unsigned long flags;
+
+	if (!spin_trylock_irqsave(&area->lock, flags)) {
+		spin_lock_irqsave(&area->lock, flags);
+		area->contended++;
+	}
+	return flags;
+}
+
 /*
  * Find a suitable number of IO TLB entries size that will fit this request and
  * allocate a buffer from that IO TLB pool.
@@ -676,7 +702,7 @@ static int swiotlb_do_find_slots(struct device *dev, int area_index,
 		stride = max(stride, stride << (PAGE_SHIFT - IO_TLB_SHIFT));
 	stride = max(stride, (alloc_align_mask >> IO_TLB_SHIFT) + 1);
 
-	spin_lock_irqsave(&area->lock, flags);
+	flags = swiotlb_area_lock(area);
 	if (unlikely(nslots > mem->area_nslabs - area->used))
 		goto not_found;
 
@@ -792,6 +818,7 @@ phys_addr_t swiotlb_tbl_map_single(struct device *dev, phys_addr_t orig_addr,
 	index = swiotlb_find_slots(dev, orig_addr,
 				   alloc_size + offset, alloc_align_mask);
 	if (index == -1) {
+		atomic_long_inc(&mem->map_failed);
 		if (!(attrs & DMA_ATTR_NO_WARN))
 			dev_warn_ratelimited(dev,
 	"swiotlb buffer is full (sz: %zd bytes), total %lu (slots), used %lu (slots)\n",
@@ -837,7 +864,7 @@ static void swiotlb_release_slots(struct device *dev, phys_addr_t tlb_addr)
 	 */
 	BUG_ON(aindex >= mem->nareas);
 
-	spin_lock_irqsave(&area->lock, flags);
+	flags = swiotlb_area_lock(area);
 	if (index + nslots < ALIGN(index + 1, IO_TLB_SEGSIZE))
 		count = mem->slots[index + nslots].list;
 	else
@@ -966,6 +993,42 @@ static int io_tlb_used_get(void *data, u64 *val)
 }
 DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_used, io_tlb_used_get, NULL, "%llu\n");
 
+static int io_tlb_bounced_get(void *data, u64 *val)
+{
+	struct io_tlb_mem *mem = data;
+	int i;
+
+	*val = 0;
+	for (i = 0; i < mem->nareas; i++)
+		*val += atomic_long_read(&mem->areas[i].bounced);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_bounced, io_tlb_bounced_get, NULL,
+			 "%llu\n");
+
+static int io_tlb_contended_get(void *data, u64 *val)
+{
+	struct io_tlb_mem *mem = data;
+	int i;
+
+	*val = 0;
+	for (i = 0; i < mem->nareas; i++)
+		*val += READ_ONCE(mem->areas[i].contended);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_contended, io_tlb_contended_get, NULL,
+			 "%llu\n");
+
+static int io_tlb_map_failed_get(void *data, u64 *val)
+{
+	struct io_tlb_mem *mem = data;
+
+	*val = atomic_long_read(&mem->map_failed);
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(fops_io_tlb_map_failed, io_tlb_map_failed_get, NULL,
+			 "%llu\n");
+
 static void swiotlb_create_debugfs_files(struct io_tlb_mem *mem,
 					 const char *dirname)
 {
@@ -976,6 +1039,13 @@ static void swiotlb_create_debugfs_files(struct io_tlb_mem *mem,
 	debugfs_create_ulong("io_tlb_nslabs", 0400, mem->debugfs, &mem->nslabs);
 	debugfs_create_file("io_tlb_used", 0400, mem->debugfs, mem,
 			&fops_io_tlb_used);
+	debugfs_create_u32("io_tlb_nareas", 0400, mem->debugfs, &mem->nareas);
+	debugfs_create_file("io_tlb_bounced", 0400, mem->debugfs, mem,
+			&fops_io_tlb_bounced);
+	debugfs_create_file("io_tlb_contended", 0400, mem->debugfs, mem,
+			&fops_io_tlb_contended);
+	debugfs_create_file("io_tlb_map_failed", 0400, mem->debugfs, mem,
+			&fops_io_tlb_map_failed);
 }
 
 static int __init __maybe_unused swiotlb_create_default_debugfs(void)
@@ -1020,14 +1090,30 @@ bool swiotlb_free(struct device *dev, struct page *page, size_t size)
 	return true;
 }
 
+/*
+ * A pool shared by several devices, or by a device mapping from several CPUs,
+ * gets one area per CPU like the default pool, as far as its size allows:
+ * each area must hold whole segments and the areas split the pool evenly.
+ * The swiotlb=,<nareas> command line setting applies to it as well.
+ */
+static unsigned int rmem_swiotlb_nareas(unsigned long nslabs)
+{
+	unsigned int nareas = default_nareas ?:
+		roundup_pow_of_two(num_possible_cpus());
+
+	while (nareas > 1 &&
+	       (nslabs < nareas * IO_TLB_SEGSIZE ||
+		nslabs % (nareas * IO_TLB_SEGSIZE)))
+		nareas >>= 1;
+	return nareas;
+}
+
 static int rmem_swiotlb_device_init(struct reserved_mem *rmem,
 				    struct device *dev)
 {
 	struct io_tlb_mem *mem = rmem->priv;
 	unsigned long nslabs = rmem->size >> IO_TLB_SHIFT;
-
-	/* Set Per-device io tlb area to one */
-	unsigned int nareas = 1;
+	unsigned int nareas;
 
 	if (PageHighMem(pfn_to_page(PHYS_PFN(rmem->base)))) {
 		dev_err(dev, "Restricted DMA pool must be accessible within the linear mapping.");
@@ -1040,6 +1126,8 @@ static int rmem_swiotlb_device_init(struct reserved_mem *rmem,
 	 * to it.
 	 */
 	if (!mem) {
+		nareas = rmem_swiotlb_nareas(nslabs);
+
 		mem = kzalloc(sizeof(*mem), GFP_KERNEL);
 		if (!mem)
 			return -ENOMEM;
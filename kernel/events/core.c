@@ -4198,6 +4198,7 @@ static bool perf_rotate_context(struct perf_cpu_context *cpuctx)
 	struct perf_event *cpu_event = NULL, *task_event = NULL;
 	struct perf_event_context *task_ctx = NULL;
 	int cpu_rotate, task_rotate;
+	u64 start;
 
 	/*
 	 * Since we run this from IRQ context, nobody can install new
@@ -4211,6 +4212,7 @@ static bool perf_rotate_context(struct perf_cpu_context *cpuctx)
 	if (!(cpu_rotate || task_rotate))
 		return false;
 
+	start = local_clock();
 	perf_ctx_lock(cpuctx, cpuctx->task_ctx);
 	perf_pmu_disable(cpuctx->ctx.pmu);
 
@@ -4238,6 +4240,9 @@ static bool perf_rotate_context(struct perf_cpu_context *cpuctx)
 	perf_pmu_enable(cpuctx->ctx.pmu);
 	perf_ctx_unlock(cpuctx, cpuctx->task_ctx);
 
+	cpuctx->nr_rotations++;
+	cpuctx->rotate_ns += local_clock() - start;
+
 	return true;
 }
 
@@ -11210,9 +11215,76 @@ perf_event_mux_interval_ms_store(struct device *dev,
 }
 static DEVICE_ATTR_RW(perf_event_mux_interval_ms);
 
+static ssize_t
+perf_event_mux_rotations_show(struct device *dev,
+			      struct device_attribute *attr,
+			      char *page)
+{
+	struct pmu *pmu = dev_get_drvdata(dev);
+	u64 rotations = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		rotations += READ_ONCE(per_cpu_ptr(pmu->pmu_cpu_context,
+						   cpu)->nr_rotations);
+
+	return scnprintf(page, PAGE_SIZE - 1, "%llu\n", rotations);
+}
+static DEVICE_ATTR_RO(perf_event_mux_rotations);
+
+static ssize_t
+perf_event_mux_rotate_ns_show(struct device *dev,
+			      struct device_attribute *attr,
+			      char *page)
+{
+	struct pmu *pmu = dev_get_drvdata(dev);
+	u64 ns = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		ns += READ_ONCE(per_cpu_ptr(pmu->pmu_cpu_context,
+					    cpu)->rotate_ns);
+
+	return scnprintf(page, PAGE_SIZE - 1, "%llu\n", ns);
+}
+static DEVICE_ATTR_RO(perf_event_mux_rotate_ns);
+
+static ssize_t
+perf_event_pinned_restricted_show(struct device *dev,
+				  struct device_attribute *attr,
+				  char *page)
+{
+	struct pmu *pmu = dev_get_drvdata(dev);
+
+	return scnprintf(page, PAGE_SIZE - 1, "%d\n",
+			 READ_ONCE(pmu->pinned_restricted));
+}
+
+static ssize_t
+perf_event_pinned_restricted_store(struct device *dev,
+				   struct device_attribute *attr,
+				   const char *buf, size_t count)
+{
+	struct pmu *pmu = dev_get_drvdata(dev);
+	bool restricted;
+	int ret;
+
+	ret = kstrtobool(buf, &restricted);
+	if (ret)
+		return ret;
+
+	WRITE_ONCE(pmu->pinned_restricted, restricted);
+
+	return count;
+}
+static DEVICE_ATTR_RW(perf_event_pinned_restricted);
+
 static struct attribute *pmu_dev_attrs[] = {
 	&dev_attr_type.attr,
 	&dev_attr_perf_event_mux_interval_ms.attr,
+	&dev_attr_perf_event_mux_rotations.attr,
+	&dev_attr_perf_event_mux_rotate_ns.attr,
+	&dev_attr_perf_event_pinned_restricted.attr,
 	NULL,
 };
 ATTRIBUTE_GROUPS(pmu_dev);
@@ -12474,6 +12546,18 @@ SYSCALL_DEFINE5(perf_event_open,
 			goto err_context;
 	}
 
+	/*
+	 * Pinned groups are never rotated out; on a PMU with few counters,
+	 * keep them for the privileged monitoring if asked to.  Check the PMU
+	 * the group ends up on, a pinned software group is moved to the PMU
+	 * of the first hardware event added to it.
+	 */
+	if ((group_leader ? group_leader->attr.pinned : attr.pinned) &&
+	    READ_ONCE(pmu->pinned_restricted) && !perfmon_capable()) {
+		err = -EACCES;
+		goto err_context;
+	}
+
 	if (output_event) {
 		err = perf_event_set_output(event, output_event);
 		if (err)
@@ -1210,6 +1210,53 @@ static irqreturn_t irq_thread_fn(struct irq_desc *desc,
 	return ret;
 }
 
+/*
+ * Keep calling the thread handler of an IRQF_THREAD_POLL interrupt, line
+ * masked, until it runs out of work or its budget is exhausted. As with
+ * NAPI, a handler still busy then goes back to interrupt mode: the line is
+ * unmasked, and the interrupt of the device, still pending, wakes the thread
+ * again through the hard interrupt path, where the spurious interrupt
+ * detection, affinity changes and disable_irq() get their turn. Stop early
+ * if the interrupt is being disabled or freed, synchronize_irq() waits for
+ * us.
+ */
+static void irq_thread_poll(struct irq_desc *desc, struct irqaction *action)
+{
+	unsigned int budget = READ_ONCE(action->poll_budget);
+	unsigned int done;
+
+	for (done = 0; done < budget; done++) {
+		if (kthread_should_stop() || irqd_irq_disabled(&desc->irq_data))
+			return;
+
+		if (action->thread_fn(action->irq,
+				      action->dev_id) != IRQ_HANDLED)
+			return;
+
+		action->polls++;
+	}
+
+	if (budget)
+		action->poll_exhausted++;
+}
+
+static irqreturn_t irq_thread_poll_fn(struct irq_desc *desc,
+				      struct irqaction *action)
+{
+	irqreturn_t ret;
+
+	action->poll_wakeups++;
+
+	ret = action->thread_fn(action->irq, action->dev_id);
+	if (ret == IRQ_HANDLED) {
+		atomic_inc(&desc->threads_handled);
+		irq_thread_poll(desc, action);
+	}
+
+	irq_finalize_oneshot(desc, action);
+	return ret;
+}
+
 static void wake_threads_waitq(struct irq_desc *desc)
 {
 	if (atomic_dec_and_test(&desc->threads_active))
@@ -1298,6 +1345,8 @@ static int irq_thread(void *data)
 	if (force_irqthreads() && test_bit(IRQTF_FORCED_THREAD,
 					   &action->thread_flags))
 		handler_fn = irq_forced_thread_fn;
+	else if (action->flags & IRQF_THREAD_POLL)
+		handler_fn = irq_thread_poll_fn;
 	else
 		handler_fn = irq_thread_fn;
 
@@ -1541,6 +1590,19 @@ __setup_irq(unsigned int irq, struct irq_desc *desc, struct irqaction *new)
 		}
 	}
 
+	/*
+	 * Polling needs a thread of our own, running with the line masked
+	 * until it has no more work.
+	 */
+	if (new->flags & IRQF_THREAD_POLL) {
+		if (nested || !new->thread_fn ||
+		    !(new->flags & IRQF_ONESHOT)) {
+			ret = -EINVAL;
+			goto out_mput;
+		}
+		new->poll_budget = IRQ_THREAD_POLL_BUDGET;
+	}
+
 	/*
 	 * Create a handler thread when a thread function is supplied
 	 * and the interrupt does not nest into another interrupt
@@ -1564,9 +1626,11 @@ __setup_irq(unsigned int irq, struct irq_desc *desc, struct irqaction *new)
 	 * requires the ONESHOT flag to be set. Some irq chips like
 	 * MSI based interrupts are per se one shot safe. Check the
 	 * chip flags, so we can avoid the unmask dance at the end of
-	 * the threaded handler for those.
+	 * the threaded handler for those. Polled interrupts rely on the
+	 * mask to not be raised while polling, they keep the flag.
 	 */
-	if (desc->irq_data.chip->flags & IRQCHIP_ONESHOT_SAFE)
+	if ((desc->irq_data.chip->flags & IRQCHIP_ONESHOT_SAFE) &&
+	    !(new->flags & IRQF_THREAD_POLL))
 		new->flags &= ~IRQF_ONESHOT;
 
 	/*
@@ -2134,6 +2198,8 @@ const void *free_nmi(unsigned int irq, void *dev_id)
  *	IRQF_SHARED		Interrupt is shared
  *	IRQF_TRIGGER_*		Specify active edge(s) or level
  *	IRQF_ONESHOT		Run thread_fn with interrupt line masked
+ *	IRQF_THREAD_POLL	Call thread_fn again, line masked, as long as
+ *				it returns IRQ_HANDLED
  */
 int request_threaded_irq(unsigned int irq, irq_handler_t handler,
 			 irq_handler_t thread_fn, unsigned long irqflags,
@@ -295,6 +295,63 @@ static int irq_spurious_proc_show(struct seq_file *m, void *v)
 	return 0;
 }
 
+static int irq_thread_poll_proc_show(struct seq_file *m, void *v)
+{
+	struct irq_desc *desc = irq_to_desc((long) m->private);
+	struct irqaction *action;
+	unsigned long flags;
+
+	seq_puts(m, "name budget wakeups polls exhausted\n");
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	for_each_action_of_desc(desc, action) {
+		if (!(action->flags & IRQF_THREAD_POLL))
+			continue;
+		seq_printf(m, "%s %u %lu %lu %lu\n", action->name,
+			   READ_ONCE(action->poll_budget), action->poll_wakeups,
+			   action->polls, action->poll_exhausted);
+	}
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+
+	return 0;
+}
+
+/* Set the budget of all the polled actions of the interrupt */
+static ssize_t irq_thread_poll_proc_write(struct file *file,
+		const char __user *buffer, size_t count, loff_t *pos)
+{
+	struct irq_desc *desc = irq_to_desc((long)pde_data(file_inode(file)));
+	struct irqaction *action;
+	unsigned int budget;
+	unsigned long flags;
+	int err;
+
+	err = kstrtouint_from_user(buffer, count, 0, &budget);
+	if (err)
+		return err;
+
+	raw_spin_lock_irqsave(&desc->lock, flags);
+	for_each_action_of_desc(desc, action)
+		if (action->flags & IRQF_THREAD_POLL)
+			WRITE_ONCE(action->poll_budget, budget);
+	raw_spin_unlock_irqrestore(&desc->lock, flags);
+
+	return count;
+}
+
+static int irq_thread_poll_proc_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_thread_poll_proc_show, pde_data(inode));
+}
+
+static const struct proc_ops irq_thread_poll_proc_ops = {
+	.proc_open	= irq_thread_poll_proc_open,
+	.proc_read	= seq_read,
+	.proc_lseek	= seq_lseek,
+	.proc_release	= single_release,
+	.proc_write	= irq_thread_poll_proc_write,
+};
+
 #define MAX_NAMELEN 128
 
 static int name_unique(unsigned int irq, struct irqaction *new_action)
@@ -386,6 +443,10 @@ void register_irq_proc(unsigned int irq, struct irq_desc *desc)
 	proc_create_single_data("spurious", 0444, desc->dir,
 			irq_spurious_proc_show, (void *)(long)irq);
 
+	/* create /proc/irq/<irq>/thread_poll */
+	proc_create_data("thread_poll", 0644, desc->dir,
+			 &irq_thread_poll_proc_ops, (void *)(long)irq);
+
 out_unlock:
 	mutex_unlock(&register_lock);
 }
@@ -407,6 +468,7 @@ void unregister_irq_proc(unsigned int irq, struct irq_desc *desc)
 # endif
 #endif
 	remove_proc_entry("spurious", desc->dir);
+	remove_proc_entry("thread_poll", desc->dir);
 
 	sprintf(name, "%u", irq);
 	remove_proc_entry(name, root_irq_dir);
@@ -8,6 +8,7 @@
 void __init printk_sysctl_init(void);
 int devkmsg_sysctl_set_loglvl(struct ctl_table *table, int write,
 			      void *buffer, size_t *lenp, loff_t *ppos);
+u64 printk_console_backlog(void);
 #else
 #define printk_sysctl_init() do { } while (0)
 #endif
@@ -42,6 +42,7 @@
 #include <linux/rculist.h>
 #include <linux/poll.h>
 #include <linux/irq_work.h>
+#include <linux/kthread.h>
 #include <linux/ctype.h>
 #include <linux/uio.h>
 #include <linux/sched/clock.h>
@@ -277,6 +278,48 @@ static bool panic_in_progress(void)
  */
 static int console_locked, console_suspended;
 
+/*
+ * Once the console threads are started, printk() callers leave the printing
+ * of the consoles having a thread to that thread, so a slow console doesn't
+ * stall them.  They still print directly when the threads may not get to run
+ * anymore: panic, oops, shutdown and console_emergency_enter() sections.
+ */
+static bool printk_console_threads = true;
+module_param_named(console_threads, printk_console_threads, bool, 0444);
+MODULE_PARM_DESC(console_threads, "print to the consoles from kernel threads");
+
+static bool printk_kthreads_running;
+static atomic_t printk_emergency = ATOMIC_INIT(0);
+
+static bool printk_direct(void)
+{
+	return !READ_ONCE(printk_kthreads_running) ||
+	       atomic_read(&printk_emergency) || oops_in_progress ||
+	       system_state > SYSTEM_RUNNING || panic_in_progress();
+}
+
+/**
+ * console_emergency_enter - print synchronously to all consoles
+ *
+ * Until the matching console_emergency_exit(), printk() callers print the
+ * whole console backlog themselves, as they did before the console threads,
+ * for the sections of code that can't count on the threads to be scheduled.
+ */
+void console_emergency_enter(void)
+{
+	atomic_inc(&printk_emergency);
+}
+EXPORT_SYMBOL(console_emergency_enter);
+
+/**
+ * console_emergency_exit - go back to printing from the console threads
+ */
+void console_emergency_exit(void)
+{
+	atomic_dec(&printk_emergency);
+}
+EXPORT_SYMBOL(console_emergency_exit);
+
 /*
  *	Array of consoles built from command line options (console=)
  */
@@ -2248,6 +2291,10 @@ asmlinkage int vprintk_emit(int facility, int level,
 
 	printed_len = vprintk_store(facility, level, dev_info, fmt, args);
 
+	/* The console threads are woken from irq_work, like klogd. */
+	if (!printk_direct())
+		in_sched = true;
+
 	/* If called from the scheduler, we can not call up(). */
 	if (!in_sched) {
 		/*
@@ -2299,6 +2346,8 @@ EXPORT_SYMBOL(_printk);
 
 static bool pr_flush(int timeout_ms, bool reset_on_progress);
 static bool __pr_flush(struct console *con, int timeout_ms, bool reset_on_progress);
+static void printk_start_kthread(struct console *con);
+static void printk_stop_kthread(struct task_struct *thread);
 
 #else /* CONFIG_PRINTK */
 
@@ -2334,6 +2383,8 @@ static void call_console_driver(struct console *con, const char *text, size_t le
 static bool suppress_message_printing(int level) { return false; }
 static bool pr_flush(int timeout_ms, bool reset_on_progress) { return true; }
 static bool __pr_flush(struct console *con, int timeout_ms, bool reset_on_progress) { return true; }
+static void printk_start_kthread(struct console *con) { }
+static void printk_stop_kthread(struct task_struct *thread) { }
 
 #endif /* CONFIG_PRINTK */
 
@@ -2534,6 +2585,7 @@ void resume_console(void)
 	down_console_sem();
 	console_suspended = 0;
 	console_unlock();
+	defer_console_output();
 	pr_flush(1000, true);
 }
 
@@ -2793,6 +2845,8 @@ static bool console_flush_all(bool do_cond_resched, u64 *next_seq, bool *handove
 
 			if (!console_is_usable(con))
 				continue;
+			if (con->thread && !printk_direct())
+				continue;
 			any_usable = true;
 
 			if (con->flags & CON_EXTENDED) {
@@ -3206,6 +3260,8 @@ void register_console(struct console *newcon)
 		/* Begin with next message. */
 		newcon->seq = prb_next_seq(prb);
 	}
+	if (printk_kthreads_running)
+		printk_start_kthread(newcon);
 	console_unlock();
 	console_sysfs_notify();
 
@@ -3229,6 +3285,7 @@ EXPORT_SYMBOL(register_console);
 
 int unregister_console(struct console *console)
 {
+	struct task_struct *thread;
 	struct console *con;
 	int res;
 
@@ -3266,9 +3323,14 @@ int unregister_console(struct console *console)
 		console_drivers->flags |= CON_CONSDEV;
 
 	console->flags &= ~CON_ENABLED;
+	thread = console->thread;
+	console->thread = NULL;
 	console_unlock();
 	console_sysfs_notify();
 
+	if (thread)
+		printk_stop_kthread(thread);
+
 	if (console->exit)
 		res = console->exit(console);
 
@@ -3444,6 +3506,180 @@ static bool pr_flush(int timeout_ms, bool reset_on_progress)
 	return __pr_flush(NULL, timeout_ms, reset_on_progress);
 }
 
+/**
+ * struct printk_kthread - state of the printing thread of a console
+ * @con:		console printed
+ * @text:		buffer of the text of a record
+ * @ext_text:		buffer of the extended text, for CON_EXTENDED consoles
+ * @dropped_text:	buffer of the dropped message, for the other consoles
+ */
+struct printk_kthread {
+	struct console	*con;
+	char		*text;
+	char		*ext_text;
+	char		*dropped_text;
+};
+
+static bool printk_kthread_should_wake(struct console *con, u64 seq)
+{
+	if (kthread_should_stop())
+		return true;
+
+	if (console_suspended || !(READ_ONCE(con->flags) & CON_ENABLED))
+		return false;
+
+	return prb_read_valid(prb, seq, NULL);
+}
+
+/*
+ * Print the records of a console one at a time, taking the console_lock for
+ * each of them only, so that the other users of the lock and the printk()
+ * callers needing to print directly get it in between.
+ */
+static int printk_kthread_func(void *data)
+{
+	struct printk_kthread *pt = data;
+	struct console *con = pt->con;
+	bool handover;
+	u64 seq;
+
+	console_lock();
+	seq = con->seq;
+	console_unlock();
+
+	while (!kthread_should_stop()) {
+		if (wait_event_interruptible(log_wait,
+				printk_kthread_should_wake(con, seq)))
+			continue;
+
+		if (kthread_should_stop())
+			break;
+
+		console_lock();
+		if (console_suspended) {
+			up_console_sem();
+			continue;
+		}
+
+		if (console_is_usable(con))
+			console_emit_next_record(con, pt->text, pt->ext_text,
+						 pt->dropped_text, &handover);
+		else
+			handover = false;
+		seq = con->seq;
+
+		if (!handover)
+			console_unlock();
+
+		cond_resched();
+	}
+
+	return 0;
+}
+
+static void printk_kthread_free(struct printk_kthread *pt)
+{
+	kfree(pt->dropped_text);
+	kfree(pt->ext_text);
+	kfree(pt->text);
+	kfree(pt);
+}
+
+/*
+ * Start the printing thread of a console.  Boot consoles and the consoles
+ * the thread can't be created for keep being printed by printk() callers.
+ *
+ * Requires the console_lock.
+ */
+static void printk_start_kthread(struct console *con)
+{
+	struct task_struct *thread;
+	struct printk_kthread *pt;
+
+	if (con->thread || (con->flags & CON_BOOT) || !con->write)
+		return;
+
+	/*
+	 * The buffers are allocated here, the printk() callers stop printing
+	 * the console as soon as it has a thread.
+	 */
+	pt = kzalloc(sizeof(*pt), GFP_KERNEL);
+	if (!pt)
+		goto err;
+
+	pt->con = con;
+	pt->text = kmalloc(CONSOLE_LOG_MAX, GFP_KERNEL);
+	if (con->flags & CON_EXTENDED)
+		pt->ext_text = kmalloc(CONSOLE_EXT_LOG_MAX, GFP_KERNEL);
+	else
+		pt->dropped_text = kmalloc(DROPPED_TEXT_MAX, GFP_KERNEL);
+	if (!pt->text || (!pt->ext_text && !pt->dropped_text))
+		goto err_free;
+
+	thread = kthread_run(printk_kthread_func, pt, "pr/%s%d", con->name,
+			     con->index);
+	if (IS_ERR(thread))
+		goto err_free;
+
+	con->thread = thread;
+	return;
+
+err_free:
+	printk_kthread_free(pt);
+err:
+	con_printk(KERN_ERR, con, "failed to start printing thread\n");
+}
+
+/*
+ * Stop the printing thread of an unregistered console.  The thread may be
+ * stopped before it ever ran, the buffers are freed here.
+ */
+static void printk_stop_kthread(struct task_struct *thread)
+{
+	struct printk_kthread *pt = kthread_data(thread);
+
+	kthread_stop(thread);
+	printk_kthread_free(pt);
+}
+
+static int __init printk_activate_kthreads(void)
+{
+	struct console *con;
+
+	if (!printk_console_threads)
+		return 0;
+
+	console_lock();
+	WRITE_ONCE(printk_kthreads_running, true);
+	for_each_console(con)
+		printk_start_kthread(con);
+	console_unlock();
+
+	return 0;
+}
+early_initcall(printk_activate_kthreads);
+
+/**
+ * printk_console_backlog - Number of records waiting to be printed
+ *
+ * Return: the largest number of records any enabled console is behind.
+ */
+u64 printk_console_backlog(void)
+{
+	u64 next_seq = prb_next_seq(prb);
+	struct console *con;
+	u64 backlog = 0;
+
+	console_lock();
+	for_each_console(con) {
+		if ((con->flags & CON_ENABLED) && con->seq < next_seq)
+			backlog = max(backlog, next_seq - con->seq);
+	}
+	console_unlock();
+
+	return backlog;
+}
+
 /*
  * Delayed printk version, for scheduler-internal messages:
  */
@@ -20,6 +20,17 @@ static int proc_dointvec_minmax_sysadmin(struct ctl_table *table, int write,
 	return proc_dointvec_minmax(table, write, buffer, lenp, ppos);
 }
 
+static int proc_console_backlog(struct ctl_table *table, int write,
+				void *buffer, size_t *lenp, loff_t *ppos)
+{
+	unsigned long backlog = printk_console_backlog();
+	struct ctl_table t = *table;
+
+	t.data = &backlog;
+
+	return proc_doulongvec_minmax(&t, write, buffer, lenp, ppos);
+}
+
 static struct ctl_table printk_sysctls[] = {
 	{
 		.procname	= "printk",
@@ -51,6 +62,12 @@ static struct ctl_table printk_sysctls[] = {
 		.extra1		= SYSCTL_ZERO,
 		.extra2		= (void *)&ten_thousand,
 	},
+	{
+		.procname	= "printk_console_backlog",
+		.maxlen		= sizeof(unsigned long),
+		.mode		= 0444,
+		.proc_handler	= proc_console_backlog,
+	},
 	{
 		.procname	= "printk_devkmsg",
 		.data		= devkmsg_log_str,
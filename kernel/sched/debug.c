@@ -680,6 +680,10 @@ void print_rt_rq(struct seq_file *m, int cpu, struct rt_rq *rt_rq)
 	PU(rt_nr_running);
 #ifdef CONFIG_SMP
 	PU(rt_nr_migratory);
+	PU(rt_nr_pushed);
+	PU(rt_nr_pulled);
+	PU(rt_nr_push_ipi);
+	PU(rt_nr_pull_skipped);
 #endif
 	P(rt_throttled);
 	PN(rt_time);
@@ -996,6 +1000,8 @@ void proc_sched_show_task(struct task_struct *p, struct pid_namespace *ns,
 		P_SCHEDSTAT(nr_wakeups_affine_attempts);
 		P_SCHEDSTAT(nr_wakeups_passive);
 		P_SCHEDSTAT(nr_wakeups_idle);
+		P_SCHEDSTAT(nr_wakeups_cache_hot);
+		P_SCHEDSTAT(nr_wakeups_llc_remote);
 
 		avg_atom = p->se.sum_exec_runtime;
 		if (nr_switches)
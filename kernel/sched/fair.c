@@ -6876,6 +6876,59 @@ static inline bool asym_fits_cpu(unsigned long util,
 	return true;
 }
 
+/*
+ * Whether @p last ran on @cpu recently enough for its working set to still be
+ * cached there, by the same measure as task_hot(). The clock of the remote rq
+ * is read without its lock, being off only makes the guess less accurate.
+ */
+static inline bool task_cache_hot_on(struct task_struct *p, int cpu)
+{
+	s64 delta;
+
+	if (sysctl_sched_migration_cost == -1)
+		return true;
+
+	if (sysctl_sched_migration_cost == 0)
+		return false;
+
+	delta = READ_ONCE(cpu_rq(cpu)->clock_task) - p->se.exec_start;
+
+	return delta < (s64)sysctl_sched_migration_cost;
+}
+
+/*
+ * Look for an idle CPU fully fitting @p among the ones sharing the LLC of
+ * @prev, @prev first. Unlike select_idle_capacity(), which walks the whole
+ * sd_asym_cpucapacity span from the waker's side, this keeps a cache hot task
+ * in its cluster whenever the cluster has room for it.
+ */
+static int select_idle_cache_hot(struct task_struct *p, int prev,
+				 unsigned long task_util,
+				 unsigned long util_min,
+				 unsigned long util_max)
+{
+	struct sched_domain *sd;
+	struct cpumask *cpus;
+	int cpu;
+
+	sd = rcu_dereference(per_cpu(sd_llc, prev));
+	if (!sd)
+		return -1;
+
+	cpus = this_cpu_cpumask_var_ptr(select_rq_mask);
+	cpumask_and(cpus, sched_domain_span(sd), p->cpus_ptr);
+
+	for_each_cpu_wrap(cpu, cpus, prev) {
+		if ((available_idle_cpu(cpu) || sched_idle_cpu(cpu)) &&
+		    asym_fits_cpu(task_util, util_min, util_max, cpu)) {
+			schedstat_inc(p->stats.nr_wakeups_cache_hot);
+			return cpu;
+		}
+	}
+
+	return -1;
+}
+
 /*
  * Try and locate an idle core/thread in the LLC cache domain.
  */
@@ -6957,6 +7010,14 @@ static int select_idle_sibling(struct task_struct *p, int prev, int target)
 		 * capacity path.
 		 */
 		if (sd) {
+			if (sched_feat(SIS_CACHE_HOT) &&
+			    task_cache_hot_on(p, prev)) {
+				i = select_idle_cache_hot(p, prev, task_util,
+							  util_min, util_max);
+				if ((unsigned)i < nr_cpumask_bits)
+					return i;
+			}
+
 			i = select_idle_capacity(p, sd, target);
 			return ((unsigned)i < nr_cpumask_bits) ? i : target;
 		}
@@ -7418,6 +7479,14 @@ static int find_energy_efficient_cpu(struct task_struct *p, int prev_cpu)
 	return target;
 }
 
+/* Account the wakeups taking @p away from the caches of @prev_cpu */
+static inline void schedstat_wakeup_placement(struct task_struct *p,
+					      int prev_cpu, int new_cpu)
+{
+	if (schedstat_enabled() && !cpus_share_cache(prev_cpu, new_cpu))
+		__schedstat_inc(p->stats.nr_wakeups_llc_remote);
+}
+
 /*
  * select_task_rq_fair: Select target runqueue for the waking task in domains
  * that have the relevant SD flag set. In practice, this is SD_BALANCE_WAKE,
@@ -7448,8 +7517,10 @@ select_task_rq_fair(struct task_struct *p, int prev_cpu, int wake_flags)
 
 		if (sched_energy_enabled()) {
 			new_cpu = find_energy_efficient_cpu(p, prev_cpu);
-			if (new_cpu >= 0)
+			if (new_cpu >= 0) {
+				schedstat_wakeup_placement(p, prev_cpu, new_cpu);
 				return new_cpu;
+			}
 			new_cpu = prev_cpu;
 		}
 
@@ -7491,6 +7562,9 @@ select_task_rq_fair(struct task_struct *p, int prev_cpu, int wake_flags)
 	}
 	rcu_read_unlock();
 
+	if (wake_flags & WF_TTWU)
+		schedstat_wakeup_placement(p, prev_cpu, new_cpu);
+
 	return new_cpu;
 }
 
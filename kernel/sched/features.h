@@ -63,6 +63,12 @@ SCHED_FEAT(TTWU_QUEUE, true)
 SCHED_FEAT(SIS_PROP, false)
 SCHED_FEAT(SIS_UTIL, true)
 
+/*
+ * On asymmetric CPU capacity systems, look for an idle CPU sharing the cache
+ * of the previous CPU first when the wakee is still cache hot there.
+ */
+SCHED_FEAT(SIS_CACHE_HOT, true)
+
 /*
  * Issue a WARN when we do multiple update_rq_clock() calls
  * in a single rq->lock section. Default disabled because the
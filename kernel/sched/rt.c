@@ -2165,6 +2165,7 @@ static int push_rt_task(struct rq *rq, bool pull)
 	set_task_cpu(next_task, lowest_rq->cpu);
 	activate_task(lowest_rq, next_task, 0);
 	resched_curr(lowest_rq);
+	rq->rt.rt_nr_pushed++;
 	ret = 1;
 
 	double_unlock_balance(rq, lowest_rq);
@@ -2311,6 +2312,7 @@ static void tell_cpu_to_push(struct rq *rq)
 		/* Make sure the rd does not get freed while pushing */
 		sched_get_rd(rq->rd);
 		irq_work_queue_on(&rq->rd->rto_push_work, cpu);
+		rq->rt.rt_nr_push_ipi++;
 	}
 }
 
@@ -2352,6 +2354,26 @@ void rto_push_irq_work_func(struct irq_work *work)
 }
 #endif /* HAVE_RT_PUSH_IPI */
 
+/*
+ * Lockless check that an overloaded CPU has a pushable task preempting
+ * what @this_rq is about to run, see the comment in pull_rt_task().
+ */
+static bool rt_pull_candidate(struct rq *this_rq)
+{
+	int cpu;
+
+	for_each_cpu(cpu, this_rq->rd->rto_mask) {
+		if (cpu == this_rq->cpu)
+			continue;
+
+		if (cpu_rq(cpu)->rt.highest_prio.next <
+		    this_rq->rt.highest_prio.curr)
+			return true;
+	}
+
+	return false;
+}
+
 static void pull_rt_task(struct rq *this_rq)
 {
 	int this_cpu = this_rq->cpu, cpu;
@@ -2376,7 +2398,15 @@ static void pull_rt_task(struct rq *this_rq)
 
 #ifdef HAVE_RT_PUSH_IPI
 	if (sched_feat(RT_PUSH_IPI)) {
-		tell_cpu_to_push(this_rq);
+		/*
+		 * The IPI interrupts every overloaded CPU in turn, which
+		 * is wasted on RT tasks running there if none of them has
+		 * anything for us.
+		 */
+		if (rt_pull_candidate(this_rq))
+			tell_cpu_to_push(this_rq);
+		else
+			this_rq->rt.rt_nr_pull_skipped++;
 		return;
 	}
 #endif
@@ -2437,6 +2467,7 @@ static void pull_rt_task(struct rq *this_rq)
 				deactivate_task(src_rq, p, 0);
 				set_task_cpu(p, this_cpu);
 				activate_task(this_rq, p, 0);
+				this_rq->rt.rt_nr_pulled++;
 				resched = true;
 			}
 			/*
@@ -678,6 +678,11 @@ struct rt_rq {
 	int			overloaded;
 	struct plist_head	pushable_tasks;
 
+	/* Migration statistics, for /sys/kernel/debug/sched/debug */
+	unsigned long		rt_nr_pushed;
+	unsigned long		rt_nr_pulled;
+	unsigned long		rt_nr_push_ipi;
+	unsigned long		rt_nr_pull_skipped;
 #endif /* CONFIG_SMP */
 	int			rt_queued;
 
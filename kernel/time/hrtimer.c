@@ -1276,6 +1276,10 @@ static int __hrtimer_start_range_ns(struct hrtimer *timer, ktime_t tim,
  * @mode:	timer mode: absolute (HRTIMER_MODE_ABS) or
  *		relative (HRTIMER_MODE_REL), and pinned (HRTIMER_MODE_PINNED);
  *		softirq based mode is considered for debug purpose only!
+ *
+ * The timer may expire anywhere between @tim and @tim + @delta_ns. Within
+ * that window it is expired by the interrupt of any other timer, so timers
+ * with close deadlines and a jitter budget share a single interrupt.
  */
 void hrtimer_start_range_ns(struct hrtimer *timer, ktime_t tim,
 			    u64 delta_ns, const enum hrtimer_mode mode)
@@ -1746,6 +1750,10 @@ static void __hrtimer_run_queues(struct hrtimer_cpu_base *cpu_base, ktime_t now,
 			if (basenow < hrtimer_get_softexpires_tv64(timer))
 				break;
 
+			/* its slack saved it an interrupt of its own */
+			if (basenow < hrtimer_get_expires_tv64(timer))
+				cpu_base->nr_grouped++;
+
 			__run_hrtimer(cpu_base, base, timer, &basenow, flags);
 			if (active_mask == HRTIMER_ACTIVE_SOFT)
 				hrtimer_sync_wait_running(cpu_base, flags);
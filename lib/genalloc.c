@@ -33,8 +33,27 @@
 #include <linux/interrupt.h>
 #include <linux/genalloc.h>
 #include <linux/of_device.h>
+#include <linux/percpu.h>
+#include <linux/timekeeping.h>
 #include <linux/vmalloc.h>
 
+#define GEN_POOL_CACHE_DEPTH	16
+
+/*
+ * Per-CPU cache of free objects of pool->cache_size bytes, filled by the
+ * frees and emptied by the allocations of that size, which then don't scan
+ * the chunk bitmaps.  Only accessed with interrupts disabled on its CPU.
+ */
+struct gen_pool_cache {
+	unsigned int nr;
+	unsigned long objs[GEN_POOL_CACHE_DEPTH];
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long overflows;
+	u64 scan_ns;
+	u64 scan_max_ns;
+};
+
 static inline size_t chunk_size(const struct gen_pool_chunk *chunk)
 {
 	return chunk->end_addr - chunk->start_addr + 1;
@@ -162,6 +181,8 @@ struct gen_pool *gen_pool_create(int min_alloc_order, int nid)
 		pool->algo = gen_pool_first_fit;
 		pool->data = NULL;
 		pool->name = NULL;
+		pool->cache = NULL;
+		pool->cache_size = 0;
 	}
 	return pool;
 }
@@ -232,6 +253,82 @@ phys_addr_t gen_pool_virt_to_phys(struct gen_pool *pool, unsigned long addr)
 }
 EXPORT_SYMBOL(gen_pool_virt_to_phys);
 
+static bool gen_pool_cacheable(struct gen_pool *pool, size_t size,
+		void **owner)
+{
+	return pool->cache && !owner && !in_nmi() &&
+	       ALIGN(size, 1UL << pool->min_alloc_order) == pool->cache_size;
+}
+
+static unsigned long gen_pool_cache_get(struct gen_pool *pool)
+{
+	struct gen_pool_cache *cache;
+	unsigned long flags, addr = 0;
+
+	local_irq_save(flags);
+	cache = this_cpu_ptr(pool->cache);
+	if (cache->nr) {
+		addr = cache->objs[--cache->nr];
+		cache->hits++;
+	}
+	local_irq_restore(flags);
+
+	return addr;
+}
+
+static bool gen_pool_cache_put(struct gen_pool *pool, unsigned long addr)
+{
+	struct gen_pool_cache *cache;
+	unsigned long flags;
+	bool cached = true;
+
+	local_irq_save(flags);
+	cache = this_cpu_ptr(pool->cache);
+	if (cache->nr < GEN_POOL_CACHE_DEPTH) {
+		cache->objs[cache->nr++] = addr;
+	} else {
+		cache->overflows++;
+		cached = false;
+	}
+	local_irq_restore(flags);
+
+	return cached;
+}
+
+static void gen_pool_cache_miss(struct gen_pool *pool, u64 ns)
+{
+	struct gen_pool_cache *cache;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	cache = this_cpu_ptr(pool->cache);
+	cache->misses++;
+	cache->scan_ns += ns;
+	if (ns > cache->scan_max_ns)
+		cache->scan_max_ns = ns;
+	local_irq_restore(flags);
+}
+
+/* Give the cached objects back to the bitmaps and stop caching. */
+static void gen_pool_cache_drain(struct gen_pool *pool)
+{
+	struct gen_pool_cache __percpu *pcache = pool->cache;
+	struct gen_pool_cache *cache;
+	int cpu;
+
+	if (!pcache)
+		return;
+
+	pool->cache = NULL;
+	for_each_possible_cpu(cpu) {
+		cache = per_cpu_ptr(pcache, cpu);
+		while (cache->nr)
+			gen_pool_free(pool, cache->objs[--cache->nr],
+				      pool->cache_size);
+	}
+	free_percpu(pcache);
+}
+
 /**
  * gen_pool_destroy - destroy a special memory pool
  * @pool: pool to destroy
@@ -246,6 +343,8 @@ void gen_pool_destroy(struct gen_pool *pool)
 	int order = pool->min_alloc_order;
 	unsigned long bit, end_bit;
 
+	gen_pool_cache_drain(pool);
+
 	list_for_each_safe(_chunk, _next_chunk, &pool->chunks) {
 		chunk = list_entry(_chunk, struct gen_pool_chunk, next_chunk);
 		list_del(&chunk->next_chunk);
@@ -271,6 +370,8 @@ EXPORT_SYMBOL(gen_pool_destroy);
  *
  * Allocate the requested number of bytes from the specified pool.
  * Uses the pool allocation function (with first-fit algorithm by default).
+ * Allocations of the size cached by gen_pool_enable_cache() using the pool
+ * algorithm are served from the cache of the CPU when it isn't empty.
  * Can not be used in NMI handler on architectures without
  * NMI-safe cmpxchg implementation.
  */
@@ -281,6 +382,8 @@ unsigned long gen_pool_alloc_algo_owner(struct gen_pool *pool, size_t size,
 	unsigned long addr = 0;
 	int order = pool->min_alloc_order;
 	unsigned long nbits, start_bit, end_bit, remain;
+	bool cacheable;
+	u64 start = 0;
 
 #ifndef CONFIG_ARCH_HAVE_NMI_SAFE_CMPXCHG
 	BUG_ON(in_nmi());
@@ -292,6 +395,15 @@ unsigned long gen_pool_alloc_algo_owner(struct gen_pool *pool, size_t size,
 	if (size == 0)
 		return 0;
 
+	cacheable = gen_pool_cacheable(pool, size, owner) &&
+		    algo == pool->algo && data == pool->data;
+	if (cacheable) {
+		addr = gen_pool_cache_get(pool);
+		if (addr)
+			return addr;
+		start = ktime_get_ns();
+	}
+
 	nbits = (size + (1UL << order) - 1) >> order;
 	rcu_read_lock();
 	list_for_each_entry_rcu(chunk, &pool->chunks, next_chunk) {
@@ -321,6 +433,10 @@ unsigned long gen_pool_alloc_algo_owner(struct gen_pool *pool, size_t size,
 		break;
 	}
 	rcu_read_unlock();
+
+	if (cacheable)
+		gen_pool_cache_miss(pool, ktime_get_ns() - start);
+
 	return addr;
 }
 EXPORT_SYMBOL(gen_pool_alloc_algo_owner);
@@ -481,8 +597,9 @@ EXPORT_SYMBOL(gen_pool_dma_zalloc_align);
  * @owner: private data stashed at gen_pool_add() time
  *
  * Free previously allocated special memory back to the specified
- * pool.  Can not be used in NMI handler on architectures without
- * NMI-safe cmpxchg implementation.
+ * pool.  Objects of the size cached by gen_pool_enable_cache() are kept
+ * in the cache of the CPU as long as it has room.  Can not be used in NMI
+ * handler on architectures without NMI-safe cmpxchg implementation.
  */
 void gen_pool_free_owner(struct gen_pool *pool, unsigned long addr, size_t size,
 		void **owner)
@@ -498,6 +615,10 @@ void gen_pool_free_owner(struct gen_pool *pool, unsigned long addr, size_t size,
 	if (owner)
 		*owner = NULL;
 
+	if (gen_pool_cacheable(pool, size, owner) &&
+	    gen_pool_cache_put(pool, addr))
+		return;
+
 	nbits = (size + (1UL << order) - 1) >> order;
 	rcu_read_lock();
 	list_for_each_entry_rcu(chunk, &pool->chunks, next_chunk) {
@@ -609,6 +730,93 @@ size_t gen_pool_size(struct gen_pool *pool)
 }
 EXPORT_SYMBOL_GPL(gen_pool_size);
 
+/**
+ * gen_pool_enable_cache - cache the free objects of a size per CPU
+ * @pool: pool to cache the objects of
+ * @size: size in bytes of the cached objects
+ *
+ * Keep up to GEN_POOL_CACHE_DEPTH freed objects of @size bytes per CPU and
+ * serve the allocations of that size using the pool algorithm from them,
+ * for pools mostly handing out small objects of a single size such as DMA
+ * descriptors.  The cached objects remain allocated in the chunk bitmaps,
+ * so gen_pool_avail() doesn't count them.  Allocations and frees in NMI
+ * context bypass the cache.
+ *
+ * Must be called before the pool is shared.
+ *
+ * Returns 0 on success or a -ve errno on failure.
+ */
+int gen_pool_enable_cache(struct gen_pool *pool, size_t size)
+{
+	if (!size || pool->cache)
+		return -EINVAL;
+
+	pool->cache = alloc_percpu(struct gen_pool_cache);
+	if (!pool->cache)
+		return -ENOMEM;
+	pool->cache_size = ALIGN(size, 1UL << pool->min_alloc_order);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(gen_pool_enable_cache);
+
+static size_t chunk_largest_free(struct gen_pool_chunk *chunk, int order)
+{
+	unsigned long bit, next, end_bit = chunk_size(chunk) >> order;
+	unsigned long largest = 0;
+
+	for (bit = find_first_zero_bit(chunk->bits, end_bit); bit < end_bit;
+	     bit = find_next_zero_bit(chunk->bits, end_bit, next)) {
+		next = find_next_bit(chunk->bits, end_bit, bit);
+		largest = max(largest, next - bit);
+	}
+
+	return largest << order;
+}
+
+/**
+ * gen_pool_get_stats - get the allocation statistics of the pool
+ * @pool: pool to get the statistics of
+ * @stats: statistics return value
+ *
+ * Fill @stats with a snapshot of the free space of the pool and, when it
+ * has a cache enabled, of the cache statistics.  A largest free range much
+ * smaller than the free space tells the pool is fragmented, the scan times
+ * of the cache misses what the allocations not served by a cache cost.
+ * Scans the chunk bitmaps, so not meant for a hot path.
+ */
+void gen_pool_get_stats(struct gen_pool *pool, struct gen_pool_stats *stats)
+{
+	struct gen_pool_cache *cache;
+	struct gen_pool_chunk *chunk;
+	int cpu;
+
+	memset(stats, 0, sizeof(*stats));
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(chunk, &pool->chunks, next_chunk) {
+		stats->avail += atomic_long_read(&chunk->avail);
+		stats->largest_free = max(stats->largest_free,
+			chunk_largest_free(chunk, pool->min_alloc_order));
+	}
+	rcu_read_unlock();
+
+	if (!pool->cache)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		cache = per_cpu_ptr(pool->cache, cpu);
+		stats->cached += READ_ONCE(cache->nr) * pool->cache_size;
+		stats->hits += READ_ONCE(cache->hits);
+		stats->misses += READ_ONCE(cache->misses);
+		stats->overflows += READ_ONCE(cache->overflows);
+		stats->scan_ns += READ_ONCE(cache->scan_ns);
+		stats->scan_max_ns = max(stats->scan_max_ns,
+					 READ_ONCE(cache->scan_max_ns));
+	}
+}
+EXPORT_SYMBOL_GPL(gen_pool_get_stats);
+
 /**
  * gen_pool_set_algo - set the allocation algorithm
  * @pool: pool to change allocation algorithm
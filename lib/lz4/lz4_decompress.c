@@ -40,6 +40,13 @@
 #include <linux/kernel.h>
 #include <asm/unaligned.h>
 
+#if defined(CONFIG_KERNEL_MODE_NEON) && !defined(PREBOOT) && \
+	!defined(LZ4_DECOMPRESS_NEON)
+#define LZ4_NEON
+#include <asm/neon.h>
+#include <asm/simd.h>
+#endif
+
 /*-*****************************
  *	Decompression functions
  *******************************/
@@ -457,9 +464,64 @@ static FORCE_INLINE int LZ4_decompress_generic(
 	return (int) (-(((const char *)ip) - src)) - 1;
 }
 
+#ifdef LZ4_DECOMPRESS_NEON
+/*
+ * Built again by lz4_decompress_neon.c, which only needs the decoder above:
+ * the rest of this file is the generic build.
+ */
+#else
+
+#ifdef LZ4_NEON
+/*
+ * Saving the FPSIMD state costs more than the 16 byte copies win on small
+ * blocks, while a large one would keep preemption disabled for too long.
+ */
+#define LZ4_NEON_MIN_SIZE	1024
+#define LZ4_NEON_MAX_SIZE	(128 * KB)
+
+static bool neon = true;
+module_param(neon, bool, 0644);
+MODULE_PARM_DESC(neon, "Use NEON to decompress blocks (default: true)");
+
+static bool LZ4_use_neon(int dstCapacity)
+{
+	return READ_ONCE(neon) && dstCapacity >= LZ4_NEON_MIN_SIZE &&
+	       dstCapacity <= LZ4_NEON_MAX_SIZE && cpu_has_neon() &&
+	       may_use_simd();
+}
+
+static int LZ4_decompress_safe_simd(const char *src, char *dst,
+	int compressedSize, int dstCapacity, bool partial)
+{
+	int ret;
+
+	kernel_neon_begin();
+	ret = LZ4_decompress_neon(src, dst, compressedSize, dstCapacity,
+				  partial);
+	kernel_neon_end();
+
+	return ret;
+}
+#else
+static inline bool LZ4_use_neon(int dstCapacity)
+{
+	return false;
+}
+
+static inline int LZ4_decompress_safe_simd(const char *src, char *dst,
+	int compressedSize, int dstCapacity, bool partial)
+{
+	return -1;
+}
+#endif
+
 int LZ4_decompress_safe(const char *source, char *dest,
 	int compressedSize, int maxDecompressedSize)
 {
+	if (LZ4_use_neon(maxDecompressedSize))
+		return LZ4_decompress_safe_simd(source, dest, compressedSize,
+						maxDecompressedSize, false);
+
 	return LZ4_decompress_generic(source, dest,
 				      compressedSize, maxDecompressedSize,
 				      endOnInputSize, decode_full_block,
@@ -470,6 +532,10 @@ int LZ4_decompress_safe_partial(const char *src, char *dst,
 	int compressedSize, int targetOutputSize, int dstCapacity)
 {
 	dstCapacity = min(targetOutputSize, dstCapacity);
+	if (LZ4_use_neon(dstCapacity))
+		return LZ4_decompress_safe_simd(src, dst, compressedSize,
+						dstCapacity, true);
+
 	return LZ4_decompress_generic(src, dst, compressedSize, dstCapacity,
 				      endOnInputSize, partial_decode,
 				      noDict, (BYTE *)dst, NULL, 0);
@@ -718,3 +784,5 @@ EXPORT_SYMBOL(LZ4_decompress_fast_usingDict);
 MODULE_LICENSE("Dual BSD/GPL");
 MODULE_DESCRIPTION("LZ4 decompressor");
 #endif
+
+#endif /* LZ4_DECOMPRESS_NEON */
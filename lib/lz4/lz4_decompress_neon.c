@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * LZ4 decompression using NEON for the wild copies
+ *
+ * The decoder of lz4_decompress.c, built again with its literal and match
+ * copies done 16 bytes at a time.  The overrun past the end of a copy stays
+ * below WILDCOPYLENGTH, so the bounds checks of the decoder still hold.
+ *
+ * Only called by lz4_decompress.c, between kernel_neon_begin() and
+ * kernel_neon_end().
+ */
+
+#ifdef CONFIG_ARM64
+#include <asm/neon-intrinsics.h>
+#else
+#include <arm_neon.h>
+#endif
+
+#include "lz4defs.h"
+
+static FORCE_INLINE void LZ4_wildCopy_neon(void *dstPtr,
+	const void *srcPtr, void *dstEnd)
+{
+	BYTE *d = (BYTE *)dstPtr;
+	const BYTE *s = (const BYTE *)srcPtr;
+	BYTE *const e = (BYTE *)dstEnd;
+
+	/*
+	 * A match less than 16 bytes behind would load what the previous
+	 * store has not written yet.  Copying forward to an earlier address,
+	 * as in-place decompression does with the literals, is fine.
+	 */
+	if ((uptrval)d - (uptrval)s >= 16) {
+		while (e - d >= 16) {
+			vst1q_u8(d, vld1q_u8(s));
+			d += 16;
+			s += 16;
+		}
+	}
+
+	while (d < e) {
+		LZ4_copy8(d, s);
+		d += 8;
+		s += 8;
+	}
+}
+
+#define LZ4_wildCopy	LZ4_wildCopy_neon
+#define LZ4_DECOMPRESS_NEON
+#include "lz4_decompress.c"
+
+int LZ4_decompress_neon(const char *src, char *dst, int compressedSize,
+	int dstCapacity, bool partial)
+{
+	if (partial)
+		return LZ4_decompress_generic(src, dst, compressedSize,
+					      dstCapacity, endOnInputSize,
+					      partial_decode, noDict,
+					      (BYTE *)dst, NULL, 0);
+
+	return LZ4_decompress_generic(src, dst, compressedSize, dstCapacity,
+				      endOnInputSize, decode_full_block,
+				      noDict, (BYTE *)dst, NULL, 0);
+}
+EXPORT_SYMBOL(LZ4_decompress_neon);
+
+MODULE_LICENSE("Dual BSD/GPL");
+MODULE_DESCRIPTION("LZ4 decompressor, NEON copies");
@@ -244,4 +244,8 @@ typedef enum { decode_full_block = 0, partial_decode = 1 } earlyEnd_directive;
 
 #define LZ4_STATIC_ASSERT(c)	BUILD_BUG_ON(!(c))
 
+/* lz4_decompress_neon.c, to call between kernel_neon_begin() and _end() */
+int LZ4_decompress_neon(const char *src, char *dst, int compressedSize,
+	int dstCapacity, bool partial);
+
 #endif
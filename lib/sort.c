@@ -14,6 +14,8 @@
 
 #include <linux/types.h>
 #include <linux/export.h>
+#include <linux/math64.h>
+#include <linux/minmax.h>
 #include <linux/sort.h>
 
 /**
@@ -290,3 +292,38 @@ void sort(void *base, size_t num, size_t size,
 	return sort_r(base, num, size, _CMP_WRAPPER, SWAP_WRAPPER, &w);
 }
 EXPORT_SYMBOL(sort);
+
+static int cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/**
+ * sort_u64 - sort an array of u64 in ascending order
+ * @base: pointer to data to sort
+ * @num: number of elements
+ *
+ * Meant for samples, such as the latencies measured by a benchmark, which
+ * are then read with sorted_percentile_u64().
+ */
+void sort_u64(u64 *base, size_t num)
+{
+	sort(base, num, sizeof(*base), cmp_u64, NULL);
+}
+EXPORT_SYMBOL(sort_u64);
+
+/**
+ * sorted_percentile_u64 - value at a percentile of sorted samples
+ * @sorted: samples sorted by sort_u64()
+ * @num: number of samples, at least one
+ * @permille: the percentile in thousandths, 0 for the minimum and 1000 for
+ *	the maximum
+ */
+u64 sorted_percentile_u64(const u64 *sorted, size_t num,
+			  unsigned int permille)
+{
+	return sorted[div_u64((u64)(num - 1) * min(permille, 1000U), 1000)];
+}
+EXPORT_SYMBOL(sorted_percentile_u64);
@@ -0,0 +1,171 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Test cases and benchmark of the LZ4 decompressor.
+ *
+ * Blocks mixing literals with matches at every offset range are compressed
+ * and decompressed back, fully and partially.  The decompression throughput
+ * is then printed, so the copies of an architecture, such as the NEON ones
+ * turned off by lz4_decompress.neon=0, can be compared with the generic
+ * code.
+ */
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/lz4.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/sizes.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+static unsigned int iterations = 100;
+module_param(iterations, uint, 0444);
+MODULE_PARM_DESC(iterations, "Number of decompressions timed per block size");
+
+static const unsigned int block_sizes[] __initconst = {
+	512, 1024, 4096, 16384, 65536, 131072,
+};
+
+#define TEST_LZ4_MAX_SIZE	131072
+
+static unsigned int total_tests __initdata;
+static unsigned int failed_tests __initdata;
+
+/* literals and overlapping matches, from 1 byte to a few KiB behind */
+static void __init test_lz4_fill(u8 *buf, unsigned int size)
+{
+	unsigned int i = 0, len, offset;
+
+	while (i < size) {
+		len = min(prandom_u32_max(16), size - i);
+		get_random_bytes(buf + i, len);
+		i += len;
+
+		if (!i)
+			continue;
+
+		switch (prandom_u32_max(3)) {
+		case 0:
+			offset = prandom_u32_max(16) + 1;
+			break;
+		case 1:
+			offset = prandom_u32_max(256) + 1;
+			break;
+		default:
+			offset = prandom_u32_max(4096) + 1;
+			break;
+		}
+		offset = min(offset, i);
+
+		for (len = min(prandom_u32_max(128) + 4, size - i); len; len--) {
+			buf[i] = buf[i - offset];
+			i++;
+		}
+	}
+}
+
+static void __init test_lz4_check(const char *what, unsigned int size,
+				  int ret, int expected, const u8 *out,
+				  const u8 *ref)
+{
+	total_tests++;
+
+	if (ret != expected || memcmp(out, ref, expected)) {
+		pr_err("%s of %u bytes failed: returned %d, expected %d\n",
+		       what, size, ret, expected);
+		failed_tests++;
+	}
+}
+
+static void __init test_lz4_size(unsigned int size, u8 *src, u8 *comp,
+				 u8 *out, void *wrkmem)
+{
+	unsigned int partial = size / 2 + prandom_u32_max(size / 2);
+	int clen, ret;
+	u64 start, ns, i;
+
+	test_lz4_fill(src, size);
+
+	clen = LZ4_compress_default(src, comp, size, LZ4_compressBound(size),
+				    wrkmem);
+	if (clen <= 0) {
+		pr_err("compression of %u bytes failed\n", size);
+		failed_tests++;
+		return;
+	}
+
+	memset(out, 0, size);
+	ret = LZ4_decompress_safe(comp, out, clen, size);
+	test_lz4_check("decompression", size, ret, size, out, src);
+
+	memset(out, 0, size);
+	ret = LZ4_decompress_safe_partial(comp, out, clen, partial, size);
+	test_lz4_check("partial decompression", size, ret, partial, out, src);
+
+	/* an output buffer too short must be caught, not overrun */
+	total_tests++;
+	if (LZ4_decompress_safe(comp, out, clen, size - 1) >= 0) {
+		pr_err("decompression of %u bytes to %u bytes succeeded\n",
+		       size, size - 1);
+		failed_tests++;
+	}
+
+	if (!iterations)
+		return;
+
+	start = ktime_get_ns();
+	for (i = 0; i < iterations; i++)
+		LZ4_decompress_safe(comp, out, clen, size);
+	ns = ktime_get_ns() - start;
+
+	pr_info("%6u bytes (ratio %3u%%): %llu MB/s\n", size, clen * 100 / size,
+		div64_u64((u64)size * iterations * NSEC_PER_SEC,
+			  max_t(u64, ns, 1) * SZ_1M));
+}
+
+static int __init test_lz4_init(void)
+{
+	u8 *src, *comp, *out;
+	void *wrkmem;
+	int i;
+
+	src = vmalloc(TEST_LZ4_MAX_SIZE);
+	comp = vmalloc(LZ4_compressBound(TEST_LZ4_MAX_SIZE));
+	out = vmalloc(TEST_LZ4_MAX_SIZE);
+	wrkmem = vmalloc(LZ4_MEM_COMPRESS);
+	if (!src || !comp || !out || !wrkmem) {
+		vfree(wrkmem);
+		vfree(out);
+		vfree(comp);
+		vfree(src);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(block_sizes); i++)
+		test_lz4_size(block_sizes[i], src, comp, out, wrkmem);
+
+	vfree(wrkmem);
+	vfree(out);
+	vfree(comp);
+	vfree(src);
+
+	if (failed_tests == 0)
+		pr_info("all %u tests passed\n", total_tests);
+	else
+		pr_err("failed %u out of %u tests\n", failed_tests, total_tests);
+
+	return failed_tests ? -EINVAL : 0;
+}
+module_init(test_lz4_init);
+
+static void __exit test_lz4_exit(void)
+{
+	/* do nothing */
+}
+module_exit(test_lz4_exit);
+
+MODULE_DESCRIPTION("LZ4 decompressor test and benchmark");
+MODULE_LICENSE("GPL");
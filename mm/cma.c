@@ -31,6 +31,7 @@
 #include <linux/highmem.h>
 #include <linux/io.h>
 #include <linux/kmemleak.h>
+#include <linux/workqueue.h>
 #include <trace/events/cma.h>
 
 #include "cma.h"
@@ -120,6 +121,7 @@ static void __init cma_activate_area(struct cma *cma)
 		init_cma_reserved_pageblock(pfn_to_page(pfn));
 
 	spin_lock_init(&cma->lock);
+	INIT_WORK(&cma->ready_work, cma_ready_work);
 
 #ifdef CONFIG_CMA_DEBUGFS
 	INIT_HLIST_HEAD(&cma->mem_head);
@@ -411,38 +413,15 @@ static void cma_debug_show_areas(struct cma *cma)
 static inline void cma_debug_show_areas(struct cma *cma) { }
 #endif
 
-/**
- * cma_alloc() - allocate pages from contiguous area
- * @cma:   Contiguous memory region for which the allocation is performed.
- * @count: Requested number of pages.
- * @align: Requested alignment of pages (in PAGE_SIZE order).
- * @no_warn: Avoid printing message about failed allocation
- *
- * This function allocates part of contiguous memory on specific
- * contiguous memory area.
- */
-struct page *cma_alloc(struct cma *cma, unsigned long count,
-		       unsigned int align, bool no_warn)
+static int __cma_alloc(struct cma *cma, unsigned long count,
+		       unsigned int align, gfp_t gfp, unsigned long *pfnp)
 {
 	unsigned long mask, offset;
 	unsigned long pfn = -1;
 	unsigned long start = 0;
 	unsigned long bitmap_maxno, bitmap_no, bitmap_count;
-	unsigned long i;
-	struct page *page = NULL;
 	int ret = -ENOMEM;
 
-	if (!cma || !cma->count || !cma->bitmap)
-		goto out;
-
-	pr_debug("%s(cma %p, count %lu, align %d)\n", __func__, (void *)cma,
-		 count, align);
-
-	if (!count)
-		goto out;
-
-	trace_cma_alloc_start(cma->name, count, align);
-
 	mask = cma_bitmap_aligned_mask(cma, align);
 	offset = cma_bitmap_aligned_offset(cma, align);
 	bitmap_maxno = cma_bitmap_maxno(cma);
@@ -470,13 +449,10 @@ struct page *cma_alloc(struct cma *cma, unsigned long count,
 
 		pfn = cma->base_pfn + (bitmap_no << cma->order_per_bit);
 		mutex_lock(&cma_mutex);
-		ret = alloc_contig_range(pfn, pfn + count, MIGRATE_CMA,
-				     GFP_KERNEL | (no_warn ? __GFP_NOWARN : 0));
+		ret = alloc_contig_range(pfn, pfn + count, MIGRATE_CMA, gfp);
 		mutex_unlock(&cma_mutex);
-		if (ret == 0) {
-			page = pfn_to_page(pfn);
+		if (ret == 0)
 			break;
-		}
 
 		cma_clear_bitmap(cma, pfn, count);
 		if (ret != -EBUSY)
@@ -490,6 +466,181 @@ struct page *cma_alloc(struct cma *cma, unsigned long count,
 		/* try again with a bit different memory target */
 		start = bitmap_no + mask + 1;
 	}
+out:
+	*pfnp = pfn;
+	return ret;
+}
+
+/*
+ * Serve an allocation from one of the chunks kept ready by cma_ready_work(),
+ * giving the part of the chunk not needed back to the area.
+ */
+static struct page *cma_take_ready(struct cma *cma, unsigned long count,
+				   unsigned int align)
+{
+	unsigned long pfn = 0, nr_pages = 0, keep;
+	unsigned int i;
+
+	if (!READ_ONCE(cma->nr_ready))
+		return NULL;
+
+	spin_lock_irq(&cma->lock);
+	for (i = 0; i < cma->nr_ready; i++) {
+		if (count <= (1UL << cma->ready[i].order) &&
+		    align <= cma->ready[i].order) {
+			pfn = cma->ready[i].pfn;
+			nr_pages = 1UL << cma->ready[i].order;
+			cma->ready[i] = cma->ready[--cma->nr_ready];
+			break;
+		}
+	}
+	spin_unlock_irq(&cma->lock);
+
+	if (!nr_pages)
+		return NULL;
+
+	queue_work(system_unbound_wq, &cma->ready_work);
+
+	/* the bitmap is only cleared in whole bits, as cma_release() does */
+	keep = ALIGN(count, 1UL << cma->order_per_bit);
+	if (count < nr_pages)
+		free_contig_range(pfn + count, nr_pages - count);
+	if (keep < nr_pages)
+		cma_clear_bitmap(cma, pfn + keep, nr_pages - keep);
+
+	cma_sysfs_account_ready_hit(cma);
+
+	return pfn_to_page(pfn);
+}
+
+static void cma_ready_work(struct work_struct *work)
+{
+	struct cma *cma = container_of(work, struct cma, ready_work);
+	struct cma_ready_chunk chunk;
+	unsigned int i, order;
+	unsigned long pfn;
+	bool stale, stored;
+
+	for (;;) {
+		stale = false;
+
+		spin_lock_irq(&cma->lock);
+		order = cma->ready_order;
+		for (i = 0; i < cma->nr_ready; i++) {
+			if (cma->ready[i].order != order ||
+			    cma->nr_ready > cma->ready_target) {
+				chunk = cma->ready[i];
+				cma->ready[i] = cma->ready[--cma->nr_ready];
+				stale = true;
+				break;
+			}
+		}
+		spin_unlock_irq(&cma->lock);
+
+		if (stale) {
+			free_contig_range(chunk.pfn, 1UL << chunk.order);
+			cma_clear_bitmap(cma, chunk.pfn, 1UL << chunk.order);
+			continue;
+		}
+
+		if (READ_ONCE(cma->nr_ready) >= READ_ONCE(cma->ready_target))
+			break;
+
+		/*
+		 * Doing the migration here rather than in cma_alloc() is the
+		 * whole point.  When nothing is left to carve a chunk from,
+		 * try again once a chunk gets used or the area is retuned.
+		 */
+		if (__cma_alloc(cma, 1UL << order, order,
+				GFP_KERNEL | __GFP_NOWARN, &pfn))
+			break;
+
+		spin_lock_irq(&cma->lock);
+		stored = cma->nr_ready < cma->ready_target &&
+			 order == cma->ready_order;
+		if (stored) {
+			cma->ready[cma->nr_ready].pfn = pfn;
+			cma->ready[cma->nr_ready].order = order;
+			cma->nr_ready++;
+		}
+		spin_unlock_irq(&cma->lock);
+
+		if (!stored) {
+			free_contig_range(pfn, 1UL << order);
+			cma_clear_bitmap(cma, pfn, 1UL << order);
+		}
+	}
+}
+
+/**
+ * cma_set_ready() - configure the chunks kept ready in an area
+ * @cma:   Contiguous memory region being tuned.
+ * @nr:    Number of chunks to keep, up to CMA_READY_MAX.
+ * @order: Order of the chunks.
+ *
+ * The chunks are allocated in the background, so that cma_alloc() requests
+ * they can hold don't wait for the pages to be migrated out of the area.
+ * They are not available to the page allocator in the meantime.
+ */
+int cma_set_ready(struct cma *cma, unsigned int nr, unsigned int order)
+{
+	if (!cma->count || nr > CMA_READY_MAX || order >= BITS_PER_LONG ||
+	    (1UL << order) > cma->count)
+		return -EINVAL;
+
+	spin_lock_irq(&cma->lock);
+	cma->ready_target = nr;
+	cma->ready_order = order;
+	spin_unlock_irq(&cma->lock);
+
+	queue_work(system_unbound_wq, &cma->ready_work);
+
+	return 0;
+}
+
+/**
+ * cma_alloc() - allocate pages from contiguous area
+ * @cma:   Contiguous memory region for which the allocation is performed.
+ * @count: Requested number of pages.
+ * @align: Requested alignment of pages (in PAGE_SIZE order).
+ * @no_warn: Avoid printing message about failed allocation
+ *
+ * This function allocates part of contiguous memory on specific
+ * contiguous memory area.
+ */
+struct page *cma_alloc(struct cma *cma, unsigned long count,
+		       unsigned int align, bool no_warn)
+{
+	unsigned long pfn = -1;
+	unsigned long i;
+	struct page *page = NULL;
+	ktime_t start;
+	int ret = -ENOMEM;
+
+	if (!cma || !cma->count || !cma->bitmap)
+		goto out;
+
+	pr_debug("%s(cma %p, count %lu, align %d)\n", __func__, (void *)cma,
+		 count, align);
+
+	if (!count)
+		goto out;
+
+	trace_cma_alloc_start(cma->name, count, align);
+
+	start = ktime_get();
+	page = cma_take_ready(cma, count, align);
+	if (page) {
+		pfn = page_to_pfn(page);
+		ret = 0;
+	} else {
+		ret = __cma_alloc(cma, count, align,
+				  GFP_KERNEL | (no_warn ? __GFP_NOWARN : 0),
+				  &pfn);
+		if (ret == 0)
+			page = pfn_to_page(pfn);
+	}
+	cma_sysfs_account_latency(cma, ktime_sub(ktime_get(), start));
 
 	trace_cma_alloc_finish(cma->name, pfn, page, count, align);
 
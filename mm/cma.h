@@ -4,12 +4,23 @@
 
 #include <linux/debugfs.h>
 #include <linux/kobject.h>
+#include <linux/ktime.h>
+#include <linux/workqueue.h>
 
 struct cma_kobject {
 	struct kobject kobj;
 	struct cma *cma;
 };
 
+#define CMA_READY_MAX		8
+#define CMA_LATENCY_BUCKETS	20
+
+/* a chunk allocated in the background for cma_alloc() to hand out */
+struct cma_ready_chunk {
+	unsigned long pfn;
+	unsigned int order;
+};
+
 struct cma {
 	unsigned long   base_pfn;
 	unsigned long   count;
@@ -22,11 +33,23 @@ struct cma {
 	struct debugfs_u32_array dfs_bitmap;
 #endif
 	char name[CMA_MAX_NAME];
+	/* chunks kept ready by ready_work, protected by lock */
+	struct cma_ready_chunk ready[CMA_READY_MAX];
+	unsigned int nr_ready;
+	unsigned int ready_target;
+	unsigned int ready_order;
+	struct work_struct ready_work;
 #ifdef CONFIG_CMA_SYSFS
 	/* the number of CMA page successful allocations */
 	atomic64_t nr_pages_succeeded;
 	/* the number of CMA page allocation failures */
 	atomic64_t nr_pages_failed;
+	/* the number of allocations served from a ready chunk */
+	atomic64_t nr_ready_hits;
+	/* allocation latencies, in log2 buckets of microseconds */
+	atomic64_t alloc_latency[CMA_LATENCY_BUCKETS];
+	/* the longest allocation latency, in nanoseconds */
+	atomic64_t alloc_latency_max;
 	/* kobject requires dynamic object */
 	struct cma_kobject *cma_kobj;
 #endif
@@ -41,13 +64,20 @@ static inline unsigned long cma_bitmap_maxno(struct cma *cma)
 	return cma->count >> cma->order_per_bit;
 }
 
+int cma_set_ready(struct cma *cma, unsigned int nr, unsigned int order);
+
 #ifdef CONFIG_CMA_SYSFS
 void cma_sysfs_account_success_pages(struct cma *cma, unsigned long nr_pages);
 void cma_sysfs_account_fail_pages(struct cma *cma, unsigned long nr_pages);
+void cma_sysfs_account_ready_hit(struct cma *cma);
+void cma_sysfs_account_latency(struct cma *cma, ktime_t latency);
 #else
 static inline void cma_sysfs_account_success_pages(struct cma *cma,
 						   unsigned long nr_pages) {};
 static inline void cma_sysfs_account_fail_pages(struct cma *cma,
 						unsigned long nr_pages) {};
+static inline void cma_sysfs_account_ready_hit(struct cma *cma) {};
+static inline void cma_sysfs_account_latency(struct cma *cma,
+					     ktime_t latency) {};
 #endif
 #endif
@@ -13,6 +13,8 @@
 
 #define CMA_ATTR_RO(_name) \
 	static struct kobj_attribute _name##_attr = __ATTR_RO(_name)
+#define CMA_ATTR_RW(_name) \
+	static struct kobj_attribute _name##_attr = __ATTR_RW(_name)
 
 void cma_sysfs_account_success_pages(struct cma *cma, unsigned long nr_pages)
 {
@@ -24,6 +26,31 @@ void cma_sysfs_account_fail_pages(struct cma *cma, unsigned long nr_pages)
 	atomic64_add(nr_pages, &cma->nr_pages_failed);
 }
 
+void cma_sysfs_account_ready_hit(struct cma *cma)
+{
+	atomic64_inc(&cma->nr_ready_hits);
+}
+
+void cma_sysfs_account_latency(struct cma *cma, ktime_t latency)
+{
+	u64 ns = ktime_to_ns(latency);
+	unsigned int bucket;
+	s64 max;
+
+	bucket = min_t(unsigned int, fls64(div_u64(ns, NSEC_PER_USEC)),
+		       CMA_LATENCY_BUCKETS - 1);
+	atomic64_inc(&cma->alloc_latency[bucket]);
+
+	max = atomic64_read(&cma->alloc_latency_max);
+	while (ns > max) {
+		s64 old = atomic64_cmpxchg(&cma->alloc_latency_max, max, ns);
+
+		if (old == max)
+			break;
+		max = old;
+	}
+}
+
 static inline struct cma *cma_from_kobj(struct kobject *kobj)
 {
 	return container_of(kobj, struct cma_kobject, kobj)->cma;
@@ -48,6 +75,92 @@ static ssize_t alloc_pages_fail_show(struct kobject *kobj,
 }
 CMA_ATTR_RO(alloc_pages_fail);
 
+/*
+ * One line per bucket: the upper bound of the bucket in microseconds and the
+ * number of allocations that took less than that, the last bucket counting
+ * everything slower.
+ */
+static ssize_t alloc_latency_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	struct cma *cma = cma_from_kobj(kobj);
+	int i, len = 0;
+
+	for (i = 0; i < CMA_LATENCY_BUCKETS - 1; i++)
+		len += sysfs_emit_at(buf, len, "%lu %llu\n", 1UL << i,
+				     atomic64_read(&cma->alloc_latency[i]));
+	len += sysfs_emit_at(buf, len, "inf %llu\n",
+			     atomic64_read(&cma->alloc_latency[i]));
+	len += sysfs_emit_at(buf, len, "max %llu\n",
+			     div_u64(atomic64_read(&cma->alloc_latency_max),
+				     NSEC_PER_USEC));
+
+	return len;
+}
+CMA_ATTR_RO(alloc_latency);
+
+static ssize_t ready_hits_show(struct kobject *kobj,
+			       struct kobj_attribute *attr, char *buf)
+{
+	struct cma *cma = cma_from_kobj(kobj);
+
+	return sysfs_emit(buf, "%llu\n", atomic64_read(&cma->nr_ready_hits));
+}
+CMA_ATTR_RO(ready_hits);
+
+static ssize_t ready_chunks_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	struct cma *cma = cma_from_kobj(kobj);
+
+	return sysfs_emit(buf, "%u %u\n", READ_ONCE(cma->nr_ready),
+			  READ_ONCE(cma->ready_target));
+}
+
+static ssize_t ready_chunks_store(struct kobject *kobj,
+				  struct kobj_attribute *attr,
+				  const char *buf, size_t count)
+{
+	struct cma *cma = cma_from_kobj(kobj);
+	unsigned int nr;
+	int err;
+
+	err = kstrtouint(buf, 0, &nr);
+	if (err)
+		return err;
+
+	err = cma_set_ready(cma, nr, READ_ONCE(cma->ready_order));
+
+	return err ? err : count;
+}
+CMA_ATTR_RW(ready_chunks);
+
+static ssize_t ready_order_show(struct kobject *kobj,
+				struct kobj_attribute *attr, char *buf)
+{
+	struct cma *cma = cma_from_kobj(kobj);
+
+	return sysfs_emit(buf, "%u\n", READ_ONCE(cma->ready_order));
+}
+
+static ssize_t ready_order_store(struct kobject *kobj,
+				 struct kobj_attribute *attr,
+				 const char *buf, size_t count)
+{
+	struct cma *cma = cma_from_kobj(kobj);
+	unsigned int order;
+	int err;
+
+	err = kstrtouint(buf, 0, &order);
+	if (err)
+		return err;
+
+	err = cma_set_ready(cma, READ_ONCE(cma->ready_target), order);
+
+	return err ? err : count;
+}
+CMA_ATTR_RW(ready_order);
+
 static void cma_kobj_release(struct kobject *kobj)
 {
 	struct cma *cma = cma_from_kobj(kobj);
@@ -60,6 +173,10 @@ static void cma_kobj_release(struct kobject *kobj)
 static struct attribute *cma_attrs[] = {
 	&alloc_pages_success_attr.attr,
 	&alloc_pages_fail_attr.attr,
+	&alloc_latency_attr.attr,
+	&ready_hits_attr.attr,
+	&ready_chunks_attr.attr,
+	&ready_order_attr.attr,
 	NULL,
 };
 ATTRIBUTE_GROUPS(cma);
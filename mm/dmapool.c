@@ -17,18 +17,28 @@
  * least 'size' bytes.  Free blocks are tracked in an unsorted singly-linked
  * list of free blocks within the page.  Used blocks aren't tracked, but we
  * keep a count of how many are currently allocated from each page.
+ *
+ * Freed blocks first go to a small per-CPU magazine of the pool, from which
+ * the next allocations on that CPU are served without taking the pool lock
+ * or walking the pages.  Under memory pressure a shrinker drains the
+ * magazines back to the pages and frees the pages left unused.
  */
 
+#include <linux/debugfs.h>
 #include <linux/device.h>
 #include <linux/dma-mapping.h>
 #include <linux/dmapool.h>
+#include <linux/init.h>
 #include <linux/kernel.h>
 #include <linux/list.h>
 #include <linux/export.h>
 #include <linux/mutex.h>
+#include <linux/percpu.h>
 #include <linux/poison.h>
 #include <linux/sched.h>
 #include <linux/sched/mm.h>
+#include <linux/seq_file.h>
+#include <linux/shrinker.h>
 #include <linux/slab.h>
 #include <linux/stat.h>
 #include <linux/spinlock.h>
@@ -40,6 +50,22 @@
 #define DMAPOOL_DEBUG 1
 #endif
 
+#define DMAPOOL_MAG_SIZE	16
+
+struct dma_pool_block {
+	void *vaddr;
+	dma_addr_t dma;
+};
+
+struct dma_pool_magazine {	/* per-CPU cache of free blocks */
+	spinlock_t lock;	/* only contended by the drain */
+	unsigned int nr;
+	struct dma_pool_block blocks[DMAPOOL_MAG_SIZE];
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long overflows;
+};
+
 struct dma_pool {		/* the pool */
 	struct list_head page_list;
 	spinlock_t lock;
@@ -49,6 +75,10 @@ struct dma_pool {		/* the pool */
 	size_t boundary;
 	char name[32];
 	struct list_head pools;
+	struct dma_pool_magazine __percpu *mag;
+	struct list_head all;	/* in pools_all, for the shrinker */
+	unsigned int nr_pages;
+	unsigned long reclaimed;
 };
 
 struct dma_page {		/* cacheable header for 'allocation' bytes */
@@ -61,6 +91,8 @@ struct dma_page {		/* cacheable header for 'allocation' bytes */
 
 static DEFINE_MUTEX(pools_lock);
 static DEFINE_MUTEX(pools_reg_lock);
+static DEFINE_MUTEX(pools_all_lock);
+static LIST_HEAD(pools_all);
 
 static ssize_t pools_show(struct device *dev, struct device_attribute *attr, char *buf)
 {
@@ -165,9 +197,25 @@ struct dma_pool *dma_pool_create(const char *name, struct device *dev,
 	retval->size = size;
 	retval->boundary = boundary;
 	retval->allocation = allocation;
+	retval->nr_pages = 0;
+	retval->reclaimed = 0;
 
 	INIT_LIST_HEAD(&retval->pools);
 
+	/*
+	 * The debug checks need every block to go through the pages, and the
+	 * pool still works, just slower, without magazines.
+	 */
+	retval->mag = NULL;
+	if (!IS_ENABLED(DMAPOOL_DEBUG))
+		retval->mag = alloc_percpu(struct dma_pool_magazine);
+	if (retval->mag) {
+		int cpu;
+
+		for_each_possible_cpu(cpu)
+			spin_lock_init(&per_cpu_ptr(retval->mag, cpu)->lock);
+	}
+
 	/*
 	 * pools_lock ensures that the ->dma_pools list does not get corrupted.
 	 * pools_reg_lock ensures that there is not a race between
@@ -191,11 +239,17 @@ struct dma_pool *dma_pool_create(const char *name, struct device *dev,
 			list_del(&retval->pools);
 			mutex_unlock(&pools_lock);
 			mutex_unlock(&pools_reg_lock);
+			free_percpu(retval->mag);
 			kfree(retval);
 			return NULL;
 		}
 	}
 	mutex_unlock(&pools_reg_lock);
+
+	mutex_lock(&pools_all_lock);
+	list_add(&retval->all, &pools_all);
+	mutex_unlock(&pools_all_lock);
+
 	return retval;
 }
 EXPORT_SYMBOL(dma_pool_create);
@@ -256,6 +310,101 @@ static void pool_free_page(struct dma_pool *pool, struct dma_page *page)
 	kfree(page);
 }
 
+static void *pool_mag_alloc(struct dma_pool *pool, dma_addr_t *handle)
+{
+	struct dma_pool_magazine *mag;
+	unsigned long flags;
+	void *retval = NULL;
+
+	if (!pool->mag)
+		return NULL;
+
+	local_irq_save(flags);
+	mag = this_cpu_ptr(pool->mag);
+	spin_lock(&mag->lock);
+	if (mag->nr) {
+		mag->nr--;
+		retval = mag->blocks[mag->nr].vaddr;
+		*handle = mag->blocks[mag->nr].dma;
+		mag->hits++;
+	} else {
+		mag->misses++;
+	}
+	spin_unlock(&mag->lock);
+	local_irq_restore(flags);
+
+	return retval;
+}
+
+static bool pool_mag_free(struct dma_pool *pool, void *vaddr, dma_addr_t dma)
+{
+	struct dma_pool_magazine *mag;
+	unsigned long flags;
+	bool cached = false;
+
+	if (!pool->mag)
+		return false;
+
+	local_irq_save(flags);
+	mag = this_cpu_ptr(pool->mag);
+	spin_lock(&mag->lock);
+	if (mag->nr < DMAPOOL_MAG_SIZE) {
+		if (want_init_on_free())
+			memset(vaddr, 0, pool->size);
+		mag->blocks[mag->nr].vaddr = vaddr;
+		mag->blocks[mag->nr].dma = dma;
+		mag->nr++;
+		cached = true;
+	} else {
+		mag->overflows++;
+	}
+	spin_unlock(&mag->lock);
+	local_irq_restore(flags);
+
+	return cached;
+}
+
+static struct dma_page *pool_find_page(struct dma_pool *pool, dma_addr_t dma)
+{
+	struct dma_page *page;
+
+	list_for_each_entry(page, &pool->page_list, page_list) {
+		if (dma < page->dma)
+			continue;
+		if ((dma - page->dma) < pool->allocation)
+			return page;
+	}
+	return NULL;
+}
+
+/* Give the blocks of all the magazines back to their pages. */
+static void pool_drain_magazines(struct dma_pool *pool)
+{
+	struct dma_pool_magazine *mag;
+	struct dma_pool_block *block;
+	struct dma_page *page;
+	unsigned long flags;
+	int cpu;
+
+	if (!pool->mag)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		mag = per_cpu_ptr(pool->mag, cpu);
+		spin_lock_irqsave(&mag->lock, flags);
+		spin_lock(&pool->lock);
+		while (mag->nr) {
+			block = &mag->blocks[--mag->nr];
+			page = pool_find_page(pool, block->dma);
+			page->in_use--;
+			*(int *)block->vaddr = page->offset;
+			page->offset = block->vaddr - page->vaddr;
+		}
+		spin_unlock(&pool->lock);
+		spin_unlock_irqrestore(&mag->lock, flags);
+	}
+}
+
 /**
  * dma_pool_destroy - destroys a pool of dma memory blocks.
  * @pool: dma pool that will be destroyed
@@ -272,6 +421,10 @@ void dma_pool_destroy(struct dma_pool *pool)
 	if (unlikely(!pool))
 		return;
 
+	mutex_lock(&pools_all_lock);
+	list_del(&pool->all);
+	mutex_unlock(&pools_all_lock);
+
 	mutex_lock(&pools_reg_lock);
 	mutex_lock(&pools_lock);
 	list_del(&pool->pools);
@@ -282,6 +435,9 @@ void dma_pool_destroy(struct dma_pool *pool)
 		device_remove_file(pool->dev, &dev_attr_pools);
 	mutex_unlock(&pools_reg_lock);
 
+	pool_drain_magazines(pool);
+	free_percpu(pool->mag);
+
 	list_for_each_entry_safe(page, tmp, &pool->page_list, page_list) {
 		if (is_page_busy(page)) {
 			if (pool->dev)
@@ -321,6 +477,10 @@ void *dma_pool_alloc(struct dma_pool *pool, gfp_t mem_flags,
 
 	might_alloc(mem_flags);
 
+	retval = pool_mag_alloc(pool, handle);
+	if (retval)
+		goto init;
+
 	spin_lock_irqsave(&pool->lock, flags);
 	list_for_each_entry(page, &pool->page_list, page_list) {
 		if (page->offset < pool->allocation)
@@ -337,6 +497,7 @@ void *dma_pool_alloc(struct dma_pool *pool, gfp_t mem_flags,
 	spin_lock_irqsave(&pool->lock, flags);
 
 	list_add(&page->page_list, &pool->page_list);
+	pool->nr_pages++;
  ready:
 	page->in_use++;
 	offset = page->offset;
@@ -372,6 +533,7 @@ void *dma_pool_alloc(struct dma_pool *pool, gfp_t mem_flags,
 #endif
 	spin_unlock_irqrestore(&pool->lock, flags);
 
+ init:
 	if (want_init_on_alloc(mem_flags))
 		memset(retval, 0, pool->size);
 
@@ -379,19 +541,6 @@ void *dma_pool_alloc(struct dma_pool *pool, gfp_t mem_flags,
 }
 EXPORT_SYMBOL(dma_pool_alloc);
 
-static struct dma_page *pool_find_page(struct dma_pool *pool, dma_addr_t dma)
-{
-	struct dma_page *page;
-
-	list_for_each_entry(page, &pool->page_list, page_list) {
-		if (dma < page->dma)
-			continue;
-		if ((dma - page->dma) < pool->allocation)
-			return page;
-	}
-	return NULL;
-}
-
 /**
  * dma_pool_free - put block back into dma pool
  * @pool: the dma pool holding the block
@@ -407,6 +556,9 @@ void dma_pool_free(struct dma_pool *pool, void *vaddr, dma_addr_t dma)
 	unsigned long flags;
 	unsigned int offset;
 
+	if (pool_mag_free(pool, vaddr, dma))
+		return;
+
 	spin_lock_irqsave(&pool->lock, flags);
 	page = pool_find_page(pool, dma);
 	if (!page) {
@@ -466,6 +618,125 @@ void dma_pool_free(struct dma_pool *pool, void *vaddr, dma_addr_t dma)
 }
 EXPORT_SYMBOL(dma_pool_free);
 
+/* Drain the magazines of a pool and free its unused pages. */
+static unsigned long pool_reclaim(struct dma_pool *pool)
+{
+	struct dma_page *page, *tmp;
+	unsigned long flags, freed = 0;
+	LIST_HEAD(idle);
+
+	pool_drain_magazines(pool);
+
+	spin_lock_irqsave(&pool->lock, flags);
+	list_for_each_entry_safe(page, tmp, &pool->page_list, page_list) {
+		if (is_page_busy(page))
+			continue;
+		list_move(&page->page_list, &idle);
+		pool->nr_pages--;
+		pool->reclaimed++;
+	}
+	spin_unlock_irqrestore(&pool->lock, flags);
+
+	/* dma_free_coherent() may not be called with interrupts disabled */
+	list_for_each_entry_safe(page, tmp, &idle, page_list) {
+		pool_free_page(pool, page);
+		freed++;
+	}
+
+	return freed;
+}
+
+static unsigned long dma_pool_shrink_count(struct shrinker *shrink,
+					   struct shrink_control *sc)
+{
+	struct dma_pool *pool;
+	unsigned long count = 0;
+
+	if (!mutex_trylock(&pools_all_lock))
+		return 0;
+	list_for_each_entry(pool, &pools_all, all)
+		count += READ_ONCE(pool->nr_pages);
+	mutex_unlock(&pools_all_lock);
+
+	return count ?: SHRINK_EMPTY;
+}
+
+static unsigned long dma_pool_shrink_scan(struct shrinker *shrink,
+					  struct shrink_control *sc)
+{
+	struct dma_pool *pool;
+	unsigned long freed = 0;
+
+	if (!mutex_trylock(&pools_all_lock))
+		return SHRINK_STOP;
+	list_for_each_entry(pool, &pools_all, all) {
+		freed += pool_reclaim(pool);
+		if (freed >= sc->nr_to_scan)
+			break;
+	}
+	mutex_unlock(&pools_all_lock);
+
+	return freed;
+}
+
+static struct shrinker dma_pool_shrinker = {
+	.count_objects = dma_pool_shrink_count,
+	.scan_objects = dma_pool_shrink_scan,
+	.seeks = DEFAULT_SEEKS,
+};
+
+static int dma_pool_stats_show(struct seq_file *s, void *unused)
+{
+	struct dma_pool_magazine *mag;
+	struct dma_pool *pool;
+	struct dma_page *page;
+
+	seq_puts(s, "device           pool             size  pages  used   cached hits       misses     overflows  reclaimed\n");
+
+	mutex_lock(&pools_all_lock);
+	list_for_each_entry(pool, &pools_all, all) {
+		unsigned long hits = 0, misses = 0, overflows = 0;
+		unsigned int blocks = 0, cached = 0, pages;
+		int cpu;
+
+		spin_lock_irq(&pool->lock);
+		list_for_each_entry(page, &pool->page_list, page_list)
+			blocks += page->in_use;
+		pages = pool->nr_pages;
+		spin_unlock_irq(&pool->lock);
+
+		if (pool->mag) {
+			for_each_possible_cpu(cpu) {
+				mag = per_cpu_ptr(pool->mag, cpu);
+				cached += READ_ONCE(mag->nr);
+				hits += READ_ONCE(mag->hits);
+				misses += READ_ONCE(mag->misses);
+				overflows += READ_ONCE(mag->overflows);
+			}
+		}
+
+		/* the magazines may have changed since the pages were counted */
+		blocks -= min(blocks, cached);
+
+		seq_printf(s, "%-16s %-16s %5zu %6u %6u %6u %10lu %10lu %10lu %10lu\n",
+			   pool->dev ? dev_name(pool->dev) : "-", pool->name,
+			   pool->size, pages, blocks, cached, hits, misses,
+			   overflows, pool->reclaimed);
+	}
+	mutex_unlock(&pools_all_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(dma_pool_stats);
+
+static int __init dma_pool_init(void)
+{
+	debugfs_create_file("dmapool", 0400, NULL, NULL, &dma_pool_stats_fops);
+
+	return register_shrinker(&dma_pool_shrinker, "dmapool");
+}
+subsys_initcall(dma_pool_init);
+
 /*
  * Managed DMA pool
  */
@@ -40,6 +40,7 @@
 #include <linux/random.h>
 #include <kunit/test.h>
 #include <linux/sort.h>
+#include <linux/hash.h>
 
 #include <linux/debugfs.h>
 #include <trace/events/kmem.h>
@@ -3295,6 +3296,142 @@ static __always_inline void maybe_wipe_obj_freeptr(struct kmem_cache *s,
 			0, sizeof(void *));
 }
 
+#ifdef CONFIG_SYSFS
+/*
+ * Sampling allocation profiler, driven from the alloc_profile sysfs file.
+ * Once every @rate allocations, and separately every @rate frees, on a CPU
+ * the event is accounted to its call site.  A free is remote when the slab
+ * of the object isn't the CPU slab of the freeing CPU, which is what the
+ * objects allocated on another CPU and the ones left behind in partial slabs
+ * come down to.  When off, the hooks are a static branch.
+ */
+#define SLUB_PROFILE_BITS	6
+#define SLUB_PROFILE_SITES	(1 << SLUB_PROFILE_BITS)
+
+struct slub_profile_site {
+	unsigned long addr;
+	unsigned long allocs;
+	unsigned long bytes;
+	unsigned long frees;
+	unsigned long remote_frees;
+};
+
+struct slub_profile {
+	unsigned int rate;
+	raw_spinlock_t lock;
+	unsigned long lost;	/* samples dropped, all the sites being taken */
+	struct slub_profile_site site[SLUB_PROFILE_SITES];
+};
+
+static DEFINE_STATIC_KEY_FALSE(slub_profile_enabled);
+static DEFINE_MUTEX(slub_profile_mutex);
+
+static struct slub_profile *slub_profile_sample(struct kmem_cache *s)
+{
+	struct slub_profile *prof = READ_ONCE(s->profile);
+	unsigned int rate;
+
+	if (!prof)
+		return NULL;
+
+	rate = READ_ONCE(prof->rate);
+	if (!rate || this_cpu_dec_return(s->cpu_slab->profile_skip) > 0)
+		return NULL;
+
+	this_cpu_write(s->cpu_slab->profile_skip, rate);
+	return prof;
+}
+
+/* Called with prof->lock held */
+static struct slub_profile_site *slub_profile_site(struct slub_profile *prof,
+						   unsigned long addr)
+{
+	unsigned int i, h = hash_long(addr, SLUB_PROFILE_BITS);
+	struct slub_profile_site *site;
+
+	for (i = 0; i < SLUB_PROFILE_SITES; i++) {
+		site = &prof->site[(h + i) % SLUB_PROFILE_SITES];
+		if (site->addr == addr)
+			return site;
+		if (!site->addr) {
+			site->addr = addr;
+			return site;
+		}
+	}
+
+	prof->lost++;
+	return NULL;
+}
+
+static noinline void slub_profile_alloc(struct kmem_cache *s,
+					unsigned long addr, size_t size)
+{
+	struct slub_profile_site *site;
+	struct slub_profile *prof;
+	unsigned long flags;
+
+	prof = slub_profile_sample(s);
+	if (!prof)
+		return;
+
+	raw_spin_lock_irqsave(&prof->lock, flags);
+	site = slub_profile_site(prof, addr);
+	if (site) {
+		site->allocs++;
+		site->bytes += size;
+	}
+	raw_spin_unlock_irqrestore(&prof->lock, flags);
+}
+
+static noinline void slub_profile_free(struct kmem_cache *s,
+				       struct slab *slab, int cnt,
+				       unsigned long addr)
+{
+	struct slub_profile_site *site;
+	struct slub_profile *prof;
+	unsigned long flags;
+	bool remote;
+
+	prof = slub_profile_sample(s);
+	if (!prof)
+		return;
+
+	remote = slab != READ_ONCE(raw_cpu_ptr(s->cpu_slab)->slab);
+
+	raw_spin_lock_irqsave(&prof->lock, flags);
+	site = slub_profile_site(prof, addr);
+	if (site) {
+		site->frees += cnt;
+		if (remote)
+			site->remote_frees += cnt;
+	}
+	raw_spin_unlock_irqrestore(&prof->lock, flags);
+}
+
+static __always_inline void slub_profile_alloc_hook(struct kmem_cache *s,
+						    void *object,
+						    unsigned long addr,
+						    size_t size)
+{
+	if (static_branch_unlikely(&slub_profile_enabled) && object)
+		slub_profile_alloc(s, addr, size);
+}
+
+static __always_inline void slub_profile_free_hook(struct kmem_cache *s,
+						   struct slab *slab, int cnt,
+						   unsigned long addr)
+{
+	if (static_branch_unlikely(&slub_profile_enabled))
+		slub_profile_free(s, slab, cnt, addr);
+}
+#else
+static inline void slub_profile_alloc_hook(struct kmem_cache *s, void *object,
+					   unsigned long addr, size_t size) {}
+static inline void slub_profile_free_hook(struct kmem_cache *s,
+					  struct slab *slab, int cnt,
+					  unsigned long addr) {}
+#endif
+
 /*
  * Inlined fastpath so that allocation functions (kmalloc, kmem_cache_alloc)
  * have the fastpath folded into their functions. So no function call
@@ -3396,6 +3533,7 @@ static __always_inline void *slab_alloc_node(struct kmem_cache *s, struct list_l
 
 out:
 	slab_post_alloc_hook(s, objcg, gfpflags, 1, &object, init);
+	slub_profile_alloc_hook(s, object, addr, orig_size);
 
 	return object;
 }
@@ -3653,6 +3791,7 @@ static __always_inline void slab_free(struct kmem_cache *s, struct slab *slab,
 				      void *head, void *tail, void **p, int cnt,
 				      unsigned long addr)
 {
+	slub_profile_free_hook(s, slab, cnt, addr);
 	memcg_slab_free_hook(s, slab, p, cnt);
 	/*
 	 * With KASAN enabled slab_free_freelist_hook modifies the freelist
@@ -5714,6 +5853,112 @@ STAT_ATTR(CPU_PARTIAL_NODE, cpu_partial_node);
 STAT_ATTR(CPU_PARTIAL_DRAIN, cpu_partial_drain);
 #endif	/* CONFIG_SLUB_STATS */
 
+static int slub_profile_cmp(const void *a, const void *b)
+{
+	const struct slub_profile_site *x = a, *y = b;
+	unsigned long nx = x->allocs + x->frees, ny = y->allocs + y->frees;
+
+	return nx < ny ? 1 : nx > ny ? -1 : 0;
+}
+
+static ssize_t alloc_profile_show(struct kmem_cache *s, char *buf)
+{
+	struct slub_profile_site *sites, *site;
+	struct slub_profile *prof;
+	unsigned long flags, lost;
+	unsigned int rate;
+	int i, len;
+
+	mutex_lock(&slub_profile_mutex);
+
+	prof = s->profile;
+	if (!prof) {
+		mutex_unlock(&slub_profile_mutex);
+		return sysfs_emit(buf, "0\n");
+	}
+
+	sites = kmalloc_array(SLUB_PROFILE_SITES, sizeof(*sites), GFP_KERNEL);
+	if (!sites) {
+		mutex_unlock(&slub_profile_mutex);
+		return -ENOMEM;
+	}
+
+	raw_spin_lock_irqsave(&prof->lock, flags);
+	memcpy(sites, prof->site, SLUB_PROFILE_SITES * sizeof(*sites));
+	rate = prof->rate;
+	lost = prof->lost;
+	raw_spin_unlock_irqrestore(&prof->lock, flags);
+
+	mutex_unlock(&slub_profile_mutex);
+
+	sort(sites, SLUB_PROFILE_SITES, sizeof(*sites), slub_profile_cmp, NULL);
+
+	len = sysfs_emit(buf, "%u\n", rate);
+	if (lost)
+		len += sysfs_emit_at(buf, len, "lost=%lu\n", lost);
+
+	for (i = 0; i < SLUB_PROFILE_SITES; i++) {
+		site = &sites[i];
+		if (!site->addr || len > PAGE_SIZE - KSYM_SYMBOL_LEN - 80)
+			break;
+		len += sysfs_emit_at(buf, len,
+				     "%pS allocs=%lu bytes=%lu frees=%lu remote_frees=%lu\n",
+				     (void *)site->addr, site->allocs,
+				     site->bytes, site->frees,
+				     site->remote_frees);
+	}
+
+	kfree(sites);
+	return len;
+}
+
+/* Writing a rate resets the profile, 0 stops it */
+static ssize_t alloc_profile_store(struct kmem_cache *s,
+				   const char *buf, size_t length)
+{
+	struct slub_profile *prof;
+	unsigned long flags;
+	unsigned int rate, old;
+	int err;
+
+	err = kstrtouint(buf, 10, &rate);
+	if (err)
+		return err;
+
+	mutex_lock(&slub_profile_mutex);
+
+	prof = s->profile;
+	if (!prof && rate) {
+		prof = kzalloc(sizeof(*prof), GFP_KERNEL);
+		if (!prof) {
+			mutex_unlock(&slub_profile_mutex);
+			return -ENOMEM;
+		}
+		raw_spin_lock_init(&prof->lock);
+		WRITE_ONCE(s->profile, prof);
+	}
+
+	if (prof) {
+		old = prof->rate;
+
+		raw_spin_lock_irqsave(&prof->lock, flags);
+		memset(prof->site, 0, sizeof(prof->site));
+		prof->lost = 0;
+		WRITE_ONCE(prof->rate, rate);
+		raw_spin_unlock_irqrestore(&prof->lock, flags);
+
+		if (!old && rate)
+			static_branch_inc(&slub_profile_enabled);
+		else if (old && !rate)
+			static_branch_dec(&slub_profile_enabled);
+	}
+
+	mutex_unlock(&slub_profile_mutex);
+
+	return length;
+}
+SLAB_ATTR(alloc_profile);
+
 #ifdef CONFIG_KFENCE
 static ssize_t skip_kfence_show(struct kmem_cache *s, char *buf)
 {
@@ -5807,6 +6052,7 @@ static struct attribute *slab_attrs[] = {
 #ifdef CONFIG_KFENCE
 	&skip_kfence_attr.attr,
 #endif
+	&alloc_profile_attr.attr,
 
 	NULL
 };
@@ -5849,7 +6095,15 @@ static ssize_t slab_attr_store(struct kobject *kobj,
 
 static void kmem_cache_release(struct kobject *k)
 {
-	slab_kmem_cache_release(to_slab(k));
+	struct kmem_cache *s = to_slab(k);
+
+	if (s->profile) {
+		if (s->profile->rate)
+			static_branch_dec(&slub_profile_enabled);
+		kfree(s->profile);
+	}
+
+	slab_kmem_cache_release(s);
 }
 
 static const struct sysfs_ops slab_sysfs_ops = {
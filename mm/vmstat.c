@@ -1726,11 +1726,19 @@ static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 			   "\n    cpu: %i"
 			   "\n              count: %i"
 			   "\n              high:  %i"
-			   "\n              batch: %i",
+			   "\n              high_min: %i"
+			   "\n              high_max: %i"
+			   "\n              batch: %i"
+			   "\n              refills: %lu"
+			   "\n              drains: %lu",
 			   i,
 			   pcp->count,
 			   pcp->high,
-			   pcp->batch);
+			   pcp->high_min,
+			   pcp->high_max,
+			   pcp->batch,
+			   pcp->refills,
+			   pcp->drains);
 #ifdef CONFIG_SMP
 		pzstats = per_cpu_ptr(zone->per_cpu_zonestats, i);
 		seq_printf(m, "\n  vm stats threshold: %d",
@@ -6347,11 +6347,14 @@ static void init_gro_hash(struct napi_struct *napi)
 {
 	int i;
 
-	for (i = 0; i < GRO_HASH_BUCKETS; i++) {
+	for (i = 0; i < GRO_HASH_BUCKETS_MAX; i++) {
 		INIT_LIST_HEAD(&napi->gro_hash[i].list);
 		napi->gro_hash[i].count = 0;
 	}
 	napi->gro_bitmask = 0;
+	napi->gro_merged = 0;
+	napi->gro_held = 0;
+	napi->gro_evicted = 0;
 }
 
 int dev_set_threaded(struct net_device *dev, bool threaded)
@@ -6488,7 +6491,7 @@ static void flush_gro_hash(struct napi_struct *napi)
 {
 	int i;
 
-	for (i = 0; i < GRO_HASH_BUCKETS; i++) {
+	for (i = 0; i < GRO_HASH_BUCKETS_MAX; i++) {
 		struct sk_buff *skb, *n;
 
 		list_for_each_entry_safe(skb, n, &napi->gro_hash[i].list, list)
@@ -10641,6 +10644,7 @@ struct net_device *alloc_netdev_mqs(int sizeof_priv, const char *name,
 	dev->gso_max_size = GSO_LEGACY_MAX_SIZE;
 	dev->gso_max_segs = GSO_MAX_SEGS;
 	dev->gro_max_size = GRO_LEGACY_MAX_SIZE;
+	dev->gro_hash_buckets = GRO_HASH_BUCKETS;
 	dev->tso_max_size = TSO_LEGACY_MAX_SIZE;
 	dev->tso_max_segs = TSO_MAX_SEGS;
 	dev->upper_level = 1;
@@ -11199,7 +11203,7 @@ static struct hlist_head * __net_init netdev_create_hash(void)
 /* Initialize per network namespace state */
 static int __net_init netdev_init(struct net *net)
 {
-	BUILD_BUG_ON(GRO_HASH_BUCKETS >
+	BUILD_BUG_ON(GRO_HASH_BUCKETS_MAX >
 		     8 * sizeof_field(struct napi_struct, gro_bitmask));
 
 	INIT_LIST_HEAD(&net->dev_base_head);
@@ -477,11 +477,13 @@ static void gro_flush_oldest(struct napi_struct *napi, struct list_head *head)
 	 */
 	skb_list_del_init(oldest);
 	napi_gro_complete(napi, oldest);
+	napi->gro_evicted++;
 }
 
 static enum gro_result dev_gro_receive(struct napi_struct *napi, struct sk_buff *skb)
 {
-	u32 bucket = skb_get_hash_raw(skb) & (GRO_HASH_BUCKETS - 1);
+	u32 bucket = skb_get_hash_raw(skb) &
+		     (READ_ONCE(napi->dev->gro_hash_buckets) - 1);
 	struct gro_list *gro_list = &napi->gro_hash[bucket];
 	struct list_head *head = &offload_base;
 	struct packet_offload *ptype;
@@ -546,6 +548,8 @@ static enum gro_result dev_gro_receive(struct napi_struct *napi, struct sk_buff
 
 	same_flow = NAPI_GRO_CB(skb)->same_flow;
 	ret = NAPI_GRO_CB(skb)->free ? GRO_MERGED_FREE : GRO_MERGED;
+	if (same_flow)
+		napi->gro_merged++;
 
 	if (pp) {
 		skb_list_del_init(pp);
@@ -570,6 +574,7 @@ static enum gro_result dev_gro_receive(struct napi_struct *napi, struct sk_buff
 		skb_shinfo(skb)->gso_size = skb_gro_len(skb);
 	list_add(&skb->list, &gro_list->list);
 	ret = GRO_HELD;
+	napi->gro_held++;
 
 pull:
 	grow = skb_gro_offset(skb) - skb_headlen(skb);
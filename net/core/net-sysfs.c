@@ -23,6 +23,7 @@
 #include <linux/of.h>
 #include <linux/of_net.h>
 #include <linux/cpu.h>
+#include <linux/log2.h>
 
 #include "dev.h"
 #include "net-sysfs.h"
@@ -405,6 +406,51 @@ static ssize_t gro_flush_timeout_store(struct device *dev,
 }
 NETDEVICE_SHOW_RW(gro_flush_timeout, fmt_ulong);
 
+static int change_gro_hash_buckets(struct net_device *dev, unsigned long val)
+{
+	if (!is_power_of_2(val) || val > GRO_HASH_BUCKETS_MAX)
+		return -EINVAL;
+
+	/* the packets held for a flow could be reordered */
+	if (netif_running(dev))
+		return -EBUSY;
+
+	WRITE_ONCE(dev->gro_hash_buckets, val);
+	return 0;
+}
+
+static ssize_t gro_hash_buckets_store(struct device *dev,
+				      struct device_attribute *attr,
+				      const char *buf, size_t len)
+{
+	if (!capable(CAP_NET_ADMIN))
+		return -EPERM;
+
+	return netdev_store(dev, attr, buf, len, change_gro_hash_buckets);
+}
+NETDEVICE_SHOW_RW(gro_hash_buckets, fmt_dec);
+
+/* One line per NAPI instance: id, merged, held and evicted packets */
+static ssize_t gro_stats_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	struct net_device *netdev = to_net_dev(dev);
+	struct napi_struct *napi;
+	int len = 0;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(napi, &netdev->napi_list, dev_list)
+		len += sysfs_emit_at(buf, len, "%u %lu %lu %lu\n",
+				     napi->napi_id,
+				     READ_ONCE(napi->gro_merged),
+				     READ_ONCE(napi->gro_held),
+				     READ_ONCE(napi->gro_evicted));
+	rcu_read_unlock();
+
+	return len;
+}
+static DEVICE_ATTR_RO(gro_stats);
+
 static int change_napi_defer_hard_irqs(struct net_device *dev, unsigned long val)
 {
 	WRITE_ONCE(dev->napi_defer_hard_irqs, val);
@@ -645,6 +691,8 @@ static struct attribute *net_class_attrs[] __ro_after_init = {
 	&dev_attr_flags.attr,
 	&dev_attr_tx_queue_len.attr,
 	&dev_attr_gro_flush_timeout.attr,
+	&dev_attr_gro_hash_buckets.attr,
+	&dev_attr_gro_stats.attr,
 	&dev_attr_napi_defer_hard_irqs.attr,
 	&dev_attr_phys_port_id.attr,
 	&dev_attr_phys_port_name.attr,
@@ -55,6 +55,9 @@ static const char pp_stats[][ETH_GSTRING_LEN] = {
 	"rx_pp_recycle_ring",
 	"rx_pp_recycle_ring_full",
 	"rx_pp_recycle_released_ref",
+	"rx_pp_alloc_remote_drain",
+	"rx_pp_recycle_remote",
+	"rx_pp_recycle_remote_flush",
 };
 
 bool page_pool_get_stats(struct page_pool *pool,
@@ -72,6 +75,7 @@ bool page_pool_get_stats(struct page_pool *pool,
 	stats->alloc_stats.empty += pool->alloc_stats.empty;
 	stats->alloc_stats.refill += pool->alloc_stats.refill;
 	stats->alloc_stats.waive += pool->alloc_stats.waive;
+	stats->alloc_stats.remote_drain += pool->alloc_stats.remote_drain;
 
 	for_each_possible_cpu(cpu) {
 		const struct page_pool_recycle_stats *pcpu =
@@ -82,6 +86,8 @@ bool page_pool_get_stats(struct page_pool *pool,
 		stats->recycle_stats.ring += pcpu->ring;
 		stats->recycle_stats.ring_full += pcpu->ring_full;
 		stats->recycle_stats.released_refcnt += pcpu->released_refcnt;
+		stats->recycle_stats.remote += pcpu->remote;
+		stats->recycle_stats.remote_flush += pcpu->remote_flush;
 	}
 
 	return true;
@@ -122,6 +128,9 @@ u64 *page_pool_ethtool_stats_get(u64 *data, void *stats)
 	*data++ = pool_stats->recycle_stats.ring;
 	*data++ = pool_stats->recycle_stats.ring_full;
 	*data++ = pool_stats->recycle_stats.released_refcnt;
+	*data++ = pool_stats->alloc_stats.remote_drain;
+	*data++ = pool_stats->recycle_stats.remote;
+	*data++ = pool_stats->recycle_stats.remote_flush;
 
 	return data;
 }
@@ -160,6 +169,7 @@ static int page_pool_init(struct page_pool *pool,
 			  const struct page_pool_params *params)
 {
 	unsigned int ring_qsize = 1024; /* Default */
+	int cpu;
 
 	memcpy(&pool->p, params, sizeof(pool->p));
 
@@ -209,12 +219,16 @@ static int page_pool_init(struct page_pool *pool,
 		return -ENOMEM;
 #endif
 
-	if (ptr_ring_init(&pool->ring, ring_qsize, GFP_KERNEL) < 0) {
-#ifdef CONFIG_PAGE_POOL_STATS
-		free_percpu(pool->recycle_stats);
-#endif
-		return -ENOMEM;
+	if (ptr_ring_init(&pool->ring, ring_qsize, GFP_KERNEL) < 0)
+		goto err_stats;
+
+	pool->remote = alloc_percpu(struct pp_remote_cache);
+	if (!pool->remote) {
+		ptr_ring_cleanup(&pool->ring, NULL);
+		goto err_stats;
 	}
+	for_each_possible_cpu(cpu)
+		spin_lock_init(&per_cpu_ptr(pool->remote, cpu)->lock);
 
 	atomic_set(&pool->pages_state_release_cnt, 0);
 
@@ -225,6 +239,12 @@ static int page_pool_init(struct page_pool *pool,
 		get_device(pool->p.dev);
 
 	return 0;
+
+err_stats:
+#ifdef CONFIG_PAGE_POOL_STATS
+	free_percpu(pool->recycle_stats);
+#endif
+	return -ENOMEM;
 }
 
 struct page_pool *page_pool_create(const struct page_pool_params *params)
@@ -249,6 +269,53 @@ EXPORT_SYMBOL(page_pool_create);
 
 static void page_pool_return_page(struct page_pool *pool, struct page *page);
 
+/* Move the pages of a remote cache into the ptr_ring, with rem->lock held */
+static void page_pool_remote_flush(struct page_pool *pool,
+				   struct pp_remote_cache *rem)
+{
+	bool in_softirq;
+	u32 i;
+
+	in_softirq = page_pool_producer_lock(pool);
+	for (i = 0; i < rem->count; i++) {
+		if (__ptr_ring_produce(&pool->ring, rem->cache[i])) {
+			recycle_stat_inc(pool, ring_full);
+			break;
+		}
+	}
+	recycle_stat_add(pool, ring, i);
+	page_pool_producer_unlock(pool, in_softirq);
+	recycle_stat_inc(pool, remote_flush);
+
+	for (; i < rem->count; i++)
+		page_pool_return_page(pool, rem->cache[i]);
+	rem->count = 0;
+}
+
+/* Flush what the remote caches of all CPUs hold, returns true if any */
+static bool page_pool_remote_drain(struct page_pool *pool)
+{
+	struct pp_remote_cache *rem;
+	bool drained = false;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		rem = per_cpu_ptr(pool->remote, cpu);
+		/* racy peek, a cache being filled will flush itself */
+		if (!READ_ONCE(rem->count))
+			continue;
+
+		spin_lock_bh(&rem->lock);
+		if (rem->count) {
+			page_pool_remote_flush(pool, rem);
+			drained = true;
+		}
+		spin_unlock_bh(&rem->lock);
+	}
+
+	return drained;
+}
+
 noinline
 static struct page *page_pool_refill_alloc_cache(struct page_pool *pool)
 {
@@ -258,8 +325,12 @@ static struct page *page_pool_refill_alloc_cache(struct page_pool *pool)
 
 	/* Quicker fallback, avoid locks when ring is empty */
 	if (__ptr_ring_empty(r)) {
-		alloc_stat_inc(pool, empty);
-		return NULL;
+		/* Last chance, pages parked on the CPUs which freed them */
+		if (!page_pool_remote_drain(pool) || __ptr_ring_empty(r)) {
+			alloc_stat_inc(pool, empty);
+			return NULL;
+		}
+		alloc_stat_inc(pool, remote_drain);
 	}
 
 	/* Softirq guarantee CPU and thus NUMA node is stable. This,
@@ -535,21 +606,24 @@ static void page_pool_return_page(struct page_pool *pool, struct page *page)
 	 */
 }
 
-static bool page_pool_recycle_in_ring(struct page_pool *pool, struct page *page)
+/* Park the page in this CPU's remote cache, flushed once full. Never fails,
+ * a full ptr_ring makes the flush release the pages instead.
+ */
+static void page_pool_recycle_in_remote(struct page_pool *pool,
+					struct page *page)
 {
-	int ret;
-	/* BH protection not needed if current is softirq */
-	if (in_softirq())
-		ret = ptr_ring_produce(&pool->ring, page);
-	else
-		ret = ptr_ring_produce_bh(&pool->ring, page);
+	struct pp_remote_cache *rem;
 
-	if (!ret) {
-		recycle_stat_inc(pool, ring);
-		return true;
-	}
-
-	return false;
+	local_bh_disable();
+	rem = this_cpu_ptr(pool->remote);
+	spin_lock(&rem->lock);
+	rem->cache[rem->count] = page;
+	WRITE_ONCE(rem->count, rem->count + 1);
+	recycle_stat_inc(pool, remote);
+	if (rem->count == PP_REMOTE_BATCH)
+		page_pool_remote_flush(pool, rem);
+	spin_unlock(&rem->lock);
+	local_bh_enable();
 }
 
 /* Only allow direct recycling in special circumstances, into the
@@ -629,11 +703,8 @@ void page_pool_put_defragged_page(struct page_pool *pool, struct page *page,
 				  unsigned int dma_sync_size, bool allow_direct)
 {
 	page = __page_pool_put_page(pool, page, dma_sync_size, allow_direct);
-	if (page && !page_pool_recycle_in_ring(pool, page)) {
-		/* Cache full, fallback to free pages */
-		recycle_stat_inc(pool, ring_full);
-		page_pool_return_page(pool, page);
-	}
+	if (page)
+		page_pool_recycle_in_remote(pool, page);
 }
 EXPORT_SYMBOL(page_pool_put_defragged_page);
 
@@ -784,6 +855,7 @@ static void page_pool_free(struct page_pool *pool)
 		pool->disconnect(pool);
 
 	ptr_ring_cleanup(&pool->ring, NULL);
+	free_percpu(pool->remote);
 
 	if (pool->p.flags & PP_FLAG_DMA_MAP)
 		put_device(pool->p.dev);
@@ -819,6 +891,7 @@ static void page_pool_scrub(struct page_pool *pool)
 	/* No more consumers should exist, but producers could still
 	 * be in-flight.
 	 */
+	page_pool_remote_drain(pool);
 	page_pool_empty_ring(pool);
 }
 
@@ -200,6 +200,7 @@
 	pf(VID_RND)		/* Random VLAN ID */			\
 	pf(SVID_RND)		/* Random SVLAN ID */			\
 	pf(NODE)		/* Node memory alloc*/			\
+	pf(LAT_HWTS)		/* RX HW timestamps for latency */	\
 
 #define pf(flag)		flag##_SHIFT,
 enum pkt_flags {
@@ -242,6 +243,18 @@ static char *pkt_flag_names[] = {
 
 #define MAX_CFLOWS  65536
 
+/* RX latency histogram: PKTGEN_LAT_SUB buckets per power of 2 of usecs */
+#define PKTGEN_LAT_SUB_SHIFT	3
+#define PKTGEN_LAT_SUB		(1 << PKTGEN_LAT_SUB_SHIFT)
+#define PKTGEN_LAT_BUCKETS ((32 - PKTGEN_LAT_SUB_SHIFT + 1) * PKTGEN_LAT_SUB)
+
+struct pktgen_lat {
+	u64 rx;		/* pktgen packets received */
+	u64 skew;	/* received before their TX timestamp */
+	u64 max;	/* usec */
+	u64 hist[PKTGEN_LAT_BUCKETS];
+};
+
 #define VLAN_TAG_SIZE(x) ((x)->vlan_id == 0xffff ? 0 : 4)
 #define SVLAN_TAG_SIZE(x) ((x)->svlan_id == 0xffff ? 0 : 4)
 
@@ -431,6 +444,16 @@ struct pktgen_dev {
 	struct xfrm_dst xdst;
 	struct dst_ops dstops;
 #endif
+
+	/* RX latency measurement */
+	struct net_device *lat_dev;	/* the packets come back on it */
+	netdevice_tracker lat_dev_tracker;
+	struct packet_type lat_pt;
+	struct pktgen_lat __percpu *lat;
+
+	u64 *queue_sofar;	/* packets sent on each TX queue of odev */
+	unsigned int nr_queues;
+
 	char result[512];
 };
 
@@ -496,6 +519,8 @@ static int pg_clone_skb_d  __read_mostly;
 static int debug  __read_mostly;
 
 static DEFINE_MUTEX(pktgen_thread_lock);
+/* Serializes the start and stop of the RX latency measurements */
+static DEFINE_MUTEX(pktgen_lat_lock);
 
 static struct notifier_block pktgen_notifier_block = {
 	.notifier_call = pktgen_device_event,
@@ -557,6 +582,233 @@ static const struct proc_ops pktgen_proc_ops = {
 	.proc_release	= single_release,
 };
 
+static unsigned int pktgen_lat_bucket(u32 us)
+{
+	unsigned int msb;
+
+	if (us < PKTGEN_LAT_SUB)
+		return us;
+
+	msb = fls(us) - 1;
+	return (msb - PKTGEN_LAT_SUB_SHIFT + 1) * PKTGEN_LAT_SUB +
+	       ((us >> (msb - PKTGEN_LAT_SUB_SHIFT)) & (PKTGEN_LAT_SUB - 1));
+}
+
+/* Largest latency counted in bucket @b */
+static u64 pktgen_lat_bucket_max(unsigned int b)
+{
+	unsigned int msb, sub;
+
+	b++;
+	if (b >= PKTGEN_LAT_BUCKETS)
+		return U32_MAX;
+	if (b < PKTGEN_LAT_SUB)
+		return b - 1;
+
+	msb = b / PKTGEN_LAT_SUB + PKTGEN_LAT_SUB_SHIFT - 1;
+	sub = b % PKTGEN_LAT_SUB;
+	return ((u64)(PKTGEN_LAT_SUB + sub) << (msb - PKTGEN_LAT_SUB_SHIFT)) - 1;
+}
+
+static bool pktgen_lat_port(const struct pktgen_dev *pkt_dev, u16 port)
+{
+	if (pkt_dev->udp_dst_min < pkt_dev->udp_dst_max)
+		return port >= pkt_dev->udp_dst_min &&
+		       port < pkt_dev->udp_dst_max;
+
+	return port == pkt_dev->udp_dst_min;
+}
+
+/*
+ * Receive handler of lat_dev: the packets sent by pkt_dev are recognized
+ * by their UDP destination port and the pktgen header magic, and their
+ * latency is the time elapsed since the timestamp of that header.
+ */
+static int pktgen_lat_rcv(struct sk_buff *skb, struct net_device *dev,
+			  struct packet_type *pt, struct net_device *orig_dev)
+{
+	struct pktgen_dev *pkt_dev = pt->af_packet_priv;
+	struct pktgen_hdr _pgh, *pgh;
+	struct udphdr _udph, *udph;
+	struct timespec64 ts;
+	unsigned int off;
+	ktime_t rx;
+	s64 us;
+
+	if (skb->protocol == htons(ETH_P_IP)) {
+		struct iphdr _iph, *iph;
+
+		iph = skb_header_pointer(skb, 0, sizeof(_iph), &_iph);
+		if (!iph || iph->ihl < 5 || iph->protocol != IPPROTO_UDP)
+			goto out;
+		off = iph->ihl * 4;
+	} else {
+		struct ipv6hdr _ip6h, *ip6h;
+
+		ip6h = skb_header_pointer(skb, 0, sizeof(_ip6h), &_ip6h);
+		if (!ip6h || ip6h->nexthdr != IPPROTO_UDP)
+			goto out;
+		off = sizeof(*ip6h);
+	}
+
+	udph = skb_header_pointer(skb, off, sizeof(_udph), &_udph);
+	if (!udph || !pktgen_lat_port(pkt_dev, ntohs(udph->dest)))
+		goto out;
+
+	pgh = skb_header_pointer(skb, off + sizeof(_udph), sizeof(_pgh), &_pgh);
+	if (!pgh || pgh->pgh_magic != htonl(PKTGEN_MAGIC) ||
+	    (!pgh->tv_sec && !pgh->tv_usec))
+		goto out;
+
+	if ((pkt_dev->flags & F_LAT_HWTS) && skb_hwtstamps(skb)->hwtstamp)
+		rx = skb_hwtstamps(skb)->hwtstamp;
+	else if (skb->tstamp && !skb->mono_delivery_time)
+		rx = skb->tstamp;
+	else
+		rx = ktime_get_real();
+
+	/* the header only has the low 32 bits of the seconds */
+	ts = ktime_to_timespec64(rx);
+	us = (s64)(s32)((u32)ts.tv_sec - ntohl(pgh->tv_sec)) * USEC_PER_SEC +
+	     ts.tv_nsec / NSEC_PER_USEC - ntohl(pgh->tv_usec);
+
+	this_cpu_inc(pkt_dev->lat->rx);
+	if (us < 0) {
+		this_cpu_inc(pkt_dev->lat->skew);
+		goto out;
+	}
+	if (us > U32_MAX)
+		us = U32_MAX;
+
+	this_cpu_inc(pkt_dev->lat->hist[pktgen_lat_bucket(us)]);
+	if (us > this_cpu_read(pkt_dev->lat->max))
+		this_cpu_write(pkt_dev->lat->max, us);
+out:
+	consume_skb(skb);
+	return NET_RX_SUCCESS;
+}
+
+static void __pktgen_lat_stop(struct pktgen_dev *pkt_dev)
+{
+	if (!pkt_dev->lat_dev)
+		return;
+
+	dev_remove_pack(&pkt_dev->lat_pt);
+	netdev_put(pkt_dev->lat_dev, &pkt_dev->lat_dev_tracker);
+	pkt_dev->lat_dev = NULL;
+}
+
+static void pktgen_lat_stop(struct pktgen_dev *pkt_dev)
+{
+	mutex_lock(&pktgen_lat_lock);
+	__pktgen_lat_stop(pkt_dev);
+	mutex_unlock(&pktgen_lat_lock);
+}
+
+/*
+ * Measure the latency of the packets of pkt_dev received on @ifname, as
+ * IPv6 if the IPV6 flag is set at this point.  The receive time is the
+ * one the stack stamped the skb with, or the HW timestamp with LAT_HWTS,
+ * in which case the PHC of the device must be synchronized to
+ * CLOCK_REALTIME.  The TX timestamps have a usec resolution and are only
+ * meaningful with clone_skb 0.
+ */
+static int pktgen_lat_start(struct pktgen_dev *pkt_dev, const char *ifname)
+{
+	struct net_device *dev;
+	int err = 0;
+
+	mutex_lock(&pktgen_lat_lock);
+	__pktgen_lat_stop(pkt_dev);
+
+	if (!pkt_dev->lat) {
+		pkt_dev->lat = alloc_percpu(struct pktgen_lat);
+		if (!pkt_dev->lat) {
+			err = -ENOMEM;
+			goto unlock;
+		}
+	}
+
+	dev = dev_get_by_name(pkt_dev->pg_thread->net->net, ifname);
+	if (!dev) {
+		err = -ENODEV;
+		goto unlock;
+	}
+
+	pkt_dev->lat_dev = dev;
+	netdev_tracker_alloc(dev, &pkt_dev->lat_dev_tracker, GFP_KERNEL);
+
+	memset(&pkt_dev->lat_pt, 0, sizeof(pkt_dev->lat_pt));
+	pkt_dev->lat_pt.type = htons(pkt_dev->flags & F_IPV6 ? ETH_P_IPV6 :
+							       ETH_P_IP);
+	pkt_dev->lat_pt.dev = dev;
+	pkt_dev->lat_pt.func = pktgen_lat_rcv;
+	pkt_dev->lat_pt.af_packet_priv = pkt_dev;
+	dev_add_pack(&pkt_dev->lat_pt);
+unlock:
+	mutex_unlock(&pktgen_lat_lock);
+	return err;
+}
+
+static void pktgen_lat_clear(struct pktgen_dev *pkt_dev)
+{
+	int cpu;
+
+	if (!pkt_dev->lat)
+		return;
+
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(pkt_dev->lat, cpu), 0,
+		       sizeof(struct pktgen_lat));
+}
+
+static void pktgen_lat_show(struct seq_file *seq,
+			    const struct pktgen_dev *pkt_dev)
+{
+	static const unsigned int permille[] = { 500, 990, 999 };
+	static const char * const names[] = { "p50", "p99", "p999" };
+	u64 *hist, rx = 0, skew = 0, max = 0, total = 0, sum, target;
+	unsigned int b, i;
+	int cpu;
+
+	hist = kcalloc(PKTGEN_LAT_BUCKETS, sizeof(*hist), GFP_KERNEL);
+	if (!hist)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		const struct pktgen_lat *lat = per_cpu_ptr(pkt_dev->lat, cpu);
+
+		rx += lat->rx;
+		skew += lat->skew;
+		max = max(max, lat->max);
+		for (b = 0; b < PKTGEN_LAT_BUCKETS; b++)
+			hist[b] += lat->hist[b];
+	}
+	for (b = 0; b < PKTGEN_LAT_BUCKETS; b++)
+		total += hist[b];
+
+	seq_printf(seq, "Latency: lat_dev: %s  rx: %llu  skew: %llu\n",
+		   pkt_dev->lat_dev ? pkt_dev->lat_dev->name : "off",
+		   rx, skew);
+
+	if (total) {
+		seq_puts(seq, "    ");
+		for (i = 0; i < ARRAY_SIZE(permille); i++) {
+			target = div_u64(total * permille[i] + 999, 1000);
+			for (b = 0, sum = 0; b < PKTGEN_LAT_BUCKETS - 1; b++) {
+				sum += hist[b];
+				if (sum >= target)
+					break;
+			}
+			seq_printf(seq, " %s: %lluus", names[i],
+				   pktgen_lat_bucket_max(b));
+		}
+		seq_printf(seq, " max: %lluus\n", max);
+	}
+
+	kfree(hist);
+}
+
 static int pktgen_if_show(struct seq_file *seq, void *v)
 {
 	const struct pktgen_dev *pkt_dev = seq->private;
@@ -732,8 +984,28 @@ static int pktgen_if_show(struct seq_file *seq, void *v)
 
 	seq_printf(seq, "     cur_queue_map: %u\n", pkt_dev->cur_queue_map);
 
+	if (pkt_dev->queue_sofar) {
+		u64 elapsed = ktime_to_ns(ktime_sub(stopped,
+						    pkt_dev->started_at));
+		u64 n;
+
+		for (i = 0; i < pkt_dev->nr_queues; i++) {
+			n = pkt_dev->queue_sofar[i];
+			if (!n)
+				continue;
+			seq_printf(seq, "     queue %u: pkts: %llu  %llupps\n",
+				   i, n, elapsed ?
+				   div64_u64(n * NSEC_PER_SEC, elapsed) : 0);
+		}
+	}
+
 	seq_printf(seq, "     flows: %u\n", pkt_dev->nflows);
 
+	mutex_lock(&pktgen_lat_lock);
+	if (pkt_dev->lat)
+		pktgen_lat_show(seq, pkt_dev);
+	mutex_unlock(&pktgen_lat_lock);
+
 	if (pkt_dev->result[0])
 		seq_printf(seq, "Result: %s\n", pkt_dev->result);
 	else
@@ -1346,7 +1618,7 @@ static ssize_t pktgen_if_write(struct file *file,
 				"MACSRC_RND, MACDST_RND, TXSIZE_RND, IPV6, "
 				"MPLS_RND, VID_RND, SVID_RND, FLOW_SEQ, "
 				"QUEUE_MAP_RND, QUEUE_MAP_CPU, UDPCSUM, "
-				"NO_TIMESTAMP, "
+				"NO_TIMESTAMP, LAT_HWTS, "
 #ifdef CONFIG_XFRM
 				"IPSEC, "
 #endif
@@ -1805,6 +2077,32 @@ static ssize_t pktgen_if_write(struct file *file,
 		return count;
 	}
 
+	if (!strcmp(name, "lat_dev")) {
+		char ifname[IFNAMSIZ];
+		int ret;
+
+		len = strn_len(&user_buffer[i], sizeof(ifname) - 1);
+		if (len < 0)
+			return len;
+
+		memset(ifname, 0, sizeof(ifname));
+		if (copy_from_user(ifname, &user_buffer[i], len))
+			return -EFAULT;
+		i += len;
+
+		if (!len || !strcmp(ifname, "off")) {
+			pktgen_lat_stop(pkt_dev);
+			sprintf(pg_result, "OK: lat_dev=off");
+			return count;
+		}
+
+		ret = pktgen_lat_start(pkt_dev, ifname);
+		if (ret)
+			return ret;
+		sprintf(pg_result, "OK: lat_dev=%s", ifname);
+		return count;
+	}
+
 	sprintf(pkt_dev->result, "No such parameter \"%s\"", name);
 	return -EINVAL;
 }
@@ -2045,6 +2343,24 @@ static void pktgen_change_name(const struct pktgen_net *pn, struct net_device *d
 	mutex_unlock(&pktgen_thread_lock);
 }
 
+/* Stop the latency measurements receiving on an unregistered device */
+static void pktgen_lat_dev_gone(const struct pktgen_net *pn,
+				struct net_device *dev)
+{
+	struct pktgen_thread *t;
+	struct pktgen_dev *pkt_dev;
+
+	mutex_lock(&pktgen_thread_lock);
+	list_for_each_entry(t, &pn->pktgen_threads, th_list) {
+		if_lock(t);
+		list_for_each_entry(pkt_dev, &t->if_list, list)
+			if (pkt_dev->lat_dev == dev)
+				pktgen_lat_stop(pkt_dev);
+		if_unlock(t);
+	}
+	mutex_unlock(&pktgen_thread_lock);
+}
+
 static int pktgen_device_event(struct notifier_block *unused,
 			       unsigned long event, void *ptr)
 {
@@ -2064,6 +2380,7 @@ static int pktgen_device_event(struct notifier_block *unused,
 		break;
 
 	case NETDEV_UNREGISTER:
+		pktgen_lat_dev_gone(pn, dev);
 		pktgen_mark_device(pn, dev->name);
 		break;
 	}
@@ -2103,6 +2420,8 @@ static int pktgen_setup_dev(const struct pktgen_net *pn,
 		netdev_put(pkt_dev->odev, &pkt_dev->dev_tracker);
 		pkt_dev->odev = NULL;
 	}
+	kfree(pkt_dev->queue_sofar);
+	pkt_dev->queue_sofar = NULL;
 
 	odev = pktgen_dev_get_by_name(pn, pkt_dev, ifname);
 	if (!odev) {
@@ -2119,6 +2438,11 @@ static int pktgen_setup_dev(const struct pktgen_net *pn,
 	} else {
 		pkt_dev->odev = odev;
 		netdev_tracker_alloc(odev, &pkt_dev->dev_tracker, GFP_KERNEL);
+		/* the per queue counts are optional */
+		pkt_dev->nr_queues = odev->num_tx_queues;
+		pkt_dev->queue_sofar = kcalloc(pkt_dev->nr_queues,
+					       sizeof(*pkt_dev->queue_sofar),
+					       GFP_KERNEL);
 		return 0;
 	}
 
@@ -3131,6 +3455,10 @@ static void pktgen_clear_counters(struct pktgen_dev *pkt_dev)
 	pkt_dev->sofar = 0;
 	pkt_dev->tx_bytes = 0;
 	pkt_dev->errors = 0;
+	if (pkt_dev->queue_sofar)
+		memset(pkt_dev->queue_sofar, 0,
+		       pkt_dev->nr_queues * sizeof(*pkt_dev->queue_sofar));
+	pktgen_lat_clear(pkt_dev);
 }
 
 /* Set up structure for sending pkts, clear counters */
@@ -3440,6 +3768,14 @@ static void pktgen_wait_for_skb(struct pktgen_dev *pkt_dev)
 	pkt_dev->idle_acc += ktime_to_ns(ktime_sub(ktime_get(), idle_start));
 }
 
+static void pktgen_count_queue(struct pktgen_dev *pkt_dev)
+{
+	u16 queue = skb_get_queue_mapping(pkt_dev->skb);
+
+	if (pkt_dev->queue_sofar && queue < pkt_dev->nr_queues)
+		pkt_dev->queue_sofar[queue]++;
+}
+
 static void pktgen_xmit(struct pktgen_dev *pkt_dev)
 {
 	unsigned int burst = READ_ONCE(pkt_dev->burst);
@@ -3519,6 +3855,7 @@ static void pktgen_xmit(struct pktgen_dev *pkt_dev)
 			pkt_dev->sofar++;
 			pkt_dev->seq_num++;
 			pkt_dev->tx_bytes += pkt_dev->last_pkt_size;
+			pktgen_count_queue(pkt_dev);
 			break;
 		case NET_XMIT_DROP:
 		case NET_XMIT_CN:
@@ -3562,6 +3899,7 @@ static void pktgen_xmit(struct pktgen_dev *pkt_dev)
 		pkt_dev->sofar++;
 		pkt_dev->seq_num++;
 		pkt_dev->tx_bytes += pkt_dev->last_pkt_size;
+		pktgen_count_queue(pkt_dev);
 		if (burst > 0 && !netif_xmit_frozen_or_drv_stopped(txq))
 			goto xmit_more;
 		break;
@@ -3903,6 +4241,7 @@ static int pktgen_remove_device(struct pktgen_thread *t,
 		netdev_put(pkt_dev->odev, &pkt_dev->dev_tracker);
 		pkt_dev->odev = NULL;
 	}
+	pktgen_lat_stop(pkt_dev);
 
 	/* Remove proc before if_list entry, because add_device uses
 	 * list to determine if interface already exist, avoid race
@@ -3918,6 +4257,8 @@ static int pktgen_remove_device(struct pktgen_thread *t,
 	vfree(pkt_dev->flows);
 	if (pkt_dev->page)
 		put_page(pkt_dev->page);
+	free_percpu(pkt_dev->lat);
+	kfree(pkt_dev->queue_sofar);
 	kfree_rcu(pkt_dev, rcu);
 	return 0;
 }
@@ -1915,9 +1915,30 @@ static skb_frag_t *skb_advance_to_frag(struct sk_buff *skb, u32 offset_skb,
 	return frag;
 }
 
-static bool can_map_frag(const skb_frag_t *frag)
+/* Number of frags, starting at @frag, laying out one whole page in order,
+ * or 0 if there are none.  Besides a full page frag, this catches the sub-page
+ * frags a driver carved out of the same page for consecutive payloads, as
+ * header split does with page_pool pages.
+ */
+static int can_map_frag(const skb_frag_t *frag, int remaining_in_skb)
 {
-	return skb_frag_size(frag) == PAGE_SIZE && !skb_frag_off(frag);
+	struct page *page;
+	u32 off = 0;
+	int nr = 0;
+
+	if (remaining_in_skb <= 0)
+		return 0;
+
+	page = skb_frag_page(frag);
+	while (off < PAGE_SIZE && remaining_in_skb > 0) {
+		if (skb_frag_page(frag) != page || skb_frag_off(frag) != off)
+			return 0;
+		off += skb_frag_size(frag);
+		remaining_in_skb -= skb_frag_size(frag);
+		++frag;
+		++nr;
+	}
+	return off == PAGE_SIZE ? nr : 0;
 }
 
 static int find_next_mappable_frag(const skb_frag_t *frag,
@@ -1925,10 +1946,11 @@ static int find_next_mappable_frag(const skb_frag_t *frag,
 {
 	int offset = 0;
 
-	if (likely(can_map_frag(frag)))
+	if (likely(can_map_frag(frag, remaining_in_skb)))
 		return 0;
 
-	while (offset < remaining_in_skb && !can_map_frag(frag)) {
+	while (offset < remaining_in_skb &&
+	       !can_map_frag(frag, remaining_in_skb - offset)) {
 		offset += skb_frag_size(frag);
 		++frag;
 	}
@@ -2233,8 +2255,8 @@ static int tcp_zerocopy_receive(struct sock *sk,
 	}
 	ret = 0;
 	while (length + PAGE_SIZE <= zc->length) {
-		int mappable_offset;
 		struct page *page;
+		int nr_frags;
 
 		if (zc->recv_skip_hint < PAGE_SIZE) {
 			u32 offset_frag;
@@ -2258,10 +2280,11 @@ static int tcp_zerocopy_receive(struct sock *sk,
 				break;
 		}
 
-		mappable_offset = find_next_mappable_frag(frags,
-							  zc->recv_skip_hint);
-		if (mappable_offset) {
-			zc->recv_skip_hint = mappable_offset;
+		nr_frags = can_map_frag(frags, zc->recv_skip_hint);
+		if (!nr_frags) {
+			zc->recv_skip_hint =
+				find_next_mappable_frag(frags,
+							zc->recv_skip_hint);
 			break;
 		}
 		page = skb_frag_page(frags);
@@ -2269,7 +2292,7 @@ static int tcp_zerocopy_receive(struct sock *sk,
 		pages[pages_to_map++] = page;
 		length += PAGE_SIZE;
 		zc->recv_skip_hint -= PAGE_SIZE;
-		frags++;
+		frags += nr_frags;
 		if (pages_to_map == TCP_ZEROCOPY_PAGE_BATCH_SIZE ||
 		    zc->recv_skip_hint < PAGE_SIZE) {
 			/* Either full batch, or we're about to go to next skb